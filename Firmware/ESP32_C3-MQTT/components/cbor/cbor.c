@@ -0,0 +1,403 @@
+#include "cbor.h"
+#include <string.h>
+
+#define CBOR_MAJOR_UINT 0
+#define CBOR_MAJOR_NEGINT 1
+#define CBOR_MAJOR_BYTES 2
+#define CBOR_MAJOR_TEXT 3
+#define CBOR_MAJOR_ARRAY 4
+#define CBOR_MAJOR_MAP 5
+#define CBOR_MAJOR_TAG 6
+#define CBOR_MAJOR_SIMPLE 7
+
+#define CBOR_AI_INDEFINITE 31
+#define CBOR_BREAK 0xFF
+
+// ============ WRITER ============
+static void cw_put(cbor_writer_t *w, const void *data, size_t n)
+{
+    if (w->overflow)
+    {
+        return;
+    }
+    if (w->len + n > w->size)
+    {
+        w->overflow = true;
+        return;
+    }
+    // memmove: cbor_from_json unescapes strings into the free space and writes them from there
+    memmove(&w->buf[w->len], data, n);
+    w->len += n;
+}
+
+static void cw_byte(cbor_writer_t *w, uint8_t b)
+{
+    cw_put(w, &b, 1);
+}
+
+/**
+ * @brief Major type and argument, shortest form
+ */
+static void cw_head(cbor_writer_t *w, uint8_t major, uint64_t value)
+{
+    uint8_t head[9];
+    uint8_t n;
+
+    if (value < 24)
+    {
+        head[0] = (uint8_t)(major << 5 | value);
+        n = 1;
+    }
+    else if (value <= 0xFF)
+    {
+        head[0] = (uint8_t)(major << 5 | 24);
+        n = 2;
+    }
+    else if (value <= 0xFFFF)
+    {
+        head[0] = (uint8_t)(major << 5 | 25);
+        n = 3;
+    }
+    else if (value <= 0xFFFFFFFFu)
+    {
+        head[0] = (uint8_t)(major << 5 | 26);
+        n = 5;
+    }
+    else
+    {
+        head[0] = (uint8_t)(major << 5 | 27);
+        n = 9;
+    }
+    // Big endian argument
+    for (uint8_t i = n - 1; i >= 1; i--)
+    {
+        head[i] = (uint8_t)value;
+        value >>= 8;
+    }
+    cw_put(w, head, n);
+}
+
+static void cw_key(cbor_writer_t *w, const char *key)
+{
+    if (key)
+    {
+        size_t n = strlen(key);
+        cw_head(w, CBOR_MAJOR_TEXT, n);
+        cw_put(w, key, n);
+    }
+}
+
+static void cw_open(cbor_writer_t *w, const char *key, uint8_t major)
+{
+    cw_key(w, key);
+    cw_byte(w, (uint8_t)(major << 5 | CBOR_AI_INDEFINITE));
+    if (w->depth + 1 >= CBOR_MAX_DEPTH)
+    {
+        w->overflow = true;
+        return;
+    }
+    w->depth++;
+}
+
+static void cw_close(cbor_writer_t *w)
+{
+    if (w->depth == 0)
+    {
+        w->overflow = true;
+        return;
+    }
+    w->depth--;
+    cw_byte(w, CBOR_BREAK);
+}
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size)
+{
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->overflow = (buf == NULL || size == 0);
+    w->depth = 0;
+}
+
+void cbor_writer_begin_map(cbor_writer_t *w, const char *key)
+{
+    cw_open(w, key, CBOR_MAJOR_MAP);
+}
+
+void cbor_writer_end_map(cbor_writer_t *w)
+{
+    cw_close(w);
+}
+
+void cbor_writer_begin_array(cbor_writer_t *w, const char *key)
+{
+    cw_open(w, key, CBOR_MAJOR_ARRAY);
+}
+
+void cbor_writer_end_array(cbor_writer_t *w)
+{
+    cw_close(w);
+}
+
+void cbor_writer_string(cbor_writer_t *w, const char *key, const char *value)
+{
+    if (value == NULL)
+    {
+        cbor_writer_null(w, key);
+        return;
+    }
+    cbor_writer_string_n(w, key, value, strlen(value));
+}
+
+void cbor_writer_string_n(cbor_writer_t *w, const char *key, const char *value, size_t len)
+{
+    cw_key(w, key);
+    cw_head(w, CBOR_MAJOR_TEXT, len);
+    cw_put(w, value, len);
+}
+
+void cbor_writer_uint(cbor_writer_t *w, const char *key, uint64_t value)
+{
+    cw_key(w, key);
+    cw_head(w, CBOR_MAJOR_UINT, value);
+}
+
+void cbor_writer_int(cbor_writer_t *w, const char *key, int64_t value)
+{
+    cw_key(w, key);
+    if (value >= 0)
+    {
+        cw_head(w, CBOR_MAJOR_UINT, (uint64_t)value);
+    }
+    else
+    {
+        // -1 - value without overflowing on INT64_MIN
+        cw_head(w, CBOR_MAJOR_NEGINT, ~(uint64_t)value);
+    }
+}
+
+void cbor_writer_double(cbor_writer_t *w, const char *key, double value)
+{
+    uint8_t out[9];
+    float single = (float)value;
+
+    cw_key(w, key);
+    if ((double)single == value || value != value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &single, sizeof(bits));
+        out[0] = CBOR_MAJOR_SIMPLE << 5 | 26;
+        for (int i = 4; i >= 1; i--)
+        {
+            out[i] = (uint8_t)bits;
+            bits >>= 8;
+        }
+        cw_put(w, out, 5);
+        return;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    out[0] = CBOR_MAJOR_SIMPLE << 5 | 27;
+    for (int i = 8; i >= 1; i--)
+    {
+        out[i] = (uint8_t)bits;
+        bits >>= 8;
+    }
+    cw_put(w, out, 9);
+}
+
+void cbor_writer_bool(cbor_writer_t *w, const char *key, bool value)
+{
+    cw_key(w, key);
+    cw_byte(w, value ? (CBOR_MAJOR_SIMPLE << 5 | 21) : (CBOR_MAJOR_SIMPLE << 5 | 20));
+}
+
+void cbor_writer_null(cbor_writer_t *w, const char *key)
+{
+    cw_key(w, key);
+    cw_byte(w, CBOR_MAJOR_SIMPLE << 5 | 22);
+}
+
+size_t cbor_writer_finish(cbor_writer_t *w)
+{
+    if (w->overflow || w->depth != 0)
+    {
+        return 0;
+    }
+    return w->len;
+}
+
+// ============ READER ============
+void cbor_reader_init(cbor_reader_t *r, const uint8_t *buf, size_t len)
+{
+    r->buf = buf;
+    r->len = len;
+    r->pos = 0;
+    r->status = CBOR_READ_OK;
+}
+
+static bool cr_fail(cbor_reader_t *r, cbor_read_status_t status)
+{
+    r->status = status;
+    return false;
+}
+
+static double cr_half(uint16_t h)
+{
+    int exp = (h >> 10) & 0x1F;
+    double mant = h & 0x3FF;
+    double val;
+
+    if (exp == 0)
+    {
+        val = mant / (1 << 24); // subnormal: mant * 2^-24
+    }
+    else if (exp != 31)
+    {
+        val = (mant + 1024) * ((exp >= 25) ? (double)(1u << (exp - 25)) : 1.0 / (1u << (25 - exp)));
+    }
+    else
+    {
+        val = (mant == 0) ? __builtin_inf() : __builtin_nan("");
+    }
+    return (h & 0x8000) ? -val : val;
+}
+
+bool cbor_reader_next(cbor_reader_t *r, cbor_item_t *item)
+{
+    if (r->status != CBOR_READ_OK || r->pos >= r->len)
+    {
+        return false;
+    }
+
+    uint8_t ib = r->buf[r->pos++];
+    uint8_t major = ib >> 5;
+    uint8_t ai = ib & 0x1F;
+    uint64_t arg = ai;
+    bool indefinite = false;
+
+    memset(item, 0, sizeof(*item));
+    if (ai >= 24 && ai <= 27)
+    {
+        uint8_t n = (uint8_t)(1u << (ai - 24));
+        if (r->len - r->pos < n)
+        {
+            return cr_fail(r, CBOR_READ_ERR_TRUNCATED);
+        }
+        arg = 0;
+        for (uint8_t i = 0; i < n; i++)
+        {
+            arg = arg << 8 | r->buf[r->pos++];
+        }
+    }
+    else if (ai == CBOR_AI_INDEFINITE)
+    {
+        indefinite = true;
+    }
+    else if (ai > 27)
+    {
+        return cr_fail(r, CBOR_READ_ERR_MALFORMED);
+    }
+
+    switch (major)
+    {
+    case CBOR_MAJOR_UINT:
+    case CBOR_MAJOR_NEGINT:
+    case CBOR_MAJOR_TAG:
+        if (indefinite)
+        {
+            return cr_fail(r, CBOR_READ_ERR_MALFORMED);
+        }
+        item->type = major == CBOR_MAJOR_UINT ? CBOR_ITEM_UINT : major == CBOR_MAJOR_NEGINT ? CBOR_ITEM_NEGINT : CBOR_ITEM_TAG;
+        item->value = arg;
+        return true;
+
+    case CBOR_MAJOR_BYTES:
+    case CBOR_MAJOR_TEXT:
+        if (indefinite)
+        {
+            return cr_fail(r, CBOR_READ_ERR_UNSUPPORTED); // chunked strings, never written here
+        }
+        if (arg > r->len - r->pos)
+        {
+            return cr_fail(r, CBOR_READ_ERR_TRUNCATED);
+        }
+        item->type = major == CBOR_MAJOR_BYTES ? CBOR_ITEM_BYTES : CBOR_ITEM_TEXT;
+        item->data = &r->buf[r->pos];
+        item->len = (uint32_t)arg;
+        r->pos += arg;
+        return true;
+
+    case CBOR_MAJOR_ARRAY:
+    case CBOR_MAJOR_MAP:
+        if (!indefinite && arg >= CBOR_INDEFINITE)
+        {
+            return cr_fail(r, CBOR_READ_ERR_UNSUPPORTED);
+        }
+        item->type = major == CBOR_MAJOR_ARRAY ? CBOR_ITEM_ARRAY : CBOR_ITEM_MAP;
+        item->len = indefinite ? CBOR_INDEFINITE : (uint32_t)arg;
+        return true;
+
+    default: // CBOR_MAJOR_SIMPLE
+        if (indefinite)
+        {
+            item->type = CBOR_ITEM_BREAK;
+            return true;
+        }
+        if (ai == 25)
+        {
+            item->type = CBOR_ITEM_FLOAT;
+            item->f = cr_half((uint16_t)arg);
+        }
+        else if (ai == 26)
+        {
+            uint32_t bits = (uint32_t)arg;
+            float single;
+            memcpy(&single, &bits, sizeof(single));
+            item->type = CBOR_ITEM_FLOAT;
+            item->f = single;
+        }
+        else if (ai == 27)
+        {
+            memcpy(&item->f, &arg, sizeof(item->f));
+            item->type = CBOR_ITEM_FLOAT;
+        }
+        else if (ai == 24 && arg < 32)
+        {
+            return cr_fail(r, CBOR_READ_ERR_MALFORMED); // two-byte form of a one-byte simple value
+        }
+        else
+        {
+            item->value = arg;
+            item->type = arg == 20   ? CBOR_ITEM_FALSE
+                         : arg == 21 ? CBOR_ITEM_TRUE
+                         : arg == 22 ? CBOR_ITEM_NULL
+                                     : CBOR_ITEM_UNDEFINED; // 23 and unassigned simple values
+        }
+        return true;
+    }
+}
+
+const char *cbor_read_status_str(cbor_read_status_t status)
+{
+    switch (status)
+    {
+    case CBOR_READ_OK:
+        return "ok";
+    case CBOR_READ_ERR_TRUNCATED:
+        return "truncated";
+    case CBOR_READ_ERR_MALFORMED:
+        return "malformed";
+    case CBOR_READ_ERR_UNSUPPORTED:
+        return "unsupported";
+    case CBOR_READ_ERR_DEPTH:
+        return "too deep";
+    case CBOR_READ_ERR_TYPE:
+        return "not representable";
+    case CBOR_READ_ERR_OUTPUT:
+        return "output too small";
+    default:
+        return "?";
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "json_reader.h"
+#include "json_writer.h"
+
+#define CBOR_MAX_DEPTH 16 // nested maps / arrays, like JSON_WRITER_MAX_DEPTH
+
+/*
+ * RFC 8949 CBOR, no heap:
+ *   cbor_writer_*  - same calls as json_writer, maps and arrays are written indefinite-length
+ *                    (0xBF / 0x9F ... 0xFF) so nothing has to be counted up front
+ *   cbor_reader_*  - pull parser over (pointer, length), one item header per call
+ *   cbor_from_json / cbor_to_json - transcoders, so JSON stays the internal format and CBOR is
+ *                    only the wire format of the topics that ask for it (with a key dictionary
+ *                    the member names shrink to one byte, which is most of the saving)
+ * Integers use the shortest head, doubles go out as float32 when that is exact.
+ */
+
+typedef struct
+{
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+    uint8_t depth;
+} cbor_writer_t;
+
+typedef enum
+{
+    CBOR_ITEM_UINT = 0,
+    CBOR_ITEM_NEGINT, // value is -1 - uint
+    CBOR_ITEM_BYTES,
+    CBOR_ITEM_TEXT,
+    CBOR_ITEM_ARRAY,
+    CBOR_ITEM_MAP,
+    CBOR_ITEM_TAG,    // the tagged item follows
+    CBOR_ITEM_FALSE,
+    CBOR_ITEM_TRUE,
+    CBOR_ITEM_NULL,
+    CBOR_ITEM_UNDEFINED,
+    CBOR_ITEM_FLOAT,  // half, single or double, in f
+    CBOR_ITEM_BREAK,  // end of an indefinite-length map / array
+} cbor_item_type_t;
+
+#define CBOR_INDEFINITE UINT32_MAX
+
+typedef struct
+{
+    cbor_item_type_t type;
+    uint64_t value;      // UINT / NEGINT / TAG / simple value
+    double f;            // FLOAT
+    const uint8_t *data; // BYTES / TEXT, points into the input
+    uint32_t len;        // BYTES / TEXT bytes, ARRAY / MAP count (pairs for MAP) or CBOR_INDEFINITE
+} cbor_item_t;
+
+typedef enum
+{
+    CBOR_READ_OK = 0,
+    CBOR_READ_ERR_TRUNCATED,   // input ended inside an item
+    CBOR_READ_ERR_MALFORMED,   // reserved additional info, break outside a container, odd map
+    CBOR_READ_ERR_UNSUPPORTED, // indefinite-length strings, 64-bit lengths
+    CBOR_READ_ERR_DEPTH,       // nested deeper than CBOR_MAX_DEPTH
+    CBOR_READ_ERR_TYPE,        // not representable in JSON (byte string, non-text key)
+    CBOR_READ_ERR_OUTPUT,      // output buffer too small
+} cbor_read_status_t;
+
+typedef struct
+{
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+    cbor_read_status_t status;
+} cbor_reader_t;
+
+// ============ WRITER ============
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size);
+
+void cbor_writer_begin_map(cbor_writer_t *w, const char *key);
+void cbor_writer_end_map(cbor_writer_t *w);
+void cbor_writer_begin_array(cbor_writer_t *w, const char *key);
+void cbor_writer_end_array(cbor_writer_t *w);
+
+void cbor_writer_string(cbor_writer_t *w, const char *key, const char *value);
+/**
+ * @brief Text string of len bytes, value does not have to be '\0' terminated
+ */
+void cbor_writer_string_n(cbor_writer_t *w, const char *key, const char *value, size_t len);
+void cbor_writer_int(cbor_writer_t *w, const char *key, int64_t value);
+void cbor_writer_uint(cbor_writer_t *w, const char *key, uint64_t value);
+void cbor_writer_double(cbor_writer_t *w, const char *key, double value);
+void cbor_writer_bool(cbor_writer_t *w, const char *key, bool value);
+void cbor_writer_null(cbor_writer_t *w, const char *key);
+
+/**
+ * @brief Length of the encoding, 0 if the buffer overflowed or a map / array is still open
+ */
+size_t cbor_writer_finish(cbor_writer_t *w);
+
+// ============ READER ============
+void cbor_reader_init(cbor_reader_t *r, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Decode the next item head (string contents are skipped and returned by pointer)
+ * @return false at the end of the input or on error (r->status)
+ */
+bool cbor_reader_next(cbor_reader_t *r, cbor_item_t *item);
+
+// ============ JSON BRIDGE ============
+/*
+ * Optional key dictionary: map keys found in it are sent as their index (one byte below 24)
+ * instead of the text, the peer decodes with the same table. Append only, never reorder.
+ */
+typedef struct
+{
+    const char *const *keys;
+    uint8_t count;
+} cbor_key_dict_t;
+
+/**
+ * @brief Re-encode a JSON document as CBOR
+ * @param toks Token scratch for json_tokenize(), one per JSON value / key
+ * @param dict NULL: keys stay text
+ * @return CBOR length, 0 on error (err->status JSON_READ_ERR_OVERFLOW when w is too small)
+ */
+size_t cbor_from_json(const char *js, size_t len, json_tok_t *toks, uint16_t max_toks, const cbor_key_dict_t *dict,
+                      cbor_writer_t *w, json_read_error_t *err);
+
+/**
+ * @brief Decode one CBOR item (with its children) as JSON
+ * @param dict Table for integer map keys, NULL: only text keys are accepted
+ * @return JSON length, 0 on error (status in *status if given)
+ */
+size_t cbor_to_json(const uint8_t *buf, size_t len, const cbor_key_dict_t *dict, json_writer_t *w,
+                    cbor_read_status_t *status);
+
+const char *cbor_read_status_str(cbor_read_status_t status);
+
+#endif // CBOR_H
@@ -0,0 +1,400 @@
+#include "cbor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define CBOR_JSON_MAX_NUMBER 40 // characters of a JSON number converted
+#define CBOR_JSON_MAX_KEY 48    // map keys decoded to JSON
+
+// ============ JSON -> CBOR ============
+static bool j2c_fail(json_read_error_t *err, json_read_status_t status, uint16_t pos)
+{
+    if (err)
+    {
+        err->status = status;
+        err->pos = pos;
+        err->field = NULL;
+    }
+    return false;
+}
+
+/**
+ * @brief JSON string token as a CBOR text string, unescaped in the free space of the writer
+ */
+static bool j2c_string(const char *js, const json_tok_t *tok, cbor_writer_t *w, json_read_error_t *err)
+{
+    size_t raw = tok->end - tok->start;
+
+    if (memchr(&js[tok->start], '\\', raw) == NULL)
+    {
+        cbor_writer_string_n(w, NULL, &js[tok->start], raw);
+        return true;
+    }
+
+    // Unescaped text is never longer than raw and its head at most 3 bytes (JSON input < 64 KiB)
+    size_t scratch = w->len + 3;
+    if (w->overflow || scratch + raw + 1 > w->size)
+    {
+        return j2c_fail(err, JSON_READ_ERR_OVERFLOW, tok->start);
+    }
+    uint16_t room = (w->size - scratch) > 0xFFFF ? 0xFFFF : (uint16_t)(w->size - scratch);
+    char *text = (char *)&w->buf[scratch];
+    if (!json_tok_copy_string(js, tok, text, room))
+    {
+        return j2c_fail(err, JSON_READ_ERR_SYNTAX, tok->start); // \u0000, not representable in a C string
+    }
+    cbor_writer_string_n(w, NULL, text, strlen(text));
+    return true;
+}
+
+static bool j2c_number(const char *js, const json_tok_t *tok, cbor_writer_t *w, json_read_error_t *err)
+{
+    char num[CBOR_JSON_MAX_NUMBER];
+    size_t n = tok->end - tok->start;
+
+    if (n >= sizeof(num))
+    {
+        return j2c_fail(err, JSON_READ_ERR_OVERFLOW, tok->start);
+    }
+    memcpy(num, &js[tok->start], n);
+    num[n] = '\0';
+
+    // Integers stay integers (CBOR major 0 / 1), anything else or out of 64-bit range is a double
+    if (strpbrk(num, ".eE") == NULL)
+    {
+        errno = 0;
+        if (num[0] == '-')
+        {
+            long long v = strtoll(num, NULL, 10);
+            if (errno == 0)
+            {
+                cbor_writer_int(w, NULL, v);
+                return true;
+            }
+        }
+        else
+        {
+            unsigned long long v = strtoull(num, NULL, 10);
+            if (errno == 0)
+            {
+                cbor_writer_uint(w, NULL, v);
+                return true;
+            }
+        }
+    }
+    cbor_writer_double(w, NULL, strtod(num, NULL));
+    return true;
+}
+
+/**
+ * @brief Member name as its dictionary index, or as text
+ */
+static bool j2c_key(const char *js, const json_tok_t *tok, const cbor_key_dict_t *dict, cbor_writer_t *w,
+                    json_read_error_t *err)
+{
+    size_t len = tok->end - tok->start;
+
+    for (uint8_t i = 0; dict != NULL && i < dict->count; i++)
+    {
+        if (strlen(dict->keys[i]) == len && memcmp(dict->keys[i], &js[tok->start], len) == 0)
+        {
+            cbor_writer_uint(w, NULL, i);
+            return true;
+        }
+    }
+    return j2c_string(js, tok, w, err);
+}
+
+/**
+ * @brief Encode token i and its children
+ * @return index of the next sibling token, -1 on error
+ */
+static int j2c_value(const char *js, const json_tok_t *toks, int i, const cbor_key_dict_t *dict, cbor_writer_t *w,
+                     json_read_error_t *err)
+{
+    const json_tok_t *tok = &toks[i];
+
+    switch (tok->type)
+    {
+    case JSON_TOK_OBJECT:
+    case JSON_TOK_ARRAY:
+    {
+        bool object = tok->type == JSON_TOK_OBJECT;
+        if (object)
+        {
+            cbor_writer_begin_map(w, NULL);
+        }
+        else
+        {
+            cbor_writer_begin_array(w, NULL);
+        }
+        int child = i + 1;
+        for (uint16_t m = 0; m < tok->size && child >= 0; m++)
+        {
+            // Member: key token, then the value
+            if (object)
+            {
+                if (!j2c_key(js, &toks[child], dict, w, err))
+                {
+                    return -1;
+                }
+                child++;
+            }
+            child = j2c_value(js, toks, child, dict, w, err);
+        }
+        if (child < 0)
+        {
+            return -1;
+        }
+        if (object)
+        {
+            cbor_writer_end_map(w);
+        }
+        else
+        {
+            cbor_writer_end_array(w);
+        }
+        return tok->next;
+    }
+
+    case JSON_TOK_STRING:
+        return j2c_string(js, tok, w, err) ? tok->next : -1;
+
+    default: // JSON_TOK_PRIMITIVE
+        switch (js[tok->start])
+        {
+        case 't':
+            cbor_writer_bool(w, NULL, true);
+            break;
+        case 'f':
+            cbor_writer_bool(w, NULL, false);
+            break;
+        case 'n':
+            cbor_writer_null(w, NULL);
+            break;
+        default:
+            if (!j2c_number(js, tok, w, err))
+            {
+                return -1;
+            }
+            break;
+        }
+        return tok->next;
+    }
+}
+
+size_t cbor_from_json(const char *js, size_t len, json_tok_t *toks, uint16_t max_toks, const cbor_key_dict_t *dict,
+                      cbor_writer_t *w, json_read_error_t *err)
+{
+    if (json_tokenize(js, len, toks, max_toks, err) < 0 || j2c_value(js, toks, 0, dict, w, err) < 0)
+    {
+        return 0;
+    }
+
+    size_t out = cbor_writer_finish(w);
+    if (out == 0)
+    {
+        j2c_fail(err, JSON_READ_ERR_OVERFLOW, (uint16_t)len);
+    }
+    return out;
+}
+
+// ============ CBOR -> JSON ============
+static bool c2j_value(cbor_reader_t *r, const cbor_key_dict_t *dict, json_writer_t *w, const char *key, uint8_t depth);
+
+/**
+ * @brief Fail with status, unless the reader already knows a more precise one
+ */
+static bool cr_status(cbor_reader_t *r, cbor_read_status_t status)
+{
+    if (r->status == CBOR_READ_OK)
+    {
+        r->status = status;
+    }
+    return false;
+}
+
+/**
+ * @brief Integer as decimal text, json_writer only has 32-bit integers
+ */
+static void c2j_integer(json_writer_t *w, const char *key, uint64_t magnitude, bool negative)
+{
+    char digits[22];
+    uint8_t n = 0;
+
+    digits[sizeof(digits) - 1] = '\0';
+    do
+    {
+        digits[sizeof(digits) - 2 - n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (negative)
+    {
+        digits[sizeof(digits) - 2 - n++] = '-';
+    }
+    json_writer_raw(w, key, &digits[sizeof(digits) - 1 - n]);
+}
+
+/**
+ * @brief Members / elements of an open map or array, up to its count or break
+ */
+static bool c2j_container(cbor_reader_t *r, const cbor_key_dict_t *dict, json_writer_t *w, const cbor_item_t *head,
+                          uint8_t depth)
+{
+    bool map = head->type == CBOR_ITEM_MAP;
+
+    for (uint32_t i = 0; head->len == CBOR_INDEFINITE || i < head->len; i++)
+    {
+        if (head->len == CBOR_INDEFINITE)
+        {
+            if (r->pos >= r->len)
+            {
+                return cr_status(r, CBOR_READ_ERR_TRUNCATED);
+            }
+            if (r->buf[r->pos] == 0xFF)
+            {
+                r->pos++;
+                return true;
+            }
+        }
+
+        if (!map)
+        {
+            if (!c2j_value(r, dict, w, NULL, depth + 1))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        cbor_item_t key;
+        char name[CBOR_JSON_MAX_KEY];
+        if (!cbor_reader_next(r, &key))
+        {
+            return cr_status(r, CBOR_READ_ERR_TRUNCATED);
+        }
+        const char *member = name;
+        if (key.type == CBOR_ITEM_UINT && dict != NULL && key.value < dict->count)
+        {
+            member = dict->keys[key.value];
+        }
+        else if (key.type == CBOR_ITEM_TEXT && key.len < sizeof(name) && memchr(key.data, '\0', key.len) == NULL)
+        {
+            memcpy(name, key.data, key.len);
+            name[key.len] = '\0';
+        }
+        else
+        {
+            return cr_status(r, CBOR_READ_ERR_TYPE);
+        }
+        if (!c2j_value(r, dict, w, member, depth + 1))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool c2j_value(cbor_reader_t *r, const cbor_key_dict_t *dict, json_writer_t *w, const char *key, uint8_t depth)
+{
+    cbor_item_t item;
+    size_t start = r->pos;
+
+    if (depth >= CBOR_MAX_DEPTH)
+    {
+        return cr_status(r, CBOR_READ_ERR_DEPTH);
+    }
+    if (!cbor_reader_next(r, &item))
+    {
+        return cr_status(r, CBOR_READ_ERR_TRUNCATED);
+    }
+
+    switch (item.type)
+    {
+    case CBOR_ITEM_UINT:
+        c2j_integer(w, key, item.value, false);
+        return true;
+    case CBOR_ITEM_NEGINT:
+        if (item.value == UINT64_MAX)
+        {
+            return cr_status(r, CBOR_READ_ERR_UNSUPPORTED); // -2^64
+        }
+        c2j_integer(w, key, item.value + 1, true);
+        return true;
+    case CBOR_ITEM_TEXT:
+        json_writer_string_n(w, key, (const char *)item.data, item.len);
+        return true;
+    case CBOR_ITEM_ARRAY:
+    case CBOR_ITEM_MAP:
+    {
+        if (item.type == CBOR_ITEM_MAP)
+        {
+            json_writer_begin_object(w, key);
+        }
+        else
+        {
+            json_writer_begin_array(w, key);
+        }
+        if (!c2j_container(r, dict, w, &item, depth))
+        {
+            return false;
+        }
+        if (item.type == CBOR_ITEM_MAP)
+        {
+            json_writer_end_object(w);
+        }
+        else
+        {
+            json_writer_end_array(w);
+        }
+        return true;
+    }
+    case CBOR_ITEM_TAG:
+        // JSON has no tags, the tagged value is kept as is
+        return c2j_value(r, dict, w, key, depth + 1);
+    case CBOR_ITEM_FALSE:
+    case CBOR_ITEM_TRUE:
+        json_writer_bool(w, key, item.type == CBOR_ITEM_TRUE);
+        return true;
+    case CBOR_ITEM_NULL:
+    case CBOR_ITEM_UNDEFINED:
+        json_writer_null(w, key);
+        return true;
+    case CBOR_ITEM_FLOAT:
+    {
+        // Digits of the encoded precision, 21.5 stays 21.5 and not 21.500000000000000
+        uint8_t ai = r->buf[start] & 0x1F;
+        json_writer_double(w, key, item.f, ai == 25 ? 5 : ai == 26 ? 8 : 15);
+        return true;
+    }
+    case CBOR_ITEM_BREAK:
+        return cr_status(r, CBOR_READ_ERR_MALFORMED);
+    default: // CBOR_ITEM_BYTES
+        return cr_status(r, CBOR_READ_ERR_TYPE);
+    }
+}
+
+size_t cbor_to_json(const uint8_t *buf, size_t len, const cbor_key_dict_t *dict, json_writer_t *w,
+                    cbor_read_status_t *status)
+{
+    cbor_reader_t r;
+
+    cbor_reader_init(&r, buf, len);
+    bool ok = c2j_value(&r, dict, w, NULL, 0);
+    if (ok && r.pos != r.len)
+    {
+        ok = cr_status(&r, CBOR_READ_ERR_MALFORMED); // trailing bytes after the root item
+    }
+
+    size_t out = ok ? json_writer_finish(w) : 0;
+    if (ok && out == 0)
+    {
+        r.status = CBOR_READ_ERR_OUTPUT;
+    }
+    if (status)
+    {
+        *status = r.status;
+    }
+    return out;
+}
@@ -1,4 +1,5 @@
 #include "fsm.h"
+#include <string.h>
 
 int16_t length_message = 0;
 uint8_t flag_new_message;
@@ -10,8 +11,30 @@ int32_t timeout_wait;
 fsmListState_e fsm_state;
 uint8_t fsm_message_buffer[FSM_MAX_FRAME_SIZE];
 
+// Running integrity values, updated per byte so no second pass is needed
+static uint16_t running_sum;
+static uint16_t running_crc = CRC16_INIT;
+uint32_t fsm_integrity_error_count = 0;
+uint32_t fsm_frame_count = 0;
+uint32_t fsm_replay_overflow_count = 0;
+
+// COBS stream decoder state (FRAMING_COBS), decodes in place into the frame buffer
+static uint8_t fsm_framing = FRAMING_LENGTH;
+static uint8_t cobs_code;      // code byte of the current block, 0 before the first block
+static uint8_t cobs_remaining; // data bytes left in the current block
+static uint8_t cobs_discard;   // overflow seen, drop everything up to the next delimiter
+
+// Length framing resync: bytes of a rejected frame not replayed yet, fed before any new byte
+static uint8_t replay_buf[FSM_MAX_FRAME_SIZE];
+static uint16_t replay_len;
+
 static void ClearState(void);
 static void Time_Out_Get_Message(void);
+static void fsm_get_message_cobs(uint8_t datain, uint8_t arr_message[]);
+static void fsm_get_message_length(uint8_t datain, uint8_t arr_message[]);
+static uint8_t fsm_step_length(uint8_t datain, uint8_t arr_message[]);
+static void fsm_requeue_rejected(uint8_t arr_message[]);
+static void fsm_replay_hold(uint8_t datain);
 /**
    @brief : Flag of the new message
 
@@ -34,6 +57,36 @@ uint16_t Is_Message(uint16_t *lenght)
   }
 }
 
+/**
+   @brief Let the FSM parse the next frame once the caller has taken the completed one out of its buffer
+*/
+void fsm_release_frame(void)
+{
+  flag_new_message = FALSE;
+  timeout_wait = FALSE;
+}
+
+/**
+   @brief Receive timeout for the task that owns the FSM, called when no byte came for one read timeout
+   @details Drops a partial frame after COUNTER_TIMEOUT idle calls in a row. A completed frame waiting
+            for fsm_release_frame is left alone.
+   @return TRUE while a partial frame is still timing, FALSE when idle
+*/
+uint8_t fsm_poll_timeout(void)
+{
+  if (flag_new_message == TRUE || timeout_wait != TRUE)
+  {
+    return FALSE;
+  }
+  if (++timeout_start >= COUNTER_TIMEOUT)
+  {
+    length_message = 0;
+    ClearState();
+    return FALSE;
+  }
+  return TRUE;
+}
+
 /**
    @brief Get the Message:: Time Out object
    time to receive the new message
@@ -66,20 +119,141 @@ void fsm_get_message(uint8_t datain, uint8_t arr_message[])
   // Keep the current frame intact until the application reads it.
   if (flag_new_message == TRUE)
   {
+    // Length framing: later bytes wait in the replay queue (up to one frame) instead of being lost
+    if (fsm_framing == FRAMING_LENGTH)
+    {
+      fsm_replay_hold(datain);
+    }
     return;
   }
 
+  if (fsm_framing == FRAMING_COBS)
+  {
+    fsm_get_message_cobs(datain, arr_message);
+    return;
+  }
+
+  fsm_get_message_length(datain, arr_message);
+}
+
+/**
+   @brief Length framing: a rejected frame is rescanned from its next START_BYTE
+   so a frame hidden behind a corrupted length or check is not swallowed with it
+*/
+static void fsm_get_message_length(uint8_t datain, uint8_t arr_message[])
+{
+  if (replay_len == 0)
+  {
+    if (fsm_step_length(datain, arr_message) == TRUE)
+    {
+      return;
+    }
+    fsm_requeue_rejected(arr_message);
+  }
+  else
+  {
+    // Leftovers of an earlier resync go first
+    fsm_replay_hold(datain);
+  }
+  fsm_replay(arr_message);
+}
+
+/**
+   @brief Queue one byte behind the held ones, counted in fsm_replay_overflow_count when the queue is full
+*/
+static void fsm_replay_hold(uint8_t datain)
+{
+  if (replay_len < sizeof(replay_buf))
+  {
+    replay_buf[replay_len++] = datain;
+  }
+  else
+  {
+    fsm_replay_overflow_count++;
+  }
+}
+
+/**
+   @brief Put the bytes of the rejected frame after its first one in front of the replay queue
+*/
+static void fsm_requeue_rejected(uint8_t arr_message[])
+{
+  uint16_t count = count_element_arr;
+  ClearState();
+  if (count <= 1)
+  {
+    return;
+  }
+  // Held bytes never exceed one frame: everything queued was in the frame buffer before
+  memmove(&replay_buf[count - 1], replay_buf, replay_len);
+  memcpy(replay_buf, &arr_message[1], count - 1);
+  replay_len += count - 1;
+}
+
+/**
+   @brief Feed the bytes held back by a resync, stops at the next completed frame
+   so the rest waits in the queue until that frame has been released
+*/
+void fsm_replay(uint8_t arr_message[])
+{
+  uint16_t i = 0;
+  while (i < replay_len && flag_new_message == FALSE)
+  {
+    // Nothing started yet: skip to the next START_BYTE
+    if (count_element_arr == 0 && replay_buf[i] != START_BYTE)
+    {
+      i++;
+      continue;
+    }
+    if (fsm_step_length(replay_buf[i++], arr_message) == FALSE)
+    {
+      replay_len -= i;
+      memmove(replay_buf, &replay_buf[i], replay_len);
+      i = 0;
+      fsm_requeue_rejected(arr_message);
+    }
+  }
+  replay_len -= i;
+  memmove(replay_buf, &replay_buf[i], replay_len);
+}
+
+/**
+   @brief Bytes held back by a resync, fsm_replay() turns them into frames
+*/
+uint16_t fsm_replay_pending(void)
+{
+  return replay_len;
+}
+
+/**
+   @brief One byte of the length framing state machine
+   @return FALSE if the frame in the buffer was rejected (buffer left as is for the resync), else TRUE
+*/
+static uint8_t fsm_step_length(uint8_t datain, uint8_t arr_message[])
+{
+  if (flag_new_message == TRUE)
+  {
+    return TRUE;
+  }
+
   timeout_wait = TRUE;
   timeout_start = 0;
 
   if (count_element_arr >= FSM_MAX_FRAME_SIZE)
   {
-    ClearState();
+    return FALSE;
   }
 
   arr_message[count_element_arr] = datain;
   count_element_arr++;
 
+  // Checked bytes are everything except the 2 trailing check bytes
+  if (fsm_state != FSM_STATE_END || count_element_arr <= data_after_length - 2)
+  {
+    running_sum += datain;
+    running_crc = crc16_update(running_crc, datain);
+  }
+
   switch (fsm_state)
   {
   case FSM_STATE_START:
@@ -87,14 +261,14 @@ void fsm_get_message(uint8_t datain, uint8_t arr_message[])
     {
       if (arr_message[0] != START_BYTE)
       {
-        ClearState();
+        return FALSE;
       }
     }
     else if (count_element_arr == FSM_STATE_CHANGE_VALUE_WAIT)
     {
       if (arr_message[1] != START_BYTE_FOLLOW)
       {
-        ClearState();
+        return FALSE;
       }
       else
       {
@@ -110,7 +284,7 @@ void fsm_get_message(uint8_t datain, uint8_t arr_message[])
 
       if (data_after_length < FRAME_MIN_LENGTH || data_after_length > FSM_MAX_FRAME_SIZE)
       {
-        ClearState();
+        return FALSE;
       }
       else
       {
@@ -122,16 +296,25 @@ void fsm_get_message(uint8_t datain, uint8_t arr_message[])
   case FSM_STATE_END:
     if (count_element_arr == data_after_length)
     {
+      uint16_t received = math.convert.bytes_to_uint16(arr_message[count_element_arr - 2], arr_message[count_element_arr - 1]);
+      uint16_t expected = (arr_message[2] & FRAME_FLAG_CRC16) ? running_crc : running_sum;
+      if (received != expected)
+      {
+        fsm_integrity_error_count++;
+        return FALSE;
+      }
       flag_new_message = TRUE;
       length_message = count_element_arr;
+      fsm_frame_count++;
       ClearState();
     }
     else if (count_element_arr > data_after_length)
     {
-      ClearState();
+      return FALSE;
     }
     break;
   }
+  return TRUE;
 }
 
 /**
@@ -145,4 +328,106 @@ void ClearState(void)
   timeout_start = 0;
   timeout_wait = FALSE;
   fsm_state = FSM_STATE_START;
+  running_sum = 0;
+  running_crc = CRC16_INIT;
+  cobs_code = 0;
+  cobs_remaining = 0;
+  cobs_discard = FALSE;
+}
+
+/**
+   @brief Select how incoming bytes are delimited, drops any partial frame
+*/
+void fsm_set_framing(Framing_Mode mode)
+{
+  fsm_framing = mode;
+  replay_len = 0;
+  ClearState();
+}
+
+/**
+   @brief Store one decoded byte, the running check lags 2 bytes so the trailing check is never summed
+*/
+static void fsm_cobs_emit(uint8_t data, uint8_t arr_message[])
+{
+  if (count_element_arr >= FSM_MAX_FRAME_SIZE)
+  {
+    cobs_discard = TRUE;
+    return;
+  }
+
+  arr_message[count_element_arr++] = data;
+  if (count_element_arr > 2)
+  {
+    uint8_t checked = arr_message[count_element_arr - 3];
+    running_sum += checked;
+    running_crc = crc16_update(running_crc, checked);
+  }
+}
+
+/**
+   @brief Delimiter reached: accept the decoded frame if it is complete and its check matches
+*/
+static void fsm_cobs_end(uint8_t arr_message[])
+{
+  uint16_t count = count_element_arr;
+
+  if (!cobs_discard && cobs_remaining == 0 && count >= FRAME_MIN_LENGTH &&
+      arr_message[0] == START_BYTE && arr_message[1] == START_BYTE_FOLLOW &&
+      math.convert.bytes_to_uint16(arr_message[3], arr_message[4]) == count)
+  {
+    uint16_t received = math.convert.bytes_to_uint16(arr_message[count - 2], arr_message[count - 1]);
+    uint16_t expected = (arr_message[2] & FRAME_FLAG_CRC16) ? running_crc : running_sum;
+    if (received == expected)
+    {
+      flag_new_message = TRUE;
+      length_message = count;
+      fsm_frame_count++;
+    }
+    else
+    {
+      fsm_integrity_error_count++;
+    }
+  }
+  else if (count > 0 || cobs_discard)
+  {
+    // Truncated or glitched frame, lost at most up to this delimiter
+    fsm_integrity_error_count++;
+  }
+  ClearState();
+}
+
+/**
+   @brief COBS decoder: a 0x00 byte always ends a frame, so resync never costs more than one frame
+*/
+static void fsm_get_message_cobs(uint8_t datain, uint8_t arr_message[])
+{
+  if (datain == COBS_DELIMITER)
+  {
+    fsm_cobs_end(arr_message);
+    return;
+  }
+
+  timeout_wait = TRUE;
+  timeout_start = 0;
+  if (cobs_discard)
+  {
+    return;
+  }
+
+  if (cobs_remaining == 0)
+  {
+    // New block: the previous one ended with an implicit zero unless it was a full 0xFF block
+    if (cobs_code != 0 && cobs_code != 0xFF)
+    {
+      fsm_cobs_emit(0x00, arr_message);
+    }
+    cobs_code = datain;
+    cobs_remaining = datain - 1;
+  }
+  else
+  {
+    fsm_cobs_emit(datain, arr_message);
+    cobs_remaining--;
+  }
 }
@@ -0,0 +1,765 @@
+#include "json_reader.h"
+#include <string.h>
+#include <limits.h>
+
+typedef struct
+{
+    const char *js;
+    uint16_t len;
+    uint16_t pos;
+    json_tok_t *toks;
+    uint16_t max;
+    uint16_t count;
+    json_read_error_t *err;
+} jr_parser_t;
+
+static bool jr_value(jr_parser_t *p, uint8_t depth);
+
+static bool jr_fail(jr_parser_t *p, json_read_status_t status)
+{
+    if (p->err)
+    {
+        p->err->status = status;
+        p->err->pos = p->pos;
+        p->err->field = NULL;
+    }
+    return false;
+}
+
+static void jr_skip_ws(jr_parser_t *p)
+{
+    while (p->pos < p->len)
+    {
+        char c = p->js[p->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+        {
+            break;
+        }
+        p->pos++;
+    }
+}
+
+static int jr_alloc(jr_parser_t *p, json_tok_type_t type, uint16_t start)
+{
+    if (p->count >= p->max)
+    {
+        jr_fail(p, JSON_READ_ERR_TOKENS);
+        return -1;
+    }
+    json_tok_t *t = &p->toks[p->count];
+    t->type = type;
+    t->start = start;
+    t->end = start;
+    t->size = 0;
+    t->next = p->count + 1;
+    return p->count++;
+}
+
+static bool jr_is_hex(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool jr_is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool jr_string(jr_parser_t *p)
+{
+    // At the opening quote
+    p->pos++;
+    int idx = jr_alloc(p, JSON_TOK_STRING, p->pos);
+    if (idx < 0)
+    {
+        return false;
+    }
+
+    while (p->pos < p->len)
+    {
+        unsigned char c = (unsigned char)p->js[p->pos];
+        if (c == '"')
+        {
+            p->toks[idx].end = p->pos++;
+            return true;
+        }
+        if (c < 0x20)
+        {
+            return jr_fail(p, JSON_READ_ERR_SYNTAX);
+        }
+        if (c == '\\')
+        {
+            if (++p->pos >= p->len)
+            {
+                break;
+            }
+            switch (p->js[p->pos])
+            {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                break;
+            case 'u':
+                for (uint8_t i = 0; i < 4; i++)
+                {
+                    if (++p->pos >= p->len)
+                    {
+                        return jr_fail(p, JSON_READ_ERR_TRUNCATED);
+                    }
+                    if (!jr_is_hex(p->js[p->pos]))
+                    {
+                        return jr_fail(p, JSON_READ_ERR_SYNTAX);
+                    }
+                }
+                break;
+            default:
+                return jr_fail(p, JSON_READ_ERR_SYNTAX);
+            }
+        }
+        p->pos++;
+    }
+    return jr_fail(p, JSON_READ_ERR_TRUNCATED);
+}
+
+static bool jr_literal(jr_parser_t *p, const char *word)
+{
+    size_t n = strlen(word);
+    for (size_t i = 0; i < n; i++, p->pos++)
+    {
+        if (p->pos >= p->len)
+        {
+            return jr_fail(p, JSON_READ_ERR_TRUNCATED);
+        }
+        if (p->js[p->pos] != word[i])
+        {
+            return jr_fail(p, JSON_READ_ERR_SYNTAX);
+        }
+    }
+    return true;
+}
+
+static bool jr_digits(jr_parser_t *p)
+{
+    if (p->pos >= p->len)
+    {
+        return jr_fail(p, JSON_READ_ERR_TRUNCATED);
+    }
+    if (!jr_is_digit(p->js[p->pos]))
+    {
+        return jr_fail(p, JSON_READ_ERR_SYNTAX);
+    }
+    while (p->pos < p->len && jr_is_digit(p->js[p->pos]))
+    {
+        p->pos++;
+    }
+    return true;
+}
+
+static bool jr_primitive(jr_parser_t *p)
+{
+    int idx = jr_alloc(p, JSON_TOK_PRIMITIVE, p->pos);
+    if (idx < 0)
+    {
+        return false;
+    }
+
+    bool ok;
+    char c = p->js[p->pos];
+    if (c == 't')
+    {
+        ok = jr_literal(p, "true");
+    }
+    else if (c == 'f')
+    {
+        ok = jr_literal(p, "false");
+    }
+    else if (c == 'n')
+    {
+        ok = jr_literal(p, "null");
+    }
+    else
+    {
+        // -? (0 | [1-9][0-9]*) (.[0-9]+)? ([eE][+-]?[0-9]+)?
+        if (c == '-')
+        {
+            p->pos++;
+        }
+        if (p->pos < p->len && p->js[p->pos] == '0')
+        {
+            p->pos++;
+            ok = true;
+        }
+        else
+        {
+            ok = jr_digits(p);
+        }
+        if (ok && p->pos < p->len && p->js[p->pos] == '.')
+        {
+            p->pos++;
+            ok = jr_digits(p);
+        }
+        if (ok && p->pos < p->len && (p->js[p->pos] == 'e' || p->js[p->pos] == 'E'))
+        {
+            p->pos++;
+            if (p->pos < p->len && (p->js[p->pos] == '+' || p->js[p->pos] == '-'))
+            {
+                p->pos++;
+            }
+            ok = jr_digits(p);
+        }
+    }
+    p->toks[idx].end = p->pos;
+    return ok;
+}
+
+static bool jr_container(jr_parser_t *p, uint8_t depth, bool object)
+{
+    if (depth >= JSON_READER_MAX_DEPTH)
+    {
+        return jr_fail(p, JSON_READ_ERR_DEPTH);
+    }
+    int idx = jr_alloc(p, object ? JSON_TOK_OBJECT : JSON_TOK_ARRAY, p->pos);
+    if (idx < 0)
+    {
+        return false;
+    }
+
+    char close = object ? '}' : ']';
+    p->pos++;
+    jr_skip_ws(p);
+    if (p->pos < p->len && p->js[p->pos] == close)
+    {
+        p->pos++;
+        p->toks[idx].end = p->pos;
+        p->toks[idx].next = p->count;
+        return true;
+    }
+
+    while (1)
+    {
+        if (object)
+        {
+            jr_skip_ws(p);
+            if (p->pos >= p->len)
+            {
+                return jr_fail(p, JSON_READ_ERR_TRUNCATED);
+            }
+            if (p->js[p->pos] != '"')
+            {
+                return jr_fail(p, JSON_READ_ERR_SYNTAX);
+            }
+            if (!jr_string(p))
+            {
+                return false;
+            }
+            jr_skip_ws(p);
+            if (p->pos >= p->len)
+            {
+                return jr_fail(p, JSON_READ_ERR_TRUNCATED);
+            }
+            if (p->js[p->pos] != ':')
+            {
+                return jr_fail(p, JSON_READ_ERR_SYNTAX);
+            }
+            p->pos++;
+        }
+
+        if (!jr_value(p, depth + 1))
+        {
+            return false;
+        }
+        p->toks[idx].size++;
+
+        jr_skip_ws(p);
+        if (p->pos >= p->len)
+        {
+            return jr_fail(p, JSON_READ_ERR_TRUNCATED);
+        }
+        char c = p->js[p->pos++];
+        if (c == close)
+        {
+            p->toks[idx].end = p->pos;
+            p->toks[idx].next = p->count;
+            return true;
+        }
+        if (c != ',')
+        {
+            p->pos--;
+            return jr_fail(p, JSON_READ_ERR_SYNTAX);
+        }
+    }
+}
+
+static bool jr_value(jr_parser_t *p, uint8_t depth)
+{
+    jr_skip_ws(p);
+    if (p->pos >= p->len)
+    {
+        return jr_fail(p, JSON_READ_ERR_TRUNCATED);
+    }
+
+    char c = p->js[p->pos];
+    if (c == '{' || c == '[')
+    {
+        return jr_container(p, depth, c == '{');
+    }
+    if (c == '"')
+    {
+        return jr_string(p);
+    }
+    if (c == '-' || jr_is_digit(c) || c == 't' || c == 'f' || c == 'n')
+    {
+        return jr_primitive(p);
+    }
+    return jr_fail(p, JSON_READ_ERR_SYNTAX);
+}
+
+int json_tokenize(const char *js, size_t len, json_tok_t *toks, uint16_t max_toks, json_read_error_t *err)
+{
+    jr_parser_t p = {.js = js, .len = (uint16_t)len, .toks = toks, .max = max_toks, .err = err};
+
+    if (err)
+    {
+        err->status = JSON_READ_OK;
+        err->pos = 0;
+        err->field = NULL;
+    }
+    if (len > UINT16_MAX)
+    {
+        jr_fail(&p, JSON_READ_ERR_TOO_LONG);
+        return -1;
+    }
+    if (!jr_value(&p, 0))
+    {
+        return -1;
+    }
+
+    jr_skip_ws(&p);
+    if (p.pos < p.len)
+    {
+        jr_fail(&p, JSON_READ_ERR_SYNTAX);
+        return -1;
+    }
+    return p.count;
+}
+
+static int jr_hex4(const char *s)
+{
+    int v = 0;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        char c = s[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9')
+        {
+            v |= c - '0';
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            v |= c - 'a' + 10;
+        }
+        else
+        {
+            v |= c - 'A' + 10;
+        }
+    }
+    return v;
+}
+
+bool json_tok_copy_string(const char *js, const json_tok_t *tok, char *out, uint16_t out_size)
+{
+    uint16_t n = 0;
+    uint16_t i = tok->start;
+
+    if (out_size == 0)
+    {
+        return false;
+    }
+    while (i < tok->end)
+    {
+        // Plain run up to the next escape in one copy
+        uint16_t run = i;
+        while (run < tok->end && js[run] != '\\')
+        {
+            run++;
+        }
+        if (run > i)
+        {
+            if (n + (run - i) >= out_size)
+            {
+                out[n] = '\0';
+                return false;
+            }
+            memcpy(&out[n], &js[i], run - i);
+            n += run - i;
+            i = run;
+            continue;
+        }
+
+        char c = js[i++];
+        char utf8[4];
+        uint8_t utf8_len = 1;
+
+        utf8[0] = c;
+        if (c == '\\')
+        {
+            // The tokenizer checked the escape, the hex digits are there
+            c = js[i++];
+            switch (c)
+            {
+            case 'b':
+                utf8[0] = '\b';
+                break;
+            case 'f':
+                utf8[0] = '\f';
+                break;
+            case 'n':
+                utf8[0] = '\n';
+                break;
+            case 'r':
+                utf8[0] = '\r';
+                break;
+            case 't':
+                utf8[0] = '\t';
+                break;
+            case 'u':
+            {
+                uint32_t cp = jr_hex4(&js[i]);
+                i += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF)
+                {
+                    // High surrogate, needs the low half
+                    if (i + 6 > tok->end || js[i] != '\\' || js[i + 1] != 'u')
+                    {
+                        return false;
+                    }
+                    uint32_t lo = jr_hex4(&js[i + 2]);
+                    if (lo < 0xDC00 || lo > 0xDFFF)
+                    {
+                        return false;
+                    }
+                    i += 6;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                else if (cp == 0 || (cp >= 0xDC00 && cp <= 0xDFFF))
+                {
+                    return false;
+                }
+
+                if (cp < 0x80)
+                {
+                    utf8[0] = (char)cp;
+                }
+                else if (cp < 0x800)
+                {
+                    utf8[0] = (char)(0xC0 | (cp >> 6));
+                    utf8[1] = (char)(0x80 | (cp & 0x3F));
+                    utf8_len = 2;
+                }
+                else if (cp < 0x10000)
+                {
+                    utf8[0] = (char)(0xE0 | (cp >> 12));
+                    utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    utf8[2] = (char)(0x80 | (cp & 0x3F));
+                    utf8_len = 3;
+                }
+                else
+                {
+                    utf8[0] = (char)(0xF0 | (cp >> 18));
+                    utf8[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+                    utf8[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    utf8[3] = (char)(0x80 | (cp & 0x3F));
+                    utf8_len = 4;
+                }
+                break;
+            }
+            default: // " \ /
+                utf8[0] = c;
+                break;
+            }
+        }
+
+        if (n + utf8_len >= out_size)
+        {
+            out[n] = '\0';
+            return false;
+        }
+        memcpy(&out[n], utf8, utf8_len);
+        n += utf8_len;
+    }
+    out[n] = '\0';
+    return true;
+}
+
+bool json_tok_to_int(const char *js, const json_tok_t *tok, int32_t *out)
+{
+    uint16_t i = tok->start;
+    bool negative = false;
+    int64_t value = 0;
+    const int64_t limit = (int64_t)INT32_MAX + 1;
+
+    if (tok->type != JSON_TOK_PRIMITIVE || i >= tok->end)
+    {
+        return false;
+    }
+    if (js[i] == '-')
+    {
+        negative = true;
+        i++;
+    }
+    if (i >= tok->end || !jr_is_digit(js[i]))
+    {
+        return false; // true / false / null
+    }
+
+    for (; i < tok->end && jr_is_digit(js[i]); i++)
+    {
+        if (value < limit)
+        {
+            value = value * 10 + (js[i] - '0');
+        }
+    }
+
+    // Fraction truncated, the exponent shifts the integer part
+    uint16_t frac = i;
+    uint16_t frac_len = 0;
+    if (i < tok->end && js[i] == '.')
+    {
+        frac = ++i;
+        while (i < tok->end && jr_is_digit(js[i]))
+        {
+            i++;
+        }
+        frac_len = i - frac;
+    }
+    if (i < tok->end && (js[i] == 'e' || js[i] == 'E'))
+    {
+        bool exp_negative = false;
+        int32_t exp = 0;
+        i++;
+        if (js[i] == '+' || js[i] == '-')
+        {
+            exp_negative = js[i++] == '-';
+        }
+        for (; i < tok->end && jr_is_digit(js[i]); i++)
+        {
+            if (exp < 1000)
+            {
+                exp = exp * 10 + (js[i] - '0');
+            }
+        }
+        if (exp_negative)
+        {
+            while (exp-- > 0 && value)
+            {
+                value /= 10;
+            }
+        }
+        else
+        {
+            for (int32_t e = 0; e < exp && value < limit; e++)
+            {
+                value = value * 10 + (e < frac_len ? js[frac + e] - '0' : 0);
+            }
+        }
+    }
+
+    if (value > limit)
+    {
+        value = limit;
+    }
+    value = negative ? -value : value;
+    if (value > INT32_MAX)
+    {
+        value = INT32_MAX;
+    }
+    *out = (int32_t)value;
+    return true;
+}
+
+static bool jr_key_eq(const char *js, const json_tok_t *key, const char *name, size_t name_len)
+{
+    return (size_t)(key->end - key->start) == name_len && memcmp(&js[key->start], name, name_len) == 0;
+}
+
+static bool jr_bind_error(json_read_error_t *err, json_read_status_t status, uint16_t pos, const char *field)
+{
+    if (err)
+    {
+        err->status = status;
+        err->pos = pos;
+        err->field = field;
+    }
+    return false;
+}
+
+/**
+ * @brief Bind the members of one object
+ * @param rest Per field: the part of its path still to match below this object, NULL if it cannot match here
+ */
+static bool jr_bind_object(const char *js, const json_tok_t *toks, uint16_t obj, const json_field_t *fields, uint8_t count,
+                           const char **rest, uint32_t *found, json_read_error_t *err)
+{
+    uint16_t i = obj + 1;
+
+    for (uint16_t m = 0; m < toks[obj].size; m++)
+    {
+        const json_tok_t *key = &toks[i];
+        uint16_t val_idx = i + 1;
+        const json_tok_t *val = &toks[val_idx];
+        const char *child[JSON_READER_MAX_FIELDS];
+        bool descend = false;
+
+        for (uint8_t f = 0; f < count; f++)
+        {
+            child[f] = NULL;
+            if (rest[f] == NULL || (*found & (1u << f)))
+            {
+                continue;
+            }
+
+            // Cheap reject on the first character before measuring the path segment
+            if (key->start == key->end || js[key->start] != rest[f][0])
+            {
+                continue;
+            }
+            const char *dot = strchr(rest[f], '.');
+            size_t seg_len = dot ? (size_t)(dot - rest[f]) : strlen(rest[f]);
+            if (!jr_key_eq(js, key, rest[f], seg_len))
+            {
+                continue;
+            }
+
+            if (dot)
+            {
+                if (val->type == JSON_TOK_OBJECT)
+                {
+                    child[f] = dot + 1;
+                    descend = true;
+                }
+                continue;
+            }
+
+            // Leaf: first occurrence wins, like cJSON_GetObjectItem
+            const json_field_t *fd = &fields[f];
+            bool ok = false;
+            switch (fd->type)
+            {
+            case JSON_FIELD_STRING:
+                if (val->type == JSON_TOK_STRING)
+                {
+                    if (!json_tok_copy_string(js, val, (char *)fd->out, fd->out_size))
+                    {
+                        return jr_bind_error(err, JSON_READ_ERR_OVERFLOW, val->start, fd->path);
+                    }
+                    ok = true;
+                }
+                break;
+            case JSON_FIELD_INT:
+                ok = json_tok_to_int(js, val, (int32_t *)fd->out);
+                break;
+            case JSON_FIELD_BOOL:
+                if (val->type == JSON_TOK_PRIMITIVE && (js[val->start] == 't' || js[val->start] == 'f'))
+                {
+                    *(bool *)fd->out = js[val->start] == 't';
+                    ok = true;
+                }
+                break;
+            }
+
+            if (ok)
+            {
+                *found |= 1u << f;
+            }
+            else if (fd->required)
+            {
+                return jr_bind_error(err, JSON_READ_ERR_TYPE, val->start, fd->path);
+            }
+        }
+
+        if (descend && !jr_bind_object(js, toks, val_idx, fields, count, child, found, err))
+        {
+            return false;
+        }
+        i = val->next;
+    }
+    return true;
+}
+
+bool json_bind(const char *js, size_t len, const json_field_t *fields, uint8_t count, uint32_t *found, json_read_error_t *err)
+{
+    json_tok_t toks[JSON_READER_MAX_TOKENS];
+    const char *rest[JSON_READER_MAX_FIELDS];
+    uint32_t mask = 0;
+
+    if (found)
+    {
+        *found = 0;
+    }
+    if (js == NULL || count > JSON_READER_MAX_FIELDS)
+    {
+        return jr_bind_error(err, JSON_READ_ERR_SYNTAX, 0, NULL);
+    }
+    if (json_tokenize(js, len, toks, JSON_READER_MAX_TOKENS, err) < 0)
+    {
+        return false;
+    }
+    if (toks[0].type != JSON_TOK_OBJECT)
+    {
+        return jr_bind_error(err, JSON_READ_ERR_TYPE, toks[0].start, NULL);
+    }
+
+    for (uint8_t f = 0; f < count; f++)
+    {
+        rest[f] = fields[f].path;
+    }
+    if (!jr_bind_object(js, toks, 0, fields, count, rest, &mask, err))
+    {
+        return false;
+    }
+    if (found)
+    {
+        *found = mask;
+    }
+
+    for (uint8_t f = 0; f < count; f++)
+    {
+        if (fields[f].required && !(mask & (1u << f)))
+        {
+            return jr_bind_error(err, JSON_READ_ERR_MISSING, toks[0].start, fields[f].path);
+        }
+    }
+    return true;
+}
+
+const char *json_read_status_str(json_read_status_t status)
+{
+    switch (status)
+    {
+    case JSON_READ_OK:
+        return "ok";
+    case JSON_READ_ERR_SYNTAX:
+        return "syntax error";
+    case JSON_READ_ERR_TRUNCATED:
+        return "truncated";
+    case JSON_READ_ERR_TOKENS:
+        return "too many tokens";
+    case JSON_READ_ERR_DEPTH:
+        return "nested too deep";
+    case JSON_READ_ERR_TOO_LONG:
+        return "input too long";
+    case JSON_READ_ERR_MISSING:
+        return "missing field";
+    case JSON_READ_ERR_TYPE:
+        return "wrong type";
+    case JSON_READ_ERR_OVERFLOW:
+        return "string too long";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,270 @@
+#include "json_writer.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+static void jw_put(json_writer_t *w, const char *s, size_t n)
+{
+    if (w->overflow)
+    {
+        return;
+    }
+    // Keep one byte for the terminator
+    if (w->len + n >= w->size)
+    {
+        w->overflow = true;
+        return;
+    }
+    memcpy(&w->buf[w->len], s, n);
+    w->len += n;
+    w->buf[w->len] = '\0';
+}
+
+static void jw_putc(json_writer_t *w, char c)
+{
+    jw_put(w, &c, 1);
+}
+
+static void jw_put_escaped_n(json_writer_t *w, const char *s, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *run = s;
+    const char *end = s + len;
+
+    for (; s < end; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\')
+        {
+            continue;
+        }
+
+        // Copy the plain run in one go, then the escape
+        jw_put(w, run, s - run);
+        run = s + 1;
+        switch (c)
+        {
+        case '"':
+            jw_put(w, "\\\"", 2);
+            break;
+        case '\\':
+            jw_put(w, "\\\\", 2);
+            break;
+        case '\b':
+            jw_put(w, "\\b", 2);
+            break;
+        case '\f':
+            jw_put(w, "\\f", 2);
+            break;
+        case '\n':
+            jw_put(w, "\\n", 2);
+            break;
+        case '\r':
+            jw_put(w, "\\r", 2);
+            break;
+        case '\t':
+            jw_put(w, "\\t", 2);
+            break;
+        default:
+        {
+            char u[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F]};
+            jw_put(w, u, sizeof(u));
+            break;
+        }
+        }
+    }
+    jw_put(w, run, s - run);
+}
+
+static void jw_put_escaped(json_writer_t *w, const char *s)
+{
+    jw_put_escaped_n(w, s, strlen(s));
+}
+
+/**
+ * @brief Comma and "key": in front of a value
+ */
+static void jw_prefix(json_writer_t *w, const char *key)
+{
+    uint32_t bit = 1u << w->depth;
+    if (w->has_items & bit)
+    {
+        jw_putc(w, ',');
+    }
+    w->has_items |= bit;
+
+    if (key)
+    {
+        jw_putc(w, '"');
+        jw_put_escaped(w, key);
+        jw_put(w, "\":", 2);
+    }
+}
+
+static void jw_open(json_writer_t *w, const char *key, char c)
+{
+    jw_prefix(w, key);
+    jw_putc(w, c);
+    if (w->depth + 1 >= JSON_WRITER_MAX_DEPTH)
+    {
+        w->overflow = true;
+        return;
+    }
+    w->depth++;
+    w->has_items &= ~(1u << w->depth);
+}
+
+static void jw_close(json_writer_t *w, char c)
+{
+    if (w->depth == 0)
+    {
+        w->overflow = true;
+        return;
+    }
+    w->depth--;
+    jw_putc(w, c);
+}
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size)
+{
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->overflow = (buf == NULL || size == 0);
+    w->depth = 0;
+    w->has_items = 0;
+    if (!w->overflow)
+    {
+        buf[0] = '\0';
+    }
+}
+
+void json_writer_begin_object(json_writer_t *w, const char *key)
+{
+    jw_open(w, key, '{');
+}
+
+void json_writer_end_object(json_writer_t *w)
+{
+    jw_close(w, '}');
+}
+
+void json_writer_begin_array(json_writer_t *w, const char *key)
+{
+    jw_open(w, key, '[');
+}
+
+void json_writer_end_array(json_writer_t *w)
+{
+    jw_close(w, ']');
+}
+
+void json_writer_string(json_writer_t *w, const char *key, const char *value)
+{
+    if (value == NULL)
+    {
+        json_writer_null(w, key);
+        return;
+    }
+    jw_prefix(w, key);
+    jw_putc(w, '"');
+    jw_put_escaped(w, value);
+    jw_putc(w, '"');
+}
+
+void json_writer_string_n(json_writer_t *w, const char *key, const char *value, size_t len)
+{
+    jw_prefix(w, key);
+    jw_putc(w, '"');
+    jw_put_escaped_n(w, value, len);
+    jw_putc(w, '"');
+}
+
+void json_writer_uint(json_writer_t *w, const char *key, uint32_t value)
+{
+    char digits[10];
+    uint8_t n = 0;
+
+    jw_prefix(w, key);
+    do
+    {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    jw_put(w, &digits[sizeof(digits) - n], n);
+}
+
+void json_writer_int(json_writer_t *w, const char *key, int32_t value)
+{
+    if (value >= 0)
+    {
+        json_writer_uint(w, key, (uint32_t)value);
+        return;
+    }
+
+    char digits[11];
+    uint8_t n = 0;
+    uint32_t magnitude = 0u - (uint32_t)value;
+
+    jw_prefix(w, key);
+    do
+    {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    digits[sizeof(digits) - 1 - n++] = '-';
+    jw_put(w, &digits[sizeof(digits) - n], n);
+}
+
+void json_writer_double(json_writer_t *w, const char *key, double value, uint8_t digits)
+{
+    if (isnan(value) || isinf(value))
+    {
+        json_writer_null(w, key);
+        return;
+    }
+
+    char num[32];
+    int n = snprintf(num, sizeof(num), "%.*g", digits ? digits : 1, value);
+    jw_prefix(w, key);
+    if (n < 0 || (size_t)n >= sizeof(num))
+    {
+        w->overflow = true;
+        return;
+    }
+    jw_put(w, num, (size_t)n);
+}
+
+void json_writer_bool(json_writer_t *w, const char *key, bool value)
+{
+    jw_prefix(w, key);
+    if (value)
+    {
+        jw_put(w, "true", 4);
+    }
+    else
+    {
+        jw_put(w, "false", 5);
+    }
+}
+
+void json_writer_null(json_writer_t *w, const char *key)
+{
+    jw_prefix(w, key);
+    jw_put(w, "null", 4);
+}
+
+void json_writer_raw(json_writer_t *w, const char *key, const char *json)
+{
+    jw_prefix(w, key);
+    jw_put(w, json, strlen(json));
+}
+
+size_t json_writer_finish(json_writer_t *w)
+{
+    if (w->overflow || w->depth != 0)
+    {
+        return 0;
+    }
+    return w->len;
+}
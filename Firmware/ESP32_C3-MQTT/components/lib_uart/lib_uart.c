@@ -9,25 +9,82 @@ static const char *TAG = "UART_LIB";
 static QueueHandle_t uart_queue = NULL;
 static TaskHandle_t uart_rx_task_handle = NULL;
 static void (*uart_rx_callback)(uint8_t data) = NULL; // callback giống ngắt UART
+static uint32_t uart_current_baud = 0;
+static TaskHandle_t uart_frame_notify_task = NULL;
+static Framing_Mode uart_framing = FRAMING_LENGTH;             // TX side, used by uart_send_frame
+static volatile Framing_Mode uart_rx_framing = FRAMING_LENGTH; // Requested for RX, applied by the RX task
+static Framing_Mode uart_rx_framing_applied = FRAMING_LENGTH;  // What the FSM runs, RX task only
+
+#define UART_SLOT_NONE 0xFF
+
+typedef struct
+{
+    uint8_t slot;
+    uint16_t length;
+} uart_ready_frame_t;
+
+// The FSM parses straight into these, frames are lent to the application without copying
+static uint8_t uart_frame_slots[UART_FRAME_SLOTS][FSM_MAX_FRAME_SIZE];
+static QueueHandle_t uart_free_slots = NULL;   // slot indices the FSM may fill
+static QueueHandle_t uart_ready_frames = NULL; // uart_ready_frame_t, arrival order
+static uint8_t uart_fill_slot = UART_SLOT_NONE;
 
 // ======================= Internal Task =======================
+/**
+ * @brief Queue the frame the FSM just completed and pick the slot for the next one
+ * @details Waits up to UART_FRAME_HOLD_MS when the application holds every slot, bytes meanwhile stay
+ *          in the driver buffer.
+ */
+static void uart_frame_publish(void)
+{
+    const uint8_t *frame = uart_frame_slots[uart_fill_slot];
+    uart_ready_frame_t ready = {
+        .slot = uart_fill_slot,
+        .length = math.convert.bytes_to_uint16(frame[3], frame[4]),
+    };
+
+    xQueueSend(uart_ready_frames, &ready, 0); // holds UART_FRAME_SLOTS entries, never full
+    fsm_release_frame();
+    uart_fill_slot = UART_SLOT_NONE;
+
+    if (uart_frame_notify_task)
+    {
+        xTaskNotifyGive(uart_frame_notify_task);
+    }
+
+    if (xQueueReceive(uart_free_slots, &uart_fill_slot, pdMS_TO_TICKS(UART_FRAME_HOLD_MS)) != pdTRUE)
+    {
+        uart_fill_slot = UART_SLOT_NONE;
+    }
+}
+
 static void uart_rx_task(void *pvParameters)
 {
     uart_event_t event;
     uint8_t data;
+    TickType_t event_wait = portMAX_DELAY;
 
     while (1)
     {
-        if (xQueueReceive(uart_queue, &event, portMAX_DELAY))
+        // While a partial frame is timing the read below is the wait, else sleep until the driver has data
+        if (xQueueReceive(uart_queue, &event, event_wait) != pdTRUE || event.type == UART_DATA)
         {
-            if (event.type == UART_DATA)
+            while (uart_read_bytes(UART_PORT_NUM, &data, 1, pdMS_TO_TICKS(UART_RX_IDLE_MS)))
             {
-                while (uart_read_bytes(UART_PORT_NUM, &data, 1, 10 / portTICK_PERIOD_MS))
+                uint32_t frames_before = fsm_frame_count;
+                if (uart_rx_callback)
+                    uart_rx_callback(data);
+                while (fsm_frame_count != frames_before)
                 {
-                    if (uart_rx_callback)
-                        uart_rx_callback(data);
+                    frames_before = fsm_frame_count;
+                    uart_frame_publish();
+                    // A resync can hold back more frames, hand them out now instead of on the next byte
+                    if (uart_fill_slot != UART_SLOT_NONE && fsm_replay_pending())
+                        fsm_replay(uart_frame_slots[uart_fill_slot]);
                 }
             }
+            // The line was idle for UART_RX_IDLE_MS: the FSM receive timeout runs here, in the task that owns it
+            event_wait = fsm_poll_timeout() ? 0 : portMAX_DELAY;
         }
     }
 }
@@ -47,6 +104,8 @@ void uart_basic_init(uint32_t baud_rate, gpio_num_t tx_pin, gpio_num_t rx_pin)
     uart_set_pin(UART_PORT_NUM, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
     uart_driver_install(UART_PORT_NUM, BUFFER_SIZE * 2, BUFFER_SIZE * 2, 10, &uart_queue, 0);
 
+    uart_current_baud = baud_rate;
+
     xTaskCreate(uart_rx_task, "uart_rx_task", 2048, NULL, 12, &uart_rx_task_handle);
     ESP_LOGI(TAG, "UART initialized (TX=%d, RX=%d, baud=%lu)", tx_pin, rx_pin, baud_rate);
 }
@@ -67,6 +126,25 @@ void uart_basic_flush(void)
     uart_flush(UART_PORT_NUM);
 }
 
+/**
+ * @brief Change baud rate on the fly
+ * @details Drains pending TX at the old rate first, then drops RX bytes that may have been
+ *          sampled across the switch.
+ */
+void uart_basic_set_baud(uint32_t baud_rate)
+{
+    uart_wait_tx_done(UART_PORT_NUM, pdMS_TO_TICKS(100));
+    uart_set_baudrate(UART_PORT_NUM, baud_rate);
+    uart_flush_input(UART_PORT_NUM);
+    uart_current_baud = baud_rate;
+    ESP_LOGI(TAG, "UART baud changed to %lu", baud_rate);
+}
+
+uint32_t uart_basic_get_baud(void)
+{
+    return uart_current_baud;
+}
+
 // ======================= Send operations =======================
 void uart_send_byte(uint8_t data)
 {
@@ -78,6 +156,59 @@ void uart_send_bytes(const uint8_t *data, size_t length)
     uart_write_bytes(UART_PORT_NUM, (const char *)data, length);
 }
 
+/**
+ * @brief Send a built frame with the current framing
+ * @details COBS blocks are written straight from the frame to the driver, no encode buffer is needed.
+ */
+void uart_send_frame(const uint8_t *frame, size_t length)
+{
+    if (uart_framing != FRAMING_COBS)
+    {
+        uart_write_bytes(UART_PORT_NUM, (const char *)frame, length);
+        return;
+    }
+
+    size_t start = 0;
+    while (1)
+    {
+        size_t end = start;
+        while (end < length && frame[end] != COBS_DELIMITER && end - start < 254)
+        {
+            end++;
+        }
+
+        uint8_t code = (uint8_t)(end - start + 1);
+        uart_write_bytes(UART_PORT_NUM, (const char *)&code, 1);
+        uart_write_bytes(UART_PORT_NUM, (const char *)&frame[start], end - start);
+
+        if (end >= length)
+        {
+            break;
+        }
+        // A zero is carried by the code byte, a full 0xFF block is not followed by one
+        start = (code == 0xFF) ? end : end + 1;
+    }
+
+    uint8_t delimiter = COBS_DELIMITER;
+    uart_write_bytes(UART_PORT_NUM, (const char *)&delimiter, 1);
+}
+
+/**
+ * @brief Switch the framing of both directions
+ * @details TX changes at once. The FSM belongs to the RX task, which switches it before the next byte it parses.
+ */
+void uart_set_framing(Framing_Mode mode)
+{
+    uart_framing = mode;
+    uart_rx_framing = mode;
+    ESP_LOGI(TAG, "UART framing: %s", mode == FRAMING_COBS ? "COBS" : "length");
+}
+
+Framing_Mode uart_get_framing(void)
+{
+    return uart_framing;
+}
+
 // ======================= Receive operations =======================
 int uart_receive_available(void)
 {
@@ -107,13 +238,42 @@ void uart_set_rx_callback(void (*callback)(uint8_t data))
 // ======================= FSM integration =======================
 static void uart_fsm_callback(uint8_t data)
 {
+    if (uart_rx_framing_applied != uart_rx_framing)
+    {
+        uart_rx_framing_applied = uart_rx_framing;
+        fsm_set_framing(uart_rx_framing_applied);
+    }
+
     // Debug: In ra mỗi byte nhận được
     // ESP_LOGI(TAG, "RX Byte: 0x%02X (%c)", data, (data >= 32 && data <= 126) ? data : '.');
-    fsm_get_message(data, fsm_message_buffer);
+    if (uart_fill_slot == UART_SLOT_NONE && xQueueReceive(uart_free_slots, &uart_fill_slot, 0) != pdTRUE)
+    {
+        // Every slot is still held by the application, the byte is lost and the FSM resyncs
+        uart_fill_slot = UART_SLOT_NONE;
+        return;
+    }
+    fsm_get_message(data, uart_frame_slots[uart_fill_slot]);
+}
+
+void uart_set_frame_notify(TaskHandle_t task)
+{
+    uart_frame_notify_task = task;
 }
 
 void uart_init_with_fsm(uint32_t baud_rate, gpio_num_t tx_pin, gpio_num_t rx_pin)
 {
+    uart_free_slots = xQueueCreate(UART_FRAME_SLOTS, sizeof(uint8_t));
+    uart_ready_frames = xQueueCreate(UART_FRAME_SLOTS, sizeof(uart_ready_frame_t));
+    if (!uart_free_slots || !uart_ready_frames)
+    {
+        ESP_LOGE(TAG, "Failed to create frame slot queues");
+        return;
+    }
+    for (uint8_t i = 0; i < UART_FRAME_SLOTS; i++)
+    {
+        xQueueSend(uart_free_slots, &i, 0);
+    }
+
     uart_basic_init(baud_rate, tx_pin, rx_pin);
     uart_set_rx_callback(uart_fsm_callback);
     ESP_LOGI(TAG, "UART + FSM initialized");
@@ -122,36 +282,63 @@ void uart_init_with_fsm(uint32_t baud_rate, gpio_num_t tx_pin, gpio_num_t rx_pin
 // ======================= Check message =======================
 uint8_t is_message(void)
 {
-    uint16_t dummy_length = 0;
-    uint8_t result = (uint8_t)Is_Message(&dummy_length);
-    if (result)
+    // Read only: the RX task owns the FSM and queues every completed frame
+    return (uart_ready_frames && uxQueueMessagesWaiting(uart_ready_frames) > 0) ? 1 : 0;
+}
+
+// ======================= Frame view =======================
+bool uart_frame_acquire(Frame_View *view)
+{
+    uart_ready_frame_t ready;
+
+    if (!view || !uart_ready_frames || xQueueReceive(uart_ready_frames, &ready, 0) != pdTRUE)
     {
-        ESP_LOGI(TAG, "FSM: Frame complete! Length=%d", dummy_length);
+        return false;
     }
-    return result;
+
+    const uint8_t *frame = uart_frame_slots[ready.slot];
+    view->type = frame[2] & FRAME_TYPE_MASK;
+    view->length = ready.length;
+    view->payload = &frame[FRAME_HEADER_SIZE];
+    view->payload_len = ready.length - FRAME_HEADER_SIZE - 2;
+    view->slot = ready.slot;
+    return true;
 }
 
-// ======================= Decode message =======================
-void decode_message(Frame_Message *message)
+void uart_frame_release(Frame_View *view)
 {
-    // Decode start_message (0xAA55) từ byte 0-1
-    message->start_message = math.convert.bytes_to_uint16(fsm_message_buffer[0], fsm_message_buffer[1]);
+    if (!view || !view->payload)
+    {
+        return;
+    }
 
-    // Decode type_message từ byte 2
-    message->type_message = (Type_Message)fsm_message_buffer[2];
+    // Wakes the RX task if it is waiting for a slot
+    xQueueSend(uart_free_slots, &view->slot, 0);
+    view->payload = NULL;
+    view->payload_len = 0;
+}
 
-    // Decode length_message từ byte 3-4
-    message->length_message = math.convert.bytes_to_uint16(fsm_message_buffer[3], fsm_message_buffer[4]);
+// ======================= Decode message =======================
+void decode_message(Frame_Message *message)
+{
+    Frame_View view;
 
-    // Copy data payload (bắt đầu từ byte 5)
-    for (uint8_t i = 0; i < message->length_message - FRAME_HEADER_SIZE; i++)
+    if (!uart_frame_acquire(&view))
     {
-        message->data[i] = fsm_message_buffer[i + FRAME_HEADER_SIZE];
+        message->length_message = 0;
+        return;
     }
 
-    // Decode checksum (2 byte cuối cùng)
-    uint16_t checksum_index = FRAME_HEADER_SIZE + (message->length_message - FRAME_HEADER_SIZE);
-    message->check_sum = math.convert.bytes_to_uint16(fsm_message_buffer[checksum_index], fsm_message_buffer[checksum_index + 1]);
+    message->start_message = math.convert.bytes_to_uint16(START_BYTE, START_BYTE_FOLLOW);
+    message->type_message = view.type;
+    message->length_message = view.length;
+
+    // data[] is smaller than the largest FSM frame
+    uint16_t copy_len = (view.payload_len < sizeof(message->data)) ? view.payload_len : sizeof(message->data);
+    memcpy(message->data, view.payload, copy_len);
+    message->check_sum = math.convert.bytes_to_uint16(view.payload[view.payload_len], view.payload[view.payload_len + 1]);
+
+    uart_frame_release(&view);
 }
 
 // ======================= Library interface table =======================
@@ -160,10 +347,13 @@ const uart_lib_t uart = {
         .init = uart_basic_init,
         .deinit = uart_basic_deinit,
         .flush = uart_basic_flush,
+        .set_baud = uart_basic_set_baud,
+        .get_baud = uart_basic_get_baud,
     },
     .send = {
         .byte = uart_send_byte,
         .bytes = uart_send_bytes,
+        .frame = uart_send_frame,
     },
     .receive = {
         .available = uart_receive_available,
@@ -172,4 +362,8 @@ const uart_lib_t uart = {
     },
     .check = {
         .is_message = is_message,
+    },
+    .frame = {
+        .acquire = uart_frame_acquire,
+        .release = uart_frame_release,
     }};
@@ -0,0 +1,106 @@
+#ifndef __UART_PORT_LINUX__
+#define __UART_PORT_LINUX__
+
+/*
+ * Host backend for IDF_TARGET=linux: the subset of driver/uart.h and driver/gpio.h used by lib_uart,
+ * carried over a pseudo-terminal (or any tty path) instead of the UART peripheral.
+ * Two processes (master2 and the C3 gateway) talk through the two ends of one pty.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+// ================= Configuration (environment, read in uart_driver_install) =================
+#define UART_HOST_ENV_DEVICE "UART_HOST_DEVICE"       // tty to open, unset -> create a pty and log its slave path
+#define UART_HOST_ENV_BYTE_RATE "UART_HOST_BYTE_RATE" // wire bytes/s, unset or 0 -> baud / 10 (8N1)
+#define UART_HOST_ENV_BER "UART_HOST_BER"             // bit error rate applied to received bytes, e.g. 1e-5
+#define UART_HOST_ENV_SEED "UART_HOST_SEED"           // error injection seed, fixed for reproducible runs
+#define UART_HOST_RX_CHUNK 256
+#define UART_HOST_TX_CHUNK 256
+
+// ================= driver/gpio.h, driver/uart.h subset =================
+typedef int gpio_num_t;
+typedef int uart_port_t;
+
+#define UART_NUM_0 0
+#define UART_NUM_1 1
+#define UART_PIN_NO_CHANGE (-1)
+
+typedef enum
+{
+    UART_DATA_8_BITS = 3
+} uart_word_length_t;
+
+typedef enum
+{
+    UART_PARITY_DISABLE = 0
+} uart_parity_t;
+
+typedef enum
+{
+    UART_STOP_BITS_1 = 1
+} uart_stop_bits_t;
+
+typedef enum
+{
+    UART_HW_FLOWCTRL_DISABLE = 0
+} uart_hw_flowcontrol_t;
+
+typedef enum
+{
+    UART_SCLK_DEFAULT = 0
+} uart_sclk_t;
+
+typedef struct
+{
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+    uart_sclk_t source_clk;
+} uart_config_t;
+
+typedef enum
+{
+    UART_DATA,
+    UART_BUFFER_FULL,
+} uart_event_type_t;
+
+typedef struct
+{
+    uart_event_type_t type;
+    size_t size;
+    bool timeout_flag;
+} uart_event_t;
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config);
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags);
+esp_err_t uart_driver_delete(uart_port_t uart_num);
+esp_err_t uart_set_baudrate(uart_port_t uart_num, uint32_t baudrate);
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait);
+esp_err_t uart_flush(uart_port_t uart_num);
+esp_err_t uart_flush_input(uart_port_t uart_num);
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size);
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size);
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait);
+
+// ================= Host only =================
+typedef struct
+{
+    uint64_t tx_bytes;
+    uint64_t rx_bytes;
+    uint64_t rx_dropped; // RX ring full, bytes lost like a hardware FIFO overflow
+    uint64_t bit_errors; // Bits flipped by UART_HOST_BER
+} uart_host_stats_t;
+
+void uart_host_get_stats(uart_host_stats_t *out);
+
+#endif // __UART_PORT_LINUX__
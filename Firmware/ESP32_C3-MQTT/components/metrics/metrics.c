@@ -0,0 +1,136 @@
+#include "metrics.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+static const metric_desc_t *metrics_table = NULL;
+static size_t metrics_count = 0;
+
+static const char *const type_names[] = {
+    [METRIC_COUNTER] = "counter",
+    [METRIC_GAUGE] = "gauge",
+    [METRIC_HISTOGRAM] = "histogram",
+};
+
+void metrics_init(const metric_desc_t *table, size_t count)
+{
+    metrics_table = table;
+    metrics_count = count;
+}
+
+typedef struct
+{
+    metrics_write_fn_t write;
+    void *ctx;
+    bool failed;
+} render_state_t;
+
+static void render_line(render_state_t *st, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void render_line(render_state_t *st, const char *fmt, ...)
+{
+    char line[METRICS_LINE_LEN];
+    va_list args;
+
+    if (st->failed)
+    {
+        return;
+    }
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len < 0)
+    {
+        return;
+    }
+    if ((size_t)len >= sizeof(line))
+    {
+        len = sizeof(line) - 1; // names and labels are static, a cut line is a table bug
+        line[len - 1] = '\n';
+    }
+    if (st->write(st->ctx, line, (size_t)len) == 0)
+    {
+        st->failed = true;
+    }
+}
+
+/**
+ * @brief _bucket (cumulative), _sum and _count series of one histogram
+ */
+static void render_histogram(render_state_t *st, const metric_desc_t *m)
+{
+    const metric_histogram_t *h = m->histogram;
+    uint32_t counts[METRICS_MAX_BUCKETS + 1];
+    uint8_t n = h->n_bounds > METRICS_MAX_BUCKETS ? METRICS_MAX_BUCKETS : h->n_bounds;
+    const char *labels = m->labels ? m->labels : "";
+    const char *sep = m->labels ? "," : "";
+
+    // Snapshot first, _count is the sum of the buckets read so the series stay consistent
+    for (uint8_t i = 0; i <= n; i++)
+    {
+        counts[i] = __atomic_load_n(&h->counts[i], __ATOMIC_RELAXED);
+    }
+    uint32_t sum = __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        cumulative += counts[i];
+        render_line(st, "%s_bucket{%s%sle=\"%lu\"} %lu\n", m->name, labels, sep, (unsigned long)h->bounds[i],
+                    (unsigned long)cumulative);
+    }
+    cumulative += counts[n];
+    render_line(st, "%s_bucket{%s%sle=\"+Inf\"} %lu\n", m->name, labels, sep, (unsigned long)cumulative);
+    const char *open = m->labels ? "{" : "";
+    const char *close = m->labels ? "}" : "";
+    render_line(st, "%s_sum%s%s%s %lu\n", m->name, open, labels, close, (unsigned long)sum);
+    render_line(st, "%s_count%s%s%s %lu\n", m->name, open, labels, close, (unsigned long)cumulative);
+}
+
+bool metrics_render(metrics_write_fn_t write, void *ctx)
+{
+    render_state_t st = {.write = write, .ctx = ctx};
+    const char *family = NULL;
+
+    for (size_t i = 0; i < metrics_count && !st.failed; i++)
+    {
+        const metric_desc_t *m = &metrics_table[i];
+
+        if (family == NULL || strcmp(family, m->name) != 0)
+        {
+            family = m->name;
+            render_line(&st, "# HELP %s %s\n", m->name, m->help ? m->help : "");
+            render_line(&st, "# TYPE %s %s\n", m->name, type_names[m->type]);
+        }
+
+        if (m->type == METRIC_HISTOGRAM)
+        {
+            if (m->histogram)
+            {
+                render_histogram(&st, m);
+            }
+            continue;
+        }
+
+        char value[12];
+        if (m->i32)
+        {
+            snprintf(value, sizeof(value), "%ld", (long)*m->i32);
+        }
+        else
+        {
+            uint32_t v = m->u32 ? *m->u32 : (m->sample ? m->sample() : 0);
+            snprintf(value, sizeof(value), "%lu", (unsigned long)v);
+        }
+        if (m->labels)
+        {
+            render_line(&st, "%s{%s} %s\n", m->name, m->labels, value);
+        }
+        else
+        {
+            render_line(&st, "%s %s\n", m->name, value);
+        }
+    }
+    return !st.failed;
+}
@@ -0,0 +1,98 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Metrics registry, Prometheus text exposition (version 0.0.4).
+ * The application describes its metrics in one static const table (metrics_init), the values
+ * live in its own globals: hot paths update them with the inline helpers below (one relaxed
+ * atomic add, no lock, no lookup), existing counters are referenced by pointer and values that
+ * cost something to compute (queue depth, free heap) are sampled only when scraped.
+ * Pure C, the HTTP side is metrics_http.c.
+ */
+
+// ============ CONFIG ============
+#define METRICS_MAX_BUCKETS 10 // finite histogram bounds, +Inf is implicit
+#define METRICS_LINE_LEN 160
+
+// ============ STRUCTURES ============
+typedef enum
+{
+    METRIC_COUNTER = 0,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM,
+} metric_type_t;
+
+typedef struct
+{
+    const uint32_t *bounds; // ascending upper bounds ("le"), n_bounds <= METRICS_MAX_BUCKETS
+    uint8_t n_bounds;
+    uint32_t counts[METRICS_MAX_BUCKETS + 1]; // per bucket (not cumulative), last = +Inf
+    uint32_t sum;                             // wraps like a counter, seen as a reset by rate()
+} metric_histogram_t;
+
+typedef struct
+{
+    const char *name;   // families with the same name must be adjacent in the table
+    const char *help;
+    const char *labels; // optional, e.g. "class=\"telemetry\""
+    metric_type_t type;
+    // Exactly one source
+    const volatile uint32_t *u32;     // counter or gauge kept by the application
+    const volatile int32_t *i32;      // signed gauge
+    uint32_t (*sample)(void);         // counter or gauge computed at scrape time
+    const metric_histogram_t *histogram;
+} metric_desc_t;
+
+// Called with consecutive pieces of the exposition, return 0 to abort
+typedef int (*metrics_write_fn_t)(void *ctx, const char *data, size_t len);
+
+// ============ HOT PATH ============
+/**
+ * @brief Counter / gauge update, safe from any task (relaxed atomic, no lock)
+ */
+static inline void metric_add(uint32_t *value, uint32_t n)
+{
+    __atomic_fetch_add(value, n, __ATOMIC_RELAXED);
+}
+
+static inline void metric_inc(uint32_t *value)
+{
+    __atomic_fetch_add(value, 1, __ATOMIC_RELAXED);
+}
+
+static inline void metric_gauge_set(int32_t *gauge, int32_t value)
+{
+    __atomic_store_n(gauge, value, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Count one observation, linear bucket search (a handful of compares)
+ */
+static inline void metric_observe(metric_histogram_t *h, uint32_t value)
+{
+    uint8_t i = 0;
+    while (i < h->n_bounds && value > h->bounds[i])
+    {
+        i++;
+    }
+    __atomic_fetch_add(&h->counts[i], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, value, __ATOMIC_RELAXED);
+}
+
+// ============ API ============
+/**
+ * @brief Set the metric table served by metrics_render (kept by pointer, must stay valid)
+ */
+void metrics_init(const metric_desc_t *table, size_t count);
+
+/**
+ * @brief Write every metric in Prometheus text format
+ * @return false if write aborted
+ */
+bool metrics_render(metrics_write_fn_t write, void *ctx);
+
+#endif // METRICS_H
@@ -0,0 +1,50 @@
+#include "metrics_http.h"
+#include "metrics.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "METRICS";
+
+typedef struct
+{
+    httpd_req_t *req;
+    char buf[METRICS_HTTP_CHUNK];
+    size_t len;
+} metrics_chunk_t;
+
+static int metrics_http_write(void *ctx, const char *data, size_t len)
+{
+    metrics_chunk_t *chunk = ctx;
+
+    if (chunk->len + len > sizeof(chunk->buf))
+    {
+        if (httpd_resp_send_chunk(chunk->req, chunk->buf, chunk->len) != ESP_OK)
+        {
+            return 0;
+        }
+        chunk->len = 0;
+    }
+    memcpy(&chunk->buf[chunk->len], data, len); // a line is at most METRICS_LINE_LEN
+    chunk->len += len;
+    return 1;
+}
+
+esp_err_t metrics_http_handler(httpd_req_t *req)
+{
+    // httpd runs one request at a time, the chunk buffer stays off its stack
+    static metrics_chunk_t chunk;
+
+    chunk.req = req;
+    chunk.len = 0;
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    if (!metrics_render(metrics_http_write, &chunk))
+    {
+        ESP_LOGW(TAG, "Scrape aborted, client gone");
+        return ESP_FAIL;
+    }
+    if (chunk.len > 0 && httpd_resp_send_chunk(req, chunk.buf, chunk.len) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
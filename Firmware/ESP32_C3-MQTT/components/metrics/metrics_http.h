@@ -0,0 +1,13 @@
+#ifndef METRICS_HTTP_H
+#define METRICS_HTTP_H
+
+#include "esp_http_server.h"
+
+#define METRICS_HTTP_CHUNK 1024 // exposition is sent in chunks of this size
+
+/**
+ * @brief GET handler for /metrics, register it on any running httpd
+ */
+esp_err_t metrics_http_handler(httpd_req_t *req);
+
+#endif // METRICS_HTTP_H
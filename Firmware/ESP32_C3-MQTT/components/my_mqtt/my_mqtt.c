@@ -1,11 +1,172 @@
 #include "my_mqtt.h"
+#include "mqtt_loopback.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_transport_ssl.h"
+#include "esp_crt_bundle.h"
 
 static esp_mqtt_client_handle_t client = NULL;
-static my_mqtt_message_t last_msg;
-static bool msg_received = false;
 static my_mqtt_init_t mqtt_cfg_local;
+static bool loopback = false; // server = MQTT_LOOPBACK_URI, in-process broker instead of the network
+static SemaphoreHandle_t loopback_mutex = NULL; // broker tables
+static SemaphoreHandle_t loopback_rx_mutex = NULL; // rx pool fill, publishers of several tasks deliver here
 
+#define MY_MQTT_SLOT_NONE 0xFF
 
+// Messages are assembled straight into the pool and lent to the consumer, the handler never blocks
+static my_mqtt_message_t rx_pool[MY_MQTT_RX_POOL_SIZE];
+static QueueHandle_t rx_free_slots = NULL;  // pool indices available to the event handler
+static QueueHandle_t rx_ready_slots = NULL; // pool indices of complete messages, arrival order
+static uint8_t rx_fill_slot = MY_MQTT_SLOT_NONE;
+static bool rx_discarding = false; // rest of the current fragmented message is dropped
+static my_mqtt_rx_stats_t rx_stats;
+static my_mqtt_conn_stats_t conn_stats;
+static int64_t connect_start_us = 0;
+
+/**
+ * @brief Store one MQTT_EVENT_DATA, large messages arrive as several events with increasing offset
+ *
+ * @param event
+ */
+static void my_mqtt_store_data(esp_mqtt_event_handle_t event)
+{
+    if (event->current_data_offset == 0)
+    {
+        // New message, a fill left over from a broken fragmented one is reused
+        rx_discarding = false;
+        if (rx_fill_slot == MY_MQTT_SLOT_NONE && xQueueReceive(rx_free_slots, &rx_fill_slot, 0) != pdTRUE)
+        {
+            rx_fill_slot = MY_MQTT_SLOT_NONE;
+            rx_stats.dropped_overflow++;
+            rx_discarding = true;
+            ESP_LOGW(TAG_MQTT, "RX pool full, message dropped");
+        }
+        else if (event->total_data_len >= (int)sizeof(rx_pool[0].payload))
+        {
+            rx_stats.dropped_oversize++;
+            rx_discarding = true;
+            ESP_LOGW(TAG_MQTT, "Message of %d bytes too large, dropped", event->total_data_len);
+        }
+        else
+        {
+            my_mqtt_message_t *msg = &rx_pool[rx_fill_slot];
+            msg->topic_len = event->topic_len < (int)sizeof(msg->topic) ? event->topic_len : (int)sizeof(msg->topic) - 1;
+            memcpy(msg->topic, event->topic, msg->topic_len);
+            msg->topic[msg->topic_len] = '\0';
+            msg->payload_len = 0;
+        }
+    }
+
+    if (rx_discarding || rx_fill_slot == MY_MQTT_SLOT_NONE)
+    {
+        return;
+    }
+
+    my_mqtt_message_t *msg = &rx_pool[rx_fill_slot];
+    if (event->current_data_offset != msg->payload_len ||
+        msg->payload_len + event->data_len >= (int)sizeof(msg->payload))
+    {
+        // Missed a fragment, the message cannot be rebuilt
+        rx_discarding = true;
+        return;
+    }
+    memcpy(&msg->payload[msg->payload_len], event->data, event->data_len);
+    msg->payload_len += event->data_len;
+
+    if (msg->payload_len < event->total_data_len)
+    {
+        return;
+    }
+
+    msg->payload[msg->payload_len] = '\0';
+    if (event->current_data_offset > 0)
+    {
+        rx_stats.fragmented++;
+    }
+    xQueueSend(rx_ready_slots, &rx_fill_slot, 0); // holds MY_MQTT_RX_POOL_SIZE entries, never full
+    rx_fill_slot = MY_MQTT_SLOT_NONE;
+    rx_stats.received++;
+
+    uint32_t queued = uxQueueMessagesWaiting(rx_ready_slots);
+    if (queued > rx_stats.max_queued)
+    {
+        rx_stats.max_queued = queued;
+    }
+}
+
+/**
+ * @brief Loopback delivery, same path as MQTT_EVENT_DATA (one unfragmented event)
+ */
+static void my_mqtt_loopback_deliver(void *ctx, const char *topic, int topic_len, const void *data, int len, int qos,
+                                     bool retained)
+{
+    esp_mqtt_event_t event = {
+        .event_id = MQTT_EVENT_DATA,
+        .topic = (char *)topic,
+        .topic_len = topic_len,
+        .data = (char *)data,
+        .data_len = len,
+        .total_data_len = len,
+        .current_data_offset = 0,
+        .qos = qos,
+        .retain = retained,
+    };
+
+    xSemaphoreTake(loopback_rx_mutex, portMAX_DELAY);
+    my_mqtt_store_data(&event);
+    xSemaphoreGive(loopback_rx_mutex);
+}
+
+static void my_mqtt_loopback_lock(void *arg)
+{
+    xSemaphoreTake((SemaphoreHandle_t)arg, portMAX_DELAY);
+}
+
+static void my_mqtt_loopback_unlock(void *arg)
+{
+    xSemaphoreGive((SemaphoreHandle_t)arg);
+}
+
+/**
+ * @brief Connect to the in-process broker: subscribe like MQTT_EVENT_CONNECTED, then report connected
+ */
+static esp_err_t my_mqtt_loopback_start(void)
+{
+    if (!loopback_mutex)
+    {
+        loopback_mutex = xSemaphoreCreateMutex();
+        loopback_rx_mutex = xSemaphoreCreateMutex();
+        if (!loopback_mutex || !loopback_rx_mutex)
+        {
+            ESP_LOGE(TAG_ERROR, "Failed to create loopback mutexes!");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    mqtt_loopback_lock_t lock = {
+        .lock = my_mqtt_loopback_lock,
+        .unlock = my_mqtt_loopback_unlock,
+        .arg = loopback_mutex,
+    };
+    mqtt_loopback_init(&lock);
+    loopback = true;
+
+    mqtt_loopback_subscribe(mqtt_cfg_local.topic_sub, 0, my_mqtt_loopback_deliver, NULL);
+    for (int i = 0; i < MY_MQTT_MAX_EXTRA_SUBS; i++)
+    {
+        if (mqtt_cfg_local.topic_sub_extra[i] != NULL && strcmp(mqtt_cfg_local.topic_sub_extra[i], mqtt_cfg_local.topic_sub) != 0)
+        {
+            mqtt_loopback_subscribe(mqtt_cfg_local.topic_sub_extra[i], 0, my_mqtt_loopback_deliver, NULL);
+        }
+    }
+    ESP_LOGW(TAG_MQTT, "Using the in-process loopback broker, nothing leaves the chip");
+
+    if (mqtt_cfg_local.on_connected_cb != NULL)
+    {
+        mqtt_cfg_local.on_connected_cb();
+    }
+    return ESP_OK;
+}
 
 /**
  * @brief callback MQTT event handler
@@ -21,10 +182,42 @@ static void my_mqtt_event_handler(void *handler_args, esp_event_base_t base, int
 
     switch (event->event_id)
     {
+    case MQTT_EVENT_BEFORE_CONNECT:
+        connect_start_us = esp_timer_get_time();
+        break;
+
     case MQTT_EVENT_CONNECTED:
-        ESP_LOGI(TAG_MQTT, "Connected to broker: %s", mqtt_cfg_local.server);
-        esp_mqtt_client_subscribe(client, mqtt_cfg_local.topic_sub, 0);
-        ESP_LOGI(TAG_MQTT, "Subscribed to topic: %s", mqtt_cfg_local.topic_sub);
+    {
+        uint32_t ms = (uint32_t)((esp_timer_get_time() - connect_start_us) / 1000);
+        conn_stats.connects++;
+        conn_stats.last_ms = ms;
+        conn_stats.first_ms = conn_stats.connects == 1 ? ms : conn_stats.first_ms;
+        conn_stats.min_ms = (conn_stats.connects == 1 || ms < conn_stats.min_ms) ? ms : conn_stats.min_ms;
+        conn_stats.max_ms = ms > conn_stats.max_ms ? ms : conn_stats.max_ms;
+        ESP_LOGI(TAG_MQTT, "Connected to broker: %s in %lu ms (session %s)", mqtt_cfg_local.server, ms,
+                 event->session_present ? "present" : "new");
+
+        // The broker still has our subscriptions, only the first connect after boot subscribes anyway
+        // (the filters may have changed with the firmware)
+        if (event->session_present && conn_stats.connects > 1)
+        {
+            conn_stats.sessions_resumed++;
+        }
+        else
+        {
+            // QoS1 so the broker also queues commands for us while we are away (persistent session)
+            int sub_qos = mqtt_cfg_local.persistent_session ? 1 : 0;
+            esp_mqtt_client_subscribe(client, mqtt_cfg_local.topic_sub, sub_qos);
+            ESP_LOGI(TAG_MQTT, "Subscribed to topic: %s", mqtt_cfg_local.topic_sub);
+            for (int i = 0; i < MY_MQTT_MAX_EXTRA_SUBS; i++)
+            {
+                if (mqtt_cfg_local.topic_sub_extra[i] != NULL && strcmp(mqtt_cfg_local.topic_sub_extra[i], mqtt_cfg_local.topic_sub) != 0)
+                {
+                    esp_mqtt_client_subscribe(client, mqtt_cfg_local.topic_sub_extra[i], sub_qos);
+                    ESP_LOGI(TAG_MQTT, "Subscribed to topic: %s", mqtt_cfg_local.topic_sub_extra[i]);
+                }
+            }
+        }
 
         // Call the callback from the config struct if it's provided
         if (mqtt_cfg_local.on_connected_cb != NULL)
@@ -32,28 +225,23 @@ static void my_mqtt_event_handler(void *handler_args, esp_event_base_t base, int
             mqtt_cfg_local.on_connected_cb();
         }
         break;
+    }
 
     case MQTT_EVENT_DISCONNECTED:
         ESP_LOGW(TAG_ERROR, "MQTT disconnected! Reconnecting...");
+        if (mqtt_cfg_local.on_disconnected_cb != NULL)
+        {
+            mqtt_cfg_local.on_disconnected_cb();
+        }
         // The client will try to reconnect automatically. 
         // We can also force it here if needed.
         // esp_mqtt_client_reconnect(client);
         break;
 
     case MQTT_EVENT_DATA:
-        ESP_LOGI(TAG_MQTT, "Message received:");
-        ESP_LOGI(TAG_MQTT, "  Topic: %.*s", event->topic_len, event->topic);
-        ESP_LOGI(TAG_MQTT, "  Data : %.*s", event->data_len, event->data);
-
-        // Safely copy data to the message buffer
-        memset(&last_msg, 0, sizeof(last_msg));
-        last_msg.topic_len = event->topic_len < sizeof(last_msg.topic) ? event->topic_len : sizeof(last_msg.topic) - 1;
-        strncpy(last_msg.topic, event->topic, last_msg.topic_len);
-        
-        last_msg.payload_len = event->data_len < sizeof(last_msg.payload) ? event->data_len : sizeof(last_msg.payload) - 1;
-        strncpy(last_msg.payload, event->data, last_msg.payload_len);
-        
-        msg_received = true;
+        ESP_LOGD(TAG_MQTT, "Data %d/%d bytes at offset %d, topic %.*s", event->data_len, event->total_data_len,
+                 event->current_data_offset, event->topic_len, event->topic);
+        my_mqtt_store_data(event);
         break;
 
     case MQTT_EVENT_ERROR:
@@ -78,10 +266,72 @@ esp_err_t my_mqtt_init(my_mqtt_init_t *cfg)
 {
     mqtt_cfg_local = *cfg;
 
+    if (!rx_free_slots)
+    {
+        rx_free_slots = xQueueCreate(MY_MQTT_RX_POOL_SIZE, sizeof(uint8_t));
+        rx_ready_slots = xQueueCreate(MY_MQTT_RX_POOL_SIZE, sizeof(uint8_t));
+        if (!rx_free_slots || !rx_ready_slots)
+        {
+            ESP_LOGE(TAG_ERROR, "Failed to create RX queues!");
+            return ESP_ERR_NO_MEM;
+        }
+        for (uint8_t i = 0; i < MY_MQTT_RX_POOL_SIZE; i++)
+        {
+            xQueueSend(rx_free_slots, &i, 0);
+        }
+    }
+
+    if (strncmp(cfg->server, MQTT_LOOPBACK_URI, strlen(MQTT_LOOPBACK_URI)) == 0)
+    {
+        return my_mqtt_loopback_start();
+    }
+
     esp_mqtt_client_config_t mqtt_cfg = {
         .broker.address.uri = cfg->server,
+        .credentials.client_id = cfg->client_id,
+        // Unacked QoS1 publishes stay in the outbox over a reconnect and are resent (DUP) into the kept session
+        .session.disable_clean_session = cfg->persistent_session,
+        .outbox.limit = cfg->outbox_limit,
     };
 
+    if (strncmp(cfg->server, "mqtts://", 8) == 0)
+    {
+        if (cfg->tls_resume)
+        {
+            // Own SSL transport: esp-mqtt does not expose the session ticket option. The ticket of the
+            // last handshake is kept in RAM and offered on the next connect (abbreviated handshake).
+            esp_transport_handle_t ssl = esp_transport_ssl_init();
+            if (!ssl)
+            {
+                ESP_LOGE(TAG_ERROR, "Failed to create the TLS transport!");
+                return ESP_ERR_NO_MEM;
+            }
+            esp_transport_set_default_port(ssl, 8883);
+            if (cfg->ca_cert_pem)
+            {
+                esp_transport_ssl_set_cert_data(ssl, cfg->ca_cert_pem, strlen(cfg->ca_cert_pem));
+            }
+            else
+            {
+                esp_transport_ssl_crt_bundle_attach(ssl, esp_crt_bundle_attach);
+            }
+#ifdef CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+            esp_transport_ssl_session_tickets_enable(ssl);
+#else
+            ESP_LOGW(TAG_MQTT, "CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS off, every reconnect is a full handshake");
+#endif
+            mqtt_cfg.network.transport = ssl; // destroyed with the client
+        }
+        else if (cfg->ca_cert_pem)
+        {
+            mqtt_cfg.broker.verification.certificate = cfg->ca_cert_pem;
+        }
+        else
+        {
+            mqtt_cfg.broker.verification.crt_bundle_attach = esp_crt_bundle_attach;
+        }
+    }
+
     client = esp_mqtt_client_init(&mqtt_cfg);
     esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID, my_mqtt_event_handler, NULL);
 
@@ -98,18 +348,70 @@ esp_err_t my_mqtt_init(my_mqtt_init_t *cfg)
  */
 void my_mqtt_pub(const char *topic, const char *msg)
 {
-    if (client)
+    my_mqtt_pub_opts(topic, msg, 1, false);
+}
+
+/**
+ * @brief publish message with explicit QoS / retain
+ *
+ * @param topic
+ * @param msg
+ * @param qos
+ * @param retain
+ * @return int
+ */
+int my_mqtt_pub_opts(const char *topic, const char *msg, int qos, bool retain)
+{
+    if (!client && !loopback)
     {
-        int msg_id = esp_mqtt_client_publish(client, topic, msg, 0, 1, 0);
-        if (msg_id >= 0)
-            ESP_LOGI(TAG_MQTT, "Published -> topic: %s | msg: %s", topic, msg);
-        else
-            ESP_LOGE(TAG_ERROR, "Failed to publish message!");
+        ESP_LOGE(TAG_ERROR, "MQTT client not initialized!");
+        return -1;
     }
+
+    int msg_id = loopback ? mqtt_loopback_publish(topic, msg, 0, qos, retain)
+                          : esp_mqtt_client_publish(client, topic, msg, 0, qos, retain);
+    if (msg_id >= 0)
+        ESP_LOGI(TAG_MQTT, "Published (qos %d%s) -> topic: %s | msg: %s", qos, retain ? ", retain" : "", topic, msg);
     else
+        ESP_LOGE(TAG_ERROR, "Failed to publish message! (%d)", msg_id);
+    return msg_id;
+}
+
+/**
+ * @brief publish a binary payload, logged by length only
+ *
+ * @param topic
+ * @param data
+ * @param len
+ * @param qos
+ * @param retain
+ * @return int
+ */
+int my_mqtt_pub_bin(const char *topic, const void *data, int len, int qos, bool retain)
+{
+    if (!client && !loopback)
     {
         ESP_LOGE(TAG_ERROR, "MQTT client not initialized!");
+        return -1;
     }
+
+    int msg_id = loopback ? mqtt_loopback_publish(topic, data, len, qos, retain)
+                          : esp_mqtt_client_publish(client, topic, (const char *)data, len, qos, retain);
+    if (msg_id >= 0)
+        ESP_LOGI(TAG_MQTT, "Published (qos %d%s) -> topic: %s | %d bytes", qos, retain ? ", retain" : "", topic, len);
+    else
+        ESP_LOGE(TAG_ERROR, "Failed to publish message! (%d)", msg_id);
+    return msg_id;
+}
+
+/**
+ * @brief bytes currently held in the outbox (always 0 on loopback, QoS1 is acknowledged on publish)
+ *
+ * @return int
+ */
+int my_mqtt_outbox_size(void)
+{
+    return client ? esp_mqtt_client_get_outbox_size(client) : 0;
 }
 
 /**
@@ -121,11 +423,74 @@ void my_mqtt_pub(const char *topic, const char *msg)
  */
 bool my_mqtt_getmess(my_mqtt_message_t *out_msg)
 {
-    if (msg_received)
+    my_mqtt_message_t *msg;
+
+    if (!my_mqtt_acquire(&msg, 0))
+    {
+        return false;
+    }
+    *out_msg = *msg;
+    my_mqtt_release(msg);
+    return true;
+}
+
+/**
+ * @brief wait for the oldest received message (no copy)
+ *
+ * @param out_msg
+ * @param ticks_to_wait
+ * @return true
+ * @return false
+ */
+bool my_mqtt_acquire(my_mqtt_message_t **out_msg, TickType_t ticks_to_wait)
+{
+    uint8_t slot;
+
+    if (!rx_ready_slots || xQueueReceive(rx_ready_slots, &slot, ticks_to_wait) != pdTRUE)
+    {
+        return false;
+    }
+    *out_msg = &rx_pool[slot];
+    return true;
+}
+
+/**
+ * @brief give a buffer from my_mqtt_acquire back to the pool
+ *
+ * @param msg
+ */
+void my_mqtt_release(my_mqtt_message_t *msg)
+{
+    if (!msg || msg < rx_pool || msg >= &rx_pool[MY_MQTT_RX_POOL_SIZE])
+    {
+        return;
+    }
+    uint8_t slot = (uint8_t)(msg - rx_pool);
+    xQueueSend(rx_free_slots, &slot, 0);
+}
+
+/**
+ * @brief copy of the receive counters
+ *
+ * @param out
+ */
+void my_mqtt_get_rx_stats(my_mqtt_rx_stats_t *out)
+{
+    if (out)
+    {
+        *out = rx_stats;
+    }
+}
+
+/**
+ * @brief copy of the connect timings
+ *
+ * @param out
+ */
+void my_mqtt_get_conn_stats(my_mqtt_conn_stats_t *out)
+{
+    if (out)
     {
-        *out_msg = last_msg;
-        msg_received = false;
-        return true;
+        *out = conn_stats; // written by the MQTT task only
     }
-    return false;
 }
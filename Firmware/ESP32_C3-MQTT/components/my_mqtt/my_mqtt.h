@@ -6,10 +6,15 @@
 #include "string.h"
 #include "stdbool.h"
 #include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 
 #define TAG_MQTT "[MY_MQTT]"
 #define TAG_ERROR "[ERROR_MQTT]"
 
+#define MY_MQTT_RX_POOL_SIZE 6 // received messages buffered while the consumer is busy
+#define MY_MQTT_MAX_EXTRA_SUBS 4 // filters subscribed besides topic_sub
+
 // Define a callback type for when MQTT connects successfully
 typedef void (*mqtt_connected_cb_t)(void);
 
@@ -18,7 +23,14 @@ typedef struct
     char server[128];
     char topic_pub[64];
     char topic_sub[64];
+    const char *topic_sub_extra[MY_MQTT_MAX_EXTRA_SUBS]; // more filters (wildcards allowed), NULL = unused
     mqtt_connected_cb_t on_connected_cb; // Callback for connection event
+    mqtt_connected_cb_t on_disconnected_cb; // Callback when the broker connection drops (client reconnects by itself)
+    uint32_t outbox_limit;               // Max bytes of unacknowledged QoS>0 messages, 0 = unlimited
+    const char *client_id;               // NULL = esp-mqtt default (from the MAC, stable across boots)
+    bool persistent_session;             // clean_session = 0: broker keeps subscriptions and queued QoS1 for us
+    const char *ca_cert_pem;             // mqtts:// server CA, NULL = ESP x509 certificate bundle
+    bool tls_resume;                     // mqtts:// reconnects resume the TLS session from a RAM ticket
 } my_mqtt_init_t;
 
 typedef struct
@@ -29,9 +41,30 @@ typedef struct
     int payload_len;
 } my_mqtt_message_t;
 
+typedef struct
+{
+    uint32_t received;         // complete messages queued
+    uint32_t dropped_overflow; // all pool buffers in use
+    uint32_t dropped_oversize; // total_data_len larger than payload
+    uint32_t fragmented;       // messages that arrived in more than one MQTT_EVENT_DATA
+    uint32_t max_queued;       // high-water mark of messages waiting
+} my_mqtt_rx_stats_t;
+
+typedef struct
+{
+    uint32_t connects;         // MQTT_EVENT_CONNECTED count
+    uint32_t sessions_resumed; // CONNACK with session present, subscriptions kept by the broker
+    uint32_t first_ms;         // BEFORE_CONNECT -> CONNECTED of the first connect (full TLS handshake)
+    uint32_t last_ms;          // same for the latest connect, TCP + TLS + MQTT CONNECT
+    uint32_t min_ms;
+    uint32_t max_ms;
+} my_mqtt_conn_stats_t;
+
 
 /**
  * @brief initialize MQTT client
+ * @details server = MQTT_LOOPBACK_URI ("loopback://") uses the in-process broker of mqtt_loopback,
+ *          connected on return, for benchmarks without a network
  *
  * @param struct init cfg
  */
@@ -44,8 +77,39 @@ esp_err_t my_mqtt_init(my_mqtt_init_t *cfg);
  */
 void my_mqtt_pub(const char *topic, const char *msg);
 
+/**
+ * @brief publish message with explicit QoS / retain
+ *
+ * @param topic
+ * @param msg
+ * @param qos
+ * @param retain
+ * @return message id (0 for QoS0), negative if not queued (-2 when the outbox is full)
+ */
+int my_mqtt_pub_opts(const char *topic, const char *msg, int qos, bool retain);
+
+/**
+ * @brief publish a binary payload (CBOR), same return values as my_mqtt_pub_opts
+ *
+ * @param topic
+ * @param data
+ * @param len
+ * @param qos
+ * @param retain
+ * @return int
+ */
+int my_mqtt_pub_bin(const char *topic, const void *data, int len, int qos, bool retain);
+
+/**
+ * @brief bytes currently held in the outbox (QoS>0 messages waiting for their ack)
+ *
+ * @return int
+ */
+int my_mqtt_outbox_size(void);
+
 /**
  * @brief get received message (not processed in callback)
+ * @details Copy of the oldest queued message, prefer my_mqtt_acquire
  *
  * @param out_msg
  * @return true
@@ -53,4 +117,34 @@ void my_mqtt_pub(const char *topic, const char *msg);
  */
 bool my_mqtt_getmess(my_mqtt_message_t *out_msg);
 
+/**
+ * @brief wait for the oldest received message (no copy)
+ *
+ * @param out_msg pool buffer, valid until my_mqtt_release
+ * @param ticks_to_wait
+ * @return true if a message was taken
+ */
+bool my_mqtt_acquire(my_mqtt_message_t **out_msg, TickType_t ticks_to_wait);
+
+/**
+ * @brief give a buffer from my_mqtt_acquire back to the pool
+ *
+ * @param msg
+ */
+void my_mqtt_release(my_mqtt_message_t *msg);
+
+/**
+ * @brief copy of the receive counters
+ *
+ * @param out
+ */
+void my_mqtt_get_rx_stats(my_mqtt_rx_stats_t *out);
+
+/**
+ * @brief copy of the connect timings (handshake durations, resumed sessions)
+ *
+ * @param out
+ */
+void my_mqtt_get_conn_stats(my_mqtt_conn_stats_t *out);
+
 #endif
@@ -0,0 +1,122 @@
+#include "report_policy.h"
+#include <string.h>
+
+static const char *const field_names[REPORT_FIELD_COUNT] = {
+    [REPORT_FIELD_LUX] = "lux",
+    [REPORT_FIELD_TEMP] = "temp",
+    [REPORT_FIELD_HUMI] = "humi",
+};
+
+void report_policy_defaults(report_policy_config_t *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->version = REPORT_POLICY_VERSION;
+    // BH1750 lux is noisy at low light: 5 % or 10 lx, whichever is larger
+    cfg->field[REPORT_FIELD_LUX] = (report_field_policy_t){.abs_deadband = 10, .rel_deadband_pm = 50, .min_interval_ms = 1000};
+    // DHT11 resolution is 1 degree / 1 %RH, a single step is often just jitter for humidity
+    cfg->field[REPORT_FIELD_TEMP] = (report_field_policy_t){.abs_deadband = 1, .min_interval_ms = 1000};
+    cfg->field[REPORT_FIELD_HUMI] = (report_field_policy_t){.abs_deadband = 2, .min_interval_ms = 1000};
+    cfg->heartbeat_ms = 60000;
+}
+
+bool report_policy_valid(const report_policy_config_t *cfg)
+{
+    if (cfg->version != REPORT_POLICY_VERSION)
+    {
+        return false;
+    }
+    for (int f = 0; f < REPORT_FIELD_COUNT; f++)
+    {
+        const report_field_policy_t *fp = &cfg->field[f];
+        if (fp->rel_deadband_pm > 1000 || (fp->max_interval_ms != 0 && fp->max_interval_ms < fp->min_interval_ms))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void report_policy_reset(report_policy_t *p, const report_policy_config_t *cfg)
+{
+    memset(p, 0, sizeof(*p));
+    p->cfg = *cfg;
+}
+
+/**
+ * @brief true if value moved past the deadband from the last published one
+ */
+static bool field_moved(const report_field_policy_t *fp, uint16_t last, uint16_t value)
+{
+    uint32_t delta = value > last ? value - last : last - value;
+
+    if (delta == 0)
+    {
+        return false;
+    }
+    // Both set: the larger one applies (a relative band alone is tiny near 0, an absolute one at high values)
+    if (fp->abs_deadband != 0 && delta < fp->abs_deadband)
+    {
+        return false;
+    }
+    return fp->rel_deadband_pm == 0 || delta * 1000u >= (uint32_t)last * fp->rel_deadband_pm;
+}
+
+bool report_policy_decide(report_policy_t *p, uint8_t node, uint8_t present, const uint16_t value[REPORT_FIELD_COUNT],
+                          uint32_t now_ms, uint8_t *publish)
+{
+    *publish = 0;
+    p->stats.frames_in++;
+    if (node >= REPORT_MAX_NODES)
+    {
+        // No state for it, report everything
+        *publish = present;
+        p->stats.frames_published++;
+        return true;
+    }
+
+    report_node_state_t *ns = &p->node[node];
+    bool heartbeat = !ns->seen || (p->cfg.heartbeat_ms != 0 && now_ms - ns->last_ms >= p->cfg.heartbeat_ms);
+
+    for (int f = 0; f < REPORT_FIELD_COUNT; f++)
+    {
+        if (!(present & REPORT_FIELD_BIT(f)))
+        {
+            continue;
+        }
+
+        const report_field_policy_t *fp = &p->cfg.field[f];
+        report_field_state_t *fs = &ns->field[f];
+        uint32_t elapsed = now_ms - fs->last_ms;
+        bool send = heartbeat || !fs->valid ||
+                    (elapsed >= fp->min_interval_ms && field_moved(fp, fs->value, value[f])) ||
+                    (fp->max_interval_ms != 0 && elapsed >= fp->max_interval_ms);
+
+        if (send)
+        {
+            fs->valid = true;
+            fs->value = value[f];
+            fs->last_ms = now_ms;
+            *publish |= REPORT_FIELD_BIT(f);
+            p->stats.fields_published[f]++;
+        }
+        else
+        {
+            p->stats.fields_suppressed[f]++;
+        }
+    }
+
+    if (*publish == 0 && !heartbeat)
+    {
+        p->stats.frames_suppressed++;
+        return false;
+    }
+    ns->seen = true;
+    ns->last_ms = now_ms;
+    p->stats.frames_published++;
+    return true;
+}
+
+const char *report_field_name(report_field_t field)
+{
+    return field < REPORT_FIELD_COUNT ? field_names[field] : "?";
+}
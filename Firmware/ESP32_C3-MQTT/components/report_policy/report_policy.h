@@ -0,0 +1,128 @@
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/*
+ * Report-by-exception for the gateway telemetry. Each field of a node is published when it moved
+ * past its deadband since the value last published, not more often than min_interval_ms; a field
+ * that did not move is still republished after max_interval_ms, and a node that published nothing
+ * for heartbeat_ms sends everything it has. The value kept is the last one *published*, so a slow
+ * drift is reported once it adds up to the deadband.
+ *
+ * report_policy_decide() and friends are pure (no ESP-IDF/FreeRTOS), the report_policy_* calls
+ * without a report_policy_t argument wrap one locked instance whose config lives in NVS.
+ */
+
+// ============ CONFIG ============
+#define REPORT_MAX_NODES 11 // node ids 0..10, like TOPIC_MAX_NODES
+#define REPORT_POLICY_VERSION 1
+
+typedef enum
+{
+    REPORT_FIELD_LUX = 0,
+    REPORT_FIELD_TEMP,
+    REPORT_FIELD_HUMI,
+    REPORT_FIELD_COUNT
+} report_field_t;
+
+#define REPORT_FIELD_BIT(f) (1u << (f))
+
+// ============ STRUCTURES ============
+typedef struct
+{
+    uint16_t abs_deadband;    // publish when |value - last| >= this, 0 = off
+    uint16_t rel_deadband_pm; // publish when |value - last| >= last * this / 1000, 0 = off
+    uint32_t min_interval_ms; // changes inside this are held back, 0 = off
+    uint32_t max_interval_ms; // republish an unchanged value after this, 0 = off
+} report_field_policy_t;
+// both set: the change must pass both (the larger band applies); both 0: any change is published
+
+typedef struct
+{
+    uint8_t version;
+    report_field_policy_t field[REPORT_FIELD_COUNT];
+    uint32_t heartbeat_ms; // node silent this long -> publish all its fields, 0 = off
+} report_policy_config_t;
+
+typedef struct
+{
+    uint32_t frames_in;
+    uint32_t frames_published;  // at least one field (or the heartbeat) went out
+    uint32_t frames_suppressed; // dropped entirely
+    uint32_t fields_published[REPORT_FIELD_COUNT];
+    uint32_t fields_suppressed[REPORT_FIELD_COUNT];
+} report_policy_stats_t;
+
+typedef struct
+{
+    bool valid;
+    uint16_t value;   // last published
+    uint32_t last_ms; // when it was published
+} report_field_state_t;
+
+typedef struct
+{
+    bool seen;
+    uint32_t last_ms; // last publish of any field
+    report_field_state_t field[REPORT_FIELD_COUNT];
+} report_node_state_t;
+
+typedef struct
+{
+    report_policy_config_t cfg;
+    report_node_state_t node[REPORT_MAX_NODES];
+    report_policy_stats_t stats;
+} report_policy_t;
+
+// ============ PURE API ============
+void report_policy_defaults(report_policy_config_t *cfg);
+
+/**
+ * @brief Reject configs that cannot work (max interval below min interval, relative deadband > 100 %)
+ */
+bool report_policy_valid(const report_policy_config_t *cfg);
+
+/**
+ * @brief New config, per-node state and counters cleared (next frame of every node is published)
+ */
+void report_policy_reset(report_policy_t *p, const report_policy_config_t *cfg);
+
+/**
+ * @brief Decide which fields of one frame to publish, and remember them as published
+ * @param present REPORT_FIELD_BIT() of the fields in the frame
+ * @param value indexed by report_field_t, only present fields are read
+ * @param now_ms free running millisecond clock, wrap-around is fine
+ * @param publish out: fields to publish
+ * @return true if the frame is published (some field, or an empty frame on the node heartbeat)
+ */
+bool report_policy_decide(report_policy_t *p, uint8_t node, uint8_t present, const uint16_t value[REPORT_FIELD_COUNT],
+                          uint32_t now_ms, uint8_t *publish);
+
+const char *report_field_name(report_field_t field);
+
+// ============ GATEWAY INSTANCE ============
+/**
+ * @brief Defaults and the lock, before the first report_policy_filter()
+ */
+esp_err_t report_policy_init(void);
+
+/**
+ * @brief Load the config stored by report_policy_set_config(), NVS must be initialised
+ */
+esp_err_t report_policy_load(void);
+
+bool report_policy_filter(uint8_t node, uint8_t present, const uint16_t value[REPORT_FIELD_COUNT], uint32_t now_ms,
+                          uint8_t *publish);
+
+/**
+ * @brief Validate, store in NVS and apply (per-node state restarts, counters are kept)
+ */
+esp_err_t report_policy_set_config(const report_policy_config_t *cfg);
+
+void report_policy_get_config(report_policy_config_t *out);
+void report_policy_get_stats(report_policy_stats_t *out);
+
+#endif // REPORT_POLICY_H
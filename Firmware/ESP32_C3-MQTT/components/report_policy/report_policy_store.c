@@ -0,0 +1,122 @@
+#include "report_policy.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include "esp_log.h"
+
+static const char *TAG = "REPORT_POLICY";
+
+#define NVS_NAMESPACE "report"
+#define NVS_KEY_CONFIG "policy"
+
+// Decided from the UART decode task, configured from the MQTT control task
+static report_policy_t policy;
+static SemaphoreHandle_t policy_lock = NULL;
+
+esp_err_t report_policy_init(void)
+{
+    report_policy_config_t cfg;
+
+    if (policy_lock == NULL)
+    {
+        policy_lock = xSemaphoreCreateMutex();
+        if (policy_lock == NULL)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    report_policy_defaults(&cfg);
+    xSemaphoreTake(policy_lock, portMAX_DELAY);
+    report_policy_reset(&policy, &cfg);
+    xSemaphoreGive(policy_lock);
+    return ESP_OK;
+}
+
+esp_err_t report_policy_load(void)
+{
+    nvs_handle_t nvs_handle;
+    report_policy_config_t cfg;
+    size_t size = sizeof(cfg);
+
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK)
+    {
+        return err; // nothing stored yet, defaults stay
+    }
+    err = nvs_get_blob(nvs_handle, NVS_KEY_CONFIG, &cfg, &size);
+    nvs_close(nvs_handle);
+    if (err != ESP_OK || size != sizeof(cfg) || !report_policy_valid(&cfg))
+    {
+        ESP_LOGW(TAG, "No valid stored policy, using defaults");
+        return err != ESP_OK ? err : ESP_ERR_INVALID_VERSION;
+    }
+
+    xSemaphoreTake(policy_lock, portMAX_DELAY);
+    report_policy_reset(&policy, &cfg);
+    xSemaphoreGive(policy_lock);
+    ESP_LOGI(TAG, "Policy loaded, heartbeat %lu ms", cfg.heartbeat_ms);
+    return ESP_OK;
+}
+
+bool report_policy_filter(uint8_t node, uint8_t present, const uint16_t value[REPORT_FIELD_COUNT], uint32_t now_ms,
+                          uint8_t *publish)
+{
+    if (policy_lock == NULL)
+    {
+        *publish = present;
+        return true;
+    }
+    xSemaphoreTake(policy_lock, portMAX_DELAY);
+    bool send = report_policy_decide(&policy, node, present, value, now_ms, publish);
+    xSemaphoreGive(policy_lock);
+    return send;
+}
+
+esp_err_t report_policy_set_config(const report_policy_config_t *cfg)
+{
+    nvs_handle_t nvs_handle;
+
+    if (!report_policy_valid(cfg))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_blob(nvs_handle, NVS_KEY_CONFIG, cfg, sizeof(*cfg));
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(nvs_handle);
+        }
+        nvs_close(nvs_handle);
+    }
+    if (err != ESP_OK)
+    {
+        // Still applied, only lost on the next reset
+        ESP_LOGW(TAG, "Policy not saved: %s", esp_err_to_name(err));
+    }
+
+    // Counters run on across config changes, only the per-node state starts over
+    xSemaphoreTake(policy_lock, portMAX_DELAY);
+    report_policy_stats_t stats = policy.stats;
+    report_policy_reset(&policy, cfg);
+    policy.stats = stats;
+    xSemaphoreGive(policy_lock);
+    return err;
+}
+
+void report_policy_get_config(report_policy_config_t *out)
+{
+    xSemaphoreTake(policy_lock, portMAX_DELAY);
+    *out = policy.cfg;
+    xSemaphoreGive(policy_lock);
+}
+
+void report_policy_get_stats(report_policy_stats_t *out)
+{
+    xSemaphoreTake(policy_lock, portMAX_DELAY);
+    *out = policy.stats;
+    xSemaphoreGive(policy_lock);
+}
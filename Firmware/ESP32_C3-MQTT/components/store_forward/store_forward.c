@@ -0,0 +1,430 @@
+#include "store_forward.h"
+#include <string.h>
+#include <stddef.h>
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_log.h"
+
+static const char *TAG = "STORE_FWD";
+
+#define SF_SECTOR_SIZE 4096
+#define SF_SECTOR_MAGIC 0x31574653 // "SFW1"
+#define SF_RECORD_MAGIC 0x5352     // "RS"
+#define SF_FREE16 0xFFFF
+#define SF_STATE_PENDING 0xFF
+#define SF_STATE_SENT 0x00
+#define SF_ALIGN4(x) (((x) + 3u) & ~3u)
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sector_seq; // increases by one per sector started, the largest one is the write head
+} sf_sector_header_t;
+
+typedef struct
+{
+    uint16_t magic;
+    uint16_t len;   // topic + payload, both '\0' terminated
+    uint32_t seq;
+    uint32_t crc;   // crc32 of seq, msg_class and the data
+    uint8_t msg_class;
+    uint8_t state;  // SF_STATE_PENDING when written, cleared in place once sent
+    uint16_t pad;
+} sf_record_header_t;
+
+typedef enum
+{
+    SF_REC_VALID,
+    SF_REC_CORRUPT, // header readable, data fails the crc: skip it
+    SF_REC_FREE,    // erased space, the sector continues here
+    SF_REC_END      // end of the sector or a header nothing after can be trusted
+} sf_rec_t;
+
+static const esp_partition_t *sf_part;
+static uint32_t sf_sectors;
+static uint32_t head_sector, head_offset, head_sector_seq;
+static uint32_t read_sector, read_offset;
+static uint32_t next_seq = 1;
+static uint32_t last_sent_seq;
+static bool peek_valid;
+static uint32_t peek_seq, peek_next;
+static store_forward_stats_t sf_stats;
+static uint8_t sf_buf[SF_ALIGN4(sizeof(sf_record_header_t) + STORE_FORWARD_MAX_RECORD)];
+
+_Static_assert(sizeof(sf_buf) <= SF_SECTOR_SIZE - sizeof(sf_sector_header_t), "record must fit one sector");
+
+static uint32_t sf_addr(uint32_t sector, uint32_t offset)
+{
+    return sector * SF_SECTOR_SIZE + offset;
+}
+
+static bool sf_sector_seq(uint32_t sector, uint32_t *seq)
+{
+    sf_sector_header_t hdr;
+    if (esp_partition_read(sf_part, sf_addr(sector, 0), &hdr, sizeof(hdr)) != ESP_OK || hdr.magic != SF_SECTOR_MAGIC)
+    {
+        return false;
+    }
+    *seq = hdr.sector_seq;
+    return true;
+}
+
+static uint32_t sf_record_crc(const sf_record_header_t *hdr, const uint8_t *data)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)&hdr->seq, sizeof(hdr->seq));
+    crc = esp_rom_crc32_le(crc, &hdr->msg_class, 1);
+    return esp_rom_crc32_le(crc, data, hdr->len);
+}
+
+/**
+ * @brief Read the record header at (sector, offset), and its data when data != NULL
+ * @param next Offset of the following record, set for SF_REC_VALID / SF_REC_CORRUPT
+ */
+static sf_rec_t sf_read_record(uint32_t sector, uint32_t offset, sf_record_header_t *hdr, uint8_t *data, uint16_t data_size, uint32_t *next)
+{
+    if (offset + sizeof(*hdr) > SF_SECTOR_SIZE ||
+        esp_partition_read(sf_part, sf_addr(sector, offset), hdr, sizeof(*hdr)) != ESP_OK)
+    {
+        return SF_REC_END;
+    }
+    if (hdr->magic == SF_FREE16 && hdr->len == SF_FREE16)
+    {
+        return SF_REC_FREE;
+    }
+    if (hdr->magic != SF_RECORD_MAGIC || hdr->len == 0 || hdr->len > STORE_FORWARD_MAX_RECORD ||
+        offset + sizeof(*hdr) + hdr->len > SF_SECTOR_SIZE)
+    {
+        return SF_REC_END;
+    }
+
+    *next = offset + SF_ALIGN4(sizeof(*hdr) + hdr->len);
+    if (data)
+    {
+        if (hdr->len > data_size ||
+            esp_partition_read(sf_part, sf_addr(sector, offset + sizeof(*hdr)), data, hdr->len) != ESP_OK ||
+            sf_record_crc(hdr, data) != hdr->crc || data[hdr->len - 1] != '\0')
+        {
+            return SF_REC_CORRUPT;
+        }
+    }
+    return SF_REC_VALID;
+}
+
+/**
+ * @brief Unsent records of a sector from offset on
+ */
+static uint32_t sf_count_pending(uint32_t sector, uint32_t offset)
+{
+    sf_record_header_t hdr;
+    uint32_t count = 0;
+    uint32_t next;
+    sf_rec_t rec;
+    while ((rec = sf_read_record(sector, offset, &hdr, NULL, 0, &next)) == SF_REC_VALID)
+    {
+        if (hdr.state == SF_STATE_PENDING && hdr.seq > last_sent_seq)
+        {
+            count++;
+        }
+        offset = next;
+    }
+    return count;
+}
+
+/**
+ * @brief Erase a sector and make it the write head
+ * @details Sectors are taken in index order, so when the ring is full this is the oldest one;
+ *          its unsent records are lost and the read cursor moves to the next oldest sector.
+ */
+static esp_err_t sf_start_sector(uint32_t sector)
+{
+    uint32_t seq;
+    if (sf_sector_seq(sector, &seq) && read_sector == sector)
+    {
+        uint32_t lost = sf_count_pending(sector, read_offset);
+        if (lost)
+        {
+            ESP_LOGW(TAG, "Ring full, %lu unsent records overwritten", lost);
+            sf_stats.dropped_overwritten += lost;
+            sf_stats.pending -= (lost < sf_stats.pending) ? lost : sf_stats.pending;
+        }
+        read_sector = (sector + 1) % sf_sectors;
+        read_offset = sizeof(sf_sector_header_t);
+        peek_valid = false;
+    }
+
+    esp_err_t err = esp_partition_erase_range(sf_part, sf_addr(sector, 0), SF_SECTOR_SIZE);
+    sf_stats.erases++;
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Erase of sector %lu failed: %s", sector, esp_err_to_name(err));
+        return err;
+    }
+
+    sf_sector_header_t hdr = {.magic = SF_SECTOR_MAGIC, .sector_seq = head_sector_seq + 1};
+    err = esp_partition_write(sf_part, sf_addr(sector, 0), &hdr, sizeof(hdr));
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Header write of sector %lu failed: %s", sector, esp_err_to_name(err));
+        return err;
+    }
+    head_sector_seq = hdr.sector_seq;
+    head_sector = sector;
+    head_offset = sizeof(hdr);
+    return ESP_OK;
+}
+
+esp_err_t store_forward_init(void)
+{
+    sf_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, STORE_FORWARD_SUBTYPE, STORE_FORWARD_PARTITION);
+    if (!sf_part)
+    {
+        ESP_LOGE(TAG, "Partition '%s' not found", STORE_FORWARD_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    sf_sectors = sf_part->size / SF_SECTOR_SIZE;
+    if (sf_sectors < 2)
+    {
+        ESP_LOGE(TAG, "Partition '%s' needs at least 2 sectors", STORE_FORWARD_PARTITION);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(&sf_stats, 0, sizeof(sf_stats));
+    sf_stats.sectors = sf_sectors;
+    next_seq = 1;
+    last_sent_seq = 0;
+    peek_valid = false;
+
+    bool found = false;
+    uint32_t oldest = 0, oldest_seq = 0;
+    head_sector_seq = 0;
+    for (uint32_t s = 0; s < sf_sectors; s++)
+    {
+        uint32_t seq;
+        if (!sf_sector_seq(s, &seq))
+        {
+            continue;
+        }
+        if (!found || seq > head_sector_seq)
+        {
+            head_sector = s;
+            head_sector_seq = seq;
+        }
+        if (!found || seq < oldest_seq)
+        {
+            oldest = s;
+            oldest_seq = seq;
+        }
+        found = true;
+    }
+
+    if (!found)
+    {
+        read_sector = 0;
+        read_offset = sizeof(sf_sector_header_t);
+        esp_err_t err = sf_start_sector(0);
+        ESP_LOGI(TAG, "Formatted '%s', %lu sectors", STORE_FORWARD_PARTITION, sf_sectors);
+        return err;
+    }
+
+    // Walk the ring from the oldest sector: recover seqs, the read cursor and the write offset
+    bool cursor_set = false;
+    uint32_t s = oldest;
+    while (1)
+    {
+        sf_record_header_t hdr;
+        uint32_t offset = sizeof(sf_sector_header_t);
+        uint32_t next;
+        sf_rec_t rec = SF_REC_END;
+        uint32_t seq;
+        bool valid = sf_sector_seq(s, &seq);
+
+        while (valid && (rec = sf_read_record(s, offset, &hdr, NULL, 0, &next)) == SF_REC_VALID)
+        {
+            if (hdr.seq >= next_seq)
+            {
+                next_seq = hdr.seq + 1;
+            }
+            if (hdr.state != SF_STATE_PENDING)
+            {
+                if (hdr.seq > last_sent_seq)
+                {
+                    last_sent_seq = hdr.seq;
+                }
+            }
+            else
+            {
+                if (!cursor_set)
+                {
+                    read_sector = s;
+                    read_offset = offset;
+                    cursor_set = true;
+                }
+                sf_stats.pending++;
+            }
+            offset = next;
+        }
+
+        if (s == head_sector)
+        {
+            // A header nothing can follow (torn write): seal the sector, the next append starts a new one
+            head_offset = (valid && rec == SF_REC_FREE) ? offset : SF_SECTOR_SIZE;
+            break;
+        }
+        s = (s + 1) % sf_sectors;
+    }
+
+    if (!cursor_set)
+    {
+        read_sector = head_sector;
+        read_offset = head_offset;
+    }
+
+    ESP_LOGI(TAG, "Mounted '%s': %lu sectors, head %lu@%lu, %lu pending, next seq %lu",
+             STORE_FORWARD_PARTITION, sf_sectors, head_sector, head_offset, sf_stats.pending, next_seq);
+    return ESP_OK;
+}
+
+esp_err_t store_forward_append(uint8_t msg_class, const char *topic, const char *payload)
+{
+    if (!sf_part)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t topic_len = strlen(topic) + 1;
+    size_t payload_len = strlen(payload) + 1;
+    if (topic_len + payload_len > STORE_FORWARD_MAX_RECORD)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t total = SF_ALIGN4(sizeof(sf_record_header_t) + topic_len + payload_len);
+    if (head_offset + total > SF_SECTOR_SIZE)
+    {
+        esp_err_t err = sf_start_sector((head_sector + 1) % sf_sectors);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+
+    sf_record_header_t *hdr = (sf_record_header_t *)sf_buf;
+    uint8_t *data = sf_buf + sizeof(*hdr);
+    memset(sf_buf, 0xFF, total);
+    memcpy(data, topic, topic_len);
+    memcpy(data + topic_len, payload, payload_len);
+    hdr->magic = SF_RECORD_MAGIC;
+    hdr->len = topic_len + payload_len;
+    hdr->seq = next_seq;
+    hdr->msg_class = msg_class;
+    hdr->state = SF_STATE_PENDING;
+    hdr->crc = sf_record_crc(hdr, data);
+
+    // Header and data in one write, a power cut in between leaves a record that fails the crc
+    esp_err_t err = esp_partition_write(sf_part, sf_addr(head_sector, head_offset), sf_buf, total);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Write failed: %s", esp_err_to_name(err));
+        head_offset = SF_SECTOR_SIZE;
+        return err;
+    }
+    head_offset += total;
+    next_seq++;
+    sf_stats.appended++;
+    sf_stats.pending++;
+    return ESP_OK;
+}
+
+bool store_forward_peek(store_forward_record_t *out, char *buf, uint16_t buf_size)
+{
+    if (!sf_part)
+    {
+        return false;
+    }
+
+    while (!(read_sector == head_sector && read_offset >= head_offset))
+    {
+        sf_record_header_t hdr;
+        uint32_t next;
+        sf_rec_t rec = sf_read_record(read_sector, read_offset, &hdr, (uint8_t *)buf, buf_size, &next);
+
+        if (rec == SF_REC_FREE || rec == SF_REC_END)
+        {
+            if (read_sector == head_sector)
+            {
+                return false;
+            }
+            read_sector = (read_sector + 1) % sf_sectors;
+            read_offset = sizeof(sf_sector_header_t);
+            continue;
+        }
+
+        bool pending = hdr.state == SF_STATE_PENDING && hdr.seq > last_sent_seq;
+        if (rec == SF_REC_CORRUPT || !pending)
+        {
+            if (rec == SF_REC_CORRUPT)
+            {
+                ESP_LOGW(TAG, "Record at %lu@%lu corrupt, skipped", read_sector, read_offset);
+                sf_stats.corrupt++;
+            }
+            if (hdr.state == SF_STATE_PENDING && sf_stats.pending)
+            {
+                sf_stats.pending--;
+            }
+            read_offset = next;
+            continue;
+        }
+
+        out->seq = hdr.seq;
+        out->msg_class = hdr.msg_class;
+        out->topic = buf;
+        out->payload = buf + strlen(buf) + 1;
+        if (out->payload >= buf + hdr.len)
+        {
+            // No payload after the topic: crc matched a record we never write
+            out->payload = buf + hdr.len - 1;
+        }
+        peek_valid = true;
+        peek_seq = hdr.seq;
+        peek_next = next;
+        return true;
+    }
+    return false;
+}
+
+esp_err_t store_forward_ack(uint32_t seq)
+{
+    if (!peek_valid || seq != peek_seq)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // 0xFF -> 0x00 only clears bits, no erase needed
+    uint8_t state = SF_STATE_SENT;
+    esp_err_t err = esp_partition_write(sf_part, sf_addr(read_sector, read_offset + offsetof(sf_record_header_t, state)), &state, 1);
+    if (err != ESP_OK)
+    {
+        // The RAM copy of last_sent_seq still skips it until reboot, the server dedups by seq after that
+        ESP_LOGW(TAG, "Marking seq %lu sent failed: %s", seq, esp_err_to_name(err));
+    }
+
+    last_sent_seq = seq;
+    read_offset = peek_next;
+    peek_valid = false;
+    sf_stats.replayed++;
+    if (sf_stats.pending)
+    {
+        sf_stats.pending--;
+    }
+    return ESP_OK;
+}
+
+uint32_t store_forward_pending(void)
+{
+    return sf_stats.pending;
+}
+
+void store_forward_get_stats(store_forward_stats_t *out)
+{
+    *out = sf_stats;
+}
@@ -0,0 +1,68 @@
+#ifndef STORE_FORWARD_H
+#define STORE_FORWARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define STORE_FORWARD_PARTITION "tlm_store" // data partition, subtype STORE_FORWARD_SUBTYPE (partitions.csv)
+#define STORE_FORWARD_SUBTYPE 0x40
+#define STORE_FORWARD_MAX_RECORD 1152       // topic + payload of one record, must fit a sector with its header
+
+/*
+ * Log-structured ring on a raw flash partition:
+ *   sector : [magic, sector_seq] then records appended back to back, never rewritten
+ *   record : [magic, len, seq, crc32, class, state, pad] [topic '\0' payload '\0'], 4-byte aligned
+ * Sectors are filled in index order and erased only when the ring wraps onto them, so every
+ * sector sees the same erase count. A sent record only has its state byte cleared (1 -> 0 bits,
+ * no erase). At mount the newest sector_seq gives the write head, the oldest pending record the
+ * read cursor; torn records from a power cut fail the crc and are skipped.
+ * Not thread safe: use from one task (the MQTT publisher), never from the UART decode path.
+ */
+
+typedef struct
+{
+    uint32_t seq;          // strictly increasing across reboots, sent with the replayed message for dedup
+    uint8_t msg_class;
+    const char *topic;     // point into the caller buffer given to store_forward_peek()
+    const char *payload;
+} store_forward_record_t;
+
+typedef struct
+{
+    uint32_t appended;
+    uint32_t replayed;           // acknowledged with store_forward_ack()
+    uint32_t dropped_overwritten; // pending records lost because the ring wrapped onto them
+    uint32_t corrupt;             // records skipped on crc / header errors
+    uint32_t pending;             // stored, not yet replayed
+    uint32_t sectors;
+    uint32_t erases;              // since boot
+} store_forward_stats_t;
+
+/**
+ * @brief Mount the partition and recover the write head / read cursor
+ * @return ESP_ERR_NOT_FOUND if the partition table has no STORE_FORWARD_PARTITION
+ */
+esp_err_t store_forward_init(void);
+
+/**
+ * @brief Append one message (may erase the next sector when the current one is full)
+ */
+esp_err_t store_forward_append(uint8_t msg_class, const char *topic, const char *payload);
+
+/**
+ * @brief Oldest pending record, left in place until store_forward_ack()
+ * @param buf Holds topic and payload, STORE_FORWARD_MAX_RECORD bytes is always enough
+ * @return false if nothing is pending
+ */
+bool store_forward_peek(store_forward_record_t *out, char *buf, uint16_t buf_size);
+
+/**
+ * @brief Mark the record returned by the last peek as sent and move past it
+ */
+esp_err_t store_forward_ack(uint32_t seq);
+
+uint32_t store_forward_pending(void);
+void store_forward_get_stats(store_forward_stats_t *out);
+
+#endif // STORE_FORWARD_H
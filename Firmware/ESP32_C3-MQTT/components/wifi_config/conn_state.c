@@ -0,0 +1,85 @@
+#include "conn_state.h"
+
+wifi_manager_state_t conn_state_next(wifi_manager_state_t state, conn_event_t event)
+{
+    // The portal stays up until the new credentials are saved and the chip restarts
+    if (state == WIFI_STATE_AP_MODE)
+    {
+        return state;
+    }
+
+    switch (event)
+    {
+    case CONN_EVT_PORTAL:
+        return WIFI_STATE_AP_MODE;
+
+    case CONN_EVT_ERROR:
+        return WIFI_STATE_ERROR;
+
+    case CONN_EVT_CONNECTING:
+        // Reconnects from DISCONNECTED stay there, the LED and consumers only care that the link is down
+        return (state == WIFI_STATE_UNINITIALIZED || state == WIFI_STATE_ERROR) ? WIFI_STATE_CONNECTING : state;
+
+    case CONN_EVT_GOT_IP:
+        // DHCP renewals while MQTT is up do not drop the MQTT state
+        return (state == WIFI_STATE_MQTT_CONNECTED) ? state : WIFI_STATE_CONNECTED;
+
+    case CONN_EVT_WIFI_LOST:
+        // During CONNECTING a disconnect is only a failed attempt
+        return (state == WIFI_STATE_CONNECTED || state == WIFI_STATE_MQTT_CONNECTED) ? WIFI_STATE_DISCONNECTED : state;
+
+    case CONN_EVT_MQTT_UP:
+        // A late MQTT event after the link dropped is ignored
+        return (state == WIFI_STATE_CONNECTED || state == WIFI_STATE_ERROR) ? WIFI_STATE_MQTT_CONNECTED : state;
+
+    case CONN_EVT_MQTT_DOWN:
+        return (state == WIFI_STATE_MQTT_CONNECTED) ? WIFI_STATE_CONNECTED : state;
+
+    default:
+        return state;
+    }
+}
+
+uint32_t conn_state_bits(wifi_manager_state_t state)
+{
+    switch (state)
+    {
+    case WIFI_STATE_CONNECTING:
+        return CONN_BIT_CONNECTING;
+    case WIFI_STATE_CONNECTED:
+        return CONN_BIT_CONNECTED | CONN_BIT_IP;
+    case WIFI_STATE_MQTT_CONNECTED:
+        return CONN_BIT_MQTT | CONN_BIT_IP;
+    case WIFI_STATE_AP_MODE:
+        return CONN_BIT_PORTAL;
+    case WIFI_STATE_ERROR:
+        return CONN_BIT_ERROR;
+    case WIFI_STATE_UNINITIALIZED:
+    case WIFI_STATE_DISCONNECTED:
+    default:
+        return CONN_BIT_DOWN;
+    }
+}
+
+const char *conn_state_str(wifi_manager_state_t state)
+{
+    switch (state)
+    {
+    case WIFI_STATE_UNINITIALIZED:
+        return "uninitialized";
+    case WIFI_STATE_CONNECTING:
+        return "connecting";
+    case WIFI_STATE_CONNECTED:
+        return "ip";
+    case WIFI_STATE_AP_MODE:
+        return "portal";
+    case WIFI_STATE_MQTT_CONNECTED:
+        return "mqtt";
+    case WIFI_STATE_ERROR:
+        return "error";
+    case WIFI_STATE_DISCONNECTED:
+        return "wifi_down";
+    default:
+        return "?";
+    }
+}
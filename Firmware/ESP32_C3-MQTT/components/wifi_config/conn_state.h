@@ -0,0 +1,62 @@
+#ifndef CONN_STATE_H
+#define CONN_STATE_H
+
+/*
+ * Gateway connectivity state machine, pure transition logic (no ESP-IDF/FreeRTOS dependency).
+ * wifi_config.c applies the events on the default event loop and mirrors the state into an
+ * event group with conn_state_bits(), tasks block on the bits instead of polling.
+ *
+ *   UNINITIALIZED --CONNECTING--> CONNECTING --GOT_IP--> CONNECTED --MQTT_UP--> MQTT_CONNECTED
+ *                                                           ^   <--MQTT_DOWN--
+ *   CONNECTED / MQTT_CONNECTED --WIFI_LOST--> DISCONNECTED --GOT_IP--^
+ *   any --PORTAL--> AP_MODE (left only by a restart)
+ */
+
+#include <stdint.h>
+
+// Enum to signal the system state to other tasks (like the LED task)
+typedef enum {
+    WIFI_STATE_UNINITIALIZED,
+    WIFI_STATE_CONNECTING,
+    WIFI_STATE_CONNECTED,      // Got IP, MQTT not (yet) connected
+    WIFI_STATE_AP_MODE,
+    WIFI_STATE_MQTT_CONNECTED,
+    WIFI_STATE_ERROR,          // MQTT client could not be started
+    WIFI_STATE_DISCONNECTED,   // Link lost after it was up, reconnecting
+} wifi_manager_state_t;
+
+typedef enum {
+    CONN_EVT_CONNECTING,       // Connect attempt started
+    CONN_EVT_GOT_IP,
+    CONN_EVT_WIFI_LOST,
+    CONN_EVT_MQTT_UP,
+    CONN_EVT_MQTT_DOWN,
+    CONN_EVT_PORTAL,           // Configuration SoftAP started
+    CONN_EVT_ERROR,
+} conn_event_t;
+
+// One-hot state bits, each transition sets a bit that was clear so any state change wakes a waiter
+#define CONN_BIT_DOWN (1u << 0)        // UNINITIALIZED, DISCONNECTED
+#define CONN_BIT_CONNECTING (1u << 1)
+#define CONN_BIT_CONNECTED (1u << 2)   // IP only
+#define CONN_BIT_MQTT (1u << 3)
+#define CONN_BIT_PORTAL (1u << 4)
+#define CONN_BIT_ERROR (1u << 5)
+#define CONN_STATE_BITS (CONN_BIT_DOWN | CONN_BIT_CONNECTING | CONN_BIT_CONNECTED | CONN_BIT_MQTT | CONN_BIT_PORTAL | CONN_BIT_ERROR)
+// Level bit, set together with CONNECTED and MQTT
+#define CONN_BIT_IP (1u << 6)
+#define CONN_ALL_BITS (CONN_STATE_BITS | CONN_BIT_IP)
+
+/**
+ * @brief Next state for an event, events that do not apply leave the state unchanged
+ */
+wifi_manager_state_t conn_state_next(wifi_manager_state_t state, conn_event_t event);
+
+/**
+ * @brief Event group bits mirroring a state
+ */
+uint32_t conn_state_bits(wifi_manager_state_t state);
+
+const char *conn_state_str(wifi_manager_state_t state);
+
+#endif // CONN_STATE_H
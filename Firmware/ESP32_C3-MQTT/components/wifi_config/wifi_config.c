@@ -1,5 +1,6 @@
 #include "wifi_config.h"
 #include "esp_wifi.h"
+#include "esp_mac.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_http_server.h"
@@ -8,57 +9,93 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "wifi_connect_sm.h"
 #include <string.h>
 
 #define TAG "WIFI_MANAGER"
 #define AP_SSID "ESP32_C3_CONFIG"
 #define AP_PASS "12345678"
-#define MAX_WIFI_CREDENTIALS 5
-#define MAX_RETRY_PER_WIFI 3
 
 // NVS keys
 #define NVS_NAMESPACE "wifi_manager"
 #define NVS_KEY_CREDENTIALS "credentials"
-
-// Struct for one WiFi credential
-typedef struct
-{
-    char ssid[33];
-    char password[65];
-} wifi_credential_t;
-
-// Struct to hold all credentials
-typedef struct
-{
-    int count;
-    wifi_credential_t credentials[MAX_WIFI_CREDENTIALS];
-} wifi_credentials_list_t;
+#define NVS_KEY_FAST_CACHE "fast_cache"
 
 static httpd_handle_t server = NULL;
+static httpd_uri_t extra_uris[WIFI_CONFIG_MAX_EXTRA_URIS]; // application handlers, registered on every server start
+static uint8_t extra_uri_count = 0;
 static wifi_connected_cb_t connected_callback = NULL;
 static SemaphoreHandle_t connection_semaphore; // To signal connection success/failure
-static SemaphoreHandle_t state_mutex;          // To protect access to the global state
-static volatile wifi_manager_state_t g_current_state = WIFI_STATE_UNINITIALIZED;
+static EventGroupHandle_t conn_bits;            // CONN_BIT_* mirror of g_current_state, tasks block on it
+static volatile wifi_manager_state_t g_current_state = WIFI_STATE_UNINITIALIZED; // Written on the event loop only
+static volatile bool connect_pending = false;    // Only an attempt in progress consumes connect results
+static volatile bool connect_got_ip = false;
+static wifi_fast_cache_t fast_cache;             // Copy of NVS, rewritten only when the association changes
+static wifi_connect_metrics_t metrics = {.phase = "none"};
+
+ESP_EVENT_DEFINE_BASE(CONN_EVENT);
 
 // --- State Management ---
-void wifi_config_set_state(wifi_manager_state_t state)
+/**
+ * @brief Apply one event, runs on the default event loop task only so transitions are serialized
+ */
+static void conn_apply(conn_event_t event)
 {
-    if (xSemaphoreTake(state_mutex, portMAX_DELAY))
+    wifi_manager_state_t old_state = g_current_state;
+    wifi_manager_state_t new_state = conn_state_next(old_state, event);
+    if (new_state == old_state)
+    {
+        return;
+    }
+
+    g_current_state = new_state;
+    uint32_t bits = conn_state_bits(new_state);
+    xEventGroupClearBits(conn_bits, CONN_ALL_BITS & ~bits);
+    xEventGroupSetBits(conn_bits, bits);
+    ESP_LOGI(TAG, "State %s -> %s", conn_state_str(old_state), conn_state_str(new_state));
+
+    if (new_state == WIFI_STATE_MQTT_CONNECTED && metrics.time_to_mqtt_ms == 0)
     {
-        g_current_state = state;
-        xSemaphoreGive(state_mutex);
+        metrics.time_to_mqtt_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        ESP_LOGI(TAG, "Boot to MQTT %lu ms (IP at %lu ms, %s path, %u attempts)", metrics.time_to_mqtt_ms,
+                 metrics.time_to_ip_ms, metrics.phase, metrics.attempts);
     }
 }
 
-wifi_manager_state_t wifi_config_get_state(void)
+static void conn_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    conn_apply((conn_event_t)event_id);
+}
+
+void wifi_config_notify(conn_event_t event)
 {
-    wifi_manager_state_t current_state = WIFI_STATE_UNINITIALIZED;
-    if (xSemaphoreTake(state_mutex, portMAX_DELAY))
+    if (esp_event_post(CONN_EVENT, event, NULL, 0, pdMS_TO_TICKS(100)) != ESP_OK)
     {
-        current_state = g_current_state;
-        xSemaphoreGive(state_mutex);
+        ESP_LOGE(TAG, "Event loop full, connectivity event %d lost", event);
     }
-    return current_state;
+}
+
+wifi_manager_state_t wifi_config_get_state(void)
+{
+    return g_current_state;
+}
+
+EventBits_t wifi_config_wait(EventBits_t bits, TickType_t ticks_to_wait)
+{
+    return xEventGroupWaitBits(conn_bits, bits, pdFALSE, pdFALSE, ticks_to_wait);
+}
+
+wifi_manager_state_t wifi_config_wait_change(wifi_manager_state_t state, TickType_t ticks_to_wait)
+{
+    xEventGroupWaitBits(conn_bits, CONN_STATE_BITS & ~conn_state_bits(state), pdFALSE, pdFALSE, ticks_to_wait);
+    return g_current_state;
+}
+
+bool wifi_config_mqtt_up(void)
+{
+    return (xEventGroupGetBits(conn_bits) & CONN_BIT_MQTT) != 0;
 }
 
 // --- Foward declarations ---
@@ -177,18 +214,32 @@ static esp_err_t save_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-static httpd_handle_t start_webserver(void)
+/**
+ * @brief Start the HTTP server, the credential pages only in the portal
+ */
+static httpd_handle_t start_webserver(bool portal)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.uri_match_fn = httpd_uri_match_wildcard;
 
+    if (server != NULL)
+    {
+        return server;
+    }
     if (httpd_start(&server, &config) == ESP_OK)
     {
-        httpd_uri_t root_uri = {"/", HTTP_GET, root_handler, NULL};
-        httpd_register_uri_handler(server, &root_uri);
-        httpd_uri_t save_uri = {"/save", HTTP_POST, save_handler, NULL};
-        httpd_register_uri_handler(server, &save_uri);
-        ESP_LOGI(TAG, "HTTP Server started on port 80");
+        if (portal)
+        {
+            httpd_uri_t root_uri = {"/", HTTP_GET, root_handler, NULL};
+            httpd_register_uri_handler(server, &root_uri);
+            httpd_uri_t save_uri = {"/save", HTTP_POST, save_handler, NULL};
+            httpd_register_uri_handler(server, &save_uri);
+        }
+        for (int i = 0; i < extra_uri_count; i++)
+        {
+            httpd_register_uri_handler(server, &extra_uris[i]);
+        }
+        ESP_LOGI(TAG, "HTTP Server started on port 80 (%s)", portal ? "portal" : "station");
         return server;
     }
     ESP_LOGE(TAG, "Failed to start HTTP server");
@@ -198,34 +249,61 @@ static httpd_handle_t start_webserver(void)
 // --- WiFi Logic ---
 static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START)
-    {
-        esp_wifi_connect();
-    }
-    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
     {
         ESP_LOGW(TAG, "Disconnected from WiFi.");
-        // Signal that the connection attempt failed. The connection loop will handle retries.
-        xSemaphoreGive(connection_semaphore);
+        wifi_manager_state_t before = g_current_state;
+        conn_apply(CONN_EVT_WIFI_LOST);
+
+        if (connect_pending)
+        {
+            // Signal that the connection attempt failed. The state machine handles retries.
+            xSemaphoreGive(connection_semaphore);
+        }
+        else if (before == WIFI_STATE_CONNECTED || before == WIFI_STATE_MQTT_CONNECTED)
+        {
+            // Link lost after it was up: reconnect to any AP of this network, the cached BSSID may be gone
+            metrics.link_lost++;
+            wifi_config_t wifi_config;
+            if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) == ESP_OK)
+            {
+                wifi_config.sta.bssid_set = false;
+                wifi_config.sta.channel = 0;
+                esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+            }
+            esp_wifi_connect();
+        }
+        else if (before == WIFI_STATE_DISCONNECTED)
+        {
+            esp_wifi_connect(); // Each failed attempt ends here again, one scan long apart
+        }
     }
     else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
     {
         ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
         ESP_LOGI(TAG, "Got IP address: " IPSTR, IP2STR(&event->ip_info.ip));
-        wifi_config_set_state(WIFI_STATE_CONNECTED);
+        if (metrics.time_to_ip_ms == 0)
+        {
+            metrics.time_to_ip_ms = (uint32_t)(esp_timer_get_time() / 1000);
+        }
+        conn_apply(CONN_EVT_GOT_IP);
         if (connected_callback)
         {
             connected_callback();
         }
         // Signal that the connection was successful
-        xSemaphoreGive(connection_semaphore);
+        if (connect_pending)
+        {
+            connect_got_ip = true;
+            xSemaphoreGive(connection_semaphore);
+        }
     }
 }
 
 static void start_softap_mode(void)
 {
     ESP_LOGI(TAG, "Starting SoftAP mode...");
-    wifi_config_set_state(WIFI_STATE_AP_MODE);
+    wifi_config_notify(CONN_EVT_PORTAL);
 
     esp_netif_t *ap_netif = esp_netif_create_default_wifi_ap();
     if (ap_netif == NULL)
@@ -254,7 +332,132 @@ static void start_softap_mode(void)
     ESP_LOGI(TAG, "SoftAP started. SSID: %s, Password: %s", AP_SSID, AP_PASS);
     ESP_LOGI(TAG, "Connect to this network and navigate to http://192.168.4.1");
 
-    start_webserver();
+    start_webserver(true);
+}
+
+// --- Wi-Fi layer for wifi_connect_sm ---
+static bool sta_connect_op(void *ctx, const wifi_credential_t *cred, const uint8_t *bssid, uint8_t channel,
+                           uint32_t timeout_ms)
+{
+    wifi_config_t wifi_config = {0};
+    strlcpy((char *)wifi_config.sta.ssid, cred->ssid, sizeof(wifi_config.sta.ssid));
+    strlcpy((char *)wifi_config.sta.password, cred->password, sizeof(wifi_config.sta.password));
+    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    wifi_config.sta.scan_method = WIFI_FAST_SCAN; // With a channel set only that channel is probed
+    wifi_config.sta.channel = channel;
+    if (bssid != NULL)
+    {
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, bssid, sizeof(wifi_config.sta.bssid));
+        ESP_LOGI(TAG, "Trying to connect to SSID: '%s' (" MACSTR ", ch %u)", cred->ssid, MAC2STR(bssid), channel);
+    }
+    else
+    {
+        ESP_LOGI(TAG, "Trying to connect to SSID: '%s'", cred->ssid);
+    }
+
+    wifi_config_notify(CONN_EVT_CONNECTING);
+    xSemaphoreTake(connection_semaphore, 0); // Drop a result left over from the previous attempt
+    connect_got_ip = false;
+    connect_pending = true;
+
+    bool connected = false;
+    if (esp_wifi_set_config(WIFI_IF_STA, &wifi_config) == ESP_OK && esp_wifi_connect() == ESP_OK)
+    {
+        if (xSemaphoreTake(connection_semaphore, pdMS_TO_TICKS(timeout_ms)) == pdTRUE)
+        {
+            connected = connect_got_ip;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Connection attempt to '%s' timed out.", cred->ssid);
+        }
+    }
+    connect_pending = false;
+
+    if (!connected)
+    {
+        ESP_LOGW(TAG, "Failed to connect to '%s'.", cred->ssid);
+        esp_wifi_disconnect();
+    }
+    return connected;
+}
+
+static int sta_scan_op(void *ctx, wifi_scan_ap_t *aps, int max)
+{
+    static wifi_ap_record_t records[WIFI_SM_MAX_SCAN_APS]; // ~1.6 KB, kept off the main task stack
+    uint16_t n = max < WIFI_SM_MAX_SCAN_APS ? max : WIFI_SM_MAX_SCAN_APS;
+    int64_t start = esp_timer_get_time();
+
+    wifi_scan_config_t scan_config = {0};
+    if (esp_wifi_scan_start(&scan_config, true) != ESP_OK || esp_wifi_scan_get_ap_records(&n, records) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Scan failed, trying saved networks blind");
+        return 0;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        strlcpy(aps[i].ssid, (const char *)records[i].ssid, sizeof(aps[i].ssid));
+        memcpy(aps[i].bssid, records[i].bssid, sizeof(aps[i].bssid));
+        aps[i].channel = records[i].primary;
+        aps[i].rssi = records[i].rssi;
+    }
+    metrics.scan_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+    ESP_LOGI(TAG, "Scan found %u APs in %lu ms", n, metrics.scan_ms);
+    return n;
+}
+
+static void load_fast_cache(void)
+{
+    nvs_handle_t nvs_handle;
+    size_t size = sizeof(fast_cache);
+
+    memset(&fast_cache, 0, sizeof(fast_cache));
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK)
+    {
+        return;
+    }
+    if (nvs_get_blob(nvs_handle, NVS_KEY_FAST_CACHE, &fast_cache, &size) != ESP_OK || size != sizeof(fast_cache))
+    {
+        memset(&fast_cache, 0, sizeof(fast_cache));
+    }
+    nvs_close(nvs_handle);
+}
+
+/**
+ * @brief Remember the AP we just associated with, written only when it changed (flash wear)
+ */
+static void save_fast_cache(const wifi_credential_t *cred)
+{
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK)
+    {
+        return;
+    }
+
+    wifi_fast_cache_t cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.version = WIFI_SM_CACHE_VERSION;
+    cache.channel = ap.primary;
+    memcpy(cache.bssid, ap.bssid, sizeof(cache.bssid));
+    strlcpy(cache.ssid, cred->ssid, sizeof(cache.ssid));
+    if (memcmp(&cache, &fast_cache, sizeof(cache)) == 0)
+    {
+        return;
+    }
+
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK)
+    {
+        return;
+    }
+    if (nvs_set_blob(nvs_handle, NVS_KEY_FAST_CACHE, &cache, sizeof(cache)) == ESP_OK && nvs_commit(nvs_handle) == ESP_OK)
+    {
+        fast_cache = cache;
+        ESP_LOGI(TAG, "Cached '%s' " MACSTR " ch %u for the next boot", cache.ssid, MAC2STR(cache.bssid), cache.channel);
+    }
+    nvs_close(nvs_handle);
 }
 
 static void try_connect_all_saved_wifi(void)
@@ -283,6 +486,7 @@ static void try_connect_all_saved_wifi(void)
     }
 
     ESP_LOGI(TAG, "Found %d saved WiFi credentials. Trying to connect...", creds_list.count);
+    load_fast_cache();
 
     esp_netif_t *sta_netif = esp_netif_create_default_wifi_sta();
     if (sta_netif == NULL)
@@ -292,44 +496,33 @@ static void try_connect_all_saved_wifi(void)
         return;
     }
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_start());
 
-    // Loop through all saved credentials
-    for (int i = 0; i < creds_list.count; i++)
-    {
-        wifi_credential_t *cred = &creds_list.credentials[i];
-        ESP_LOGI(TAG, "Trying to connect to SSID: '%s'", cred->ssid);
-
-        wifi_config_t wifi_config = {0};
-        strcpy((char *)wifi_config.sta.ssid, cred->ssid);
-        strcpy((char *)wifi_config.sta.password, cred->password);
-        wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    // Cached BSSID/channel first, then one scan and the saved networks by RSSI
+    const wifi_connect_ops_t ops = {
+        .connect = sta_connect_op,
+        .scan = sta_scan_op,
+        .ctx = NULL,
+    };
+    wifi_connect_result_t result;
+    int64_t start = esp_timer_get_time();
+    bool connected = wifi_sm_run(&ops, &creds_list, &fast_cache, &result);
 
-        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    metrics.connect_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+    metrics.attempts = result.attempts;
+    metrics.scan_count = result.scan_count;
+    metrics.phase = wifi_sm_phase_str(result.phase);
 
-        // Try to connect to this specific network with retries
-        for (int retry = 0; retry < MAX_RETRY_PER_WIFI; retry++)
+    if (connected)
+    {
+        ESP_LOGI(TAG, "Successfully connected to '%s' in %lu ms (%s path, %u attempts)!",
+                 creds_list.credentials[result.cred_index].ssid, metrics.connect_ms, metrics.phase, result.attempts);
+        save_fast_cache(&creds_list.credentials[result.cred_index]);
+        if (extra_uri_count > 0)
         {
-            wifi_config_set_state(WIFI_STATE_CONNECTING);
-            ESP_ERROR_CHECK(esp_wifi_start());
-
-            // Wait for connection result (success or disconnect event)
-            if (xSemaphoreTake(connection_semaphore, pdMS_TO_TICKS(15000)) == pdTRUE)
-            { // 15s timeout
-                if (wifi_config_get_state() == WIFI_STATE_CONNECTED)
-                {
-                    ESP_LOGI(TAG, "Successfully connected to '%s'!", cred->ssid);
-                    return; // Exit function on success
-                }
-            }
-            else
-            {
-                ESP_LOGW(TAG, "Connection attempt to '%s' timed out.", cred->ssid);
-            }
-
-            ESP_LOGW(TAG, "Failed to connect to '%s' (attempt %d/%d).", cred->ssid, retry + 1, MAX_RETRY_PER_WIFI);
-            esp_wifi_stop(); // Stop wifi before next attempt
-            vTaskDelay(pdMS_TO_TICKS(1000));
+            start_webserver(false);
         }
+        return;
     }
 
     // If we get here, all credentials failed
@@ -344,8 +537,8 @@ esp_err_t wifi_config_start(wifi_connected_cb_t callback)
 {
     connected_callback = callback;
     connection_semaphore = xSemaphoreCreateBinary();
-    state_mutex = xSemaphoreCreateMutex();
-    wifi_config_set_state(WIFI_STATE_UNINITIALIZED);
+    conn_bits = xEventGroupCreate();
+    xEventGroupSetBits(conn_bits, conn_state_bits(WIFI_STATE_UNINITIALIZED));
 
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
@@ -364,6 +557,7 @@ esp_err_t wifi_config_start(wifi_connected_cb_t callback)
     // Register event handlers
     ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL));
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_register(CONN_EVENT, ESP_EVENT_ANY_ID, &conn_event_handler, NULL));
 
     try_connect_all_saved_wifi();
 
@@ -379,6 +573,7 @@ esp_err_t wifi_config_reset(void)
         ESP_LOGE(TAG, "Error opening NVS handle to erase: %s", esp_err_to_name(err));
         return err;
     }
+    nvs_erase_key(nvs_handle, NVS_KEY_FAST_CACHE);
     err = nvs_erase_key(nvs_handle, NVS_KEY_CREDENTIALS);
     if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
     {
@@ -393,3 +588,19 @@ esp_err_t wifi_config_reset(void)
     nvs_close(nvs_handle);
     return err;
 }
+
+void wifi_config_get_metrics(wifi_connect_metrics_t *out)
+{
+    *out = metrics; // Written while connecting at boot, link_lost on the event loop
+}
+
+esp_err_t wifi_config_register_uri(const httpd_uri_t *uri)
+{
+    if (extra_uri_count >= WIFI_CONFIG_MAX_EXTRA_URIS)
+    {
+        ESP_LOGE(TAG, "No room for URI %s", uri->uri);
+        return ESP_ERR_NO_MEM;
+    }
+    extra_uris[extra_uri_count++] = *uri;
+    return server != NULL ? httpd_register_uri_handler(server, uri) : ESP_OK;
+}
@@ -1,25 +1,39 @@
 #ifndef WIFI_CONFIG_H
 #define WIFI_CONFIG_H
 
+#include <stdint.h>
+#include <stdbool.h>
 #include "esp_err.h"
+#include "esp_event.h"
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "conn_state.h"
+
+#define WIFI_CONFIG_MAX_EXTRA_URIS 4 // application pages (e.g. /metrics), served in portal and station mode
 
 // Define a callback type for when WiFi connects successfully
 typedef void (*wifi_connected_cb_t)(void);
 
-// Enum to signal the system state to other tasks (like the LED task)
-typedef enum {
-    WIFI_STATE_UNINITIALIZED,
-    WIFI_STATE_CONNECTING,
-    WIFI_STATE_CONNECTED,
-    WIFI_STATE_AP_MODE,
-    WIFI_STATE_MQTT_CONNECTED, // Added for LED logic
-    WIFI_STATE_ERROR
-} wifi_manager_state_t;
+ESP_EVENT_DECLARE_BASE(CONN_EVENT); // event id = conn_event_t, posted with wifi_config_notify()
+
+// Boot connection timings, milliseconds since boot (esp_timer), 0 = not reached yet
+typedef struct {
+    uint32_t time_to_ip_ms;
+    uint32_t time_to_mqtt_ms;  // First WIFI_STATE_MQTT_CONNECTED
+    uint32_t connect_ms;       // Connect state machine alone (cache/scan/attempts)
+    uint32_t scan_ms;          // 0 if the cached BSSID worked and no scan was needed
+    uint8_t attempts;
+    uint8_t scan_count;        // APs seen by the scan
+    const char *phase;         // "fast", "ranked", "hidden" or "failed"
+    uint32_t link_lost;        // Drops after the link was up (updated at runtime, not only at boot)
+} wifi_connect_metrics_t;
 
 /**
  * @brief Starts the WiFi manager.
  *
- * This function attempts to connect to any of the saved WiFi networks.
+ * This function first tries the last successful network directly on its cached BSSID and channel,
+ * then does one scan and tries the saved networks ordered by signal strength.
  * If no networks are saved, or if it fails to connect to all saved networks,
  * it will start an Access Point (AP) mode to allow for configuration.
  *
@@ -31,21 +45,64 @@ esp_err_t wifi_config_start(wifi_connected_cb_t callback);
 /**
  * @brief Gets the current state of the WiFi manager.
  *
- * This is used to signal the status to other parts of the application,
- * for example, to control an LED.
+ * Prefer wifi_config_wait() / wifi_config_wait_change() over polling this.
  *
  * @return wifi_manager_state_t The current state.
  */
 wifi_manager_state_t wifi_config_get_state(void);
 
 /**
- * @brief Sets the current state of the WiFi manager.
+ * @brief Feeds an event to the connectivity state machine.
+ *
+ * Events are applied in order on the default event loop, together with the WiFi and IP events,
+ * so no lock is taken by the caller. Used for the MQTT up/down and error events.
+ *
+ * @param event The event.
+ */
+void wifi_config_notify(conn_event_t event);
+
+/**
+ * @brief Blocks until any of the given CONN_BIT_* bits is set.
+ *
+ * @param bits CONN_BIT_* mask.
+ * @param ticks_to_wait Max wait.
+ * @return EventBits_t The event group bits when returning (check them on timeout).
+ */
+EventBits_t wifi_config_wait(EventBits_t bits, TickType_t ticks_to_wait);
+
+/**
+ * @brief Blocks until the state bit changes from the one of the given state (or the timeout expires).
+ *
+ * UNINITIALIZED and DISCONNECTED share CONN_BIT_DOWN and count as the same state here.
+ *
+ * @param state State the caller last acted on.
+ * @param ticks_to_wait Max wait.
+ * @return wifi_manager_state_t The current state.
+ */
+wifi_manager_state_t wifi_config_wait_change(wifi_manager_state_t state, TickType_t ticks_to_wait);
+
+/**
+ * @brief True while connected to the MQTT broker (event group read, never blocks).
+ */
+bool wifi_config_mqtt_up(void);
+
+/**
+ * @brief Copies the boot connection timings (time-to-IP, time-to-MQTT and how the link was found).
+ *
+ * @param out Destination.
+ */
+void wifi_config_get_metrics(wifi_connect_metrics_t *out);
+
+/**
+ * @brief Adds an application URI handler to the HTTP server.
  *
- * This function is thread-safe.
+ * The credential pages exist only in the SoftAP portal, these handlers are also served on the
+ * station interface once connected. Call before wifi_config_start(), or any time after.
  *
- * @param state The new state to set.
+ * @param uri Handler, copied.
+ * @return esp_err_t ESP_ERR_NO_MEM if WIFI_CONFIG_MAX_EXTRA_URIS are already registered.
  */
-void wifi_config_set_state(wifi_manager_state_t state);
+esp_err_t wifi_config_register_uri(const httpd_uri_t *uri);
 
 /**
  * @brief Deletes all saved WiFi credentials from NVS.
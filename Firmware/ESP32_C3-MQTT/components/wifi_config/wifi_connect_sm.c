@@ -0,0 +1,165 @@
+#include "wifi_connect_sm.h"
+#include <string.h>
+
+static int find_credential(const wifi_credentials_list_t *creds, const char *ssid)
+{
+    for (int i = 0; i < creds->count; i++)
+    {
+        if (strncmp(creds->credentials[i].ssid, ssid, sizeof(creds->credentials[i].ssid)) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool try_connect(const wifi_connect_ops_t *ops, const wifi_credentials_list_t *creds, int index,
+                        const uint8_t *bssid, uint8_t channel, uint32_t timeout_ms, wifi_connect_result_t *result)
+{
+    result->attempts++;
+    if (ops->connect(ops->ctx, &creds->credentials[index], bssid, channel, timeout_ms))
+    {
+        result->cred_index = (int8_t)index;
+        return true;
+    }
+    return false;
+}
+
+int wifi_sm_rank(const wifi_credential_t *creds, int count, const wifi_scan_ap_t *aps, int n_aps,
+                 wifi_candidate_t *out)
+{
+    int n = 0;
+
+    for (int c = 0; c < count; c++)
+    {
+        int best = -1;
+        for (int a = 0; a < n_aps; a++)
+        {
+            if (strncmp(aps[a].ssid, creds[c].ssid, sizeof(aps[a].ssid)) == 0 &&
+                (best < 0 || aps[a].rssi > aps[best].rssi))
+            {
+                best = a;
+            }
+        }
+        if (best < 0)
+        {
+            continue;
+        }
+
+        // Insertion sort, stable so equal RSSI keeps the saved (most recent first) order
+        int pos = n;
+        while (pos > 0 && out[pos - 1].rssi < aps[best].rssi)
+        {
+            out[pos] = out[pos - 1];
+            pos--;
+        }
+        out[pos].cred_index = (int8_t)c;
+        out[pos].rssi = aps[best].rssi;
+        out[pos].channel = aps[best].channel;
+        memcpy(out[pos].bssid, aps[best].bssid, sizeof(out[pos].bssid));
+        n++;
+    }
+    return n;
+}
+
+bool wifi_sm_run(const wifi_connect_ops_t *ops, const wifi_credentials_list_t *creds, const wifi_fast_cache_t *cache,
+                 wifi_connect_result_t *result)
+{
+    wifi_scan_ap_t aps[WIFI_SM_MAX_SCAN_APS];
+    wifi_candidate_t ranked[MAX_WIFI_CREDENTIALS];
+    int n_ranked = 0;
+    int count = creds->count > MAX_WIFI_CREDENTIALS ? MAX_WIFI_CREDENTIALS : creds->count;
+
+    memset(result, 0, sizeof(*result));
+    result->cred_index = -1;
+    result->phase = WIFI_SM_FAST;
+
+    while (result->phase != WIFI_SM_DONE && result->phase != WIFI_SM_FAILED)
+    {
+        switch (result->phase)
+        {
+        case WIFI_SM_FAST:
+        {
+            int index = -1;
+            if (cache != NULL && cache->version == WIFI_SM_CACHE_VERSION && cache->channel >= 1 && cache->channel <= 14)
+            {
+                index = find_credential(creds, cache->ssid);
+            }
+            if (index >= 0 && try_connect(ops, creds, index, cache->bssid, cache->channel, WIFI_SM_FAST_TIMEOUT_MS, result))
+            {
+                return true; // phase stays FAST
+            }
+            result->phase = WIFI_SM_SCAN;
+            break;
+        }
+
+        case WIFI_SM_SCAN:
+        {
+            int n_aps = ops->scan(ops->ctx, aps, WIFI_SM_MAX_SCAN_APS);
+            if (n_aps < 0)
+            {
+                n_aps = 0;
+            }
+            result->scan_count = (uint8_t)n_aps;
+            n_ranked = wifi_sm_rank(creds->credentials, count, aps, n_aps, ranked);
+            result->phase = WIFI_SM_RANKED;
+            break;
+        }
+
+        case WIFI_SM_RANKED:
+            for (int i = 0; i < n_ranked; i++)
+            {
+                for (int retry = 0; retry < WIFI_SM_RETRY_PER_WIFI; retry++)
+                {
+                    if (try_connect(ops, creds, ranked[i].cred_index, ranked[i].bssid, ranked[i].channel,
+                                    WIFI_SM_CONNECT_TIMEOUT_MS, result))
+                    {
+                        return true;
+                    }
+                }
+            }
+            result->phase = WIFI_SM_HIDDEN;
+            break;
+
+        case WIFI_SM_HIDDEN:
+            for (int c = 0; c < count; c++)
+            {
+                bool seen = false;
+                for (int i = 0; i < n_ranked; i++)
+                {
+                    seen |= ranked[i].cred_index == c;
+                }
+                if (!seen && try_connect(ops, creds, c, NULL, 0, WIFI_SM_CONNECT_TIMEOUT_MS, result))
+                {
+                    return true;
+                }
+            }
+            result->phase = WIFI_SM_FAILED;
+            break;
+
+        default:
+            result->phase = WIFI_SM_FAILED;
+            break;
+        }
+    }
+    return false;
+}
+
+const char *wifi_sm_phase_str(wifi_sm_phase_t phase)
+{
+    switch (phase)
+    {
+    case WIFI_SM_FAST:
+        return "fast";
+    case WIFI_SM_SCAN:
+        return "scan";
+    case WIFI_SM_RANKED:
+        return "ranked";
+    case WIFI_SM_HIDDEN:
+        return "hidden";
+    case WIFI_SM_DONE:
+        return "done";
+    default:
+        return "failed";
+    }
+}
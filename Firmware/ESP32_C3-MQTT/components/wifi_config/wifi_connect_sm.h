@@ -0,0 +1,117 @@
+#ifndef WIFI_CONNECT_SM_H
+#define WIFI_CONNECT_SM_H
+
+/*
+ * Station connect state machine, without any ESP-IDF dependency so it can run on the host
+ * against a stubbed Wi-Fi layer (wifi_connect_ops_t).
+ *
+ *   FAST   : last good credential, BSSID and channel from NVS, one direct connect (no scan)
+ *   SCAN   : one active scan of all channels
+ *   RANKED : saved credentials seen in the scan, strongest RSSI first, pinned to that BSSID/channel
+ *   HIDDEN : saved credentials not seen in the scan (hidden SSID), one plain attempt each
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_WIFI_CREDENTIALS 5
+#define WIFI_SM_MAX_SCAN_APS 20
+#define WIFI_SM_FAST_TIMEOUT_MS 4000   // Direct connect to a known BSSID normally takes < 1 s
+#define WIFI_SM_CONNECT_TIMEOUT_MS 10000
+#define WIFI_SM_RETRY_PER_WIFI 2       // Attempts per credential seen in the scan
+#define WIFI_SM_CACHE_VERSION 1
+
+// Struct for one WiFi credential
+typedef struct
+{
+    char ssid[33];
+    char password[65];
+} wifi_credential_t;
+
+// Struct to hold all credentials
+typedef struct
+{
+    int count;
+    wifi_credential_t credentials[MAX_WIFI_CREDENTIALS];
+} wifi_credentials_list_t;
+
+// Last successful association, kept in NVS
+typedef struct
+{
+    uint8_t version; // WIFI_SM_CACHE_VERSION, anything else = no cache
+    uint8_t channel;
+    uint8_t bssid[6];
+    char ssid[33];   // Matched against the credential list, the index can shift when a network is added
+} wifi_fast_cache_t;
+
+typedef struct
+{
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    int8_t rssi;
+} wifi_scan_ap_t;
+
+typedef enum
+{
+    WIFI_SM_FAST,
+    WIFI_SM_SCAN,
+    WIFI_SM_RANKED,
+    WIFI_SM_HIDDEN,
+    WIFI_SM_DONE,
+    WIFI_SM_FAILED,
+} wifi_sm_phase_t;
+
+// Wi-Fi layer, the ESP-IDF one lives in wifi_config.c
+typedef struct
+{
+    /**
+     * @brief Associate and wait for an IP address
+     * @param bssid NULL = any AP with this SSID
+     * @param channel 0 = all channels
+     * @return true once an IP address was obtained
+     */
+    bool (*connect)(void *ctx, const wifi_credential_t *cred, const uint8_t *bssid, uint8_t channel, uint32_t timeout_ms);
+    /**
+     * @brief One blocking scan
+     * @return Number of records written to aps (<= max)
+     */
+    int (*scan)(void *ctx, wifi_scan_ap_t *aps, int max);
+    void *ctx;
+} wifi_connect_ops_t;
+
+typedef struct
+{
+    int8_t cred_index;
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t bssid[6];
+} wifi_candidate_t;
+
+typedef struct
+{
+    wifi_sm_phase_t phase;       // Phase that connected, or WIFI_SM_FAILED
+    int8_t cred_index;           // -1 when nothing connected
+    uint8_t attempts;            // connect() calls
+    uint8_t scan_count;          // APs returned by the scan (0 if the fast path worked)
+} wifi_connect_result_t;
+
+/**
+ * @brief Rank saved credentials against a scan, strongest first
+ * @details Each credential keeps only its strongest AP, credentials not seen are left out.
+ * @return Number of candidates written to out (<= count)
+ */
+int wifi_sm_rank(const wifi_credential_t *creds, int count, const wifi_scan_ap_t *aps, int n_aps,
+                 wifi_candidate_t *out);
+
+/**
+ * @brief Run FAST -> SCAN -> RANKED -> HIDDEN until one credential gets an IP address
+ * @param cache Last good association, NULL or wrong version skips the fast path
+ * @return true if connected, details in result
+ */
+bool wifi_sm_run(const wifi_connect_ops_t *ops, const wifi_credentials_list_t *creds, const wifi_fast_cache_t *cache,
+                 wifi_connect_result_t *result);
+
+const char *wifi_sm_phase_str(wifi_sm_phase_t phase);
+
+#endif // WIFI_CONNECT_SM_H
@@ -13,14 +13,79 @@
 
 // UART config
 #define UART_BAUD_RATE 115200
+#define UART_INTEGRITY_MODE INTEGRITY_CRC16 // check used on frames we send (receiver follows the type flag)
+#define UART_CONTROL_SEND_TIMEOUT_MS 1000   // max wait for a free ARQ window slot when sending a command
+
+// MQTT publish classes, each with its own QoS / retain
+typedef enum
+{
+    MQTT_CLASS_TELEMETRY = 0, // sensor readings, batched
+    MQTT_CLASS_CONTROL_ACK,   // control command forwarded to the master
+    MQTT_CLASS_ALERT,         // control command that could not be delivered
+    MQTT_CLASS_COUNT
+} mqtt_msg_class_t;
+
+#define MQTT_TELEMETRY_QOS 0 // next reading supersedes a lost one, no PUBACK round trip
+#define MQTT_TELEMETRY_RETAIN 0
+#define MQTT_CONTROL_ACK_QOS 1
+#define MQTT_CONTROL_ACK_RETAIN 0
+#define MQTT_ALERT_QOS 1
+#define MQTT_ALERT_RETAIN 1
+
+// Wire encoding per class. JSON stays the internal format (queue, batch, flash backlog), CBOR is
+// transcoded at publish time and goes to <topic>MQTT_CBOR_TOPIC_SUFFIX (MQTT 3.1.1 has no content type)
+typedef enum
+{
+    MQTT_ENCODING_JSON = 0,
+    MQTT_ENCODING_CBOR, // RFC 8949, member names from the key dictionary in main.c as small integers
+} mqtt_encoding_t;
+
+#define MQTT_TELEMETRY_ENCODING MQTT_ENCODING_JSON
+#define MQTT_CONTROL_ACK_ENCODING MQTT_ENCODING_JSON
+#define MQTT_ALERT_ENCODING MQTT_ENCODING_JSON
+#define MQTT_CBOR_TOPIC_SUFFIX "/cbor"
+#define MQTT_CBOR_MAX_TOKENS 160 // JSON values + keys of the largest message transcoded (a full batch is ~115)
+
+// Telemetry batching
+#define MQTT_BATCH_MAX_ITEMS 8     // readings per publish, 1 = publish each reading as before
+#define MQTT_BATCH_FLUSH_MS 1000   // max age of the oldest reading in a batch
+#define MQTT_BATCH_MAX_BYTES 1024  // payload cap of one batch
+#define MQTT_OUTBOX_LIMIT 8192     // bytes of unacked QoS>0 messages kept by the client
+#define MQTT_OUTBOX_WAIT_MS 50     // publisher polls the outbox at this period while it is full
+
+// Broker connection. TLS uses the ESP x509 certificate bundle (my_mqtt ca_cert_pem for a private CA).
+#define MQTT_USE_TLS 0
+#if MQTT_USE_TLS
+#define MQTT_BROKER_URI "mqtts://broker.emqx.io:8883"
+#else
+#define MQTT_BROKER_URI "mqtt://broker.emqx.io"
+#endif
+#define MQTT_TLS_RESUME 1         // reconnects resume the TLS session (ticket in RAM), abbreviated handshake
+#define MQTT_PERSISTENT_SESSION 1 // clean_session = 0: no resubscribe on reconnect, QoS1 in flight is resumed
+
+// Loopback benchmark: 1 = MQTT goes to the in-process broker (mqtt_loopback) and a bench task measures
+// UART-side telemetry -> publish and control request -> reply latency. WiFi still has to come up, publishing
+// is gated on the connectivity state.
+#define MQTT_LOOPBACK_BENCH 0
+#define MQTT_LOOPBACK_BENCH_COUNT 200        // samples per measurement
+#define MQTT_LOOPBACK_BENCH_TIMEOUT_MS 2000  // per closed-loop request
+
+// Per-node topics (topic_router.h): <root>/node<N>/<sensor> telemetry, control routes in app_main.
+// The ESP-NOW nodes have no plug outputs, so there are no per-node plug routes.
+#define TOPIC_ROOT "home"
+#define MQTT_SENSOR_TOPICS 1 // 1 = also publish each reading on its sensor topic (QoS/retain of telemetry)
+
+// Store-and-forward (flash backlog while WiFi / MQTT is down)
+#define STORE_REPLAY_INTERVAL_MS 100 // one stored message per period after reconnect, live data first
 
 // Queues
+#define JSON_QUEUE_LEN 10
+#define MQTT_CONNECT_TIMEOUT_MS 30000 // app tasks start anyway after this, messages go to flash meanwhile
 extern QueueHandle_t json_queue;
 extern QueueHandle_t mqtt_rx_queue;
 
 // Global variables
 extern my_mqtt_init_t mqtt_cfg;
-extern Frame_Message mess;
 
 // Task tags
 extern const char *UART_TAG;
@@ -0,0 +1,35 @@
+#ifndef GATEWAY_METRICS_H
+#define GATEWAY_METRICS_H
+
+#include <stdint.h>
+#include "metrics.h"
+#include "define.h"
+
+/*
+ * Gateway pipeline metrics, served at /metrics (Prometheus text) by the wifi_config httpd.
+ * Counters below are updated in place with metric_inc / metric_observe; UART, ARQ, queue, heap
+ * and connection figures that already exist elsewhere are read only when scraped.
+ */
+
+// ============ STRUCTURES ============
+typedef struct
+{
+    uint32_t published[MQTT_CLASS_COUNT]; // taken by the MQTT client (or loopback broker)
+    uint32_t stored;                      // went to flash while offline
+    uint32_t dropped_offline;             // offline and no room in flash
+    uint32_t dropped_queue_full;          // json_queue full, producer gave up
+    uint32_t mqtt_disconnects;
+    metric_histogram_t queue_wait_ms;     // produced -> taken by the publisher task (tick resolution)
+    metric_histogram_t publish_us;        // one my_mqtt publish call
+} gateway_metrics_t;
+
+extern gateway_metrics_t gw_metrics;
+
+// ============ API ============
+/**
+ * @brief Install the metric table and add GET /metrics to the wifi_config HTTP server
+ * @details Call before wifi_config_start() so the station server is started with it
+ */
+void gateway_metrics_init(void);
+
+#endif // GATEWAY_METRICS_H
@@ -0,0 +1,63 @@
+#ifndef __MQTT_BATCH_H__
+#define __MQTT_BATCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Telemetry readings coalesced into one publish per topic:
+ *   {"type":"telemetry","batch":[{"dt":0,"data":{..}},{"dt":120,"data":{..}},..],"age_ms":830}
+ * dt = reading time relative to the first reading of the batch, age_ms = age of the first reading at publish.
+ * A batch is published when the topic changes, the next reading does not fit, max_items is reached or
+ * the first reading is max_age_ms old. Times are in ms of a free running counter (wrap-around safe).
+ */
+
+// ============ CONFIG ============
+#define MQTT_BATCH_TOPIC_LEN 64 // same as mqtt_message_t.topic
+#define MQTT_BATCH_NEVER UINT32_MAX
+
+// ============ STRUCTURES ============
+// Called with the finished payload, valid during the call only
+typedef void (*mqtt_batch_publish_t)(const char *topic, const char *payload);
+
+typedef struct
+{
+    char *buf;                   // payload buffer, kept by pointer
+    uint16_t size;               // its size, caps one batch
+    uint8_t max_items;
+    uint32_t max_age_ms;
+    mqtt_batch_publish_t publish;
+} mqtt_batch_config_t;
+
+typedef struct
+{
+    mqtt_batch_config_t cfg;
+    uint16_t len;
+    uint8_t count;
+    uint32_t first_ms; // stamp of the first reading
+    char topic[MQTT_BATCH_TOPIC_LEN];
+} mqtt_batch_t;
+
+// ============ API ============
+void mqtt_batch_init(mqtt_batch_t *b, const mqtt_batch_config_t *cfg);
+
+/**
+ * @brief Append one reading, publishing the pending batch first when the topic changes or it does not fit
+ * @param data JSON value of the reading
+ * @param stamp_ms When the reading was taken (sets dt)
+ * @param now_ms For age_ms of a batch published during the call
+ * @return false if the reading alone does not fit a batch (dropped)
+ */
+bool mqtt_batch_add(mqtt_batch_t *b, const char *topic, const char *data, uint32_t stamp_ms, uint32_t now_ms);
+
+/**
+ * @brief Publish the pending batch, if any
+ */
+void mqtt_batch_flush(mqtt_batch_t *b, uint32_t now_ms);
+
+/**
+ * @brief Time until the pending batch is due, 0 if it is, MQTT_BATCH_NEVER if there is none
+ */
+uint32_t mqtt_batch_due_in_ms(const mqtt_batch_t *b, uint32_t now_ms);
+
+#endif // __MQTT_BATCH_H__
@@ -0,0 +1,94 @@
+#ifndef __TOPIC_ROUTER_H__
+#define __TOPIC_ROUTER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Per-node MQTT topics, built once at init:
+ *   telemetry  <root>/node<N>/<sensor>   (N = node id from the UART data frame, 0 = aggregate frame)
+ *   control    <root>/gateway/report/set|get, plus the legacy JSON topic
+ * Incoming topics are matched against a trie compiled from the route filters ('+' and '#' wildcards,
+ * MQTT semantics), each route maps straight to an action and its node / plug fields.
+ */
+
+// ============ CONFIG ============
+#define TOPIC_MAX_NODES 11        // node ids 0..10 (master MAX_SLAVES = 10)
+#define TOPIC_MAX_LEN 48
+#define TOPIC_TRIE_MAX_NODES 32   // trie nodes over all route filters
+#define TOPIC_MAX_ROUTES 8
+#define TOPIC_MAX_CAPTURES 4      // '+' levels per filter
+
+// ============ ENUMS ============
+typedef enum
+{
+    TOPIC_SENSOR_LUX = 0,
+    TOPIC_SENSOR_TEMP,
+    TOPIC_SENSOR_HUMI,
+    TOPIC_SENSOR_COUNT
+} topic_sensor_t;
+
+typedef enum
+{
+    TOPIC_ACTION_JSON_CONTROL = 0, // {"type":"control","data":{"plug":"plug_N","status":"on"}}, master plugs
+    TOPIC_ACTION_REPORT_SET,       // report policy update (JSON, only the members given)
+    TOPIC_ACTION_REPORT_GET,       // report policy and its counters, payload ignored
+} topic_action_t;
+
+// Route field taken from the i-th '+' level of the filter (its trailing decimal number, "node2" -> 2)
+#define TOPIC_FROM_CAPTURE(i) (-1 - (i))
+
+// ============ STRUCTURES ============
+typedef struct
+{
+    const char *filter; // kept by pointer, must stay valid
+    topic_action_t action;
+    int8_t node;        // >= 0 fixed, TOPIC_FROM_CAPTURE(i) from the topic
+    int8_t plug;        // 1-based like the topics, same encoding
+} topic_route_t;
+
+typedef struct
+{
+    topic_action_t action;
+    uint8_t node;       // 0 = master
+    uint8_t plug;       // 1-based, 0 if the route has none
+} topic_match_t;
+
+// ============ API ============
+/**
+ * @brief Build the telemetry topic table and an empty trie
+ * @param root First topic level, e.g. "home"
+ */
+void topic_router_init(const char *root);
+
+/**
+ * @brief Compile a route filter into the trie (init time only)
+ * @return false if the filter is malformed or the trie / route table is full
+ */
+bool topic_router_add(const topic_route_t *route);
+
+/**
+ * @brief Precomputed telemetry topic, no formatting at publish time
+ * @return NULL if node is out of range
+ */
+const char *topic_router_sensor_topic(uint8_t node, topic_sensor_t sensor);
+
+/**
+ * @brief Match a received topic (not NUL terminated) against the compiled filters
+ * @details Exact levels win over '+', '+' over '#'; captured numbers fill the route fields.
+ * @return true if a route matched and its captures are valid numbers
+ */
+bool topic_router_match(const char *topic, int topic_len, topic_match_t *out);
+
+/**
+ * @brief Number of compiled routes, filters returned by topic_router_filter() are what to subscribe to
+ */
+int topic_router_route_count(void);
+const char *topic_router_filter(int index);
+
+/**
+ * @brief true if another route filter already matches every topic of this one (no need to subscribe to it)
+ */
+bool topic_router_filter_covered(int index);
+
+#endif // __TOPIC_ROUTER_H__
@@ -0,0 +1,110 @@
+#ifndef __UART_LINK_H__
+#define __UART_LINK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "message.h"
+
+// ============ CONFIG ============
+#define UART_LINK_BASE_BAUD 115200        // Rate both ends boot at and fall back to
+#define UART_LINK_TEST_FRAMES 32          // Test frames sent per probed rate
+#define UART_LINK_TEST_PATTERN_LEN 64     // Pattern bytes per test frame
+#define UART_LINK_MAX_ERROR_PERMILLE 20   // Max frame error rate accepted (2%)
+#define UART_LINK_REPLY_TIMEOUT_MS 300    // Wait for ACCEPT / REPORT / COMMIT_ACK
+#define UART_LINK_COMMIT_TIMEOUT_MS 1500  // Responder reverts if no COMMIT after switching
+#define UART_LINK_HEARTBEAT_MS 1000       // HELLO period (carries RX counters)
+#define UART_LINK_SILENCE_TIMEOUT_MS 5000 // No valid frame for this long -> back to base rate
+#define UART_LINK_RETRY_PERIOD_MS 30000   // Initiator retries negotiation while at base rate
+#define UART_LINK_RETRY_MAX_MS 600000     // Retry period doubles after each failed negotiation up to this
+#define UART_LINK_MIN_MONITOR_FRAMES 50   // Frames needed before the error rate is trusted
+#define UART_LINK_TX_WAIT_MS 500          // Max time a sender waits behind a short link write before queuing
+#define UART_LINK_HOLD_FRAMES 16          // Application frames queued while a rate switch owns the TX path
+#define UART_LINK_MAX_RATES 6
+#define UART_LINK_FRAMING FRAMING_COBS    // Framing proposed with every rate (FRAMING_LENGTH keeps the AA 55 stream)
+
+// ============ ENUMS ============
+typedef enum
+{
+    UART_LINK_ROLE_INITIATOR = 0, // Probes and decides (master)
+    UART_LINK_ROLE_RESPONDER = 1  // Follows proposals (gateway)
+} uart_link_role_t;
+
+// First payload byte of a UART_MSG_LINK frame
+typedef enum
+{
+    LINK_OP_PROPOSE = 0x01,    // [op, seq, baud u32, framing]
+    LINK_OP_ACCEPT = 0x02,     // [op, seq, baud u32, framing]
+    LINK_OP_TEST = 0x03,       // [op, seq, index, pattern...]
+    LINK_OP_TEST_END = 0x04,   // [op, seq, sent u16]
+    LINK_OP_REPORT = 0x05,     // [op, seq, good u16, bytes u32, elapsed_ms u32]
+    LINK_OP_COMMIT = 0x06,     // [op, seq, baud u32, framing]
+    LINK_OP_COMMIT_ACK = 0x07, // [op, seq, baud u32, framing]
+    LINK_OP_HELLO = 0x08       // [op, rx_ok u32, rx_err u32, baud u32]
+} uart_link_op_t;
+
+// ============ STRUCTURES ============
+// Result of the last probe of one baud rate
+typedef struct
+{
+    uint32_t baud;
+    uint32_t probes;          // Number of times this rate was probed
+    uint16_t frames_sent;     // Test frames sent in the last probe
+    uint16_t frames_ok;       // Test frames received intact in the last probe
+    uint16_t error_permille;  // Frame error rate of the last probe
+    uint32_t throughput_bps;  // Payload bytes/s measured by the receiver in the last probe
+    bool accepted;            // Last probe passed the error threshold
+} uart_link_rate_stats_t;
+
+typedef struct
+{
+    uint32_t current_baud;
+    uint8_t current_framing;  // Framing_Mode in use on both directions
+    uint32_t negotiations;    // Completed negotiation attempts
+    uint32_t fallbacks;       // Step-downs on error rate or silence (silence also restores FRAMING_LENGTH)
+    uint32_t rx_frames_ok;    // Valid frames seen locally
+    uint32_t rx_frames_err;   // Frames dropped locally on checksum/CRC
+    uint32_t rx_replay_lost;  // Bytes lost locally, resync replay queue full (length framing)
+    uint32_t peer_rx_ok;      // Last counters reported by the peer's HELLO
+    uint32_t peer_rx_err;
+    uint32_t tx_held;         // Frames queued during a rate switch and sent after it
+    uint32_t tx_dropped;      // Frames lost because the hold queue was full
+    uint32_t retry_ms;        // Current wait before the initiator probes again from the base rate
+    uart_link_rate_stats_t rates[UART_LINK_MAX_RATES];
+} uart_link_stats_t;
+
+// ============ API ============
+/**
+ * @brief Start the link manager task
+ * @param role Initiator probes rates and stores the last good one in NVS, responder follows
+ */
+void uart_link_start(uart_link_role_t role);
+
+/**
+ * @brief Feed a received UART_MSG_LINK payload to the link manager
+ */
+void uart_link_handle_frame(const uint8_t *payload, uint16_t payload_len);
+
+/**
+ * @brief Record that a valid frame (of any type) was received
+ */
+void uart_link_notify_rx(void);
+
+/**
+ * @brief Send a frame without interleaving with an ongoing rate switch
+ * @details During a switch the frame is queued and goes out, in order, once both ends run the same mode again.
+ * @return true if sent or queued, false if the hold queue is full
+ */
+bool uart_link_send(const uint8_t *frame, uint16_t length);
+
+/**
+ * @brief Copy of the per-rate and live link counters
+ */
+void uart_link_get_stats(uart_link_stats_t *out);
+
+/**
+ * @brief Print the stats table with ESP_LOG
+ */
+void uart_link_log_stats(void);
+
+#endif // __UART_LINK_H__
@@ -0,0 +1,167 @@
+#include "gateway_metrics.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/queue.h"
+#include "fsm.h"
+#include "wifi_config.h"
+#include "store_forward.h"
+#include "metrics_http.h"
+#include "uart_arq.h"
+
+static const char *TAG = "GW_METRICS";
+
+static const uint32_t queue_wait_bounds_ms[] = {10, 20, 50, 100, 200, 500, 1000, 2000, 5000};
+static const uint32_t publish_bounds_us[] = {50, 100, 200, 500, 1000, 2000, 5000, 10000, 50000};
+
+gateway_metrics_t gw_metrics = {
+    .queue_wait_ms = {queue_wait_bounds_ms, sizeof(queue_wait_bounds_ms) / sizeof(queue_wait_bounds_ms[0])},
+    .publish_us = {publish_bounds_us, sizeof(publish_bounds_us) / sizeof(publish_bounds_us[0])},
+};
+
+// ============ SAMPLED AT SCRAPE ============
+static uint32_t sample_arq_retransmits(void)
+{
+    uart_arq_stats_t stats;
+    uart_arq_get_stats(&stats);
+    return stats.retransmits;
+}
+
+static uint32_t sample_arq_failed(void)
+{
+    uart_arq_stats_t stats;
+    uart_arq_get_stats(&stats);
+    return stats.failed;
+}
+
+static uint32_t sample_mqtt_rx(void)
+{
+    my_mqtt_rx_stats_t stats;
+    my_mqtt_get_rx_stats(&stats);
+    return stats.received;
+}
+
+static uint32_t sample_mqtt_rx_dropped(void)
+{
+    my_mqtt_rx_stats_t stats;
+    my_mqtt_get_rx_stats(&stats);
+    return stats.dropped_overflow + stats.dropped_oversize;
+}
+
+static uint32_t sample_mqtt_connects(void)
+{
+    my_mqtt_conn_stats_t stats;
+    my_mqtt_get_conn_stats(&stats);
+    return stats.connects;
+}
+
+static uint32_t sample_mqtt_sessions_resumed(void)
+{
+    my_mqtt_conn_stats_t stats;
+    my_mqtt_get_conn_stats(&stats);
+    return stats.sessions_resumed;
+}
+
+static uint32_t sample_mqtt_connect_last_ms(void)
+{
+    my_mqtt_conn_stats_t stats;
+    my_mqtt_get_conn_stats(&stats);
+    return stats.last_ms;
+}
+
+static uint32_t sample_mqtt_connect_first_ms(void)
+{
+    my_mqtt_conn_stats_t stats;
+    my_mqtt_get_conn_stats(&stats);
+    return stats.first_ms;
+}
+
+static uint32_t sample_json_queue_depth(void)
+{
+    return json_queue ? uxQueueMessagesWaiting(json_queue) : 0;
+}
+
+static uint32_t sample_outbox_bytes(void)
+{
+    return (uint32_t)my_mqtt_outbox_size();
+}
+
+static uint32_t sample_store_pending(void)
+{
+    return store_forward_pending();
+}
+
+static uint32_t sample_wifi_link_lost(void)
+{
+    wifi_connect_metrics_t m;
+    wifi_config_get_metrics(&m);
+    return m.link_lost;
+}
+
+static uint32_t sample_mqtt_up(void)
+{
+    return wifi_config_mqtt_up() ? 1 : 0;
+}
+
+static uint32_t sample_heap_free(void)
+{
+    return esp_get_free_heap_size();
+}
+
+static uint32_t sample_heap_min_free(void)
+{
+    return esp_get_minimum_free_heap_size();
+}
+
+// Families stay adjacent, HELP / TYPE are written once per name
+static const metric_desc_t gateway_metric_table[] = {
+    {"gateway_uart_frames_total", "UART frames accepted", NULL, METRIC_COUNTER, .u32 = &fsm_frame_count},
+    {"gateway_uart_integrity_errors_total", "UART frames dropped on checksum/CRC mismatch", NULL, METRIC_COUNTER,
+     .u32 = &fsm_integrity_error_count},
+    {"gateway_uart_replay_lost_bytes_total", "UART bytes lost with the resync replay queue full", NULL, METRIC_COUNTER,
+     .u32 = &fsm_replay_overflow_count},
+    {"gateway_uart_arq_retransmits_total", "Reliable UART frames sent again", NULL, METRIC_COUNTER,
+     .sample = sample_arq_retransmits},
+    {"gateway_uart_arq_failed_total", "Reliable UART frames given up", NULL, METRIC_COUNTER, .sample = sample_arq_failed},
+    {"gateway_mqtt_published_total", "Messages handed to the MQTT client", "class=\"telemetry\"", METRIC_COUNTER,
+     .u32 = &gw_metrics.published[MQTT_CLASS_TELEMETRY]},
+    {"gateway_mqtt_published_total", NULL, "class=\"control_ack\"", METRIC_COUNTER,
+     .u32 = &gw_metrics.published[MQTT_CLASS_CONTROL_ACK]},
+    {"gateway_mqtt_published_total", NULL, "class=\"alert\"", METRIC_COUNTER, .u32 = &gw_metrics.published[MQTT_CLASS_ALERT]},
+    {"gateway_mqtt_stored_total", "Messages kept in flash while offline", NULL, METRIC_COUNTER, .u32 = &gw_metrics.stored},
+    {"gateway_messages_dropped_total", "Messages lost before reaching MQTT", "reason=\"offline\"", METRIC_COUNTER,
+     .u32 = &gw_metrics.dropped_offline},
+    {"gateway_messages_dropped_total", NULL, "reason=\"queue_full\"", METRIC_COUNTER, .u32 = &gw_metrics.dropped_queue_full},
+    {"gateway_mqtt_received_total", "MQTT messages received", NULL, METRIC_COUNTER, .sample = sample_mqtt_rx},
+    {"gateway_mqtt_rx_dropped_total", "MQTT messages dropped (pool full or too large)", NULL, METRIC_COUNTER,
+     .sample = sample_mqtt_rx_dropped},
+    {"gateway_mqtt_disconnects_total", "Broker connection drops", NULL, METRIC_COUNTER, .u32 = &gw_metrics.mqtt_disconnects},
+    {"gateway_mqtt_connects_total", "Broker connections established", NULL, METRIC_COUNTER, .sample = sample_mqtt_connects},
+    {"gateway_mqtt_sessions_resumed_total", "Reconnects that found the persistent session", NULL, METRIC_COUNTER,
+     .sample = sample_mqtt_sessions_resumed},
+    {"gateway_mqtt_connect_ms", "TCP + TLS + MQTT CONNECT duration", "connect=\"first\"", METRIC_GAUGE,
+     .sample = sample_mqtt_connect_first_ms},
+    {"gateway_mqtt_connect_ms", NULL, "connect=\"last\"", METRIC_GAUGE, .sample = sample_mqtt_connect_last_ms},
+    {"gateway_wifi_link_lost_total", "WiFi drops after the link was up", NULL, METRIC_COUNTER, .sample = sample_wifi_link_lost},
+    {"gateway_mqtt_up", "1 while connected to the broker", NULL, METRIC_GAUGE, .sample = sample_mqtt_up},
+    {"gateway_json_queue_depth", "Messages waiting for the publisher", NULL, METRIC_GAUGE, .sample = sample_json_queue_depth},
+    {"gateway_mqtt_outbox_bytes", "Unacknowledged QoS>0 bytes in the client outbox", NULL, METRIC_GAUGE,
+     .sample = sample_outbox_bytes},
+    {"gateway_store_pending", "Messages waiting in flash", NULL, METRIC_GAUGE, .sample = sample_store_pending},
+    {"gateway_heap_free_bytes", "Free heap", NULL, METRIC_GAUGE, .sample = sample_heap_free},
+    {"gateway_heap_min_free_bytes", "Lowest free heap since boot", NULL, METRIC_GAUGE, .sample = sample_heap_min_free},
+    {"gateway_queue_wait_ms", "Time from message produced to taken by the publisher", NULL, METRIC_HISTOGRAM,
+     .histogram = &gw_metrics.queue_wait_ms},
+    {"gateway_mqtt_publish_us", "Duration of one MQTT publish call", NULL, METRIC_HISTOGRAM,
+     .histogram = &gw_metrics.publish_us},
+};
+
+void gateway_metrics_init(void)
+{
+    static const httpd_uri_t metrics_uri = {"/metrics", HTTP_GET, metrics_http_handler, NULL};
+
+    metrics_init(gateway_metric_table, sizeof(gateway_metric_table) / sizeof(gateway_metric_table[0]));
+    if (wifi_config_register_uri(&metrics_uri) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "/metrics not served");
+    }
+}
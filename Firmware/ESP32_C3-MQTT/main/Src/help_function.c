@@ -16,41 +16,42 @@ void led_status_task(void *pvParameters)
     gpio_config(&io_conf);
 
     uint8_t led_level = 0;
-    wifi_manager_state_t last_state = WIFI_STATE_UNINITIALIZED;
+    wifi_manager_state_t current_state = wifi_config_get_state();
     while (1)
     {
-        wifi_manager_state_t current_state = wifi_config_get_state();
-        if (current_state != last_state) {
-            ESP_LOGI("LED_TASK", "State changed to %d", current_state);
-            last_state = current_state;
-        }
-
+        // Sleeps until the connectivity state changes, only the AP mode blink needs a period
+        TickType_t wait = portMAX_DELAY;
         switch (current_state)
         {
         case WIFI_STATE_MQTT_CONNECTED:
             // Solid ON when fully connected
             led_level = 1;
             gpio_set_level(LED_PIN, led_level);
-            vTaskDelay(pdMS_TO_TICKS(1000));
             break;
 
         case WIFI_STATE_AP_MODE:
             // Fast blink in AP mode
             led_level = !led_level;
             gpio_set_level(LED_PIN, led_level);
-            vTaskDelay(pdMS_TO_TICKS(250));
+            wait = pdMS_TO_TICKS(250);
             break;
 
         case WIFI_STATE_CONNECTING:
         case WIFI_STATE_CONNECTED: // Still OFF until MQTT is connected
+        case WIFI_STATE_DISCONNECTED:
         case WIFI_STATE_UNINITIALIZED:
         case WIFI_STATE_ERROR:
         default:
             // LED OFF during connection attempts or on failure
             led_level = 0;
             gpio_set_level(LED_PIN, led_level);
-            vTaskDelay(pdMS_TO_TICKS(1000));
             break;
         }
+
+        wifi_manager_state_t last_state = current_state;
+        current_state = wifi_config_wait_change(last_state, wait);
+        if (current_state != last_state) {
+            ESP_LOGI("LED_TASK", "State changed to %d", current_state);
+        }
     }
 }
@@ -2,6 +2,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "driver/gpio.h"
 #include <string.h>
 #include <stdlib.h>
@@ -11,31 +12,84 @@
 #include "message.h"
 #include "wifi_config.h"
 #include "my_mqtt.h"
-#include "cJSON.h"
+#include "json_reader.h"
+#include "json_writer.h"
 #include "uart_protocol.h"
+#include "uart_link.h"
+#include "uart_arq.h"
+#include "store_forward.h"
+#include "topic_router.h"
+#include "mqtt_batch.h"
+#include "report_policy.h"
+#include "cbor.h"
+#include "gateway_metrics.h"
+#include "mqtt_loopback.h"
+#include "esp_timer.h"
 #include "define.h"
 #include "help_function.h"
 
 my_mqtt_init_t mqtt_cfg = {
-    .server = "mqtt://broker.emqx.io", // Server broker
-    .topic_pub = "GateWays/Server",    // topic publish
-    .topic_sub = "Server/Gateways"     // topic subscribe
+    .server = MQTT_BROKER_URI,        // Server broker
+    .topic_pub = "GateWays/Server",   // topic publish
+    .topic_sub = "Server/Gateways",   // topic subscribe
+    .outbox_limit = MQTT_OUTBOX_LIMIT, // slow broker -> publisher waits instead of growing the heap
+    .persistent_session = MQTT_PERSISTENT_SESSION,
+    .tls_resume = MQTT_TLS_RESUME,
 };
 
 const char *UART_TAG = "UART_TASK";
 const char *MQTT_TAG = "MQTT_TASK";
 const char *MAIN_TAG = "MAIN";
 
-Frame_Message mess;
 QueueHandle_t json_queue;    // Queue to send JSON from UART task to MQTT task
 QueueHandle_t mqtt_rx_queue; // Queue to receive MQTT messages
+static SemaphoreHandle_t mqtt_up_signal; // Given on MQTT connect, wakes the publisher to replay the backlog
+static QueueSetHandle_t publish_set;     // json_queue + mqtt_up_signal, the publisher blocks on both
 
 typedef struct
 {
-    char json_data[512];
+    char json_data[512]; // telemetry: the "data" object only, the publisher wraps it
     char topic[64];
+    uint8_t msg_class;   // mqtt_msg_class_t
+    TickType_t stamp;    // when the message was produced
+    Sensor_Data sensors; // telemetry: raw readings and node id, for the per-sensor topics
 } mqtt_message_t;
 
+static const struct
+{
+    uint8_t qos;
+    bool retain;
+    uint8_t encoding; // mqtt_encoding_t
+} mqtt_class_opts[MQTT_CLASS_COUNT] = {
+    [MQTT_CLASS_TELEMETRY] = {MQTT_TELEMETRY_QOS, MQTT_TELEMETRY_RETAIN, MQTT_TELEMETRY_ENCODING},
+    [MQTT_CLASS_CONTROL_ACK] = {MQTT_CONTROL_ACK_QOS, MQTT_CONTROL_ACK_RETAIN, MQTT_CONTROL_ACK_ENCODING},
+    [MQTT_CLASS_ALERT] = {MQTT_ALERT_QOS, MQTT_ALERT_RETAIN, MQTT_ALERT_ENCODING},
+};
+
+// CBOR member names -> index, shared with the server. Append only, an index never changes meaning.
+static const char *const cbor_key_names[] = {
+    "type", "data", "batch", "dt", "age_ms", "node", "lux", "temp", "humi", "seq", "plug", "status", "reason",
+};
+static const cbor_key_dict_t cbor_keys = {cbor_key_names, sizeof(cbor_key_names) / sizeof(cbor_key_names[0])};
+
+// Sensor_Data flags <-> report_policy fields
+static const struct
+{
+    uint8_t flag;
+    report_field_t field;
+} report_fields[REPORT_FIELD_COUNT] = {
+    {SENSOR_FLAG_LUX, REPORT_FIELD_LUX},
+    {SENSOR_FLAG_TEMP, REPORT_FIELD_TEMP},
+    {SENSOR_FLAG_HUMI, REPORT_FIELD_HUMI},
+};
+
+// Telemetry waiting to be published as one message (mqtt_batch.h), mqtt_publish_task only
+static char batch_buf[MQTT_BATCH_MAX_BYTES];
+static mqtt_batch_t telemetry_batch;
+
+static bool store_ready = false;   // tlm_store partition mounted, outages are buffered in flash
+static TickType_t replay_last = 0; // last backlog message published (live traffic does not move it)
+
 /**
  * @brief Callback when WiFi is connected
  * @details This function is called by the wifi_config component when the device gets an IP address.
@@ -54,111 +108,626 @@ void on_mqtt_connected(void)
 {
     ESP_LOGI(MAIN_TAG, "MQTT connected!");
     // Update the system state to reflect MQTT is also connected
-    wifi_config_set_state(WIFI_STATE_MQTT_CONNECTED);
+    wifi_config_notify(CONN_EVT_MQTT_UP);
+    xSemaphoreGive(mqtt_up_signal);
+}
+
+/**
+ * @brief Callback when the MQTT connection drops, the client reconnects by itself
+ *
+ */
+void on_mqtt_disconnected(void)
+{
+    metric_inc(&gw_metrics.mqtt_disconnects);
+    wifi_config_notify(CONN_EVT_MQTT_DOWN);
+}
+
+/**
+ * @brief Handle a received frame, plain or delivered in order by the ARQ layer
+ * @param view (inner) frame, only valid during the call
+ */
+static void uart_handle_payload(const Frame_View *view)
+{
+    if (uart_view_is_data(view))
+    {
+        mqtt_message_t mqtt_msg = {
+            .msg_class = MQTT_CLASS_TELEMETRY,
+            .stamp = xTaskGetTickCount(),
+        };
+
+        mqtt_msg.sensors = (Sensor_Data){
+            .flags = uart_data_flags(view),
+            .lux = uart_data_lux(view),
+            .temp = uart_data_temp(view),
+            .humi = uart_data_humi(view),
+            .node = uart_data_node(view),
+        };
+
+        // Report by exception: only the fields that moved past their deadband (or are due) go out
+        const uint16_t values[REPORT_FIELD_COUNT] = {
+            [REPORT_FIELD_LUX] = mqtt_msg.sensors.lux,
+            [REPORT_FIELD_TEMP] = mqtt_msg.sensors.temp,
+            [REPORT_FIELD_HUMI] = mqtt_msg.sensors.humi,
+        };
+        uint8_t present = 0;
+        uint8_t publish;
+        for (int i = 0; i < REPORT_FIELD_COUNT; i++)
+        {
+            if (mqtt_msg.sensors.flags & report_fields[i].flag)
+            {
+                present |= REPORT_FIELD_BIT(report_fields[i].field);
+            }
+        }
+        if (!report_policy_filter(mqtt_msg.sensors.node, present, values, pdTICKS_TO_MS(mqtt_msg.stamp), &publish))
+        {
+            return;
+        }
+        mqtt_msg.sensors.flags = SENSOR_FLAG_NONE;
+        for (int i = 0; i < REPORT_FIELD_COUNT; i++)
+        {
+            if (publish & REPORT_FIELD_BIT(report_fields[i].field))
+            {
+                mqtt_msg.sensors.flags |= report_fields[i].flag;
+            }
+        }
+
+        // Only the "data" object, written in place (no cJSON tree on the decode path)
+        json_writer_t w;
+        json_writer_init(&w, mqtt_msg.json_data, sizeof(mqtt_msg.json_data));
+        uart_sensor_write_json(&w, NULL, &mqtt_msg.sensors);
+        if (json_writer_finish(&w) == 0)
+        {
+            ESP_LOGW(UART_TAG, "Telemetry JSON does not fit, message dropped");
+            return;
+        }
+
+        strncpy(mqtt_msg.topic, mqtt_cfg.topic_pub, sizeof(mqtt_msg.topic) - 1);
+        if (xQueueSend(json_queue, &mqtt_msg, pdMS_TO_TICKS(100)) != pdTRUE)
+        {
+            metric_inc(&gw_metrics.dropped_queue_full);
+            ESP_LOGW(UART_TAG, "JSON Queue full, message dropped");
+        }
+    }
 }
 
 /**
  * @brief TASK receive UART and decode message
- *@details This task continuously checks for incoming UART messages.
+ *@details This task is woken by lib_uart when a frame is complete, LINK frames go to the link manager
+ *         and RELIABLE/ACK frames to the ARQ layer.
  * @param pvParameters
  */
 void uart_receive_decode_task(void *pvParameters)
 {
     ESP_LOGI(UART_TAG, "UART Receive & Decode Task Started\n");
+    uart_set_frame_notify(xTaskGetCurrentTaskHandle());
 
     while (1)
     {
-        if (uart.check.is_message())
+        Frame_View frame;
+
+        while (uart.check.is_message() && uart.frame.acquire(&frame))
         {
-            decode_message(&mess);
-            if (mess.type_message == UART_MSG_DATA && mess.length_message >= 5)
+            uart_link_notify_rx();
+            switch (frame.type)
             {
-                uint8_t flags = mess.data[0];
-                uint16_t lux = (mess.data[1] << 8) | mess.data[2];
-                uint8_t temp = mess.data[3];
-                uint8_t humi = mess.data[4];
-
-                cJSON *root = cJSON_CreateObject();
-                cJSON_AddStringToObject(root, "type", "telemetry");
-                cJSON *data = cJSON_CreateObject();
-                if (flags & SENSOR_FLAG_LUX)
-                    cJSON_AddNumberToObject(data, "lux", lux);
-                if (flags & SENSOR_FLAG_TEMP)
-                    cJSON_AddNumberToObject(data, "temp", temp);
-                if (flags & SENSOR_FLAG_HUMI)
-                    cJSON_AddNumberToObject(data, "humi", humi);
-                cJSON_AddItemToObject(root, "data", data);
-
-                char *json_str = cJSON_PrintUnformatted(root);
-                cJSON_Delete(root);
-
-                if (json_str != NULL)
-                {
-                    mqtt_message_t mqtt_msg;
-                    strncpy(mqtt_msg.json_data, json_str, sizeof(mqtt_msg.json_data) - 1);
-                    strncpy(mqtt_msg.topic, mqtt_cfg.topic_pub, sizeof(mqtt_msg.topic) - 1);
-                    if (xQueueSend(json_queue, &mqtt_msg, pdMS_TO_TICKS(100)) != pdTRUE)
-                    {
-                        ESP_LOGW(UART_TAG, "JSON Queue full, message dropped");
-                    }
-                    free(json_str);
-                }
+            case UART_MSG_LINK:
+                uart_link_handle_frame(frame.payload, frame.payload_len);
+                break;
+            case UART_MSG_RELIABLE:
+                uart_arq_handle_data(frame.payload, frame.payload_len);
+                break;
+            case UART_MSG_ACK:
+                uart_arq_handle_ack(frame.payload, frame.payload_len);
+                break;
+            default:
+                uart_handle_payload(&frame);
+                break;
             }
+            uart.frame.release(&frame);
         }
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // Woken by the RX task for every queued frame, the timeout is only a fallback
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+    }
+}
+
+/**
+ * @brief Queue the outcome of a plug command: control_ack once the master acknowledged it, else an alert
+ * @details Runs in the ARQ completion context (UART RX dispatch or retransmit timer task), so it does not
+ *          wait for room in json_queue.
+ */
+static void control_reply(uint8_t node, int plug_id, Plug_Status status, bool delivered)
+{
+    mqtt_message_t reply = {
+        .msg_class = delivered ? MQTT_CLASS_CONTROL_ACK : MQTT_CLASS_ALERT,
+        .stamp = xTaskGetTickCount(),
+    };
+    json_writer_t w;
+    json_writer_init(&w, reply.json_data, sizeof(reply.json_data));
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "type", delivered ? "control_ack" : "alert");
+    json_writer_begin_object(&w, "data");
+    if (!delivered)
+    {
+        json_writer_string(&w, "reason", "control_undelivered");
+    }
+    if (node != 0)
+    {
+        json_writer_uint(&w, "node", node);
+    }
+    char plug_name[12];
+    snprintf(plug_name, sizeof(plug_name), "plug_%d", plug_id);
+    json_writer_string(&w, "plug", plug_name);
+    json_writer_string(&w, "status", status == STATUS_ON ? "on" : "off");
+    json_writer_end_object(&w);
+    json_writer_end_object(&w);
+    json_writer_finish(&w);
+
+    strncpy(reply.topic, mqtt_cfg.topic_pub, sizeof(reply.topic) - 1);
+    if (xQueueSend(json_queue, &reply, 0) != pdTRUE)
+    {
+        metric_inc(&gw_metrics.dropped_queue_full);
+        ESP_LOGW(MQTT_TAG, "JSON Queue full, %s dropped", delivered ? "control ack" : "alert");
+    }
+}
+
+/**
+ * @brief ARQ outcome of a plug command, tag = node << 16 | plug_id << 8 | status (see control_forward)
+ */
+static void control_arq_done(uart_arq_result_t result, uint32_t tag)
+{
+    uint8_t node = (uint8_t)(tag >> 16);
+    int plug_id = (uint8_t)(tag >> 8);
+    Plug_Status status = (Plug_Status)(tag & 0xFF);
+
+    if (result != UART_ARQ_DELIVERED)
+    {
+        ESP_LOGW(MQTT_TAG, "UART control for node %u plug %d not acknowledged", node, plug_id);
+    }
+    control_reply(node, plug_id, status, result == UART_ARQ_DELIVERED);
+}
+
+/**
+ * @brief Send a plug command over UART (acknowledged), the control_ack / alert reply follows the outcome
+ * @param node 0 = master
+ * @param plug_id 1-based, like the topics and "plug_N"
+ */
+static void control_forward(uint8_t node, int plug_id, Plug_Status status)
+{
+    uint8_t uart_buffer[32];
+
+    if (plug_id < PLUG_1 + 1 || plug_id > PLUG_3 + 1)
+    {
+        ESP_LOGW(MQTT_TAG, "Unknown plug %d", plug_id);
+        return;
+    }
+
+    uint16_t length = create_uart_control_message_to(node, plug_id - 1, status, uart_buffer);
+    uint32_t tag = ((uint32_t)node << 16) | ((uint32_t)plug_id << 8) | (uint32_t)status;
+    // Commands must not be lost, telemetry stays unacknowledged
+    if (length > 0 &&
+        uart_arq_send_frame_notify(uart_buffer, length, UART_CONTROL_SEND_TIMEOUT_MS, control_arq_done, tag))
+    {
+        ESP_LOGI(MQTT_TAG, "Sent UART control for node %u plug %d to %s", node, plug_id, status == STATUS_ON ? "on" : "off");
+        return;
+    }
+    // Too long or the window stayed full: never left the gateway
+    control_reply(node, plug_id, status, false);
+}
+
+/**
+ * @brief Legacy {"type":"control","data":{"plug":"plug_N","status":"on"}} command, for the master
+ */
+static void control_handle_json(const char *payload, int payload_len)
+{
+    // Fixed schema, bound in one pass without a cJSON tree
+    char type[24] = "";
+    char plug[16];
+    char status[8];
+    const json_field_t fields[] = {
+        {"type", JSON_FIELD_STRING, true, type, sizeof(type)},
+        {"data.plug", JSON_FIELD_STRING, false, plug, sizeof(plug)},
+        {"data.status", JSON_FIELD_STRING, false, status, sizeof(status)},
+    };
+    uint32_t found;
+    json_read_error_t err;
+    if (!json_bind(payload, payload_len, fields, 3, &found, &err))
+    {
+        ESP_LOGW(MQTT_TAG, "Bad JSON: %s at %u%s%s", json_read_status_str(err.status), err.pos,
+                 err.field ? ", field " : "", err.field ? err.field : "");
+        return;
+    }
+    if (strcmp(type, "control") != 0)
+    {
+        return;
     }
+    if ((found & 0x6) != 0x6) // fields[1] and fields[2]
+    {
+        ESP_LOGW(MQTT_TAG, "Control message without data.plug / data.status");
+        return;
+    }
+
+    int plug_id = 0;
+    if (sscanf(plug, "plug_%d", &plug_id) != 1)
+    {
+        ESP_LOGW(MQTT_TAG, "Unknown plug '%s'", plug);
+        return;
+    }
+    control_forward(0, plug_id, (strcasecmp(status, "on") == 0) ? STATUS_ON : STATUS_OFF);
+}
+
+/**
+ * @brief Queue the report policy and its counters as a control_ack-class reply
+ */
+static void report_policy_reply(void)
+{
+    report_policy_config_t cfg;
+    report_policy_stats_t stats;
+    report_policy_get_config(&cfg);
+    report_policy_get_stats(&stats);
+
+    mqtt_message_t reply = {
+        .msg_class = MQTT_CLASS_CONTROL_ACK,
+        .stamp = xTaskGetTickCount(),
+    };
+    json_writer_t w;
+    json_writer_init(&w, reply.json_data, sizeof(reply.json_data));
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "type", "report_policy");
+    json_writer_begin_object(&w, "data");
+    json_writer_uint(&w, "heartbeat_ms", cfg.heartbeat_ms);
+    for (int f = 0; f < REPORT_FIELD_COUNT; f++)
+    {
+        json_writer_begin_object(&w, report_field_name(f));
+        json_writer_uint(&w, "abs", cfg.field[f].abs_deadband);
+        json_writer_uint(&w, "rel_pm", cfg.field[f].rel_deadband_pm);
+        json_writer_uint(&w, "min_ms", cfg.field[f].min_interval_ms);
+        json_writer_uint(&w, "max_ms", cfg.field[f].max_interval_ms);
+        json_writer_uint(&w, "published", stats.fields_published[f]);
+        json_writer_uint(&w, "suppressed", stats.fields_suppressed[f]);
+        json_writer_end_object(&w);
+    }
+    json_writer_uint(&w, "frames_in", stats.frames_in);
+    json_writer_uint(&w, "frames_published", stats.frames_published);
+    json_writer_uint(&w, "frames_suppressed", stats.frames_suppressed);
+    json_writer_end_object(&w);
+    json_writer_end_object(&w);
+    if (json_writer_finish(&w) == 0)
+    {
+        ESP_LOGW(MQTT_TAG, "Report policy reply does not fit");
+        return;
+    }
+
+    strncpy(reply.topic, mqtt_cfg.topic_pub, sizeof(reply.topic) - 1);
+    if (xQueueSend(json_queue, &reply, pdMS_TO_TICKS(100)) != pdTRUE)
+    {
+        metric_inc(&gw_metrics.dropped_queue_full);
+        ESP_LOGW(MQTT_TAG, "JSON Queue full, report policy reply dropped");
+    }
+}
+
+/**
+ * @brief Update the report policy from {"heartbeat_ms":N,"<field>":{"abs":N,"rel_pm":N,"min_ms":N,"max_ms":N},..}
+ * @details Members not given keep their value. Stored in NVS and answered with the new policy.
+ */
+static void report_policy_handle_set(const char *payload, int payload_len)
+{
+    report_policy_config_t cfg;
+    report_policy_get_config(&cfg);
+
+    // [0] heartbeat, then abs / rel_pm / min_ms / max_ms per field
+    int32_t values[1 + REPORT_FIELD_COUNT * 4];
+    char paths[REPORT_FIELD_COUNT * 4][16];
+    json_field_t fields[1 + REPORT_FIELD_COUNT * 4] = {
+        {"heartbeat_ms", JSON_FIELD_INT, false, &values[0], 0},
+    };
+    static const char *const members[4] = {"abs", "rel_pm", "min_ms", "max_ms"};
+    for (int f = 0; f < REPORT_FIELD_COUNT; f++)
+    {
+        for (int m = 0; m < 4; m++)
+        {
+            int i = f * 4 + m;
+            snprintf(paths[i], sizeof(paths[i]), "%s.%s", report_field_name(f), members[m]);
+            fields[1 + i] = (json_field_t){paths[i], JSON_FIELD_INT, false, &values[1 + i], 0};
+        }
+    }
+
+    uint32_t found;
+    json_read_error_t err;
+    if (!json_bind(payload, payload_len, fields, sizeof(fields) / sizeof(fields[0]), &found, &err))
+    {
+        ESP_LOGW(MQTT_TAG, "Bad report policy: %s at %u", json_read_status_str(err.status), err.pos);
+        return;
+    }
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+    {
+        if ((found & (1u << i)) && values[i] < 0)
+        {
+            ESP_LOGW(MQTT_TAG, "Report policy '%s' must not be negative", fields[i].path);
+            return;
+        }
+    }
+
+    if (found & 1u)
+    {
+        cfg.heartbeat_ms = (uint32_t)values[0];
+    }
+    for (int f = 0; f < REPORT_FIELD_COUNT; f++)
+    {
+        const int32_t *v = &values[1 + f * 4];
+        uint32_t bits = found >> (1 + f * 4);
+        if (bits & 1u)
+        {
+            cfg.field[f].abs_deadband = v[0] > UINT16_MAX ? UINT16_MAX : (uint16_t)v[0];
+        }
+        if (bits & 2u)
+        {
+            cfg.field[f].rel_deadband_pm = v[1] > UINT16_MAX ? UINT16_MAX : (uint16_t)v[1];
+        }
+        if (bits & 4u)
+        {
+            cfg.field[f].min_interval_ms = (uint32_t)v[2];
+        }
+        if (bits & 8u)
+        {
+            cfg.field[f].max_interval_ms = (uint32_t)v[3];
+        }
+    }
+
+    esp_err_t ret = report_policy_set_config(&cfg);
+    if (ret == ESP_ERR_INVALID_ARG)
+    {
+        ESP_LOGW(MQTT_TAG, "Report policy rejected (rel_pm > 1000 or max_ms < min_ms)");
+        return;
+    }
+    ESP_LOGI(MQTT_TAG, "Report policy updated%s", ret == ESP_OK ? "" : ", not saved");
+    report_policy_reply();
 }
 
 /**
  * @brief TASK receive MQTT control messages and send UART commands
- * @details This task listens for control messages from MQTT and sends corresponding UART commands.
+ * @details Blocks on the my_mqtt receive queue, so a command is handled as soon as it arrives and
+ *          bursts are processed in order instead of overwriting each other. The topic selects the
+ *          route (topic_router trie).
  * @param pvParameters
  */
 void mqtt_receive_control_task(void *pvParameters)
 {
     ESP_LOGI(MQTT_TAG, "MQTT Receive Control Task Started\n");
-    my_mqtt_message_t mqtt_msg;
-    uint8_t uart_buffer[256];
+    my_mqtt_message_t *mqtt_msg;
 
     while (1)
     {
-        if (my_mqtt_getmess(&mqtt_msg))
+        if (!my_mqtt_acquire(&mqtt_msg, portMAX_DELAY))
         {
-            ESP_LOGI(MQTT_TAG, "Received '%.*s' on topic '%.*s'", mqtt_msg.payload_len, mqtt_msg.payload, mqtt_msg.topic_len, mqtt_msg.topic);
-            cJSON *root = cJSON_ParseWithLength(mqtt_msg.payload, mqtt_msg.payload_len);
-            if (root)
-            {
-                cJSON *type = cJSON_GetObjectItem(root, "type");
-                cJSON *data = cJSON_GetObjectItem(root, "data");
-                if (type && cJSON_IsString(type) && strcmp(type->valuestring, "control") == 0 && data)
-                {
-                    cJSON *plug = cJSON_GetObjectItem(data, "plug");
-                    cJSON *status = cJSON_GetObjectItem(data, "status");
-                    if (plug && cJSON_IsString(plug) && status && cJSON_IsString(status))
-                    {
-                        int plug_id = 0;
-                        if (sscanf(plug->valuestring, "plug_%d", &plug_id) == 1)
-                        {
-                            Plug_Status a_status = (strcasecmp(status->valuestring, "on") == 0) ? STATUS_ON : STATUS_OFF;
-                            uint16_t length = create_uart_control_message(plug_id - 1, a_status, uart_buffer);
-                            if (length > 0)
-                            {
-                                uart.send.bytes(uart_buffer, length);
-                                ESP_LOGI(MQTT_TAG, "Sent UART control for Plug %d to %s", plug_id, status->valuestring);
-                            }
-                        }
-                    }
-                }
-                cJSON_Delete(root);
-            }
+            continue;
+        }
+
+        ESP_LOGI(MQTT_TAG, "Received '%.*s' on topic '%.*s'", mqtt_msg->payload_len, mqtt_msg->payload, mqtt_msg->topic_len, mqtt_msg->topic);
+        topic_match_t route;
+        if (!topic_router_match(mqtt_msg->topic, mqtt_msg->topic_len, &route))
+        {
+            ESP_LOGW(MQTT_TAG, "No route for topic '%.*s'", mqtt_msg->topic_len, mqtt_msg->topic);
+            my_mqtt_release(mqtt_msg);
+            continue;
+        }
+
+        switch (route.action)
+        {
+        case TOPIC_ACTION_JSON_CONTROL:
+            control_handle_json(mqtt_msg->payload, mqtt_msg->payload_len);
+            my_mqtt_release(mqtt_msg);
+            break;
+
+        case TOPIC_ACTION_REPORT_SET:
+            report_policy_handle_set(mqtt_msg->payload, mqtt_msg->payload_len);
+            my_mqtt_release(mqtt_msg);
+            break;
+
+        case TOPIC_ACTION_REPORT_GET:
+            my_mqtt_release(mqtt_msg);
+            report_policy_reply();
+            break;
+
+        default:
+            my_mqtt_release(mqtt_msg);
+            break;
         }
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
+/**
+ * @brief Wait while a QoS>0 message of size bytes would put the client outbox over MQTT_OUTBOX_LIMIT
+ * @details A slow broker backs up into json_queue (and the producers drop) instead of exhausting the heap.
+ * @return false if MQTT is down
+ */
+static bool mqtt_outbox_wait(uint8_t qos, int size)
+{
+    while (qos > 0 && my_mqtt_outbox_size() + size > MQTT_OUTBOX_LIMIT)
+    {
+        if (!wifi_config_mqtt_up())
+        {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(MQTT_OUTBOX_WAIT_MS));
+    }
+    return wifi_config_mqtt_up();
+}
+
+/**
+ * @brief Publish with the QoS / retain of the message class
+ * @details Waits for room in the client outbox first (mqtt_outbox_wait).
+ * @return true if the client took the message
+ */
+static bool mqtt_publish_now(mqtt_msg_class_t msg_class, const char *topic, const char *payload)
+{
+    // Publisher task only
+    static uint8_t cbor_buf[STORE_FORWARD_MAX_RECORD + 24];
+    static json_tok_t cbor_toks[MQTT_CBOR_MAX_TOKENS];
+    static char cbor_topic[64 + sizeof(MQTT_CBOR_TOPIC_SUFFIX)];
+    uint8_t qos = mqtt_class_opts[msg_class].qos;
+    size_t cbor_len = 0;
+
+    if (mqtt_class_opts[msg_class].encoding == MQTT_ENCODING_CBOR)
+    {
+        cbor_writer_t w;
+        json_read_error_t err;
+        cbor_writer_init(&w, cbor_buf, sizeof(cbor_buf));
+        cbor_len = cbor_from_json(payload, strlen(payload), cbor_toks, MQTT_CBOR_MAX_TOKENS, &cbor_keys, &w, &err);
+        if (cbor_len == 0)
+        {
+            // Still delivered, as JSON on the plain topic
+            ESP_LOGW(MQTT_TAG, "CBOR encoding failed (%s at %u), sent as JSON", json_read_status_str(err.status), err.pos);
+        }
+        snprintf(cbor_topic, sizeof(cbor_topic), "%s%s", topic, MQTT_CBOR_TOPIC_SUFFIX);
+    }
+    int size = cbor_len ? (int)cbor_len : (int)strlen(payload);
+
+    if (!mqtt_outbox_wait(qos, size))
+    {
+        return false;
+    }
+    int64_t start = esp_timer_get_time();
+    int msg_id = cbor_len ? my_mqtt_pub_bin(cbor_topic, cbor_buf, (int)cbor_len, qos, mqtt_class_opts[msg_class].retain)
+                          : my_mqtt_pub_opts(topic, payload, qos, mqtt_class_opts[msg_class].retain);
+    metric_observe(&gw_metrics.publish_us, (uint32_t)(esp_timer_get_time() - start));
+    if (msg_id < 0)
+    {
+        return false;
+    }
+    metric_inc(&gw_metrics.published[msg_class]);
+    return true;
+}
+
+/**
+ * @brief Publish, or keep the message in flash until the broker is back
+ */
+static void mqtt_publish_class(mqtt_msg_class_t msg_class, const char *topic, const char *payload)
+{
+    if (mqtt_publish_now(msg_class, topic, payload))
+    {
+        return;
+    }
+
+    if (store_ready && store_forward_append(msg_class, topic, payload) == ESP_OK)
+    {
+        metric_inc(&gw_metrics.stored);
+        ESP_LOGD(MQTT_TAG, "Not connected to MQTT, message stored (%lu pending)", store_forward_pending());
+        return;
+    }
+    metric_inc(&gw_metrics.dropped_offline);
+    ESP_LOGW(MQTT_TAG, "Not connected to MQTT, dropping message.");
+}
+
+/**
+ * @brief Publish each reading on its precomputed <root>/node<N>/<sensor> topic
+ * @details Latest value only, skipped while MQTT is down (the batched telemetry keeps the history).
+ *          Plain digits (never CBOR), with the same outbox backpressure as mqtt_publish_now().
+ */
+static void mqtt_publish_sensor_topics(const Sensor_Data *sensors)
+{
+    static const struct
+    {
+        uint8_t flag;
+        topic_sensor_t sensor;
+    } sensor_map[] = {
+        {SENSOR_FLAG_LUX, TOPIC_SENSOR_LUX},
+        {SENSOR_FLAG_TEMP, TOPIC_SENSOR_TEMP},
+        {SENSOR_FLAG_HUMI, TOPIC_SENSOR_HUMI},
+    };
+
+    uint8_t qos = mqtt_class_opts[MQTT_CLASS_TELEMETRY].qos;
+
+    if (!MQTT_SENSOR_TOPICS || !wifi_config_mqtt_up())
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < sizeof(sensor_map) / sizeof(sensor_map[0]); i++)
+    {
+        const char *topic = topic_router_sensor_topic(sensors->node, sensor_map[i].sensor);
+        if (!(sensors->flags & sensor_map[i].flag) || topic == NULL)
+        {
+            continue;
+        }
+
+        uint16_t value = sensor_map[i].sensor == TOPIC_SENSOR_LUX    ? sensors->lux
+                         : sensor_map[i].sensor == TOPIC_SENSOR_TEMP ? sensors->temp
+                                                                      : sensors->humi;
+        char digits[6];
+        char *p = &digits[sizeof(digits) - 1];
+        *p = '\0';
+        do
+        {
+            *--p = (char)('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+
+        if (!mqtt_outbox_wait(qos, (int)(&digits[sizeof(digits) - 1] - p)))
+        {
+            return;
+        }
+        my_mqtt_pub_opts(topic, p, qos, mqtt_class_opts[MQTT_CLASS_TELEMETRY].retain);
+    }
+}
+
+/**
+ * @brief Publish the oldest stored message, marked with its seq so the server drops duplicates
+ * @details A message published but not marked sent before a reset is replayed again after boot,
+ *          with the same seq.
+ */
+static void mqtt_replay_one(void)
+{
+    static char record[STORE_FORWARD_MAX_RECORD];
+    static char payload[STORE_FORWARD_MAX_RECORD + 24];
+    store_forward_record_t rec;
+
+    replay_last = xTaskGetTickCount();
+    if (!store_forward_peek(&rec, record, sizeof(record)))
+    {
+        return;
+    }
+
+    // {"seq":N,<original members>}
+    if (rec.payload[0] == '{')
+    {
+        snprintf(payload, sizeof(payload), "{\"seq\":%lu%s%s", rec.seq, rec.payload[1] == '}' ? "" : ",", rec.payload + 1);
+    }
+    else
+    {
+        strncpy(payload, rec.payload, sizeof(payload) - 1);
+    }
+
+    if (rec.msg_class >= MQTT_CLASS_COUNT)
+    {
+        rec.msg_class = MQTT_CLASS_TELEMETRY;
+    }
+    if (mqtt_publish_now(rec.msg_class, rec.topic, payload))
+    {
+        store_forward_ack(rec.seq);
+        if (store_forward_pending() == 0)
+        {
+            store_forward_stats_t stats;
+            store_forward_get_stats(&stats);
+            ESP_LOGI(MQTT_TAG, "Backlog replayed: %lu sent, %lu overwritten, %lu corrupt since boot",
+                     stats.replayed, stats.dropped_overwritten, stats.corrupt);
+        }
+    }
+}
+
+static void mqtt_batch_publish(const char *topic, const char *payload)
+{
+    mqtt_publish_class(MQTT_CLASS_TELEMETRY, topic, payload);
+}
+
 /**
  * @brief TASK publish JSON messages to MQTT
- * @details This task waits for JSON messages from the UART task and publishes them to MQTT.
+ * @details Telemetry is coalesced into one publish per MQTT_BATCH_MAX_ITEMS readings, MQTT_BATCH_MAX_BYTES
+ *          or MQTT_BATCH_FLUSH_MS, whichever comes first. Other classes are published at once.
+ *          Messages that cannot be published go to flash and are replayed after reconnect, at most one
+ *          per STORE_REPLAY_INTERVAL_MS and only when no live message is waiting in json_queue, so live
+ *          data goes first but a steady live stream does not hold the backlog back. Flash writes and
+ *          erases run here, never in uart_receive_decode_task. Connectivity comes from the wifi_config
+ *          event group, the task never polls it.
  *
  * @param pvParameters
  */
@@ -166,45 +735,248 @@ void mqtt_publish_task(void *pvParameters)
 {
     ESP_LOGI(MQTT_TAG, "MQTT Publish Task Started\n");
     mqtt_message_t mqtt_msg;
+    const mqtt_batch_config_t batch_cfg = {
+        .buf = batch_buf,
+        .size = sizeof(batch_buf),
+        .max_items = MQTT_BATCH_MAX_ITEMS,
+        .max_age_ms = MQTT_BATCH_FLUSH_MS,
+        .publish = mqtt_batch_publish,
+    };
+    mqtt_batch_init(&telemetry_batch, &batch_cfg);
 
     while (1)
     {
-        if (xQueueReceive(json_queue, &mqtt_msg, portMAX_DELAY) == pdTRUE)
+        TickType_t now = xTaskGetTickCount();
+        TickType_t wait = portMAX_DELAY;
+        uint32_t batch_due_ms = mqtt_batch_due_in_ms(&telemetry_batch, now * portTICK_PERIOD_MS);
+        if (batch_due_ms != MQTT_BATCH_NEVER)
+        {
+            wait = (batch_due_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+        }
+
+        // Backlog: at most one message per replay period, and only when json_queue is empty at that
+        // moment (a waiting live message is always taken first, a steady live stream does not block it)
+        bool replay = store_ready && store_forward_pending() > 0 && wifi_config_mqtt_up();
+        if (replay)
         {
-            if (wifi_config_get_state() == WIFI_STATE_MQTT_CONNECTED)
+            TickType_t since = now - replay_last;
+            TickType_t period = pdMS_TO_TICKS(STORE_REPLAY_INTERVAL_MS);
+            TickType_t replay_wait = (since < period) ? period - since : 0;
+            wait = (replay_wait < wait) ? replay_wait : wait;
+        }
+
+        // Also woken by mqtt_up_signal, the backlog starts going out right after a reconnect
+        QueueSetMemberHandle_t ready = xQueueSelectFromSet(publish_set, wait);
+        if (ready == mqtt_up_signal)
+        {
+            xSemaphoreTake(mqtt_up_signal, 0);
+            continue;
+        }
+        if (ready != json_queue || xQueueReceive(json_queue, &mqtt_msg, 0) != pdTRUE)
+        {
+            now = xTaskGetTickCount();
+            if (mqtt_batch_due_in_ms(&telemetry_batch, now * portTICK_PERIOD_MS) == 0)
             {
-                ESP_LOGI(MQTT_TAG, "Publishing to %s: %s", mqtt_msg.topic, mqtt_msg.json_data);
-                my_mqtt_pub(mqtt_msg.topic, mqtt_msg.json_data);
+                mqtt_batch_flush(&telemetry_batch, now * portTICK_PERIOD_MS);
             }
-            else
+            if (replay && now - replay_last >= pdMS_TO_TICKS(STORE_REPLAY_INTERVAL_MS))
             {
-                ESP_LOGW(MQTT_TAG, "Not connected to MQTT, dropping message.");
+                mqtt_replay_one();
             }
+            continue;
+        }
+        metric_observe(&gw_metrics.queue_wait_ms, pdTICKS_TO_MS(xTaskGetTickCount() - mqtt_msg.stamp));
+
+        if (mqtt_msg.msg_class == MQTT_CLASS_TELEMETRY)
+        {
+            mqtt_publish_sensor_topics(&mqtt_msg.sensors);
+        }
+
+        if (mqtt_msg.msg_class != MQTT_CLASS_TELEMETRY)
+        {
+            mqtt_publish_class(mqtt_msg.msg_class, mqtt_msg.topic, mqtt_msg.json_data);
+        }
+        else if (MQTT_BATCH_MAX_ITEMS <= 1)
+        {
+            char payload[sizeof(mqtt_msg.json_data) + 40];
+            snprintf(payload, sizeof(payload), "{\"type\":\"telemetry\",\"data\":%s}", mqtt_msg.json_data);
+            mqtt_publish_class(MQTT_CLASS_TELEMETRY, mqtt_msg.topic, payload);
+        }
+        else
+        {
+            mqtt_batch_add(&telemetry_batch, mqtt_msg.topic, mqtt_msg.json_data, mqtt_msg.stamp * portTICK_PERIOD_MS,
+                           xTaskGetTickCount() * portTICK_PERIOD_MS);
+        }
+    }
+}
+
+#if MQTT_LOOPBACK_BENCH
+// Loopback benchmark: the bench task plays both the UART side (readings into json_queue) and the
+// server (subscribed to topic_pub on the in-process broker, publishing control requests)
+static int64_t bench_sent_us[MQTT_LOOPBACK_BENCH_COUNT];
+static uint32_t bench_latency_us[MQTT_LOOPBACK_BENCH_COUNT];
+static volatile uint32_t bench_received = 0;
+static SemaphoreHandle_t bench_reply;
+
+/**
+ * @brief Server side of the bench, runs in the publisher task (inside my_mqtt_pub_opts)
+ * @details Telemetry: every "bench":k of a batch is reading k. Control: a report_policy reply answers
+ *          the pending request.
+ */
+static void bench_on_server_message(void *ctx, const char *topic, int topic_len, const void *data, int len, int qos,
+                                    bool retained)
+{
+    static const char key[] = "\"bench\":";
+    const char *p = data;
+    const char *end = p + len;
+    int64_t now = esp_timer_get_time();
+
+    if (retained)
+    {
+        return; // alert left on the topic by an earlier run
+    }
+    if (ctx != NULL)
+    {
+        if (len > 0 && strstr(data, "\"report_policy\"") != NULL) // payloads of my_mqtt_pub_opts end with '\0'
+        {
+            xSemaphoreGive(bench_reply);
+        }
+        return;
+    }
+
+    while (end - p > (int)sizeof(key) - 1)
+    {
+        if (memcmp(p, key, sizeof(key) - 1) != 0)
+        {
+            p++;
+            continue;
+        }
+        p += sizeof(key) - 1;
+        uint32_t k = (uint32_t)strtoul(p, NULL, 10);
+        if (k < MQTT_LOOPBACK_BENCH_COUNT && bench_received < MQTT_LOOPBACK_BENCH_COUNT)
+        {
+            bench_latency_us[bench_received++] = (uint32_t)(now - bench_sent_us[k]);
+        }
+    }
+}
+
+static void bench_log(const char *name, uint32_t count, int64_t elapsed_us)
+{
+    mqtt_bench_result_t r;
+    mqtt_bench_result(bench_latency_us, count, (uint64_t)elapsed_us, &r);
+    ESP_LOGI(MAIN_TAG, "[BENCH] %s: %lu msgs, p50 %lu us, p99 %lu us, max %lu us, %lu msgs/s", name, r.count, r.p50_us,
+             r.p99_us, r.max_us, r.msgs_per_s);
+}
+
+/**
+ * @brief TASK loopback benchmark, once after start
+ * @details 1) telemetry: readings pushed into json_queue as fast as it takes them, latency to the batch
+ *          publish that carries each one (includes MQTT_BATCH_FLUSH_MS for the last partial batch);
+ *          2) control: home/gateway/report/get -> receive task -> json_queue -> publisher -> reply, closed loop.
+ */
+static void mqtt_loopback_bench_task(void *pvParameters)
+{
+    bench_reply = xSemaphoreCreateBinary();
+    int sub_tlm = mqtt_loopback_subscribe(mqtt_cfg.topic_pub, 0, bench_on_server_message, NULL);
+    if (!bench_reply || sub_tlm < 0)
+    {
+        ESP_LOGE(MAIN_TAG, "[BENCH] setup failed");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    // 1) Telemetry
+    int64_t start = esp_timer_get_time();
+    for (uint32_t k = 0; k < MQTT_LOOPBACK_BENCH_COUNT; k++)
+    {
+        mqtt_message_t msg = {
+            .msg_class = MQTT_CLASS_TELEMETRY,
+            .stamp = xTaskGetTickCount(),
+        };
+        snprintf(msg.json_data, sizeof(msg.json_data), "{\"bench\":%lu}", k);
+        strncpy(msg.topic, mqtt_cfg.topic_pub, sizeof(msg.topic) - 1);
+        bench_sent_us[k] = esp_timer_get_time();
+        xQueueSend(json_queue, &msg, portMAX_DELAY);
+    }
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(MQTT_BATCH_FLUSH_MS + MQTT_LOOPBACK_BENCH_TIMEOUT_MS);
+    while (bench_received < MQTT_LOOPBACK_BENCH_COUNT && xTaskGetTickCount() < deadline)
+    {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    bench_log("telemetry", bench_received, esp_timer_get_time() - start);
+    mqtt_loopback_unsubscribe(sub_tlm);
+
+    // 2) Control round trip
+    int sub_ctl = mqtt_loopback_subscribe(mqtt_cfg.topic_pub, 0, bench_on_server_message, (void *)1);
+    uint32_t done = 0;
+    start = esp_timer_get_time();
+    for (uint32_t k = 0; k < MQTT_LOOPBACK_BENCH_COUNT; k++)
+    {
+        int64_t sent = esp_timer_get_time();
+        mqtt_loopback_publish(TOPIC_ROOT "/gateway/report/get", "", 0, 1, false);
+        if (xSemaphoreTake(bench_reply, pdMS_TO_TICKS(MQTT_LOOPBACK_BENCH_TIMEOUT_MS)) != pdTRUE)
+        {
+            ESP_LOGW(MAIN_TAG, "[BENCH] control reply %lu timed out", k);
+            break;
         }
+        bench_latency_us[done++] = (uint32_t)(esp_timer_get_time() - sent);
     }
+    bench_log("control", done, esp_timer_get_time() - start);
+    mqtt_loopback_unsubscribe(sub_ctl);
+
+    mqtt_loopback_stats_t stats;
+    mqtt_loopback_get_stats(&stats);
+    ESP_LOGI(MAIN_TAG, "[BENCH] broker: %lu published, %lu delivered", stats.published, stats.delivered);
+    vTaskDelete(NULL);
 }
+#endif
 
 void app_main(void)
 {
+    message_set_integrity_mode(UART_INTEGRITY_MODE);
     uart_init_with_fsm(UART_BAUD_RATE, UART_TX_PIN, UART_RX_PIN);
     ESP_LOGI(MAIN_TAG, "UART initialized.");
 
+    // Follow the master's baud negotiation from boot, independent of WiFi/MQTT
+    uart_link_start(UART_LINK_ROLE_RESPONDER);
+    uart_arq_init(uart_handle_payload);
+    // Backlog from a previous outage is kept across resets
+    store_ready = store_forward_init() == ESP_OK;
+    if (!store_ready)
+    {
+        ESP_LOGW(MAIN_TAG, "No store-and-forward partition, messages are dropped while offline.");
+    }
+    json_queue = xQueueCreate(JSON_QUEUE_LEN, sizeof(mqtt_message_t));
+    mqtt_up_signal = xSemaphoreCreateBinary();
+    publish_set = xQueueCreateSet(JSON_QUEUE_LEN + 1);
+    if (!json_queue || !mqtt_up_signal || !publish_set)
+    {
+        ESP_LOGE(MAIN_TAG, "Failed to create JSON queue!");
+        return;
+    }
+    // Members must be empty when added, before the UART task starts producing
+    xQueueAddToSet(json_queue, publish_set);
+    xQueueAddToSet(mqtt_up_signal, publish_set);
+    // Defaults until NVS is up (wifi_config_start), the stored policy is loaded below
+    report_policy_init();
+    // Before the WiFi manager, its station HTTP server is started with /metrics on it
+    gateway_metrics_init();
+    xTaskCreate(uart_receive_decode_task, "uart_rx_decode", 4096, NULL, 5, NULL);
+
     // Start the WiFi manager
     ESP_LOGI(MAIN_TAG, "Starting WiFi Manager...");
     wifi_config_start(wifi_connected_callback);
+    report_policy_load();
 
     // Start LED status task AFTER wifi_config_start to ensure mutex is created
     xTaskCreate(led_status_task, "led_status", 2048, NULL, 2, NULL);
 
     // Wait until WiFi is connected or AP mode is active
     ESP_LOGI(MAIN_TAG, "Waiting for WiFi connection or AP mode...");
-    while (wifi_config_get_state() != WIFI_STATE_CONNECTED && wifi_config_get_state() != WIFI_STATE_AP_MODE)
-    {
-        vTaskDelay(pdMS_TO_TICKS(500));
-    }
+    EventBits_t bits = wifi_config_wait(CONN_BIT_IP | CONN_BIT_PORTAL, portMAX_DELAY);
 
     // If we are in AP mode, we don't proceed to connect MQTT.
-    if (wifi_config_get_state() == WIFI_STATE_AP_MODE)
+    if (bits & CONN_BIT_PORTAL)
     {
         ESP_LOGI(MAIN_TAG, "Device is in AP Mode. Halting main task.");
         // The device will restart when configured via web page.
@@ -215,25 +987,43 @@ void app_main(void)
     ESP_LOGI(MAIN_TAG, "WiFi is ready! Proceeding with MQTT connection.");
 
     // Connect to MQTT
+#if MQTT_LOOPBACK_BENCH
+    strncpy(mqtt_cfg.server, MQTT_LOOPBACK_URI, sizeof(mqtt_cfg.server) - 1);
+#endif
     ESP_LOGI(MAIN_TAG, "Connecting to MQTT broker: %s", mqtt_cfg.server);
-    // Link the on_mqtt_connected callback to the mqtt component
+    // Link the connection callbacks to the mqtt component
     mqtt_cfg.on_connected_cb = on_mqtt_connected;
+    mqtt_cfg.on_disconnected_cb = on_mqtt_disconnected;
+    // Control topics: compiled once, the receive task only walks the trie
+    const topic_route_t control_routes[] = {
+        {mqtt_cfg.topic_sub, TOPIC_ACTION_JSON_CONTROL, 0, 0},             // legacy JSON commands
+        {TOPIC_ROOT "/gateway/report/set", TOPIC_ACTION_REPORT_SET, 0, 0}, // deadbands / intervals
+        {TOPIC_ROOT "/gateway/report/get", TOPIC_ACTION_REPORT_GET, 0, 0}, // policy + counters
+    };
+    topic_router_init(TOPIC_ROOT);
+    for (size_t i = 0; i < sizeof(control_routes) / sizeof(control_routes[0]); i++)
+    {
+        topic_router_add(&control_routes[i]);
+    }
+    // Overlapping subscriptions would get the same message twice from the broker
+    int extra = 0;
+    for (int i = 0; i < topic_router_route_count() && extra < MY_MQTT_MAX_EXTRA_SUBS; i++)
+    {
+        if (!topic_router_filter_covered(i))
+        {
+            mqtt_cfg.topic_sub_extra[extra++] = topic_router_filter(i);
+        }
+    }
     esp_err_t err_mqtt = my_mqtt_init(&mqtt_cfg);
     if (err_mqtt != ESP_OK)
     {
         ESP_LOGE(MAIN_TAG, "MQTT init failed!");
-        wifi_config_set_state(WIFI_STATE_ERROR);
+        wifi_config_notify(CONN_EVT_ERROR);
     }
 
     // Wait for MQTT to be connected. The state will be set in the callback.
-    int mqtt_retry = 0;
-    while (wifi_config_get_state() != WIFI_STATE_MQTT_CONNECTED && mqtt_retry < 60)
-    {
-        vTaskDelay(pdMS_TO_TICKS(500));
-        mqtt_retry++;
-    }
-
-    if (wifi_config_get_state() == WIFI_STATE_MQTT_CONNECTED)
+    bits = wifi_config_wait(CONN_BIT_MQTT, pdMS_TO_TICKS(MQTT_CONNECT_TIMEOUT_MS));
+    if (bits & CONN_BIT_MQTT)
     {
         ESP_LOGI(MAIN_TAG, "System is fully operational (WiFi + MQTT).");
     }
@@ -243,18 +1033,12 @@ void app_main(void)
         // The LED task will handle the visual state
     }
 
-    // Create queues
-    json_queue = xQueueCreate(10, sizeof(mqtt_message_t));
-    if (!json_queue)
-    {
-        ESP_LOGE(MAIN_TAG, "Failed to create JSON queue!");
-        return;
-    }
-
     ESP_LOGI(MAIN_TAG, "Starting application tasks...");
-    xTaskCreate(uart_receive_decode_task, "uart_rx_decode", 4096, NULL, 5, NULL);
     xTaskCreate(mqtt_publish_task, "mqtt_publish", 4096, NULL, 4, NULL);
     xTaskCreate(mqtt_receive_control_task, "mqtt_rx_control", 4096, NULL, 4, NULL);
+#if MQTT_LOOPBACK_BENCH
+    xTaskCreate(mqtt_loopback_bench_task, "mqtt_bench", 4096, NULL, 3, NULL);
+#endif
 
     ESP_LOGI(MAIN_TAG, "System setup complete.");
 }
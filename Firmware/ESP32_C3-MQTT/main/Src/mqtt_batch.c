@@ -0,0 +1,93 @@
+#include "mqtt_batch.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "MQTT_BATCH";
+
+// Room kept for the closing "],"age_ms":4294967295}"
+#define BATCH_TAIL 24
+
+/**
+ * @brief Format one item in place behind the last one, nothing is written if it does not fit
+ */
+static bool batch_append(mqtt_batch_t *b, const char *data, uint32_t stamp_ms)
+{
+    uint32_t dt_ms = b->count ? stamp_ms - b->first_ms : 0;
+    int room = (int)b->cfg.size - (int)b->len - BATCH_TAIL;
+    if (room <= 0)
+    {
+        return false;
+    }
+
+    int n = snprintf(&b->cfg.buf[b->len], (size_t)room, "%s{\"dt\":%lu,\"data\":%s}", b->count ? "," : "",
+                     (unsigned long)dt_ms, data);
+    if (n < 0 || n >= room)
+    {
+        b->cfg.buf[b->len] = '\0';
+        return false;
+    }
+    b->len += (uint16_t)n;
+    b->count++;
+    return true;
+}
+
+void mqtt_batch_init(mqtt_batch_t *b, const mqtt_batch_config_t *cfg)
+{
+    memset(b, 0, sizeof(*b));
+    b->cfg = *cfg;
+}
+
+void mqtt_batch_flush(mqtt_batch_t *b, uint32_t now_ms)
+{
+    if (b->count == 0)
+    {
+        return;
+    }
+
+    snprintf(&b->cfg.buf[b->len], b->cfg.size - b->len, "],\"age_ms\":%lu}", (unsigned long)(now_ms - b->first_ms));
+    b->cfg.publish(b->topic, b->cfg.buf);
+    b->len = 0;
+    b->count = 0;
+}
+
+bool mqtt_batch_add(mqtt_batch_t *b, const char *topic, const char *data, uint32_t stamp_ms, uint32_t now_ms)
+{
+    if (b->count > 0 && strcmp(b->topic, topic) != 0)
+    {
+        mqtt_batch_flush(b, now_ms);
+    }
+    if (b->count > 0 && !batch_append(b, data, stamp_ms))
+    {
+        mqtt_batch_flush(b, now_ms);
+    }
+
+    if (b->count == 0)
+    {
+        b->first_ms = stamp_ms;
+        snprintf(b->topic, sizeof(b->topic), "%s", topic);
+        b->len = (uint16_t)snprintf(b->cfg.buf, b->cfg.size, "{\"type\":\"telemetry\",\"batch\":[");
+        if (!batch_append(b, data, stamp_ms))
+        {
+            ESP_LOGW(TAG, "Reading of %u bytes does not fit a batch, dropped", (unsigned)strlen(data));
+            b->len = 0;
+            return false;
+        }
+    }
+
+    if (b->count >= b->cfg.max_items)
+    {
+        mqtt_batch_flush(b, now_ms);
+    }
+    return true;
+}
+
+uint32_t mqtt_batch_due_in_ms(const mqtt_batch_t *b, uint32_t now_ms)
+{
+    if (b->count == 0)
+    {
+        return MQTT_BATCH_NEVER;
+    }
+    uint32_t age = now_ms - b->first_ms;
+    return (age < b->cfg.max_age_ms) ? b->cfg.max_age_ms - age : 0;
+}
@@ -0,0 +1,351 @@
+#include "topic_router.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "TOPIC_ROUTER";
+
+#define TOPIC_NONE 0xFF
+
+typedef struct
+{
+    const char *seg;   // points into the route filter
+    uint8_t seg_len;
+    uint8_t child;     // first exact child
+    uint8_t sibling;   // next exact child of the parent
+    uint8_t plus;      // '+' child
+    uint8_t hash;      // route of a '#' level below this one ("a/#" also matches "a")
+    uint8_t route;     // route ending at this level
+} topic_trie_node_t;
+
+typedef struct
+{
+    uint8_t pos;
+    uint8_t len;
+} topic_capture_t;
+
+static topic_trie_node_t trie[TOPIC_TRIE_MAX_NODES];
+static uint8_t trie_used = 0;
+static topic_route_t routes[TOPIC_MAX_ROUTES];
+static uint8_t route_count = 0;
+static char sensor_topics[TOPIC_MAX_NODES][TOPIC_SENSOR_COUNT][TOPIC_MAX_LEN];
+
+static const char *const sensor_names[TOPIC_SENSOR_COUNT] = {
+    [TOPIC_SENSOR_LUX] = "lux",
+    [TOPIC_SENSOR_TEMP] = "temp",
+    [TOPIC_SENSOR_HUMI] = "humi",
+};
+
+static uint8_t trie_new_node(const char *seg, uint8_t seg_len)
+{
+    if (trie_used >= TOPIC_TRIE_MAX_NODES)
+    {
+        return TOPIC_NONE;
+    }
+    trie[trie_used] = (topic_trie_node_t){
+        .seg = seg,
+        .seg_len = seg_len,
+        .child = TOPIC_NONE,
+        .sibling = TOPIC_NONE,
+        .plus = TOPIC_NONE,
+        .hash = TOPIC_NONE,
+        .route = TOPIC_NONE,
+    };
+    return trie_used++;
+}
+
+void topic_router_init(const char *root)
+{
+    for (int node = 0; node < TOPIC_MAX_NODES; node++)
+    {
+        for (int s = 0; s < TOPIC_SENSOR_COUNT; s++)
+        {
+            snprintf(sensor_topics[node][s], TOPIC_MAX_LEN, "%s/node%d/%s", root, node, sensor_names[s]);
+        }
+    }
+
+    trie_used = 0;
+    route_count = 0;
+    trie_new_node("", 0); // root, level before the first '/'
+}
+
+bool topic_router_add(const topic_route_t *route)
+{
+    if (route_count >= TOPIC_MAX_ROUTES || route->filter == NULL || route->filter[0] == '\0')
+    {
+        ESP_LOGE(TAG, "Cannot add route '%s'", route->filter ? route->filter : "");
+        return false;
+    }
+
+    uint8_t index = route_count;
+    uint8_t cur = 0;
+    int plus_levels = 0;
+    const char *p = route->filter;
+
+    while (1)
+    {
+        const char *slash = strchr(p, '/');
+        size_t seg_len = slash ? (size_t)(slash - p) : strlen(p);
+
+        if (seg_len == 1 && p[0] == '#')
+        {
+            if (slash != NULL || trie[cur].hash != TOPIC_NONE)
+            {
+                ESP_LOGE(TAG, "'#' must be the last level of '%s' and unique", route->filter);
+                return false;
+            }
+            trie[cur].hash = index;
+            break;
+        }
+
+        uint8_t next;
+        if (seg_len == 1 && p[0] == '+')
+        {
+            if (trie[cur].plus == TOPIC_NONE)
+            {
+                trie[cur].plus = trie_new_node(p, 1);
+            }
+            next = trie[cur].plus;
+            plus_levels++;
+        }
+        else
+        {
+            if (seg_len > 0xFF || memchr(p, '+', seg_len) != NULL || memchr(p, '#', seg_len) != NULL)
+            {
+                ESP_LOGE(TAG, "Bad level in '%s'", route->filter);
+                return false;
+            }
+            next = trie[cur].child;
+            while (next != TOPIC_NONE && !(trie[next].seg_len == seg_len && memcmp(trie[next].seg, p, seg_len) == 0))
+            {
+                next = trie[next].sibling;
+            }
+            if (next == TOPIC_NONE)
+            {
+                next = trie_new_node(p, (uint8_t)seg_len);
+                if (next != TOPIC_NONE)
+                {
+                    trie[next].sibling = trie[cur].child;
+                    trie[cur].child = next;
+                }
+            }
+        }
+
+        if (next == TOPIC_NONE)
+        {
+            ESP_LOGE(TAG, "Trie full, route '%s' dropped", route->filter);
+            return false;
+        }
+        cur = next;
+
+        if (slash == NULL)
+        {
+            if (trie[cur].route != TOPIC_NONE)
+            {
+                ESP_LOGE(TAG, "Duplicate route '%s'", route->filter);
+                return false;
+            }
+            trie[cur].route = index;
+            break;
+        }
+        p = slash + 1;
+    }
+
+    // Checked last, a rejected route may leave unused trie levels behind (init time only)
+    if ((route->node < 0 && -1 - route->node >= plus_levels) || (route->plug < 0 && -1 - route->plug >= plus_levels))
+    {
+        ESP_LOGE(TAG, "Route '%s' uses a capture it does not have", route->filter);
+        if (trie[cur].route == index)
+        {
+            trie[cur].route = TOPIC_NONE;
+        }
+        if (trie[cur].hash == index)
+        {
+            trie[cur].hash = TOPIC_NONE;
+        }
+        return false;
+    }
+
+    routes[index] = *route;
+    route_count++;
+    return true;
+}
+
+const char *topic_router_sensor_topic(uint8_t node, topic_sensor_t sensor)
+{
+    if (node >= TOPIC_MAX_NODES || sensor >= TOPIC_SENSOR_COUNT)
+    {
+        return NULL;
+    }
+    return sensor_topics[node][sensor];
+}
+
+/**
+ * @brief Match the levels from pos on below trie node n
+ * @return route index, -1 if nothing matched
+ */
+static int trie_match(uint8_t n, const char *topic, int len, int pos, topic_capture_t *caps, int ncap)
+{
+    const topic_trie_node_t *node = &trie[n];
+
+    if (pos > len)
+    {
+        // Topic ended at this level
+        if (node->route != TOPIC_NONE)
+        {
+            return node->route;
+        }
+        return node->hash != TOPIC_NONE ? node->hash : -1;
+    }
+
+    int end = pos;
+    while (end < len && topic[end] != '/')
+    {
+        end++;
+    }
+    int seg_len = end - pos;
+
+    for (uint8_t c = node->child; c != TOPIC_NONE; c = trie[c].sibling)
+    {
+        if (trie[c].seg_len == seg_len && memcmp(trie[c].seg, &topic[pos], seg_len) == 0)
+        {
+            int r = trie_match(c, topic, len, end + 1, caps, ncap);
+            if (r >= 0)
+            {
+                return r;
+            }
+            break;
+        }
+    }
+
+    // Wildcards at the first level never match "$SYS/..." style topics
+    bool wildcard_ok = !(n == 0 && pos == 0 && len > 0 && topic[0] == '$');
+    if (wildcard_ok && node->plus != TOPIC_NONE && ncap < TOPIC_MAX_CAPTURES)
+    {
+        caps[ncap].pos = (uint8_t)pos;
+        caps[ncap].len = (uint8_t)seg_len;
+        int r = trie_match(node->plus, topic, len, end + 1, caps, ncap + 1);
+        if (r >= 0)
+        {
+            return r;
+        }
+    }
+    return (wildcard_ok && node->hash != TOPIC_NONE) ? node->hash : -1;
+}
+
+/**
+ * @brief Route field from a fixed value or the trailing number of a captured level
+ */
+static bool route_field(int8_t spec, const char *topic, const topic_capture_t *caps, uint8_t *out)
+{
+    if (spec >= 0)
+    {
+        *out = (uint8_t)spec;
+        return true;
+    }
+
+    const topic_capture_t *cap = &caps[-1 - spec];
+    int start = cap->pos + cap->len;
+    while (start > cap->pos && topic[start - 1] >= '0' && topic[start - 1] <= '9')
+    {
+        start--;
+    }
+    int digits = cap->pos + cap->len - start;
+    if (digits == 0 || digits > 3)
+    {
+        return false;
+    }
+
+    unsigned value = 0;
+    for (int i = start; i < cap->pos + cap->len; i++)
+    {
+        value = value * 10 + (unsigned)(topic[i] - '0');
+    }
+    if (value > 0xFF)
+    {
+        return false;
+    }
+    *out = (uint8_t)value;
+    return true;
+}
+
+bool topic_router_match(const char *topic, int topic_len, topic_match_t *out)
+{
+    topic_capture_t caps[TOPIC_MAX_CAPTURES];
+
+    if (topic == NULL || topic_len <= 0 || topic_len > 0xFF || trie_used == 0)
+    {
+        return false;
+    }
+
+    int r = trie_match(0, topic, topic_len, 0, caps, 0);
+    if (r < 0)
+    {
+        return false;
+    }
+
+    const topic_route_t *route = &routes[r];
+    out->action = route->action;
+    return route_field(route->node, topic, caps, &out->node) && route_field(route->plug, topic, caps, &out->plug);
+}
+
+int topic_router_route_count(void)
+{
+    return route_count;
+}
+
+const char *topic_router_filter(int index)
+{
+    return (index >= 0 && index < route_count) ? routes[index].filter : NULL;
+}
+
+/**
+ * @brief true if every topic matched by filter b is also matched by filter a
+ */
+static bool filter_covers(const char *a, const char *b)
+{
+    while (1)
+    {
+        const char *a_end = strchr(a, '/');
+        const char *b_end = strchr(b, '/');
+        size_t a_len = a_end ? (size_t)(a_end - a) : strlen(a);
+        size_t b_len = b_end ? (size_t)(b_end - b) : strlen(b);
+
+        if (a_len == 1 && a[0] == '#')
+        {
+            return true;
+        }
+        if (b_len == 1 && b[0] == '#')
+        {
+            return false;
+        }
+        if (!(a_len == 1 && a[0] == '+') && !(a_len == b_len && memcmp(a, b, a_len) == 0))
+        {
+            return false;
+        }
+        if (a_end == NULL || b_end == NULL)
+        {
+            // "a/#" also matches "a"
+            return (a_end == NULL && b_end == NULL) || (b_end == NULL && strcmp(a_end + 1, "#") == 0);
+        }
+        a = a_end + 1;
+        b = b_end + 1;
+    }
+}
+
+bool topic_router_filter_covered(int index)
+{
+    if (index < 0 || index >= route_count)
+    {
+        return false;
+    }
+    for (int i = 0; i < route_count; i++)
+    {
+        // Identical filters cannot be added twice, so two routes never cover each other
+        if (i != index && filter_covers(routes[i].filter, routes[index].filter))
+        {
+            return true;
+        }
+    }
+    return false;
+}
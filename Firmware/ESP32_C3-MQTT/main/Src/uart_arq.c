@@ -0,0 +1,486 @@
+#include "uart_arq.h"
+#include "uart_link.h"
+#include "uart_protocol.h"
+#include "fsm.h"
+#include "message.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+#if (UART_ARQ_WINDOW & (UART_ARQ_WINDOW - 1)) || UART_ARQ_WINDOW > 16
+#error "UART_ARQ_WINDOW must be a power of two <= 16"
+#endif
+
+static const char *TAG = "UART_ARQ";
+
+#define ARQ_HEADER_SIZE 4 // [epoch, seq, base, inner_type]
+#define ARQ_FRAME_SIZE (FRAME_HEADER_SIZE + ARQ_HEADER_SIZE + UART_ARQ_MAX_PAYLOAD + 2)
+#define ARQ_SLOT(seq) ((uint8_t)(seq) & (UART_ARQ_WINDOW - 1))
+
+typedef struct
+{
+    bool used;
+    uint8_t seq;
+    uint8_t retries;
+    TickType_t sent_at; // Last transmission
+    uart_arq_done_t done;
+    uint32_t tag;
+    uint16_t length;
+    uint8_t frame[ARQ_FRAME_SIZE];
+} arq_tx_slot_t;
+
+typedef struct
+{
+    bool present;
+    uint8_t type;
+    uint16_t length;
+    uint8_t data[UART_ARQ_MAX_PAYLOAD];
+} arq_rx_slot_t;
+
+// Completion noted under arq_mutex, the callback runs after it is released
+typedef struct
+{
+    uart_arq_done_t done;
+    uint32_t tag;
+    uart_arq_result_t result;
+} arq_report_t;
+
+static SemaphoreHandle_t arq_mutex = NULL;
+static SemaphoreHandle_t arq_window_sem = NULL; // Given when tx_base moves, wakes a sender waiting on a full window
+static uart_arq_rx_handler_t arq_rx_handler = NULL;
+static uart_arq_stats_t arq_stats;
+
+// TX side, protected by arq_mutex
+static arq_tx_slot_t tx_slots[UART_ARQ_WINDOW];
+// Retransmits staged by the timer task under arq_mutex, sent after releasing it (timer task only)
+static uint8_t retx_frames[UART_ARQ_WINDOW][ARQ_FRAME_SIZE];
+static uint16_t retx_lengths[UART_ARQ_WINDOW];
+static uint8_t tx_epoch;
+static uint8_t tx_next_seq;
+static uint8_t tx_base; // Oldest seq not yet acked or given up
+static uint32_t rttvar_ms;
+
+// RX side, only touched from the UART RX dispatch task
+static arq_rx_slot_t rx_slots[UART_ARQ_WINDOW];
+static bool rx_synced = false;
+static uint8_t rx_epoch;
+static uint8_t rx_expected;
+
+// ======================= TX =======================
+/**
+ * @brief Rewrite the base byte and the trailing check, and copy the frame out for sending
+ * @details Called with arq_mutex held. uart_link_send() can block (link busy, rate switch), so the copy
+ *          goes on the wire only after the mutex is released and ACKs keep being processed meanwhile.
+ * @return Frame length
+ */
+static uint16_t arq_stage(arq_tx_slot_t *slot, uint8_t *out)
+{
+    slot->frame[FRAME_HEADER_SIZE + 2] = tx_base;
+    message_append_integrity(slot->frame, slot->length - 2);
+    slot->sent_at = xTaskGetTickCount();
+    memcpy(out, slot->frame, slot->length);
+    return slot->length;
+}
+
+static void arq_advance_base(void)
+{
+    uint8_t old_base = tx_base;
+    while (tx_base != tx_next_seq && !tx_slots[ARQ_SLOT(tx_base)].used)
+    {
+        tx_base++;
+    }
+    if (tx_base != old_base)
+    {
+        xSemaphoreGive(arq_window_sem);
+    }
+}
+
+static void arq_release(arq_tx_slot_t *slot, uart_arq_result_t result, arq_report_t *reports, int *report_count)
+{
+    if (slot->done)
+    {
+        reports[(*report_count)++] = (arq_report_t){slot->done, slot->tag, result};
+    }
+    slot->used = false;
+    arq_stats.in_flight--;
+}
+
+static void arq_report(const arq_report_t *reports, int report_count)
+{
+    for (int i = 0; i < report_count; i++)
+    {
+        reports[i].done(reports[i].result, reports[i].tag);
+    }
+}
+
+/**
+ * @brief SRTT/RTTVAR smoothing with RTO = SRTT + 4 * RTTVAR
+ */
+static void arq_rtt_sample(uint32_t rtt_ms)
+{
+    arq_stats.rtt_last_ms = rtt_ms;
+    if (arq_stats.rtt_min_ms == 0 || rtt_ms < arq_stats.rtt_min_ms)
+        arq_stats.rtt_min_ms = rtt_ms;
+    if (rtt_ms > arq_stats.rtt_max_ms)
+        arq_stats.rtt_max_ms = rtt_ms;
+
+    if (arq_stats.srtt_ms == 0)
+    {
+        arq_stats.srtt_ms = rtt_ms;
+        rttvar_ms = rtt_ms / 2;
+    }
+    else
+    {
+        uint32_t diff = (rtt_ms > arq_stats.srtt_ms) ? rtt_ms - arq_stats.srtt_ms : arq_stats.srtt_ms - rtt_ms;
+        rttvar_ms = (3 * rttvar_ms + diff) / 4;
+        arq_stats.srtt_ms = (7 * arq_stats.srtt_ms + rtt_ms) / 8;
+    }
+
+    uint32_t rto = arq_stats.srtt_ms + 4 * rttvar_ms;
+    if (rto < UART_ARQ_RTO_MIN_MS)
+        rto = UART_ARQ_RTO_MIN_MS;
+    if (rto > UART_ARQ_RTO_MAX_MS)
+        rto = UART_ARQ_RTO_MAX_MS;
+    arq_stats.rto_ms = rto;
+}
+
+static void arq_ack_slot(arq_tx_slot_t *slot, TickType_t now, arq_report_t *reports, int *report_count)
+{
+    // Karn: a retransmitted frame gives an ambiguous RTT
+    if (slot->retries == 0)
+    {
+        arq_rtt_sample((uint32_t)((now - slot->sent_at) * portTICK_PERIOD_MS));
+    }
+    arq_stats.acked++;
+    arq_release(slot, UART_ARQ_DELIVERED, reports, report_count);
+}
+
+static void arq_timer_task(void *pvParameters)
+{
+    (void)pvParameters;
+
+    while (1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(UART_ARQ_TICK_MS));
+
+        arq_tx_slot_t *due[UART_ARQ_WINDOW];
+        int due_count = 0;
+        arq_report_t reports[UART_ARQ_WINDOW];
+        int report_count = 0;
+
+        xSemaphoreTake(arq_mutex, portMAX_DELAY);
+        TickType_t now = xTaskGetTickCount();
+        for (int i = 0; i < UART_ARQ_WINDOW; i++)
+        {
+            arq_tx_slot_t *slot = &tx_slots[i];
+            if (!slot->used)
+            {
+                continue;
+            }
+
+            // Exponential backoff per retry
+            uint32_t rto_ms = arq_stats.rto_ms << slot->retries;
+            if (rto_ms > UART_ARQ_RTO_MAX_MS)
+                rto_ms = UART_ARQ_RTO_MAX_MS;
+            if ((now - slot->sent_at) < pdMS_TO_TICKS(rto_ms))
+            {
+                continue;
+            }
+
+            if (slot->retries >= UART_ARQ_MAX_RETRIES)
+            {
+                ESP_LOGW(TAG, "seq %u given up after %u retries", slot->seq, slot->retries);
+                arq_stats.failed++;
+                arq_release(slot, UART_ARQ_GIVEN_UP, reports, &report_count);
+                continue;
+            }
+
+            slot->retries++;
+            arq_stats.retransmits++;
+            due[due_count++] = slot;
+        }
+        arq_advance_base();
+        // Staged after the give-ups, so the retransmits already carry the new base
+        for (int i = 0; i < due_count; i++)
+        {
+            retx_lengths[i] = arq_stage(due[i], retx_frames[i]);
+        }
+        xSemaphoreGive(arq_mutex);
+
+        arq_report(reports, report_count);
+        for (int i = 0; i < due_count; i++)
+        {
+            uart_link_send(retx_frames[i], retx_lengths[i]);
+        }
+    }
+}
+
+bool uart_arq_send_frame(const uint8_t *frame, uint16_t length, uint32_t timeout_ms)
+{
+    return uart_arq_send_frame_notify(frame, length, timeout_ms, NULL, 0);
+}
+
+bool uart_arq_send_frame_notify(const uint8_t *frame, uint16_t length, uint32_t timeout_ms, uart_arq_done_t done,
+                                uint32_t tag)
+{
+    if (!arq_mutex || !frame || length < FRAME_MIN_LENGTH)
+    {
+        return false;
+    }
+
+    uint16_t inner_len = length - FRAME_HEADER_SIZE - 2;
+    if (inner_len > UART_ARQ_MAX_PAYLOAD)
+    {
+        ESP_LOGE(TAG, "Payload too long for reliable mode: %u", (unsigned)inner_len);
+        return false;
+    }
+
+    // The window slides on the oldest unacked seq, SACKed frames after a gap do not free a slot
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    while (1)
+    {
+        xSemaphoreTake(arq_mutex, portMAX_DELAY);
+        if ((uint8_t)(tx_next_seq - tx_base) < UART_ARQ_WINDOW)
+        {
+            break;
+        }
+        xSemaphoreGive(arq_mutex);
+
+        TickType_t waited = xTaskGetTickCount() - start;
+        if (waited >= timeout || xSemaphoreTake(arq_window_sem, timeout - waited) != pdTRUE)
+        {
+            arq_stats.window_full++;
+            return false;
+        }
+    }
+
+    uint8_t out[ARQ_FRAME_SIZE];
+    uint8_t seq = tx_next_seq++;
+    arq_tx_slot_t *slot = &tx_slots[ARQ_SLOT(seq)];
+    uint16_t idx = 0;
+
+    slot->frame[idx++] = START_BYTE;
+    slot->frame[idx++] = START_BYTE_FOLLOW;
+    slot->frame[idx++] = UART_MSG_RELIABLE;
+    uint16_t total = FRAME_HEADER_SIZE + ARQ_HEADER_SIZE + inner_len + 2;
+    slot->frame[idx++] = (uint8_t)(total & 0xFF);
+    slot->frame[idx++] = (uint8_t)(total >> 8);
+    slot->frame[idx++] = tx_epoch;
+    slot->frame[idx++] = seq;
+    slot->frame[idx++] = tx_base; // refreshed on every transmission
+    slot->frame[idx++] = frame[2] & FRAME_TYPE_MASK;
+    memcpy(&slot->frame[idx], &frame[FRAME_HEADER_SIZE], inner_len);
+
+    slot->length = total;
+    slot->seq = seq;
+    slot->retries = 0;
+    slot->done = done;
+    slot->tag = tag;
+    slot->used = true;
+    arq_stats.sent++;
+    arq_stats.in_flight++;
+    uint16_t out_len = arq_stage(slot, out);
+    xSemaphoreGive(arq_mutex);
+
+    uart_link_send(out, out_len);
+    return true;
+}
+
+void uart_arq_handle_ack(const uint8_t *payload, uint16_t payload_len)
+{
+    if (!arq_mutex || payload_len < 4 || payload[0] != tx_epoch)
+    {
+        return;
+    }
+
+    uint8_t next_expected = payload[1];
+    uint16_t sack = math.convert.bytes_to_uint16(payload[2], payload[3]);
+    TickType_t now = xTaskGetTickCount();
+    arq_report_t reports[UART_ARQ_WINDOW];
+    int report_count = 0;
+
+    xSemaphoreTake(arq_mutex, portMAX_DELAY);
+    for (int i = 0; i < UART_ARQ_WINDOW; i++)
+    {
+        arq_tx_slot_t *slot = &tx_slots[i];
+        if (!slot->used)
+        {
+            continue;
+        }
+
+        // Cumulative: everything before next_expected
+        uint8_t behind = (uint8_t)(next_expected - 1 - slot->seq);
+        // Selective: bit (offset - 1) for seqs after the gap
+        uint8_t offset = (uint8_t)(slot->seq - next_expected);
+
+        if (behind < UART_ARQ_WINDOW || (offset >= 1 && offset <= 16 && (sack & (1u << (offset - 1)))))
+        {
+            arq_ack_slot(slot, now, reports, &report_count);
+        }
+    }
+    arq_advance_base();
+    xSemaphoreGive(arq_mutex);
+    arq_report(reports, report_count);
+}
+
+// ======================= RX =======================
+static void arq_send_ack(void)
+{
+    uint8_t frame[FRAME_HEADER_SIZE + 4 + 2];
+    uint16_t sack = 0;
+    uint16_t idx = 0;
+
+    for (uint8_t i = 1; i < UART_ARQ_WINDOW; i++)
+    {
+        arq_rx_slot_t *slot = &rx_slots[ARQ_SLOT(rx_expected + i)];
+        if (slot->present)
+        {
+            sack |= (uint16_t)(1u << (i - 1));
+        }
+    }
+
+    frame[idx++] = START_BYTE;
+    frame[idx++] = START_BYTE_FOLLOW;
+    frame[idx++] = UART_MSG_ACK;
+    frame[idx++] = sizeof(frame);
+    frame[idx++] = 0x00;
+    frame[idx++] = rx_epoch;
+    frame[idx++] = rx_expected;
+    frame[idx++] = (uint8_t)(sack & 0xFF);
+    frame[idx++] = (uint8_t)(sack >> 8);
+    idx = message_append_integrity(frame, idx);
+
+    uart_link_send(frame, idx);
+}
+
+static void arq_deliver_in_order(void)
+{
+    while (rx_slots[ARQ_SLOT(rx_expected)].present)
+    {
+        arq_rx_slot_t *slot = &rx_slots[ARQ_SLOT(rx_expected)];
+        if (arq_rx_handler)
+        {
+            Frame_View view = {
+                .type = slot->type,
+                .length = FRAME_HEADER_SIZE + slot->length + 2,
+                .payload = slot->data,
+                .payload_len = slot->length,
+            };
+            arq_rx_handler(&view);
+        }
+        slot->present = false;
+        arq_stats.rx_delivered++;
+        rx_expected++;
+    }
+}
+
+void uart_arq_handle_data(const uint8_t *payload, uint16_t payload_len)
+{
+    if (payload_len < ARQ_HEADER_SIZE || payload_len - ARQ_HEADER_SIZE > UART_ARQ_MAX_PAYLOAD)
+    {
+        return;
+    }
+
+    uint8_t epoch = payload[0];
+    uint8_t seq = payload[1];
+    uint8_t base = payload[2];
+
+    // Peer rebooted (or first frame ever): start from its base
+    if (!rx_synced || epoch != rx_epoch)
+    {
+        memset(rx_slots, 0, sizeof(rx_slots));
+        rx_epoch = epoch;
+        rx_expected = base;
+        rx_synced = true;
+    }
+
+    // Sender moved past seqs it gave up on, deliver what we hold and skip the rest
+    while ((uint8_t)(base - rx_expected) < 128 && base != rx_expected)
+    {
+        arq_rx_slot_t *slot = &rx_slots[ARQ_SLOT(rx_expected)];
+        if (!slot->present)
+        {
+            arq_stats.rx_skipped++;
+            rx_expected++;
+        }
+        arq_deliver_in_order();
+    }
+
+    uint8_t offset = (uint8_t)(seq - rx_expected);
+    if (offset >= UART_ARQ_WINDOW)
+    {
+        // Already delivered (ACK was lost) or beyond the window: only re-ACK
+        arq_stats.rx_duplicates++;
+    }
+    else if (rx_slots[ARQ_SLOT(seq)].present)
+    {
+        arq_stats.rx_duplicates++;
+    }
+    else
+    {
+        arq_rx_slot_t *slot = &rx_slots[ARQ_SLOT(seq)];
+        slot->type = payload[3];
+        slot->length = payload_len - ARQ_HEADER_SIZE;
+        memcpy(slot->data, &payload[ARQ_HEADER_SIZE], slot->length);
+        slot->present = true;
+        if (offset > 0)
+        {
+            arq_stats.rx_out_of_order++;
+        }
+        arq_deliver_in_order();
+    }
+
+    arq_send_ack();
+}
+
+// ======================= API =======================
+void uart_arq_init(uart_arq_rx_handler_t handler)
+{
+    if (arq_mutex)
+    {
+        return;
+    }
+
+    arq_mutex = xSemaphoreCreateMutex();
+    arq_window_sem = xSemaphoreCreateBinary();
+    if (!arq_mutex || !arq_window_sem)
+    {
+        ESP_LOGE(TAG, "Failed to create ARQ mutex/semaphore");
+        return;
+    }
+
+    arq_rx_handler = handler;
+    memset(&arq_stats, 0, sizeof(arq_stats));
+    arq_stats.rto_ms = UART_ARQ_RTO_INIT_MS;
+    tx_epoch = (uint8_t)esp_random();
+
+    if (xTaskCreate(arq_timer_task, "uart_arq_timer", 3072, NULL, 7, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create uart_arq_timer");
+    }
+}
+
+void uart_arq_get_stats(uart_arq_stats_t *out)
+{
+    if (out)
+    {
+        memcpy(out, &arq_stats, sizeof(*out));
+    }
+}
+
+void uart_arq_log_stats(void)
+{
+    uart_arq_stats_t s;
+    uart_arq_get_stats(&s);
+
+    ESP_LOGI(TAG, "tx sent=%lu acked=%lu retx=%lu failed=%lu window_full=%lu in_flight=%u",
+             s.sent, s.acked, s.retransmits, s.failed, s.window_full, s.in_flight);
+    ESP_LOGI(TAG, "rx delivered=%lu dup=%lu ooo=%lu skipped=%lu",
+             s.rx_delivered, s.rx_duplicates, s.rx_out_of_order, s.rx_skipped);
+    ESP_LOGI(TAG, "rtt last=%lu min=%lu max=%lu srtt=%lu ms, rto=%lu ms",
+             s.rtt_last_ms, s.rtt_min_ms, s.rtt_max_ms, s.srtt_ms, s.rto_ms);
+}
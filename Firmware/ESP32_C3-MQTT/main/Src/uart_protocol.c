@@ -16,45 +16,43 @@ void extract_sensor_data_from_json(const char *json_str, Sensor_Data *sensor_dat
         return;
     }
 
-    cJSON *root = cJSON_Parse(json_str);
-    if (root == NULL)
+    int32_t lux, temp, humi;
+    const json_field_t fields[] = {
+        {"data.lux", JSON_FIELD_INT, false, &lux, 0},
+        {"data.temp", JSON_FIELD_INT, false, &temp, 0},
+        {"data.humi", JSON_FIELD_INT, false, &humi, 0},
+    };
+    uint32_t found;
+    json_read_error_t err;
+    if (!json_bind(json_str, strlen(json_str), fields, 3, &found, &err))
     {
-        ESP_LOGW(TAG, "Failed to parse JSON");
+        ESP_LOGW(TAG, "Failed to parse JSON: %s at %u", json_read_status_str(err.status), err.pos);
         return;
     }
 
-    cJSON *data = cJSON_GetObjectItem(root, "data");
-    if (data != NULL && cJSON_IsObject(data))
+    // get lux value if exists
+    if (found & (1u << 0))
     {
-        // get lux value if exists
-        cJSON *lux = cJSON_GetObjectItem(data, "lux");
-        if (lux != NULL && cJSON_IsNumber(lux))
-        {
-            sensor_data->lux = (uint16_t)lux->valueint;
-            sensor_data->flags |= SENSOR_FLAG_LUX;
-            ESP_LOGI(TAG, "Found lux: %d", sensor_data->lux);
-        }
-
-        // get temp value if exists
-        cJSON *temp = cJSON_GetObjectItem(data, "temp");
-        if (temp != NULL && cJSON_IsNumber(temp))
-        {
-            sensor_data->temp = (uint8_t)temp->valueint;
-            sensor_data->flags |= SENSOR_FLAG_TEMP;
-            ESP_LOGI(TAG, "Found temp: %d", sensor_data->temp);
-        }
+        sensor_data->lux = (uint16_t)lux;
+        sensor_data->flags |= SENSOR_FLAG_LUX;
+        ESP_LOGI(TAG, "Found lux: %d", sensor_data->lux);
+    }
 
-        // get humi value if exists
-        cJSON *humi = cJSON_GetObjectItem(data, "humi");
-        if (humi != NULL && cJSON_IsNumber(humi))
-        {
-            sensor_data->humi = (uint8_t)humi->valueint;
-            sensor_data->flags |= SENSOR_FLAG_HUMI;
-            ESP_LOGI(TAG, "Found humi: %d", sensor_data->humi);
-        }
+    // get temp value if exists
+    if (found & (1u << 1))
+    {
+        sensor_data->temp = (uint8_t)temp;
+        sensor_data->flags |= SENSOR_FLAG_TEMP;
+        ESP_LOGI(TAG, "Found temp: %d", sensor_data->temp);
     }
 
-    cJSON_Delete(root);
+    // get humi value if exists
+    if (found & (1u << 2))
+    {
+        sensor_data->humi = (uint8_t)humi;
+        sensor_data->flags |= SENSOR_FLAG_HUMI;
+        ESP_LOGI(TAG, "Found humi: %d", sensor_data->humi);
+    }
 }
 
 /**
@@ -124,6 +122,10 @@ uint16_t create_uart_data_message(Sensor_Data *sensor_data, uint8_t *data_out)
     data_out[idx++] = sensor_data->lux & 0xFF;
     data_out[idx++] = sensor_data->temp;
     data_out[idx++] = sensor_data->humi;
+    if (sensor_data->node != 0)
+    {
+        data_out[idx++] = sensor_data->node; // optional, older gateways ignore the extra byte
+    }
 
     // Calculate total length (from 0xAA to end of data, excluding checksum)
     uint16_t total_length = idx + 2; // +2 for checksum
@@ -132,13 +134,8 @@ uint16_t create_uart_data_message(Sensor_Data *sensor_data, uint8_t *data_out)
     data_out[length_pos] = (uint8_t)(total_length & 0xFF);   // low byte
     data_out[length_pos + 1] = (uint8_t)(total_length >> 8); // high byte
 
-    // Calculate checksum (all bytes before checksum)
-    uint16_t checksum = caculate_checksum(data_out, idx);
-
-    // Add checksum (little endian like uint16_to_bytes)
-    uint8_t *chk = math.convert.uint16_to_bytes(checksum);
-    data_out[idx++] = chk[0];
-    data_out[idx++] = chk[1];
+    // Add checksum or CRC (all bytes before it, little endian like uint16_to_bytes)
+    idx = message_append_integrity(data_out, idx);
 
     ESP_LOGI(TAG, "Created UART data message: flags=0x%02X, lux=%d, temp=%d, humi=%d",
              sensor_data->flags, sensor_data->lux, sensor_data->temp, sensor_data->humi);
@@ -180,6 +177,11 @@ uint16_t parse_json_to_uart_data(const char *json_str, uint8_t *data_out)
  * @return uint16_t
  */
 uint16_t create_uart_control_message(Plug_ID plug_id, Plug_Status status, uint8_t *data_out)
+{
+    return create_uart_control_message_to(0, plug_id, status, data_out);
+}
+
+uint16_t create_uart_control_message_to(uint8_t node, Plug_ID plug_id, Plug_Status status, uint8_t *data_out)
 {
     if (data_out == NULL)
     {
@@ -204,6 +206,10 @@ uint16_t create_uart_control_message(Plug_ID plug_id, Plug_Status status, uint8_
     // Data payload: [plug_id, status]
     data_out[idx++] = (uint8_t)plug_id;
     data_out[idx++] = (uint8_t)status;
+    if (node != 0)
+    {
+        data_out[idx++] = node;
+    }
 
     // Calculate total length
     uint16_t total_length = idx + 2; // +2 for checksum
@@ -212,13 +218,10 @@ uint16_t create_uart_control_message(Plug_ID plug_id, Plug_Status status, uint8_
     data_out[length_pos] = (uint8_t)(total_length & 0xFF);   // low byte
     data_out[length_pos + 1] = (uint8_t)(total_length >> 8); // high byte
 
-    // Calculate checksum
-    uint16_t checksum = caculate_checksum(data_out, idx);
-    uint8_t *chk = math.convert.uint16_to_bytes(checksum);
-    data_out[idx++] = chk[0];
-    data_out[idx++] = chk[1];
+    // Add checksum or CRC
+    idx = message_append_integrity(data_out, idx);
 
-    ESP_LOGI(TAG, "Created UART control message: plug=%d, status=%d", plug_id, status);
+    ESP_LOGI(TAG, "Created UART control message: node=%u, plug=%d, status=%d", node, plug_id, status);
 
     return idx;
 }
@@ -226,142 +229,134 @@ uint16_t create_uart_control_message(Plug_ID plug_id, Plug_Status status, uint8_
 // ============ UART TO JSON ============
 
 /**
- * @brief Decode UART data message to JSON string
+ * @brief Write the "data" object of a UART data message (only the fields set in flags)
  *
- * @param uart_data
- * @param length
- * @return char*
+ * @param w writer positioned where the value goes
+ * @param key member name, NULL when data is the root value
+ * @param view frame borrowed from lib_uart or delivered by the ARQ layer
  */
-char *decode_uart_data_to_json(const uint8_t *uart_data, uint16_t length)
+void uart_data_write_json(json_writer_t *w, const char *key, const Frame_View *view)
 {
-    if (uart_data == NULL || length < sizeof(Frame_Message))
-    {
-        ESP_LOGE(TAG, "Invalid UART data");
-        return NULL;
-    }
-
-    Frame_Message *frame = (Frame_Message *)uart_data;
+    Sensor_Data sensor_data = {
+        .flags = uart_data_flags(view),
+        .lux = uart_data_lux(view),
+        .temp = uart_data_temp(view),
+        .humi = uart_data_humi(view),
+        .node = uart_data_node(view),
+    };
+    uart_sensor_write_json(w, key, &sensor_data);
+}
 
-    // Check start message
-    if (frame->start_message != 0xAA55)
+/**
+ * @brief Same object from decoded readings, e.g. only the fields left after the report policy
+ */
+void uart_sensor_write_json(json_writer_t *w, const char *key, const Sensor_Data *sensor_data)
+{
+    json_writer_begin_object(w, key);
+    if (sensor_data->node != 0)
     {
-        ESP_LOGE(TAG, "Invalid start message: 0x%04X", frame->start_message);
-        return NULL;
+        json_writer_uint(w, "node", sensor_data->node);
     }
-
-    // Check message type
-    if (frame->type_message != UART_MSG_DATA)
+    // Add sensor values based on flags
+    if (sensor_data->flags & SENSOR_FLAG_LUX)
     {
-        ESP_LOGE(TAG, "Not a data message: 0x%02X", frame->type_message);
-        return NULL;
+        json_writer_uint(w, "lux", sensor_data->lux);
     }
 
-    // Check     length
-    if (frame->length_message < 5)
+    if (sensor_data->flags & SENSOR_FLAG_TEMP)
     {
-        ESP_LOGE(TAG, "Invalid data length: %d", frame->length_message);
-        return NULL;
+        json_writer_uint(w, "temp", sensor_data->temp);
     }
 
-    // Extract data
-    uint8_t flags = frame->data[0];
-    uint16_t lux = (frame->data[1] << 8) | frame->data[2];
-    uint8_t temp = frame->data[3];
-    uint8_t humi = frame->data[4];
-
-    // Create JSON telemetry
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "type", "telemetry");
-
-    cJSON *data = cJSON_CreateObject();
-
-    // Add sensor values based on flags
-    if (flags & SENSOR_FLAG_LUX)
+    if (sensor_data->flags & SENSOR_FLAG_HUMI)
     {
-        cJSON_AddNumberToObject(data, "lux", lux);
+        json_writer_uint(w, "humi", sensor_data->humi);
     }
+    json_writer_end_object(w);
+}
 
-    if (flags & SENSOR_FLAG_TEMP)
+/**
+ * @brief Decode UART data message to JSON string
+ *
+ * @param view frame borrowed from lib_uart or delivered by the ARQ layer
+ * @param json_out buffer for the JSON string
+ * @param out_size size of json_out
+ * @return uint16_t - length of the JSON string, 0 on error
+ */
+uint16_t decode_uart_data_to_json(const Frame_View *view, char *json_out, uint16_t out_size)
+{
+    // Start bytes, length and checksum/CRC were already checked by the FSM
+    if (view == NULL || !uart_view_is_data(view))
     {
-        cJSON_AddNumberToObject(data, "temp", temp);
+        ESP_LOGE(TAG, "Invalid UART DATA frame");
+        return 0;
     }
 
-    if (flags & SENSOR_FLAG_HUMI)
+    // Create JSON telemetry
+    json_writer_t w;
+    json_writer_init(&w, json_out, out_size);
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "type", "telemetry");
+    uart_data_write_json(&w, "data", view);
+    json_writer_end_object(&w);
+
+    uint16_t len = json_writer_finish(&w);
+    if (len == 0)
     {
-        cJSON_AddNumberToObject(data, "humi", humi);
+        ESP_LOGE(TAG, "JSON buffer too small (%u bytes)", out_size);
+        return 0;
     }
 
-    cJSON_AddItemToObject(root, "data", data);
+    ESP_LOGI(TAG, "Decoded UART data to JSON (flags=0x%02X): %s", uart_data_flags(view), json_out);
 
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    ESP_LOGI(TAG, "Decoded UART data to JSON (flags=0x%02X): %s", flags, json_str);
-
-    return json_str;
+    return len;
 }
 
 /**
  * @brief Decode UART control message to JSON string
  *
- * @param uart_data
- * @param length
- * @return char*
+ * @param view frame borrowed from lib_uart or delivered by the ARQ layer
+ * @param json_out buffer for the JSON string
+ * @param out_size size of json_out
+ * @return uint16_t - length of the JSON string, 0 on error
  */
-char *decode_uart_control_to_json(const uint8_t *uart_data, uint16_t length)
+uint16_t decode_uart_control_to_json(const Frame_View *view, char *json_out, uint16_t out_size)
 {
-    if (uart_data == NULL || length < sizeof(Frame_Message))
+    if (view == NULL || !uart_view_is_control(view))
     {
-        ESP_LOGE(TAG, "Invalid UART data");
-        return NULL;
+        ESP_LOGE(TAG, "Invalid UART CONTROL frame");
+        return 0;
     }
 
-    Frame_Message *frame = (Frame_Message *)uart_data;
+    uint8_t plug_id = uart_control_plug_id(view);
+    uint8_t status = uart_control_status(view);
 
-    // Check start message
-    if (frame->start_message != 0xAA55)
-    {
-        ESP_LOGE(TAG, "Invalid start message: 0x%04X", frame->start_message);
-        return NULL;
-    }
+    // Create JSON control
+    char plug_name[10];
+    snprintf(plug_name, sizeof(plug_name), "plug_%d", plug_id + 1);
 
-    // Check message type
-    if (frame->type_message != UART_MSG_CONTROL)
+    json_writer_t w;
+    json_writer_init(&w, json_out, out_size);
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "type", "control");
+    json_writer_begin_object(&w, "data");
+    json_writer_string(&w, "plug", plug_name);
+    json_writer_string(&w, "status", status == STATUS_ON ? "on" : "off");
+    if (uart_control_node(view) != 0)
     {
-        ESP_LOGE(TAG, "Not a control message: 0x%02X", frame->type_message);
-        return NULL;
+        json_writer_uint(&w, "node", uart_control_node(view));
     }
+    json_writer_end_object(&w);
+    json_writer_end_object(&w);
 
-    // Check length
-    if (frame->length_message < 2)
+    uint16_t len = json_writer_finish(&w);
+    if (len == 0)
     {
-        ESP_LOGE(TAG, "Invalid data length: %d", frame->length_message);
-        return NULL;
+        ESP_LOGE(TAG, "JSON buffer too small (%u bytes)", out_size);
+        return 0;
     }
 
-    // Extract data
-    uint8_t plug_id = frame->data[0];
-    uint8_t status = frame->data[1];
-
-    // Create JSON control
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "type", "control");
-
-    cJSON *data = cJSON_CreateObject();
-
-    // Create plug name
-    char plug_name[10];
-    snprintf(plug_name, sizeof(plug_name), "plug_%d", plug_id + 1);
-
-    cJSON_AddStringToObject(data, "plug", plug_name);
-    cJSON_AddStringToObject(data, "status", status == STATUS_ON ? "on" : "off");
-
-    cJSON_AddItemToObject(root, "data", data);
-
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    ESP_LOGI(TAG, "Decoded UART control to JSON: %s", json_str);
+    ESP_LOGI(TAG, "Decoded UART control to JSON: %s", json_out);
 
-    return json_str;
+    return len;
 }
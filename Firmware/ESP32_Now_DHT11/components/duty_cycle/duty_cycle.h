@@ -0,0 +1,95 @@
+#ifndef DUTY_CYCLE_H
+#define DUTY_CYCLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Poll schedule of a sensor node that sleeps between the master's ask_data polls.
+ * The time of the next poll comes with the poll ("NEXT": ms until the following one); from a master
+ * that does not announce it, it is the learned poll period after the last one. The node wakes
+ * guard_ms before the expected poll and listens until listen_ms after it (wake skew, master re-sends),
+ * sleeps again once it answered. A window without a poll counts as missed and the schedule moves one
+ * period on; resync_after misses in a row drop the schedule, the node then stays awake until a poll.
+ *
+ * Pure C (no ESP-IDF/FreeRTOS), the caller serialises access and supplies the millisecond clock.
+ */
+
+// ============ CONFIG ============
+#define DUTY_WAIT_FOREVER UINT32_MAX
+
+// ============ STRUCTURES ============
+typedef struct
+{
+    uint32_t guard_ms;     // wake this long before the expected poll
+    uint32_t listen_ms;    // wait this long past the expected poll before counting it missed
+    uint32_t linger_ms;    // stay awake this long after answering (master re-send, pending pushes)
+    uint32_t min_sleep_ms; // shorter gaps are not worth a sleep
+    uint8_t resync_after;  // consecutive missed polls before the schedule is dropped
+} duty_cycle_config_t;
+
+typedef struct
+{
+    uint32_t polls;
+    uint32_t missed;
+    uint32_t resyncs;
+    uint32_t cycles;         // sleeps taken
+    uint32_t last_awake_ms;  // awake time of the last completed cycle
+    uint64_t awake_ms;       // totals over the completed cycles
+    uint64_t sleep_ms;
+} duty_cycle_stats_t;
+
+typedef struct
+{
+    duty_cycle_config_t cfg;
+    bool synced;             // next_poll_ms valid
+    uint32_t period_ms;      // announced or learned poll period, 0 = unknown
+    uint32_t next_poll_ms;
+    bool have_last;
+    uint32_t last_poll_ms;
+    uint8_t missed_run;
+    duty_cycle_stats_t stats;
+} duty_cycle_t;
+
+// ============ API ============
+void duty_cycle_init(duty_cycle_t *d, const duty_cycle_config_t *cfg);
+
+/**
+ * @brief Forget the schedule (master lost), the stats are kept
+ */
+void duty_cycle_reset(duty_cycle_t *d);
+
+/**
+ * @brief A poll arrived
+ * @param next_ms ms until the master's next poll as announced in it, 0 = not announced (learn the period)
+ */
+void duty_cycle_poll(duty_cycle_t *d, uint32_t now_ms, uint32_t next_ms);
+
+/**
+ * @brief How long to keep listening for the expected poll
+ * @return DUTY_WAIT_FOREVER without a schedule, 0 once the listen window is over
+ */
+uint32_t duty_cycle_listen_ms(const duty_cycle_t *d, uint32_t now_ms);
+
+/**
+ * @brief The listen window ended without a poll
+ */
+void duty_cycle_missed(duty_cycle_t *d, uint32_t now_ms);
+
+/**
+ * @brief How long the node may sleep now (until guard_ms before the next poll)
+ * @return 0 = stay awake (no schedule, or the gap is below min_sleep_ms)
+ */
+uint32_t duty_cycle_sleep_ms(const duty_cycle_t *d, uint32_t now_ms);
+
+/**
+ * @brief One cycle done: awake_ms since the last wake-up, then slept sleep_ms
+ */
+void duty_cycle_account(duty_cycle_t *d, uint32_t awake_ms, uint32_t sleep_ms);
+
+/**
+ * @brief Awake share of the completed cycles in permille, 1000 before the first one
+ */
+uint16_t duty_cycle_permille(const duty_cycle_t *d);
+
+#endif // DUTY_CYCLE_H
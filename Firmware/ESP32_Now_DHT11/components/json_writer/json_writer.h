@@ -0,0 +1,74 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define JSON_WRITER_MAX_DEPTH 16 // nested objects / arrays
+
+/*
+ * Serializes straight into a caller buffer, no DOM and no heap:
+ *   char buf[64];
+ *   json_writer_t w;
+ *   json_writer_init(&w, buf, sizeof(buf));
+ *   json_writer_begin_object(&w, NULL);
+ *   json_writer_string(&w, "type", "telemetry");
+ *   json_writer_begin_object(&w, "data");
+ *   json_writer_int(&w, "temp", 25);
+ *   json_writer_end_object(&w);
+ *   json_writer_end_object(&w);
+ *   size_t len = json_writer_finish(&w); // {"type":"telemetry","data":{"temp":25}}, 0 on overflow
+ * key is the member name inside an object, NULL for the root value and for array elements.
+ * After an overflow every call is a no-op, so the checks can wait for json_writer_finish().
+ */
+
+typedef struct
+{
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+    uint8_t depth;
+    uint32_t has_items; // bit n: level n already holds a value, the next one needs a comma
+} json_writer_t;
+
+/**
+ * @brief Start writing into buf (always '\0' terminated, also on overflow)
+ */
+void json_writer_init(json_writer_t *w, char *buf, size_t size);
+
+void json_writer_begin_object(json_writer_t *w, const char *key);
+void json_writer_end_object(json_writer_t *w);
+void json_writer_begin_array(json_writer_t *w, const char *key);
+void json_writer_end_array(json_writer_t *w);
+
+/**
+ * @brief String value, quotes, backslashes and control characters escaped like cJSON
+ */
+void json_writer_string(json_writer_t *w, const char *key, const char *value);
+/**
+ * @brief String of len bytes, not '\0' terminated (embedded NULs are written as \u0000)
+ */
+void json_writer_string_n(json_writer_t *w, const char *key, const char *value, size_t len);
+void json_writer_int(json_writer_t *w, const char *key, int32_t value);
+void json_writer_uint(json_writer_t *w, const char *key, uint32_t value);
+
+/**
+ * @brief Number with up to digits significant digits (%g), NaN / Inf are written as null like cJSON
+ */
+void json_writer_double(json_writer_t *w, const char *key, double value, uint8_t digits);
+void json_writer_bool(json_writer_t *w, const char *key, bool value);
+void json_writer_null(json_writer_t *w, const char *key);
+
+/**
+ * @brief Already serialized JSON value, copied as is
+ */
+void json_writer_raw(json_writer_t *w, const char *key, const char *json);
+
+/**
+ * @brief Length of the document, 0 if the buffer overflowed or an object / array is still open
+ */
+size_t json_writer_finish(json_writer_t *w);
+
+#endif // JSON_WRITER_H
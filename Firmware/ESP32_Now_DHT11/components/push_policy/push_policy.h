@@ -0,0 +1,90 @@
+#ifndef PUSH_POLICY_H
+#define PUSH_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Report-by-exception on the sensor node. A sample is pushed to the master unsolicited when a field
+ * moved past its delta or crossed its threshold since the value last *reported* (pushed or answered
+ * to a poll), not more often than min_interval_ms; with nothing to report the node still pushes
+ * after heartbeat_ms of silence. Unlike the gateway report_policy deadbands, either delta alone triggers.
+ *
+ * Pure C (no ESP-IDF/FreeRTOS), the caller serialises access and supplies the millisecond clock.
+ */
+
+// ============ CONFIG ============
+#define PUSH_MAX_FIELDS 2
+
+// ============ STRUCTURES ============
+typedef struct
+{
+    uint16_t abs_delta;       // push when |value - last| >= this, 0 = off
+    uint16_t rel_delta_pm;    // push when |value - last| >= |last| * this / 1000, 0 = off
+    bool threshold_en;
+    int32_t threshold;        // push when the value crosses this level (either way)
+    uint16_t threshold_hyst;  // a crossing counts once the value is this far past the level
+} push_field_policy_t;
+// abs, rel and threshold all off: the field never triggers a push, only the heartbeat sends it
+
+typedef struct
+{
+    push_field_policy_t field[PUSH_MAX_FIELDS];
+    uint8_t field_count;
+    uint32_t min_interval_ms; // rate limit, a change inside it goes out once it expires, 0 = off
+    uint32_t heartbeat_ms;    // push after this long without any report, 0 = off
+} push_policy_config_t;
+
+typedef enum
+{
+    PUSH_NONE = 0,
+    PUSH_CHANGE,    // delta / threshold, or the first report
+    PUSH_HEARTBEAT,
+} push_reason_t;
+
+typedef struct
+{
+    uint32_t samples;
+    uint32_t pushed_change;
+    uint32_t pushed_heartbeat;
+    uint32_t rate_limited;    // change held back by min_interval_ms
+    uint32_t polled;          // reports answered to the master's poll
+} push_policy_stats_t;
+
+typedef struct
+{
+    push_policy_config_t cfg;
+    bool reported;            // last[] valid
+    int32_t last[PUSH_MAX_FIELDS];
+    int8_t side[PUSH_MAX_FIELDS]; // threshold side of the reported value, -1 below / 1 above / 0 unknown
+    uint32_t last_ms;
+    push_policy_stats_t stats;
+} push_policy_t;
+
+// ============ API ============
+/**
+ * @brief Reject configs that cannot work (too many fields, relative delta > 100 %)
+ */
+bool push_policy_valid(const push_policy_config_t *cfg);
+
+/**
+ * @brief New config and state, the first sample afterwards is pushed
+ */
+void push_policy_init(push_policy_t *p, const push_policy_config_t *cfg);
+
+/**
+ * @brief Should this sample be pushed
+ * @details Nothing is remembered here, call push_policy_reported() once the push went out so a failed
+ *          send is retried with the next sample.
+ * @param value cfg.field_count values
+ * @param now_ms free running millisecond clock, wrap-around is fine
+ */
+push_reason_t push_policy_decide(push_policy_t *p, const int32_t *value, uint32_t now_ms);
+
+/**
+ * @brief The master now has these values
+ * @param reason what push_policy_decide() returned for a push, PUSH_NONE for an answer to the master's poll
+ */
+void push_policy_reported(push_policy_t *p, const int32_t *value, uint32_t now_ms, push_reason_t reason);
+
+#endif // PUSH_POLICY_H
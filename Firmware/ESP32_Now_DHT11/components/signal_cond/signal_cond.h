@@ -0,0 +1,106 @@
+#ifndef SIGNAL_COND_H
+#define SIGNAL_COND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Per-sensor conditioning on the node, one call per sample:
+ *   - optional 2nd order low-pass per field (esp-dsp biquad, dsps_biquad_f32), primed with the first
+ *     sample so it starts at the signal instead of ramping up from 0
+ *   - min / max / mean / variance of the raw samples over a window of N samples (Welford, O(1) per sample)
+ * What gets reported is selectable: the raw sample, the filtered one, or the mean of the last complete
+ * window plus its min / max / standard deviation (summary: one value per window, pushes decided per window).
+ *
+ * No ESP-IDF/FreeRTOS beyond esp-dsp (ANSI C on the C3), the caller serialises access.
+ */
+
+// ============ CONFIG ============
+#define COND_MAX_FIELDS 2
+
+// ============ ENUMS ============
+typedef enum
+{
+    COND_FILTER_NONE = 0,
+    COND_FILTER_LOWPASS,
+} cond_filter_t;
+
+typedef enum
+{
+    COND_OUTPUT_RAW = 0,  // latest sample as is
+    COND_OUTPUT_FILTERED, // latest low-pass output
+    COND_OUTPUT_SUMMARY,  // mean of the last complete window (+ min / max / sd)
+} cond_output_t;
+
+// ============ STRUCTURES ============
+typedef struct
+{
+    cond_filter_t filter;
+    float cutoff;  // low-pass corner / sample rate, (0, 0.5)
+    float q;       // 0.707 = Butterworth, no overshoot on a step below ~0.6
+} cond_field_config_t;
+
+typedef struct
+{
+    cond_field_config_t field[COND_MAX_FIELDS];
+    uint8_t field_count;
+    cond_output_t output;
+    uint16_t window;     // samples per statistics window
+} cond_config_t;
+
+typedef struct
+{
+    uint16_t n;
+    float min;
+    float max;
+    float mean;
+    float m2;            // sum of squared deviations (Welford)
+} cond_stats_t;
+
+typedef struct
+{
+    cond_config_t cfg;
+    float coef[COND_MAX_FIELDS][5]; // b0 b1 b2 a1 a2
+    float w[COND_MAX_FIELDS][2];    // biquad delay line
+    bool primed;
+    float raw[COND_MAX_FIELDS];
+    float filtered[COND_MAX_FIELDS];
+    cond_stats_t window[COND_MAX_FIELDS]; // running
+    cond_stats_t last[COND_MAX_FIELDS];   // last complete window
+    bool have_last;
+    uint32_t samples;
+    uint32_t windows;
+} signal_cond_t;
+
+// ============ API ============
+/**
+ * @brief Reject configs that cannot work (field count, cutoff out of (0, 0.5), q <= 0, empty window)
+ */
+bool signal_cond_valid(const cond_config_t *cfg);
+
+/**
+ * @brief New config and state (filter coefficients generated here)
+ * @return false if the config is invalid, c is unusable then
+ */
+bool signal_cond_init(signal_cond_t *c, const cond_config_t *cfg);
+
+/**
+ * @brief Feed one sample (cfg.field_count values)
+ * @return true if it completed a statistics window
+ */
+bool signal_cond_update(signal_cond_t *c, const float *sample);
+
+/**
+ * @brief Values to report for the selected output, false before the first sample
+ * @note Summary before the first complete window: mean of the running one
+ */
+bool signal_cond_output(const signal_cond_t *c, float *value);
+
+/**
+ * @brief Statistics of the last complete window (running one before that), NULL before the first sample
+ */
+const cond_stats_t *signal_cond_stats(const signal_cond_t *c, uint8_t field);
+
+float cond_stats_stddev(const cond_stats_t *s);
+
+#endif // SIGNAL_COND_H
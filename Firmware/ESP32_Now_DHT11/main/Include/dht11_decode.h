@@ -0,0 +1,62 @@
+#ifndef __DHT11_DECODE_H__
+#define __DHT11_DECODE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * DHT11 frame decoder, no ESP-IDF dependency (host testable).
+ * Input is the captured pulse train as (level, duration) pairs, e.g. the RMT RX symbols unpacked:
+ *   [host start low tail] sensor low ~80us, high ~80us, 40 x (low ~50us, high ~26us = 0 / ~70us = 1), low ~50us
+ * Bytes: humi int, humi dec, temp int, temp dec (bit7 = negative on newer parts), checksum.
+ */
+
+// ============ TIMING (us) ============
+#define DHT11_RESP_MIN_US 40       // sensor response low / high, nominal 80
+#define DHT11_RESP_MAX_US 120
+#define DHT11_BIT_LOW_MIN_US 30    // bit start low, nominal 50
+#define DHT11_BIT_LOW_MAX_US 90
+#define DHT11_BIT_HIGH_MIN_US 10   // bit high, nominal 26-28 (0) / 70 (1)
+#define DHT11_BIT_HIGH_MAX_US 100
+#define DHT11_BIT_ONE_US 48        // high longer than this = 1
+
+#define DHT11_FRAME_BYTES 5
+
+// ============ STRUCTURES ============
+typedef struct
+{
+    uint8_t level;     // 0 / 1
+    uint16_t duration; // us, 0 = end of capture
+} dht11_pulse_t;
+
+typedef enum
+{
+    DHT11_DECODE_OK = 0,
+    DHT11_DECODE_NO_RESPONSE, // no 80/80 us response found
+    DHT11_DECODE_SHORT,       // capture ended before 40 bits
+    DHT11_DECODE_BAD_PULSE,   // bit pulse out of the timing window
+    DHT11_DECODE_CHECKSUM,
+} dht11_decode_status_t;
+
+typedef struct
+{
+    int16_t temp_x10;  // 0.1 C
+    uint16_t humi_x10; // 0.1 %RH
+    uint8_t raw[DHT11_FRAME_BYTES];
+} dht11_reading_t;
+
+// ============ API ============
+/**
+ * @brief Decode a captured pulse train into a reading
+ * @param pulses Pulses in capture order, consecutive pulses of the same level are merged
+ * @param count Number of pulses
+ * @param out Filled on DHT11_DECODE_OK, raw[] also filled on DHT11_DECODE_CHECKSUM
+ */
+dht11_decode_status_t dht11_decode(const dht11_pulse_t *pulses, size_t count, dht11_reading_t *out);
+
+/**
+ * @brief Short name of a decode status for logs
+ */
+const char *dht11_decode_status_str(dht11_decode_status_t status);
+
+#endif // __DHT11_DECODE_H__
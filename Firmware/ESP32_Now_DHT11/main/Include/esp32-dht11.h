@@ -1,40 +1,82 @@
 #ifndef __DHT_11__
 #define __DHT_11__
 
-#include <driver/gpio.h>
-#include <stdio.h>
-#include <string.h>
-#include <rom/ets_sys.h>
-#include "esp_log.h"
-/**
- * Structure containing readings and info about the dht11
- * @var dht11_pin the pin associated with the dht11
- * @var temperature last temperature reading
- * @var humidity last humidity reading
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "dht11_decode.h"
+
+/*
+ * DHT11 over the RMT RX peripheral: the start signal is a tick-based low hold, the response pulse
+ * train is captured by hardware and decoded by dht11_decode(), no busy-wait.
+ * A background task samples at a fixed cadence and caches the latest valid reading, readers never
+ * touch the sensor.
  */
+
+// ============ CONFIG ============
+#define DHT11_SAMPLE_PERIOD_MS 2000 // cadence of the background sampling, DHT11 needs >= 1 s
+#define DHT11_MAX_RETRIES 2         // extra attempts per cadence after a bad frame
+#define DHT11_RETRY_DELAY_MS 1100   // sensor needs ~1 s before the next start signal
+#define DHT11_START_LOW_MS 20       // host start low, datasheet >= 18 ms
+#define DHT11_RX_TIMEOUT_MS 10      // full frame is ~4.5 ms after release
+#define DHT11_RX_SYMBOLS 64         // RMT symbols per capture (frame needs ~43)
+#define DHT11_TASK_STACK 3072
+#define DHT11_TASK_PRIO 3
+
+// ============ STRUCTURES ============
 typedef struct
 {
-    int dht11_pin;
-    float temperature;
-    float humidity;
-} dht11_t;
+    int16_t temp_x10;     // 0.1 C
+    uint16_t humi_x10;    // 0.1 %RH
+    TickType_t timestamp; // tick of the capture
+    uint32_t age_ms;      // filled by dht11_get_sample()
+} dht11_sample_t;
+
+typedef struct
+{
+    uint32_t reads;       // captures attempted
+    uint32_t ok;
+    uint32_t retries;
+    uint32_t timeout;     // no frame from the RMT
+    uint32_t no_response;
+    uint32_t short_frame;
+    uint32_t bad_pulse;
+    uint32_t checksum;
+} dht11_stats_t;
+
+// ============ API ============
+/**
+ * @brief Create the RMT RX channel on the data pin (open-drain, pull-up)
+ */
+esp_err_t dht11_init(gpio_num_t pin);
+
 /**
- * @brief Wait on pin until it reaches the specified state
- * @return returns either the time waited or -1 in the case of a timeout
- * @param state state to wait for
- * @param timeout if counter reaches timeout the function returns -1
+ * @brief One start signal + capture + decode
+ * @note Blocks the calling task ~25 ms but yields the CPU, call from the sampling task only
+ * @return ESP_OK, ESP_ERR_TIMEOUT (no frame), ESP_ERR_INVALID_CRC (checksum), ESP_ERR_INVALID_RESPONSE (bad frame)
  */
-int wait_for_state(dht11_t dht11, int state, int timeout);
+esp_err_t dht11_read(dht11_reading_t *out);
+
 /**
- * @brief Holds the pin low fo the specified duration
- * @param hold_time_us time to hold the pin low for in microseconds
+ * @brief dht11_init() and start the background sampling task
+ * @param period_ms Sampling cadence, 0 = DHT11_SAMPLE_PERIOD_MS
  */
-void hold_low(dht11_t dht11, int hold_time_us);
+esp_err_t dht11_sampler_start(gpio_num_t pin, uint32_t period_ms);
+
 /**
- * @brief The function for reading temperature and humidity values from the dht11
- * @note  This function is blocking, ie: it forces the cpu to busy wait for the duration necessary to finish comms with the sensor.
- * @note  Wait for atleast 2 seconds between reads
- * @param connection_timeout the number of connection attempts before declaring a timeout
+ * @brief Latest valid sample from the cache, never touches the sensor
+ * @return false if no valid sample yet
  */
-int dht11_read(dht11_t *dht11, int connection_timeout);
-#endif
\ No newline at end of file
+bool dht11_get_sample(dht11_sample_t *out);
+
+void dht11_get_stats(dht11_stats_t *out);
+
+/**
+ * @brief Task notified (xTaskNotifyGive) after every new cached sample, NULL = none
+ */
+void dht11_set_sample_notify(TaskHandle_t task);
+
+#endif
@@ -0,0 +1,115 @@
+#include "dht11_decode.h"
+#include <stdbool.h>
+
+typedef struct
+{
+    const dht11_pulse_t *pulses;
+    size_t count;
+    size_t pos;
+} pulse_iter_t;
+
+/**
+ * @brief Next pulse with same-level neighbours merged
+ * @return false at the end of the capture (also on a 0 us end marker)
+ */
+static bool pulse_next(pulse_iter_t *it, uint8_t *level, uint32_t *duration)
+{
+    if (it->pos >= it->count || it->pulses[it->pos].duration == 0)
+    {
+        return false;
+    }
+    *level = it->pulses[it->pos].level ? 1 : 0;
+    *duration = 0;
+    while (it->pos < it->count && it->pulses[it->pos].duration != 0 && (it->pulses[it->pos].level ? 1 : 0) == *level)
+    {
+        *duration += it->pulses[it->pos].duration;
+        it->pos++;
+    }
+    return true;
+}
+
+static bool in_window(uint32_t value, uint32_t min, uint32_t max)
+{
+    return value >= min && value <= max;
+}
+
+dht11_decode_status_t dht11_decode(const dht11_pulse_t *pulses, size_t count, dht11_reading_t *out)
+{
+    pulse_iter_t it = {.pulses = pulses, .count = count, .pos = 0};
+    uint8_t level;
+    uint32_t duration;
+
+    // Response: the first low / high pair in the 80 us window, anything before is the host start signal
+    bool found = false;
+    uint8_t prev_level = 1;
+    uint32_t prev_duration = 0;
+    while (!found && pulse_next(&it, &level, &duration))
+    {
+        found = level == 1 && prev_level == 0 &&
+                in_window(prev_duration, DHT11_RESP_MIN_US, DHT11_RESP_MAX_US) &&
+                in_window(duration, DHT11_RESP_MIN_US, DHT11_RESP_MAX_US);
+        prev_level = level;
+        prev_duration = duration;
+    }
+    if (!found)
+    {
+        return DHT11_DECODE_NO_RESPONSE;
+    }
+
+    uint8_t raw[DHT11_FRAME_BYTES] = {0};
+    for (int bit = 0; bit < DHT11_FRAME_BYTES * 8; bit++)
+    {
+        uint32_t low;
+        uint32_t high;
+        if (!pulse_next(&it, &level, &low))
+        {
+            return DHT11_DECODE_SHORT;
+        }
+        if (level != 0 || !in_window(low, DHT11_BIT_LOW_MIN_US, DHT11_BIT_LOW_MAX_US))
+        {
+            return DHT11_DECODE_BAD_PULSE;
+        }
+        // The last high is closed by the sensor's ~50 us end low, a capture ending on it is short
+        if (!pulse_next(&it, &level, &high))
+        {
+            return DHT11_DECODE_SHORT;
+        }
+        if (!in_window(high, DHT11_BIT_HIGH_MIN_US, DHT11_BIT_HIGH_MAX_US))
+        {
+            return DHT11_DECODE_BAD_PULSE;
+        }
+        raw[bit / 8] = (uint8_t)((raw[bit / 8] << 1) | (high > DHT11_BIT_ONE_US ? 1 : 0));
+    }
+
+    for (int i = 0; i < DHT11_FRAME_BYTES; i++)
+    {
+        out->raw[i] = raw[i];
+    }
+    if ((uint8_t)(raw[0] + raw[1] + raw[2] + raw[3]) != raw[4])
+    {
+        return DHT11_DECODE_CHECKSUM;
+    }
+
+    out->humi_x10 = (uint16_t)(raw[0] * 10 + (raw[1] % 10));
+    int16_t temp = (int16_t)(raw[2] * 10 + ((raw[3] & 0x7F) % 10));
+    out->temp_x10 = (raw[3] & 0x80) ? (int16_t)-temp : temp;
+    return DHT11_DECODE_OK;
+}
+
+const char *dht11_decode_status_str(dht11_decode_status_t status)
+{
+    switch (status)
+    {
+    case DHT11_DECODE_OK:
+        return "ok";
+    case DHT11_DECODE_NO_RESPONSE:
+        return "no response";
+    case DHT11_DECODE_SHORT:
+        return "short frame";
+    case DHT11_DECODE_BAD_PULSE:
+        return "bad pulse";
+    case DHT11_DECODE_CHECKSUM:
+        return "checksum";
+    }
+    return "?";
+}
@@ -1,92 +1,238 @@
 #include "esp32-dht11.h"
+#include <stdlib.h>
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "driver/rmt_rx.h"
+#include "esp_log.h"
 
-int wait_for_state(dht11_t dht11,int state,int timeout)
+static const char *TAG = "DHT11";
+
+static gpio_num_t dht_pin = GPIO_NUM_NC;
+static rmt_channel_handle_t rx_chan = NULL;
+static QueueHandle_t rx_queue = NULL;
+static rmt_symbol_word_t rx_symbols[DHT11_RX_SYMBOLS];
+static dht11_pulse_t rx_pulses[DHT11_RX_SYMBOLS * 2];
+static uint32_t sample_period_ms = DHT11_SAMPLE_PERIOD_MS;
+
+static portMUX_TYPE cache_lock = portMUX_INITIALIZER_UNLOCKED;
+static dht11_sample_t cache;
+static bool cache_valid = false;
+static dht11_stats_t stats;
+static TaskHandle_t sample_notify = NULL;
+
+static const rmt_receive_config_t rx_config = {
+    .signal_range_min_ns = 1000,   // glitch filter
+    .signal_range_max_ns = 200000, // line idle high this long = end of frame
+};
+
+static bool IRAM_ATTR dht11_rx_done_cb(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *edata, void *user_ctx)
 {
-    gpio_set_direction(dht11.dht11_pin, GPIO_MODE_INPUT);
-    int count = 0;
-    
-    while(gpio_get_level(dht11.dht11_pin) != state)
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR((QueueHandle_t)user_ctx, edata, &woken);
+    return woken == pdTRUE;
+}
+
+esp_err_t dht11_init(gpio_num_t pin)
+{
+    if (rx_chan != NULL)
+    {
+        return ESP_OK;
+    }
+
+    rx_queue = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
+    if (rx_queue == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    rmt_rx_channel_config_t chan_config = {
+        .gpio_num = pin,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = 1000000, // 1 tick = 1 us
+        .mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL,
+    };
+    esp_err_t err = rmt_new_rx_channel(&chan_config, &rx_chan);
+    if (err != ESP_OK)
     {
-        if(count == timeout) return -1;
-        count += 2;
-        ets_delay_us(2);
-        
+        ESP_LOGE(TAG, "RMT RX channel failed: %s", esp_err_to_name(err));
+        rx_chan = NULL;
+        return err;
     }
 
-    return  count;
+    rmt_rx_event_callbacks_t cbs = {
+        .on_recv_done = dht11_rx_done_cb,
+    };
+    ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(rx_chan, &cbs, rx_queue));
+
+    // Same pad drives the start signal: GPIO open-drain output, RMT keeps its input path
+    dht_pin = pin;
+    gpio_set_level(pin, 1);
+    gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(pin, GPIO_PULLUP_ONLY);
+    return ESP_OK;
 }
 
-void hold_low(dht11_t dht11,int hold_time_us)
+/**
+ * @brief Unpack RMT symbols into the decoder's pulse list
+ */
+static size_t symbols_to_pulses(const rmt_symbol_word_t *symbols, size_t count)
 {
-    gpio_set_direction(dht11.dht11_pin,GPIO_MODE_OUTPUT);
-    gpio_set_level(dht11.dht11_pin,0);
-    ets_delay_us(hold_time_us);
-    gpio_set_level(dht11.dht11_pin,1);
+    size_t n = 0;
+    for (size_t i = 0; i < count && n + 2 <= sizeof(rx_pulses) / sizeof(rx_pulses[0]); i++)
+    {
+        rx_pulses[n++] = (dht11_pulse_t){.level = symbols[i].level0, .duration = symbols[i].duration0};
+        rx_pulses[n++] = (dht11_pulse_t){.level = symbols[i].level1, .duration = symbols[i].duration1};
+    }
+    return n;
 }
 
-int dht11_read(dht11_t *dht11,int connection_timeout)
+esp_err_t dht11_read(dht11_reading_t *out)
 {
-    int waited = 0;
-    int one_duration = 0;
-    int zero_duration = 0;
-    int timeout_counter = 0;
-
-    uint8_t recieved_data[5] = 
+    if (rx_chan == NULL)
     {
-        0x00,
-        0x00,
-        0x00,
-        0x00,
-        0x00
-    };
+        return ESP_ERR_INVALID_STATE;
+    }
+    stats.reads++;
 
-    while(timeout_counter < connection_timeout)
-    {
-        timeout_counter++;
-        gpio_set_direction(dht11->dht11_pin,GPIO_MODE_INPUT);
-        hold_low(*dht11, 18000);
-        
-        waited = wait_for_state(*dht11,0,40);
+    // Start signal, tick-based hold (+1 tick so it never comes out shorter than asked)
+    gpio_set_level(dht_pin, 0);
+    vTaskDelay(pdMS_TO_TICKS(DHT11_START_LOW_MS) + 1);
 
-        if(waited == -1)
+    // Armed before the release, the sensor answers 20-40 us after it.
+    // Enabled per capture only, an enabled channel holds its PM lock and would keep the chip out of light sleep.
+    xQueueReset(rx_queue);
+    esp_err_t err = rmt_enable(rx_chan);
+    if (err == ESP_OK)
+    {
+        err = rmt_receive(rx_chan, rx_symbols, sizeof(rx_symbols), &rx_config);
+        if (err != ESP_OK)
         {
-            ESP_LOGE("DHT11:","Failed at phase 1");
-            ets_delay_us(20000);
-            continue;
-        } 
+            rmt_disable(rx_chan);
+        }
+    }
+    gpio_set_level(dht_pin, 1);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "rmt_receive failed: %s", esp_err_to_name(err));
+        return err;
+    }
 
+    rmt_rx_done_event_data_t done;
+    bool received = xQueueReceive(rx_queue, &done, pdMS_TO_TICKS(DHT11_RX_TIMEOUT_MS) + 1) == pdTRUE;
+    rmt_disable(rx_chan); // also cancels a pending receive
+    if (!received)
+    {
+        stats.timeout++;
+        return ESP_ERR_TIMEOUT;
+    }
 
-        waited = wait_for_state(*dht11,1,80);
-        if(waited == -1) 
-        {
-            ESP_LOGE("DHT11:","Failed at phase 2");
-            ets_delay_us(20000);
-            continue;
-        } 
-        
-        waited = wait_for_state(*dht11,0,80);
-        if(waited == -1) 
-        {
-            ESP_LOGE("DHT11:","Failed at phase 3");
-            ets_delay_us(20000);
-            continue;
-        } 
+    size_t n = symbols_to_pulses(done.received_symbols, done.num_symbols);
+    dht11_decode_status_t status = dht11_decode(rx_pulses, n, out);
+    switch (status)
+    {
+    case DHT11_DECODE_OK:
+        stats.ok++;
+        return ESP_OK;
+    case DHT11_DECODE_CHECKSUM:
+        stats.checksum++;
+        ESP_LOGW(TAG, "Checksum: %02X %02X %02X %02X / %02X", out->raw[0], out->raw[1], out->raw[2], out->raw[3], out->raw[4]);
+        return ESP_ERR_INVALID_CRC;
+    case DHT11_DECODE_NO_RESPONSE:
+        stats.no_response++;
+        break;
+    case DHT11_DECODE_SHORT:
+        stats.short_frame++;
+        break;
+    case DHT11_DECODE_BAD_PULSE:
+        stats.bad_pulse++;
         break;
-        
     }
-    
-    if(timeout_counter == connection_timeout) return -1;
+    ESP_LOGW(TAG, "Bad frame (%s, %u symbols)", dht11_decode_status_str(status), (unsigned)done.num_symbols);
+    return ESP_ERR_INVALID_RESPONSE;
+}
 
-    for(int i = 0; i < 5; i++)
+static void dht11_sampler_task(void *pvParameter)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1)
     {
-        for(int j = 0; j < 8; j++)
+        dht11_reading_t reading;
+        esp_err_t err = ESP_FAIL;
+        for (int attempt = 0; attempt <= DHT11_MAX_RETRIES && err != ESP_OK; attempt++)
+        {
+            if (attempt > 0)
+            {
+                stats.retries++;
+                vTaskDelay(pdMS_TO_TICKS(DHT11_RETRY_DELAY_MS));
+            }
+            err = dht11_read(&reading);
+        }
+
+        if (err == ESP_OK)
+        {
+            taskENTER_CRITICAL(&cache_lock);
+            cache.temp_x10 = reading.temp_x10;
+            cache.humi_x10 = reading.humi_x10;
+            cache.timestamp = xTaskGetTickCount();
+            cache_valid = true;
+            taskEXIT_CRITICAL(&cache_lock);
+            if (sample_notify != NULL)
+            {
+                xTaskNotifyGive(sample_notify);
+            }
+            ESP_LOGD(TAG, "Temp = %d.%dC, Humi = %u.%u%%", reading.temp_x10 / 10, abs(reading.temp_x10 % 10),
+                     reading.humi_x10 / 10, reading.humi_x10 % 10);
+        }
+        else
         {
-            zero_duration = wait_for_state(*dht11,1,60);         
-            one_duration = wait_for_state(*dht11,0,80);
-            recieved_data[i] |= (one_duration > zero_duration) << (7 - j);
+            ESP_LOGE(TAG, "No valid frame after %d attempts, keeping the cached sample", DHT11_MAX_RETRIES + 1);
         }
+
+        // Retries eat into the cadence, xTaskDelayUntil() does not run late cycles twice
+        xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(sample_period_ms));
+    }
+}
+
+esp_err_t dht11_sampler_start(gpio_num_t pin, uint32_t period_ms)
+{
+    esp_err_t err = dht11_init(pin);
+    if (err != ESP_OK)
+    {
+        return err;
     }
-    dht11->humidity = recieved_data[0] + recieved_data[1] /10.0 ;
-    dht11->temperature = recieved_data[2] + recieved_data[3] /10.0 ;
-    return 0;
+    if (period_ms != 0)
+    {
+        sample_period_ms = period_ms;
+    }
+    if (xTaskCreate(dht11_sampler_task, "dht11_task", DHT11_TASK_STACK, NULL, DHT11_TASK_PRIO, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create the sampling task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Sampling GPIO %d every %lu ms (RMT)", pin, (unsigned long)sample_period_ms);
+    return ESP_OK;
+}
+
+bool dht11_get_sample(dht11_sample_t *out)
+{
+    taskENTER_CRITICAL(&cache_lock);
+    bool valid = cache_valid;
+    *out = cache;
+    taskEXIT_CRITICAL(&cache_lock);
+
+    if (valid)
+    {
+        out->age_ms = (uint32_t)pdTICKS_TO_MS(xTaskGetTickCount() - out->timestamp);
+    }
+    return valid;
+}
+
+void dht11_get_stats(dht11_stats_t *out)
+{
+    *out = stats;
+}
+
+void dht11_set_sample_notify(TaskHandle_t task)
+{
+    sample_notify = task;
 }
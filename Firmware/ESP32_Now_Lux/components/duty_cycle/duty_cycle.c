@@ -0,0 +1,128 @@
+#include "duty_cycle.h"
+#include <string.h>
+
+void duty_cycle_init(duty_cycle_t *d, const duty_cycle_config_t *cfg)
+{
+    memset(d, 0, sizeof(*d));
+    d->cfg = *cfg;
+}
+
+void duty_cycle_reset(duty_cycle_t *d)
+{
+    d->synced = false;
+    d->period_ms = 0;
+    d->have_last = false;
+    d->missed_run = 0;
+}
+
+/**
+ * @brief Fold one observed poll interval into the period: under half of it is a re-send of the same
+ *        poll, over 1.5x spans a missed one
+ */
+static void learn_period(duty_cycle_t *d, uint32_t interval)
+{
+    if (d->period_ms == 0)
+    {
+        d->period_ms = interval;
+    }
+    else if (interval > d->period_ms / 2 && interval < d->period_ms + d->period_ms / 2)
+    {
+        d->period_ms = (d->period_ms * 3 + interval) / 4;
+    }
+}
+
+void duty_cycle_poll(duty_cycle_t *d, uint32_t now_ms, uint32_t next_ms)
+{
+    d->stats.polls++;
+    d->missed_run = 0;
+
+    // Announced: consecutive targets are the master's cycle starts, free of wake skew and re-send delays.
+    // Otherwise the period comes from the arrivals.
+    if (next_ms != 0)
+    {
+        if (d->period_ms == 0)
+        {
+            d->period_ms = next_ms;
+        }
+        else if (d->synced)
+        {
+            learn_period(d, now_ms + next_ms - d->next_poll_ms);
+        }
+    }
+    else if (d->have_last)
+    {
+        learn_period(d, now_ms - d->last_poll_ms);
+    }
+    d->last_poll_ms = now_ms;
+    d->have_last = true;
+
+    uint32_t next = next_ms != 0 ? next_ms : d->period_ms;
+    if (next != 0)
+    {
+        d->next_poll_ms = now_ms + next;
+        d->synced = true;
+    }
+}
+
+uint32_t duty_cycle_listen_ms(const duty_cycle_t *d, uint32_t now_ms)
+{
+    if (!d->synced)
+    {
+        return DUTY_WAIT_FOREVER;
+    }
+    int32_t left = (int32_t)(d->next_poll_ms + d->cfg.listen_ms - now_ms);
+    return left > 0 ? (uint32_t)left : 0;
+}
+
+void duty_cycle_missed(duty_cycle_t *d, uint32_t now_ms)
+{
+    if (!d->synced)
+    {
+        return;
+    }
+    d->stats.missed++;
+    d->missed_run++;
+    if (d->missed_run >= d->cfg.resync_after || d->period_ms == 0)
+    {
+        d->synced = false;
+        d->missed_run = 0;
+        d->stats.resyncs++;
+        return;
+    }
+
+    // Next window still ahead, windows overslept are missed as well
+    d->next_poll_ms += d->period_ms;
+    while ((int32_t)(d->next_poll_ms + d->cfg.listen_ms - now_ms) <= 0)
+    {
+        d->next_poll_ms += d->period_ms;
+        d->stats.missed++;
+    }
+}
+
+uint32_t duty_cycle_sleep_ms(const duty_cycle_t *d, uint32_t now_ms)
+{
+    if (!d->synced)
+    {
+        return 0;
+    }
+    int32_t gap = (int32_t)(d->next_poll_ms - d->cfg.guard_ms - now_ms);
+    return gap >= (int32_t)d->cfg.min_sleep_ms && gap > 0 ? (uint32_t)gap : 0;
+}
+
+void duty_cycle_account(duty_cycle_t *d, uint32_t awake_ms, uint32_t sleep_ms)
+{
+    d->stats.cycles++;
+    d->stats.last_awake_ms = awake_ms;
+    d->stats.awake_ms += awake_ms;
+    d->stats.sleep_ms += sleep_ms;
+}
+
+uint16_t duty_cycle_permille(const duty_cycle_t *d)
+{
+    uint64_t total = d->stats.awake_ms + d->stats.sleep_ms;
+    if (total == 0)
+    {
+        return 1000;
+    }
+    return (uint16_t)(d->stats.awake_ms * 1000 / total);
+}
@@ -0,0 +1,122 @@
+#include "push_policy.h"
+#include <string.h>
+
+bool push_policy_valid(const push_policy_config_t *cfg)
+{
+    if (cfg->field_count == 0 || cfg->field_count > PUSH_MAX_FIELDS)
+    {
+        return false;
+    }
+    for (int f = 0; f < cfg->field_count; f++)
+    {
+        if (cfg->field[f].rel_delta_pm > 1000)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void push_policy_init(push_policy_t *p, const push_policy_config_t *cfg)
+{
+    memset(p, 0, sizeof(*p));
+    p->cfg = *cfg;
+}
+
+/**
+ * @brief Threshold side of a value, 0 inside the hysteresis band
+ */
+static int8_t threshold_side(const push_field_policy_t *fp, int32_t value)
+{
+    if (value >= fp->threshold + (int32_t)fp->threshold_hyst)
+    {
+        return 1;
+    }
+    if (value <= fp->threshold - (int32_t)fp->threshold_hyst)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief true if value moved past the delta or crossed the threshold since the last report
+ */
+static bool field_changed(const push_field_policy_t *fp, int32_t last, int8_t side, int32_t value)
+{
+    if (fp->threshold_en)
+    {
+        int8_t now_side = threshold_side(fp, value);
+        if (now_side != 0 && now_side != side)
+        {
+            return true;
+        }
+    }
+
+    uint32_t delta = value > last ? (uint32_t)(value - last) : (uint32_t)(last - value);
+    uint32_t base = last < 0 ? (uint32_t)-last : (uint32_t)last;
+    return delta != 0 && ((fp->abs_delta != 0 && delta >= fp->abs_delta) ||
+                          (fp->rel_delta_pm != 0 && delta * 1000u >= base * fp->rel_delta_pm));
+}
+
+push_reason_t push_policy_decide(push_policy_t *p, const int32_t *value, uint32_t now_ms)
+{
+    p->stats.samples++;
+    if (!p->reported)
+    {
+        return PUSH_CHANGE;
+    }
+
+    uint32_t elapsed = now_ms - p->last_ms;
+    bool changed = false;
+    for (int f = 0; f < p->cfg.field_count && !changed; f++)
+    {
+        changed = field_changed(&p->cfg.field[f], p->last[f], p->side[f], value[f]);
+    }
+
+    if (changed)
+    {
+        if (elapsed >= p->cfg.min_interval_ms)
+        {
+            return PUSH_CHANGE;
+        }
+        p->stats.rate_limited++;
+    }
+    if (p->cfg.heartbeat_ms != 0 && elapsed >= p->cfg.heartbeat_ms)
+    {
+        return PUSH_HEARTBEAT;
+    }
+    return PUSH_NONE;
+}
+
+void push_policy_reported(push_policy_t *p, const int32_t *value, uint32_t now_ms, push_reason_t reason)
+{
+    for (int f = 0; f < p->cfg.field_count; f++)
+    {
+        const push_field_policy_t *fp = &p->cfg.field[f];
+        p->last[f] = value[f];
+        if (fp->threshold_en)
+        {
+            // Inside the band the side stays, so hovering at the level does not push
+            int8_t side = threshold_side(fp, value[f]);
+            if (side != 0)
+            {
+                p->side[f] = side;
+            }
+        }
+    }
+    p->reported = true;
+    p->last_ms = now_ms;
+    switch (reason)
+    {
+    case PUSH_CHANGE:
+        p->stats.pushed_change++;
+        break;
+    case PUSH_HEARTBEAT:
+        p->stats.pushed_heartbeat++;
+        break;
+    case PUSH_NONE:
+        p->stats.polled++;
+        break;
+    }
+}
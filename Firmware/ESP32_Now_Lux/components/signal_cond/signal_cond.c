@@ -0,0 +1,130 @@
+#include "signal_cond.h"
+#include <string.h>
+#include <math.h>
+#include "dsps_biquad.h"
+#include "dsps_biquad_gen.h"
+
+bool signal_cond_valid(const cond_config_t *cfg)
+{
+    if (cfg->field_count == 0 || cfg->field_count > COND_MAX_FIELDS || cfg->window == 0)
+    {
+        return false;
+    }
+    for (int f = 0; f < cfg->field_count; f++)
+    {
+        const cond_field_config_t *fc = &cfg->field[f];
+        if (fc->filter == COND_FILTER_LOWPASS && (!(fc->cutoff > 0.0f && fc->cutoff < 0.5f) || !(fc->q > 0.0f)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool signal_cond_init(signal_cond_t *c, const cond_config_t *cfg)
+{
+    memset(c, 0, sizeof(*c));
+    if (!signal_cond_valid(cfg))
+    {
+        return false;
+    }
+    c->cfg = *cfg;
+    for (int f = 0; f < cfg->field_count; f++)
+    {
+        if (cfg->field[f].filter == COND_FILTER_LOWPASS)
+        {
+            dsps_biquad_gen_lpf_f32(c->coef[f], cfg->field[f].cutoff, cfg->field[f].q);
+        }
+        else
+        {
+            c->coef[f][0] = 1.0f; // pass-through
+        }
+    }
+    return true;
+}
+
+static void stats_add(cond_stats_t *s, float x)
+{
+    if (s->n == 0)
+    {
+        s->min = x;
+        s->max = x;
+    }
+    else
+    {
+        s->min = x < s->min ? x : s->min;
+        s->max = x > s->max ? x : s->max;
+    }
+    s->n++;
+    float delta = x - s->mean;
+    s->mean += delta / s->n;
+    s->m2 += delta * (x - s->mean);
+}
+
+bool signal_cond_update(signal_cond_t *c, const float *sample)
+{
+    for (int f = 0; f < c->cfg.field_count; f++)
+    {
+        float x = sample[f];
+        if (!c->primed)
+        {
+            // Direct form II steady state for a constant input x: w = x / (1 + a1 + a2)
+            float w = x / (1.0f + c->coef[f][3] + c->coef[f][4]);
+            c->w[f][0] = w;
+            c->w[f][1] = w;
+        }
+        dsps_biquad_f32(&x, &c->filtered[f], 1, c->coef[f], c->w[f]);
+        c->raw[f] = x;
+        stats_add(&c->window[f], x);
+    }
+    c->primed = true;
+    c->samples++;
+
+    if (c->window[0].n < c->cfg.window)
+    {
+        return false;
+    }
+    memcpy(c->last, c->window, sizeof(c->last));
+    memset(c->window, 0, sizeof(c->window));
+    c->have_last = true;
+    c->windows++;
+    return true;
+}
+
+bool signal_cond_output(const signal_cond_t *c, float *value)
+{
+    if (!c->primed)
+    {
+        return false;
+    }
+    for (int f = 0; f < c->cfg.field_count; f++)
+    {
+        switch (c->cfg.output)
+        {
+        case COND_OUTPUT_FILTERED:
+            value[f] = c->filtered[f];
+            break;
+        case COND_OUTPUT_SUMMARY:
+            value[f] = signal_cond_stats(c, f)->mean;
+            break;
+        default:
+            value[f] = c->raw[f];
+            break;
+        }
+    }
+    return true;
+}
+
+const cond_stats_t *signal_cond_stats(const signal_cond_t *c, uint8_t field)
+{
+    if (!c->primed || field >= c->cfg.field_count)
+    {
+        return NULL;
+    }
+    return c->have_last ? &c->last[field] : &c->window[field];
+}
+
+float cond_stats_stddev(const cond_stats_t *s)
+{
+    return s->n > 1 ? sqrtf(s->m2 / (s->n - 1)) : 0.0f;
+}
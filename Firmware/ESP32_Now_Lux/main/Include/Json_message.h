@@ -3,10 +3,16 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "cJSON.h"
+#include "json_writer.h"
+#include "json_reader.h"
 
 #define SLAVE_NAME_LEN 32
 #define MAC_STR_LEN 18
+#define JSON_TYPE_STR_LEN 24 // longest TYPE is "discovery_response"
+#define JSON_MSG_MAX_LEN 250 // ESP-NOW payload limit, buffer size for the encoders
+#define JSON_STATS_DIGITS 6  // significant digits of the STATS numbers, lux up to ~100000
 
 // Defines the type of JSON message
 typedef enum
@@ -38,6 +44,8 @@ typedef struct
     // Fields for control messages
     bool has_cmd;
     json_cmd_t cmd;
+
+    uint32_t next_ms; // ask_data: ms until the master's next poll ("NEXT"), 0 if not announced
 } json_master_msg_t;
 
 /* --- Slave -> Master Message Structures --- */
@@ -62,6 +70,22 @@ typedef struct
         int humi;
         int lux;
     } data;
+    bool push; // unsolicited (report-by-exception), adds "PUSH":true
+    bool has_duty; // adds "DUTY":{awake, missed, duty}, sleep statistics for tuning
+    struct
+    {
+        uint32_t awake_ms; // awake time of the last sleep cycle
+        uint32_t missed;   // polls missed since boot
+        uint16_t duty_pm;  // awake share in permille
+    } duty;
+    bool has_stats; // adds "STATS":{n, <field>:[min, max, sd]} of the last window, data is its mean
+    struct
+    {
+        uint16_t n;         // samples in the window
+        float min[1];
+        float max[1];
+        float sd[1];       // sample standard deviation
+    } stats;
 } json_slave_data_t;
 
 /* --- Function Prototypes --- */
@@ -70,27 +94,29 @@ typedef struct
  * @brief Decodes a JSON string into a master message structure.
  *
  * @param json_str The JSON string received from the master.
- * @return A pointer to a dynamically allocated json_master_msg_t structure, or NULL on failure.
- *         The caller is responsible for freeing this memory.
+ * @param msg Filled on success (nothing is allocated).
+ * @return true on success, false if the JSON is malformed or TYPE / ID are missing.
  */
-json_master_msg_t *json_decode_master_msg(const char *json_str);
+bool json_decode_master_msg(const char *json_str, json_master_msg_t *msg);
 
 /**
  * @brief Encodes a slave discovery response structure into a JSON string.
  *
  * @param disc_resp Pointer to the discovery response structure.
- * @return A dynamically allocated JSON string, or NULL on failure.
- *         The caller is responsible for freeing this memory.
+ * @param json_out Buffer for the JSON string (nothing is allocated).
+ * @param out_size Size of json_out, JSON_MSG_MAX_LEN fits any message.
+ * @return Length of the JSON string, or 0 if it does not fit.
  */
-char *json_encode_slave_discovery_response(const json_slave_disc_resp_t *disc_resp);
+size_t json_encode_slave_discovery_response(const json_slave_disc_resp_t *disc_resp, char *json_out, size_t out_size);
 
 /**
  * @brief Encodes a slave data response structure into a JSON string.
  *
  * @param data_resp Pointer to the data response structure.
- * @return A dynamically allocated JSON string, or NULL on failure.
- *         The caller is responsible for freeing this memory.
+ * @param json_out Buffer for the JSON string (nothing is allocated).
+ * @param out_size Size of json_out, JSON_MSG_MAX_LEN fits any message.
+ * @return Length of the JSON string, or 0 if it does not fit.
  */
-char *json_encode_slave_data(const json_slave_data_t *data_resp);
+size_t json_encode_slave_data(const json_slave_data_t *data_resp, char *json_out, size_t out_size);
 
 #endif // JSON_MESSAGE_H
\ No newline at end of file
@@ -1,136 +1,72 @@
-/*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
- *
- * SPDX-License-Identifier: Apache-2.0
- */
+#ifndef __BH1750_H__
+#define __BH1750_H__
 
-#pragma once
-
-#ifdef __cplusplus
-extern "C"
-{
-#endif
-
-#include "driver/i2c.h" 
-#include <stdio.h>
-#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include "esp_err.h"
-#include "esp_log.h"
-
-    typedef enum
-    {
-        BH1750_CONTINUE_1LX_RES = 0x10,    /*!< Command to set measure mode as Continuously H-Resolution mode*/
-        BH1750_CONTINUE_HALFLX_RES = 0x11, /*!< Command to set measure mode as Continuously H-Resolution mode2*/
-        BH1750_CONTINUE_4LX_RES = 0x13,    /*!< Command to set measure mode as Continuously L-Resolution mode*/
-        BH1750_ONETIME_1LX_RES = 0x20,     /*!< Command to set measure mode as One Time H-Resolution mode*/
-        BH1750_ONETIME_HALFLX_RES = 0x21,  /*!< Command to set measure mode as One Time H-Resolution mode2*/
-        BH1750_ONETIME_4LX_RES = 0x23,     /*!< Command to set measure mode as One Time L-Resolution mode*/
-    } bh1750_measure_mode_t;
-
-#define BH1750_I2C_ADDRESS_DEFAULT (0x23)
-    typedef void *bh1750_handle_t;
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bh1750_core.h"
 
-    /**
-     * @brief Set bh1750 as power down mode (low current)
-     *
-     * @param sensor object handle of bh1750
-     *
-     * @return
-     *     - ESP_OK Success
-     *     - ESP_FAIL Fail
-     */
-    esp_err_t bh1750_power_down(bh1750_handle_t sensor);
+/*
+ * BH1750 on the i2c_master bus/device driver. A background task measures at a fixed cadence
+ * (bh1750_core: auto-ranging, one-time or continuous mode) and caches the latest lux, data
+ * requests read the cache. I2C errors resync the sensor, repeated ones reset the bus and back off.
+ */
 
-    /**
-     * @brief Set bh1750 as power on mode
-     *
-     * @param sensor object handle of bh1750
-     *
-     * @return
-     *     - ESP_OK Success
-     *     - ESP_FAIL Fail
-     */
-    esp_err_t bh1750_power_on(bh1750_handle_t sensor);
+// ============ CONFIG ============
+#define BH1750_I2C_SDA_IO 8
+#define BH1750_I2C_SCL_IO 9
+#define BH1750_I2C_FREQ_HZ 100000
+#define BH1750_I2C_TIMEOUT_MS 50
+#define BH1750_SAMPLE_PERIOD_MS 1000  // cadence, the dark range alone takes up to 663 ms
+#define BH1750_BUS_RESET_AFTER 3      // consecutive I2C errors before a bus reset
+#define BH1750_BACKOFF_MAX_MS 30000   // retry delay doubles per consecutive error up to this
+#define BH1750_SATURATED_RETRIES 3    // immediate re-measures after a clipped reading (range already widened)
+#define BH1750_TASK_STACK 3072
+#define BH1750_TASK_PRIO 3
 
-    /**
-     * @brief Get light intensity from bh1750
-     *
-     * @param     sensor object handle of bh1750
-     * @param[in] cmd_measure the instruction to set measurement mode
-     *
-     * @note
-     *        You should call this funtion to set measurement mode before call bh1750_get_data() to acquire data.
-     *        If you set onetime mode, you just can get one measurement result.
-     *        If you set continuous mode, you can call bh1750_get_data() to acquire data repeatedly.
-     *
-     * @return
-     *     - ESP_OK Success
-     *     - ESP_FAIL Fail
-     */
-    esp_err_t bh1750_set_measure_mode(bh1750_handle_t sensor, const bh1750_measure_mode_t cmd_measure);
+// ============ STRUCTURES ============
+typedef struct
+{
+    float lux;
+    bh1750_res_t res;     // range it was measured with
+    uint8_t mtreg;
+    bool saturated;       // brighter than the widest range, lux is a lower bound
+    TickType_t timestamp; // tick of the measurement
+    uint32_t age_ms;      // filled by bh1750_get_sample()
+} bh1750_sample_t;
 
-    /**
-     * @brief Get light intensity from BH1750
-     *
-     * Returns light intensity in [lx] corrected by typical BH1750 Measurement Accuracy (= 1.2).
-     *
-     * @see BH1750 datasheet Rev. D page 2
-     *
-     * @note
-     *        You should acquire data from the sensor after the measurement time is over,
-     *        so take care of measurement time in different modes.
-     *
-     * @param      sensor object handle of bh1750
-     * @param[out] data light intensity value got from bh1750 in [lx]
-     *
-     * @return
-     *     - ESP_OK Success
-     *     - ESP_FAIL Fail
-     */
-    esp_err_t bh1750_get_data(bh1750_handle_t sensor, float *const data);
+typedef struct
+{
+    uint32_t reads;         // measurements attempted
+    uint32_t ok;
+    uint32_t i2c_errors;
+    uint32_t bus_resets;
+    uint32_t range_changes;
+    uint32_t saturated;
+} bh1750_stats_t;
 
-    /**
-     * @brief Set measurement time
-     *
-     * This function is used to adjust BH1750 sensitivity, i.e. compensating influence from optical window.
-     *
-     * @see BH1750 datasheet Rev. D page 11
-     *
-     * @param     sensor object handle of bh1750
-     * @param[in] measure_time measurement time
-     *
-     * @return
-     *     - ESP_OK Success
-     *     - ESP_FAIL Fail
-     */
-    esp_err_t bh1750_set_measure_time(bh1750_handle_t sensor, const uint8_t measure_time);
+// ============ API ============
+/**
+ * @brief Create the I2C bus and device, start the sampling task
+ * @note A missing sensor is not fatal, the task keeps retrying with backoff
+ * @param cfg Mode / ranging, NULL = one-time auto-ranging from H-res MTreg 69
+ * @param period_ms Sampling cadence, 0 = BH1750_SAMPLE_PERIOD_MS
+ */
+esp_err_t bh1750_sampler_start(const bh1750_config_t *cfg, uint32_t period_ms);
 
-    /**
-     * @brief Create and init sensor object and return a sensor handle
-     *
-     * @param     port     I2C port number
-     * @param[in] dev_addr I2C device address of sensor
-     *
-     * @return
-     *     - NULL Fail
-     *     - Others Success
-     */
-    bh1750_handle_t bh1750_create(i2c_port_t port, const uint16_t dev_addr);
+/**
+ * @brief Latest valid sample from the cache, never touches the bus
+ * @return false if no valid sample yet
+ */
+bool bh1750_get_sample(bh1750_sample_t *out);
 
-    /**
-     * @brief Delete and release a sensor object
-     *
-     * @param sensor object handle of bh1750
-     *
-     * @return
-     *     - ESP_OK Success
-     *     - ESP_FAIL Fail
-     */
-    esp_err_t bh1750_delete(bh1750_handle_t sensor);
+void bh1750_get_stats(bh1750_stats_t *out);
 
-    void Bh1750_Init(void);
-    float Bh1750_Read();
+/**
+ * @brief Task notified (xTaskNotifyGive) after every new cached sample, NULL = none
+ */
+void bh1750_set_sample_notify(TaskHandle_t task);
 
-#ifdef __cplusplus
-}
-#endif
+#endif // __BH1750_H__
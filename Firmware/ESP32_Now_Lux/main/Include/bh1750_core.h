@@ -0,0 +1,119 @@
+#ifndef __BH1750_CORE_H__
+#define __BH1750_CORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * BH1750 protocol and auto-ranging over an abstract bus, no ESP-IDF dependency (host testable with a mock bus).
+ * A measurement is split in bh1750_start() (commands, returns the conversion time) and bh1750_fetch()
+ * (result + range for the next one), the caller waits in between however it likes.
+ *
+ * Auto-ranging ladder, fast -> sensitive (lux = count / 1.2 * 69 / MTreg, / 2 in H-res2):
+ *   L-res   MTreg 31   max 11 ms   step ~8.9 lx   full scale ~121 klx
+ *   H-res   MTreg 69   max 180 ms  step 1 lx      full scale ~54.6 klx
+ *   H-res2  MTreg 69   max 180 ms  step 0.5 lx    full scale ~27.3 klx
+ *   H-res2  MTreg 254  max 663 ms  step ~0.14 lx  full scale ~7.4 klx
+ * The next range is the first one whose step is <= 1 % of the reading and whose full scale is >= 2x the reading.
+ * A more sensitive range is only taken once the current one no longer holds (step > 2 % or count > 90 %
+ * of full scale), so readings near a boundary do not flip between two ranges.
+ */
+
+// ============ CONFIG ============
+#define BH1750_I2C_ADDRESS_DEFAULT 0x23 // ADDR pin low, 0x5C if high
+#define BH1750_MTREG_MIN 31
+#define BH1750_MTREG_DEFAULT 69
+#define BH1750_MTREG_MAX 254
+#define BH1750_RANGE_ENTER_STEP_PERMILLE 10 // range taken if its step is <= this share of the reading
+#define BH1750_RANGE_HOLD_STEP_PERMILLE 20  // and kept while the step stays <= this share
+#define BH1750_RANGE_ENTER_FULL_PERCENT 50  // range taken if the reading is <= this share of its full scale
+#define BH1750_RANGE_HOLD_FULL_PERCENT 90   // and kept while the count stays below this share
+
+// ============ ENUMS ============
+typedef enum
+{
+    BH1750_RES_LOW = 0, // 4 lx, ~16 ms
+    BH1750_RES_HIGH,    // 1 lx, ~120 ms
+    BH1750_RES_HIGH2,   // 0.5 lx, ~120 ms
+} bh1750_res_t;
+
+// ============ STRUCTURES ============
+/**
+ * @brief Bus access, return 0 on success, the bus error code otherwise (esp_err_t on target)
+ */
+typedef struct
+{
+    int (*write)(void *ctx, const uint8_t *data, size_t len);
+    int (*read)(void *ctx, uint8_t *data, size_t len);
+    void *ctx;
+} bh1750_bus_t;
+
+typedef struct
+{
+    bool one_time;      // one-time mode, the sensor powers down after each conversion
+    bool auto_range;    // walk the ladder above, res / mtreg are the start point
+    bh1750_res_t res;
+    uint8_t mtreg;      // 31..254
+} bh1750_config_t;
+
+typedef struct
+{
+    bh1750_bus_t bus;
+    bh1750_config_t cfg;
+    bh1750_res_t res;   // range of the next / running measurement
+    uint8_t mtreg;
+    bool synced;        // sensor holds our MTreg and continuous mode, false after an error
+    uint8_t sensor_mtreg;
+    bh1750_res_t sensor_res;
+} bh1750_t;
+
+typedef struct
+{
+    float lux;
+    uint16_t raw;
+    bh1750_res_t res;   // range the value was measured with
+    uint8_t mtreg;
+    bool saturated;     // clipped at 0xFFFF, the range is already changed for the next measurement
+} bh1750_reading_t;
+
+// ============ API ============
+void bh1750_core_init(bh1750_t *dev, const bh1750_bus_t *bus, const bh1750_config_t *cfg);
+
+/**
+ * @brief Send what the next measurement needs (power on, MTreg, mode)
+ * @param wait_ms Max conversion time, read the result with bh1750_fetch() after it
+ * @return 0 or the bus error
+ */
+int bh1750_start(bh1750_t *dev, uint32_t *wait_ms);
+
+/**
+ * @brief Read the result of the measurement started last and pick the range of the next one
+ * @return 0 or the bus error
+ */
+int bh1750_fetch(bh1750_t *dev, bh1750_reading_t *out);
+
+/**
+ * @brief Power down (continuous mode stops), the next bh1750_start() sets the sensor up again
+ */
+int bh1750_power_down(bh1750_t *dev);
+
+/**
+ * @brief Force a full setup on the next bh1750_start(), after a bus error or reset
+ */
+void bh1750_resync(bh1750_t *dev);
+
+/**
+ * @brief Pure helpers used by the driver
+ */
+uint32_t bh1750_measure_time_ms(bh1750_res_t res, uint8_t mtreg);
+float bh1750_raw_to_lux(uint16_t raw, bh1750_res_t res, uint8_t mtreg);
+float bh1750_full_scale_lux(bh1750_res_t res, uint8_t mtreg);
+
+/**
+ * @brief Auto-ranging decision for a reading (policy in the header comment)
+ * @return true if the range changes
+ */
+bool bh1750_next_range(uint16_t raw, bh1750_res_t res, uint8_t mtreg, bh1750_res_t *next_res, uint8_t *next_mtreg);
+
+#endif // __BH1750_CORE_H__
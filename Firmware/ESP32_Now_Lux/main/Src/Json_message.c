@@ -48,95 +48,110 @@ static const char *get_string_from_type(json_msg_type_t type)
 
 /**
  * @brief Decode a JSON string into a master message structure.
- * @details Parses the JSON string and fills the json_master_msg_t structure.
+ * @details Binds TYPE, ID and the optional NEXT straight into msg in one pass over the tokens, nothing is allocated.
  * @param json_str
- * @return json_master_msg_t*
+ * @param msg
+ * @return true on success, false if the JSON is malformed or TYPE / ID are missing
  */
-json_master_msg_t *json_decode_master_msg(const char *json_str)
+bool json_decode_master_msg(const char *json_str, json_master_msg_t *msg)
 {
-    cJSON *json = cJSON_Parse(json_str);
-    if (json == NULL)
+    char type_str[JSON_TYPE_STR_LEN];
+    int32_t next = 0;
+    const json_field_t fields[] = {
+        {"TYPE", JSON_FIELD_STRING, true, type_str, sizeof(type_str)},
+        {"ID", JSON_FIELD_STRING, true, msg->id, sizeof(msg->id)},
+        {"NEXT", JSON_FIELD_INT, false, &next, 0},
+    };
+    json_read_error_t err;
+
+    memset(msg, 0, sizeof(*msg));
+    if (!json_bind(json_str, strlen(json_str), fields, 3, NULL, &err))
     {
-        ESP_LOGE(TAG, "Failed to parse JSON string.");
-        return NULL;
+        ESP_LOGE(TAG, "Bad master message: %s at %u%s%s", json_read_status_str(err.status), err.pos,
+                 err.field ? ", field " : "", err.field ? err.field : "");
+        return false;
     }
 
-    cJSON *type_item = cJSON_GetObjectItem(json, "TYPE");
-    cJSON *id_item = cJSON_GetObjectItem(json, "ID");
-
-    if (!cJSON_IsString(type_item) || !cJSON_IsString(id_item))
-    {
-        ESP_LOGE(TAG, "JSON message missing 'TYPE' or 'ID' fields.");
-        cJSON_Delete(json);
-        return NULL;
-    }
-
-    json_master_msg_t *msg = (json_master_msg_t *)malloc(sizeof(json_master_msg_t));
-    if (msg == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to allocate memory for master message.");
-        cJSON_Delete(json);
-        return NULL;
-    }
-
-    msg->type = get_type_from_string(type_item->valuestring);
-    strncpy(msg->id, id_item->valuestring, MAC_STR_LEN - 1);
-    msg->id[MAC_STR_LEN - 1] = '\0';
-
-    cJSON_Delete(json);
-    return msg;
+    msg->type = get_type_from_string(type_str);
+    msg->next_ms = next > 0 ? (uint32_t)next : 0;
+    return true;
 }
 
 /**
  * @brief Encode a slave discovery response into a JSON string.
- * @details Converts the json_slave_disc_resp_t structure into a JSON formatted string.
+ * @details Converts the json_slave_disc_resp_t structure into a JSON formatted string,
+ *          written straight into json_out without building a cJSON tree.
  * @param disc_resp
- * @return char*
+ * @param json_out
+ * @param out_size
+ * @return size_t length, 0 if json_out is too small
  */
-char *json_encode_slave_discovery_response(const json_slave_disc_resp_t *disc_resp)
+size_t json_encode_slave_discovery_response(const json_slave_disc_resp_t *disc_resp, char *json_out, size_t out_size)
 {
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL)
+    json_writer_t w;
+    json_writer_init(&w, json_out, out_size);
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "TYPE", get_string_from_type(disc_resp->type));
+    json_writer_string(&w, "ID", disc_resp->id);
+    json_writer_string(&w, "NAME", disc_resp->name);
+    json_writer_end_object(&w);
+
+    size_t len = json_writer_finish(&w);
+    if (len == 0)
     {
-        ESP_LOGE(TAG, "Failed to create cJSON object.");
-        return NULL;
+        ESP_LOGE(TAG, "Discovery response does not fit %u bytes.", (unsigned)out_size);
     }
-
-    cJSON_AddStringToObject(root, "TYPE", get_string_from_type(disc_resp->type));
-    cJSON_AddStringToObject(root, "ID", disc_resp->id);
-    cJSON_AddStringToObject(root, "NAME", disc_resp->name);
-
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    return json_str;
+    return len;
 }
 
-char *json_encode_slave_data(const json_slave_data_t *data_resp)
+/**
+ * @brief Encode a slave data response into a JSON string.
+ * @details Same layout as before: {"TYPE":..,"ID":..,"DST":..,"data":{..}}
+ * @param data_resp
+ * @param json_out
+ * @param out_size
+ * @return size_t length, 0 if json_out is too small
+ */
+size_t json_encode_slave_data(const json_slave_data_t *data_resp, char *json_out, size_t out_size)
 {
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL)
+    json_writer_t w;
+    json_writer_init(&w, json_out, out_size);
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "TYPE", get_string_from_type(data_resp->type));
+    json_writer_string(&w, "ID", data_resp->id);
+    json_writer_string(&w, "DST", data_resp->dst);
+    json_writer_begin_object(&w, "data");
+    json_writer_int(&w, "lux", data_resp->data.lux);
+    json_writer_end_object(&w);
+    if (data_resp->push)
     {
-        ESP_LOGE(TAG, "Failed to create cJSON object.");
-        return NULL;
+        json_writer_bool(&w, "PUSH", true);
     }
-
-    cJSON_AddStringToObject(root, "TYPE", get_string_from_type(data_resp->type));
-    cJSON_AddStringToObject(root, "ID", data_resp->id);
-    cJSON_AddStringToObject(root, "DST", data_resp->dst);
-
-    cJSON *data_obj = cJSON_CreateObject();
-    if (data_obj == NULL)
+    if (data_resp->has_duty)
     {
-        ESP_LOGE(TAG, "Failed to create data sub-object.");
-        cJSON_Delete(root);
-        return NULL;
+        json_writer_begin_object(&w, "DUTY");
+        json_writer_uint(&w, "awake", data_resp->duty.awake_ms);
+        json_writer_uint(&w, "missed", data_resp->duty.missed);
+        json_writer_uint(&w, "duty", data_resp->duty.duty_pm);
+        json_writer_end_object(&w);
     }
-    cJSON_AddItemToObject(root, "data", data_obj);
-    cJSON_AddNumberToObject(data_obj, "lux", data_resp->data.lux);
-
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
+    if (data_resp->has_stats)
+    {
+        json_writer_begin_object(&w, "STATS");
+        json_writer_uint(&w, "n", data_resp->stats.n);
+        json_writer_begin_array(&w, "lux");
+        json_writer_double(&w, NULL, data_resp->stats.min[0], JSON_STATS_DIGITS);
+        json_writer_double(&w, NULL, data_resp->stats.max[0], JSON_STATS_DIGITS);
+        json_writer_double(&w, NULL, data_resp->stats.sd[0], JSON_STATS_DIGITS);
+        json_writer_end_array(&w);
+        json_writer_end_object(&w);
+    }
+    json_writer_end_object(&w);
 
-    return json_str;
-}
\ No newline at end of file
+    size_t len = json_writer_finish(&w);
+    if (len == 0)
+    {
+        ESP_LOGE(TAG, "Data response does not fit %u bytes.", (unsigned)out_size);
+    }
+    return len;
+}
@@ -1,183 +1,204 @@
-/*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
- *
- * SPDX-License-Identifier: Apache-2.0
- */
-
 #include "bh1750.h"
-
-static const char *TAG_BH1750 = "bh1750_main";
-
-#define BH_1750_MEASUREMENT_ACCURACY 1.2 /*!< the typical measurement accuracy of  BH1750 sensor */
-
-#define BH1750_POWER_DOWN 0x00 /*!< Command to set Power Down*/
-#define BH1750_POWER_ON 0x01   /*!< Command to set Power On*/
-
-#define I2C_MASTER_SCL_IO 9       /*!< GPIO cho I2C clock */
-#define I2C_MASTER_SDA_IO 8       /*!< GPIO cho I2C data */
-#define I2C_MASTER_NUM I2C_NUM_0  /*!< Cổng I2C */
-#define I2C_MASTER_FREQ_HZ 100000 /*!< Tần số I2C master */
-
-static bh1750_handle_t bh1750 = NULL;
-
-typedef struct
+#include "freertos/task.h"
+#include "driver/i2c_master.h"
+#include "esp_log.h"
+
+static const char *TAG = "BH1750";
+
+static i2c_master_bus_handle_t i2c_bus = NULL;
+static i2c_master_dev_handle_t i2c_dev = NULL;
+static bh1750_t sensor;
+static uint32_t sample_period_ms = BH1750_SAMPLE_PERIOD_MS;
+
+static portMUX_TYPE cache_lock = portMUX_INITIALIZER_UNLOCKED;
+static bh1750_sample_t cache;
+static bool cache_valid = false;
+static bh1750_stats_t stats;
+static TaskHandle_t sample_notify = NULL;
+
+static const bh1750_config_t default_config = {
+    .one_time = true,
+    .auto_range = true,
+    .res = BH1750_RES_HIGH,
+    .mtreg = BH1750_MTREG_DEFAULT,
+};
+
+static int bus_write(void *ctx, const uint8_t *data, size_t len)
 {
-    i2c_port_t bus;
-    uint16_t dev_addr;
-} bh1750_dev_t;
-
-static void i2c_bus_init(void);
-
-static esp_err_t bh1750_write_byte(const bh1750_dev_t *const sens, const uint8_t byte)
-{
-    esp_err_t ret;
-
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    ret = i2c_master_start(cmd);
-    assert(ESP_OK == ret);
-    ret = i2c_master_write_byte(cmd, sens->dev_addr | I2C_MASTER_WRITE, true);
-    assert(ESP_OK == ret);
-    ret = i2c_master_write_byte(cmd, byte, true);
-    assert(ESP_OK == ret);
-    ret = i2c_master_stop(cmd);
-    assert(ESP_OK == ret);
-    ret = i2c_master_cmd_begin(sens->bus, cmd, 1000 / portTICK_PERIOD_MS);
-    i2c_cmd_link_delete(cmd);
-
-    return ret;
+    return i2c_master_transmit((i2c_master_dev_handle_t)ctx, data, len, BH1750_I2C_TIMEOUT_MS);
 }
 
-bh1750_handle_t bh1750_create(i2c_port_t port, const uint16_t dev_addr)
+static int bus_read(void *ctx, uint8_t *data, size_t len)
 {
-    bh1750_dev_t *sensor = (bh1750_dev_t *)calloc(1, sizeof(bh1750_dev_t));
-    sensor->bus = port;
-    sensor->dev_addr = dev_addr << 1;
-    return (bh1750_handle_t)sensor;
+    return i2c_master_receive((i2c_master_dev_handle_t)ctx, data, len, BH1750_I2C_TIMEOUT_MS);
 }
 
-esp_err_t bh1750_delete(bh1750_handle_t sensor)
+/**
+ * @brief start -> wait the conversion time (task sleeps) -> fetch
+ */
+static esp_err_t bh1750_measure(bh1750_reading_t *reading)
 {
-    bh1750_dev_t *sens = (bh1750_dev_t *)sensor;
-    free(sens);
+    uint32_t wait_ms;
+    stats.reads++;
+    esp_err_t err = bh1750_start(&sensor, &wait_ms);
+    if (err == ESP_OK)
+    {
+        vTaskDelay(pdMS_TO_TICKS(wait_ms) + 1);
+        err = bh1750_fetch(&sensor, reading);
+    }
+    if (err != ESP_OK)
+    {
+        stats.i2c_errors++;
+        return err;
+    }
+    if (sensor.res != reading->res || sensor.mtreg != reading->mtreg)
+    {
+        stats.range_changes++;
+    }
     return ESP_OK;
 }
 
-esp_err_t bh1750_power_down(bh1750_handle_t sensor)
+static void bh1750_sampler_task(void *pvParameter)
 {
-    bh1750_dev_t *sens = (bh1750_dev_t *)sensor;
-    return bh1750_write_byte(sens, BH1750_POWER_DOWN);
-}
+    uint32_t consecutive_errors = 0;
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1)
+    {
+        bh1750_reading_t reading;
+        esp_err_t err = bh1750_measure(&reading);
 
-esp_err_t bh1750_power_on(bh1750_handle_t sensor)
-{
-    bh1750_dev_t *sens = (bh1750_dev_t *)sensor;
-    return bh1750_write_byte(sens, BH1750_POWER_ON);
-}
+        // Clipped: the range is already wider, measure again instead of caching a lower bound
+        for (int i = 0; i < BH1750_SATURATED_RETRIES && err == ESP_OK && reading.saturated &&
+                        (sensor.res != reading.res || sensor.mtreg != reading.mtreg);
+             i++)
+        {
+            err = bh1750_measure(&reading);
+        }
 
-esp_err_t bh1750_set_measure_time(bh1750_handle_t sensor, const uint8_t measure_time)
-{
-    bh1750_dev_t *sens = (bh1750_dev_t *)sensor;
-    uint32_t i = 0;
-    uint8_t buf[2] = {0x40, 0x60}; // constant part of the the MTreg
-    buf[0] |= measure_time >> 5;
-    buf[1] |= measure_time & 0x1F;
-    for (i = 0; i < 2; i++)
-    {
-        esp_err_t ret = bh1750_write_byte(sens, buf[i]);
-        if (ESP_OK != ret)
+        if (err == ESP_OK)
         {
-            return ret;
+            consecutive_errors = 0;
+            stats.ok++;
+            if (reading.saturated)
+            {
+                stats.saturated++;
+            }
+            taskENTER_CRITICAL(&cache_lock);
+            cache.lux = reading.lux;
+            cache.res = reading.res;
+            cache.mtreg = reading.mtreg;
+            cache.saturated = reading.saturated;
+            cache.timestamp = xTaskGetTickCount();
+            cache_valid = true;
+            taskEXIT_CRITICAL(&cache_lock);
+            if (sample_notify != NULL)
+            {
+                xTaskNotifyGive(sample_notify);
+            }
+            ESP_LOGD(TAG, "Lux = %.2f (res %d, MTreg %u, raw %u)", reading.lux, reading.res, reading.mtreg, reading.raw);
+            xTaskDelayUntil(&last_wake, pdMS_TO_TICKS(sample_period_ms));
+            continue;
         }
-    }
-    return ESP_OK;
-}
 
-esp_err_t bh1750_set_measure_mode(bh1750_handle_t sensor, const bh1750_measure_mode_t cmd_measure)
-{
-    bh1750_dev_t *sens = (bh1750_dev_t *)sensor;
-    return bh1750_write_byte(sens, (uint8_t)cmd_measure);
+        // Recover: resync the sensor next time, reset the bus on repeated errors, back off
+        consecutive_errors++;
+        bh1750_resync(&sensor);
+        if (consecutive_errors % BH1750_BUS_RESET_AFTER == 0)
+        {
+            stats.bus_resets++;
+            esp_err_t rst = i2c_master_bus_reset(i2c_bus);
+            ESP_LOGW(TAG, "Bus reset after %lu errors: %s", (unsigned long)consecutive_errors, esp_err_to_name(rst));
+        }
+        uint32_t shift = consecutive_errors < 6 ? consecutive_errors : 6;
+        uint32_t backoff_ms = sample_period_ms << shift;
+        if (backoff_ms > BH1750_BACKOFF_MAX_MS)
+        {
+            backoff_ms = BH1750_BACKOFF_MAX_MS;
+        }
+        ESP_LOGE(TAG, "I2C error %s, retry in %lu ms", esp_err_to_name(err), (unsigned long)backoff_ms);
+        vTaskDelay(pdMS_TO_TICKS(backoff_ms));
+        last_wake = xTaskGetTickCount();
+    }
 }
 
-esp_err_t bh1750_get_data(bh1750_handle_t sensor, float *const data)
+esp_err_t bh1750_sampler_start(const bh1750_config_t *cfg, uint32_t period_ms)
 {
-    esp_err_t ret;
-    uint8_t bh1750_data_h, bh1750_data_l;
-    bh1750_dev_t *sens = (bh1750_dev_t *)sensor;
-
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    ret = i2c_master_start(cmd);
-    assert(ESP_OK == ret);
-    ret = i2c_master_write_byte(cmd, sens->dev_addr | I2C_MASTER_READ, true);
-    assert(ESP_OK == ret);
-    ret = i2c_master_read_byte(cmd, &bh1750_data_h, I2C_MASTER_ACK);
-    assert(ESP_OK == ret);
-    ret = i2c_master_read_byte(cmd, &bh1750_data_l, I2C_MASTER_NACK);
-    assert(ESP_OK == ret);
-    ret = i2c_master_stop(cmd);
-    assert(ESP_OK == ret);
-    ret = i2c_master_cmd_begin(sens->bus, cmd, 1000 / portTICK_PERIOD_MS);
-    i2c_cmd_link_delete(cmd);
-    if (ESP_OK != ret)
+    if (i2c_bus != NULL)
     {
-        return ret;
+        return ESP_ERR_INVALID_STATE;
     }
-    *data = ((bh1750_data_h << 8 | bh1750_data_l) / BH_1750_MEASUREMENT_ACCURACY);
-    return ESP_OK;
-}
 
-/**
- * @brief Hàm khởi tạo I2C master
- */
-static void i2c_bus_init(void)
-{
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
-        .clk_flags = I2C_SCLK_SRC_FLAG_FOR_NOMAL,
+    i2c_master_bus_config_t bus_config = {
+        .i2c_port = I2C_NUM_0,
+        .sda_io_num = BH1750_I2C_SDA_IO,
+        .scl_io_num = BH1750_I2C_SCL_IO,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = true,
     };
+    esp_err_t err = i2c_new_master_bus(&bus_config, &i2c_bus);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "I2C bus init failed: %s", esp_err_to_name(err));
+        i2c_bus = NULL;
+        return err;
+    }
 
-    ESP_ERROR_CHECK(i2c_param_config(I2C_MASTER_NUM, &conf));
-    ESP_ERROR_CHECK(i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0));
-}
-
-/**
- * @brief Khởi tạo cảm biến BH1750
- */
-void Bh1750_Init(void)
-{
-    i2c_bus_init(); // Khởi tạo bus I2C
-    bh1750 = bh1750_create(I2C_MASTER_NUM, BH1750_I2C_ADDRESS_DEFAULT);
-    if (bh1750 == NULL)
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = BH1750_I2C_ADDRESS_DEFAULT,
+        .scl_speed_hz = BH1750_I2C_FREQ_HZ,
+    };
+    err = i2c_master_bus_add_device(i2c_bus, &dev_config, &i2c_dev);
+    if (err != ESP_OK)
     {
-        ESP_LOGE(TAG_BH1750, "Không thể tạo BH1750");
-        return;
+        ESP_LOGE(TAG, "I2C device add failed: %s", esp_err_to_name(err));
+        i2c_del_master_bus(i2c_bus);
+        i2c_bus = NULL;
+        return err;
     }
-    ESP_ERROR_CHECK(bh1750_power_on(bh1750));
-    ESP_LOGI(TAG_BH1750, "BH1750 đã được khởi tạo thành công");
 
-    if (bh1750 == NULL)
+    bh1750_bus_t bus = {
+        .write = bus_write,
+        .read = bus_read,
+        .ctx = i2c_dev,
+    };
+    bh1750_core_init(&sensor, &bus, cfg ? cfg : &default_config);
+    if (period_ms != 0)
     {
-        ESP_LOGE(TAG_BH1750, "Không thể tiếp tục, BH1750 chưa được khởi tạo");
-        return;
+        sample_period_ms = period_ms;
     }
 
-    bh1750_measure_mode_t measure_mode = BH1750_CONTINUE_4LX_RES; // Chế độ đo liên tục
-    ESP_ERROR_CHECK(bh1750_set_measure_mode(bh1750, measure_mode));
-    ESP_LOGI(TAG_BH1750, "BH1750 đang hoạt động ở chế độ đo liên tục");
+    if (xTaskCreate(bh1750_sampler_task, "bh1750_task", BH1750_TASK_STACK, NULL, BH1750_TASK_PRIO, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create the sampling task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Sampling every %lu ms (%s mode, auto-range %s)", (unsigned long)sample_period_ms,
+             sensor.cfg.one_time ? "one-time" : "continuous", sensor.cfg.auto_range ? "on" : "off");
+    return ESP_OK;
 }
 
-float Bh1750_Read()
+bool bh1750_get_sample(bh1750_sample_t *out)
 {
-    float bh1750_data = 0;
-    esp_err_t ret = bh1750_get_data(bh1750, &bh1750_data);
-    if (ret != ESP_OK)
+    taskENTER_CRITICAL(&cache_lock);
+    bool valid = cache_valid;
+    *out = cache;
+    taskEXIT_CRITICAL(&cache_lock);
+
+    if (valid)
     {
-        ESP_LOGE(TAG_BH1750, "Không thể đọc dữ liệu từ BH1750");
-        return -1;
+        out->age_ms = (uint32_t)pdTICKS_TO_MS(xTaskGetTickCount() - out->timestamp);
     }
-    return bh1750_data;
-}
\ No newline at end of file
+    return valid;
+}
+
+void bh1750_get_stats(bh1750_stats_t *out)
+{
+    *out = stats;
+}
+
+void bh1750_set_sample_notify(TaskHandle_t task)
+{
+    sample_notify = task;
+}
@@ -0,0 +1,185 @@
+#include "bh1750_core.h"
+
+#define BH1750_POWER_DOWN 0x00
+#define BH1750_POWER_ON 0x01
+#define BH1750_MTREG_HIGH 0x40 // | MTreg[7:5]
+#define BH1750_MTREG_LOW 0x60  // | MTreg[4:0]
+
+#define BH1750_MEASUREMENT_ACCURACY 1.2f // typical count per lx at MTreg 69 (datasheet Rev. D p.2)
+
+typedef struct
+{
+    bh1750_res_t res;
+    uint8_t mtreg;
+} bh1750_range_t;
+
+static const bh1750_range_t ladder[] = {
+    {BH1750_RES_LOW, BH1750_MTREG_MIN},
+    {BH1750_RES_HIGH, BH1750_MTREG_DEFAULT},
+    {BH1750_RES_HIGH2, BH1750_MTREG_DEFAULT},
+    {BH1750_RES_HIGH2, BH1750_MTREG_MAX},
+};
+#define LADDER_LEN (sizeof(ladder) / sizeof(ladder[0]))
+
+// Commands per resolution, max conversion time and step at MTreg 69
+static const uint8_t continuous_cmd[] = {[BH1750_RES_LOW] = 0x13, [BH1750_RES_HIGH] = 0x10, [BH1750_RES_HIGH2] = 0x11};
+static const uint8_t one_time_cmd[] = {[BH1750_RES_LOW] = 0x23, [BH1750_RES_HIGH] = 0x20, [BH1750_RES_HIGH2] = 0x21};
+static const uint16_t max_time_ms[] = {[BH1750_RES_LOW] = 24, [BH1750_RES_HIGH] = 180, [BH1750_RES_HIGH2] = 180};
+static const float step_lx[] = {[BH1750_RES_LOW] = 4.0f, [BH1750_RES_HIGH] = 1.0f, [BH1750_RES_HIGH2] = 0.5f};
+
+static uint8_t clamp_mtreg(uint8_t mtreg)
+{
+    if (mtreg < BH1750_MTREG_MIN)
+    {
+        return BH1750_MTREG_MIN;
+    }
+    return mtreg > BH1750_MTREG_MAX ? BH1750_MTREG_MAX : mtreg;
+}
+
+static int write_cmd(bh1750_t *dev, uint8_t cmd)
+{
+    return dev->bus.write(dev->bus.ctx, &cmd, 1);
+}
+
+void bh1750_core_init(bh1750_t *dev, const bh1750_bus_t *bus, const bh1750_config_t *cfg)
+{
+    dev->bus = *bus;
+    dev->cfg = *cfg;
+    dev->cfg.mtreg = clamp_mtreg(cfg->mtreg);
+    dev->res = dev->cfg.res;
+    dev->mtreg = dev->cfg.mtreg;
+    dev->synced = false;
+    dev->sensor_mtreg = 0;
+    dev->sensor_res = dev->res;
+}
+
+void bh1750_resync(bh1750_t *dev)
+{
+    dev->synced = false;
+}
+
+uint32_t bh1750_measure_time_ms(bh1750_res_t res, uint8_t mtreg)
+{
+    return ((uint32_t)max_time_ms[res] * mtreg + BH1750_MTREG_DEFAULT - 1) / BH1750_MTREG_DEFAULT;
+}
+
+float bh1750_raw_to_lux(uint16_t raw, bh1750_res_t res, uint8_t mtreg)
+{
+    float lux = raw / BH1750_MEASUREMENT_ACCURACY * BH1750_MTREG_DEFAULT / mtreg;
+    return res == BH1750_RES_HIGH2 ? lux / 2 : lux;
+}
+
+float bh1750_full_scale_lux(bh1750_res_t res, uint8_t mtreg)
+{
+    return bh1750_raw_to_lux(0xFFFF, res, mtreg);
+}
+
+static float range_step(bh1750_res_t res, uint8_t mtreg)
+{
+    return step_lx[res] * BH1750_MTREG_DEFAULT / mtreg;
+}
+
+bool bh1750_next_range(uint16_t raw, bh1750_res_t res, uint8_t mtreg, bh1750_res_t *next_res, uint8_t *next_mtreg)
+{
+    float lux = bh1750_raw_to_lux(raw, res, mtreg);
+    float full = bh1750_full_scale_lux(res, mtreg);
+
+    // First ladder range good enough for this reading, the most sensitive one catches the dark end
+    const bh1750_range_t *target = NULL;
+    for (size_t i = 0; i < LADDER_LEN && target == NULL; i++)
+    {
+        bool last = i == LADDER_LEN - 1;
+        bool fits = lux * 100 <= bh1750_full_scale_lux(ladder[i].res, ladder[i].mtreg) * BH1750_RANGE_ENTER_FULL_PERCENT;
+        bool fine = range_step(ladder[i].res, ladder[i].mtreg) * 1000 <= lux * BH1750_RANGE_ENTER_STEP_PERMILLE;
+        if (fits && (fine || last))
+        {
+            target = &ladder[i];
+        }
+    }
+    if (target == NULL)
+    {
+        target = &ladder[0]; // brighter than the widest range can hold
+    }
+
+    *next_res = res;
+    *next_mtreg = mtreg;
+    if (target->res == res && target->mtreg == mtreg)
+    {
+        return false;
+    }
+
+    // Faster / wider range: always. More sensitive: only once the current one stops holding.
+    bool holds = (uint32_t)raw * 100 < 0xFFFFu * BH1750_RANGE_HOLD_FULL_PERCENT &&
+                 range_step(res, mtreg) * 1000 <= lux * BH1750_RANGE_HOLD_STEP_PERMILLE;
+    if (bh1750_full_scale_lux(target->res, target->mtreg) > full || !holds)
+    {
+        *next_res = target->res;
+        *next_mtreg = target->mtreg;
+        return true;
+    }
+    return false;
+}
+
+int bh1750_start(bh1750_t *dev, uint32_t *wait_ms)
+{
+    int err = 0;
+    bool setup = !dev->synced || dev->sensor_mtreg != dev->mtreg || dev->sensor_res != dev->res;
+
+    // One-time mode: the sensor is powered down after every conversion, one command per sample
+    if (dev->cfg.one_time || setup)
+    {
+        err = write_cmd(dev, BH1750_POWER_ON);
+        if (err == 0 && (!dev->synced || dev->sensor_mtreg != dev->mtreg))
+        {
+            err = write_cmd(dev, (uint8_t)(BH1750_MTREG_HIGH | (dev->mtreg >> 5)));
+            if (err == 0)
+            {
+                err = write_cmd(dev, (uint8_t)(BH1750_MTREG_LOW | (dev->mtreg & 0x1F)));
+            }
+        }
+        if (err == 0)
+        {
+            err = write_cmd(dev, dev->cfg.one_time ? one_time_cmd[dev->res] : continuous_cmd[dev->res]);
+        }
+        if (err != 0)
+        {
+            dev->synced = false;
+            return err;
+        }
+        dev->synced = true;
+        dev->sensor_mtreg = dev->mtreg;
+        dev->sensor_res = dev->res;
+    }
+
+    *wait_ms = bh1750_measure_time_ms(dev->res, dev->mtreg);
+    return 0;
+}
+
+int bh1750_fetch(bh1750_t *dev, bh1750_reading_t *out)
+{
+    uint8_t data[2];
+    int err = dev->bus.read(dev->bus.ctx, data, sizeof(data));
+    if (err != 0)
+    {
+        dev->synced = false;
+        return err;
+    }
+
+    out->raw = (uint16_t)((data[0] << 8) | data[1]);
+    out->res = dev->res;
+    out->mtreg = dev->mtreg;
+    out->lux = bh1750_raw_to_lux(out->raw, dev->res, dev->mtreg);
+    out->saturated = out->raw == 0xFFFF;
+
+    if (dev->cfg.auto_range)
+    {
+        bh1750_next_range(out->raw, dev->res, dev->mtreg, &dev->res, &dev->mtreg);
+    }
+    return 0;
+}
+
+int bh1750_power_down(bh1750_t *dev)
+{
+    dev->synced = false;
+    return write_cmd(dev, BH1750_POWER_DOWN);
+}
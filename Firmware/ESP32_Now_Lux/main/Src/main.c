@@ -2,23 +2,32 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <string.h>
+#include <math.h>
 
 #include "nvs_flash.h"
 #include "esp_wifi.h"
+#include "esp_pm.h"
 #include "driver/gpio.h"
 
 #include "api.h"
 #include "my_wifi.h"
 #include "Json_message.h"
 #include "bh1750.h"
+#include "push_policy.h"
+#include "signal_cond.h"
+#include "duty_cycle.h"
 #include "esp_now.h"
 #include "cJSON.h"
 
 // --- Configuration ---
 #define SLAVE_NAME "LUX_Sensor_1"
 #define LED_PIN (GPIO_NUM_2)
+#define LUX_SAMPLE_MAX_AGE_MS (3 * BH1750_SAMPLE_PERIOD_MS) // older cached samples are not reported
 #define MASTER_CONNECTION_TIMEOUT_MS 5000 // 5 seconds
 #define ESP_NOW_WIFI_CHANNEL 1            // Define a fixed channel for ESP-NOW
+#define PUSH_ENABLE 1                     // unsolicited response_data on change (report-by-exception)
+#define DUTY_ENABLE 1                     // light sleep between the master's polls while paired
+#define DUTY_MIN_CPU_FREQ_MHZ 40          // DFS floor (XTAL) when awake but idle
 
 // --- Global Variables ---
 static const char *TAG = "SLAVE";
@@ -28,12 +37,64 @@ static uint8_t s_master_mac[6];
 static bool s_is_master_paired = false;
 static volatile TickType_t s_last_msg_recv_time;
 
+// Push policy on the reported lux: 20 % or 10 lx, and the 50 lx level (a light switched on / off)
+static const push_policy_config_t s_push_config = {
+    .field = {
+        {.abs_delta = 10, .rel_delta_pm = 200, .threshold_en = true, .threshold = 50, .threshold_hyst = 10},
+    },
+    .field_count = 1,
+    .min_interval_ms = 500,
+    .heartbeat_ms = 60000,
+};
+static push_policy_t s_push;
+static portMUX_TYPE s_push_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Conditioning of the samples (every 1 s) before they are reported, output selects what the master gets:
+// COND_OUTPUT_RAW, COND_OUTPUT_FILTERED (low-pass) or COND_OUTPUT_SUMMARY (mean + min / max / sd per window).
+// Lamp flicker aliases into the 1 Hz samples as slow ripple: Butterworth low-pass at 0.1 Hz, settles in
+// ~5 samples so a light switched on / off is still pushed within seconds. Window stats for the log only.
+static const cond_config_t s_cond_config = {
+    .field = {
+        {.filter = COND_FILTER_LOWPASS, .cutoff = 0.1f, .q = 0.707f},
+    },
+    .field_count = 1,
+    .output = COND_OUTPUT_FILTERED,
+    .window = 60,
+};
+static signal_cond_t s_cond;
+static portMUX_TYPE s_cond_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Conditioned value ready to report, snapshot of s_cond
+typedef struct
+{
+    float value;
+    bool summary;       // stats valid
+    cond_stats_t stats;
+} cond_report_t;
+
+// Sleep schedule around the master's polls (ASK_DATA every 1 s, re-sent at +40 / +80 ms)
+static const duty_cycle_config_t s_duty_config = {
+    .guard_ms = 30,      // wake-up and radio start, FreeRTOS tick is 10 ms
+    .listen_ms = 120,    // covers the master's re-sends
+    .linger_ms = 20,
+    .min_sleep_ms = 100,
+    .resync_after = 3,
+};
+static duty_cycle_t s_duty;
+static portMUX_TYPE s_duty_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_duty_task = NULL;
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t s_awake_lock = NULL;
+#endif
+
 // --- Forward Declarations ---
 static void handle_data_request(const espnow_msg_t *msg);
 static void send_discovery_response(const uint8_t *mac_addr);
 static void espnow_process_task(void *pvParameter);
 static void connection_check_task(void *pvParameter);
 static void slave_discovery_broadcast_task(void *pvParameter);
+static void sensor_cond_task(void *pvParameter);
+static void duty_cycle_task(void *pvParameter);
 
 // --- Helper Functions ---
 
@@ -48,6 +109,31 @@ static void mac_to_string(const uint8_t *mac, char *str)
     sprintf(str, "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 }
 
+/**
+ * @brief Milliseconds since boot on the FreeRTOS tick, the clock of the push and sleep schedules.
+ */
+static uint32_t now_ms(void)
+{
+    return (uint32_t)pdTICKS_TO_MS(xTaskGetTickCount());
+}
+
+/**
+ * @brief Snapshot of the conditioned value for the selected output.
+ * @return false before the first conditioned sample
+ */
+static bool cond_snapshot(cond_report_t *out)
+{
+    taskENTER_CRITICAL(&s_cond_lock);
+    bool ok = signal_cond_output(&s_cond, &out->value);
+    out->summary = ok && s_cond.cfg.output == COND_OUTPUT_SUMMARY;
+    if (out->summary)
+    {
+        out->stats = *signal_cond_stats(&s_cond, 0);
+    }
+    taskEXIT_CRITICAL(&s_cond_lock);
+    return ok;
+}
+
 /**
  * @brief Creates and sends a standard discovery response to the given MAC address.
  */
@@ -59,19 +145,62 @@ static void send_discovery_response(const uint8_t *mac_addr)
     strncpy(resp.name, SLAVE_NAME, sizeof(resp.name) - 1);
     resp.name[sizeof(resp.name) - 1] = '\0'; // Ensure null termination
 
-    char *json_str = json_encode_slave_discovery_response(&resp);
-    if (json_str)
+    char json_str[JSON_MSG_MAX_LEN];
+    size_t json_len = json_encode_slave_discovery_response(&resp, json_str, sizeof(json_str));
+    if (json_len)
     {
         ESP_LOGI(TAG, "--> SENDING DISCOVERY RESPONSE to %02X:%02X:%02X:%02X:%02X:%02X",
                  mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
         ESP_LOGD(TAG, "Response JSON: %s", json_str);
-        espnow_api_send_to(mac_addr, (const uint8_t *)json_str, strlen(json_str));
-        free(json_str);
+        espnow_api_send_to(mac_addr, (const uint8_t *)json_str, json_len);
     }
 }
 
 /**
- * @brief Handles a data request from the master by reading the sensor and sending a response.
+ * @brief Sends the conditioned value as response_data to the master.
+ * @param push true for an unsolicited report (carries "PUSH":true)
+ * @return true if ESP-NOW accepted the frame
+ */
+static bool send_data_response(const uint8_t *dst_mac, const cond_report_t *report, bool push)
+{
+    json_slave_data_t resp;
+    resp.type = JSON_MSG_TYPE_RESPONSE_DATA;
+    mac_to_string(s_slave_mac, resp.id);
+    mac_to_string(dst_mac, resp.dst);
+    resp.data.lux = lroundf(report->value);
+    resp.push = push;
+
+    // Summary: data is the window mean, the spread goes along
+    resp.has_stats = report->summary;
+    if (report->summary)
+    {
+        resp.stats.n = report->stats.n;
+        resp.stats.min[0] = report->stats.min;
+        resp.stats.max[0] = report->stats.max;
+        resp.stats.sd[0] = cond_stats_stddev(&report->stats);
+    }
+
+    // Sleep statistics of the last completed cycle, for tuning the duty cycle against latency
+    taskENTER_CRITICAL(&s_duty_lock);
+    resp.has_duty = s_duty_task != NULL && s_duty.stats.cycles > 0;
+    resp.duty.awake_ms = s_duty.stats.last_awake_ms;
+    resp.duty.missed = s_duty.stats.missed;
+    resp.duty.duty_pm = duty_cycle_permille(&s_duty);
+    taskEXIT_CRITICAL(&s_duty_lock);
+
+    char json_str[JSON_MSG_MAX_LEN];
+    size_t json_len = json_encode_slave_data(&resp, json_str, sizeof(json_str));
+    if (json_len == 0)
+    {
+        return false;
+    }
+    ESP_LOGI(TAG, "--> SENDING DATA %s", push ? "PUSH" : "RESPONSE");
+    ESP_LOGD(TAG, "Response JSON: %s", json_str);
+    return espnow_api_send_to(dst_mac, (const uint8_t *)json_str, json_len) == ESP_OK;
+}
+
+/**
+ * @brief Handles a data request from the master with the latest cached sensor sample.
  */
 static void handle_data_request(const espnow_msg_t *msg)
 {
@@ -83,22 +212,243 @@ static void handle_data_request(const espnow_msg_t *msg)
         return;
     }
 
-    float lux = Bh1750_Read();
-    ESP_LOGI(TAG, "Master requested data. Lux = %.2f", lux);
+    // Answered from the sampler cache, the bus is never touched in the request path
+    bh1750_sample_t sample;
+    if (!bh1750_get_sample(&sample))
+    {
+        ESP_LOGW(TAG, "No BH1750 sample yet, data request ignored.");
+        return;
+    }
+    if (sample.age_ms > LUX_SAMPLE_MAX_AGE_MS)
+    {
+        ESP_LOGE(TAG, "BH1750 sample is %lu ms old, data request ignored.", (unsigned long)sample.age_ms);
+        return;
+    }
+    cond_report_t report;
+    if (!cond_snapshot(&report))
+    {
+        ESP_LOGW(TAG, "BH1750 sample not conditioned yet, data request ignored.");
+        return;
+    }
+    ESP_LOGI(TAG, "Master requested data. Lux = %.2f (%lu ms old), reporting %.2f", sample.lux,
+             (unsigned long)sample.age_ms, report.value);
+
+    if (send_data_response(msg->src_mac, &report, false))
+    {
+        // The master has this value now, the push policy measures changes from it
+        int32_t value = lroundf(report.value);
+        taskENTER_CRITICAL(&s_push_lock);
+        push_policy_reported(&s_push, &value, now_ms(), PUSH_NONE);
+        taskEXIT_CRITICAL(&s_push_lock);
+    }
+}
 
-    json_slave_data_t resp;
-    resp.type = JSON_MSG_TYPE_RESPONSE_DATA;
-    mac_to_string(s_slave_mac, resp.id);
-    mac_to_string(msg->src_mac, resp.dst); // Respond to the source of the request
-    resp.data.lux = (int)lux;
+#if PUSH_ENABLE
+/**
+ * @brief Push to the master without waiting for its poll when the policy sees a change of the
+ *        reported value (rate limited) or the heartbeat is due.
+ * @details Only while paired, the policy restarts on every pairing. In summary mode the reported
+ *          value only changes when a window completes, so only then.
+ */
+static void sensor_push(bool window_done)
+{
+    static bool was_paired = false;
+    bool paired = s_is_master_paired;
+    if (paired && !was_paired)
+    {
+        taskENTER_CRITICAL(&s_push_lock);
+        push_policy_init(&s_push, &s_push_config);
+        taskEXIT_CRITICAL(&s_push_lock);
+    }
+    was_paired = paired;
 
-    char *json_str = json_encode_slave_data(&resp);
-    if (json_str)
+    cond_report_t report;
+    if (!paired || (s_cond.cfg.output == COND_OUTPUT_SUMMARY && !window_done) || !cond_snapshot(&report))
     {
-        ESP_LOGI(TAG, "--> SENDING DATA RESPONSE");
-        ESP_LOGD(TAG, "Response JSON: %s", json_str);
-        espnow_api_send_to(msg->src_mac, (const uint8_t *)json_str, strlen(json_str));
-        free(json_str);
+        return;
+    }
+
+    int32_t value = lroundf(report.value);
+    uint32_t now = now_ms();
+    taskENTER_CRITICAL(&s_push_lock);
+    push_reason_t reason = push_policy_decide(&s_push, &value, now);
+    taskEXIT_CRITICAL(&s_push_lock);
+    if (reason == PUSH_NONE)
+    {
+        return;
+    }
+
+    uint8_t master_mac[6];
+    memcpy(master_mac, s_master_mac, 6);
+    if (send_data_response(master_mac, &report, true))
+    {
+        taskENTER_CRITICAL(&s_push_lock);
+        push_policy_reported(&s_push, &value, now, reason);
+        taskEXIT_CRITICAL(&s_push_lock);
+    }
+}
+#endif
+
+/**
+ * @brief Task conditioning every new sample (filter, window statistics), then pushing if enabled.
+ * @details Woken by the BH1750 sampler; runs paired or not so the filter and window stay warm.
+ * @param pvParameter
+ */
+static void sensor_cond_task(void *pvParameter)
+{
+    bh1750_set_sample_notify(xTaskGetCurrentTaskHandle());
+    ESP_LOGI(TAG, "Sensor conditioning task started.");
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        bh1750_sample_t sample;
+        if (!bh1750_get_sample(&sample))
+        {
+            continue;
+        }
+
+        taskENTER_CRITICAL(&s_cond_lock);
+        bool window_done = signal_cond_update(&s_cond, &sample.lux);
+        cond_stats_t lux = s_cond.last[0];
+        taskEXIT_CRITICAL(&s_cond_lock);
+        if (window_done)
+        {
+            ESP_LOGD(TAG, "Window of %u: lux %.1f..%.1f mean %.1f sd %.2f", lux.n, lux.min, lux.max, lux.mean,
+                     cond_stats_stddev(&lux));
+        }
+
+#if PUSH_ENABLE
+        sensor_push(window_done);
+#endif
+    }
+}
+
+/**
+ * @brief Radio on and no light sleep, or modem sleep and let the idle task light-sleep the chip.
+ */
+static void radio_set_awake(bool awake)
+{
+#if CONFIG_PM_ENABLE
+    if (awake)
+    {
+        esp_pm_lock_acquire(s_awake_lock);
+    }
+#endif
+    esp_wifi_set_ps(awake ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+#if CONFIG_PM_ENABLE
+    if (!awake)
+    {
+        esp_pm_lock_release(s_awake_lock);
+    }
+#endif
+}
+
+/**
+ * @brief A poll from the master arrived at rx_tick, move the sleep schedule to it.
+ */
+static void duty_cycle_on_poll(TickType_t rx_tick, uint32_t next_ms)
+{
+    if (s_duty_task == NULL)
+    {
+        return;
+    }
+    taskENTER_CRITICAL(&s_duty_lock);
+    duty_cycle_poll(&s_duty, (uint32_t)pdTICKS_TO_MS(rx_tick), next_ms);
+    taskEXIT_CRITICAL(&s_duty_lock);
+    xTaskNotifyGive(s_duty_task);
+}
+
+/**
+ * @brief Task sleeping the node between the master's polls.
+ * @details Awake: waits for the expected poll until its listen window ends (missed otherwise), stays a
+ *          little after answering, then puts the radio in modem sleep until guard_ms before the next
+ *          poll; with nothing else running the chip light-sleeps meanwhile. Unpaired or without a
+ *          schedule the node stays awake. Pushes still go out while asleep, the driver wakes the radio.
+ * @param pvParameter
+ */
+static void duty_cycle_task(void *pvParameter)
+{
+    uint32_t wake_ms = now_ms();
+    ESP_LOGI(TAG, "Duty cycle task started.");
+    while (1)
+    {
+        taskENTER_CRITICAL(&s_duty_lock);
+        uint32_t listen_ms = duty_cycle_listen_ms(&s_duty, now_ms());
+        taskEXIT_CRITICAL(&s_duty_lock);
+
+        TickType_t wait = listen_ms == DUTY_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(listen_ms);
+        if (ulTaskNotifyTake(pdTRUE, wait) != 0)
+        {
+            // Answered: room for a re-send of the poll and pending pushes before the radio goes off
+            vTaskDelay(pdMS_TO_TICKS(s_duty_config.linger_ms));
+        }
+        else
+        {
+            taskENTER_CRITICAL(&s_duty_lock);
+            duty_cycle_missed(&s_duty, now_ms());
+            uint32_t missed = s_duty.stats.missed;
+            bool synced = s_duty.synced;
+            taskEXIT_CRITICAL(&s_duty_lock);
+            ESP_LOGW(TAG, "Poll missed (%lu total)%s", (unsigned long)missed, synced ? "" : ", awake until the next one");
+        }
+
+        uint32_t sleep_start = now_ms();
+        taskENTER_CRITICAL(&s_duty_lock);
+        uint32_t sleep_ms = s_is_master_paired ? duty_cycle_sleep_ms(&s_duty, sleep_start) : 0;
+        taskEXIT_CRITICAL(&s_duty_lock);
+        if (sleep_ms == 0)
+        {
+            continue;
+        }
+
+        radio_set_awake(false);
+        vTaskDelay(pdMS_TO_TICKS(sleep_ms));
+        radio_set_awake(true);
+
+        uint32_t awake_ms = sleep_start - wake_ms;
+        wake_ms = now_ms();
+        taskENTER_CRITICAL(&s_duty_lock);
+        duty_cycle_account(&s_duty, awake_ms, wake_ms - sleep_start);
+        taskEXIT_CRITICAL(&s_duty_lock);
+        ESP_LOGD(TAG, "Cycle: awake %lu ms, slept %lu ms", (unsigned long)awake_ms, (unsigned long)(wake_ms - sleep_start));
+    }
+}
+
+/**
+ * @brief Enable automatic light sleep and start the duty cycle task, the node starts awake.
+ */
+static void duty_cycle_start(void)
+{
+#if CONFIG_PM_ENABLE
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = DUTY_MIN_CPU_FREQ_MHZ,
+        .light_sleep_enable = true,
+    };
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err == ESP_OK)
+    {
+        err = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "duty_awake", &s_awake_lock);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Power management setup failed: %s, duty cycle off", esp_err_to_name(err));
+        return;
+    }
+    esp_pm_lock_acquire(s_awake_lock);
+#else
+    ESP_LOGW(TAG, "CONFIG_PM_ENABLE is off, only the radio sleeps between polls");
+#endif
+    // No periodic connectionless wake-ups, the radio is on only while the duty task holds it awake
+    esp_now_set_wake_window(0);
+    esp_wifi_set_ps(WIFI_PS_NONE);
+
+    duty_cycle_init(&s_duty, &s_duty_config);
+    if (xTaskCreate(duty_cycle_task, "duty_cycle_task", 3072, NULL, 5, &s_duty_task) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create the duty cycle task");
+        s_duty_task = NULL;
     }
 }
 
@@ -122,15 +472,15 @@ static void espnow_process_task(void *pvParameter)
                      msg.src_mac[0], msg.src_mac[1], msg.src_mac[2], msg.src_mac[3], msg.src_mac[4], msg.src_mac[5],
                      (char *)msg.data);
 
-            json_master_msg_t *master_msg = json_decode_master_msg((const char *)msg.data);
-            if (!master_msg)
+            json_master_msg_t master_msg;
+            if (!json_decode_master_msg((const char *)msg.data, &master_msg))
             {
                 ESP_LOGW(TAG, "Failed to decode JSON message.");
                 continue;
             }
 
             // --- Main Logic ---
-            switch (master_msg->type)
+            switch (master_msg.type)
             {
             case JSON_MSG_TYPE_DISCOVERY:
                 if (!s_is_master_paired)
@@ -159,14 +509,16 @@ static void espnow_process_task(void *pvParameter)
                     espnow_api_del_peer(s_broadcast_mac);
                 }
                 handle_data_request(&msg);
+                if (memcmp(msg.src_mac, s_master_mac, 6) == 0)
+                {
+                    duty_cycle_on_poll(s_last_msg_recv_time, master_msg.next_ms);
+                }
                 break;
 
             default:
-                ESP_LOGW(TAG, "Received unknown message type: %d", master_msg->type);
+                ESP_LOGW(TAG, "Received unknown message type: %d", master_msg.type);
                 break;
             }
-
-            free(master_msg);
         }
         else
         {
@@ -199,6 +551,9 @@ static void connection_check_task(void *pvParameter)
 
                 // Un-pair
                 s_is_master_paired = false;
+                taskENTER_CRITICAL(&s_duty_lock);
+                duty_cycle_reset(&s_duty);
+                taskEXIT_CRITICAL(&s_duty_lock);
 
                 // Delete old master peer
                 espnow_api_del_peer(s_master_mac);
@@ -242,13 +597,13 @@ static void slave_discovery_broadcast_task(void *pvParameter)
             strncpy(resp.name, SLAVE_NAME, sizeof(resp.name) - 1);
             resp.name[sizeof(resp.name) - 1] = '\0';
 
-            char *json_str = json_encode_slave_discovery_response(&resp);
-            if (json_str)
+            char json_str[JSON_MSG_MAX_LEN];
+            size_t json_len = json_encode_slave_discovery_response(&resp, json_str, sizeof(json_str));
+            if (json_len)
             {
                 ESP_LOGI(TAG, "--> BROADCASTING DISCOVERY RESPONSE (unpaired)");
                 ESP_LOGD(TAG, "Response JSON: %s", json_str);
-                espnow_api_send_to(s_broadcast_mac, (const uint8_t *)json_str, strlen(json_str));
-                free(json_str);
+                espnow_api_send_to(s_broadcast_mac, (const uint8_t *)json_str, json_len);
             }
             else
             {
@@ -269,7 +624,11 @@ void app_main(void)
     }
     ESP_ERROR_CHECK(ret);
 
-    Bh1750_Init();
+    // BH1750 sampled in the background (one-time mode, auto-ranging), data requests read the cache
+    if (bh1750_sampler_start(NULL, BH1750_SAMPLE_PERIOD_MS) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start BH1750 sampling");
+    }
 
     gpio_config_t io_conf = {
         .pin_bit_mask = (1ULL << LED_PIN),
@@ -310,6 +669,19 @@ void app_main(void)
     xTaskCreate(espnow_process_task, "espnow_proc_task", 4096, NULL, 4, NULL);
     xTaskCreate(connection_check_task, "conn_check_task", 2048, NULL, 3, NULL);
     xTaskCreate(slave_discovery_broadcast_task, "slave_disc_bcast_task", 4096, NULL, 3, NULL);
+    if (!signal_cond_init(&s_cond, &s_cond_config))
+    {
+        ESP_LOGE(TAG, "Invalid conditioning config, reporting raw samples");
+        cond_config_t raw = {.field_count = 1, .output = COND_OUTPUT_RAW, .window = 1};
+        signal_cond_init(&s_cond, &raw);
+    }
+#if PUSH_ENABLE
+    push_policy_init(&s_push, &s_push_config);
+#endif
+    xTaskCreate(sensor_cond_task, "sensor_cond_task", 4096, NULL, 3, NULL);
+#if DUTY_ENABLE
+    duty_cycle_start();
+#endif
 
     ESP_LOGI(TAG, "Setup complete. app_main task will now be deleted.");
 
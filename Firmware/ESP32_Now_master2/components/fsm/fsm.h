@@ -18,7 +18,7 @@ extern "C"
 
 #define TRUE 1
 #define FALSE 0
-#define COUNTER_TIMEOUT 300
+#define COUNTER_TIMEOUT 300 // idle polls (one UART read timeout each) before a partial frame is dropped
 
 	typedef enum
 	{
@@ -37,9 +37,17 @@ extern "C"
 	extern int32_t timeout_wait;
 	extern int16_t length_message;
 	extern uint8_t fsm_message_buffer[FSM_MAX_FRAME_SIZE];
+	extern uint32_t fsm_integrity_error_count; // frames dropped on checksum/CRC mismatch
+	extern uint32_t fsm_frame_count;			 // frames accepted
+	extern uint32_t fsm_replay_overflow_count; // bytes lost because the resync replay queue was full
 
 	uint16_t Is_Message(uint16_t *lenght);
 	void fsm_get_message(uint8_t datain, uint8_t arr_message[]);
+	void fsm_release_frame(void);
+	uint8_t fsm_poll_timeout(void);
+	void fsm_set_framing(Framing_Mode mode);
+	uint16_t fsm_replay_pending(void);
+	void fsm_replay(uint8_t arr_message[]);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,109 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define JSON_READER_MAX_TOKENS 48 // tokens json_bind() keeps on the stack (10 bytes each)
+#define JSON_READER_MAX_DEPTH 8   // nested objects / arrays
+#define JSON_READER_MAX_FIELDS 32 // fields of one schema (found mask is 32 bits)
+
+/*
+ * Two layers, neither allocates:
+ *   json_tokenize() - strict RFC 8259 tokenizer (jsmn style) into a caller token array,
+ *                     input is (pointer, length) and does not have to be '\0' terminated
+ *   json_bind()     - walks the tokens once and copies the fields of a schema into C variables:
+ *     char type[16];
+ *     int32_t temp;
+ *     const json_field_t fields[] = {
+ *         {"TYPE", JSON_FIELD_STRING, true, type, sizeof(type)},
+ *         {"data.temp", JSON_FIELD_INT, false, &temp, 0},
+ *     };
+ *     json_read_error_t err;
+ *     uint32_t found;
+ *     if (!json_bind(js, len, fields, 2, &found, &err)) -> err.status / err.pos / err.field
+ */
+
+typedef enum
+{
+    JSON_TOK_OBJECT = 1,
+    JSON_TOK_ARRAY,
+    JSON_TOK_STRING,    // start / end exclude the quotes, escapes are left in place
+    JSON_TOK_PRIMITIVE, // number, true, false or null
+} json_tok_type_t;
+
+typedef struct
+{
+    uint8_t type;   // json_tok_type_t
+    uint16_t start; // offset of the first character
+    uint16_t end;   // offset one past the last character
+    uint16_t size;  // object: members (each is a key token then a value), array: elements
+    uint16_t next;  // index of the first token after this one and all its children
+} json_tok_t;
+
+typedef enum
+{
+    JSON_READ_OK = 0,
+    JSON_READ_ERR_SYNTAX,     // unexpected character at pos
+    JSON_READ_ERR_TRUNCATED,  // input ended inside a value
+    JSON_READ_ERR_TOKENS,     // more tokens than the array holds
+    JSON_READ_ERR_DEPTH,      // nested deeper than JSON_READER_MAX_DEPTH
+    JSON_READ_ERR_TOO_LONG,   // input longer than 65535 bytes
+    JSON_READ_ERR_MISSING,    // required field absent
+    JSON_READ_ERR_TYPE,       // required field has another JSON type
+    JSON_READ_ERR_OVERFLOW,   // string does not fit its buffer
+} json_read_status_t;
+
+typedef struct
+{
+    json_read_status_t status;
+    uint16_t pos;      // offset in the input where it went wrong
+    const char *field; // schema path, for MISSING / TYPE / OVERFLOW
+} json_read_error_t;
+
+typedef enum
+{
+    JSON_FIELD_STRING, // out: char[out_size], unescaped and '\0' terminated
+    JSON_FIELD_INT,    // out: int32_t, fractions truncated and out of range values saturated like cJSON valueint
+    JSON_FIELD_BOOL,   // out: bool
+} json_field_type_t;
+
+typedef struct
+{
+    const char *path;       // member name, "a.b" for member b of object a
+    json_field_type_t type;
+    bool required;          // missing or of another type -> error, optional ones are just skipped
+    void *out;
+    uint16_t out_size;      // JSON_FIELD_STRING only
+} json_field_t;
+
+/**
+ * @brief Tokenize a JSON document
+ * @param err Optional, set on failure
+ * @return number of tokens (toks[0] is the root value), -1 on error
+ */
+int json_tokenize(const char *js, size_t len, json_tok_t *toks, uint16_t max_toks, json_read_error_t *err);
+
+/**
+ * @brief Copy the schema fields of a JSON object into their variables in one pass
+ * @param found Optional, bit i set when fields[i] was present with the right type
+ * @param err Optional, set on failure
+ * @return true if the document parsed and every required field was bound
+ */
+bool json_bind(const char *js, size_t len, const json_field_t *fields, uint8_t count, uint32_t *found, json_read_error_t *err);
+
+/**
+ * @brief Copy a JSON_TOK_STRING token, unescaped
+ * @return false if it does not fit out_size (with the terminator) or holds \u0000
+ */
+bool json_tok_copy_string(const char *js, const json_tok_t *tok, char *out, uint16_t out_size);
+
+/**
+ * @brief Value of a numeric JSON_TOK_PRIMITIVE token, see JSON_FIELD_INT
+ */
+bool json_tok_to_int(const char *js, const json_tok_t *tok, int32_t *out);
+
+const char *json_read_status_str(json_read_status_t status);
+
+#endif // JSON_READER_H
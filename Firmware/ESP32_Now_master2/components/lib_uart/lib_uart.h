@@ -4,8 +4,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#if CONFIG_IDF_TARGET_LINUX
+#include "uart_port_linux.h" // pty backend, runs the link stack as a Linux process
+#else
 #include "driver/gpio.h"
 #include "driver/uart.h"
+#endif
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -14,7 +20,10 @@
 
 // ================= Configuration =================
 #define UART_PORT_NUM UART_NUM_1
-#define BUFFER_SIZE 256
+#define BUFFER_SIZE 1024     // driver RX/TX ring = 2x, absorbs bytes while a frame is held
+#define UART_FRAME_HOLD_MS 50 // max time RX waits for the application to release a frame slot
+#define UART_RX_IDLE_MS 10     // read timeout of the RX task, one tick of the FSM receive timeout
+#define UART_FRAME_SLOTS 3     // frame buffers: one being parsed, the rest queued or held by the application
 
 // =================================================
 
@@ -26,6 +35,8 @@ typedef struct
         void (*init)(uint32_t baud_rate, gpio_num_t tx_pin, gpio_num_t rx_pin);
         void (*deinit)(void);
         void (*flush)(void);
+        void (*set_baud)(uint32_t baud_rate);
+        uint32_t (*get_baud)(void);
     } basic;
 
     // Send operations
@@ -33,6 +44,7 @@ typedef struct
     {
         void (*byte)(uint8_t data);
         void (*bytes)(const uint8_t *data, size_t length);
+        void (*frame)(const uint8_t *frame, size_t length); // applies the current framing
     } send;
 
     // Receive operations
@@ -49,6 +61,13 @@ typedef struct
         uint8_t (*is_message)(void);
     } check;
 
+    // Zero-copy access to received frames
+    struct
+    {
+        bool (*acquire)(Frame_View *view);
+        void (*release)(Frame_View *view);
+    } frame;
+
 } uart_lib_t;
 
 extern const uart_lib_t uart;
@@ -57,10 +76,22 @@ extern const uart_lib_t uart;
 // Callback nhận từng byte (giống ISR trong STM8)
 void uart_set_rx_callback(void (*callback)(uint8_t data));
 
+// Chọn framing cho cả TX và FSM (FRAMING_LENGTH lúc khởi động, đổi qua link negotiation)
+// FSM được đổi trong RX task trước byte kế tiếp, gọi từ task khác được
+void uart_set_framing(Framing_Mode mode);
+Framing_Mode uart_get_framing(void);
+
+// Task được notify (xTaskNotifyGive) mỗi khi FSM có frame hoàn chỉnh
+void uart_set_frame_notify(TaskHandle_t task);
+
 // Hàm khởi tạo UART có gắn FSM
 void uart_init_with_fsm(uint32_t baud_rate, gpio_num_t tx_pin, gpio_num_t rx_pin);
 
-// Hàm decode message từ buffer FSM
+// Lấy frame cũ nhất (không copy), phải gọi release khi dùng xong
+bool uart_frame_acquire(Frame_View *view);
+void uart_frame_release(Frame_View *view);
+
+// Hàm decode message từ buffer FSM (copy, payload bị cắt theo sizeof(data)), nên dùng uart.frame.acquire
 void decode_message(Frame_Message *message);
 
 #endif // __LIB_UART__
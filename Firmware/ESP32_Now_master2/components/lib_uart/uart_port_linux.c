@@ -0,0 +1,427 @@
+#define _GNU_SOURCE
+#include "uart_port_linux.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "freertos/stream_buffer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *TAG = "UART_HOST";
+
+static int host_fd = -1;
+static int host_pty_slave = -1; // kept open so the pty stays raw until the peer opens it
+static StreamBufferHandle_t host_rx_buffer = NULL;
+static StreamBufferHandle_t host_tx_buffer = NULL;
+static QueueHandle_t host_event_queue = NULL;
+static TaskHandle_t host_rx_task_handle = NULL;
+static TaskHandle_t host_tx_task_handle = NULL;
+
+static uint32_t host_baud = 115200;
+static uint32_t host_byte_rate_override = 0;
+static uint64_t host_byte_ns = 0;                // wire time of one byte
+static volatile uint64_t host_tx_busy_until = 0; // ns timestamp when the last written byte leaves the "wire"
+static uint32_t host_ber_threshold = 0;          // P(bit flip) scaled to 2^32
+static uint32_t host_rng_state = 1;
+static uart_host_stats_t host_stats;
+
+// ======================= Helpers =======================
+static uint64_t host_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void host_sleep_ns(uint64_t ns)
+{
+    TickType_t ticks = (TickType_t)(ns / (1000000ull * portTICK_PERIOD_MS));
+    vTaskDelay(ticks ? ticks : 1);
+}
+
+static void host_update_byte_time(void)
+{
+    uint32_t rate = host_byte_rate_override ? host_byte_rate_override : host_baud / 10; // 8N1
+    host_byte_ns = 1000000000ull / (rate ? rate : 1);
+}
+
+static uint32_t host_rand(void)
+{
+    // xorshift32, deterministic for a given UART_HOST_SEED
+    uint32_t x = host_rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    host_rng_state = x;
+    return x;
+}
+
+static void host_inject_errors(uint8_t *data, int length)
+{
+    if (host_ber_threshold == 0)
+    {
+        return;
+    }
+    for (int i = 0; i < length; i++)
+    {
+        for (int bit = 0; bit < 8; bit++)
+        {
+            if (host_rand() < host_ber_threshold)
+            {
+                data[i] ^= (uint8_t)(1u << bit);
+                host_stats.bit_errors++;
+            }
+        }
+    }
+}
+
+static void host_write_all(const uint8_t *data, size_t size)
+{
+    size_t written = 0;
+
+    while (written < size)
+    {
+        ssize_t n = write(host_fd, data + written, size - written);
+        if (n > 0)
+        {
+            written += (size_t)n;
+        }
+        else if (n < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            ESP_LOGE(TAG, "write failed: %s", strerror(errno));
+            return;
+        }
+        else
+        {
+            vTaskDelay(1); // pty buffer full, the peer is not reading
+        }
+    }
+    host_stats.tx_bytes += written;
+}
+
+static void host_set_raw(int fd)
+{
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+}
+
+static int host_open_device(void)
+{
+    const char *path = getenv(UART_HOST_ENV_DEVICE);
+
+    if (path && path[0])
+    {
+        int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (fd < 0)
+        {
+            ESP_LOGE(TAG, "Failed to open %s: %s", path, strerror(errno));
+            return -1;
+        }
+        host_set_raw(fd);
+        ESP_LOGI(TAG, "Using %s", path);
+        return fd;
+    }
+
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to create pty: %s", strerror(errno));
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    // No echo / line editing on the slave side even before the peer opens it
+    host_pty_slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+    if (host_pty_slave >= 0)
+    {
+        host_set_raw(host_pty_slave);
+    }
+    ESP_LOGI(TAG, "Created pty, start the peer with %s=%s", UART_HOST_ENV_DEVICE, ptsname(fd));
+    return fd;
+}
+
+/**
+ * @brief Plays the role of the UART ISR: moves bytes from the fd into the RX ring and posts UART_DATA
+ * @details Polls with a 1 tick delay, blocking syscalls would stall the FreeRTOS POSIX scheduler.
+ */
+static void host_rx_task(void *pvParameters)
+{
+    (void)pvParameters;
+    uint8_t chunk[UART_HOST_RX_CHUNK];
+
+    while (1)
+    {
+        ssize_t n = read(host_fd, chunk, sizeof(chunk));
+        if (n <= 0)
+        {
+            vTaskDelay(1);
+            continue;
+        }
+
+        host_inject_errors(chunk, (int)n);
+        size_t stored = xStreamBufferSend(host_rx_buffer, chunk, (size_t)n, 0);
+        host_stats.rx_bytes += stored;
+        host_stats.rx_dropped += (size_t)n - stored;
+
+        uart_event_t event = {
+            .type = (stored < (size_t)n) ? UART_BUFFER_FULL : UART_DATA,
+            .size = stored,
+            .timeout_flag = false,
+        };
+        if (host_event_queue)
+        {
+            xQueueSend(host_event_queue, &event, 0);
+        }
+    }
+}
+
+/**
+ * @brief Plays the role of the TX FIFO: drains the TX ring to the fd at the configured byte rate
+ * @details Writes at most one tick worth of bytes at a time, so the peer sees them at wire speed.
+ */
+static void host_tx_task(void *pvParameters)
+{
+    (void)pvParameters;
+    uint8_t chunk[UART_HOST_TX_CHUNK];
+
+    while (1)
+    {
+        uint64_t tick_bytes = (1000000ull * portTICK_PERIOD_MS) / host_byte_ns;
+        size_t limit = (tick_bytes == 0) ? 1 : (tick_bytes < sizeof(chunk)) ? (size_t)tick_bytes : sizeof(chunk);
+
+        size_t n = xStreamBufferReceive(host_tx_buffer, chunk, limit, portMAX_DELAY);
+        if (n == 0)
+        {
+            continue;
+        }
+
+        uint64_t now = host_now_ns();
+        if (host_tx_busy_until > now)
+        {
+            host_sleep_ns(host_tx_busy_until - now);
+            now = host_now_ns();
+        }
+        uint64_t start = (host_tx_busy_until > now) ? host_tx_busy_until : now;
+        host_write_all(chunk, n);
+        host_tx_busy_until = start + (uint64_t)n * host_byte_ns;
+    }
+}
+
+// ======================= driver/uart.h subset =======================
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+    (void)uart_num;
+    host_baud = (uint32_t)uart_config->baud_rate;
+    host_update_byte_time();
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+    (void)uart_num;
+    (void)tx_io_num;
+    (void)rx_io_num;
+    (void)rts_io_num;
+    (void)cts_io_num;
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+    (void)uart_num;
+    (void)intr_alloc_flags;
+
+    const char *env = getenv(UART_HOST_ENV_BYTE_RATE);
+    host_byte_rate_override = env ? (uint32_t)strtoul(env, NULL, 10) : 0;
+    env = getenv(UART_HOST_ENV_BER);
+    double ber = env ? strtod(env, NULL) : 0.0;
+    host_ber_threshold = (ber <= 0.0) ? 0 : (ber >= 1.0) ? UINT32_MAX : (uint32_t)(ber * 4294967296.0);
+    env = getenv(UART_HOST_ENV_SEED);
+    host_rng_state = env ? (uint32_t)strtoul(env, NULL, 10) : (uint32_t)host_now_ns();
+    if (host_rng_state == 0)
+    {
+        host_rng_state = 1;
+    }
+
+    host_fd = host_open_device();
+    if (host_fd < 0)
+    {
+        return ESP_FAIL;
+    }
+
+    host_rx_buffer = xStreamBufferCreate((size_t)rx_buffer_size, 1);
+    host_tx_buffer = xStreamBufferCreate((size_t)(tx_buffer_size > 0 ? tx_buffer_size : UART_HOST_TX_CHUNK), 1);
+    if (uart_queue && queue_size > 0)
+    {
+        host_event_queue = xQueueCreate(queue_size, sizeof(uart_event_t));
+        *uart_queue = host_event_queue;
+    }
+    host_update_byte_time();
+    memset(&host_stats, 0, sizeof(host_stats));
+
+    xTaskCreate(host_rx_task, "uart_host_rx", 4096, NULL, 13, &host_rx_task_handle);
+    xTaskCreate(host_tx_task, "uart_host_tx", 4096, NULL, 13, &host_tx_task_handle);
+    ESP_LOGI(TAG, "Backend ready: %lu bytes/s, BER %g", (unsigned long)(1000000000ull / host_byte_ns), ber);
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num)
+{
+    (void)uart_num;
+    if (host_rx_task_handle)
+    {
+        vTaskDelete(host_rx_task_handle);
+        host_rx_task_handle = NULL;
+    }
+    if (host_tx_task_handle)
+    {
+        vTaskDelete(host_tx_task_handle);
+        host_tx_task_handle = NULL;
+    }
+    if (host_fd >= 0)
+    {
+        close(host_fd);
+        host_fd = -1;
+    }
+    if (host_pty_slave >= 0)
+    {
+        close(host_pty_slave);
+        host_pty_slave = -1;
+    }
+    if (host_rx_buffer)
+    {
+        vStreamBufferDelete(host_rx_buffer);
+        host_rx_buffer = NULL;
+    }
+    if (host_tx_buffer)
+    {
+        vStreamBufferDelete(host_tx_buffer);
+        host_tx_buffer = NULL;
+    }
+    if (host_event_queue)
+    {
+        vQueueDelete(host_event_queue);
+        host_event_queue = NULL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_set_baudrate(uart_port_t uart_num, uint32_t baudrate)
+{
+    (void)uart_num;
+    host_baud = baudrate;
+    host_update_byte_time();
+    return ESP_OK;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait)
+{
+    (void)uart_num;
+    TickType_t start = xTaskGetTickCount();
+
+    while ((host_tx_buffer && !xStreamBufferIsEmpty(host_tx_buffer)) || host_now_ns() < host_tx_busy_until)
+    {
+        if (xTaskGetTickCount() - start >= ticks_to_wait)
+        {
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(1);
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+    (void)uart_num;
+    if (host_fd >= 0)
+    {
+        uint8_t drop[UART_HOST_RX_CHUNK];
+        while (read(host_fd, drop, sizeof(drop)) > 0)
+        {
+        }
+    }
+    if (host_rx_buffer)
+    {
+        xStreamBufferReset(host_rx_buffer);
+    }
+    if (host_event_queue)
+    {
+        xQueueReset(host_event_queue);
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_flush(uart_port_t uart_num)
+{
+    return uart_flush_input(uart_num);
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+    (void)uart_num;
+    *size = host_rx_buffer ? xStreamBufferBytesAvailable(host_rx_buffer) : 0;
+    return ESP_OK;
+}
+
+/**
+ * @brief Copy into the TX ring like the driver, blocks only while the ring is full
+ */
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    (void)uart_num;
+    const uint8_t *data = (const uint8_t *)src;
+    size_t queued = 0;
+
+    if (!host_tx_buffer)
+    {
+        return -1;
+    }
+    while (queued < size)
+    {
+        queued += xStreamBufferSend(host_tx_buffer, data + queued, size - queued, portMAX_DELAY);
+    }
+    return (int)queued;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    (void)uart_num;
+    uint8_t *out = (uint8_t *)buf;
+    uint32_t got = 0;
+    TickType_t start = xTaskGetTickCount();
+
+    if (!host_rx_buffer)
+    {
+        return -1;
+    }
+
+    while (got < length)
+    {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        TickType_t left = (elapsed < ticks_to_wait) ? ticks_to_wait - elapsed : 0;
+        size_t n = xStreamBufferReceive(host_rx_buffer, out + got, length - got, left);
+        got += (uint32_t)n;
+        if (n == 0 && left == 0)
+        {
+            break;
+        }
+    }
+    return (int)got;
+}
+
+void uart_host_get_stats(uart_host_stats_t *out)
+{
+    if (out)
+    {
+        memcpy(out, &host_stats, sizeof(*out));
+    }
+}
@@ -2,8 +2,21 @@
 #define __MESSAGE__
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
 #include "lib_math.h"
 
+// Bit 7 of the type byte tells the receiver which integrity check trails the frame
+#define FRAME_TYPE_MASK 0x7F
+#define FRAME_FLAG_CRC16 0x80
+
+#define CRC16_INIT 0xFFFF
+
+// Slice-by-4 tables (1.5 KB more flash) for bulk CRC, set to 0 to use the single table
+#ifndef MESSAGE_CRC16_SLICE_BY_4
+#define MESSAGE_CRC16_SLICE_BY_4 1
+#endif
+
 typedef struct
 {
     uint8_t start_byte;        // 0xAA
@@ -14,13 +27,72 @@ typedef struct
     uint16_t check_sum;        // checksum (little-endian on wire)
 } Frame_Message;
 
+// Received frame borrowed from the UART driver's slots, no copy (see uart.frame.acquire/release)
+typedef struct
+{
+    uint8_t type;           // Frame type with the integrity flag masked off
+    uint16_t length;        // Total frame length
+    const uint8_t *payload; // Valid until the frame is released
+    uint16_t payload_len;
+    uint8_t slot;           // Owner slot, used by release
+} Frame_View;
+
 typedef enum
 {
     ASK_MESSAGE = 0x00,
     RESPONSE_MESSAGE = 0x01
 } Type_Message;
 
+// How frames are delimited on the wire
+typedef enum
+{
+    FRAMING_LENGTH = 0, // 0xAA 0x55 + length field (default at boot)
+    FRAMING_COBS = 1    // Same frame COBS-encoded, terminated by COBS_DELIMITER
+} Framing_Mode;
+
+#define COBS_DELIMITER 0x00
+
+typedef enum
+{
+    INTEGRITY_SUM16 = 0, // additive 16-bit sum (legacy)
+    INTEGRITY_CRC16 = 1  // CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+} Integrity_Mode;
+
+extern const uint16_t crc16_table[256];
+
 uint16_t create_message(Type_Message type_mess, uint16_t value, uint8_t *data_out);
 uint16_t caculate_checksum(uint8_t *data, uint16_t length_data);
 
+/**
+ * @brief CRC-16/CCITT over a buffer (slice-by-4 when enabled)
+ */
+uint16_t caculate_crc16(const uint8_t *data, uint16_t length_data);
+
+/**
+ * @brief Feed one byte into a running CRC-16/CCITT (used by the FSM while bytes arrive)
+ */
+static inline uint16_t crc16_update(uint16_t crc, uint8_t data)
+{
+    return (uint16_t)((crc << 8) ^ crc16_table[(uint8_t)((crc >> 8) ^ data)]);
+}
+
+/**
+ * @brief Select the integrity check used by frames built on this side of the link
+ */
+void message_set_integrity_mode(Integrity_Mode mode);
+Integrity_Mode message_get_integrity_mode(void);
+
+/**
+ * @brief Mark the type byte with the current integrity mode and append the 2-byte check
+ * @param data_out frame with header, length and payload already written
+ * @param len number of bytes written so far
+ * @return total frame length including the check
+ */
+uint16_t message_append_integrity(uint8_t *data_out, uint16_t len);
+
+/**
+ * @brief Verify the trailing check of a complete frame according to its type flag
+ */
+bool message_check_integrity(const uint8_t *frame, uint16_t frame_len);
+
 #endif
\ No newline at end of file
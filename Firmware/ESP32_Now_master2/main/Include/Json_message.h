@@ -4,9 +4,12 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <cJSON.h>
+#include "json_reader.h"
 
 #define MAC_ADDR_STR_LEN 18
 #define SLAVE_NAME_LEN 32
+#define JSON_TYPE_STR_LEN 24 // longest TYPE is "discovery_response"
+#define JSON_CMD_STR_LEN 24
 
 // Command types
 typedef enum
@@ -35,6 +38,7 @@ typedef struct
     json_msg_type_t type;
     json_cmd_type_t cmd; // Only for control
     bool has_cmd;        // true if cmd is valid
+    uint32_t next_ms;    // ask_data: ms until the next poll ("NEXT", sleeping nodes wake for it), 0 = omitted
 } json_master_msg_t;
 
 // Message structure for slave's discovery response
@@ -65,25 +69,39 @@ typedef struct
     bool is_dht11; // true if DHT11, false if lux
 } json_slave_msg_t;
 
+// Sleep statistics a node adds to its response_data ("DUTY")
+typedef struct
+{
+    uint32_t awake_ms; // awake time of the node's last sleep cycle
+    uint32_t missed;   // polls the node missed since boot
+    uint32_t duty_pm;  // awake share in permille
+} json_duty_report_t;
+
 // --- API ---
 
 // Get the type of the message from a JSON string
 json_msg_type_t json_decode_msg_type(const char *json_str);
 
+// True if a response_data was pushed by the node ("PUSH": true) instead of answering an ask_data
+bool json_decode_push_flag(const char *json_str);
+
+// Sleep statistics of a response_data, false if the node sent none
+bool json_decode_duty_report(const char *json_str, json_duty_report_t *report);
+
 // Encode master message to JSON string
 char *json_encode_master_msg(const json_master_msg_t *msg);
 
-// Decode master message from JSON string, return pointer to struct or NULL if error
-json_master_msg_t *json_decode_master_msg(const char *json_str);
+// Decode master message from JSON string into msg (no allocation), false if malformed
+bool json_decode_master_msg(const char *json_str, json_master_msg_t *msg);
 
-// Decode discovery response from JSON string
-json_discovery_response_t *json_decode_discovery_response(const char *json_str);
+// Decode discovery response from JSON string into resp (no allocation), false if malformed or another TYPE
+bool json_decode_discovery_response(const char *json_str, json_discovery_response_t *resp);
 
 // Encode slave message to JSON string (response)
 char *json_encode_slave_msg(const json_slave_msg_t *msg);
 
-// Decode slave message from JSON string, return pointer to struct or NULL if error
-json_slave_msg_t *json_decode_slave_msg(const char *json_str);
+// Decode slave message from JSON string into msg (no allocation), false if malformed
+bool json_decode_slave_msg(const char *json_str, json_slave_msg_t *msg);
 
 // Encode slave message data to JSON string for MQTT
 char *json_encode_slave_data_for_mqtt(const json_slave_msg_t *msg);
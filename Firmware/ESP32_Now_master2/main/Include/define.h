@@ -6,16 +6,21 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "Json_message.h"
+#include "message.h"
 
 // ----- define -----
 /*pin uart2 on esp32-wrom*/
 #define UART_TX_PIN 17
 #define UART_RX_PIN 16
 #define UART_BAUD_RATE 115200
+#define UART_INTEGRITY_MODE INTEGRITY_CRC16 // check used on frames we send (receiver follows the type flag)
 
 #define DISCOVERY_PERIOD_MS 5000     // send discovery every 5 seconds
 #define MQTT_PUBLISH_PERIOD_MS 10000 // send data to MQTT every 10 seconds
 #define ASK_DATA_PERIOD_MS 1000      // send request data every 1 second
+#define ASK_DATA_RETRIES 2           // re-sends per cycle to nodes that did not answer yet (late wake-up of sleeping nodes)
+#define ASK_DATA_RETRY_MS 40         // gap between the sends, all of them inside the 200 ms bridge window
+#define POLL_STATS_LOG_CYCLES 60     // per node poll statistics logged every this many cycles
 #define ESP_NOW_WIFI_CHANNEL 1       // Fixed channel for ESP-NOW (must match Slave)
 #define MAX_SLAVES 10
 
@@ -24,17 +29,30 @@ typedef struct
 {
     uint8_t mac[6];
     char name[SLAVE_NAME_LEN];
+    uint8_t node; // 1..MAX_SLAVES, kept while registered, carried in UART frames and gateway topics
 } discovered_slave_t;
 
+// Poll statistics per node, kept by data_request_task
+typedef struct
+{
+    uint32_t polls;     // cycles the node was asked in
+    uint32_t retried;   // cycles that needed a re-send
+    uint32_t missed;    // cycles without an answer after all re-sends
+    bool has_duty;      // node reports sleep statistics (DUTY), last ones below
+    json_duty_report_t duty;
+} poll_stats_t;
+
 typedef enum
 {
     UART_BRIDGE_EVT_JSON = 0,
     UART_BRIDGE_EVT_CYCLE = 1,
+    UART_BRIDGE_EVT_PUSH = 2, // unsolicited response_data from a registered node, forwarded at once
 } uart_bridge_evt_t;
 
 typedef struct
 {
     uart_bridge_evt_t evt;
+    uint8_t node; // Sender, 0 if not registered
     uint16_t len;
     char json[251]; // espnow_msg_t.data max 250 + null terminator
 } uart_json_msg_t;
@@ -0,0 +1,96 @@
+#ifndef __UART_ARQ_H__
+#define __UART_ARQ_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "message.h"
+
+// ============ CONFIG ============
+#define UART_ARQ_WINDOW 8           // Frames in flight, power of two <= 16 (SACK bitmap is 16 bits)
+#define UART_ARQ_MAX_PAYLOAD 96     // Inner payload per slot, larger frames go unacknowledged
+#define UART_ARQ_RTO_INIT_MS 200    // Retransmit timeout before the first RTT sample
+#define UART_ARQ_RTO_MIN_MS 30
+#define UART_ARQ_RTO_MAX_MS 2000
+#define UART_ARQ_MAX_RETRIES 5      // Retransmits before a frame is given up
+#define UART_ARQ_TICK_MS 10         // Retransmit timer resolution
+
+/*
+ * UART_MSG_RELIABLE payload: [epoch, seq, base, inner_type, inner payload...]
+ *   epoch : random per boot, receiver resynchronises when it changes
+ *   base  : oldest seq the sender still waits on, receiver skips what the sender gave up on
+ * UART_MSG_ACK payload:      [epoch, next_expected, sack_lo, sack_hi]
+ *   bit i of sack = seq next_expected + 1 + i already received
+ */
+
+// ============ STRUCTURES ============
+typedef struct
+{
+    uint32_t sent;            // Reliable frames handed to the link (first transmission)
+    uint32_t retransmits;
+    uint32_t acked;
+    uint32_t failed;          // Given up after UART_ARQ_MAX_RETRIES
+    uint32_t window_full;     // Sends that timed out waiting for a free slot
+    uint32_t rx_delivered;
+    uint32_t rx_duplicates;
+    uint32_t rx_out_of_order; // Buffered until the gap was filled
+    uint32_t rx_skipped;      // Seqs the sender gave up on
+    uint32_t rtt_last_ms;     // From frames acked on first transmission (Karn)
+    uint32_t rtt_min_ms;
+    uint32_t rtt_max_ms;
+    uint32_t srtt_ms;
+    uint32_t rto_ms;
+    uint8_t in_flight;
+} uart_arq_stats_t;
+
+typedef enum
+{
+    UART_ARQ_DELIVERED = 0, // Acknowledged by the peer
+    UART_ARQ_GIVEN_UP = 1,  // No ACK after UART_ARQ_MAX_RETRIES retransmits
+} uart_arq_result_t;
+
+// Called in order, once per reliable frame, from the UART RX dispatch task (view valid during the call)
+typedef void (*uart_arq_rx_handler_t)(const Frame_View *view);
+
+// Called once per frame sent with uart_arq_send_frame_notify(): from the task feeding the ACKs when delivered,
+// from the retransmit timer task when given up. Never with the window locked, but it must not block.
+typedef void (*uart_arq_done_t)(uart_arq_result_t result, uint32_t tag);
+
+// ============ API ============
+/**
+ * @brief Create the window state and the retransmit timer task
+ * @param handler Receives the inner frames of UART_MSG_RELIABLE in sequence order
+ */
+void uart_arq_init(uart_arq_rx_handler_t handler);
+
+/**
+ * @brief Send an already built frame (any type) with acknowledged delivery
+ * @details Blocks only while the window is full. Unacknowledged frames keep using uart_link_send()
+ *          directly, so bulk telemetry never waits behind retransmits.
+ * @param timeout_ms Max wait for a free window slot
+ * @return true if queued for delivery (not yet acknowledged), false if the frame is too long or the window
+ *         stayed full
+ */
+bool uart_arq_send_frame(const uint8_t *frame, uint16_t length, uint32_t timeout_ms);
+
+/**
+ * @brief uart_arq_send_frame() with the outcome reported later through done
+ * @details done is not called when this returns false, the caller handles that case itself.
+ * @param tag Passed back to done, e.g. what the frame was about
+ */
+bool uart_arq_send_frame_notify(const uint8_t *frame, uint16_t length, uint32_t timeout_ms, uart_arq_done_t done,
+                                uint32_t tag);
+
+/**
+ * @brief Feed a UART_MSG_RELIABLE payload (delivers and sends the ACK)
+ */
+void uart_arq_handle_data(const uint8_t *payload, uint16_t payload_len);
+
+/**
+ * @brief Feed a UART_MSG_ACK payload
+ */
+void uart_arq_handle_ack(const uint8_t *payload, uint16_t payload_len);
+
+void uart_arq_get_stats(uart_arq_stats_t *out);
+void uart_arq_log_stats(void);
+
+#endif // __UART_ARQ_H__
@@ -4,6 +4,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "cJSON.h"
+#include "json_writer.h"
+#include "json_reader.h"
+#include "message.h"
 
 // ============ ENUMS ============
 typedef enum
@@ -21,8 +24,11 @@ typedef enum
 
 typedef enum
 {
-    UART_MSG_DATA = 0x01,   // Bản tin dữ liệu cảm biến
-    UART_MSG_CONTROL = 0x02 // Bản tin điều khiển
+    UART_MSG_DATA = 0x01,    // Bản tin dữ liệu cảm biến
+    UART_MSG_CONTROL = 0x02, // Bản tin điều khiển
+    UART_MSG_LINK = 0x03,    // Link management (baud negotiation, heartbeat)
+    UART_MSG_RELIABLE = 0x04, // Acknowledged frame wrapping another type (see uart_arq.h)
+    UART_MSG_ACK = 0x05       // Cumulative + selective ACK for UART_MSG_RELIABLE
 } UART_Message_Type;
 
 // Cờ để quản lý dữ liệu cảm biến
@@ -41,14 +47,67 @@ typedef struct
     uint16_t lux;  // Ánh sáng (0-65535)
     uint8_t temp;  // Nhiệt độ (0-100)
     uint8_t humi;  // Độ ẩm (0-100)
+    uint8_t node;  // Node gửi dữ liệu (1..), 0 = tổng hợp, không gửi byte node
 } Sensor_Data;
 
 typedef struct
 {
     Plug_ID plug_id;
     Plug_Status status;
+    uint8_t node; // Node đích, 0 = master
 } Control_Data;
 
+// ============ FRAME VIEW ACCESSORS ============
+// X(name, msg_type, min_payload_len)
+#define UART_FRAME_TYPES(X)          \
+    X(data, UART_MSG_DATA, 5)        \
+    X(control, UART_MSG_CONTROL, 2)
+
+// X(name, field, kind, offset), kind U8 or U16BE (big-endian, like lux on the wire)
+#define UART_FRAME_FIELDS(X)         \
+    X(data, flags, U8, 0)            \
+    X(data, lux, U16BE, 1)           \
+    X(data, temp, U8, 3)             \
+    X(data, humi, U8, 4)             \
+    X(control, plug_id, U8, 0)       \
+    X(control, status, U8, 1)
+
+#define UART_FIELD_TYPE_U8 uint8_t
+#define UART_FIELD_TYPE_U16BE uint16_t
+#define UART_FIELD_READ_U8(p, off) ((p)[(off)])
+#define UART_FIELD_READ_U16BE(p, off) ((uint16_t)(((uint16_t)(p)[(off)] << 8) | (p)[(off) + 1]))
+
+// uart_view_is_<name>(view): type matches and the payload holds every field
+#define UART_VIEW_IS(name, msg_type, min_len)                             \
+    static inline bool uart_view_is_##name(const Frame_View *view)        \
+    {                                                                     \
+        return view->type == (msg_type) && view->payload_len >= (min_len); \
+    }
+UART_FRAME_TYPES(UART_VIEW_IS)
+#undef UART_VIEW_IS
+
+// uart_<name>_<field>(view): read a field, only after uart_view_is_<name>() returned true
+#define UART_VIEW_FIELD(name, field, kind, offset)                                    \
+    static inline UART_FIELD_TYPE_##kind uart_##name##_##field(const Frame_View *view) \
+    {                                                                                 \
+        return UART_FIELD_READ_##kind(view->payload, offset);                         \
+    }
+UART_FRAME_FIELDS(UART_VIEW_FIELD)
+#undef UART_VIEW_FIELD
+
+// X(name, field, offset): optional trailing U8, 0 when the peer is older and did not send it
+#define UART_FRAME_OPT_FIELDS(X)     \
+    X(data, node, 5)                 \
+    X(control, node, 2)
+
+#define UART_VIEW_OPT_FIELD(name, field, offset)                                  \
+    static inline uint8_t uart_##name##_##field(const Frame_View *view)           \
+    {                                                                             \
+        return view->payload_len > (offset) ? view->payload[(offset)] : 0;        \
+    }
+UART_FRAME_OPT_FIELDS(UART_VIEW_OPT_FIELD)
+#undef UART_VIEW_OPT_FIELD
+
 // ============ JSON TO UART ============
 /**
  * @brief Parse JSON và tạo bản tin UART data
@@ -67,22 +126,47 @@ uint16_t parse_json_to_uart_data(const char *json_str, uint8_t *data_out);
  */
 uint16_t create_uart_control_message(Plug_ID plug_id, Plug_Status status, uint8_t *data_out);
 
+/**
+ * @brief Tạo bản tin UART control tới một node
+ * @param node Node đích (1..), 0 = master (bản tin giống create_uart_control_message)
+ * @param plug_id ID công tắc (0-2)
+ * @param status Trạng thái (ON/OFF)
+ * @param data_out Buffer để lưu bản tin UART
+ * @return Độ dài bản tin UART
+ */
+uint16_t create_uart_control_message_to(uint8_t node, Plug_ID plug_id, Plug_Status status, uint8_t *data_out);
+
 // ============ UART TO JSON ============
+/**
+ * @brief Ghi object "data" của bản tin UART data (chỉ các giá trị có flag)
+ * @param w Writer đang ở vị trí của giá trị
+ * @param key Tên member, NULL nếu data là giá trị gốc
+ * @param view Frame đã nhận (uart.frame.acquire hoặc ARQ)
+ */
+void uart_data_write_json(json_writer_t *w, const char *key, const Frame_View *view);
+
+/**
+ * @brief Ghi object "data" từ Sensor_Data (chỉ các giá trị có flag), vd. sau khi lọc deadband
+ */
+void uart_sensor_write_json(json_writer_t *w, const char *key, const Sensor_Data *sensor_data);
+
 /**
  * @brief Decode bản tin UART data và tạo JSON telemetry
- * @param uart_data Dữ liệu UART đã nhận
- * @param length Độ dài dữ liệu
- * @return Chuỗi JSON (cần free sau khi dùng), NULL nếu lỗi
+ * @param view Frame đã nhận (uart.frame.acquire hoặc ARQ)
+ * @param json_out Buffer chứa chuỗi JSON (không cấp phát heap)
+ * @param out_size Kích thước json_out
+ * @return Độ dài chuỗi JSON, 0 nếu lỗi hoặc buffer không đủ
  */
-char *decode_uart_data_to_json(const uint8_t *uart_data, uint16_t length);
+uint16_t decode_uart_data_to_json(const Frame_View *view, char *json_out, uint16_t out_size);
 
 /**
  * @brief Decode bản tin UART control và tạo JSON control
- * @param uart_data Dữ liệu UART đã nhận
- * @param length Độ dài dữ liệu
- * @return Chuỗi JSON (cần free sau khi dùng), NULL nếu lỗi
+ * @param view Frame đã nhận (uart.frame.acquire hoặc ARQ)
+ * @param json_out Buffer chứa chuỗi JSON (không cấp phát heap)
+ * @param out_size Kích thước json_out
+ * @return Độ dài chuỗi JSON, 0 nếu lỗi hoặc buffer không đủ
  */
-char *decode_uart_control_to_json(const uint8_t *uart_data, uint16_t length);
+uint16_t decode_uart_control_to_json(const Frame_View *view, char *json_out, uint16_t out_size);
 
 // ============ HELPER FUNCTIONS ============
 /**
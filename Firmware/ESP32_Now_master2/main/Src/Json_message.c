@@ -2,6 +2,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "JSON";
 
 // --- Helper Macros ---
 #define JSON_SAFE_FREE(p) \
@@ -15,45 +18,89 @@
     } while (0)
 
 // --- Get Message Type ---
-json_msg_type_t json_decode_msg_type(const char *json_str)
+static json_msg_type_t json_type_from_string(const char *type_str)
 {
-    cJSON *root = cJSON_Parse(json_str);
-    if (!root)
-        return JSON_MSG_TYPE_UNKNOWN;
-
-    cJSON *type_item = cJSON_GetObjectItem(root, "TYPE");
-    if (!cJSON_IsString(type_item))
-    {
-        cJSON_Delete(root);
-        return JSON_MSG_TYPE_UNKNOWN;
-    }
-
-    char *type_str = type_item->valuestring;
-    json_msg_type_t type = JSON_MSG_TYPE_UNKNOWN;
-
     if (strcmp(type_str, "discovery") == 0)
     {
-        type = JSON_MSG_TYPE_DISCOVERY;
+        return JSON_MSG_TYPE_DISCOVERY;
     }
     else if (strcmp(type_str, "discovery_response") == 0)
     {
-        type = JSON_MSG_TYPE_DISCOVERY_RESPONSE;
+        return JSON_MSG_TYPE_DISCOVERY_RESPONSE;
     }
     else if (strcmp(type_str, "ask_data") == 0)
     {
-        type = JSON_MSG_TYPE_ASK_DATA;
+        return JSON_MSG_TYPE_ASK_DATA;
     }
     else if (strcmp(type_str, "control") == 0)
     {
-        type = JSON_MSG_TYPE_CONTROL;
+        return JSON_MSG_TYPE_CONTROL;
     }
     else if (strcmp(type_str, "response_data") == 0)
     {
-        type = JSON_MSG_TYPE_RESPONSE_DATA;
+        return JSON_MSG_TYPE_RESPONSE_DATA;
     }
+    return JSON_MSG_TYPE_UNKNOWN;
+}
 
-    cJSON_Delete(root);
-    return type;
+// Log why a message was rejected: status, offset and the schema field involved
+static void json_log_error(const char *what, const json_read_error_t *err)
+{
+    ESP_LOGW(TAG, "%s: %s at %u%s%s", what, json_read_status_str(err->status), err->pos,
+             err->field ? ", field " : "", err->field ? err->field : "");
+}
+
+json_msg_type_t json_decode_msg_type(const char *json_str)
+{
+    char type_str[JSON_TYPE_STR_LEN];
+    const json_field_t fields[] = {
+        {"TYPE", JSON_FIELD_STRING, true, type_str, sizeof(type_str)},
+    };
+    json_read_error_t err;
+
+    if (!json_str || !json_bind(json_str, strlen(json_str), fields, 1, NULL, &err))
+    {
+        return JSON_MSG_TYPE_UNKNOWN;
+    }
+    return json_type_from_string(type_str);
+}
+
+// --- Push flag of a response_data ---
+bool json_decode_push_flag(const char *json_str)
+{
+    bool push = false;
+    const json_field_t fields[] = {
+        {"PUSH", JSON_FIELD_BOOL, false, &push, 0},
+    };
+    json_read_error_t err;
+
+    if (!json_str || !json_bind(json_str, strlen(json_str), fields, 1, NULL, &err))
+    {
+        return false;
+    }
+    return push;
+}
+
+// --- Sleep statistics of a response_data ---
+bool json_decode_duty_report(const char *json_str, json_duty_report_t *report)
+{
+    int32_t awake = 0, missed = 0, duty = 0;
+    const json_field_t fields[] = {
+        {"DUTY.awake", JSON_FIELD_INT, false, &awake, 0},
+        {"DUTY.missed", JSON_FIELD_INT, false, &missed, 0},
+        {"DUTY.duty", JSON_FIELD_INT, false, &duty, 0},
+    };
+    uint32_t found;
+    json_read_error_t err;
+
+    if (!json_str || !json_bind(json_str, strlen(json_str), fields, 3, &found, &err) || found == 0)
+    {
+        return false;
+    }
+    report->awake_ms = awake > 0 ? (uint32_t)awake : 0;
+    report->missed = missed > 0 ? (uint32_t)missed : 0;
+    report->duty_pm = duty > 0 ? (uint32_t)duty : 0;
+    return true;
 }
 
 // --- Encode Master Message ---
@@ -92,6 +139,10 @@ char *json_encode_master_msg(const json_master_msg_t *msg)
     {
         cJSON_AddStringToObject(root, "DST", msg->dst);
     }
+    if (msg->type == JSON_MSG_TYPE_ASK_DATA && msg->next_ms != 0)
+    {
+        cJSON_AddNumberToObject(root, "NEXT", msg->next_ms);
+    }
 
     if (msg->type == JSON_MSG_TYPE_CONTROL && msg->has_cmd)
     {
@@ -117,99 +168,71 @@ char *json_encode_master_msg(const json_master_msg_t *msg)
 }
 
 // --- Decode Discovery Response ---
-json_discovery_response_t *json_decode_discovery_response(const char *json_str)
+bool json_decode_discovery_response(const char *json_str, json_discovery_response_t *resp)
 {
-    cJSON *root = cJSON_Parse(json_str);
-    if (!root)
-        return NULL;
-
-    cJSON *type = cJSON_GetObjectItem(root, "TYPE");
-    if (!cJSON_IsString(type) || strcmp(type->valuestring, "discovery_response") != 0)
-    {
-        cJSON_Delete(root);
-        return NULL;
-    }
-
-    cJSON *id = cJSON_GetObjectItem(root, "ID");
-    cJSON *name = cJSON_GetObjectItem(root, "NAME");
-
-    if (!cJSON_IsString(id) || !id->valuestring ||
-        !cJSON_IsString(name) || !name->valuestring)
-    {
-        cJSON_Delete(root);
-        return NULL;
-    }
-
-    json_discovery_response_t *resp = calloc(1, sizeof(json_discovery_response_t));
-    if (!resp)
+    char type_str[JSON_TYPE_STR_LEN];
+    const json_field_t fields[] = {
+        {"TYPE", JSON_FIELD_STRING, true, type_str, sizeof(type_str)},
+        {"ID", JSON_FIELD_STRING, true, resp->id, sizeof(resp->id)},
+        {"NAME", JSON_FIELD_STRING, true, resp->name, sizeof(resp->name)},
+    };
+    json_read_error_t err;
+
+    if (!json_str || !json_bind(json_str, strlen(json_str), fields, 3, NULL, &err))
     {
-        cJSON_Delete(root);
-        return NULL;
+        if (json_str)
+        {
+            json_log_error("Bad discovery response", &err);
+        }
+        return false;
     }
-
-    snprintf(resp->id, MAC_ADDR_STR_LEN, "%s", id->valuestring);
-    snprintf(resp->name, SLAVE_NAME_LEN, "%s", name->valuestring);
-
-    cJSON_Delete(root);
-    return resp;
+    return strcmp(type_str, "discovery_response") == 0;
 }
 
 // --- Decode Master Message ---
-json_master_msg_t *json_decode_master_msg(const char *json_str)
+bool json_decode_master_msg(const char *json_str, json_master_msg_t *msg)
 {
-    cJSON *root = cJSON_Parse(json_str);
-    if (!root)
-        return NULL;
-    cJSON *id = cJSON_GetObjectItem(root, "ID");
-    cJSON *dst = cJSON_GetObjectItem(root, "DST");
-    cJSON *type_item = cJSON_GetObjectItem(root, "TYPE");
-    if (!cJSON_IsString(id) || !cJSON_IsString(dst) || !cJSON_IsString(type_item))
+    char type_str[JSON_TYPE_STR_LEN];
+    char cmd_str[JSON_CMD_STR_LEN];
+    const json_field_t fields[] = {
+        {"ID", JSON_FIELD_STRING, true, msg->id, sizeof(msg->id)},
+        {"DST", JSON_FIELD_STRING, true, msg->dst, sizeof(msg->dst)},
+        {"TYPE", JSON_FIELD_STRING, true, type_str, sizeof(type_str)},
+        {"CMD.CMD", JSON_FIELD_STRING, false, cmd_str, sizeof(cmd_str)},
+    };
+    uint32_t found;
+    json_read_error_t err;
+
+    memset(msg, 0, sizeof(*msg));
+    if (!json_str || !json_bind(json_str, strlen(json_str), fields, 4, &found, &err))
     {
-        cJSON_Delete(root);
-        return NULL;
-    }
-    json_master_msg_t *msg = (json_master_msg_t *)calloc(1, sizeof(json_master_msg_t));
-    if (!msg)
-    {
-        cJSON_Delete(root);
-        return NULL;
+        if (json_str)
+        {
+            json_log_error("Bad master message", &err);
+        }
+        return false;
     }
-    strncpy(msg->id, id->valuestring, MAC_ADDR_STR_LEN - 1);
-    strncpy(msg->dst, dst->valuestring, MAC_ADDR_STR_LEN - 1);
-    msg->id[MAC_ADDR_STR_LEN - 1] = '\0';
-    msg->dst[MAC_ADDR_STR_LEN - 1] = '\0';
-
-    msg->type = json_decode_msg_type(json_str);
 
-    if (msg->type == JSON_MSG_TYPE_CONTROL)
+    msg->type = json_type_from_string(type_str);
+    if (msg->type == JSON_MSG_TYPE_CONTROL && (found & (1u << 3)))
     {
-        cJSON *cmd_obj = cJSON_GetObjectItem(root, "CMD");
-        if (cmd_obj && cJSON_IsObject(cmd_obj))
+        if (strcmp(cmd_str, "turn on led") == 0)
+        {
+            msg->cmd = JSON_CMD_TURN_ON_LED;
+            msg->has_cmd = true;
+        }
+        else if (strcmp(cmd_str, "turn off led") == 0)
         {
-            cJSON *cmd = cJSON_GetObjectItem(cmd_obj, "CMD");
-            if (cJSON_IsString(cmd))
-            {
-                if (strcmp(cmd->valuestring, "turn on led") == 0)
-                {
-                    msg->cmd = JSON_CMD_TURN_ON_LED;
-                    msg->has_cmd = true;
-                }
-                else if (strcmp(cmd->valuestring, "turn off led") == 0)
-                {
-                    msg->cmd = JSON_CMD_TURN_OFF_LED;
-                    msg->has_cmd = true;
-                }
-                else if (strcmp(cmd->valuestring, "register_success") == 0)
-                {
-                    msg->cmd = JSON_CMD_REGISTER_SUCCESS;
-                    msg->has_cmd = true;
-                }
-            }
+            msg->cmd = JSON_CMD_TURN_OFF_LED;
+            msg->has_cmd = true;
+        }
+        else if (strcmp(cmd_str, "register_success") == 0)
+        {
+            msg->cmd = JSON_CMD_REGISTER_SUCCESS;
+            msg->has_cmd = true;
         }
     }
-
-    cJSON_Delete(root);
-    return msg;
+    return true;
 }
 
 // --- Encode Slave Message ---
@@ -237,78 +260,55 @@ char *json_encode_slave_msg(const json_slave_msg_t *msg)
     return json_str;
 }
 
-json_slave_msg_t *json_decode_slave_msg(const char *json_str)
+bool json_decode_slave_msg(const char *json_str, json_slave_msg_t *msg)
 {
-    if (!json_str)
-        return NULL;
-
-    cJSON *root = cJSON_Parse(json_str);
-    if (!root)
-        return NULL;
-
-    json_slave_msg_t *msg = NULL;
-
-    /* ===== BASIC FIELDS ===== */
-    cJSON *id = cJSON_GetObjectItem(root, "ID");
-    cJSON *dst = cJSON_GetObjectItem(root, "DST");
-    cJSON *type = cJSON_GetObjectItem(root, "TYPE");
-    cJSON *data = cJSON_GetObjectItem(root, "data");
-
-    if (!cJSON_IsString(id) || !id->valuestring ||
-        !cJSON_IsString(dst) || !dst->valuestring ||
-        !cJSON_IsString(type) || !type->valuestring ||
-        !cJSON_IsObject(data))
+    char type_str[JSON_TYPE_STR_LEN];
+    int32_t temp, humi, lux;
+    const json_field_t fields[] = {
+        {"ID", JSON_FIELD_STRING, true, msg->id, sizeof(msg->id)},
+        {"DST", JSON_FIELD_STRING, true, msg->dst, sizeof(msg->dst)},
+        {"TYPE", JSON_FIELD_STRING, true, type_str, sizeof(type_str)},
+        {"data.temp", JSON_FIELD_INT, false, &temp, 0},
+        {"data.humi", JSON_FIELD_INT, false, &humi, 0},
+        {"data.lux", JSON_FIELD_INT, false, &lux, 0},
+    };
+    uint32_t found;
+    json_read_error_t err;
+
+    memset(msg, 0, sizeof(*msg));
+    if (!json_str || !json_bind(json_str, strlen(json_str), fields, 6, &found, &err))
     {
-        goto exit;
+        if (json_str)
+        {
+            json_log_error("Bad slave message", &err);
+        }
+        return false;
     }
 
-    msg = calloc(1, sizeof(json_slave_msg_t));
-    if (!msg)
-        goto exit;
-
-    /* ===== COPY STRING SAFE ===== */
-    snprintf(msg->id, MAC_ADDR_STR_LEN, "%s", id->valuestring);
-    snprintf(msg->dst, MAC_ADDR_STR_LEN, "%s", dst->valuestring);
-
     /* ===== TYPE ===== */
-    if (strcmp(type->valuestring, "response_data") == 0)
-    {
-        msg->type = JSON_MSG_TYPE_RESPONSE_DATA;
-    }
-    else
+    if (strcmp(type_str, "response_data") != 0)
     {
-        goto error;
+        return false;
     }
+    msg->type = JSON_MSG_TYPE_RESPONSE_DATA;
 
     /* ===== DATA ===== */
-    cJSON *temp = cJSON_GetObjectItem(data, "temp");
-    cJSON *humi = cJSON_GetObjectItem(data, "humi");
-    cJSON *lux = cJSON_GetObjectItem(data, "lux");
-
-    if (cJSON_IsNumber(temp) && cJSON_IsNumber(humi))
+    if ((found & (1u << 3)) && (found & (1u << 4)))
     {
         msg->is_dht11 = true;
-        msg->data.dht11.temp = temp->valueint;
-        msg->data.dht11.humi = humi->valueint;
+        msg->data.dht11.temp = temp;
+        msg->data.dht11.humi = humi;
     }
-    else if (cJSON_IsNumber(lux))
+    else if (found & (1u << 5))
     {
         msg->is_dht11 = false;
-        msg->data.lux_sensor.lux = lux->valueint;
+        msg->data.lux_sensor.lux = lux;
     }
     else
     {
-        goto error;
+        return false;
     }
-
-    cJSON_Delete(root);
-    return msg;
-
-error:
-    free(msg);
-exit:
-    cJSON_Delete(root);
-    return NULL;
+    return true;
 }
 
 // --- Encode Slave Message Data for MQTT ---
@@ -47,6 +47,43 @@ bool is_slave_discovered(const uint8_t *mac)
     return false;
 }
 
+/**
+ * @brief node id of a registered slave
+ * @param mac Pointer to the MAC address of the slave.
+ * @return 1..MAX_SLAVES, 0 if the slave is not registered
+ */
+uint8_t slave_node_id(const uint8_t *mac)
+{
+    for (int i = 0; i < slave_count; i++)
+    {
+        if (memcmp(discovered_slaves[i].mac, mac, 6) == 0)
+        {
+            return discovered_slaves[i].node;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief smallest node id not used by a registered slave
+ */
+static uint8_t slave_free_node_id(void)
+{
+    for (uint8_t node = 1; node <= MAX_SLAVES; node++)
+    {
+        bool used = false;
+        for (int i = 0; i < slave_count; i++)
+        {
+            used |= discovered_slaves[i].node == node;
+        }
+        if (!used)
+        {
+            return node;
+        }
+    }
+    return 0;
+}
+
 /**
  * @brief remove slave when send fail
  * @details This function removes a slave from the discovered_slaves list and deletes it from the ESP-NOW peer list when a send failure occurs.
@@ -88,9 +125,10 @@ void add_new_slave(const uint8_t *mac, const char *name)
             memcpy(discovered_slaves[slave_count].mac, mac, 6);
             strncpy(discovered_slaves[slave_count].name, name, SLAVE_NAME_LEN - 1);
             discovered_slaves[slave_count].name[SLAVE_NAME_LEN - 1] = '\0'; // Ensure null-termination
+            discovered_slaves[slave_count].node = slave_free_node_id();
             slave_count++;
-            ESP_LOGI(Master_Tag, "Added new slave '%s' with MAC: %02X:%02X:%02X:%02X:%02X:%02X",
-                     name, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+            ESP_LOGI(Master_Tag, "Added new slave '%s' as node %u with MAC: %02X:%02X:%02X:%02X:%02X:%02X",
+                     name, discovered_slaves[slave_count - 1].node, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 
             // --- Send confirmation message ---
             json_master_msg_t confirm_msg = {
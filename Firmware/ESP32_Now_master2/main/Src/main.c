@@ -15,6 +15,9 @@
 #include "nvs_flash.h"
 #include "uart_protocol.h"
 #include "lib_uart.h"
+#include "fsm.h"
+#include "uart_link.h"
+#include "uart_arq.h"
 #include "define.h"
 #include "helper_function.h"
 
@@ -27,17 +30,84 @@ discovered_slave_t discovered_slaves[MAX_SLAVES];
 volatile int slave_count = 0;
 QueueHandle_t uart_json_queue = NULL;
 
+static portMUX_TYPE poll_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t poll_answered;                  // bit per node id, answers to the running poll cycle
+static poll_stats_t poll_stats[MAX_SLAVES + 1]; // index = node id
+
 // ----- Task prototypes -----
 static void uart_bridge_task(void *pvParameters);
+static void uart_rx_dispatch_task(void *pvParameters);
+static void uart_handle_payload(const Frame_View *view);
 static void master_discovery_task(void *pvParameters);
 static void espnow_receive_task(void *pvParameters);
 static void data_request_task(void *pvParameters);
 
 
+/**
+ * @brief send one node's readings to the gateway
+ */
+static void uart_bridge_send(Sensor_Data *data)
+{
+    uint8_t uart_frame[32];
+    uint16_t frame_len = create_uart_data_message(data, uart_frame);
+    if (frame_len == 0)
+    {
+        ESP_LOGW(Master_Tag, "Failed to create UART frame from aggregated data");
+    }
+    else if (uart_link_send(uart_frame, frame_len))
+    {
+        ESP_LOGI(Master_Tag, "UART sent sensor frame node %u (len=%u)", data->node, (unsigned)frame_len);
+    }
+}
+
+/**
+ * @brief send the readings collected in one window, one frame per node that answered
+ * @details Nothing answered -> one empty aggregate frame (node 0) so the gateway still sees the cycle.
+ * @param pending readings indexed by node id, cleared after sending
+ */
+static void uart_bridge_flush(Sensor_Data pending[MAX_SLAVES + 1])
+{
+    bool sent_any = false;
+
+    for (int node = 0; node <= MAX_SLAVES; node++)
+    {
+        if (pending[node].flags != SENSOR_FLAG_NONE)
+        {
+            uart_bridge_send(&pending[node]);
+            sent_any = true;
+        }
+    }
+    if (!sent_any)
+    {
+        uart_bridge_send(&pending[0]);
+    }
+
+    for (int node = 0; node <= MAX_SLAVES; node++)
+    {
+        pending[node] = (Sensor_Data){.flags = SENSOR_FLAG_NONE, .node = (uint8_t)node};
+    }
+}
+
+/**
+ * @brief send a pushed reading at once as its own node frame, the poll window is not touched
+ */
+static void uart_bridge_push(const uart_json_msg_t *in)
+{
+    Sensor_Data data = {.flags = SENSOR_FLAG_NONE, .node = in->node};
+
+    extract_sensor_data_from_json(in->json, &data);
+    if (data.flags != SENSOR_FLAG_NONE)
+    {
+        uart_bridge_send(&data);
+    }
+}
+
 /**
  * @brief task uart bridge
  * @details This task bridges ESP-NOW JSON messages to UART frames. It waits for a cycle marker, then collects JSON messages within a defined time window,
- *          aggregates the sensor data, and sends a single UART frame with the aggregated data at the end of the window.
+ *          keeps the sensor data per node, and at the end of the window sends one UART frame per node (node id in the frame,
+ *          the gateway turns it into per-node topics).
+ *          Pushed readings (UART_BRIDGE_EVT_PUSH) are sent right away, inside or outside a window.
  * @param pvParameters
  */
 static void uart_bridge_task(void *pvParameters)
@@ -47,7 +117,12 @@ static void uart_bridge_task(void *pvParameters)
 
     const TickType_t COLLECT_WINDOW = pdMS_TO_TICKS(200);
     uart_json_msg_t in = {0};
-    uint8_t uart_frame[32];
+    static Sensor_Data pending[MAX_SLAVES + 1]; // index = node id, 0 = sender not registered
+
+    for (int node = 0; node <= MAX_SLAVES; node++)
+    {
+        pending[node] = (Sensor_Data){.flags = SENSOR_FLAG_NONE, .node = (uint8_t)node};
+    }
 
     while (1)
     {
@@ -57,19 +132,18 @@ static void uart_bridge_task(void *pvParameters)
             continue;
         }
 
+        if (in.evt == UART_BRIDGE_EVT_PUSH)
+        {
+            uart_bridge_push(&in);
+            continue;
+        }
+
         if (in.evt != UART_BRIDGE_EVT_CYCLE)
         {
             // Ignore stray JSON until we get a cycle marker
             continue;
         }
 
-        Sensor_Data pending = {
-            .flags = SENSOR_FLAG_NONE,
-            .lux = 0,
-            .temp = 0,
-            .humi = 0,
-        };
-
         TickType_t deadline = xTaskGetTickCount() + COLLECT_WINDOW;
 
         // Collect response_data JSONs within the window
@@ -86,26 +160,17 @@ static void uart_bridge_task(void *pvParameters)
             {
                 if (in.evt == UART_BRIDGE_EVT_JSON)
                 {
-                    extract_sensor_data_from_json(in.json, &pending);
+                    uint8_t node = in.node <= MAX_SLAVES ? in.node : 0;
+                    extract_sensor_data_from_json(in.json, &pending[node]);
+                }
+                else if (in.evt == UART_BRIDGE_EVT_PUSH)
+                {
+                    uart_bridge_push(&in);
                 }
                 else if (in.evt == UART_BRIDGE_EVT_CYCLE)
                 {
-                    // New cycle arrived before we sent previous one: break and send immediately.
-                    // Then this cycle marker will be processed next loop iteration.
-                    // Put it back to queue front is not supported, so we just treat it as next cycle by sending now
-                    // and starting a new window immediately.
-                    // Start next cycle by resetting deadline and pending.
-                    uint16_t frame_len = create_uart_data_message(&pending, uart_frame);
-                    if (frame_len > 0)
-                    {
-                        uart.send.bytes(uart_frame, frame_len);
-                        ESP_LOGI(Master_Tag, "UART sent sensor frame (len=%u)", (unsigned)frame_len);
-                    }
-
-                    pending.flags = SENSOR_FLAG_NONE;
-                    pending.lux = 0;
-                    pending.temp = 0;
-                    pending.humi = 0;
+                    // New cycle arrived before we sent previous one: send now and start a new window immediately.
+                    uart_bridge_flush(pending);
                     deadline = xTaskGetTickCount() + COLLECT_WINDOW;
                 }
             }
@@ -115,16 +180,68 @@ static void uart_bridge_task(void *pvParameters)
             }
         }
 
-        // Send once per cycle, even if pending.flags == NONE (all default 0)
-        uint16_t frame_len = create_uart_data_message(&pending, uart_frame);
-        if (frame_len > 0)
+        // Send once per cycle, even if nothing answered
+        uart_bridge_flush(pending);
+    }
+}
+
+/**
+ * @brief handle a frame from the gateway, plain or delivered in order by the ARQ layer
+ * @param view (inner) frame, only valid during the call
+ */
+static void uart_handle_payload(const Frame_View *view)
+{
+    if (uart_view_is_control(view))
+    {
+        ESP_LOGI(Master_Tag, "UART control from gateway: node=%u plug=%u status=%u",
+                 uart_control_node(view), uart_control_plug_id(view), uart_control_status(view));
+    }
+}
+
+/**
+ * @brief task dispatch frames received from the gateway
+ * @details Woken by lib_uart as soon as the FSM holds a complete frame, so link negotiation frames are not
+ *          left waiting behind a polling delay. LINK frames go to the link manager, RELIABLE/ACK frames to the
+ *          ARQ layer, the rest to uart_handle_payload.
+ * @param pvParameters
+ */
+static void uart_rx_dispatch_task(void *pvParameters)
+{
+    (void)pvParameters;
+    Frame_View frame;
+
+    uart_set_frame_notify(xTaskGetCurrentTaskHandle());
+    ESP_LOGI(Master_Tag, "uart_rx_dispatch_task started");
+
+    while (1)
+    {
+        // Woken by the RX task for every queued frame, the timeout is only a fallback
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+        if (!uart.check.is_message())
         {
-            uart.send.bytes(uart_frame, frame_len);
-            ESP_LOGI(Master_Tag, "UART sent sensor frame (len=%u)", (unsigned)frame_len);
+            continue;
         }
-        else
+
+        // Drain every queued frame, each stays in its lib_uart slot until released
+        while (uart.frame.acquire(&frame))
         {
-            ESP_LOGW(Master_Tag, "Failed to create UART frame from aggregated data");
+            uart_link_notify_rx();
+            switch (frame.type)
+            {
+            case UART_MSG_LINK:
+                uart_link_handle_frame(frame.payload, frame.payload_len);
+                break;
+            case UART_MSG_RELIABLE:
+                uart_arq_handle_data(frame.payload, frame.payload_len);
+                break;
+            case UART_MSG_ACK:
+                uart_arq_handle_ack(frame.payload, frame.payload_len);
+                break;
+            default:
+                uart_handle_payload(&frame);
+                break;
+            }
+            uart.frame.release(&frame);
         }
     }
 }
@@ -195,15 +312,14 @@ static void espnow_receive_task(void *pvParameters)
             {
             case JSON_MSG_TYPE_DISCOVERY_RESPONSE:
             {
-                json_discovery_response_t *resp = json_decode_discovery_response((const char *)msg.data);
-                if (resp)
+                json_discovery_response_t resp;
+                if (json_decode_discovery_response((const char *)msg.data, &resp))
                 {
                     ESP_LOGI(Master_Tag, "Discovered slave '%s' with MAC: %02X:%02X:%02X:%02X:%02X:%02X",
-                             resp->name,
+                             resp.name,
                              msg.src_mac[0], msg.src_mac[1], msg.src_mac[2],
                              msg.src_mac[3], msg.src_mac[4], msg.src_mac[5]);
-                    add_new_slave(msg.src_mac, resp->name);
-                    free(resp);
+                    add_new_slave(msg.src_mac, resp.name);
                 }
                 break;
             }
@@ -212,7 +328,30 @@ static void espnow_receive_task(void *pvParameters)
                 if (uart_json_queue)
                 {
                     uart_json_msg_t out = {0};
-                    out.evt = UART_BRIDGE_EVT_JSON;
+                    out.node = slave_node_id(msg.src_mac);
+                    out.evt = json_decode_push_flag((const char *)msg.data) ? UART_BRIDGE_EVT_PUSH : UART_BRIDGE_EVT_JSON;
+                    if (out.evt == UART_BRIDGE_EVT_PUSH && out.node == 0)
+                    {
+                        ESP_LOGW(Master_Tag, "Push from unregistered %02X:%02X:%02X:%02X:%02X:%02X, dropped",
+                                 msg.src_mac[0], msg.src_mac[1], msg.src_mac[2], msg.src_mac[3], msg.src_mac[4], msg.src_mac[5]);
+                        break;
+                    }
+                    if (out.node != 0)
+                    {
+                        json_duty_report_t duty;
+                        bool has_duty = json_decode_duty_report((const char *)msg.data, &duty);
+                        taskENTER_CRITICAL(&poll_lock);
+                        if (out.evt == UART_BRIDGE_EVT_JSON)
+                        {
+                            poll_answered |= 1u << out.node; // no re-send for this cycle
+                        }
+                        if (has_duty)
+                        {
+                            poll_stats[out.node].has_duty = true;
+                            poll_stats[out.node].duty = duty;
+                        }
+                        taskEXIT_CRITICAL(&poll_lock);
+                    }
                     out.len = (uint16_t)strnlen((const char *)msg.data, sizeof(out.json) - 1);
                     memcpy(out.json, (const char *)msg.data, out.len);
                     out.json[out.len] = '\0';
@@ -232,9 +371,76 @@ static void espnow_receive_task(void *pvParameters)
     }
 }
 
+/**
+ * @brief send ask_data to the nodes in mask
+ * @param next_ms time until the next cycle, sleeping nodes wake up for it
+ */
+static void send_ask_data(const char *master_mac_str, uint32_t mask, uint32_t next_ms)
+{
+    json_master_msg_t ask_msg = {.type = JSON_MSG_TYPE_ASK_DATA, .next_ms = next_ms};
+    strcpy(ask_msg.id, master_mac_str);
+
+    char *json_ask = json_encode_master_msg(&ask_msg);
+    if (!json_ask)
+    {
+        ESP_LOGE(Master_Tag, "Failed to create ASK_DATA JSON");
+        return;
+    }
+
+    for (int i = 0; i < slave_count; i++)
+    {
+        if (mask & (1u << discovered_slaves[i].node))
+        {
+            char slave_mac_str[MAC_ADDR_STR_LEN];
+            mac_to_string(discovered_slaves[i].mac, slave_mac_str);
+            ESP_LOGI(Master_Tag, "ASK_DATA -> %s (%s)", discovered_slaves[i].name, slave_mac_str);
+            espnow_api_send_to(discovered_slaves[i].mac, (const uint8_t *)json_ask, strlen(json_ask));
+        }
+    }
+    free(json_ask);
+}
+
+/**
+ * @brief ms from now until the next cycle starts
+ */
+static uint32_t ask_next_ms(TickType_t cycle_start)
+{
+    uint32_t elapsed = (uint32_t)pdTICKS_TO_MS(xTaskGetTickCount() - cycle_start);
+    return elapsed < ASK_DATA_PERIOD_MS ? ASK_DATA_PERIOD_MS - elapsed : 1;
+}
+
+/**
+ * @brief log the poll statistics of every registered node
+ */
+static void poll_stats_log(void)
+{
+    for (int i = 0; i < slave_count; i++)
+    {
+        uint8_t node = discovered_slaves[i].node;
+        taskENTER_CRITICAL(&poll_lock);
+        poll_stats_t st = poll_stats[node];
+        taskEXIT_CRITICAL(&poll_lock);
+
+        if (st.has_duty)
+        {
+            ESP_LOGI(Master_Tag, "Node %u '%s': polls %lu, retried %lu, missed %lu | awake %lu ms/cycle, node missed %lu, duty %lu.%lu%%",
+                     node, discovered_slaves[i].name, (unsigned long)st.polls, (unsigned long)st.retried, (unsigned long)st.missed,
+                     (unsigned long)st.duty.awake_ms, (unsigned long)st.duty.missed,
+                     (unsigned long)(st.duty.duty_pm / 10), (unsigned long)(st.duty.duty_pm % 10));
+        }
+        else
+        {
+            ESP_LOGI(Master_Tag, "Node %u '%s': polls %lu, retried %lu, missed %lu",
+                     node, discovered_slaves[i].name, (unsigned long)st.polls, (unsigned long)st.retried, (unsigned long)st.missed);
+        }
+    }
+}
+
 /**
  * @brief task request data from slaves
- * @details This task periodically sends data request messages to all discovered slaves every 1000  milliseconds.
+ * @details This task sends data request messages to all discovered slaves every ASK_DATA_PERIOD_MS milliseconds on a fixed
+ *          schedule. Every request carries the time until the next one ("NEXT") so sleeping nodes wake up just before it;
+ *          nodes that did not answer yet (woke up late) get up to ASK_DATA_RETRIES re-sends ASK_DATA_RETRY_MS apart.
  * @param pvParameters
  */
 static void data_request_task(void *pvParameters)
@@ -242,22 +448,14 @@ static void data_request_task(void *pvParameters)
     ESP_LOGI(Master_Tag, "data_request_task started (period=%dms)", ASK_DATA_PERIOD_MS);
     char master_mac_str[MAC_ADDR_STR_LEN];
     mac_to_string(MASTER_MAC, master_mac_str);
+    TickType_t cycle_start = xTaskGetTickCount();
+    uint32_t cycles = 0;
 
     while (1)
     {
-        vTaskDelay(pdMS_TO_TICKS(ASK_DATA_PERIOD_MS)); // Gửi yêu cầu mỗi 1 giây
+        xTaskDelayUntil(&cycle_start, pdMS_TO_TICKS(ASK_DATA_PERIOD_MS)); // Gửi yêu cầu mỗi 1 giây
         if (slave_count > 0)
         {
-            json_master_msg_t ask_msg = {.type = JSON_MSG_TYPE_ASK_DATA};
-            strcpy(ask_msg.id, master_mac_str);
-
-            char *json_ask_common = json_encode_master_msg(&ask_msg);
-            if (!json_ask_common)
-            {
-                ESP_LOGE(Master_Tag, "Failed to create ASK_DATA JSON");
-                continue;
-            }
-
             // Signal UART bridge: start a new collection cycle BEFORE sending requests
             // (prevents responses arriving before the cycle marker and being dropped)
             if (uart_json_queue)
@@ -267,15 +465,47 @@ static void data_request_task(void *pvParameters)
                 (void)xQueueSend(uart_json_queue, &cycle, 0);
             }
 
+            uint32_t pending = 0;
+            taskENTER_CRITICAL(&poll_lock);
+            poll_answered = 0;
             for (int i = 0; i < slave_count; i++)
             {
-                char slave_mac_str[MAC_ADDR_STR_LEN];
-                mac_to_string(discovered_slaves[i].mac, slave_mac_str);
-                ESP_LOGI(Master_Tag, "ASK_DATA -> %s (%s)", discovered_slaves[i].name, slave_mac_str);
-                espnow_api_send_to(discovered_slaves[i].mac, (const uint8_t *)json_ask_common, strlen(json_ask_common));
+                pending |= 1u << discovered_slaves[i].node;
+                poll_stats[discovered_slaves[i].node].polls++;
+            }
+            taskEXIT_CRITICAL(&poll_lock);
+
+            // Re-send to the nodes that did not answer yet, the last wait only tells who missed the cycle
+            send_ask_data(master_mac_str, pending, ask_next_ms(cycle_start));
+            for (int retry = 1; retry <= ASK_DATA_RETRIES + 1; retry++)
+            {
+                vTaskDelay(pdMS_TO_TICKS(ASK_DATA_RETRY_MS));
+                taskENTER_CRITICAL(&poll_lock);
+                pending &= ~poll_answered;
+                for (int node = 1; node <= MAX_SLAVES; node++)
+                {
+                    if ((pending & (1u << node)) && retry == 1)
+                    {
+                        poll_stats[node].retried++;
+                    }
+                    if ((pending & (1u << node)) && retry > ASK_DATA_RETRIES)
+                    {
+                        poll_stats[node].missed++;
+                    }
+                }
+                taskEXIT_CRITICAL(&poll_lock);
+
+                if (pending == 0 || retry > ASK_DATA_RETRIES)
+                {
+                    break;
+                }
+                send_ask_data(master_mac_str, pending, ask_next_ms(cycle_start));
             }
 
-            free(json_ask_common);
+            if (++cycles % POLL_STATS_LOG_CYCLES == 0)
+            {
+                poll_stats_log();
+            }
         }
     }
 }
@@ -283,6 +513,7 @@ static void data_request_task(void *pvParameters)
 
 void app_main(void)
 {
+    message_set_integrity_mode(UART_INTEGRITY_MODE);
     uart_init_with_fsm(UART_BAUD_RATE, UART_TX_PIN, UART_RX_PIN);
 
     // Queue/task to forward ESP-NOW response_data JSON -> UART frames
@@ -315,6 +546,20 @@ void app_main(void)
 
     ESP_LOGI(Master_Tag, "Wi-Fi started (STA mode, ESP-NOW)");
 
+    /* ================== UART link (NVS is ready now) ================== */
+    uart_link_start(UART_LINK_ROLE_INITIATOR);
+    uart_arq_init(uart_handle_payload);
+    if (xTaskCreate(
+            uart_rx_dispatch_task,
+            "uart_rx_dispatch_task",
+            4096,
+            NULL,
+            8,
+            NULL) != pdPASS)
+    {
+        ESP_LOGE(Master_Tag, "Failed to create uart_rx_dispatch_task");
+    }
+
     /* ================== Channel ================== */
     ESP_ERROR_CHECK(
         esp_wifi_set_channel(ESP_NOW_WIFI_CHANNEL, WIFI_SECOND_CHAN_NONE));
@@ -0,0 +1,829 @@
+#include "uart_link.h"
+#include "uart_protocol.h"
+#include "lib_uart.h"
+#include "fsm.h"
+#include "message.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "UART_LINK";
+
+#define UART_LINK_NVS_NAMESPACE "uart_link"
+#define UART_LINK_NVS_KEY_BAUD "baud"
+#define UART_LINK_MAX_PAYLOAD (3 + UART_LINK_TEST_PATTERN_LEN) // [op, seq, index, pattern...]
+#define UART_LINK_QUEUE_LEN (UART_LINK_TEST_FRAMES + 8)
+#define UART_LINK_SETTLE_MS 20 // Let both ends finish switching before the first test frame
+#define UART_LINK_POLL_MS 50
+
+// Ascending, index 0 is the base rate both ends boot at
+static const uint32_t link_rates[UART_LINK_MAX_RATES] = {
+    UART_LINK_BASE_BAUD, 230400, 460800, 921600, 1500000, 2000000};
+
+typedef struct
+{
+    uint16_t len;
+    uint8_t data[UART_LINK_MAX_PAYLOAD];
+} link_payload_t;
+
+typedef struct
+{
+    uint16_t len;
+    uint8_t data[FSM_MAX_FRAME_SIZE];
+} link_held_frame_t;
+
+static QueueHandle_t link_queue = NULL;
+static SemaphoreHandle_t link_tx_mutex = NULL;
+static QueueHandle_t link_hold_queue = NULL; // link_held_frame_t, application frames waiting for a switch to end
+static link_held_frame_t link_flush_frame;   // Only used with link_tx_mutex held
+static volatile bool link_switching = false; // A probe or responder test owns the TX path
+static uart_link_role_t link_role;
+static uart_link_stats_t link_stats;
+static volatile TickType_t link_last_rx = 0;
+static uint8_t link_seq = 0;
+
+// Counters of the last HELLO / local poll, used to compute error rate deltas
+static uint32_t monitor_peer_ok, monitor_peer_err, monitor_local_ok, monitor_local_err;
+static uint32_t window_ok, window_err;
+
+// ======================= Helpers =======================
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)(v & 0xFFFF));
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)math.convert.bytes_to_uint16(p[0], p[1]) |
+           ((uint32_t)math.convert.bytes_to_uint16(p[2], p[3]) << 16);
+}
+
+static uint8_t link_pattern_byte(uint8_t index, uint16_t j)
+{
+    return (uint8_t)((index * 37 + j * 11) ^ ((j & 1) ? 0xAA : 0x55));
+}
+
+static int link_rate_index(uint32_t baud)
+{
+    for (int i = 0; i < UART_LINK_MAX_RATES; i++)
+    {
+        if (link_rates[i] == baud)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static uint32_t link_elapsed_ms(TickType_t since)
+{
+    return (uint32_t)((xTaskGetTickCount() - since) * portTICK_PERIOD_MS);
+}
+
+/**
+ * @brief Wrap a link payload in a UART frame and write it (caller owns the TX path)
+ */
+static void link_write(const uint8_t *payload, uint16_t len)
+{
+    uint8_t frame[FRAME_HEADER_SIZE + UART_LINK_MAX_PAYLOAD + 2];
+    uint16_t idx = 0;
+
+    frame[idx++] = START_BYTE;
+    frame[idx++] = START_BYTE_FOLLOW;
+    frame[idx++] = UART_MSG_LINK;
+    put_u16(&frame[idx], (uint16_t)(FRAME_HEADER_SIZE + len + 2));
+    idx += 2;
+    memcpy(&frame[idx], payload, len);
+    idx += len;
+    idx = message_append_integrity(frame, idx);
+
+    uart.send.frame(frame, idx);
+}
+
+/**
+ * @brief Send the frames queued during a switch, in arrival order (caller owns the TX path)
+ */
+static void link_flush_held(void)
+{
+    while (xQueueReceive(link_hold_queue, &link_flush_frame, 0) == pdTRUE)
+    {
+        uart.send.frame(link_flush_frame.data, link_flush_frame.len);
+    }
+}
+
+/**
+ * @brief End of a switch or link write: queued frames go out before anyone else gets the TX path
+ */
+static void link_tx_release(void)
+{
+    link_switching = false;
+    link_flush_held();
+    xSemaphoreGive(link_tx_mutex);
+}
+
+/**
+ * @brief Send frames left in the hold queue when the switch ended while a sender was queuing
+ */
+static void link_flush_pending(void)
+{
+    if (link_switching || uxQueueMessagesWaiting(link_hold_queue) == 0)
+    {
+        return;
+    }
+    if (xSemaphoreTake(link_tx_mutex, 0) == pdTRUE)
+    {
+        link_tx_release();
+    }
+}
+
+static void link_write_mode(uart_link_op_t op, uint8_t seq, uint32_t baud, uint8_t framing)
+{
+    uint8_t p[7] = {op, seq};
+    put_u32(&p[2], baud);
+    p[6] = framing;
+    link_write(p, sizeof(p));
+}
+
+/**
+ * @brief Framing carried by PROPOSE / ACCEPT / COMMIT, peers without the byte only speak FRAMING_LENGTH
+ */
+static uint8_t link_get_framing(const link_payload_t *in)
+{
+    return (in->len >= 7) ? in->data[6] : FRAMING_LENGTH;
+}
+
+/**
+ * @brief Wait for a link payload with the given op and sequence, other payloads are dropped
+ */
+static bool link_wait_op(uart_link_op_t op, uint8_t seq, uint32_t timeout_ms, link_payload_t *out)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+
+    while (xTaskGetTickCount() - start < timeout)
+    {
+        TickType_t left = timeout - (xTaskGetTickCount() - start);
+        if (xQueueReceive(link_queue, out, left) != pdTRUE)
+        {
+            break;
+        }
+        if (out->len >= 2 && out->data[0] == op && out->data[1] == seq)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void link_set_mode(uint32_t baud, uint8_t framing)
+{
+    uart.basic.set_baud(baud);
+    link_stats.current_baud = baud;
+    if (link_stats.current_framing != framing)
+    {
+        uart_set_framing((Framing_Mode)framing);
+        link_stats.current_framing = framing;
+    }
+
+    // Counters from the previous rate must not trigger a fallback at the new one
+    window_ok = 0;
+    window_err = 0;
+    monitor_local_ok = fsm_frame_count;
+    monitor_local_err = fsm_integrity_error_count;
+    link_last_rx = xTaskGetTickCount();
+}
+
+static void link_send_hello(void)
+{
+    uint8_t p[13] = {LINK_OP_HELLO};
+    put_u32(&p[1], fsm_frame_count);
+    put_u32(&p[5], fsm_integrity_error_count);
+    put_u32(&p[9], link_stats.current_baud);
+
+    // Skip a beat rather than wait behind a long application write
+    if (xSemaphoreTake(link_tx_mutex, 0) != pdTRUE)
+    {
+        return;
+    }
+    link_write(p, sizeof(p));
+    xSemaphoreGive(link_tx_mutex);
+}
+
+/**
+ * @brief Add frame counts to the error window, used for both the peer's and the local counters
+ */
+static void link_monitor_add(uint32_t ok_now, uint32_t err_now, uint32_t *ok_prev, uint32_t *err_prev)
+{
+    window_ok += ok_now - *ok_prev;
+    window_err += err_now - *err_prev;
+    *ok_prev = ok_now;
+    *err_prev = err_now;
+}
+
+static void link_handle_hello(const link_payload_t *in)
+{
+    if (in->len < 13)
+    {
+        return;
+    }
+
+    link_stats.peer_rx_ok = get_u32(&in->data[1]);
+    link_stats.peer_rx_err = get_u32(&in->data[5]);
+
+    // Peer rebooted: counters went backwards, restart the deltas from here
+    if (link_stats.peer_rx_ok < monitor_peer_ok || link_stats.peer_rx_err < monitor_peer_err)
+    {
+        monitor_peer_ok = link_stats.peer_rx_ok;
+        monitor_peer_err = link_stats.peer_rx_err;
+    }
+    link_monitor_add(link_stats.peer_rx_ok, link_stats.peer_rx_err, &monitor_peer_ok, &monitor_peer_err);
+}
+
+static bool link_at_base(void)
+{
+    return link_stats.current_baud == UART_LINK_BASE_BAUD && link_stats.current_framing == FRAMING_LENGTH;
+}
+
+/**
+ * @brief Back to the base rate and framing when nothing valid was heard for a while, both ends do this on their own
+ * @return true if the rate was changed
+ */
+static bool link_check_silence(void)
+{
+    if (link_at_base())
+    {
+        return false;
+    }
+    if (link_elapsed_ms(link_last_rx) < UART_LINK_SILENCE_TIMEOUT_MS)
+    {
+        return false;
+    }
+
+    ESP_LOGW(TAG, "No valid frame for %d ms at %lu, back to %d", UART_LINK_SILENCE_TIMEOUT_MS,
+             link_stats.current_baud, UART_LINK_BASE_BAUD);
+    link_stats.fallbacks++;
+    link_switching = true;
+    xSemaphoreTake(link_tx_mutex, portMAX_DELAY);
+    link_set_mode(UART_LINK_BASE_BAUD, FRAMING_LENGTH);
+    link_tx_release();
+    return true;
+}
+
+// ======================= Initiator =======================
+static uint32_t link_nvs_load(void)
+{
+    nvs_handle_t nvs_handle;
+    uint32_t baud = 0;
+
+    if (nvs_open(UART_LINK_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK)
+    {
+        return 0;
+    }
+    if (nvs_get_u32(nvs_handle, UART_LINK_NVS_KEY_BAUD, &baud) != ESP_OK)
+    {
+        baud = 0;
+    }
+    nvs_close(nvs_handle);
+    return baud;
+}
+
+static void link_nvs_store(uint32_t baud)
+{
+    nvs_handle_t nvs_handle;
+
+    if (nvs_open(UART_LINK_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to open NVS, rate not remembered");
+        return;
+    }
+    if (nvs_set_u32(nvs_handle, UART_LINK_NVS_KEY_BAUD, baud) == ESP_OK)
+    {
+        nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+}
+
+/**
+ * @brief Probe one rate with UART_LINK_FRAMING: PROPOSE -> ACCEPT -> switch -> TEST burst -> REPORT -> COMMIT -> COMMIT_ACK
+ * @return true if both ends are now running at the probed rate
+ */
+static bool link_probe_rate(int index)
+{
+    uart_link_rate_stats_t *rate = &link_stats.rates[index];
+    uint32_t baud = link_rates[index];
+    uint8_t framing = UART_LINK_FRAMING;
+    uint32_t old_baud = link_stats.current_baud;
+    uint8_t old_framing = link_stats.current_framing;
+    uint8_t seq = ++link_seq;
+    link_payload_t in;
+    bool committed = false;
+
+    // Senders queue from here on instead of waiting for the whole probe
+    link_switching = true;
+    xSemaphoreTake(link_tx_mutex, portMAX_DELAY);
+    xQueueReset(link_queue);
+    rate->probes++;
+
+    link_write_mode(LINK_OP_PROPOSE, seq, baud, framing);
+    if (!link_wait_op(LINK_OP_ACCEPT, seq, UART_LINK_REPLY_TIMEOUT_MS, &in) || link_get_framing(&in) != framing)
+    {
+        // Peer never switched, nothing to undo
+        ESP_LOGW(TAG, "No ACCEPT for %lu", baud);
+        rate->accepted = false;
+        link_tx_release();
+        return false;
+    }
+
+    link_set_mode(baud, framing);
+    vTaskDelay(pdMS_TO_TICKS(UART_LINK_SETTLE_MS));
+
+    uint8_t test[UART_LINK_MAX_PAYLOAD] = {LINK_OP_TEST, seq};
+    for (uint16_t i = 0; i < UART_LINK_TEST_FRAMES; i++)
+    {
+        test[2] = (uint8_t)i;
+        for (uint16_t j = 0; j < UART_LINK_TEST_PATTERN_LEN; j++)
+        {
+            test[3 + j] = link_pattern_byte((uint8_t)i, j);
+        }
+        link_write(test, sizeof(test));
+    }
+
+    uint8_t end[4] = {LINK_OP_TEST_END, seq};
+    put_u16(&end[2], UART_LINK_TEST_FRAMES);
+    link_write(end, sizeof(end));
+
+    rate->frames_sent = UART_LINK_TEST_FRAMES;
+    rate->frames_ok = 0;
+    rate->throughput_bps = 0;
+    rate->error_permille = 1000;
+
+    if (link_wait_op(LINK_OP_REPORT, seq, UART_LINK_REPLY_TIMEOUT_MS, &in) && in.len >= 12)
+    {
+        uint32_t bytes = get_u32(&in.data[4]);
+        uint32_t elapsed_ms = get_u32(&in.data[8]);
+
+        rate->frames_ok = math.convert.bytes_to_uint16(in.data[2], in.data[3]);
+        if (rate->frames_ok > UART_LINK_TEST_FRAMES)
+        {
+            rate->frames_ok = UART_LINK_TEST_FRAMES;
+        }
+        rate->error_permille = (uint16_t)((UART_LINK_TEST_FRAMES - rate->frames_ok) * 1000 / UART_LINK_TEST_FRAMES);
+        rate->throughput_bps = (uint32_t)((uint64_t)bytes * 1000 / (elapsed_ms ? elapsed_ms : 1));
+    }
+
+    rate->accepted = (rate->error_permille <= UART_LINK_MAX_ERROR_PERMILLE);
+    if (rate->accepted)
+    {
+        link_write_mode(LINK_OP_COMMIT, seq, baud, framing);
+        committed = link_wait_op(LINK_OP_COMMIT_ACK, seq, UART_LINK_REPLY_TIMEOUT_MS, &in);
+    }
+
+    if (!committed)
+    {
+        // Peer reverts on its own once COMMIT_TIMEOUT expires, keep the line quiet until then
+        link_set_mode(old_baud, old_framing);
+        vTaskDelay(pdMS_TO_TICKS(UART_LINK_COMMIT_TIMEOUT_MS));
+        xQueueReset(link_queue);
+        link_last_rx = xTaskGetTickCount();
+    }
+
+    ESP_LOGI(TAG, "Probe %lu/%s: %u/%u ok, %u permille, %lu B/s -> %s", baud, framing == FRAMING_COBS ? "cobs" : "len",
+             rate->frames_ok, rate->frames_sent, rate->error_permille, rate->throughput_bps,
+             committed ? "committed" : "rejected");
+
+    link_tx_release();
+    return committed;
+}
+
+/**
+ * @brief Climb from the current rate, trying the remembered rate first
+ */
+static void link_negotiate(uint32_t preferred)
+{
+    int current = link_rate_index(link_stats.current_baud);
+    int remembered = link_rate_index(preferred);
+    int start = current + 1;
+    int limit = UART_LINK_MAX_RATES;
+
+    link_stats.negotiations++;
+
+    // Switch framing at the current rate first, higher rates are still tried if that fails
+    if (link_stats.current_framing != UART_LINK_FRAMING)
+    {
+        link_probe_rate(current);
+    }
+
+    if (remembered > current)
+    {
+        if (link_probe_rate(remembered))
+        {
+            start = remembered + 1;
+        }
+        else
+        {
+            limit = remembered;
+        }
+    }
+
+    for (int i = start; i < limit; i++)
+    {
+        if (!link_probe_rate(i))
+        {
+            break;
+        }
+    }
+
+    if (link_stats.current_baud != link_rates[current])
+    {
+        link_nvs_store(link_stats.current_baud);
+    }
+    ESP_LOGI(TAG, "Negotiation done, running at %lu (%s framing)", link_stats.current_baud,
+             link_stats.current_framing == FRAMING_COBS ? "COBS" : "length");
+}
+
+/**
+ * @brief Step one rate down when the error rate seen by either end is too high
+ */
+static void link_check_error_rate(void)
+{
+    link_monitor_add(fsm_frame_count, fsm_integrity_error_count, &monitor_local_ok, &monitor_local_err);
+
+    uint32_t total = window_ok + window_err;
+    if (total < UART_LINK_MIN_MONITOR_FRAMES)
+    {
+        return;
+    }
+
+    uint32_t permille = window_err * 1000 / total;
+    window_ok = 0;
+    window_err = 0;
+
+    int current = link_rate_index(link_stats.current_baud);
+    if (permille <= UART_LINK_MAX_ERROR_PERMILLE || current <= 0)
+    {
+        return;
+    }
+
+    ESP_LOGW(TAG, "Error rate %lu permille at %lu, stepping down", permille, link_stats.current_baud);
+    link_stats.fallbacks++;
+    if (link_probe_rate(current - 1))
+    {
+        link_nvs_store(link_stats.current_baud);
+    }
+    else
+    {
+        // Peer gets back to base through its silence timeout
+        link_switching = true;
+        xSemaphoreTake(link_tx_mutex, portMAX_DELAY);
+        link_set_mode(UART_LINK_BASE_BAUD, FRAMING_LENGTH);
+        link_tx_release();
+    }
+}
+
+static void link_initiator_task(void *pvParameters)
+{
+    (void)pvParameters;
+    uint32_t remembered = link_nvs_load();
+    TickType_t last_hello = 0;
+    TickType_t last_attempt = 0;
+    bool attempted = false;
+    uint32_t retry_ms = UART_LINK_RETRY_PERIOD_MS;
+    uint32_t failed = 0;
+    link_payload_t in;
+
+    ESP_LOGI(TAG, "Initiator started, remembered rate %lu", remembered);
+
+    while (1)
+    {
+        if (xQueueReceive(link_queue, &in, pdMS_TO_TICKS(UART_LINK_POLL_MS)) == pdTRUE)
+        {
+            if (in.data[0] == LINK_OP_HELLO)
+            {
+                link_handle_hello(&in);
+            }
+        }
+
+        if (link_elapsed_ms(last_hello) >= UART_LINK_HEARTBEAT_MS)
+        {
+            last_hello = xTaskGetTickCount();
+            link_send_hello();
+            link_check_error_rate();
+        }
+
+        link_check_silence();
+        link_flush_pending();
+
+        // Only negotiate once the peer has been heard at the base rate
+        bool peer_alive = (link_last_rx != 0) && link_elapsed_ms(link_last_rx) < UART_LINK_SILENCE_TIMEOUT_MS;
+        if (link_at_base() && peer_alive && (!attempted || link_elapsed_ms(last_attempt) >= retry_ms))
+        {
+            attempted = true;
+            link_negotiate(remembered);
+            remembered = link_stats.current_baud;
+            last_attempt = xTaskGetTickCount();
+
+            if (link_at_base())
+            {
+                // Every probe stalls the application frames for a while, each failed attempt doubles the wait
+                retry_ms = (failed == 0) ? UART_LINK_RETRY_PERIOD_MS : retry_ms * 2;
+                if (retry_ms > UART_LINK_RETRY_MAX_MS)
+                {
+                    retry_ms = UART_LINK_RETRY_MAX_MS;
+                }
+                failed++;
+            }
+            else
+            {
+                failed = 0;
+                retry_ms = UART_LINK_RETRY_PERIOD_MS;
+            }
+            link_stats.retry_ms = retry_ms;
+        }
+    }
+}
+
+// ======================= Responder =======================
+static void link_responder_task(void *pvParameters)
+{
+    (void)pvParameters;
+    TickType_t last_hello = 0;
+    link_payload_t in;
+
+    bool testing = false;
+    uint8_t test_seq = 0;
+    uint32_t prev_baud = UART_LINK_BASE_BAUD;
+    uint8_t prev_framing = FRAMING_LENGTH;
+    uint16_t test_good = 0;
+    uint32_t test_bytes = 0;
+    TickType_t test_first = 0;
+    TickType_t test_deadline = 0;
+
+    ESP_LOGI(TAG, "Responder started");
+
+    while (1)
+    {
+        if (xQueueReceive(link_queue, &in, pdMS_TO_TICKS(UART_LINK_POLL_MS)) == pdTRUE)
+        {
+            uint8_t op = in.data[0];
+            uint8_t seq = (in.len >= 2) ? in.data[1] : 0;
+
+            switch (op)
+            {
+            case LINK_OP_PROPOSE:
+            {
+                uint32_t baud = (in.len >= 6) ? get_u32(&in.data[2]) : 0;
+                uint8_t framing = link_get_framing(&in);
+                if (link_rate_index(baud) < 0 || framing > FRAMING_COBS)
+                {
+                    ESP_LOGW(TAG, "Unsupported rate %lu / framing %u proposed", baud, framing);
+                    break;
+                }
+
+                // Hold the TX path so the application does not write across the switch, its frames are queued
+                if (!testing)
+                {
+                    link_switching = true;
+                    xSemaphoreTake(link_tx_mutex, portMAX_DELAY);
+                    prev_baud = link_stats.current_baud;
+                    prev_framing = link_stats.current_framing;
+                }
+                link_write_mode(LINK_OP_ACCEPT, seq, baud, framing);
+                link_set_mode(baud, framing);
+
+                testing = true;
+                test_seq = seq;
+                test_good = 0;
+                test_bytes = 0;
+                test_first = 0;
+                test_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(UART_LINK_COMMIT_TIMEOUT_MS);
+                break;
+            }
+
+            case LINK_OP_TEST:
+            {
+                if (!testing || seq != test_seq || in.len != UART_LINK_MAX_PAYLOAD)
+                {
+                    break;
+                }
+
+                bool intact = true;
+                for (uint16_t j = 0; j < UART_LINK_TEST_PATTERN_LEN; j++)
+                {
+                    if (in.data[3 + j] != link_pattern_byte(in.data[2], j))
+                    {
+                        intact = false;
+                        break;
+                    }
+                }
+                if (intact)
+                {
+                    if (test_good == 0)
+                    {
+                        test_first = xTaskGetTickCount();
+                    }
+                    test_good++;
+                    test_bytes += in.len;
+                }
+                break;
+            }
+
+            case LINK_OP_TEST_END:
+            {
+                if (!testing || seq != test_seq)
+                {
+                    break;
+                }
+
+                uint8_t p[12] = {LINK_OP_REPORT, seq};
+                put_u16(&p[2], test_good);
+                put_u32(&p[4], test_bytes);
+                put_u32(&p[8], test_good ? link_elapsed_ms(test_first) + portTICK_PERIOD_MS : 0);
+                link_write(p, sizeof(p));
+                break;
+            }
+
+            case LINK_OP_COMMIT:
+            {
+                uint32_t baud = (in.len >= 6) ? get_u32(&in.data[2]) : 0;
+                if (!testing || seq != test_seq || baud != link_stats.current_baud ||
+                    link_get_framing(&in) != link_stats.current_framing)
+                {
+                    break;
+                }
+
+                link_write_mode(LINK_OP_COMMIT_ACK, seq, baud, link_stats.current_framing);
+                testing = false;
+                link_stats.negotiations++;
+                link_stats.rates[link_rate_index(baud)].accepted = true;
+                link_tx_release();
+                ESP_LOGI(TAG, "Committed %lu", baud);
+                break;
+            }
+
+            case LINK_OP_HELLO:
+                link_handle_hello(&in);
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if (testing && (int32_t)(xTaskGetTickCount() - test_deadline) >= 0)
+        {
+            ESP_LOGW(TAG, "No COMMIT for %lu, back to %lu", link_stats.current_baud, prev_baud);
+            link_set_mode(prev_baud, prev_framing);
+            testing = false;
+            link_tx_release();
+        }
+
+        if (!testing)
+        {
+            if (link_elapsed_ms(last_hello) >= UART_LINK_HEARTBEAT_MS)
+            {
+                last_hello = xTaskGetTickCount();
+                link_send_hello();
+            }
+            link_check_silence();
+            link_flush_pending();
+        }
+    }
+}
+
+// ======================= API =======================
+void uart_link_start(uart_link_role_t role)
+{
+    if (link_queue)
+    {
+        return;
+    }
+
+    link_queue = xQueueCreate(UART_LINK_QUEUE_LEN, sizeof(link_payload_t));
+    link_hold_queue = xQueueCreate(UART_LINK_HOLD_FRAMES, sizeof(link_held_frame_t));
+    link_tx_mutex = xSemaphoreCreateMutex();
+    if (!link_queue || !link_hold_queue || !link_tx_mutex)
+    {
+        ESP_LOGE(TAG, "Failed to create link queue/mutex");
+        return;
+    }
+
+    link_role = role;
+    memset(&link_stats, 0, sizeof(link_stats));
+    for (int i = 0; i < UART_LINK_MAX_RATES; i++)
+    {
+        link_stats.rates[i].baud = link_rates[i];
+    }
+    link_stats.current_baud = uart.basic.get_baud();
+    link_stats.current_framing = uart_get_framing();
+    link_stats.retry_ms = UART_LINK_RETRY_PERIOD_MS;
+    monitor_local_ok = fsm_frame_count;
+    monitor_local_err = fsm_integrity_error_count;
+
+    if (xTaskCreate(role == UART_LINK_ROLE_INITIATOR ? link_initiator_task : link_responder_task,
+                    "uart_link_task", 4096, NULL, 7, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create uart_link_task");
+    }
+}
+
+void uart_link_handle_frame(const uint8_t *payload, uint16_t payload_len)
+{
+    if (!link_queue || !payload || payload_len == 0 || payload_len > UART_LINK_MAX_PAYLOAD)
+    {
+        return;
+    }
+
+    link_payload_t item;
+    item.len = payload_len;
+    memcpy(item.data, payload, payload_len);
+    if (xQueueSend(link_queue, &item, 0) != pdTRUE)
+    {
+        ESP_LOGW(TAG, "Link queue full, dropping op 0x%02X", payload[0]);
+    }
+}
+
+void uart_link_notify_rx(void)
+{
+    link_last_rx = xTaskGetTickCount();
+    link_stats.rx_frames_ok = fsm_frame_count;
+    link_stats.rx_frames_err = fsm_integrity_error_count;
+    link_stats.rx_replay_lost = fsm_replay_overflow_count;
+}
+
+bool uart_link_send(const uint8_t *frame, uint16_t length)
+{
+    if (!link_tx_mutex)
+    {
+        uart.send.frame(frame, length);
+        return true;
+    }
+
+    // Frames already queued go first, so a new one queues behind them as well
+    if (!link_switching && uxQueueMessagesWaiting(link_hold_queue) == 0 &&
+        xSemaphoreTake(link_tx_mutex, pdMS_TO_TICKS(UART_LINK_TX_WAIT_MS)) == pdTRUE)
+    {
+        link_flush_held();
+        uart.send.frame(frame, length);
+        xSemaphoreGive(link_tx_mutex);
+        return true;
+    }
+
+    link_held_frame_t held;
+    if (length > sizeof(held.data))
+    {
+        ESP_LOGW(TAG, "Link busy (rate switch), frame of %u bytes too large to queue", (unsigned)length);
+        link_stats.tx_dropped++;
+        return false;
+    }
+    held.len = length;
+    memcpy(held.data, frame, length);
+    if (xQueueSend(link_hold_queue, &held, 0) != pdTRUE)
+    {
+        ESP_LOGW(TAG, "Link busy (rate switch), hold queue full, frame of %u bytes dropped", (unsigned)length);
+        link_stats.tx_dropped++;
+        return false;
+    }
+    link_stats.tx_held++;
+    return true;
+}
+
+void uart_link_get_stats(uart_link_stats_t *out)
+{
+    if (!out)
+    {
+        return;
+    }
+    memcpy(out, &link_stats, sizeof(*out));
+    out->rx_frames_ok = fsm_frame_count;
+    out->rx_frames_err = fsm_integrity_error_count;
+    out->rx_replay_lost = fsm_replay_overflow_count;
+}
+
+void uart_link_log_stats(void)
+{
+    uart_link_stats_t s;
+    uart_link_get_stats(&s);
+
+    ESP_LOGI(TAG, "%s @ %lu baud (%s framing), negotiations=%lu fallbacks=%lu",
+             link_role == UART_LINK_ROLE_INITIATOR ? "initiator" : "responder",
+             s.current_baud, s.current_framing == FRAMING_COBS ? "COBS" : "length", s.negotiations, s.fallbacks);
+    ESP_LOGI(TAG, "rx ok=%lu err=%lu replay lost=%lu | peer rx ok=%lu err=%lu | tx held=%lu dropped=%lu | retry %lu ms",
+             s.rx_frames_ok, s.rx_frames_err, s.rx_replay_lost, s.peer_rx_ok, s.peer_rx_err, s.tx_held, s.tx_dropped,
+             s.retry_ms);
+    for (int i = 0; i < UART_LINK_MAX_RATES; i++)
+    {
+        const uart_link_rate_stats_t *r = &s.rates[i];
+        ESP_LOGI(TAG, "  %7lu: probes=%lu ok=%u/%u err=%u permille %lu B/s %s", r->baud, r->probes,
+                 r->frames_ok, r->frames_sent, r->error_permille, r->throughput_bps, r->accepted ? "ok" : "-");
+    }
+}
@@ -16,45 +16,43 @@ void extract_sensor_data_from_json(const char *json_str, Sensor_Data *sensor_dat
         return;
     }
 
-    cJSON *root = cJSON_Parse(json_str);
-    if (root == NULL)
+    int32_t lux, temp, humi;
+    const json_field_t fields[] = {
+        {"data.lux", JSON_FIELD_INT, false, &lux, 0},
+        {"data.temp", JSON_FIELD_INT, false, &temp, 0},
+        {"data.humi", JSON_FIELD_INT, false, &humi, 0},
+    };
+    uint32_t found;
+    json_read_error_t err;
+    if (!json_bind(json_str, strlen(json_str), fields, 3, &found, &err))
     {
-        ESP_LOGW(TAG, "Failed to parse JSON");
+        ESP_LOGW(TAG, "Failed to parse JSON: %s at %u", json_read_status_str(err.status), err.pos);
         return;
     }
 
-    cJSON *data = cJSON_GetObjectItem(root, "data");
-    if (data != NULL && cJSON_IsObject(data))
+    // Lấy lux nếu có
+    if (found & (1u << 0))
     {
-        // Lấy lux nếu có
-        cJSON *lux = cJSON_GetObjectItem(data, "lux");
-        if (lux != NULL && cJSON_IsNumber(lux))
-        {
-            sensor_data->lux = (uint16_t)lux->valueint;
-            sensor_data->flags |= SENSOR_FLAG_LUX;
-            ESP_LOGI(TAG, "Found lux: %d", sensor_data->lux);
-        }
-
-        // Lấy temp nếu có
-        cJSON *temp = cJSON_GetObjectItem(data, "temp");
-        if (temp != NULL && cJSON_IsNumber(temp))
-        {
-            sensor_data->temp = (uint8_t)temp->valueint;
-            sensor_data->flags |= SENSOR_FLAG_TEMP;
-            ESP_LOGI(TAG, "Found temp: %d", sensor_data->temp);
-        }
+        sensor_data->lux = (uint16_t)lux;
+        sensor_data->flags |= SENSOR_FLAG_LUX;
+        ESP_LOGI(TAG, "Found lux: %d", sensor_data->lux);
+    }
 
-        // Lấy humi nếu có
-        cJSON *humi = cJSON_GetObjectItem(data, "humi");
-        if (humi != NULL && cJSON_IsNumber(humi))
-        {
-            sensor_data->humi = (uint8_t)humi->valueint;
-            sensor_data->flags |= SENSOR_FLAG_HUMI;
-            ESP_LOGI(TAG, "Found humi: %d", sensor_data->humi);
-        }
+    // Lấy temp nếu có
+    if (found & (1u << 1))
+    {
+        sensor_data->temp = (uint8_t)temp;
+        sensor_data->flags |= SENSOR_FLAG_TEMP;
+        ESP_LOGI(TAG, "Found temp: %d", sensor_data->temp);
     }
 
-    cJSON_Delete(root);
+    // Lấy humi nếu có
+    if (found & (1u << 2))
+    {
+        sensor_data->humi = (uint8_t)humi;
+        sensor_data->flags |= SENSOR_FLAG_HUMI;
+        ESP_LOGI(TAG, "Found humi: %d", sensor_data->humi);
+    }
 }
 
 void extract_sensor_data_from_multiple_json(const char **json_messages, int count, Sensor_Data *sensor_data)
@@ -111,6 +109,10 @@ uint16_t create_uart_data_message(Sensor_Data *sensor_data, uint8_t *data_out)
     data_out[idx++] = sensor_data->lux & 0xFF;
     data_out[idx++] = sensor_data->temp;
     data_out[idx++] = sensor_data->humi;
+    if (sensor_data->node != 0)
+    {
+        data_out[idx++] = sensor_data->node; // tùy chọn, gateway cũ bỏ qua byte thừa
+    }
 
     // Tính tổng độ dài (từ 0xAA đến cuối data, chưa tính checksum)
     uint16_t total_length = idx + 2; // +2 cho checksum
@@ -119,13 +121,8 @@ uint16_t create_uart_data_message(Sensor_Data *sensor_data, uint8_t *data_out)
     data_out[length_pos] = (uint8_t)(total_length & 0xFF);   // low byte
     data_out[length_pos + 1] = (uint8_t)(total_length >> 8); // high byte
 
-    // Tính checksum (tất cả bytes trước checksum)
-    uint16_t checksum = caculate_checksum(data_out, idx);
-
-    // Thêm checksum (little endian như uint16_to_bytes)
-    uint8_t *chk = math.convert.uint16_to_bytes(checksum);
-    data_out[idx++] = chk[0];
-    data_out[idx++] = chk[1];
+    // Thêm checksum hoặc CRC (tất cả bytes trước nó, little endian như uint16_to_bytes)
+    idx = message_append_integrity(data_out, idx);
 
     ESP_LOGI(TAG, "Created UART data message: flags=0x%02X, lux=%d, temp=%d, humi=%d",
              sensor_data->flags, sensor_data->lux, sensor_data->temp, sensor_data->humi);
@@ -153,6 +150,11 @@ uint16_t parse_json_to_uart_data(const char *json_str, uint8_t *data_out)
 }
 
 uint16_t create_uart_control_message(Plug_ID plug_id, Plug_Status status, uint8_t *data_out)
+{
+    return create_uart_control_message_to(0, plug_id, status, data_out);
+}
+
+uint16_t create_uart_control_message_to(uint8_t node, Plug_ID plug_id, Plug_Status status, uint8_t *data_out)
 {
     if (data_out == NULL)
     {
@@ -177,6 +179,10 @@ uint16_t create_uart_control_message(Plug_ID plug_id, Plug_Status status, uint8_
     // Data payload: [plug_id, status]
     data_out[idx++] = (uint8_t)plug_id;
     data_out[idx++] = (uint8_t)status;
+    if (node != 0)
+    {
+        data_out[idx++] = node;
+    }
 
     // Tính tổng độ dài
     uint16_t total_length = idx + 2; // +2 cho checksum
@@ -185,155 +191,119 @@ uint16_t create_uart_control_message(Plug_ID plug_id, Plug_Status status, uint8_
     data_out[length_pos] = (uint8_t)(total_length & 0xFF);   // low byte
     data_out[length_pos + 1] = (uint8_t)(total_length >> 8); // high byte
 
-    // Tính checksum
-    uint16_t checksum = caculate_checksum(data_out, idx);
-    uint8_t *chk = math.convert.uint16_to_bytes(checksum);
-    data_out[idx++] = chk[0];
-    data_out[idx++] = chk[1];
+    // Thêm checksum hoặc CRC
+    idx = message_append_integrity(data_out, idx);
 
-    ESP_LOGI(TAG, "Created UART control message: plug=%d, status=%d", plug_id, status);
+    ESP_LOGI(TAG, "Created UART control message: node=%u, plug=%d, status=%d", node, plug_id, status);
 
     return idx;
 }
 
 // ============ UART TO JSON ============
 
-static bool uart_parse_and_check_frame(const uint8_t *uart_data, uint16_t buf_len, uint8_t expected_type,
-                                       const uint8_t **payload_out, uint16_t *payload_len_out)
+void uart_data_write_json(json_writer_t *w, const char *key, const Frame_View *view)
 {
-    if (!uart_data || buf_len < 7)
-    {
-        return false;
-    }
+    Sensor_Data sensor_data = {
+        .flags = uart_data_flags(view),
+        .lux = uart_data_lux(view),
+        .temp = uart_data_temp(view),
+        .humi = uart_data_humi(view),
+        .node = uart_data_node(view),
+    };
+    uart_sensor_write_json(w, key, &sensor_data);
+}
 
-    if (uart_data[0] != 0xAA || uart_data[1] != 0x55)
+void uart_sensor_write_json(json_writer_t *w, const char *key, const Sensor_Data *sensor_data)
+{
+    json_writer_begin_object(w, key);
+    if (sensor_data->node != 0)
     {
-        return false;
+        json_writer_uint(w, "node", sensor_data->node);
     }
-
-    if (uart_data[2] != expected_type)
+    // Chỉ thêm các giá trị có flag tương ứng
+    if (sensor_data->flags & SENSOR_FLAG_LUX)
     {
-        return false;
+        json_writer_uint(w, "lux", sensor_data->lux);
     }
 
-    // Length is little-endian: [3]=low, [4]=high
-    uint16_t frame_len = math.convert.bytes_to_uint16(uart_data[3], uart_data[4]);
-    if (frame_len < 7 || frame_len > buf_len)
+    if (sensor_data->flags & SENSOR_FLAG_TEMP)
     {
-        return false;
+        json_writer_uint(w, "temp", sensor_data->temp);
     }
 
-    // checksum is last 2 bytes, little-endian
-    uint16_t received_chk = math.convert.bytes_to_uint16(uart_data[frame_len - 2], uart_data[frame_len - 1]);
-    uint16_t calc_chk = caculate_checksum((uint8_t *)uart_data, (uint16_t)(frame_len - 2));
-    if (received_chk != calc_chk)
+    if (sensor_data->flags & SENSOR_FLAG_HUMI)
     {
-        ESP_LOGE(TAG, "Checksum mismatch: recv=0x%04X calc=0x%04X", received_chk, calc_chk);
-        return false;
+        json_writer_uint(w, "humi", sensor_data->humi);
     }
-
-    const uint8_t *payload = &uart_data[5];
-    uint16_t payload_len = (uint16_t)(frame_len - 5 - 2);
-
-    if (payload_out)
-        *payload_out = payload;
-    if (payload_len_out)
-        *payload_len_out = payload_len;
-
-    return true;
+    json_writer_end_object(w);
 }
 
-char *decode_uart_data_to_json(const uint8_t *uart_data, uint16_t length)
+uint16_t decode_uart_data_to_json(const Frame_View *view, char *json_out, uint16_t out_size)
 {
-    const uint8_t *payload = NULL;
-    uint16_t payload_len = 0;
-    if (!uart_parse_and_check_frame(uart_data, length, UART_MSG_DATA, &payload, &payload_len))
+    // Start bytes, length and checksum/CRC were already checked by the FSM
+    if (view == NULL || !uart_view_is_data(view))
     {
         ESP_LOGE(TAG, "Invalid UART DATA frame");
-        return NULL;
-    }
-
-    if (payload_len < 5)
-    {
-        ESP_LOGE(TAG, "Invalid DATA payload length: %u", (unsigned)payload_len);
-        return NULL;
+        return 0;
     }
 
-    uint8_t flags = payload[0];
-    uint16_t lux = ((uint16_t)payload[1] << 8) | payload[2];
-    uint8_t temp = payload[3];
-    uint8_t humi = payload[4];
-
     // Tạo JSON telemetry
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "type", "telemetry");
-
-    cJSON *data = cJSON_CreateObject();
-
-    // Chỉ thêm các giá trị có flag tương ứng
-    if (flags & SENSOR_FLAG_LUX)
+    json_writer_t w;
+    json_writer_init(&w, json_out, out_size);
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "type", "telemetry");
+    uart_data_write_json(&w, "data", view);
+    json_writer_end_object(&w);
+
+    uint16_t len = json_writer_finish(&w);
+    if (len == 0)
     {
-        cJSON_AddNumberToObject(data, "lux", lux);
-    }
-
-    if (flags & SENSOR_FLAG_TEMP)
-    {
-        cJSON_AddNumberToObject(data, "temp", temp);
-    }
-
-    if (flags & SENSOR_FLAG_HUMI)
-    {
-        cJSON_AddNumberToObject(data, "humi", humi);
+        ESP_LOGE(TAG, "JSON buffer too small (%u bytes)", out_size);
+        return 0;
     }
 
-    cJSON_AddItemToObject(root, "data", data);
+    ESP_LOGI(TAG, "Decoded UART data to JSON (flags=0x%02X): %s", uart_data_flags(view), json_out);
 
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    ESP_LOGI(TAG, "Decoded UART data to JSON (flags=0x%02X): %s", flags, json_str);
-
-    return json_str;
+    return len;
 }
 
-char *decode_uart_control_to_json(const uint8_t *uart_data, uint16_t length)
+uint16_t decode_uart_control_to_json(const Frame_View *view, char *json_out, uint16_t out_size)
 {
-    const uint8_t *payload = NULL;
-    uint16_t payload_len = 0;
-    if (!uart_parse_and_check_frame(uart_data, length, UART_MSG_CONTROL, &payload, &payload_len))
+    if (view == NULL || !uart_view_is_control(view))
     {
         ESP_LOGE(TAG, "Invalid UART CONTROL frame");
-        return NULL;
-    }
-
-    if (payload_len < 2)
-    {
-        ESP_LOGE(TAG, "Invalid CONTROL payload length: %u", (unsigned)payload_len);
-        return NULL;
+        return 0;
     }
 
-    uint8_t plug_id = payload[0];
-    uint8_t status = payload[1];
+    uint8_t plug_id = uart_control_plug_id(view);
+    uint8_t status = uart_control_status(view);
 
     // Tạo JSON control
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "type", "control");
-
-    cJSON *data = cJSON_CreateObject();
-
-    // Tạo plug name
     char plug_name[10];
     snprintf(plug_name, sizeof(plug_name), "plug_%d", plug_id + 1);
 
-    cJSON_AddStringToObject(data, "plug", plug_name);
-    cJSON_AddStringToObject(data, "status", status == STATUS_ON ? "on" : "off");
-
-    cJSON_AddItemToObject(root, "data", data);
+    json_writer_t w;
+    json_writer_init(&w, json_out, out_size);
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "type", "control");
+    json_writer_begin_object(&w, "data");
+    json_writer_string(&w, "plug", plug_name);
+    json_writer_string(&w, "status", status == STATUS_ON ? "on" : "off");
+    if (uart_control_node(view) != 0)
+    {
+        json_writer_uint(&w, "node", uart_control_node(view));
+    }
+    json_writer_end_object(&w);
+    json_writer_end_object(&w);
 
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
+    uint16_t len = json_writer_finish(&w);
+    if (len == 0)
+    {
+        ESP_LOGE(TAG, "JSON buffer too small (%u bytes)", out_size);
+        return 0;
+    }
 
-    ESP_LOGI(TAG, "Decoded UART control to JSON: %s", json_str);
+    ESP_LOGI(TAG, "Decoded UART control to JSON: %s", json_out);
 
-    return json_str;
+    return len;
 }
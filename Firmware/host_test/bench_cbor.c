@@ -0,0 +1,173 @@
+// CBOR against JSON for the gateway telemetry: bytes on the wire and encode time, one reading and a batch of 8
+
+#include "host_test.h"
+#include "cbor.h"
+
+static uint8_t out[4096];
+static char js[4096];
+static json_tok_t toks[512];
+
+// Same append-only table as the gateway (main.c cbor_key_names)
+static const char *const keys[] = {"type", "data", "batch", "dt", "age_ms", "node", "lux", "temp", "humi", "seq"};
+static const cbor_key_dict_t dict = {keys, sizeof(keys) / sizeof(keys[0])};
+
+static size_t json_reading(int i)
+{
+    json_writer_t w;
+    json_writer_init(&w, js, sizeof(js));
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "type", "telemetry");
+    json_writer_begin_object(&w, "data");
+    json_writer_uint(&w, "node", 3);
+    json_writer_uint(&w, "lux", 512 + i % 7);
+    json_writer_uint(&w, "temp", 27);
+    json_writer_uint(&w, "humi", 61);
+    json_writer_end_object(&w);
+    json_writer_end_object(&w);
+    return json_writer_finish(&w);
+}
+
+static size_t cbor_reading(int i)
+{
+    cbor_writer_t w;
+    cbor_writer_init(&w, out, sizeof(out));
+    cbor_writer_begin_map(&w, NULL);
+    cbor_writer_string(&w, "type", "telemetry");
+    cbor_writer_begin_map(&w, "data");
+    cbor_writer_uint(&w, "node", 3);
+    cbor_writer_uint(&w, "lux", 512 + i % 7);
+    cbor_writer_uint(&w, "temp", 27);
+    cbor_writer_uint(&w, "humi", 61);
+    cbor_writer_end_map(&w);
+    cbor_writer_end_map(&w);
+    return cbor_writer_finish(&w);
+}
+
+static size_t json_batch(void)
+{
+    json_writer_t w;
+    json_writer_init(&w, js, sizeof(js));
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "type", "telemetry");
+    json_writer_begin_array(&w, "batch");
+    for (int k = 0; k < 8; k++)
+    {
+        json_writer_begin_object(&w, NULL);
+        json_writer_uint(&w, "dt", k * 200);
+        json_writer_begin_object(&w, "data");
+        json_writer_uint(&w, "node", 1 + k % 3);
+        json_writer_uint(&w, "lux", 500 + k * 13);
+        json_writer_uint(&w, "temp", 27);
+        json_writer_uint(&w, "humi", 61);
+        json_writer_end_object(&w);
+        json_writer_end_object(&w);
+    }
+    json_writer_end_array(&w);
+    json_writer_uint(&w, "age_ms", 1400);
+    json_writer_end_object(&w);
+    return json_writer_finish(&w);
+}
+
+static size_t cbor_batch(void)
+{
+    cbor_writer_t w;
+    cbor_writer_init(&w, out, sizeof(out));
+    cbor_writer_begin_map(&w, NULL);
+    cbor_writer_string(&w, "type", "telemetry");
+    cbor_writer_begin_array(&w, "batch");
+    for (int k = 0; k < 8; k++)
+    {
+        cbor_writer_begin_map(&w, NULL);
+        cbor_writer_uint(&w, "dt", k * 200);
+        cbor_writer_begin_map(&w, "data");
+        cbor_writer_uint(&w, "node", 1 + k % 3);
+        cbor_writer_uint(&w, "lux", 500 + k * 13);
+        cbor_writer_uint(&w, "temp", 27);
+        cbor_writer_uint(&w, "humi", 61);
+        cbor_writer_end_map(&w);
+        cbor_writer_end_map(&w);
+    }
+    cbor_writer_end_array(&w);
+    cbor_writer_uint(&w, "age_ms", 1400);
+    cbor_writer_end_map(&w);
+    return cbor_writer_finish(&w);
+}
+
+static size_t transcode(const char *doc, size_t len, const cbor_key_dict_t *d)
+{
+    cbor_writer_t w;
+    cbor_writer_init(&w, out, sizeof(out));
+    return cbor_from_json(doc, len, toks, 512, d, &w, NULL);
+}
+
+int main(int argc, char **argv)
+{
+    const int n = ht_quick(argc, argv) ? 20000 : 500000;
+    volatile size_t sink = 0;
+    double t0;
+
+    t0 = ht_now_s();
+    for (int i = 0; i < n; i++)
+        sink += json_reading(i);
+    double t_json = (ht_now_s() - t0) / n;
+    size_t json_len = json_reading(0);
+    char one[256];
+    memcpy(one, js, json_len + 1);
+
+    t0 = ht_now_s();
+    for (int i = 0; i < n; i++)
+        sink += cbor_reading(i);
+    double t_cbor = (ht_now_s() - t0) / n;
+    size_t cbor_len = cbor_reading(0);
+
+    t0 = ht_now_s();
+    for (int i = 0; i < n; i++)
+        sink += transcode(one, json_len, NULL);
+    double t_tr = (ht_now_s() - t0) / n;
+    size_t tr_len = transcode(one, json_len, NULL);
+    size_t tr_dict_len = transcode(one, json_len, &dict);
+
+    t0 = ht_now_s();
+    for (int i = 0; i < n; i++)
+        sink += json_batch();
+    double t_json_b = (ht_now_s() - t0) / n;
+    size_t json_b_len = json_batch();
+    static char batch[2048];
+    memcpy(batch, js, json_b_len + 1);
+
+    t0 = ht_now_s();
+    for (int i = 0; i < n; i++)
+        sink += cbor_batch();
+    double t_cbor_b = (ht_now_s() - t0) / n;
+    size_t cbor_b_len = cbor_batch();
+
+    t0 = ht_now_s();
+    for (int i = 0; i < n; i++)
+        sink += transcode(batch, json_b_len, NULL);
+    double t_tr_b = (ht_now_s() - t0) / n;
+    size_t tr_b_len = transcode(batch, json_b_len, NULL);
+
+    t0 = ht_now_s();
+    for (int i = 0; i < n; i++)
+        sink += transcode(batch, json_b_len, &dict);
+    double t_tr_bd = (ht_now_s() - t0) / n;
+    size_t tr_bd_len = transcode(batch, json_b_len, &dict);
+
+    printf("%-9s %16s %16s %18s %22s\n", "", "json", "cbor", "json->cbor", "json->cbor+dict");
+    printf("%-9s %6zu B %6.0f ns %6zu B %6.0f ns %6zu B %8.0f ns %6zu B\n", "reading", json_len, t_json * 1e9, cbor_len,
+           t_cbor * 1e9, tr_len, t_tr * 1e9, tr_dict_len);
+    printf("%-9s %6zu B %6.0f ns %6zu B %6.0f ns %6zu B %8.0f ns %6zu B %6.0f ns\n", "batch x8", json_b_len,
+           t_json_b * 1e9, cbor_b_len, t_cbor_b * 1e9, tr_b_len, t_tr_b * 1e9, tr_bd_len, t_tr_bd * 1e9);
+
+    // The transcoder gives the same bytes as the direct writer, and the dictionary decodes back to the batch
+    CHECK_EQ(tr_len, cbor_len);
+    CHECK_EQ(tr_b_len, cbor_b_len);
+    CHECK(tr_bd_len < tr_b_len && tr_b_len < json_b_len);
+    json_writer_t jw;
+    cbor_read_status_t st;
+    transcode(batch, json_b_len, &dict);
+    json_writer_init(&jw, js, sizeof(js));
+    CHECK(cbor_to_json(out, tr_bd_len, &dict, &jw, &st) > 0);
+    CHECK(strcmp(js, batch) == 0);
+    return ht_summary("bench_cbor");
+}
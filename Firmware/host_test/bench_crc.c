@@ -0,0 +1,82 @@
+// Cost of the CRC-16 against the legacy 16-bit sum, and how many corrupted frames each lets through
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "message.h"
+
+static volatile uint16_t sink;
+
+static uint16_t crc16_bytewise(const uint8_t *data, uint16_t len)
+{
+    uint16_t crc = CRC16_INIT;
+    for (uint16_t i = 0; i < len; i++)
+        crc = crc16_update(crc, data[i]);
+    return crc;
+}
+
+static double mbps(uint16_t (*fn)(const uint8_t *, uint16_t), const uint8_t *buf, uint16_t len, long iters)
+{
+    double t0 = ht_now_s();
+    for (long i = 0; i < iters; i++)
+        sink ^= fn(buf, len);
+    double dt = ht_now_s() - t0;
+    return (double)len * (double)iters / dt / 1e6;
+}
+
+static uint16_t sum16(const uint8_t *data, uint16_t len)
+{
+    return caculate_checksum((uint8_t *)data, len);
+}
+
+int main(int argc, char **argv)
+{
+    bool quick = ht_quick(argc, argv);
+    long bytes_per_run = quick ? 2000000L : 200000000L;
+    static const uint16_t sizes[] = {16, 64, 200};
+    uint8_t buf[256];
+
+    srand(1);
+    for (int i = 0; i < (int)sizeof(buf); i++)
+        buf[i] = (uint8_t)rand();
+
+    printf("%6s %12s %14s %14s\n", "bytes", "sum MB/s", "crc-byte MB/s", "crc-slice MB/s");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        long iters = bytes_per_run / sizes[s];
+        double m_sum = mbps(sum16, buf, sizes[s], iters);
+        double m_byte = mbps(crc16_bytewise, buf, sizes[s], iters);
+        double m_slice = mbps(caculate_crc16, buf, sizes[s], iters);
+        printf("%6u %12.1f %14.1f %14.1f\n", sizes[s], m_sum, m_byte, m_slice);
+        CHECK(m_sum > 0 && m_byte > 0 && m_slice > 0);
+    }
+
+    // Random 1..2 byte bursts on a 64-byte frame (the CRC catches every burst up to 16 bits)
+    long trials = quick ? 20000 : 2000000;
+    uint8_t f[80];
+    for (int mode = INTEGRITY_SUM16; mode <= INTEGRITY_CRC16; mode++)
+    {
+        message_set_integrity_mode((Integrity_Mode)mode);
+        long missed = 0;
+        for (long t = 0; t < trials; t++)
+        {
+            uint16_t len = 0;
+            f[len++] = 0xAA;
+            f[len++] = 0x55;
+            f[len++] = RESPONSE_MESSAGE;
+            f[len++] = 0;
+            f[len++] = 66;
+            memcpy(&f[len], buf, 59);
+            len = message_append_integrity(f, (uint16_t)(len + 59));
+
+            int burst = 1 + rand() % 2;
+            int pos = 5 + rand() % (len - 5 - burst);
+            for (int b = 0; b < burst; b++)
+                f[pos + b] ^= (uint8_t)(1 + rand() % 255);
+            missed += message_check_integrity(f, len);
+        }
+        printf("%s: %ld of %ld burst errors undetected\n", mode == INTEGRITY_CRC16 ? "crc16" : "sum16", missed, trials);
+        if (mode == INTEGRITY_CRC16)
+            CHECK_EQ(missed, 0);
+    }
+    return ht_summary("bench_crc");
+}
@@ -0,0 +1,115 @@
+// Receive FSM throughput and loss: frames/s, bytes/s and dropped frames per framing, check and bit error rate
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "fsm_frames.h"
+
+static uint8_t rx_buf[FSM_MAX_FRAME_SIZE];
+static uint32_t delivered, corrupted;
+
+static uint32_t rng;
+
+static uint32_t bench_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+/**
+ * @brief Payload of frame seq: [seq u32, len-4 bytes derived from seq], so receivers can check it without a copy
+ */
+static uint16_t bench_payload(uint32_t seq, uint8_t *out)
+{
+    uint16_t len = (uint16_t)(8 + (seq * 2654435761u >> 24) % 113);
+    memcpy(out, &seq, 4);
+    for (uint16_t i = 4; i < len; i++)
+        out[i] = (uint8_t)((seq * 31 + i * 7) ^ (i >> 2));
+    return len;
+}
+
+static void on_frame(const uint8_t *frame, uint16_t length)
+{
+    uint8_t expect[128];
+    uint32_t seq;
+
+    memcpy(&seq, &frame[FRAME_HEADER_SIZE], 4);
+    uint16_t len = bench_payload(seq, expect);
+    if (length == FRAME_HEADER_SIZE + len + 2 && memcmp(&frame[FRAME_HEADER_SIZE], expect, len) == 0)
+        delivered++;
+    else
+        corrupted++;
+}
+
+int main(int argc, char **argv)
+{
+    bool quick = ht_quick(argc, argv);
+    uint32_t frames = quick ? 5000 : 200000;
+    static const double bers[] = {0, 1e-5, 1e-4, 1e-3};
+    size_t cap = (size_t)frames * 300;
+    uint8_t *wire = malloc(cap);
+
+    printf("%-7s %-6s %8s %12s %10s %8s %8s\n", "framing", "check", "BER", "frames/s", "MB/s", "dropped", "bad");
+    for (int framing = FRAMING_LENGTH; framing <= FRAMING_COBS; framing++)
+    {
+        for (int check = INTEGRITY_SUM16; check <= INTEGRITY_CRC16; check++)
+        {
+            for (size_t b = 0; b < sizeof(bers) / sizeof(bers[0]); b++)
+            {
+                uint8_t payload[128], frame[160];
+                size_t len = 0;
+
+                message_set_integrity_mode((Integrity_Mode)check);
+                for (uint32_t seq = 0; seq < frames; seq++)
+                {
+                    uint16_t n = frame_build(frame, 0x01, payload, bench_payload(seq, payload));
+                    if (framing == FRAMING_COBS)
+                        len += frame_cobs_encode(frame, n, &wire[len]);
+                    else
+                    {
+                        memcpy(&wire[len], frame, n);
+                        len += n;
+                    }
+                }
+
+                // Independent bit errors at the given rate
+                rng = 0x9E3779B9u + (uint32_t)b;
+                uint32_t flips = 0;
+                if (bers[b] > 0)
+                {
+                    double bits = (double)len * 8;
+                    flips = (uint32_t)(bits * bers[b]);
+                    for (uint32_t f = 0; f < flips; f++)
+                    {
+                        size_t bit = ((size_t)bench_rand() << 16 ^ bench_rand()) % (len * 8);
+                        wire[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+                    }
+                }
+
+                fsm_set_framing((Framing_Mode)framing);
+                delivered = 0;
+                corrupted = 0;
+                double t0 = ht_now_s();
+                frames_feed(wire, len, rx_buf, on_frame);
+                double dt = ht_now_s() - t0;
+
+                printf("%-7s %-6s %8.0e %12.0f %10.1f %8u %8u\n", framing == FRAMING_COBS ? "cobs" : "length",
+                       check == INTEGRITY_CRC16 ? "crc16" : "sum16", bers[b], delivered / dt, len / dt / 1e6,
+                       frames - delivered, corrupted);
+                if (bers[b] == 0)
+                {
+                    CHECK_EQ(delivered, frames);
+                    CHECK_EQ(corrupted, 0);
+                }
+                else
+                {
+                    // A bit error costs at most the frame it hits plus the one a resync may swallow
+                    CHECK(frames - delivered <= 2 * flips);
+                }
+            }
+        }
+    }
+    free(wire);
+    return ht_summary("bench_fsm");
+}
@@ -0,0 +1,72 @@
+// Decode of the master's response_data message: cJSON_Parse + lookups against json_tokenize / json_bind
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "cJSON.h"
+#include "json_reader.h"
+
+static long allocs;
+
+static void *count_malloc(size_t n)
+{
+    allocs++;
+    return malloc(n);
+}
+
+int main(int argc, char **argv)
+{
+    const int n = ht_quick(argc, argv) ? 50000 : 1000000;
+    cJSON_Hooks hooks = {count_malloc, free};
+    cJSON_InitHooks(&hooks);
+
+    const char *js = "{\"TYPE\":\"response_data\",\"ID\":\"AA:BB:CC:DD:EE:FF\",\"DST\":\"11:22:33:44:55:66\","
+                     "\"data\":{\"temp\":25,\"humi\":60}}";
+    size_t len = strlen(js);
+    char type[24], id[18], dst[18];
+    int32_t temp = 0, humi = 0;
+    const json_field_t fields[] = {
+        {"TYPE", JSON_FIELD_STRING, true, type, sizeof(type)},
+        {"ID", JSON_FIELD_STRING, true, id, sizeof(id)},
+        {"DST", JSON_FIELD_STRING, false, dst, sizeof(dst)},
+        {"data.temp", JSON_FIELD_INT, false, &temp, 0},
+        {"data.humi", JSON_FIELD_INT, false, &humi, 0},
+    };
+    json_tok_t toks[JSON_READER_MAX_TOKENS];
+    json_read_error_t err;
+    volatile long sink = 0;
+
+    long a0 = allocs;
+    double t0 = ht_now_s();
+    for (int i = 0; i < n; i++)
+    {
+        cJSON *root = cJSON_Parse(js);
+        cJSON *data = cJSON_GetObjectItem(root, "data");
+        sink += cJSON_GetObjectItem(data, "temp")->valueint + strlen(cJSON_GetObjectItem(root, "ID")->valuestring);
+        cJSON_Delete(root);
+    }
+    double t1 = ht_now_s();
+    long cjson_allocs = allocs - a0;
+
+    a0 = allocs;
+    double t2 = ht_now_s();
+    for (int i = 0; i < n; i++)
+        sink += json_tokenize(js, len, toks, JSON_READER_MAX_TOKENS, &err);
+    double t3 = ht_now_s();
+
+    uint32_t found = 0;
+    double t4 = ht_now_s();
+    for (int i = 0; i < n; i++)
+    {
+        json_bind(js, len, fields, 5, &found, &err);
+        sink += temp + strlen(id);
+    }
+    double t5 = ht_now_s();
+
+    printf("cJSON_Parse:   %10.0f msgs/s, %.1f allocs/msg\n", n / (t1 - t0), (double)cjson_allocs / n);
+    printf("json_tokenize: %10.0f msgs/s\n", n / (t3 - t2));
+    printf("json_bind:     %10.0f msgs/s, %ld allocs\n", n / (t5 - t4), allocs - a0);
+    CHECK_EQ(allocs - a0, 0);
+    CHECK_EQ(found, 0x1F);
+    CHECK_EQ(temp, 25);
+    return ht_summary("bench_json_reader");
+}
@@ -0,0 +1,76 @@
+// Telemetry serialization: cJSON DOM + PrintUnformatted against json_writer into a stack buffer
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "cJSON.h"
+#include "json_writer.h"
+
+static long allocs;
+
+static void *count_malloc(size_t n)
+{
+    allocs++;
+    return malloc(n);
+}
+
+static char *cjson_telemetry(int lux, int temp, int humi)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "type", "telemetry");
+    cJSON *data = cJSON_CreateObject();
+    cJSON_AddNumberToObject(data, "lux", lux);
+    cJSON_AddNumberToObject(data, "temp", temp);
+    cJSON_AddNumberToObject(data, "humi", humi);
+    cJSON_AddItemToObject(root, "data", data);
+    char *s = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return s;
+}
+
+static size_t writer_telemetry(char *buf, size_t size, int lux, int temp, int humi)
+{
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "type", "telemetry");
+    json_writer_begin_object(&w, "data");
+    json_writer_int(&w, "lux", lux);
+    json_writer_int(&w, "temp", temp);
+    json_writer_int(&w, "humi", humi);
+    json_writer_end_object(&w);
+    json_writer_end_object(&w);
+    return json_writer_finish(&w);
+}
+
+int main(int argc, char **argv)
+{
+    const int n = ht_quick(argc, argv) ? 50000 : 2000000;
+    cJSON_Hooks hooks = {count_malloc, free};
+    cJSON_InitHooks(&hooks);
+
+    char buf[128];
+    volatile size_t sink = 0;
+
+    long a0 = allocs;
+    double t0 = ht_now_s();
+    for (int i = 0; i < n; i++)
+    {
+        char *s = cjson_telemetry(i & 1023, i & 63, i & 127);
+        sink += strlen(s);
+        free(s);
+    }
+    double t1 = ht_now_s();
+    long cjson_allocs = allocs - a0;
+
+    a0 = allocs;
+    double t2 = ht_now_s();
+    for (int i = 0; i < n; i++)
+        sink += writer_telemetry(buf, sizeof(buf), i & 1023, i & 63, i & 127);
+    double t3 = ht_now_s();
+
+    printf("cJSON:       %10.0f msgs/s, %.1f allocs/msg\n", n / (t1 - t0), (double)cjson_allocs / n);
+    printf("json_writer: %10.0f msgs/s, %ld allocs\n", n / (t3 - t2), allocs - a0);
+    printf("speedup x%.1f\n", (t1 - t0) / (t3 - t2));
+    CHECK_EQ(allocs - a0, 0);
+    return ht_summary("bench_json_writer");
+}
@@ -0,0 +1,48 @@
+// Cost of the hot-path metric updates and of one full render
+
+#include "host_test.h"
+#include "metrics.h"
+
+static uint32_t counter;
+static const uint32_t bounds[] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000};
+static metric_histogram_t hist = {bounds, 10};
+
+static const metric_desc_t table[] = {
+    {"c_total", "Counter", NULL, METRIC_COUNTER, .u32 = &counter},
+    {"h_us", "Histogram", NULL, METRIC_HISTOGRAM, .histogram = &hist},
+};
+
+static size_t rendered;
+
+static int write_count(void *ctx, const char *data, size_t len)
+{
+    rendered += len;
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    const long n = ht_quick(argc, argv) ? 2000000 : 100000000;
+    metrics_init(table, 2);
+
+    double t0 = ht_now_s();
+    for (long i = 0; i < n; i++)
+        metric_inc(&counter);
+    double t_inc = (ht_now_s() - t0) / n;
+
+    t0 = ht_now_s();
+    for (long i = 0; i < n; i++)
+        metric_observe(&hist, (uint32_t)i & 2047);
+    double t_obs = (ht_now_s() - t0) / n;
+
+    const long renders = n / 1000;
+    t0 = ht_now_s();
+    for (long i = 0; i < renders; i++)
+        metrics_render(write_count, NULL);
+    double t_render = (ht_now_s() - t0) / renders;
+
+    printf("metric_inc %.2f ns, metric_observe (10 buckets) %.2f ns, render %.0f ns (%zu B)\n", t_inc * 1e9,
+           t_obs * 1e9, t_render * 1e9, rendered / renders);
+    CHECK_EQ(counter, (uint32_t)n);
+    return ht_summary("bench_metrics");
+}
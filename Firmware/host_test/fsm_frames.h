@@ -0,0 +1,83 @@
+#ifndef __FSM_FRAMES__
+#define __FSM_FRAMES__
+
+// Frame builders shared by the FSM test, fuzz driver and benchmark
+
+#include <stdint.h>
+#include <string.h>
+#include "fsm.h"
+#include "message.h"
+
+/**
+ * @brief Build a length-framed frame: AA 55 type len(LE) payload check(LE)
+ * @return total frame length
+ */
+static uint16_t frame_build(uint8_t *out, uint8_t type, const uint8_t *payload, uint16_t payload_len)
+{
+    uint16_t len = 0;
+    uint16_t total = (uint16_t)(FRAME_HEADER_SIZE + payload_len + 2);
+
+    out[len++] = START_BYTE;
+    out[len++] = START_BYTE_FOLLOW;
+    out[len++] = type;
+    out[len++] = (uint8_t)(total & 0xFF);
+    out[len++] = (uint8_t)(total >> 8);
+    memcpy(&out[len], payload, payload_len);
+    len += payload_len;
+    return message_append_integrity(out, len);
+}
+
+/**
+ * @brief COBS-encode a frame and append the delimiter, same output as uart_send_frame
+ * @return encoded length
+ */
+static uint16_t frame_cobs_encode(const uint8_t *frame, uint16_t length, uint8_t *out)
+{
+    uint16_t o = 0;
+    uint16_t start = 0;
+
+    while (1)
+    {
+        uint16_t end = start;
+        while (end < length && frame[end] != COBS_DELIMITER && end - start < 254)
+        {
+            end++;
+        }
+
+        uint8_t code = (uint8_t)(end - start + 1);
+        out[o++] = code;
+        memcpy(&out[o], &frame[start], end - start);
+        o += end - start;
+
+        if (end >= length)
+        {
+            break;
+        }
+        start = (code == 0xFF) ? end : end + 1;
+    }
+    out[o++] = COBS_DELIMITER;
+    return o;
+}
+
+/**
+ * @brief Feed a byte stream to the FSM the way the UART RX task does and hand out every frame
+ */
+static void frames_feed(const uint8_t *data, size_t len, uint8_t *rx_buf,
+                        void (*on_frame)(const uint8_t *frame, uint16_t length))
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uint16_t frame_len;
+        fsm_get_message(data[i], rx_buf);
+        while (Is_Message(&frame_len))
+        {
+            on_frame(rx_buf, frame_len);
+            if (fsm_replay_pending())
+            {
+                fsm_replay(rx_buf);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,107 @@
+// Fuzz target for the CBOR decoder and the JSON bridge
+//   libFuzzer: target fuzz_cbor_libfuzzer, otherwise fuzz_cbor [--quick] [corpus...] (host_fuzz.h)
+//
+// Input: byte 0 picks the output buffer size and the key dictionary, the rest is CBOR. The pull reader must stay
+// inside the input. When cbor_to_json() succeeds the JSON must be valid, re-encode with cbor_from_json() and
+// decode again to the same text (one round trip normalizes floats and indefinite lengths).
+
+#include <stdlib.h>
+#include "host_fuzz.h"
+#include "cbor.h"
+
+static const char *const keys[] = {"type", "data", "batch", "dt", "age_ms", "node", "lux", "temp", "humi", "seq"};
+static const cbor_key_dict_t dict = {keys, sizeof(keys) / sizeof(keys[0])};
+static uint32_t fuzz_decoded, fuzz_items;
+
+static void fuzz_fail(const char *what, const char *json)
+{
+    fprintf(stderr, "fuzz_cbor: %s\n  json: %s\n", what, json ? json : "");
+    abort();
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static char js[2048], js2[2048];
+    static uint8_t cbor[2048];
+    static json_tok_t toks[512];
+
+    if (size < 1)
+        return 0;
+    const cbor_key_dict_t *d = (data[0] & 1) ? &dict : NULL;
+    size_t out_size = (data[0] & 2) ? 24 : sizeof(js);
+    data++;
+    size--;
+
+    // Pull reader over the raw bytes
+    cbor_reader_t r;
+    cbor_item_t item;
+    cbor_reader_init(&r, data, size);
+    while (cbor_reader_next(&r, &item))
+    {
+        fuzz_items++;
+        if (r.pos > size)
+            fuzz_fail("reader past the end of the input", NULL);
+        if ((item.type == CBOR_ITEM_TEXT || item.type == CBOR_ITEM_BYTES) &&
+            (item.data < data || item.data + item.len > data + size))
+            fuzz_fail("string outside the input", NULL);
+    }
+
+    json_writer_t w;
+    cbor_read_status_t st;
+    json_writer_init(&w, js, out_size);
+    size_t n = cbor_to_json(data, size, d, &w, &st);
+    if (n == 0)
+        return 0;
+    fuzz_decoded++;
+    if (n != strlen(js) || n >= out_size)
+        fuzz_fail("length differs from the text", js);
+
+    // CBOR nests deeper (CBOR_MAX_DEPTH) than json_reader reads (JSON_READER_MAX_DEPTH), the bridge only goes
+    // JSON -> CBOR for the gateway's own shallow documents
+    json_read_error_t err;
+    if (json_tokenize(js, n, toks, 512, &err) < 0)
+    {
+        if (err.status != JSON_READ_ERR_DEPTH && err.status != JSON_READ_ERR_TOKENS)
+            fuzz_fail("decoded JSON does not tokenize", js);
+        return 0;
+    }
+
+    // Normalize once, then it must be a fixed point
+    cbor_writer_t cw;
+    cbor_writer_init(&cw, cbor, sizeof(cbor));
+    size_t cn = cbor_from_json(js, n, toks, 512, d, &cw, &err);
+    if (cn == 0)
+    {
+        // \u0000 in a decoded text string is the one thing the bridge refuses on the way back
+        if (strstr(js, "\\u0000") == NULL)
+            fuzz_fail("decoded JSON does not re-encode", js);
+        return 0;
+    }
+    json_writer_init(&w, js2, sizeof(js2));
+    size_t n2 = cbor_to_json(cbor, cn, d, &w, &st);
+    if (n2 == 0)
+        fuzz_fail("re-encoded CBOR does not decode", js);
+
+    static char js3[2048];
+    cbor_writer_init(&cw, cbor, sizeof(cbor));
+    cn = cbor_from_json(js2, n2, toks, 512, d, &cw, &err);
+    json_writer_init(&w, js3, sizeof(js3));
+    if (cn == 0 || cbor_to_json(cbor, cn, d, &w, &st) == 0 || strcmp(js2, js3) != 0)
+        fuzz_fail("round trip not stable", js2);
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+int main(int argc, char **argv)
+{
+    // Heads: indefinite map / array, break, text, float16/32/64, tag, dictionary key
+    static const char *const dict_tokens[] = {"\xbf", "\x9f", "\xff", "\x64type", "\xf9\x3c\x01", "\xfa\x47\xc3\x50\x01",
+                                              "\xfb\x3f\xf1\x99\x99\x99\x99\x99\x9a", "\xc1", "\x1b\xff\xff\xff\xff",
+                                              "\x3b\x7f\xff\xff\xff", "\xa1\x05\x18\x20", "\x7f\x61\x61\xff"};
+    host_fuzz_run(argc, argv, "fuzz_cbor", dict_tokens, sizeof(dict_tokens) / sizeof(dict_tokens[0]));
+    printf("fuzz_cbor: %lu items read, %lu documents decoded\n", (unsigned long)fuzz_items,
+           (unsigned long)fuzz_decoded);
+    CHECK(fuzz_decoded > 0);
+    return ht_summary("fuzz_cbor");
+}
+#endif
@@ -0,0 +1,256 @@
+// Fuzz target for the receive FSM
+//   libFuzzer: clang -fsanitize=fuzzer,address -DFUZZ_LIBFUZZER ... (target fuzz_fsm_libfuzzer)
+//   otherwise: fuzz_fsm [--quick] [corpus files or dirs...] replays the corpus then runs a seeded mutation loop
+//
+// Input: byte 0 picks the framing (bit 0) and the integrity check of the sentinel frame (bit 1), the rest is
+// the line. Every accepted frame must be well formed, and after the line has gone quiet the FSM must be idle
+// and accept a clean frame.
+
+#include <stdlib.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "host_test.h"
+#include "fsm_frames.h"
+
+static uint8_t rx_buf[FSM_MAX_FRAME_SIZE];
+static Framing_Mode fuzz_framing;
+static uint32_t fuzz_frames;
+static const uint8_t *fuzz_sentinel;
+static uint16_t fuzz_sentinel_len;
+static bool fuzz_sentinel_seen;
+
+static void fuzz_fail(const char *what)
+{
+    fprintf(stderr, "fuzz_fsm: %s\n", what);
+    abort();
+}
+
+static void on_frame(const uint8_t *frame, uint16_t length)
+{
+    fuzz_frames++;
+    if (length < FRAME_MIN_LENGTH || length > FSM_MAX_FRAME_SIZE)
+        fuzz_fail("accepted frame length out of range");
+    if (frame[0] != START_BYTE || frame[1] != START_BYTE_FOLLOW)
+        fuzz_fail("accepted frame without start bytes");
+    if (math.convert.bytes_to_uint16(frame[3], frame[4]) != length)
+        fuzz_fail("accepted frame length differs from its header");
+    if (!message_check_integrity(frame, length))
+        fuzz_fail("accepted frame fails its integrity check");
+    if (fuzz_sentinel && length == fuzz_sentinel_len && memcmp(frame, fuzz_sentinel, length) == 0)
+        fuzz_sentinel_seen = true;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size < 1)
+        return 0;
+
+    fuzz_framing = (data[0] & 1) ? FRAMING_COBS : FRAMING_LENGTH;
+    fsm_set_framing(fuzz_framing);
+    fuzz_sentinel = NULL;
+    frames_feed(data + 1, size - 1, rx_buf, on_frame);
+    if (fsm_replay_pending() > FSM_MAX_FRAME_SIZE)
+        fuzz_fail("replay queue larger than one frame");
+
+    // Quiet line: a delimiter ends any COBS frame, zero bytes (never START_BYTE) run out any length frame
+    uint8_t quiet[FSM_MAX_FRAME_SIZE];
+    memset(quiet, 0, sizeof(quiet));
+    for (int pass = 0; pass < 4 && (pass == 0 || fsm_replay_pending()); pass++)
+        frames_feed(quiet, fuzz_framing == FRAMING_COBS ? 1 : sizeof(quiet), rx_buf, on_frame);
+    if (fsm_replay_pending())
+        fuzz_fail("replay queue not drained by a quiet line");
+
+    static const uint8_t payload[] = {0x5A, 0x00, 0xA5, 0x01};
+    uint8_t frame[32], wire[64];
+    message_set_integrity_mode((data[0] & 2) ? INTEGRITY_CRC16 : INTEGRITY_SUM16);
+    fuzz_sentinel_len = frame_build(frame, 0x01, payload, sizeof(payload));
+    fuzz_sentinel = frame;
+    fuzz_sentinel_seen = false;
+    if (fuzz_framing == FRAMING_COBS)
+        frames_feed(wire, frame_cobs_encode(frame, fuzz_sentinel_len, wire), rx_buf, on_frame);
+    else
+        frames_feed(frame, fuzz_sentinel_len, rx_buf, on_frame);
+    if (!fuzz_sentinel_seen)
+        fuzz_fail("clean frame after a quiet line was not accepted");
+    fuzz_sentinel = NULL;
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+#define FUZZ_MAX_INPUT 1024
+
+static uint32_t rng = 0x12345678;
+
+static uint32_t fuzz_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static uint8_t corpus[64][FUZZ_MAX_INPUT];
+static size_t corpus_len[64];
+static int corpus_count;
+
+static void corpus_load_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f || corpus_count >= 64)
+    {
+        if (f)
+            fclose(f);
+        return;
+    }
+    corpus_len[corpus_count] = fread(corpus[corpus_count], 1, FUZZ_MAX_INPUT, f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(corpus[corpus_count], corpus_len[corpus_count]);
+    corpus_count++;
+}
+
+static void corpus_load(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return;
+    if (!S_ISDIR(st.st_mode))
+    {
+        corpus_load_file(path);
+        return;
+    }
+
+    DIR *dir = opendir(path);
+    struct dirent *e;
+    while (dir && (e = readdir(dir)) != NULL)
+    {
+        if (e->d_name[0] == '.')
+            continue;
+        char file[512];
+        snprintf(file, sizeof(file), "%s/%s", path, e->d_name);
+        corpus_load_file(file);
+    }
+    if (dir)
+        closedir(dir);
+}
+
+/**
+ * @brief Flip, insert, delete, splice or overwrite a few bytes, or stitch in valid frames
+ */
+static size_t fuzz_mutate(uint8_t *buf, size_t len)
+{
+    int edits = 1 + fuzz_rand() % 8;
+    for (int e = 0; e < edits; e++)
+    {
+        size_t pos = len ? fuzz_rand() % len : 0;
+        switch (fuzz_rand() % 7)
+        {
+        case 0:
+            if (len)
+                buf[pos] ^= (uint8_t)(1u << (fuzz_rand() % 8));
+            break;
+        case 1:
+            if (len < FUZZ_MAX_INPUT)
+            {
+                memmove(&buf[pos + 1], &buf[pos], len - pos);
+                buf[pos] = (fuzz_rand() & 1) ? START_BYTE : (uint8_t)fuzz_rand();
+                len++;
+            }
+            break;
+        case 2:
+            if (len > 1)
+            {
+                memmove(&buf[pos], &buf[pos + 1], len - pos - 1);
+                len--;
+            }
+            break;
+        case 3:
+            if (len)
+                buf[pos] = (uint8_t)fuzz_rand();
+            break;
+        case 4:
+        {
+            // Splice a piece of another corpus entry
+            int other = fuzz_rand() % corpus_count;
+            size_t n = corpus_len[other] ? fuzz_rand() % corpus_len[other] : 0;
+            if (len + n <= FUZZ_MAX_INPUT)
+            {
+                memmove(&buf[pos + n], &buf[pos], len - pos);
+                memcpy(&buf[pos], corpus[other], n);
+                len += n;
+            }
+            break;
+        }
+        case 5:
+        {
+            // A valid frame, so mutations reach past the integrity check
+            uint8_t payload[96], frame[128], wire[160];
+            uint16_t pl = fuzz_rand() % sizeof(payload);
+            for (uint16_t i = 0; i < pl; i++)
+                payload[i] = (uint8_t)fuzz_rand();
+            message_set_integrity_mode((fuzz_rand() & 1) ? INTEGRITY_CRC16 : INTEGRITY_SUM16);
+            uint16_t n = frame_build(frame, (uint8_t)fuzz_rand(), payload, pl);
+            const uint8_t *src = frame;
+            if (len && (buf[0] & 1))
+            {
+                n = frame_cobs_encode(frame, n, wire);
+                src = wire;
+            }
+            if (len + n <= FUZZ_MAX_INPUT)
+            {
+                memmove(&buf[pos + n], &buf[pos], len - pos);
+                memcpy(&buf[pos], src, n);
+                len += n;
+            }
+            break;
+        }
+        default:
+            // Length field of a frame start: small, large and just past the limit
+            if (len >= 5 && pos + 4 < len)
+            {
+                static const uint16_t lengths[] = {0, 6, 7, 8, 60, 199, 200, 201, 0xFFFF};
+                uint16_t l = lengths[fuzz_rand() % (sizeof(lengths) / sizeof(lengths[0]))];
+                buf[pos] = START_BYTE;
+                buf[pos + 1] = START_BYTE_FOLLOW;
+                buf[pos + 3] = (uint8_t)(l & 0xFF);
+                buf[pos + 4] = (uint8_t)(l >> 8);
+            }
+            break;
+        }
+    }
+    return len;
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = ht_quick(argc, argv) ? 20000 : 2000000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+            corpus_load(argv[i]);
+    }
+    if (corpus_count == 0)
+    {
+        corpus[0][0] = 0;
+        corpus_len[0] = 1;
+        corpus_count = 1;
+    }
+    printf("fuzz_fsm: %d corpus inputs replayed\n", corpus_count);
+
+    static uint8_t input[FUZZ_MAX_INPUT];
+    uint32_t frames = 0;
+    for (long it = 0; it < iterations; it++)
+    {
+        int seed = fuzz_rand() % corpus_count;
+        memcpy(input, corpus[seed], corpus_len[seed]);
+        size_t len = fuzz_mutate(input, corpus_len[seed]);
+        fuzz_frames = 0;
+        LLVMFuzzerTestOneInput(input, len);
+        frames += fuzz_frames;
+    }
+    printf("fuzz_fsm: %ld mutated inputs, %lu frames accepted, %lu integrity errors\n", iterations,
+           (unsigned long)frames, (unsigned long)fsm_integrity_error_count);
+    CHECK(frames > 0);
+    return ht_summary("fuzz_fsm");
+}
+#endif
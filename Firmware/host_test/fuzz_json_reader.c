@@ -0,0 +1,163 @@
+// Fuzz target for json_reader
+//   libFuzzer: target fuzz_json_reader_libfuzzer, otherwise fuzz_json_reader [--quick] [corpus...] (host_fuzz.h)
+//
+// Input: the JSON text, not terminated. Tokens must stay inside the input and nest properly, errors must point
+// inside it. The tokenizer is stricter than cJSON, so whatever it accepts cJSON must accept too (except lone
+// surrogate / \u0000 escapes, which RFC 8259 allows in the grammar and json_tok_copy_string() refuses), and the
+// string and integer members of an accepted root object must read the same as through cJSON.
+
+#include <stdlib.h>
+#include "host_fuzz.h"
+#include "cJSON.h"
+#include "json_reader.h"
+
+static uint32_t fuzz_accepted, fuzz_rejected, fuzz_members, fuzz_bound;
+
+static void fuzz_fail(const char *what, const uint8_t *data, size_t size)
+{
+    fprintf(stderr, "fuzz_json_reader: %s\n  input: %.*s\n", what, (int)size, (const char *)data);
+    abort();
+}
+
+/**
+ * @brief Some string token holds an escape cJSON cannot decode either
+ */
+static bool fuzz_has_bad_escape(const char *js, size_t size, const json_tok_t *toks, int n)
+{
+    char *out = malloc(size + 1);
+    bool bad = false;
+    for (int i = 0; i < n && !bad; i++)
+        bad = toks[i].type == JSON_TOK_STRING && !json_tok_copy_string(js, &toks[i], out, (uint16_t)(size + 1));
+    free(out);
+    return bad;
+}
+
+/**
+ * @brief Compare every string / integer member of the root object with cJSON (first occurrence of each key)
+ */
+static void fuzz_compare_members(const char *js, const json_tok_t *toks, const cJSON *root, const uint8_t *data,
+                                 size_t size)
+{
+    char key[64], str[128];
+    uint16_t i = 1;
+    for (uint16_t m = 0; m < toks[0].size; m++)
+    {
+        const json_tok_t *k = &toks[i];
+        const json_tok_t *v = &toks[i + 1];
+        i = v->next;
+        if (!json_tok_copy_string(js, k, key, sizeof(key)))
+            continue;
+
+        // Only the first member of that name, like cJSON_GetObjectItemCaseSensitive (an earlier key that does
+        // not copy, e.g. with \u0000, may be the same name for cJSON)
+        bool first = true;
+        for (uint16_t j = 1; j < (uint16_t)(k - toks); j = toks[j + 1].next)
+        {
+            char other[64];
+            if (!json_tok_copy_string(js, &toks[j], other, sizeof(other)) || strcmp(other, key) == 0)
+                first = false;
+        }
+        const cJSON *item = cJSON_GetObjectItemCaseSensitive(root, key);
+        if (!first || !item)
+            continue;
+
+        if (v->type == JSON_TOK_STRING && json_tok_copy_string(js, v, str, sizeof(str)))
+        {
+            if (!cJSON_IsString(item) || strcmp(item->valuestring, str) != 0)
+                fuzz_fail("string member differs from cJSON", data, size);
+            fuzz_members++;
+        }
+        int32_t n;
+        if (v->type == JSON_TOK_PRIMITIVE && json_tok_to_int(js, v, &n))
+        {
+            if (!cJSON_IsNumber(item) || item->valueint != n)
+                fuzz_fail("integer member differs from cJSON valueint", data, size);
+            fuzz_members++;
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    const char *js = (const char *)data;
+    json_tok_t toks[JSON_READER_MAX_TOKENS];
+    json_read_error_t err;
+
+    int n = json_tokenize(js, size, toks, JSON_READER_MAX_TOKENS, &err);
+    if (n > 0)
+    {
+        fuzz_accepted++;
+        for (int i = 0; i < n; i++)
+        {
+            if (toks[i].start > toks[i].end || toks[i].end > size || toks[i].next <= i || toks[i].next > n)
+                fuzz_fail("token out of range", data, size);
+        }
+        if (toks[0].next != n)
+            fuzz_fail("root token does not span the document", data, size);
+    }
+    else
+    {
+        fuzz_rejected++;
+        if (n != -1 || err.pos > size)
+            fuzz_fail("error position outside the input", data, size);
+    }
+
+    // cJSON needs a terminated copy, and stops at an embedded NUL
+    if (n > 0 && memchr(data, '\0', size) == NULL)
+    {
+        char *z = malloc(size + 1);
+        memcpy(z, data, size);
+        z[size] = '\0';
+        cJSON *root = cJSON_ParseWithOpts(z, NULL, 1);
+        if (!root && !fuzz_has_bad_escape(js, size, toks, n))
+            fuzz_fail("accepted by json_tokenize, rejected by cJSON", data, size);
+        if (root && toks[0].type == JSON_TOK_OBJECT)
+            fuzz_compare_members(js, toks, root, data, size);
+        cJSON_Delete(root);
+        free(z);
+    }
+
+    // The schemas the firmware binds: strings must come back terminated inside their buffer
+    char type[16], plug[8];
+    int32_t temp;
+    bool on;
+    uint32_t found;
+    memset(type, 'X', sizeof(type));
+    memset(plug, 'X', sizeof(plug));
+    const json_field_t fields[] = {
+        {"type", JSON_FIELD_STRING, false, type, sizeof(type)},
+        {"data.plug", JSON_FIELD_STRING, false, plug, sizeof(plug)},
+        {"data.temp", JSON_FIELD_INT, false, &temp, 0},
+        {"data.x", JSON_FIELD_BOOL, false, &on, 0},
+    };
+    if (json_bind(js, size, fields, 4, &found, &err))
+    {
+        if (((found & 1) && memchr(type, '\0', sizeof(type)) == NULL) ||
+            ((found & 2) && memchr(plug, '\0', sizeof(plug)) == NULL))
+            fuzz_fail("bound string not terminated", data, size);
+        fuzz_bound += found != 0;
+    }
+    else if (err.pos > size)
+    {
+        fuzz_fail("bind error position outside the input", data, size);
+    }
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+int main(int argc, char **argv)
+{
+    static const char *const dict[] = {"{", "}", "[", "]", "\"", ",", ":", "\\", "\\u00e9", "\\ud83d\\ude00",
+                                       "\\ud800", "\\u0000", "true", "false", "null", "-0", "1e40", "-2147483649",
+                                       "0.5e-3", "\"type\":", "\"data\":{", "\"plug\":\"plug_1\"", "\"temp\":25"};
+    host_fuzz_run(argc, argv, "fuzz_json_reader", dict, sizeof(dict) / sizeof(dict[0]));
+    printf("fuzz_json_reader: %lu accepted, %lu rejected, %lu members compared with cJSON, %lu binds\n",
+           (unsigned long)fuzz_accepted, (unsigned long)fuzz_rejected, (unsigned long)fuzz_members,
+           (unsigned long)fuzz_bound);
+    CHECK(fuzz_accepted > 0);
+    CHECK(fuzz_rejected > 0);
+    CHECK(fuzz_members > 0);
+    CHECK(fuzz_bound > 0);
+    return ht_summary("fuzz_json_reader");
+}
+#endif
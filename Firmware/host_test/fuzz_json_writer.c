@@ -0,0 +1,191 @@
+// Fuzz target for json_writer
+//   libFuzzer: target fuzz_json_writer_libfuzzer, otherwise fuzz_json_writer [--quick] [corpus...] (host_fuzz.h)
+//
+// Input: 2 bytes of buffer size, then a program of writer calls (op byte, then its key / value bytes). The same
+// document is built with cJSON: when json_writer_finish() succeeds the text must equal cJSON_PrintUnformatted(),
+// and it must fail exactly when that text does not fit. The output buffer is an exact-size heap block.
+
+#include <stdlib.h>
+#include "host_fuzz.h"
+#include "cJSON.h"
+#include "json_writer.h"
+
+#define FUZZ_JW_MAX_NESTING (JSON_WRITER_MAX_DEPTH - 2)
+
+static uint32_t fuzz_fit, fuzz_overflow;
+
+static void fuzz_fail(const char *what, const char *got, const char *want)
+{
+    fprintf(stderr, "fuzz_json_writer: %s\n  got:  %s\n  want: %s\n", what, got ? got : "", want ? want : "");
+    abort();
+}
+
+typedef struct
+{
+    const uint8_t *p;
+    const uint8_t *end;
+} fuzz_input_t;
+
+static uint8_t fuzz_byte(fuzz_input_t *in)
+{
+    return in->p < in->end ? *in->p++ : 0;
+}
+
+/**
+ * @brief Length byte then that many bytes, NUL mapped to 0x01 (cJSON strings stop at NUL)
+ */
+static void fuzz_str(fuzz_input_t *in, char *out)
+{
+    uint8_t n = fuzz_byte(in) % 24;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        uint8_t c = fuzz_byte(in);
+        out[i] = (char)(c ? c : 1);
+    }
+    out[n] = '\0';
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    fuzz_input_t in = {data, data + size};
+    size_t buf_size = 1 + (fuzz_byte(&in) | (fuzz_byte(&in) << 8)) % 600;
+    char *buf = malloc(buf_size);
+    json_writer_t w;
+    json_writer_init(&w, buf, buf_size);
+
+    cJSON *stack[FUZZ_JW_MAX_NESTING];
+    int depth = 0;
+    cJSON *root = cJSON_CreateObject();
+    json_writer_begin_object(&w, NULL);
+    stack[depth++] = root;
+
+    char key[32], str[32];
+    while (in.p < in.end)
+    {
+        cJSON *top = stack[depth - 1];
+        bool in_object = cJSON_IsObject(top);
+        uint8_t op = fuzz_byte(&in) % 9;
+        if (in_object)
+            fuzz_str(&in, key);
+        const char *k = in_object ? key : NULL;
+        cJSON *item = NULL;
+
+        switch (op)
+        {
+        case 0:
+        case 1:
+            if (depth >= FUZZ_JW_MAX_NESTING)
+                break;
+            item = op == 0 ? cJSON_CreateObject() : cJSON_CreateArray();
+            if (op == 0)
+                json_writer_begin_object(&w, k);
+            else
+                json_writer_begin_array(&w, k);
+            break;
+        case 2:
+            if (depth > 1)
+            {
+                if (in_object)
+                    json_writer_end_object(&w);
+                else
+                    json_writer_end_array(&w);
+                depth--;
+            }
+            break;
+        case 3:
+            fuzz_str(&in, str);
+            item = cJSON_CreateString(str);
+            json_writer_string(&w, k, str);
+            break;
+        case 4:
+        {
+            int32_t v = (int32_t)((uint32_t)fuzz_byte(&in) | (uint32_t)fuzz_byte(&in) << 8 |
+                                  (uint32_t)fuzz_byte(&in) << 16 | (uint32_t)fuzz_byte(&in) << 24);
+            item = cJSON_CreateNumber(v);
+            json_writer_int(&w, k, v);
+            break;
+        }
+        case 5:
+        {
+            uint32_t v = (uint32_t)fuzz_byte(&in) << 24 | (uint32_t)fuzz_byte(&in);
+            item = cJSON_CreateNumber(v);
+            json_writer_uint(&w, k, v);
+            break;
+        }
+        case 6:
+        {
+            bool v = fuzz_byte(&in) & 1;
+            item = cJSON_CreateBool(v);
+            json_writer_bool(&w, k, v);
+            break;
+        }
+        case 7:
+            item = cJSON_CreateNull();
+            json_writer_null(&w, k);
+            break;
+        default:
+            item = cJSON_CreateRaw("[1,\"r\"]");
+            json_writer_raw(&w, k, "[1,\"r\"]");
+            break;
+        }
+
+        if (item)
+        {
+            if (in_object)
+                cJSON_AddItemToObject(top, k, item);
+            else
+                cJSON_AddItemToArray(top, item);
+            if (op <= 1)
+                stack[depth++] = item;
+        }
+    }
+    while (depth > 1)
+    {
+        if (cJSON_IsObject(stack[--depth]))
+            json_writer_end_object(&w);
+        else
+            json_writer_end_array(&w);
+    }
+    json_writer_end_object(&w);
+
+    size_t len = json_writer_finish(&w);
+    char *want = cJSON_PrintUnformatted(root);
+    size_t want_len = strlen(want);
+    if (memchr(buf, '\0', buf_size) == NULL)
+        fuzz_fail("output not terminated", NULL, want);
+    if (want_len < buf_size)
+    {
+        if (len != want_len || strcmp(buf, want) != 0)
+            fuzz_fail("output differs from cJSON", buf, want);
+        fuzz_fit++;
+    }
+    else if (len != 0)
+    {
+        fuzz_fail("finish() succeeded on a document larger than the buffer", buf, want);
+    }
+    else
+    {
+        fuzz_overflow++;
+    }
+
+    free(want);
+    cJSON_Delete(root);
+    free(buf);
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+int main(int argc, char **argv)
+{
+    // Op bytes are taken mod 9: 9 object, 1 array, 2 close, 3 string, 4 int, 5 uint (no NUL, the tokens are C strings)
+    static const char *const dict[] = {"\x09\x02" "ab", "\x01\x01k", "\x02", "\x03\x05quote\"\\\n",
+                                       "\x04\xff\xff\xff\x7f", "\x04\x01\x01\x01\x80", "\x05\xff\xff",
+                                       "\x03\x04\x1f\x7f\xc3\xa9"};
+    host_fuzz_run(argc, argv, "fuzz_json_writer", dict, sizeof(dict) / sizeof(dict[0]));
+    printf("fuzz_json_writer: %lu documents matched cJSON, %lu overflowed\n", (unsigned long)fuzz_fit,
+           (unsigned long)fuzz_overflow);
+    CHECK(fuzz_fit > 0);
+    CHECK(fuzz_overflow > 0);
+    return ht_summary("fuzz_json_writer");
+}
+#endif
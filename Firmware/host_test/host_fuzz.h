@@ -0,0 +1,172 @@
+#ifndef __HOST_FUZZ__
+#define __HOST_FUZZ__
+
+// Standalone driver for the text-input fuzz targets when libFuzzer is not available (gcc builds):
+//   fuzz_<target> [--quick] [corpus files or dirs...]
+// replays the corpus, then runs a seeded mutation loop (byte edits, splices and dictionary tokens). The target's
+// main() calls host_fuzz_run(), then checks its own counters so ctest sees that the oracles were reached.
+// With -DFUZZ_LIBFUZZER the header only declares the entry point and libFuzzer brings main().
+
+#include <stdlib.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "host_test.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#ifndef FUZZ_LIBFUZZER
+#define HOST_FUZZ_MAX_INPUT 1024
+#define HOST_FUZZ_MAX_CORPUS 64
+
+static uint32_t host_fuzz_rng = 0x12345678;
+static uint8_t host_fuzz_corpus[HOST_FUZZ_MAX_CORPUS][HOST_FUZZ_MAX_INPUT];
+static size_t host_fuzz_corpus_len[HOST_FUZZ_MAX_CORPUS];
+static int host_fuzz_corpus_count;
+
+static uint32_t host_fuzz_rand(void)
+{
+    host_fuzz_rng ^= host_fuzz_rng << 13;
+    host_fuzz_rng ^= host_fuzz_rng >> 17;
+    host_fuzz_rng ^= host_fuzz_rng << 5;
+    return host_fuzz_rng;
+}
+
+static void host_fuzz_load_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f || host_fuzz_corpus_count >= HOST_FUZZ_MAX_CORPUS)
+    {
+        if (f)
+            fclose(f);
+        return;
+    }
+    int i = host_fuzz_corpus_count++;
+    host_fuzz_corpus_len[i] = fread(host_fuzz_corpus[i], 1, HOST_FUZZ_MAX_INPUT, f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(host_fuzz_corpus[i], host_fuzz_corpus_len[i]);
+}
+
+static void host_fuzz_load(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return;
+    if (!S_ISDIR(st.st_mode))
+    {
+        host_fuzz_load_file(path);
+        return;
+    }
+
+    DIR *dir = opendir(path);
+    struct dirent *e;
+    while (dir && (e = readdir(dir)) != NULL)
+    {
+        if (e->d_name[0] == '.')
+            continue;
+        char file[512];
+        snprintf(file, sizeof(file), "%s/%s", path, e->d_name);
+        host_fuzz_load_file(file);
+    }
+    if (dir)
+        closedir(dir);
+}
+
+static size_t host_fuzz_insert(uint8_t *buf, size_t len, size_t pos, const void *src, size_t n)
+{
+    if (len + n > HOST_FUZZ_MAX_INPUT)
+        return len;
+    memmove(&buf[pos + n], &buf[pos], len - pos);
+    memcpy(&buf[pos], src, n);
+    return len + n;
+}
+
+/**
+ * @brief Flip, insert, delete, overwrite, splice another corpus entry or insert a dictionary token
+ */
+static size_t host_fuzz_mutate(uint8_t *buf, size_t len, const char *const *dict, size_t dict_count)
+{
+    int edits = 1 + host_fuzz_rand() % 6;
+    for (int e = 0; e < edits; e++)
+    {
+        size_t pos = len ? host_fuzz_rand() % len : 0;
+        switch (host_fuzz_rand() % 6)
+        {
+        case 0:
+            if (len)
+                buf[pos] ^= (uint8_t)(1u << (host_fuzz_rand() % 8));
+            break;
+        case 1:
+        {
+            uint8_t c = (uint8_t)host_fuzz_rand();
+            len = host_fuzz_insert(buf, len, pos, &c, 1);
+            break;
+        }
+        case 2:
+            if (len > 1)
+            {
+                size_t n = 1 + host_fuzz_rand() % 4;
+                n = n < len - pos ? n : len - pos;
+                memmove(&buf[pos], &buf[pos + n], len - pos - n);
+                len -= n;
+            }
+            break;
+        case 3:
+            if (len)
+                buf[pos] = (uint8_t)host_fuzz_rand();
+            break;
+        case 4:
+        {
+            int other = host_fuzz_rand() % host_fuzz_corpus_count;
+            size_t start = host_fuzz_corpus_len[other] ? host_fuzz_rand() % host_fuzz_corpus_len[other] : 0;
+            size_t n = host_fuzz_rand() % (host_fuzz_corpus_len[other] - start + 1);
+            len = host_fuzz_insert(buf, len, pos, &host_fuzz_corpus[other][start], n);
+            break;
+        }
+        default:
+            if (dict_count)
+            {
+                const char *tok = dict[host_fuzz_rand() % dict_count];
+                len = host_fuzz_insert(buf, len, pos, tok, strlen(tok));
+            }
+            break;
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Corpus replay and mutation loop, 20000 inputs with --quick and 1000000 otherwise
+ */
+static void host_fuzz_run(int argc, char **argv, const char *name, const char *const *dict, size_t dict_count)
+{
+    long iterations = ht_quick(argc, argv) ? 20000 : 1000000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+            host_fuzz_load(argv[i]);
+    }
+    if (host_fuzz_corpus_count == 0)
+    {
+        host_fuzz_corpus_len[0] = 0;
+        host_fuzz_corpus_count = 1;
+    }
+    printf("%s: %d corpus inputs replayed\n", name, host_fuzz_corpus_count);
+
+    // Exact-size heap copy, so ASan catches any read past the end of the input
+    static uint8_t input[HOST_FUZZ_MAX_INPUT];
+    for (long it = 0; it < iterations; it++)
+    {
+        int seed = host_fuzz_rand() % host_fuzz_corpus_count;
+        memcpy(input, host_fuzz_corpus[seed], host_fuzz_corpus_len[seed]);
+        size_t len = host_fuzz_mutate(input, host_fuzz_corpus_len[seed], dict, dict_count);
+        uint8_t *data = malloc(len ? len : 1);
+        memcpy(data, input, len);
+        LLVMFuzzerTestOneInput(data, len);
+        free(data);
+    }
+    printf("%s: %ld mutated inputs\n", name, iterations);
+}
+#endif // FUZZ_LIBFUZZER
+
+#endif
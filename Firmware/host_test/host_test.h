@@ -0,0 +1,73 @@
+#ifndef __HOST_TEST__
+#define __HOST_TEST__
+
+// Minimal check/timing helpers shared by the host tests and benchmarks (no framework needed)
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+static int ht_checks;
+static int ht_failures;
+
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        ht_checks++;                                                         \
+        if (!(cond))                                                         \
+        {                                                                    \
+            ht_failures++;                                                   \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);  \
+        }                                                                    \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                       \
+    do                                                                       \
+    {                                                                        \
+        long long ht_a = (long long)(a), ht_b = (long long)(b);              \
+        ht_checks++;                                                         \
+        if (ht_a != ht_b)                                                    \
+        {                                                                    \
+            ht_failures++;                                                   \
+            printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n",         \
+                   __FILE__, __LINE__, #a, #b, ht_a, ht_b);                  \
+        }                                                                    \
+    } while (0)
+
+#define CHECK_MEM(a, b, n) CHECK(memcmp((a), (b), (n)) == 0)
+
+/**
+ * @brief Monotonic time in seconds, for the benchmarks
+ */
+static inline double ht_now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Benchmarks run a short pass under ctest (--quick) and the full one by hand
+ */
+static inline bool ht_quick(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Print the result line and return the process exit code
+ */
+static inline int ht_summary(const char *name)
+{
+    printf("[%s] %d checks, %d failed\n", name, ht_checks, ht_failures);
+    return ht_failures ? 1 : 0;
+}
+
+#endif
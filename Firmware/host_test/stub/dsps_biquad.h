@@ -0,0 +1,15 @@
+#pragma once
+// Host stand-in for esp-dsp dsps_biquad.h: the ANSI C direct form II of dsps_biquad_f32_ansi
+#include "esp_err.h"
+
+static inline esp_err_t dsps_biquad_f32(const float *input, float *output, int len, float *coef, float *w)
+{
+    for (int i = 0; i < len; i++)
+    {
+        float d0 = input[i] - coef[3] * w[0] - coef[4] * w[1];
+        output[i] = coef[0] * d0 + coef[1] * w[0] + coef[2] * w[1];
+        w[1] = w[0];
+        w[0] = d0;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,24 @@
+#pragma once
+// Host stand-in for esp-dsp dsps_biquad_gen.h: low-pass coefficients as dsps_biquad_gen_lpf_f32 (RBJ cookbook)
+#include <math.h>
+#include "esp_err.h"
+
+static inline esp_err_t dsps_biquad_gen_lpf_f32(float *coeffs, float f, float qFactor)
+{
+    if (qFactor <= 0.0001f)
+    {
+        qFactor = 0.0001f;
+    }
+    float w0 = 2 * (float)M_PI * f;
+    float c = cosf(w0);
+    float s = sinf(w0);
+    float alpha = s / (2 * qFactor);
+    float a0 = 1 + alpha;
+
+    coeffs[0] = (1 - c) / 2 / a0;
+    coeffs[1] = (1 - c) / a0;
+    coeffs[2] = coeffs[0];
+    coeffs[3] = -2 * c / a0;
+    coeffs[4] = (1 - alpha) / a0;
+    return ESP_OK;
+}
@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in for esp_crt_bundle.h, faked by the test
+#include "esp_err.h"
+
+esp_err_t esp_crt_bundle_attach(void *conf);
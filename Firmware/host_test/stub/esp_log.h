@@ -0,0 +1,14 @@
+#pragma once
+// Host stand-in for esp_log.h: warnings and errors go to stderr, info/debug are compiled but not printed
+#include <stdio.h>
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOG_QUIET(tag, fmt, ...)                     \
+    do                                                   \
+    {                                                    \
+        if (0)                                           \
+            fprintf(stderr, "%s: " fmt, tag, ##__VA_ARGS__); \
+    } while (0)
+#define ESP_LOGI ESP_LOG_QUIET
+#define ESP_LOGD ESP_LOG_QUIET
+#define ESP_LOGV ESP_LOG_QUIET
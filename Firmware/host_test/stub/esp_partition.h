@@ -0,0 +1,56 @@
+#pragma once
+// Host stand-in for esp_partition.h: one data partition backed by a file, see esp_partition_file.c
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef enum
+{
+    ESP_PARTITION_TYPE_APP = 0,
+    ESP_PARTITION_TYPE_DATA = 1
+} esp_partition_type_t;
+
+typedef int esp_partition_subtype_t;
+
+typedef struct
+{
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_size;
+    char label[17];
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size);
+
+// ======================= Host only =======================
+typedef struct
+{
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t erases;
+    uint32_t sector_erases_max; // Most erased sector
+    uint32_t sector_erases_min; // Least erased sector
+    uint32_t bad_writes;        // Writes that tried to set a 0 bit back to 1 without an erase
+} esp_partition_file_stats_t;
+
+/**
+ * @brief Back the partition with a file, created erased (0xFF) if missing. Reopening the same path is a reboot.
+ */
+esp_err_t esp_partition_file_open(const char *path, const char *label, esp_partition_subtype_t subtype,
+                                  uint32_t size);
+void esp_partition_file_close(void);
+
+/**
+ * @brief Power cut: only the next budget bytes written reach the flash, -1 for no limit
+ */
+void esp_partition_file_set_write_budget(long budget);
+void esp_partition_file_get_stats(esp_partition_file_stats_t *out);
@@ -0,0 +1,173 @@
+// File-backed flash partition with NOR semantics: writes only clear bits, erases are sector aligned and set 0xFF.
+// Every write goes to the file at once, so closing and reopening the file is a power cycle.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_partition.h"
+
+#define PART_FILE_MAX_SECTORS 256
+
+static FILE *part_file;
+static esp_partition_t part_info;
+static long part_write_budget = -1;
+static esp_partition_file_stats_t part_stats;
+static uint32_t part_sector_erases[PART_FILE_MAX_SECTORS];
+
+esp_err_t esp_partition_file_open(const char *path, const char *label, esp_partition_subtype_t subtype,
+                                  uint32_t size)
+{
+    if (size % SPI_FLASH_SEC_SIZE != 0 || size / SPI_FLASH_SEC_SIZE > PART_FILE_MAX_SECTORS)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_partition_file_close();
+
+    part_file = fopen(path, "r+b");
+    if (!part_file)
+    {
+        part_file = fopen(path, "w+b");
+        if (!part_file)
+        {
+            return ESP_FAIL;
+        }
+        uint8_t erased[SPI_FLASH_SEC_SIZE];
+        memset(erased, 0xFF, sizeof(erased));
+        for (uint32_t s = 0; s < size / SPI_FLASH_SEC_SIZE; s++)
+        {
+            fwrite(erased, 1, sizeof(erased), part_file);
+        }
+        fflush(part_file);
+    }
+
+    memset(&part_info, 0, sizeof(part_info));
+    part_info.type = ESP_PARTITION_TYPE_DATA;
+    part_info.subtype = subtype;
+    part_info.size = size;
+    part_info.erase_size = SPI_FLASH_SEC_SIZE;
+    snprintf(part_info.label, sizeof(part_info.label), "%s", label);
+    part_write_budget = -1;
+    return ESP_OK;
+}
+
+void esp_partition_file_close(void)
+{
+    if (part_file)
+    {
+        fclose(part_file);
+        part_file = NULL;
+    }
+}
+
+void esp_partition_file_set_write_budget(long budget)
+{
+    part_write_budget = budget;
+}
+
+void esp_partition_file_get_stats(esp_partition_file_stats_t *out)
+{
+    uint32_t sectors = part_info.size / SPI_FLASH_SEC_SIZE;
+    *out = part_stats;
+    out->sector_erases_min = sectors ? UINT32_MAX : 0;
+    out->sector_erases_max = 0;
+    for (uint32_t s = 0; s < sectors; s++)
+    {
+        if (part_sector_erases[s] < out->sector_erases_min)
+            out->sector_erases_min = part_sector_erases[s];
+        if (part_sector_erases[s] > out->sector_erases_max)
+            out->sector_erases_max = part_sector_erases[s];
+    }
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    if (!part_file || type != part_info.type || subtype != part_info.subtype ||
+        (label && strcmp(label, part_info.label) != 0))
+    {
+        return NULL;
+    }
+    return &part_info;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size)
+{
+    if (part != &part_info || !part_file || offset + size > part_info.size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    part_stats.reads++;
+    fseek(part_file, (long)offset, SEEK_SET);
+    return fread(dst, 1, size, part_file) == size ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size)
+{
+    if (part != &part_info || !part_file || offset + size > part_info.size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    part_stats.writes++;
+
+    uint8_t *cell = malloc(size ? size : 1);
+    const uint8_t *in = src;
+    fseek(part_file, (long)offset, SEEK_SET);
+    if (fread(cell, 1, size, part_file) != size)
+    {
+        free(cell);
+        return ESP_FAIL;
+    }
+
+    size_t n = size;
+    if (part_write_budget >= 0 && (long)n > part_write_budget)
+    {
+        n = (size_t)part_write_budget;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        if (in[i] & ~cell[i])
+        {
+            part_stats.bad_writes++;
+        }
+        cell[i] &= in[i];
+    }
+    fseek(part_file, (long)offset, SEEK_SET);
+    fwrite(cell, 1, n, part_file);
+    fflush(part_file);
+    free(cell);
+
+    if (part_write_budget >= 0)
+    {
+        part_write_budget -= (long)n;
+        if (n < size)
+        {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    if (part != &part_info || !part_file || offset + size > part_info.size || offset % SPI_FLASH_SEC_SIZE != 0 ||
+        size % SPI_FLASH_SEC_SIZE != 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (part_write_budget == 0)
+    {
+        return ESP_FAIL;
+    }
+
+    uint8_t erased[SPI_FLASH_SEC_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    fseek(part_file, (long)offset, SEEK_SET);
+    for (size_t s = 0; s < size / SPI_FLASH_SEC_SIZE; s++)
+    {
+        fwrite(erased, 1, sizeof(erased), part_file);
+        part_sector_erases[offset / SPI_FLASH_SEC_SIZE + s]++;
+        part_stats.erases++;
+    }
+    fflush(part_file);
+    return ESP_OK;
+}
@@ -0,0 +1,9 @@
+#pragma once
+// Host stand-in for esp_random.h
+#include <stdint.h>
+#include <stdlib.h>
+
+static inline uint32_t esp_random(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
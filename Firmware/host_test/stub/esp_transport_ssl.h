@@ -0,0 +1,9 @@
+#pragma once
+// Host stand-in for esp_transport_ssl.h, faked by the test
+#include "mqtt_client.h"
+
+esp_transport_handle_t esp_transport_ssl_init(void);
+esp_err_t esp_transport_set_default_port(esp_transport_handle_t t, int port);
+void esp_transport_ssl_set_cert_data(esp_transport_handle_t t, const char *data, int len);
+void esp_transport_ssl_crt_bundle_attach(esp_transport_handle_t t, esp_err_t (*crt_bundle_attach)(void *conf));
+void esp_transport_ssl_session_tickets_enable(esp_transport_handle_t t);
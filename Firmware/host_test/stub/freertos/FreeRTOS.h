@@ -0,0 +1,34 @@
+#pragma once
+// Host stand-in for FreeRTOS: tasks are pthreads, see freertos_shim.c
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef struct shim_task *TaskHandle_t;
+typedef struct shim_queue *QueueHandle_t;
+typedef struct shim_queue *SemaphoreHandle_t;
+typedef struct shim_queue *StreamBufferHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 10 // Same tick as the firmware, HOST_TICK_US sets how long one lasts on the host
+#define pdMS_TO_TICKS(ms) ((TickType_t)((ms) / portTICK_PERIOD_MS))
+
+typedef struct
+{
+    int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+void shim_critical_enter(void);
+void shim_critical_exit(void);
+#define taskENTER_CRITICAL(mux) shim_critical_enter()
+#define taskEXIT_CRITICAL(mux) shim_critical_exit()
+#define portENTER_CRITICAL(mux) shim_critical_enter()
+#define portEXIT_CRITICAL(mux) shim_critical_exit()
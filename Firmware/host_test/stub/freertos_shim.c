@@ -0,0 +1,477 @@
+// pthread-backed FreeRTOS subset for the host tests
+// One lock and one condition variable guard every queue, tasks re-check their condition on each wake-up.
+// A tick lasts HOST_TICK_US on the host (default 1000 us, 10x faster than the 10 ms firmware tick), so
+// timeouts of several seconds run in a fraction of that.
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+
+#ifndef HOST_TICK_US
+#define HOST_TICK_US 1000
+#endif
+
+struct shim_queue
+{
+    uint8_t *buf;
+    UBaseType_t item_size; // 0 for semaphores, 1 for stream buffers
+    UBaseType_t length;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+struct shim_task
+{
+    pthread_t thread;
+    void (*fn)(void *);
+    void *arg;
+    uint32_t notify;
+    struct shim_task *next;
+};
+
+static pthread_mutex_t shim_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t shim_cond;
+static pthread_once_t shim_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t shim_critical = PTHREAD_MUTEX_INITIALIZER;
+static struct timespec shim_start;
+static __thread struct shim_task *shim_current;
+static struct shim_task *shim_tasks; // Tasks live until the process exits
+
+static void shim_init(void)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&shim_cond, &attr);
+    clock_gettime(CLOCK_MONOTONIC, &shim_start);
+}
+
+static uint64_t shim_now_us(void)
+{
+    struct timespec ts;
+    pthread_once(&shim_once, shim_init);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)(ts.tv_sec - shim_start.tv_sec) * 1000000u + (uint64_t)(ts.tv_nsec / 1000) -
+           (uint64_t)(shim_start.tv_nsec / 1000);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(shim_now_us() / HOST_TICK_US);
+}
+
+/**
+ * @brief Wait on the shared condition until woken or the tick budget runs out (lock held)
+ * @return false once the deadline has passed
+ */
+static bool shim_wait(const struct timespec *deadline)
+{
+    if (deadline == NULL)
+    {
+        pthread_cond_wait(&shim_cond, &shim_lock);
+        return true;
+    }
+    return pthread_cond_timedwait(&shim_cond, &shim_lock, deadline) != ETIMEDOUT;
+}
+
+static const struct timespec *shim_deadline(TickType_t ticks, struct timespec *out)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, out);
+    uint64_t ns = (uint64_t)out->tv_nsec + (uint64_t)ticks * HOST_TICK_US * 1000u;
+    out->tv_sec += (time_t)(ns / 1000000000u);
+    out->tv_nsec = (long)(ns % 1000000000u);
+    return out;
+}
+
+// ======================= Tasks =======================
+static void *shim_task_entry(void *p)
+{
+    struct shim_task *task = p;
+    shim_current = task;
+    task->fn(task->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(void (*fn)(void *), const char *name, uint32_t stack, void *arg, UBaseType_t prio,
+                       TaskHandle_t *out)
+{
+    (void)name;
+    (void)stack;
+    (void)prio;
+    pthread_once(&shim_once, shim_init);
+
+    struct shim_task *task = calloc(1, sizeof(*task));
+    if (!task)
+    {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    pthread_mutex_lock(&shim_lock);
+    task->next = shim_tasks;
+    shim_tasks = task;
+    pthread_mutex_unlock(&shim_lock);
+    if (pthread_create(&task->thread, NULL, shim_task_entry, task) != 0)
+    {
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    if (out)
+    {
+        *out = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *out, BaseType_t core)
+{
+    (void)core;
+    return xTaskCreate(fn, name, stack, arg, prio, out);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // Only self-deletion ends a thread, other tasks keep running until the test exits
+    if (task == NULL || task == shim_current)
+    {
+        pthread_exit(NULL);
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (ticks == 0)
+    {
+        sched_yield();
+        return;
+    }
+    usleep((useconds_t)ticks * HOST_TICK_US);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return shim_current;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    if (!task)
+    {
+        return pdFAIL;
+    }
+    pthread_mutex_lock(&shim_lock);
+    task->notify++;
+    pthread_cond_broadcast(&shim_cond);
+    pthread_mutex_unlock(&shim_lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    struct shim_task *task = shim_current;
+    struct timespec ts;
+    const struct timespec *deadline = shim_deadline(ticks, &ts);
+    uint32_t value = 0;
+
+    if (!task)
+    {
+        vTaskDelay(ticks == portMAX_DELAY ? 1 : ticks);
+        return 0;
+    }
+    pthread_mutex_lock(&shim_lock);
+    while (task->notify == 0 && ticks != 0 && shim_wait(deadline))
+    {
+    }
+    value = task->notify;
+    if (value)
+    {
+        task->notify = clear ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&shim_lock);
+    return value;
+}
+
+void shim_critical_enter(void)
+{
+    pthread_mutex_lock(&shim_critical);
+}
+
+void shim_critical_exit(void)
+{
+    pthread_mutex_unlock(&shim_critical);
+}
+
+// ======================= Queues =======================
+static struct shim_queue *shim_queue_new(UBaseType_t length, UBaseType_t item_size)
+{
+    pthread_once(&shim_once, shim_init);
+    struct shim_queue *q = calloc(1, sizeof(*q));
+    if (!q)
+    {
+        return NULL;
+    }
+    q->length = length;
+    q->item_size = item_size;
+    if (item_size)
+    {
+        q->buf = calloc(length, item_size);
+        if (!q->buf)
+        {
+            free(q);
+            return NULL;
+        }
+    }
+    return q;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    return shim_queue_new(length, item_size);
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    if (q)
+    {
+        free(q->buf);
+        free(q);
+    }
+}
+
+static BaseType_t shim_queue_put(struct shim_queue *q, const void *item, TickType_t ticks, bool front)
+{
+    struct timespec ts;
+    const struct timespec *deadline = shim_deadline(ticks, &ts);
+    BaseType_t ok = pdFALSE;
+
+    pthread_mutex_lock(&shim_lock);
+    while (q->count >= q->length && ticks != 0 && shim_wait(deadline))
+    {
+    }
+    if (q->count < q->length)
+    {
+        if (q->item_size)
+        {
+            UBaseType_t slot;
+            if (front)
+            {
+                q->head = (q->head + q->length - 1) % q->length;
+                slot = q->head;
+            }
+            else
+            {
+                slot = (q->head + q->count) % q->length;
+            }
+            memcpy(q->buf + (size_t)slot * q->item_size, item, q->item_size);
+        }
+        q->count++;
+        ok = pdTRUE;
+        pthread_cond_broadcast(&shim_cond);
+    }
+    pthread_mutex_unlock(&shim_lock);
+    return ok;
+}
+
+static BaseType_t shim_queue_get(struct shim_queue *q, void *item, TickType_t ticks, bool remove)
+{
+    struct timespec ts;
+    const struct timespec *deadline = shim_deadline(ticks, &ts);
+    BaseType_t ok = pdFALSE;
+
+    pthread_mutex_lock(&shim_lock);
+    while (q->count == 0 && ticks != 0 && shim_wait(deadline))
+    {
+    }
+    if (q->count > 0)
+    {
+        if (q->item_size && item)
+        {
+            memcpy(item, q->buf + (size_t)q->head * q->item_size, q->item_size);
+        }
+        if (remove)
+        {
+            q->head = (q->head + 1) % q->length;
+            q->count--;
+            pthread_cond_broadcast(&shim_cond);
+        }
+        ok = pdTRUE;
+    }
+    pthread_mutex_unlock(&shim_lock);
+    return ok;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    return shim_queue_put(q, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    return shim_queue_put(q, item, ticks, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    return shim_queue_get(q, item, ticks, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    return shim_queue_get(q, item, ticks, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&shim_lock);
+    q->head = 0;
+    q->count = 0;
+    pthread_cond_broadcast(&shim_cond);
+    pthread_mutex_unlock(&shim_lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&shim_lock);
+    UBaseType_t n = q->count;
+    pthread_mutex_unlock(&shim_lock);
+    return n;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+    pthread_mutex_lock(&shim_lock);
+    UBaseType_t n = q->length - q->count;
+    pthread_mutex_unlock(&shim_lock);
+    return n;
+}
+
+// ======================= Semaphores =======================
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    struct shim_queue *q = shim_queue_new(1, 0);
+    if (q)
+    {
+        q->count = 1;
+    }
+    return q;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return shim_queue_new(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    struct shim_queue *q = shim_queue_new(max, 0);
+    if (q)
+    {
+        q->count = initial;
+    }
+    return q;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    return shim_queue_get(sem, NULL, ticks, true);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return shim_queue_put(sem, NULL, 0, false);
+}
+
+// ======================= Stream buffers =======================
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger)
+{
+    (void)trigger;
+    return shim_queue_new((UBaseType_t)size, 1);
+}
+
+void vStreamBufferDelete(StreamBufferHandle_t buffer)
+{
+    vQueueDelete(buffer);
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t b, const void *data, size_t length, TickType_t ticks)
+{
+    struct timespec ts;
+    const struct timespec *deadline = shim_deadline(ticks, &ts);
+    const uint8_t *in = data;
+    size_t sent = 0;
+
+    pthread_mutex_lock(&shim_lock);
+    while (1)
+    {
+        while (sent < length && b->count < b->length)
+        {
+            b->buf[(b->head + b->count) % b->length] = in[sent++];
+            b->count++;
+        }
+        if (sent == length || ticks == 0 || !shim_wait(deadline))
+        {
+            break;
+        }
+    }
+    if (sent)
+    {
+        pthread_cond_broadcast(&shim_cond);
+    }
+    pthread_mutex_unlock(&shim_lock);
+    return sent;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t b, void *data, size_t length, TickType_t ticks)
+{
+    struct timespec ts;
+    const struct timespec *deadline = shim_deadline(ticks, &ts);
+    uint8_t *out = data;
+    size_t got = 0;
+
+    pthread_mutex_lock(&shim_lock);
+    while (b->count == 0 && ticks != 0 && shim_wait(deadline))
+    {
+    }
+    while (got < length && b->count > 0)
+    {
+        out[got++] = b->buf[b->head];
+        b->head = (b->head + 1) % b->length;
+        b->count--;
+    }
+    if (got)
+    {
+        pthread_cond_broadcast(&shim_cond);
+    }
+    pthread_mutex_unlock(&shim_lock);
+    return got;
+}
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t b)
+{
+    return uxQueueMessagesWaiting(b);
+}
+
+BaseType_t xStreamBufferIsEmpty(StreamBufferHandle_t b)
+{
+    return uxQueueMessagesWaiting(b) == 0;
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t b)
+{
+    return xQueueReset(b);
+}
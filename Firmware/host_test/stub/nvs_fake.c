@@ -0,0 +1,141 @@
+// In-memory NVS for the host tests, one flat table shared by every namespace handle
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "nvs.h"
+
+#define NVS_FAKE_ENTRIES 32
+#define NVS_FAKE_VALUE_MAX 256
+
+typedef struct
+{
+    char key[48]; // "<namespace>/<key>"
+    uint8_t value[NVS_FAKE_VALUE_MAX];
+    size_t length;
+    bool used;
+} nvs_fake_entry_t;
+
+static nvs_fake_entry_t nvs_fake[NVS_FAKE_ENTRIES];
+static char nvs_fake_ns[8][16];
+static uint32_t nvs_fake_ns_count;
+
+static nvs_fake_entry_t *nvs_fake_find(nvs_handle_t handle, const char *key, bool create)
+{
+    char full[48];
+    snprintf(full, sizeof(full), "%s/%s", nvs_fake_ns[handle], key);
+    for (int i = 0; i < NVS_FAKE_ENTRIES; i++)
+    {
+        if (nvs_fake[i].used && strcmp(nvs_fake[i].key, full) == 0)
+            return &nvs_fake[i];
+    }
+    for (int i = 0; create && i < NVS_FAKE_ENTRIES; i++)
+    {
+        if (!nvs_fake[i].used)
+        {
+            nvs_fake[i].used = true;
+            strcpy(nvs_fake[i].key, full);
+            return &nvs_fake[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+    (void)mode;
+    for (uint32_t i = 0; i < nvs_fake_ns_count; i++)
+    {
+        if (strcmp(nvs_fake_ns[i], ns) == 0)
+        {
+            *out = i;
+            return ESP_OK;
+        }
+    }
+    if (nvs_fake_ns_count >= 8)
+        return ESP_ERR_NO_MEM;
+    snprintf(nvs_fake_ns[nvs_fake_ns_count], sizeof(nvs_fake_ns[0]), "%s", ns);
+    *out = nvs_fake_ns_count++;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *length)
+{
+    nvs_fake_entry_t *e = nvs_fake_find(handle, key, false);
+    if (!e)
+        return ESP_ERR_NVS_NOT_FOUND;
+    if (out == NULL)
+    {
+        *length = e->length;
+        return ESP_OK;
+    }
+    if (*length < e->length)
+        return ESP_ERR_INVALID_SIZE;
+    memcpy(out, e->value, e->length);
+    *length = e->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    if (length > NVS_FAKE_VALUE_MAX)
+        return ESP_ERR_INVALID_SIZE;
+    nvs_fake_entry_t *e = nvs_fake_find(handle, key, true);
+    if (!e)
+        return ESP_ERR_NO_MEM;
+    memcpy(e->value, value, length);
+    e->length = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out)
+{
+    size_t len = sizeof(*out);
+    return nvs_get_blob(handle, key, out, &len);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out)
+{
+    size_t len = sizeof(*out);
+    return nvs_get_blob(handle, key, out, &len);
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value)
+{
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out, size_t *length)
+{
+    return nvs_get_blob(handle, key, out, length);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return nvs_set_blob(handle, key, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    nvs_fake_entry_t *e = nvs_fake_find(handle, key, false);
+    if (!e)
+        return ESP_ERR_NVS_NOT_FOUND;
+    e->used = false;
+    return ESP_OK;
+}
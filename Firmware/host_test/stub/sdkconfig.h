@@ -0,0 +1,3 @@
+#pragma once
+// Host builds take the IDF_TARGET=linux paths (pty UART backend)
+#define CONFIG_IDF_TARGET_LINUX 1
@@ -0,0 +1,245 @@
+// BH1750 protocol and auto-ranging (bh1750_core.c) on a mock I2C bus: command sequences, one-time /
+// continuous mode, bus error recovery, range convergence, saturation and no flapping on a slow ramp
+
+#include <math.h>
+#include "host_test.h"
+#include "bh1750_core.h"
+
+// ============ MOCK SENSOR ============
+typedef struct
+{
+    double lux;
+    bool powered;
+    uint8_t mode; // last measurement command, 0 = none
+    uint8_t mt_hi, mt_lo;
+    uint16_t result;
+    uint8_t log[64]; // bytes written, in order
+    int nlog;
+    int fail_writes, fail_reads;
+} mock_t;
+
+static bh1750_t dev;
+static mock_t mk;
+
+static int mock_mtreg(const mock_t *m)
+{
+    return (m->mt_hi << 5) | m->mt_lo;
+}
+
+static void mock_convert(mock_t *m)
+{
+    uint8_t cmd = (m->mode & 0x20) ? m->mode - 0x10 : m->mode; // one-time -> same continuous resolution
+    double count = m->lux * 1.2 * mock_mtreg(m) / 69.0;
+    if (cmd == 0x11)
+        count *= 2;
+    if (count > 65535)
+        count = 65535;
+    m->result = (uint16_t)count;
+    if (cmd == 0x13)
+        m->result &= ~3u; // L-res only has 4 lx steps
+}
+
+static int mock_write(void *ctx, const uint8_t *data, size_t len)
+{
+    mock_t *m = ctx;
+    if (m->fail_writes)
+    {
+        m->fail_writes--;
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t c = data[i];
+        if (m->nlog < (int)sizeof(m->log))
+            m->log[m->nlog++] = c;
+        if (c == 0x00)
+            m->powered = false;
+        else if (c == 0x01)
+            m->powered = true;
+        else if ((c & 0xF8) == 0x40)
+            m->mt_hi = c & 0x07;
+        else if ((c & 0xE0) == 0x60)
+            m->mt_lo = c & 0x1F;
+        else if (c == 0x10 || c == 0x11 || c == 0x13 || c == 0x20 || c == 0x21 || c == 0x23)
+        {
+            if (!m->powered)
+                return -2;
+            m->mode = c;
+            mock_convert(m);
+            if (c & 0x20)
+                m->powered = false;
+        }
+        else
+            return -3;
+    }
+    return 0;
+}
+
+static int mock_read(void *ctx, uint8_t *data, size_t len)
+{
+    mock_t *m = ctx;
+    if (m->fail_reads)
+    {
+        m->fail_reads--;
+        return -1;
+    }
+    if (m->mode && !(m->mode & 0x20))
+        mock_convert(m); // continuous mode keeps tracking the light
+    data[0] = m->result >> 8;
+    data[1] = m->result & 0xFF;
+    return 0;
+}
+
+static void setup(bool one_time, bool auto_range, bh1750_res_t res, uint8_t mtreg, double lux)
+{
+    memset(&mk, 0, sizeof(mk));
+    mk.lux = lux;
+    mk.mt_hi = BH1750_MTREG_DEFAULT >> 5;
+    mk.mt_lo = BH1750_MTREG_DEFAULT & 0x1F;
+    const bh1750_bus_t bus = {mock_write, mock_read, &mk};
+    const bh1750_config_t cfg = {one_time, auto_range, res, mtreg};
+    bh1750_core_init(&dev, &bus, &cfg);
+}
+
+static int measure(bh1750_reading_t *r)
+{
+    uint32_t wait_ms;
+    int err = bh1750_start(&dev, &wait_ms);
+    return err ? err : bh1750_fetch(&dev, r);
+}
+
+int main(void)
+{
+    bh1750_reading_t r;
+    uint32_t wait_ms;
+
+    CHECK_EQ(bh1750_measure_time_ms(BH1750_RES_LOW, 31), 11);
+    CHECK_EQ(bh1750_measure_time_ms(BH1750_RES_HIGH2, 254), 663);
+    CHECK_EQ(bh1750_measure_time_ms(BH1750_RES_HIGH, 69), 180);
+
+    // One-time, fixed range: power on, MTreg, one-time H-res; powered down after the conversion
+    setup(true, false, BH1750_RES_HIGH, 69, 400);
+    CHECK_EQ(bh1750_start(&dev, &wait_ms), 0);
+    CHECK_EQ(wait_ms, 180);
+    CHECK_EQ(mk.nlog, 4);
+    CHECK_MEM(mk.log, "\x01\x42\x65\x20", 4);
+    CHECK_EQ(bh1750_fetch(&dev, &r), 0);
+    CHECK(fabs(r.lux - 400) < 1.0);
+    CHECK(!mk.powered);
+    // MTreg already set: only power on + mode
+    mk.nlog = 0;
+    CHECK_EQ(bh1750_start(&dev, &wait_ms), 0);
+    CHECK_EQ(mk.nlog, 2);
+    CHECK_MEM(mk.log, "\x01\x20", 2);
+
+    // Continuous: set up once, then only reads on the bus
+    setup(false, false, BH1750_RES_HIGH2, 69, 100);
+    CHECK_EQ(measure(&r), 0);
+    CHECK_EQ(mk.log[mk.nlog - 1], 0x11);
+    int n = mk.nlog;
+    mk.lux = 200;
+    CHECK_EQ(measure(&r), 0);
+    CHECK_EQ(mk.nlog, n);
+    CHECK(fabs(r.lux - 200) < 0.6);
+    CHECK(mk.powered);
+    CHECK_EQ(bh1750_power_down(&dev), 0);
+    CHECK(!mk.powered);
+    CHECK_EQ(measure(&r), 0);
+    CHECK(mk.nlog > n + 2);
+
+    // Errors are returned, not asserted; the next start resends the full setup
+    setup(true, false, BH1750_RES_HIGH, 69, 50);
+    CHECK_EQ(measure(&r), 0);
+    mk.fail_writes = 1;
+    CHECK(bh1750_start(&dev, &wait_ms) != 0);
+    mk.nlog = 0;
+    CHECK_EQ(measure(&r), 0);
+    CHECK_EQ(mk.nlog, 4);
+    mk.fail_reads = 1;
+    CHECK(measure(&r) != 0);
+    CHECK(!dev.synced);
+    mk.nlog = 0;
+    CHECK_EQ(measure(&r), 0);
+    CHECK_EQ(mk.nlog, 4);
+
+    // Auto-ranging converges and then stays, from the fast and from the sensitive end of the ladder
+    static const struct
+    {
+        double lux;
+        bh1750_res_t res;
+        int mtreg;
+    } ranges[] = {
+        {0.5, BH1750_RES_HIGH2, 254}, {5, BH1750_RES_HIGH2, 254}, {500, BH1750_RES_HIGH, 69},
+        {5000, BH1750_RES_LOW, 31},   {80000, BH1750_RES_LOW, 31}, {110000, BH1750_RES_LOW, 31},
+    };
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++)
+    {
+        for (int from_dark = 0; from_dark < 2; from_dark++)
+        {
+            if (from_dark)
+                setup(true, true, BH1750_RES_HIGH2, 254, ranges[i].lux);
+            else
+                setup(true, true, BH1750_RES_LOW, 31, ranges[i].lux);
+            for (int k = 0; k < 5; k++)
+                CHECK_EQ(measure(&r), 0);
+
+            bh1750_res_t res = dev.res;
+            int mtreg = dev.mtreg;
+            int moved = 0;
+            for (int k = 0; k < 10; k++)
+            {
+                CHECK_EQ(measure(&r), 0);
+                moved += dev.res != res || dev.mtreg != mtreg;
+            }
+            CHECK_EQ(moved, 0);
+
+            if (ranges[i].lux == 500 && !from_dark)
+            {
+                // Hysteresis: L-res / 31 holds down to ~445 lx, coming from above it is not left
+                CHECK(res == BH1750_RES_LOW && mtreg == 31);
+            }
+            else if (ranges[i].lux >= 500 || from_dark)
+            {
+                CHECK(res == ranges[i].res && mtreg == ranges[i].mtreg);
+            }
+
+            double step = (r.res == BH1750_RES_LOW ? 4 : r.res == BH1750_RES_HIGH ? 1 : 0.5) * 69.0 / r.mtreg + 0.01;
+            CHECK(fabs(r.lux - ranges[i].lux) <= step * 2);
+            CHECK(!r.saturated);
+        }
+    }
+
+    // Saturated in the dark range: walks towards the fast end
+    setup(true, true, BH1750_RES_HIGH2, 254, 80000);
+    CHECK_EQ(measure(&r), 0);
+    CHECK(r.saturated);
+    CHECK(dev.mtreg != 254 || dev.res != BH1750_RES_HIGH2);
+
+    // Slow ramp 0.1 lx -> 126 klx and back: a bounded number of range changes (no flapping)
+    setup(true, true, BH1750_RES_HIGH, 69, 0.1);
+    int changes = 0;
+    bh1750_res_t prev_res = dev.res;
+    int prev_mtreg = dev.mtreg;
+    for (int down = 0; down < 2; down++)
+    {
+        for (int s = 0; s <= 400; s++)
+        {
+            double e = down ? 5.1 - s * 6.2 / 400 : -1 + s * 6.2 / 400;
+            mk.lux = pow(10, e);
+            for (int k = 0; k < 4; k++)
+            {
+                CHECK_EQ(measure(&r), 0);
+                if (dev.res != prev_res || dev.mtreg != prev_mtreg)
+                {
+                    changes++;
+                    prev_res = dev.res;
+                    prev_mtreg = dev.mtreg;
+                }
+            }
+        }
+    }
+    CHECK(changes <= 8);
+    printf("range changes over the up + down ramp: %d\n", changes);
+
+    return ht_summary("bh1750_core");
+}
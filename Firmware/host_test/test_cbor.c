@@ -0,0 +1,218 @@
+// CBOR writer / decoder (cbor.c, cbor_json.c): RFC 8949 appendix A vectors, error statuses, JSON round trips
+
+#include "host_test.h"
+#include "cbor.h"
+
+static uint8_t out[4096];
+static char js[4096];
+static json_tok_t toks[512];
+
+static void check_hex(const char *want, size_t n, int line)
+{
+    char got[512] = "";
+    for (size_t i = 0; i < n && 2 * i + 2 < sizeof(got); i++)
+        sprintf(&got[2 * i], "%02x", out[i]);
+    ht_checks++;
+    if (strcmp(got, want) != 0)
+    {
+        ht_failures++;
+        printf("%s:%d: CBOR %s, expected %s\n", __FILE__, line, got, want);
+    }
+}
+
+// Run the writer calls on w, then compare the encoding with the hex string
+#define CBOR_CASE(want, ...)                                                 \
+    do                                                                       \
+    {                                                                        \
+        cbor_writer_t wr, *w = &wr;                                          \
+        cbor_writer_init(w, out, sizeof(out));                               \
+        __VA_ARGS__;                                                         \
+        check_hex(want, cbor_writer_finish(w), __LINE__);                    \
+    } while (0)
+
+static size_t unhex(const char *h, uint8_t *b)
+{
+    size_t n = 0;
+    while (h[0] && h[1])
+    {
+        unsigned v;
+        sscanf(h, "%2x", &v);
+        b[n++] = (uint8_t)v;
+        h += 2;
+    }
+    return n;
+}
+
+/**
+ * @brief Decode hex CBOR to JSON, NULL on error with the status in *st
+ */
+static const char *to_json(const char *hex, cbor_read_status_t *st)
+{
+    uint8_t b[256];
+    size_t n = unhex(hex, b);
+    json_writer_t w;
+    json_writer_init(&w, js, sizeof(js));
+    return cbor_to_json(b, n, NULL, &w, st) ? js : NULL;
+}
+
+static void check_decode(const char *hex, const char *want, int line)
+{
+    cbor_read_status_t st = CBOR_READ_OK;
+    const char *got = to_json(hex, &st);
+    ht_checks++;
+    if (!got || strcmp(got, want) != 0)
+    {
+        ht_failures++;
+        printf("%s:%d: %s -> %s (%s), expected %s\n", __FILE__, line, hex, got ? got : "error",
+               cbor_read_status_str(st), want);
+    }
+}
+
+static void check_decode_error(const char *hex, cbor_read_status_t want, int line)
+{
+    cbor_read_status_t st = CBOR_READ_OK;
+    const char *got = to_json(hex, &st);
+    ht_checks++;
+    if (got || st != want)
+    {
+        ht_failures++;
+        printf("%s:%d: %s -> %s (%s), expected %s\n", __FILE__, line, hex, got ? got : "error",
+               cbor_read_status_str(st), cbor_read_status_str(want));
+    }
+}
+
+/**
+ * @brief JSON -> CBOR -> JSON gives want (or the input when want is NULL)
+ */
+static void check_round_trip(const char *in, const char *want, int line)
+{
+    cbor_writer_t w;
+    json_read_error_t err;
+    cbor_writer_init(&w, out, sizeof(out));
+    size_t n = cbor_from_json(in, strlen(in), toks, 512, NULL, &w, &err);
+
+    json_writer_t jw;
+    cbor_read_status_t st = CBOR_READ_OK;
+    json_writer_init(&jw, js, sizeof(js));
+    bool ok = n && cbor_to_json(out, n, NULL, &jw, &st);
+    ht_checks++;
+    if (!ok || strcmp(js, want ? want : in) != 0)
+    {
+        ht_failures++;
+        printf("%s:%d: %s -> %s\n", __FILE__, line, in, ok ? js : "error");
+    }
+}
+
+#define DECODE(hex, want) check_decode(hex, want, __LINE__)
+#define DECODE_ERROR(hex, st) check_decode_error(hex, st, __LINE__)
+#define ROUND_TRIP(in, want) check_round_trip(in, want, __LINE__)
+
+int main(void)
+{
+    // Writer, RFC 8949 appendix A
+    CBOR_CASE("00", cbor_writer_uint(w, NULL, 0));
+    CBOR_CASE("17", cbor_writer_uint(w, NULL, 23));
+    CBOR_CASE("1818", cbor_writer_uint(w, NULL, 24));
+    CBOR_CASE("1864", cbor_writer_uint(w, NULL, 100));
+    CBOR_CASE("1903e8", cbor_writer_uint(w, NULL, 1000));
+    CBOR_CASE("1a000f4240", cbor_writer_uint(w, NULL, 1000000));
+    CBOR_CASE("1b000000e8d4a51000", cbor_writer_uint(w, NULL, 1000000000000ULL));
+    CBOR_CASE("1bffffffffffffffff", cbor_writer_uint(w, NULL, UINT64_MAX));
+    CBOR_CASE("20", cbor_writer_int(w, NULL, -1));
+    CBOR_CASE("29", cbor_writer_int(w, NULL, -10));
+    CBOR_CASE("3863", cbor_writer_int(w, NULL, -100));
+    CBOR_CASE("3903e7", cbor_writer_int(w, NULL, -1000));
+    CBOR_CASE("3b7fffffffffffffff", cbor_writer_int(w, NULL, INT64_MIN));
+    CBOR_CASE("fa47c35000", cbor_writer_double(w, NULL, 100000.0));
+    CBOR_CASE("fb3ff199999999999a", cbor_writer_double(w, NULL, 1.1));
+    CBOR_CASE("fa7f800000", cbor_writer_double(w, NULL, 1.0 / 0.0));
+    CBOR_CASE("f4", cbor_writer_bool(w, NULL, false));
+    CBOR_CASE("f5", cbor_writer_bool(w, NULL, true));
+    CBOR_CASE("f6", cbor_writer_null(w, NULL));
+    CBOR_CASE("60", cbor_writer_string(w, NULL, ""));
+    CBOR_CASE("6449455446", cbor_writer_string(w, NULL, "IETF"));
+    CBOR_CASE("bf61610161629f0203ffff", {
+        cbor_writer_begin_map(w, NULL);
+        cbor_writer_uint(w, "a", 1);
+        cbor_writer_begin_array(w, "b");
+        cbor_writer_uint(w, NULL, 2);
+        cbor_writer_uint(w, NULL, 3);
+        cbor_writer_end_array(w);
+        cbor_writer_end_map(w);
+    });
+
+    // Overflow and unclosed map
+    cbor_writer_t w;
+    cbor_writer_init(&w, out, 3);
+    cbor_writer_string(&w, NULL, "IETF");
+    CHECK_EQ(cbor_writer_finish(&w), 0);
+    cbor_writer_init(&w, out, 9);
+    cbor_writer_begin_map(&w, NULL);
+    CHECK_EQ(cbor_writer_finish(&w), 0);
+
+    // Decoder, appendix A
+    DECODE("f93c00", "1");
+    DECODE("f97bff", "65504");
+    DECODE("f9c400", "-4");
+    DECODE("f90001", "5.9605e-08");
+    DECODE("f93e00", "1.5");
+    DECODE("f97c00", "null");
+    DECODE("fb7e37e43c8800759c", "1e+300");
+    DECODE("1bffffffffffffffff", "18446744073709551615");
+    DECODE("3b7fffffffffffffff", "-9223372036854775808");
+    DECODE("a26161016162820203", "{\"a\":1,\"b\":[2,3]}");
+    DECODE("9f018202039f0405ffff", "[1,[2,3],[4,5]]");
+    DECODE("c074323031332d30332d32315432303a30343a30305a", "\"2013-03-21T20:04:00Z\"");
+    DECODE("62225c", "\"\\\"\\\\\"");
+    DECODE("f7", "null");
+
+    DECODE_ERROR("3bffffffffffffffff", CBOR_READ_ERR_UNSUPPORTED); // below INT64_MIN
+    DECODE_ERROR("a201020304", CBOR_READ_ERR_TYPE);                // integer keys without a dictionary
+    DECODE_ERROR("1a0000", CBOR_READ_ERR_TRUNCATED);
+    DECODE_ERROR("1c", CBOR_READ_ERR_MALFORMED);
+    DECODE_ERROR("ff", CBOR_READ_ERR_MALFORMED);
+    DECODE_ERROR("4401020304", CBOR_READ_ERR_TYPE);
+    DECODE_ERROR("7f657374726561ff", CBOR_READ_ERR_UNSUPPORTED);
+    DECODE_ERROR("0000", CBOR_READ_ERR_MALFORMED);
+    DECODE_ERROR("9f01", CBOR_READ_ERR_TRUNCATED);
+    DECODE_ERROR("f800", CBOR_READ_ERR_MALFORMED);
+    DECODE_ERROR("818181818181818181818181818181818101", CBOR_READ_ERR_DEPTH);
+
+    // JSON -> CBOR -> JSON
+    ROUND_TRIP("{\"type\":\"telemetry\",\"batch\":[{\"dt\":0,\"data\":{\"node\":3,\"lux\":512,\"temp\":27,\"humi\":61}}],"
+               "\"age_ms\":1000}",
+               NULL);
+    ROUND_TRIP("[-1,0,1,-2147483649,18446744073709551615,1.5,0.1,1e300,true,false,null,\"\"]",
+               "[-1,0,1,-2147483649,18446744073709551615,1.5,0.1,1e+300,true,false,null,\"\"]");
+    ROUND_TRIP("{\"s\":\"a\\\"b\\\\c\\n\\u00e9\\ud83d\\ude00\"}", "{\"s\":\"a\\\"b\\\\c\\n\xc3\xa9\xf0\x9f\x98\x80\"}");
+    ROUND_TRIP("{\"k\\u0041\":1}", "{\"kA\":1}");
+    ROUND_TRIP("[1e2,2.50,-0.0]", "[100,2.5,-0]");
+
+    json_read_error_t err;
+    cbor_writer_init(&w, out, sizeof(out));
+    CHECK_EQ(cbor_from_json("{\"a\":\"\\u0000\"}", 14, toks, 512, NULL, &w, &err), 0);
+    cbor_writer_init(&w, out, 8);
+    CHECK_EQ(cbor_from_json("{\"abcdefgh\":1}", 14, toks, 512, NULL, &w, &err), 0);
+    CHECK_EQ(err.status, JSON_READ_ERR_OVERFLOW);
+    cbor_writer_init(&w, out, 8);
+    CHECK_EQ(cbor_from_json("[\"ab\\ncdefgh\"]", 14, toks, 512, NULL, &w, &err), 0);
+    CHECK_EQ(err.status, JSON_READ_ERR_OVERFLOW);
+
+    // Key dictionary: keys become indexes, decoding needs the same table
+    static const char *const keys[] = {"type", "data", "batch", "dt", "age_ms", "node", "lux", "temp", "humi", "seq"};
+    const cbor_key_dict_t dict = {keys, sizeof(keys) / sizeof(keys[0])};
+    const char *doc = "{\"type\":\"telemetry\",\"data\":{\"node\":3,\"lux\":512,\"other\":1}}";
+    cbor_writer_init(&w, out, sizeof(out));
+    size_t n = cbor_from_json(doc, strlen(doc), toks, 512, &dict, &w, &err);
+    CHECK(n > 0);
+    json_writer_t jw;
+    cbor_read_status_t st;
+    json_writer_init(&jw, js, sizeof(js));
+    CHECK(cbor_to_json(out, n, &dict, &jw, &st) > 0);
+    CHECK(strcmp(js, doc) == 0);
+    json_writer_init(&jw, js, sizeof(js));
+    CHECK_EQ(cbor_to_json(out, n, NULL, &jw, &st), 0);
+    CHECK_EQ(st, CBOR_READ_ERR_TYPE);
+
+    return ht_summary("test_cbor");
+}
@@ -0,0 +1,72 @@
+// Gateway connectivity state machine (conn_state.c): scripted event sequence and exhaustive transition properties
+
+#include "host_test.h"
+#include "conn_state.h"
+
+#define S(x) WIFI_STATE_##x
+#define E(x) CONN_EVT_##x
+#define STATE_COUNT (S(DISCONNECTED) + 1)
+#define EVENT_COUNT (E(ERROR) + 1)
+
+int main(void)
+{
+    static const struct
+    {
+        conn_event_t event;
+        wifi_manager_state_t want;
+    } seq[] = {
+        {E(MQTT_UP), S(UNINITIALIZED)}, {E(WIFI_LOST), S(UNINITIALIZED)}, {E(CONNECTING), S(CONNECTING)},
+        {E(WIFI_LOST), S(CONNECTING)},  {E(CONNECTING), S(CONNECTING)},   {E(GOT_IP), S(CONNECTED)},
+        {E(MQTT_DOWN), S(CONNECTED)},   {E(MQTT_UP), S(MQTT_CONNECTED)},  {E(GOT_IP), S(MQTT_CONNECTED)},
+        {E(MQTT_DOWN), S(CONNECTED)},   {E(MQTT_UP), S(MQTT_CONNECTED)},  {E(WIFI_LOST), S(DISCONNECTED)},
+        {E(MQTT_DOWN), S(DISCONNECTED)}, {E(MQTT_UP), S(DISCONNECTED)},   {E(CONNECTING), S(DISCONNECTED)},
+        {E(WIFI_LOST), S(DISCONNECTED)}, {E(GOT_IP), S(CONNECTED)},       {E(ERROR), S(ERROR)},
+        {E(MQTT_UP), S(MQTT_CONNECTED)}, {E(PORTAL), S(AP_MODE)},         {E(GOT_IP), S(AP_MODE)},
+        {E(ERROR), S(AP_MODE)},
+    };
+    wifi_manager_state_t s = S(UNINITIALIZED);
+    for (size_t i = 0; i < sizeof(seq) / sizeof(seq[0]); i++)
+    {
+        wifi_manager_state_t next = conn_state_next(s, seq[i].event);
+        if (next != seq[i].want)
+            printf("  step %zu: %s -> %s, expected %s\n", i, conn_state_str(s), conn_state_str(next),
+                   conn_state_str(seq[i].want));
+        CHECK_EQ(next, seq[i].want);
+        s = seq[i].want;
+    }
+
+    // One state bit per state, the IP level bit exactly when an address is held
+    for (int a = 0; a < STATE_COUNT; a++)
+    {
+        uint32_t bits = conn_state_bits(a);
+        uint32_t state_bits = bits & CONN_STATE_BITS;
+        CHECK(state_bits != 0 && (state_bits & (state_bits - 1)) == 0);
+        CHECK_EQ((bits & ~CONN_ALL_BITS), 0);
+        CHECK_EQ(!!(bits & CONN_BIT_IP), a == S(CONNECTED) || a == S(MQTT_CONNECTED));
+        CHECK(conn_state_str(a) != NULL);
+    }
+
+    // Every state x event: AP_MODE absorbs, nothing goes back to UNINITIALIZED,
+    // and a state change always sets a state bit that was clear (so a waiter wakes up)
+    for (int a = 0; a < STATE_COUNT; a++)
+    {
+        for (int e = 0; e < EVENT_COUNT; e++)
+        {
+            wifi_manager_state_t n = conn_state_next(a, e);
+            CHECK(n >= 0 && n < STATE_COUNT);
+            if (a == S(AP_MODE))
+                CHECK_EQ(n, a);
+            if (n != a)
+            {
+                CHECK(n != S(UNINITIALIZED));
+                CHECK((conn_state_bits(n) & ~conn_state_bits(a) & CONN_STATE_BITS) != 0);
+            }
+        }
+    }
+
+    // PORTAL reaches AP_MODE from anywhere
+    for (int a = 0; a < STATE_COUNT; a++)
+        CHECK_EQ(conn_state_next(a, E(PORTAL)), S(AP_MODE));
+
+    return ht_summary("test_conn_state");
+}
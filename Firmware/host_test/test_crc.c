@@ -0,0 +1,106 @@
+// CRC-16/CCITT-FALSE and frame integrity checks (message.c)
+
+#include "host_test.h"
+#include "message.h"
+
+static uint16_t crc16_bytewise(const uint8_t *data, uint16_t len)
+{
+    uint16_t crc = CRC16_INIT;
+    for (uint16_t i = 0; i < len; i++)
+        crc = crc16_update(crc, data[i]);
+    return crc;
+}
+
+static uint16_t build_frame(uint8_t *f, const uint8_t *payload, uint16_t payload_len)
+{
+    uint16_t len = 0;
+    f[len++] = 0xAA;
+    f[len++] = 0x55;
+    f[len++] = RESPONSE_MESSAGE;
+    uint16_t total = (uint16_t)(5 + payload_len + 2);
+    f[len++] = (uint8_t)(total >> 8);
+    f[len++] = (uint8_t)(total & 0xFF);
+    memcpy(&f[len], payload, payload_len);
+    len += payload_len;
+    return message_append_integrity(f, len);
+}
+
+int main(void)
+{
+    // Check value of CRC-16/CCITT-FALSE
+    CHECK_EQ(caculate_crc16((const uint8_t *)"123456789", 9), 0x29B1);
+    CHECK_EQ(caculate_crc16(NULL, 0), CRC16_INIT);
+
+    // Slice-by-4 must match the byte-at-a-time update for every length and alignment
+    uint8_t buf[320];
+    for (int i = 0; i < (int)sizeof(buf); i++)
+        buf[i] = (uint8_t)(i * 7 + 3);
+    for (int off = 0; off < 4; off++)
+    {
+        for (uint16_t n = 0; n < 300; n++)
+            CHECK_EQ(caculate_crc16(buf + off, n), crc16_bytewise(buf + off, n));
+    }
+
+    // Frames built in each mode pass their own check and carry the right flag
+    const uint8_t payload[] = {7, 0, 0x3C, 24, 69};
+    uint8_t f[64];
+    for (int mode = INTEGRITY_SUM16; mode <= INTEGRITY_CRC16; mode++)
+    {
+        message_set_integrity_mode((Integrity_Mode)mode);
+        CHECK_EQ(message_get_integrity_mode(), mode);
+        uint16_t len = build_frame(f, payload, sizeof(payload));
+        CHECK_EQ(len, 5 + sizeof(payload) + 2);
+        CHECK_EQ((f[2] & FRAME_FLAG_CRC16) != 0, mode == INTEGRITY_CRC16);
+        CHECK(message_check_integrity(f, len));
+        f[6] ^= 0x01;
+        CHECK(!message_check_integrity(f, len));
+    }
+    CHECK(!message_check_integrity(NULL, 10));
+    CHECK(!message_check_integrity(f, 6));
+
+    // create_message stays readable by both sides
+    message_set_integrity_mode(INTEGRITY_SUM16);
+    uint16_t len = create_message(RESPONSE_MESSAGE, 0x1234, f);
+    CHECK_EQ(len, 9);
+    CHECK_EQ((f[3] << 8) | f[4], len);
+    CHECK(message_check_integrity(f, len));
+
+    // Every single-bit and every two-byte swap error is caught by the CRC, the sum misses swaps
+    message_set_integrity_mode(INTEGRITY_CRC16);
+    uint8_t pl[40];
+    for (int i = 0; i < (int)sizeof(pl); i++)
+        pl[i] = (uint8_t)(i * 29 + 1);
+    len = build_frame(f, pl, sizeof(pl));
+    int crc_missed = 0;
+    for (int bit = 0; bit < (len - 2) * 8; bit++)
+    {
+        f[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        crc_missed += message_check_integrity(f, len);
+        f[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+    }
+    CHECK_EQ(crc_missed, 0);
+
+    int swaps_crc = 0, swaps_sum = 0;
+    for (int mode = INTEGRITY_SUM16; mode <= INTEGRITY_CRC16; mode++)
+    {
+        message_set_integrity_mode((Integrity_Mode)mode);
+        len = build_frame(f, pl, sizeof(pl));
+        for (int i = 5; i < len - 3; i++)
+        {
+            uint8_t t = f[i];
+            f[i] = f[i + 1];
+            f[i + 1] = t;
+            int missed = message_check_integrity(f, len);
+            if (mode == INTEGRITY_CRC16)
+                swaps_crc += missed;
+            else
+                swaps_sum += missed;
+            f[i + 1] = f[i];
+            f[i] = t;
+        }
+    }
+    CHECK_EQ(swaps_crc, 0);
+    CHECK(swaps_sum > 0);
+
+    return ht_summary("test_crc");
+}
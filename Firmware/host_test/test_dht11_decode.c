@@ -0,0 +1,112 @@
+// DHT11 pulse train decoder (dht11_decode.c): synthetic frames with timing jitter, error classes,
+// RMT split pulses and a recorded logic-analyzer trace
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "dht11_decode.h"
+
+/**
+ * @brief Synthesise a capture: host start tail, release high, response, 40 bits, end low, end marker
+ */
+static size_t build(dht11_pulse_t *p, const uint8_t b[DHT11_FRAME_BYTES], int jitter, unsigned seed)
+{
+    size_t n = 0;
+
+    srand(seed);
+#define J (jitter ? (rand() % (2 * jitter + 1)) - jitter : 0)
+    p[n++] = (dht11_pulse_t){0, 3};
+    p[n++] = (dht11_pulse_t){1, 30 + J / 2};
+    p[n++] = (dht11_pulse_t){0, 80 + J};
+    p[n++] = (dht11_pulse_t){1, 80 + J};
+    for (int i = 0; i < 40; i++)
+    {
+        int one = (b[i / 8] >> (7 - i % 8)) & 1;
+        p[n++] = (dht11_pulse_t){0, 50 + J};
+        p[n++] = (dht11_pulse_t){1, (one ? 70 : 26) + J};
+    }
+#undef J
+    p[n++] = (dht11_pulse_t){0, 52};
+    p[n++] = (dht11_pulse_t){1, 0};
+    return n;
+}
+
+int main(void)
+{
+    dht11_pulse_t p[128];
+    dht11_reading_t r;
+    const uint8_t ok[5] = {55, 0, 24, 3, 82};
+    size_t n;
+
+    n = build(p, ok, 0, 1);
+    CHECK_EQ(dht11_decode(p, n, &r), DHT11_DECODE_OK);
+    CHECK_EQ(r.humi_x10, 550);
+    CHECK_EQ(r.temp_x10, 243);
+
+    // +-12 us on every pulse (interrupt latency on a bit-banged read is worse than this)
+    int jitter_fail = 0;
+    for (unsigned s = 0; s < 1000; s++)
+    {
+        n = build(p, ok, 12, s);
+        if (dht11_decode(p, n, &r) != DHT11_DECODE_OK || r.temp_x10 != 243)
+        {
+            jitter_fail++;
+        }
+    }
+    CHECK_EQ(jitter_fail, 0);
+
+    // Negative temperature: bit7 of the decimal byte
+    const uint8_t neg[5] = {40, 0, 2, 0x85, (uint8_t)(40 + 2 + 0x85)};
+    n = build(p, neg, 0, 1);
+    CHECK_EQ(dht11_decode(p, n, &r), DHT11_DECODE_OK);
+    CHECK_EQ(r.temp_x10, -25);
+
+    // Checksum mismatch still reports the raw bytes
+    const uint8_t bad[5] = {55, 0, 24, 3, 83};
+    n = build(p, bad, 0, 1);
+    CHECK_EQ(dht11_decode(p, n, &r), DHT11_DECODE_CHECKSUM);
+    CHECK_EQ(r.raw[4], 83);
+
+    n = build(p, ok, 0, 1);
+    CHECK_EQ(dht11_decode(p, 50, &r), DHT11_DECODE_SHORT);
+
+    // Capture ended on the last bit high (end marker)
+    n = build(p, ok, 0, 1);
+    p[n - 3].duration = 0;
+    CHECK_EQ(dht11_decode(p, n, &r), DHT11_DECODE_SHORT);
+
+    n = build(p, ok, 0, 1);
+    p[20].duration = 150;
+    CHECK_EQ(dht11_decode(p, n, &r), DHT11_DECODE_BAD_PULSE);
+
+    // No sensor: the line stays high
+    const dht11_pulse_t idle[2] = {{0, 3}, {1, 0}};
+    CHECK_EQ(dht11_decode(idle, 2, &r), DHT11_DECODE_NO_RESPONSE);
+
+    // RMT split a long pulse into two same-level halves: merged
+    n = build(p, ok, 0, 1);
+    memmove(&p[4], &p[3], (n - 3) * sizeof(p[0]));
+    p[3].duration = 40;
+    p[4].duration = 40;
+    n++;
+    CHECK_EQ(dht11_decode(p, n, &r), DHT11_DECODE_OK);
+
+    // Recorded logic-analyzer trace, 58 %RH 26.1 C (58, 0, 26, 1, 85)
+    static const uint16_t rec[] = {
+        2, 26, 84, 86, 52, 27, 55, 23, 54, 72, 54, 72, 55, 69, 55, 23, 54, 71, 55, 23, 52, 27, 54, 27, 55, 24,
+        54, 27, 52, 23, 55, 23, 55, 24, 55, 23, 55, 23, 52, 27, 52, 24, 52, 71, 54, 72, 55, 24, 55, 71, 54, 27,
+        55, 24, 52, 24, 52, 23, 52, 24, 52, 24, 55, 24, 55, 24, 54, 72, 54, 27, 54, 72, 55, 24, 55, 69, 54, 27,
+        52, 71, 55, 27, 55, 69, 53, 0};
+    const size_t rn = sizeof(rec) / sizeof(rec[0]);
+    dht11_pulse_t rp[128];
+    for (size_t i = 0; i < rn; i++)
+    {
+        rp[i] = (dht11_pulse_t){(uint8_t)(i % 2), rec[i]};
+    }
+    CHECK_EQ(dht11_decode(rp, rn, &r), DHT11_DECODE_OK);
+    CHECK_EQ(r.humi_x10, 580);
+    CHECK_EQ(r.temp_x10, 261);
+
+    CHECK(strcmp(dht11_decode_status_str(DHT11_DECODE_CHECKSUM), "") != 0);
+
+    return ht_summary("dht11_decode");
+}
@@ -0,0 +1,130 @@
+// Node light-sleep schedule (duty_cycle.c): announced and learned poll times, wake skew, missed polls and
+// resync, tick wrap-around, awake accounting, and a simulated 1000-poll run with lost polls
+
+#include "host_test.h"
+#include "duty_cycle.h"
+
+static const duty_cycle_config_t cfg = {
+    .guard_ms = 30,
+    .listen_ms = 120,
+    .linger_ms = 20,
+    .min_sleep_ms = 100,
+    .resync_after = 3,
+};
+
+int main(void)
+{
+    duty_cycle_t d;
+
+    duty_cycle_init(&d, &cfg);
+    CHECK_EQ(duty_cycle_listen_ms(&d, 0), DUTY_WAIT_FOREVER);
+    CHECK_EQ(duty_cycle_sleep_ms(&d, 0), 0);
+
+    // ---- Announced schedule (NEXT in the poll) ----
+    duty_cycle_poll(&d, 5000, 1000);
+    CHECK(d.synced);
+    CHECK_EQ(d.next_poll_ms, 6000);
+    CHECK_EQ(d.period_ms, 1000);
+    CHECK_EQ(duty_cycle_sleep_ms(&d, 5025), 945);  // wake at 5970
+    CHECK_EQ(duty_cycle_listen_ms(&d, 5970), 150); // until 6120
+    CHECK_EQ(duty_cycle_sleep_ms(&d, 5950), 0);    // gap below min_sleep_ms
+
+    // Poll a bit late (skew): the next one is announced from the master's cycle start
+    duty_cycle_poll(&d, 6040, 960);
+    CHECK_EQ(d.next_poll_ms, 7000);
+
+    // Missed: the schedule moves one period on, resync after resync_after in a row
+    CHECK_EQ(duty_cycle_listen_ms(&d, 7120), 0);
+    duty_cycle_missed(&d, 7120);
+    CHECK(d.synced);
+    CHECK_EQ(d.next_poll_ms, 8000);
+    CHECK_EQ(d.stats.missed, 1);
+    CHECK_EQ(duty_cycle_sleep_ms(&d, 7120), 850);
+    duty_cycle_missed(&d, 8120);
+    duty_cycle_missed(&d, 9120);
+    CHECK(!d.synced);
+    CHECK_EQ(d.stats.missed, 3);
+    CHECK_EQ(d.stats.resyncs, 1);
+    CHECK_EQ(duty_cycle_listen_ms(&d, 9120), DUTY_WAIT_FOREVER);
+    duty_cycle_poll(&d, 10000, 1000);
+    CHECK(d.synced);
+    CHECK_EQ(d.missed_run, 0);
+    CHECK_EQ(d.next_poll_ms, 11000);
+
+    // Overslept two windows at once
+    duty_cycle_missed(&d, 12500);
+    CHECK_EQ(d.next_poll_ms, 13000);
+    CHECK_EQ(d.stats.missed, 5);
+
+    // ---- Learned schedule (master without NEXT) ----
+    duty_cycle_init(&d, &cfg);
+    duty_cycle_poll(&d, 0, 0);
+    CHECK(!d.synced);
+    duty_cycle_poll(&d, 1000, 0);
+    CHECK(d.synced);
+    CHECK_EQ(d.period_ms, 1000);
+    CHECK_EQ(d.next_poll_ms, 2000);
+    duty_cycle_poll(&d, 1040, 0); // re-send of the same poll: not learned
+    CHECK_EQ(d.period_ms, 1000);
+    CHECK_EQ(d.next_poll_ms, 2040);
+    duty_cycle_poll(&d, 3040, 0); // two periods (one missed): not learned
+    CHECK_EQ(d.period_ms, 1000);
+    duty_cycle_poll(&d, 4080, 0); // 1040 -> EWMA
+    CHECK_EQ(d.period_ms, 1010);
+    duty_cycle_reset(&d);
+    CHECK(!d.synced);
+    CHECK_EQ(d.period_ms, 0);
+
+    // ---- Tick wrap-around ----
+    duty_cycle_init(&d, &cfg);
+    duty_cycle_poll(&d, 0xFFFFFF00u, 1000);
+    CHECK_EQ(duty_cycle_sleep_ms(&d, 0xFFFFFF00u), 970);
+    CHECK_EQ(duty_cycle_listen_ms(&d, 0xFFFFFF00u + 1000), 120);
+
+    // ---- Accounting ----
+    CHECK_EQ(duty_cycle_permille(&d), 1000);
+    duty_cycle_account(&d, 60, 940);
+    duty_cycle_account(&d, 40, 960);
+    CHECK_EQ(d.stats.cycles, 2);
+    CHECK_EQ(d.stats.last_awake_ms, 40);
+    CHECK_EQ(duty_cycle_permille(&d), 50);
+
+    // ---- Simulated run: polls every 1000 ms, +-15 ms wake skew, 1 poll in 10 lost ----
+    duty_cycle_init(&d, &cfg);
+    uint32_t t = 0, awake_start = 0, lost = 0;
+    duty_cycle_poll(&d, 0, 1000);
+    for (uint32_t cycle = 1; cycle <= 1000; cycle++)
+    {
+        uint32_t poll_at = cycle * 1000;
+        uint32_t sleep = duty_cycle_sleep_ms(&d, t);
+        if (sleep)
+        {
+            duty_cycle_account(&d, t - awake_start, sleep);
+            t += sleep + (cycle * 7919 % 31) - 15;
+            awake_start = t;
+        }
+        if (cycle % 10 == 0)
+        {
+            lost++;
+            t += duty_cycle_listen_ms(&d, t);
+            duty_cycle_missed(&d, t);
+            continue;
+        }
+        // Late wake: the master's re-send at +40 / +80 ms catches it
+        uint32_t rx = poll_at > t ? poll_at : t;
+        if (rx > poll_at)
+        {
+            rx = poll_at + ((rx - poll_at + 39) / 40) * 40;
+        }
+        duty_cycle_poll(&d, rx, 1000 - (rx - poll_at));
+        t = rx + cfg.linger_ms;
+    }
+    printf("sim: cycles %lu missed %lu (lost %lu) resyncs %lu duty %u permille, last awake %lu ms\n",
+           (unsigned long)d.stats.cycles, (unsigned long)d.stats.missed, (unsigned long)lost,
+           (unsigned long)d.stats.resyncs, (unsigned)duty_cycle_permille(&d), (unsigned long)d.stats.last_awake_ms);
+    CHECK_EQ(d.stats.missed, lost);
+    CHECK_EQ(d.stats.resyncs, 0);
+    CHECK(duty_cycle_permille(&d) < 100);
+
+    return ht_summary("duty_cycle");
+}
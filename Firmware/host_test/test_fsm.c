@@ -0,0 +1,312 @@
+// Receive FSM: both framings, both integrity checks, the length framing resync and the receive timeout
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "fsm_frames.h"
+
+#define MAX_FRAMES 64
+
+static uint8_t rx_buf[FSM_MAX_FRAME_SIZE];
+static uint8_t got[MAX_FRAMES][FSM_MAX_FRAME_SIZE];
+static uint16_t got_len[MAX_FRAMES];
+static int got_count;
+
+static void take_frames(void)
+{
+    uint16_t len;
+    while (Is_Message(&len))
+    {
+        if (got_count < MAX_FRAMES)
+        {
+            memcpy(got[got_count], rx_buf, len);
+            got_len[got_count] = len;
+        }
+        got_count++;
+        // Same as the UART RX task: frames held by a resync are handed out right away
+        if (fsm_replay_pending())
+        {
+            fsm_replay(rx_buf);
+        }
+    }
+}
+
+static void feed(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        fsm_get_message(data[i], rx_buf);
+        take_frames();
+    }
+}
+
+static void reset(Framing_Mode mode)
+{
+    fsm_set_framing(mode);
+    got_count = 0;
+}
+
+/**
+ * @brief Ten frames with distinct payloads, returns the stream length
+ */
+static size_t build_stream(uint8_t *stream, uint8_t frames[][32], uint16_t *frame_len, int n)
+{
+    size_t len = 0;
+    for (int k = 0; k < n; k++)
+    {
+        uint8_t payload[5] = {(uint8_t)k, 0x11, (uint8_t)(k * 3), 0x22, (uint8_t)(0xA0 + k)};
+        frame_len[k] = frame_build(frames[k], 0x01, payload, sizeof(payload));
+        memcpy(&stream[len], frames[k], frame_len[k]);
+        len += frame_len[k];
+    }
+    return len;
+}
+
+static void check_frames(uint8_t frames[][32], const uint16_t *frame_len, int n)
+{
+    CHECK_EQ(got_count, n);
+    for (int k = 0; k < n && k < got_count; k++)
+    {
+        CHECK_EQ(got_len[k], frame_len[k]);
+        CHECK_MEM(got[k], frames[k], frame_len[k]);
+    }
+}
+
+static void test_clean_stream(void)
+{
+    uint8_t stream[512], frames[10][32];
+    uint16_t frame_len[10];
+
+    for (int mode = INTEGRITY_SUM16; mode <= INTEGRITY_CRC16; mode++)
+    {
+        message_set_integrity_mode((Integrity_Mode)mode);
+        reset(FRAMING_LENGTH);
+        size_t len = build_stream(stream, frames, frame_len, 10);
+        feed(stream, len);
+        check_frames(frames, frame_len, 10);
+        CHECK_EQ(fsm_replay_pending(), 0);
+    }
+}
+
+/**
+ * @brief Review case: a frame whose length field is corrupted swallows the frames behind it,
+ *        every one of them must come back once the bad frame fails its check
+ */
+static void test_corrupted_length_then_ten_frames(void)
+{
+    uint8_t stream[512], frames[10][32], bad[32];
+    uint16_t frame_len[10];
+    const uint8_t payload[5] = {9, 9, 9, 9, 9};
+
+    for (int mode = INTEGRITY_SUM16; mode <= INTEGRITY_CRC16; mode++)
+    {
+        message_set_integrity_mode((Integrity_Mode)mode);
+        reset(FRAMING_LENGTH);
+
+        uint16_t bad_len = frame_build(bad, 0x01, payload, sizeof(payload));
+        bad[3] = 90; // real length is 12, the FSM now waits for 90 bytes
+        size_t len = bad_len;
+        memcpy(stream, bad, bad_len);
+        len += build_stream(&stream[len], frames, frame_len, 10);
+
+        uint32_t errors = fsm_integrity_error_count;
+        feed(stream, len);
+        check_frames(frames, frame_len, 10);
+        CHECK_EQ(fsm_integrity_error_count - errors, 1);
+        CHECK_EQ(fsm_replay_pending(), 0);
+    }
+}
+
+/**
+ * @brief Resync while the application still holds the frame: later bytes queue behind the held ones
+ */
+static void test_resync_with_slow_reader(void)
+{
+    uint8_t stream[512], frames[10][32], bad[32];
+    uint16_t frame_len[10];
+    const uint8_t payload[5] = {1, 2, 3, 4, 5};
+
+    message_set_integrity_mode(INTEGRITY_CRC16);
+    reset(FRAMING_LENGTH);
+    uint16_t bad_len = frame_build(bad, 0x01, payload, sizeof(payload));
+    bad[3] = 60;
+    memcpy(stream, bad, bad_len);
+    size_t len = bad_len + build_stream(&stream[bad_len], frames, frame_len, 10);
+
+    // Only poll every 7 bytes, nothing may be lost in between
+    for (size_t i = 0; i < len; i++)
+    {
+        fsm_get_message(stream[i], rx_buf);
+        if (i % 7 == 6)
+        {
+            take_frames();
+        }
+    }
+    take_frames();
+    check_frames(frames, frame_len, 10);
+}
+
+/**
+ * @brief Reader stalls with a frame held: the replay queue keeps one frame buffer of bytes, the rest is counted
+ */
+static void test_replay_overflow(void)
+{
+    uint8_t stream[1024], frames[30][32];
+    uint16_t frame_len[30];
+    size_t len = 0;
+
+    message_set_integrity_mode(INTEGRITY_CRC16);
+    reset(FRAMING_LENGTH);
+    for (int k = 0; k < 30; k++)
+    {
+        const uint8_t payload[5] = {(uint8_t)k, 1, 2, 3, 4};
+        frame_len[k] = frame_build(frames[k], 0x01, payload, sizeof(payload));
+        memcpy(&stream[len], frames[k], frame_len[k]);
+        len += frame_len[k];
+    }
+
+    // Nobody takes frame 0: everything behind it goes to the replay queue
+    uint32_t lost = fsm_replay_overflow_count;
+    for (size_t i = 0; i < len; i++)
+    {
+        fsm_get_message(stream[i], rx_buf);
+    }
+    size_t behind = len - frame_len[0];
+    CHECK(behind > FSM_MAX_FRAME_SIZE);
+    CHECK_EQ(fsm_replay_pending(), FSM_MAX_FRAME_SIZE);
+    CHECK_EQ(fsm_replay_overflow_count - lost, behind - FSM_MAX_FRAME_SIZE);
+
+    // The held frames come out intact, the frame cut by the overflow never completes
+    take_frames();
+    int kept = 1 + FSM_MAX_FRAME_SIZE / frame_len[1];
+    check_frames(frames, frame_len, kept);
+    CHECK_EQ(fsm_replay_pending(), 0);
+}
+
+static void test_garbage_between_frames(void)
+{
+    uint8_t stream[1024], frames[10][32];
+    uint16_t frame_len[10];
+
+    message_set_integrity_mode(INTEGRITY_CRC16);
+    reset(FRAMING_LENGTH);
+    srand(7);
+    size_t len = 0;
+    for (int k = 0; k < 10; k++)
+    {
+        uint8_t payload[5] = {(uint8_t)k, 1, 2, 3, 4};
+        frame_len[k] = frame_build(frames[k], 0x01, payload, sizeof(payload));
+        // Noise without START_BYTE, plus a lone start byte and a broken header
+        for (int g = 0; g < 5; g++)
+        {
+            uint8_t b = (uint8_t)rand();
+            stream[len++] = (b == START_BYTE) ? 0x00 : b;
+        }
+        stream[len++] = START_BYTE;
+        stream[len++] = 0x12;
+        memcpy(&stream[len], frames[k], frame_len[k]);
+        len += frame_len[k];
+    }
+    feed(stream, len);
+    check_frames(frames, frame_len, 10);
+}
+
+static void test_oversize_length(void)
+{
+    uint8_t frame[32];
+    const uint8_t payload[3] = {1, 2, 3};
+
+    message_set_integrity_mode(INTEGRITY_SUM16);
+    reset(FRAMING_LENGTH);
+    uint16_t len = frame_build(frame, 0x01, payload, sizeof(payload));
+    frame[3] = 0xFF; // 255 > FSM_MAX_FRAME_SIZE, rejected at the header
+    feed(frame, len);
+    CHECK_EQ(got_count, 0);
+
+    len = frame_build(frame, 0x01, payload, sizeof(payload));
+    feed(frame, len);
+    CHECK_EQ(got_count, 1);
+}
+
+static void test_cobs(void)
+{
+    uint8_t stream[1024], frame[FSM_MAX_FRAME_SIZE], payload[150];
+
+    message_set_integrity_mode(INTEGRITY_CRC16);
+    reset(FRAMING_COBS);
+    size_t len = 0;
+    uint16_t flen = 0;
+    for (int k = 0; k < 4; k++)
+    {
+        // Zeros inside the payload and a block longer than one COBS code
+        for (int j = 0; j < (int)sizeof(payload); j++)
+            payload[j] = (uint8_t)((j % 9 == 0) ? 0 : j + k);
+        flen = frame_build(frame, 0x02, payload, sizeof(payload));
+        len += frame_cobs_encode(frame, flen, &stream[len]);
+    }
+    feed(stream, len);
+    CHECK_EQ(got_count, 4);
+    CHECK_EQ(got_len[3], flen);
+    CHECK_MEM(got[3], frame, flen);
+
+    // A glitch costs only the frame it hits
+    uint32_t errors = fsm_integrity_error_count;
+    got_count = 0;
+    stream[10] ^= 0x40;
+    feed(stream, len);
+    CHECK_EQ(got_count, 3);
+    CHECK_EQ(fsm_integrity_error_count - errors, 1);
+}
+
+/**
+ * @brief Receive timeout as run by the RX task: a cut frame is dropped without an integrity error,
+ *        a completed frame waiting for the reader is kept
+ */
+static void test_poll_timeout(void)
+{
+    uint8_t frame[32];
+    const uint8_t payload[5] = {9, 8, 7, 6, 5};
+
+    message_set_integrity_mode(INTEGRITY_CRC16);
+    reset(FRAMING_LENGTH);
+    uint16_t len = frame_build(frame, 0x01, payload, sizeof(payload));
+    CHECK(!fsm_poll_timeout()); // idle
+    uint32_t errors = fsm_integrity_error_count;
+    for (uint16_t i = 0; i < len / 2; i++)
+    {
+        fsm_get_message(frame[i], rx_buf);
+    }
+    for (int i = 1; i < COUNTER_TIMEOUT; i++)
+    {
+        CHECK(fsm_poll_timeout());
+    }
+    CHECK(!fsm_poll_timeout());
+    feed(frame, len);
+    CHECK_EQ(got_count, 1);
+    CHECK_EQ(fsm_integrity_error_count, errors);
+
+    got_count = 0;
+    for (uint16_t i = 0; i < len; i++)
+    {
+        fsm_get_message(frame[i], rx_buf);
+    }
+    for (int i = 0; i < COUNTER_TIMEOUT * 2; i++)
+    {
+        CHECK(!fsm_poll_timeout());
+    }
+    take_frames();
+    CHECK_EQ(got_count, 1);
+    CHECK_MEM(got[0], frame, len);
+}
+
+int main(void)
+{
+    test_clean_stream();
+    test_corrupted_length_then_ten_frames();
+    test_resync_with_slow_reader();
+    test_replay_overflow();
+    test_garbage_between_frames();
+    test_oversize_length();
+    test_cobs();
+    test_poll_timeout();
+    return ht_summary("test_fsm");
+}
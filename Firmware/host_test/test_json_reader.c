@@ -0,0 +1,120 @@
+// json_reader: strict tokenizer errors and positions, schema binding, integer semantics against cJSON valueint
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "cJSON.h"
+#include "json_reader.h"
+
+static void check_tokenize_error(const char *js, json_read_status_t status, int pos)
+{
+    json_tok_t toks[16];
+    json_read_error_t err;
+    int n = json_tokenize(js, strlen(js), toks, 16, &err);
+    CHECK_EQ(n, -1);
+    if (n < 0 && (err.status != status || (pos >= 0 && err.pos != pos)))
+    {
+        printf("  %s: %s at %u, expected %s at %d\n", js, json_read_status_str(err.status), err.pos,
+               json_read_status_str(status), pos);
+        CHECK(false);
+    }
+}
+
+int main(void)
+{
+    json_tok_t toks[32];
+    json_read_error_t err;
+
+    static const char *const valid[] = {
+        "{}", "[]", "{\"a\":1}", "{\"a\":[1,2,{\"b\":null}],\"c\":\"x\\\"y\\u00e9\"}", " 0 ", "-0.5e+3", "\"s\"",
+        "true", "{\"TYPE\":\"response_data\",\"ID\":\"AA\",\"DST\":\"BB\",\"data\":{\"temp\":25,\"humi\":60}}",
+    };
+    for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++)
+    {
+        int n = json_tokenize(valid[i], strlen(valid[i]), toks, 32, &err);
+        CHECK(n > 0);
+        if (n > 0)
+            CHECK_EQ(toks[0].next, n);
+    }
+
+    // Not '\0' terminated: the length bounds the input
+    CHECK_EQ(json_tokenize("{\"a\":1}garbage", 7, toks, 32, &err), 3);
+
+    check_tokenize_error("{\"a\":1,}", JSON_READ_ERR_SYNTAX, 7);
+    check_tokenize_error("{\"a\" 1}", JSON_READ_ERR_SYNTAX, 5);
+    check_tokenize_error("{\"a\":01}", JSON_READ_ERR_SYNTAX, 6);
+    check_tokenize_error("{\"a\":tru}", JSON_READ_ERR_SYNTAX, 8);
+    check_tokenize_error("{\"a\":1", JSON_READ_ERR_TRUNCATED, 6);
+    check_tokenize_error("{\"a\":\"x", JSON_READ_ERR_TRUNCATED, -1);
+    check_tokenize_error("{\"a\":\"\\q\"}", JSON_READ_ERR_SYNTAX, -1);
+    check_tokenize_error("{\"a\":1} x", JSON_READ_ERR_SYNTAX, 8);
+    check_tokenize_error("[[[[[[[[[1]]]]]]]]]", JSON_READ_ERR_DEPTH, -1);
+    check_tokenize_error("[1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16]", JSON_READ_ERR_TOKENS, -1);
+    check_tokenize_error("{1:2}", JSON_READ_ERR_SYNTAX, 1);
+    check_tokenize_error("", JSON_READ_ERR_TRUNCATED, 0);
+
+    // Bind: nested paths, wrong types skipped when optional, first of duplicate keys, fractions truncated
+    char type[24], id[18], dst[18], name[8];
+    int32_t temp = -1, humi = -1, lux = -1;
+    bool on = false;
+    const json_field_t fields[] = {
+        {"TYPE", JSON_FIELD_STRING, true, type, sizeof(type)},
+        {"ID", JSON_FIELD_STRING, true, id, sizeof(id)},
+        {"DST", JSON_FIELD_STRING, false, dst, sizeof(dst)},
+        {"data.temp", JSON_FIELD_INT, false, &temp, 0},
+        {"data.humi", JSON_FIELD_INT, false, &humi, 0},
+        {"data.lux", JSON_FIELD_INT, false, &lux, 0},
+        {"data.x.on", JSON_FIELD_BOOL, false, &on, 0},
+    };
+    uint32_t found;
+    const char *js = "{\"TYPE\":\"response_data\",\"ID\":\"AA:BB\",\"data\":{\"temp\":25.9,\"humi\":-3e1,\"lux\":\"no\","
+                     "\"x\":{\"on\":true}},\"TYPE\":\"dup\"}";
+    CHECK(json_bind(js, strlen(js), fields, 7, &found, &err));
+    CHECK(strcmp(type, "response_data") == 0);
+    CHECK(strcmp(id, "AA:BB") == 0);
+    CHECK_EQ(temp, 25);
+    CHECK_EQ(humi, -30);
+    CHECK_EQ(lux, -1);
+    CHECK(on);
+    CHECK_EQ(found, 1 | 2 | 8 | 16 | 64);
+
+    js = "{\"ID\":\"x\"}";
+    CHECK(!json_bind(js, strlen(js), fields, 7, &found, &err));
+    CHECK_EQ(err.status, JSON_READ_ERR_MISSING);
+    CHECK(err.field && strcmp(err.field, "TYPE") == 0);
+
+    js = "{\"TYPE\":5,\"ID\":\"x\"}";
+    CHECK(!json_bind(js, strlen(js), fields, 7, &found, &err));
+    CHECK_EQ(err.status, JSON_READ_ERR_TYPE);
+    CHECK(err.field && strcmp(err.field, "TYPE") == 0);
+
+    const json_field_t short_field[] = {{"n", JSON_FIELD_STRING, true, name, sizeof(name)}};
+    js = "{\"n\":\"12345678\"}";
+    CHECK(!json_bind(js, strlen(js), short_field, 1, NULL, &err));
+    CHECK_EQ(err.status, JSON_READ_ERR_OVERFLOW);
+    js = "{\"n\":\"\\ud83d\\ude00a\"}";
+    CHECK(json_bind(js, strlen(js), short_field, 1, NULL, &err));
+    CHECK(strcmp(name, "\xf0\x9f\x98\x80" "a") == 0);
+    js = "{\"n\":\"a\\u0000b\"}";
+    CHECK(!json_bind(js, strlen(js), short_field, 1, NULL, &err));
+
+    // Integers read like cJSON valueint: truncated toward zero, saturated at the int32 range
+    static const char *const nums[] = {"0", "-0", "7", "-7", "2147483647", "2147483648", "-2147483648",
+                                       "-2147483649", "99999999999", "1e3", "1.5e1", "-2.7", "1e-2", "123e-1",
+                                       "0.5", "1e40", "-1e40"};
+    for (size_t i = 0; i < sizeof(nums) / sizeof(nums[0]); i++)
+    {
+        char doc[64];
+        snprintf(doc, sizeof(doc), "{\"v\":%s}", nums[i]);
+        int32_t v = 0;
+        const json_field_t f[] = {{"v", JSON_FIELD_INT, true, &v, 0}};
+        CHECK(json_bind(doc, strlen(doc), f, 1, NULL, &err));
+        cJSON *root = cJSON_Parse(doc);
+        int cv = cJSON_GetObjectItem(root, "v")->valueint;
+        cJSON_Delete(root);
+        if (cv != v)
+            printf("  %s: %ld, cJSON %d\n", nums[i], (long)v, cv);
+        CHECK_EQ(v, cv);
+    }
+
+    return ht_summary("test_json_reader");
+}
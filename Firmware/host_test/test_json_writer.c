@@ -0,0 +1,136 @@
+// json_writer: same output as cJSON_PrintUnformatted, escaping, nesting and overflow
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "cJSON.h"
+#include "json_writer.h"
+
+static char *cjson_telemetry(int lux, int temp, int humi)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "type", "telemetry");
+    cJSON *data = cJSON_CreateObject();
+    cJSON_AddNumberToObject(data, "lux", lux);
+    cJSON_AddNumberToObject(data, "temp", temp);
+    cJSON_AddNumberToObject(data, "humi", humi);
+    cJSON_AddItemToObject(root, "data", data);
+    char *s = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return s;
+}
+
+static size_t writer_telemetry(char *buf, size_t size, int lux, int temp, int humi)
+{
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "type", "telemetry");
+    json_writer_begin_object(&w, "data");
+    json_writer_int(&w, "lux", lux);
+    json_writer_int(&w, "temp", temp);
+    json_writer_int(&w, "humi", humi);
+    json_writer_end_object(&w);
+    json_writer_end_object(&w);
+    return json_writer_finish(&w);
+}
+
+int main(void)
+{
+    char buf[128];
+    json_writer_t w;
+
+    // Same bytes as cJSON for the telemetry message
+    int mismatches = 0;
+    for (int i = -70000; i < 70000; i += 37)
+    {
+        char *s = cjson_telemetry(i, i / 3, -i);
+        size_t len = writer_telemetry(buf, sizeof(buf), i, i / 3, -i);
+        mismatches += len != strlen(s) || strcmp(s, buf) != 0;
+        free(s);
+    }
+    CHECK_EQ(mismatches, 0);
+
+    // Escaping of keys and values
+    static const char *const strs[] = {"plain", "q\"uote", "back\\slash", "nl\n\t\r\b\f", "\x01\x1f ctl",
+                                       "utf8 \xc3\xa9", ""};
+    for (size_t i = 0; i < sizeof(strs) / sizeof(strs[0]); i++)
+    {
+        cJSON *root = cJSON_CreateObject();
+        cJSON_AddStringToObject(root, strs[i], strs[i]);
+        char *s = cJSON_PrintUnformatted(root);
+        cJSON_Delete(root);
+
+        json_writer_init(&w, buf, sizeof(buf));
+        json_writer_begin_object(&w, NULL);
+        json_writer_string(&w, strs[i], strs[i]);
+        json_writer_end_object(&w);
+        CHECK(json_writer_finish(&w) > 0);
+        CHECK(strcmp(s, buf) == 0);
+        free(s);
+    }
+
+    // Embedded NUL through string_n
+    json_writer_init(&w, buf, sizeof(buf));
+    json_writer_string_n(&w, NULL, "a\0b", 3);
+    CHECK(json_writer_finish(&w) > 0);
+    CHECK(strcmp(buf, "\"a\\u0000b\"") == 0);
+
+    // Arrays, nesting, double, null
+    json_writer_init(&w, buf, sizeof(buf));
+    json_writer_begin_array(&w, NULL);
+    for (int i = 0; i < 3; i++)
+    {
+        json_writer_begin_object(&w, NULL);
+        json_writer_int(&w, "i", i);
+        json_writer_bool(&w, "b", i & 1);
+        json_writer_end_object(&w);
+    }
+    json_writer_double(&w, NULL, 3.25, 6);
+    json_writer_null(&w, NULL);
+    json_writer_uint(&w, NULL, 4294967295u);
+    json_writer_raw(&w, NULL, "{\"r\":1}");
+    json_writer_end_array(&w);
+    CHECK(json_writer_finish(&w) > 0);
+    CHECK(strcmp(buf, "[{\"i\":0,\"b\":false},{\"i\":1,\"b\":true},{\"i\":2,\"b\":false},3.25,null,4294967295,{\"r\":1}]") == 0);
+
+    // NaN / Inf as null like cJSON
+    json_writer_init(&w, buf, sizeof(buf));
+    json_writer_begin_array(&w, NULL);
+    json_writer_double(&w, NULL, 0.0 / 0.0, 6);
+    json_writer_double(&w, NULL, 1.0 / 0.0, 6);
+    json_writer_end_array(&w);
+    CHECK(json_writer_finish(&w) > 0);
+    CHECK(strcmp(buf, "[null,null]") == 0);
+
+    // Every buffer size: never writes past it, always terminated, 0 unless the whole document fits
+    size_t full = writer_telemetry(buf, sizeof(buf), 123, 25, 60);
+    for (size_t n = 1; n < 60; n++)
+    {
+        char small[64];
+        memset(small, 'X', sizeof(small));
+        size_t len = writer_telemetry(small, n, 123, 25, 60);
+        CHECK_EQ(len, n > full ? full : 0);
+        CHECK(small[n] == 'X');
+        CHECK(strlen(small) < n);
+    }
+
+    // Unclosed object, closing too many, nesting past the limit
+    json_writer_init(&w, buf, sizeof(buf));
+    json_writer_begin_object(&w, NULL);
+    CHECK_EQ(json_writer_finish(&w), 0);
+
+    json_writer_init(&w, buf, sizeof(buf));
+    json_writer_begin_object(&w, NULL);
+    json_writer_end_object(&w);
+    json_writer_end_object(&w);
+    CHECK_EQ(json_writer_finish(&w), 0);
+
+    json_writer_init(&w, buf, sizeof(buf));
+    for (int i = 0; i < JSON_WRITER_MAX_DEPTH; i++)
+        json_writer_begin_array(&w, NULL);
+    for (int i = 0; i < JSON_WRITER_MAX_DEPTH; i++)
+        json_writer_end_array(&w);
+    CHECK_EQ(json_writer_finish(&w), 0);
+
+    return ht_summary("test_json_writer");
+}
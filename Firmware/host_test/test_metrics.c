@@ -0,0 +1,90 @@
+// Prometheus text rendering (metrics.c): counters with labels, gauges, sampled gauges, histograms, writer errors
+
+#include "host_test.h"
+#include "metrics.h"
+
+static uint32_t count_a, labelled[2];
+static int32_t gauge = -5;
+static const uint32_t bounds[] = {10, 100, 1000};
+static metric_histogram_t hist = {bounds, 3};
+
+static uint32_t sample_42(void)
+{
+    return 42;
+}
+
+static const metric_desc_t table[] = {
+    {"a_total", "A count", NULL, METRIC_COUNTER, .u32 = &count_a},
+    {"l_total", "L", "k=\"x\"", METRIC_COUNTER, .u32 = &labelled[0]},
+    {"l_total", NULL, "k=\"y\"", METRIC_COUNTER, .u32 = &labelled[1]},
+    {"g", "G", NULL, METRIC_GAUGE, .i32 = &gauge},
+    {"s", "S", NULL, METRIC_GAUGE, .sample = sample_42},
+    {"h_ms", "H", "k=\"x\"", METRIC_HISTOGRAM, .histogram = &hist},
+};
+
+static char out[4096];
+static size_t out_len;
+
+static int write_out(void *ctx, const char *data, size_t len)
+{
+    if (out_len + len >= sizeof(out))
+        return 0;
+    memcpy(&out[out_len], data, len);
+    out_len += len;
+    out[out_len] = '\0';
+    return 1;
+}
+
+static int writes_left;
+
+static int write_fail(void *ctx, const char *data, size_t len)
+{
+    return --writes_left > 0;
+}
+
+static int count_substr(const char *s, const char *needle)
+{
+    int n = 0;
+    for (const char *p = s; (p = strstr(p, needle)) != NULL; p++)
+        n++;
+    return n;
+}
+
+int main(void)
+{
+    metrics_init(table, sizeof(table) / sizeof(table[0]));
+    metric_inc(&count_a);
+    metric_add(&labelled[1], 3);
+    metric_observe(&hist, 5);
+    metric_observe(&hist, 10);
+    metric_observe(&hist, 11);
+    metric_observe(&hist, 5000);
+
+    CHECK(metrics_render(write_out, NULL));
+    CHECK(strstr(out, "# TYPE a_total counter\n") != NULL);
+    CHECK(strstr(out, "a_total 1\n") != NULL);
+
+    // Cumulative buckets, le=bound inclusive, then +Inf, sum and count
+    CHECK(strstr(out, "h_ms_bucket{k=\"x\",le=\"10\"} 2\n") != NULL);
+    CHECK(strstr(out, "h_ms_bucket{k=\"x\",le=\"100\"} 3\n") != NULL);
+    CHECK(strstr(out, "h_ms_bucket{k=\"x\",le=\"1000\"} 3\n") != NULL);
+    CHECK(strstr(out, "h_ms_bucket{k=\"x\",le=\"+Inf\"} 4\n") != NULL);
+    CHECK(strstr(out, "h_ms_sum{k=\"x\"} 5026\n") != NULL);
+    CHECK(strstr(out, "h_ms_count{k=\"x\"} 4\n") != NULL);
+    CHECK(strstr(out, "# TYPE h_ms histogram\n") != NULL);
+
+    // One HELP / TYPE per family, even with several label sets
+    CHECK_EQ(count_substr(out, "# TYPE l_total"), 1);
+    CHECK_EQ(count_substr(out, "# HELP l_total"), 1);
+    CHECK(strstr(out, "l_total{k=\"x\"} 0\n") != NULL);
+    CHECK(strstr(out, "l_total{k=\"y\"} 3\n") != NULL);
+
+    CHECK(strstr(out, "g -5\n") != NULL);
+    CHECK(strstr(out, "s 42\n") != NULL);
+
+    // A failing writer stops the render
+    writes_left = 3;
+    CHECK(!metrics_render(write_fail, NULL));
+
+    return ht_summary("test_metrics");
+}
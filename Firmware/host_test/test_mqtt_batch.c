@@ -0,0 +1,99 @@
+// Gateway telemetry batching (mqtt_batch.c): dt / age_ms stamping, flush on max items, topic change and size,
+// the split when the next reading does not fit, oversize readings, the flush deadline and tick wrap-around
+
+#include "host_test.h"
+#include "mqtt_batch.h"
+
+#define PUB_MAX 8
+
+static char pub_topic[PUB_MAX][MQTT_BATCH_TOPIC_LEN];
+static char pub_payload[PUB_MAX][512];
+static int pub_count;
+
+static void on_publish(const char *topic, const char *payload)
+{
+    CHECK(pub_count < PUB_MAX);
+    if (pub_count < PUB_MAX)
+    {
+        snprintf(pub_topic[pub_count], sizeof(pub_topic[0]), "%s", topic);
+        snprintf(pub_payload[pub_count], sizeof(pub_payload[0]), "%s", payload);
+        pub_count++;
+    }
+}
+
+static void setup(mqtt_batch_t *b, char *buf, uint16_t size, uint8_t max_items)
+{
+    const mqtt_batch_config_t cfg = {buf, size, max_items, 1000, on_publish};
+    mqtt_batch_init(b, &cfg);
+    pub_count = 0;
+}
+
+int main(void)
+{
+    mqtt_batch_t b;
+    char buf[512];
+
+    // ---- dt from the first reading, age_ms at publish, flush on max_items ----
+    setup(&b, buf, sizeof(buf), 3);
+    CHECK_EQ(mqtt_batch_due_in_ms(&b, 0), MQTT_BATCH_NEVER);
+    CHECK(mqtt_batch_add(&b, "home/node1", "{\"v\":1}", 1000, 1010));
+    CHECK(mqtt_batch_add(&b, "home/node1", "{\"v\":2}", 1120, 1130));
+    CHECK_EQ(pub_count, 0);
+    CHECK_EQ(mqtt_batch_due_in_ms(&b, 1500), 500);
+    CHECK(mqtt_batch_add(&b, "home/node1", "{\"v\":3}", 1250, 1300));
+    CHECK_EQ(pub_count, 1);
+    CHECK(strcmp(pub_topic[0], "home/node1") == 0);
+    CHECK(strcmp(pub_payload[0], "{\"type\":\"telemetry\",\"batch\":[{\"dt\":0,\"data\":{\"v\":1}},"
+                                 "{\"dt\":120,\"data\":{\"v\":2}},{\"dt\":250,\"data\":{\"v\":3}}],\"age_ms\":300}") == 0);
+    CHECK_EQ(mqtt_batch_due_in_ms(&b, 1300), MQTT_BATCH_NEVER);
+
+    // ---- Topic change: the pending batch goes out on its own topic first ----
+    CHECK(mqtt_batch_add(&b, "home/node1", "{\"v\":4}", 2000, 2000));
+    CHECK(mqtt_batch_add(&b, "home/node2", "{\"v\":5}", 2040, 2050));
+    CHECK_EQ(pub_count, 2);
+    CHECK(strcmp(pub_topic[1], "home/node1") == 0);
+    CHECK(strcmp(pub_payload[1], "{\"type\":\"telemetry\",\"batch\":[{\"dt\":0,\"data\":{\"v\":4}}],\"age_ms\":50}") == 0);
+    // The new batch starts at the reading that changed the topic
+    CHECK_EQ(mqtt_batch_due_in_ms(&b, 2050), 990);
+    CHECK_EQ(mqtt_batch_due_in_ms(&b, 3040), 0);
+    mqtt_batch_flush(&b, 3100);
+    CHECK_EQ(pub_count, 3);
+    CHECK(strcmp(pub_topic[2], "home/node2") == 0);
+    CHECK(strcmp(pub_payload[2], "{\"type\":\"telemetry\",\"batch\":[{\"dt\":0,\"data\":{\"v\":5}}],\"age_ms\":1060}") == 0);
+    mqtt_batch_flush(&b, 3200); // nothing pending
+    CHECK_EQ(pub_count, 3);
+
+    // ---- Size: split when the next reading does not fit, every payload stays inside the buffer ----
+    char small[96];
+    setup(&b, small, sizeof(small), 8);
+    CHECK(mqtt_batch_add(&b, "t", "{\"v\":1}", 0, 0));
+    CHECK(mqtt_batch_add(&b, "t", "{\"v\":2}", 10, 10)); // 29 + 22 + 24 > 96 - 24
+    CHECK_EQ(pub_count, 1);
+    CHECK(strcmp(pub_payload[0], "{\"type\":\"telemetry\",\"batch\":[{\"dt\":0,\"data\":{\"v\":1}}],\"age_ms\":10}") == 0);
+    mqtt_batch_flush(&b, 20); // dt restarted at the reading that was split off
+    CHECK(strstr(pub_payload[1], "[{\"dt\":0,\"data\":{\"v\":2}}]") != NULL);
+    CHECK(strlen(pub_payload[1]) < sizeof(small));
+
+    // A reading that cannot fit even alone is dropped, the pending batch is published before
+    CHECK(mqtt_batch_add(&b, "t", "{\"v\":3}", 20, 20));
+    char big[80];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    CHECK(!mqtt_batch_add(&b, "t", big, 30, 30));
+    CHECK_EQ(pub_count, 3);
+    CHECK(strstr(pub_payload[2], "{\"v\":3}") != NULL);
+    CHECK_EQ(mqtt_batch_due_in_ms(&b, 30), MQTT_BATCH_NEVER);
+    CHECK(mqtt_batch_add(&b, "t", "{\"v\":4}", 40, 40)); // and batching goes on
+    CHECK_EQ(b.count, 1);
+
+    // ---- Free running ms counter wrapping inside a batch ----
+    setup(&b, buf, sizeof(buf), 8);
+    CHECK(mqtt_batch_add(&b, "t", "1", 0xFFFFFF00u, 0xFFFFFF00u));
+    CHECK(mqtt_batch_add(&b, "t", "2", 0x00000040u, 0x00000040u));
+    CHECK_EQ(mqtt_batch_due_in_ms(&b, 0x00000040u), 1000 - 0x140);
+    mqtt_batch_flush(&b, 0x00000100u);
+    CHECK(strcmp(pub_payload[0], "{\"type\":\"telemetry\",\"batch\":[{\"dt\":0,\"data\":1},{\"dt\":320,\"data\":2}],"
+                                 "\"age_ms\":512}") == 0);
+
+    return ht_summary("mqtt_batch");
+}
@@ -0,0 +1,106 @@
+// In-process MQTT broker (mqtt_loopback.c): filter matching, retained messages, QoS / message ids, lock hooks
+
+#include "host_test.h"
+#include "mqtt_loopback.h"
+
+static int hits[4];
+static int last_qos;
+static bool last_retained;
+static char last_payload[64];
+static int locks, unlocks;
+
+static void on_message(void *ctx, const char *topic, int topic_len, const void *data, int len, int qos, bool retained)
+{
+    hits[(intptr_t)ctx]++;
+    last_qos = qos;
+    last_retained = retained;
+    snprintf(last_payload, sizeof(last_payload), "%.*s", len, (const char *)data);
+}
+
+static void count_lock(void *arg)
+{
+    locks++;
+}
+
+static void count_unlock(void *arg)
+{
+    unlocks++;
+}
+
+int main(void)
+{
+    // '+' / '#' and the '$' rule
+    CHECK(mqtt_topic_match("a/#", "a", 1));
+    CHECK(mqtt_topic_match("a/#", "a/b/c", 5));
+    CHECK(mqtt_topic_match("a/+/c", "a/b/c", 5));
+    CHECK(!mqtt_topic_match("a/+/c", "a/b/d", 5));
+    CHECK(mqtt_topic_match("a/+", "a/", 2));
+    CHECK(!mqtt_topic_match("a/+", "a", 1));
+    CHECK(!mqtt_topic_match("#", "$SYS/x", 6));
+    CHECK(mqtt_topic_match("$SYS/#", "$SYS/x", 6));
+    CHECK(mqtt_topic_match("+/+", "/x", 2));
+    CHECK(!mqtt_topic_match("a/b", "a/b/c", 5));
+    CHECK(!mqtt_topic_match("a/b/c", "a/b", 3));
+    CHECK(mqtt_topic_match("a/b", "a/bXXX", 3)); // topic is (pointer, length)
+
+    const mqtt_loopback_lock_t lock = {count_lock, count_unlock, NULL};
+    mqtt_loopback_init(&lock);
+
+    // Malformed filters and publish topics
+    CHECK(mqtt_loopback_subscribe("a/#b", 0, on_message, 0) < 0);
+    CHECK(mqtt_loopback_subscribe("a+/b", 0, on_message, 0) < 0);
+    CHECK_EQ(mqtt_loopback_publish("a/+", NULL, 0, 0, false), -1);
+
+    // Retained message goes to a new subscription before subscribe() returns
+    mqtt_loopback_publish("home/r", "x", 1, 1, true);
+    int sub = mqtt_loopback_subscribe("home/+", 1, on_message, (void *)1);
+    CHECK(sub >= 0);
+    CHECK_EQ(hits[1], 1);
+    CHECK(last_retained);
+    CHECK_EQ(last_qos, 1);
+    CHECK(strcmp(last_payload, "x") == 0);
+
+    // Delivered QoS is the lower of publish and subscription
+    mqtt_loopback_subscribe("#", 0, on_message, (void *)2);
+    CHECK_EQ(hits[2], 1);
+    CHECK_EQ(last_qos, 0);
+
+    // QoS 1 gets a message id, every matching subscription gets one copy
+    int id = mqtt_loopback_publish("home/q", "y", 1, 1, false);
+    CHECK(id > 0);
+    CHECK_EQ(hits[1], 2);
+    CHECK_EQ(hits[2], 2);
+    CHECK(!last_retained);
+    CHECK_EQ(mqtt_loopback_publish("home/q", "y", 1, 0, false), 0);
+
+    // Empty retained payload clears the topic
+    mqtt_loopback_publish("home/r", "", 0, 0, true);
+    int before = hits[3];
+    mqtt_loopback_subscribe("home/r", 0, on_message, (void *)3);
+    CHECK_EQ(hits[3], before);
+
+    // No delivery after unsubscribe
+    mqtt_loopback_unsubscribe(sub);
+    before = hits[1];
+    mqtt_loopback_publish("home/q", "z", 1, 0, false);
+    CHECK_EQ(hits[1], before);
+
+    mqtt_loopback_stats_t st;
+    mqtt_loopback_get_stats(&st);
+    CHECK(st.published >= 4);
+    CHECK(st.delivered >= 6);
+    CHECK(locks > 0);
+    CHECK_EQ(locks, unlocks);
+
+    // Percentiles sort in place, rate over the elapsed time
+    uint32_t v[] = {5, 1, 3, 2, 4};
+    mqtt_bench_result_t r;
+    mqtt_bench_result(v, 5, 1000000, &r);
+    CHECK_EQ(r.count, 5);
+    CHECK_EQ(r.p50_us, 3);
+    CHECK_EQ(r.p99_us, 5);
+    CHECK_EQ(r.max_us, 5);
+    CHECK_EQ(r.msgs_per_s, 5);
+
+    return ht_summary("test_mqtt_loopback");
+}
@@ -0,0 +1,312 @@
+// my_mqtt against a fake esp-mqtt client: persistent session (subscribe only when the broker lost it),
+// TLS transport setup, fragmented receive into the pool, overflow / oversize drops, loopback mode
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "my_mqtt.h"
+#include "mqtt_loopback.h"
+#include "esp_transport_ssl.h"
+#include "esp_crt_bundle.h"
+
+// ============ FAKE CLIENT ============
+struct esp_mqtt_client
+{
+    esp_mqtt_client_config_t cfg;
+    esp_event_handler_t handler;
+    void *handler_arg;
+    bool started;
+};
+
+struct esp_transport_item_t
+{
+    int port;
+    const char *cert;
+    bool bundle;
+    bool tickets;
+};
+
+static struct esp_mqtt_client fake_client;
+static struct esp_transport_item_t fake_ssl;
+static int subs;
+static int sub_qos[8];
+static char sub_topic[8][64];
+static int pubs;
+static int connected_cbs, disconnected_cbs;
+
+esp_err_t esp_crt_bundle_attach(void *conf)
+{
+    return ESP_OK;
+}
+
+esp_transport_handle_t esp_transport_ssl_init(void)
+{
+    memset(&fake_ssl, 0, sizeof(fake_ssl));
+    return &fake_ssl;
+}
+
+esp_err_t esp_transport_set_default_port(esp_transport_handle_t t, int port)
+{
+    t->port = port;
+    return ESP_OK;
+}
+
+void esp_transport_ssl_set_cert_data(esp_transport_handle_t t, const char *data, int len)
+{
+    t->cert = data;
+}
+
+void esp_transport_ssl_crt_bundle_attach(esp_transport_handle_t t, esp_err_t (*crt_bundle_attach)(void *conf))
+{
+    t->bundle = crt_bundle_attach == esp_crt_bundle_attach;
+}
+
+void esp_transport_ssl_session_tickets_enable(esp_transport_handle_t t)
+{
+    t->tickets = true;
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    memset(&fake_client, 0, sizeof(fake_client));
+    fake_client.cfg = *config;
+    return &fake_client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, int32_t event, esp_event_handler_t handler,
+                                         void *arg)
+{
+    client->handler = handler;
+    client->handler_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    client->started = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client)
+{
+    return ESP_OK;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos)
+{
+    if (subs < 8)
+    {
+        sub_qos[subs] = qos;
+        snprintf(sub_topic[subs], sizeof(sub_topic[0]), "%s", topic);
+    }
+    return ++subs;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos,
+                            int retain)
+{
+    pubs++;
+    return qos > 0 ? pubs : 0;
+}
+
+int esp_mqtt_client_get_outbox_size(esp_mqtt_client_handle_t client)
+{
+    return 42;
+}
+
+// ============ EVENTS ============
+static void fire(esp_mqtt_event_t *event)
+{
+    event->client = &fake_client;
+    fake_client.handler(fake_client.handler_arg, "MQTT_EVENTS", event->event_id, event);
+}
+
+static void broker_connect(int session_present)
+{
+    esp_mqtt_event_t before = {.event_id = MQTT_EVENT_BEFORE_CONNECT};
+    esp_mqtt_event_t conn = {.event_id = MQTT_EVENT_CONNECTED, .session_present = session_present};
+    fire(&before);
+    fire(&conn);
+}
+
+static void data(const char *topic, const char *payload, int offset, int len, int total)
+{
+    esp_mqtt_event_t event = {
+        .event_id = MQTT_EVENT_DATA,
+        .topic = offset == 0 ? (char *)topic : NULL, // esp-mqtt only sets the topic on the first fragment
+        .topic_len = offset == 0 ? (int)strlen(topic) : 0,
+        .data = (char *)payload + offset,
+        .data_len = len,
+        .total_data_len = total,
+        .current_data_offset = offset,
+        .qos = 1,
+    };
+    fire(&event);
+}
+
+static void on_connected(void)
+{
+    connected_cbs++;
+}
+
+static void on_disconnected(void)
+{
+    disconnected_cbs++;
+}
+
+static my_mqtt_init_t base_cfg(const char *server, bool persistent)
+{
+    my_mqtt_init_t cfg = {
+        .topic_sub_extra = {"cmd/#", "sub/in", NULL, NULL}, // the duplicate of topic_sub is skipped
+        .on_connected_cb = on_connected,
+        .on_disconnected_cb = on_disconnected,
+        .outbox_limit = 4096,
+        .client_id = "gw-1",
+        .persistent_session = persistent,
+    };
+    snprintf(cfg.server, sizeof(cfg.server), "%s", server);
+    snprintf(cfg.topic_sub, sizeof(cfg.topic_sub), "sub/in");
+    return cfg;
+}
+
+int main(void)
+{
+    my_mqtt_message_t *msg;
+    my_mqtt_message_t copy;
+    my_mqtt_conn_stats_t conn;
+    my_mqtt_rx_stats_t rx;
+
+    // Not initialised yet
+    CHECK_EQ(my_mqtt_pub_opts("t", "x", 0, false), -1);
+    CHECK(!my_mqtt_getmess(&copy));
+
+    // ---- Persistent session: clean_session = 0, QoS1 subscriptions, resubscribe only on a new session ----
+    my_mqtt_init_t cfg = base_cfg("mqtt://broker:1883", true);
+    CHECK_EQ(my_mqtt_init(&cfg), ESP_OK);
+    CHECK(fake_client.started);
+    CHECK(fake_client.cfg.session.disable_clean_session);
+    CHECK_EQ(fake_client.cfg.outbox.limit, 4096);
+    CHECK(strcmp(fake_client.cfg.credentials.client_id, "gw-1") == 0);
+    CHECK(fake_client.cfg.network.transport == NULL);
+
+    broker_connect(0);
+    CHECK_EQ(subs, 2);
+    CHECK(strcmp(sub_topic[0], "sub/in") == 0);
+    CHECK(strcmp(sub_topic[1], "cmd/#") == 0);
+    CHECK_EQ(sub_qos[0], 1);
+    CHECK_EQ(sub_qos[1], 1);
+    CHECK_EQ(connected_cbs, 1);
+
+    // Reconnect into the kept session: no SUBSCRIBE, counted as resumed
+    esp_mqtt_event_t disc = {.event_id = MQTT_EVENT_DISCONNECTED};
+    fire(&disc);
+    CHECK_EQ(disconnected_cbs, 1);
+    broker_connect(1);
+    CHECK_EQ(subs, 2);
+    CHECK_EQ(connected_cbs, 2);
+
+    // Broker dropped the session (expiry, restart): subscribe again
+    broker_connect(0);
+    CHECK_EQ(subs, 4);
+
+    my_mqtt_get_conn_stats(&conn);
+    CHECK_EQ(conn.connects, 3);
+    CHECK_EQ(conn.sessions_resumed, 1);
+    CHECK(conn.min_ms <= conn.max_ms);
+
+    // Publishes go to the client, the outbox size is the client's
+    CHECK_EQ(my_mqtt_pub_opts("pub/x", "1", 1, false), 1);
+    CHECK_EQ(my_mqtt_pub_bin("pub/x", "\x01\x02", 2, 0, false), 0);
+    CHECK_EQ(my_mqtt_outbox_size(), 42);
+
+    // ---- Receive: fragments are assembled in place, overflow and oversize are dropped ----
+    static char big[400];
+    memset(big, 'b', sizeof(big) - 1);
+    data("cmd/a", big, 0, 150, 399);
+    data("cmd/a", big, 150, 150, 399);
+    data("cmd/a", big, 300, 99, 399);
+    CHECK(my_mqtt_acquire(&msg, 0));
+    CHECK(strcmp(msg->topic, "cmd/a") == 0);
+    CHECK_EQ(msg->payload_len, 399);
+    CHECK_EQ(msg->payload[399], '\0');
+    my_mqtt_release(msg);
+
+    // A missed fragment drops the message, the slot is reused by the next one
+    data("cmd/b", big, 0, 100, 399);
+    data("cmd/b", big, 200, 100, 399);
+    data("cmd/c", "ok", 0, 2, 2);
+    CHECK(my_mqtt_getmess(&copy));
+    CHECK(strcmp(copy.topic, "cmd/c") == 0);
+    CHECK(strcmp(copy.payload, "ok") == 0);
+    CHECK(!my_mqtt_getmess(&copy));
+
+    static char huge[600];
+    memset(huge, 'h', sizeof(huge));
+    data("cmd/h", huge, 0, 300, 600);
+    data("cmd/h", huge, 300, 300, 600);
+    CHECK(!my_mqtt_getmess(&copy));
+
+    for (int i = 0; i < MY_MQTT_RX_POOL_SIZE + 2; i++)
+    {
+        data("cmd/q", "q", 0, 1, 1);
+    }
+    my_mqtt_get_rx_stats(&rx);
+    CHECK_EQ(rx.received, 2 + MY_MQTT_RX_POOL_SIZE);
+    CHECK_EQ(rx.fragmented, 1);
+    CHECK_EQ(rx.dropped_oversize, 1);
+    CHECK_EQ(rx.dropped_overflow, 2);
+    CHECK_EQ(rx.max_queued, MY_MQTT_RX_POOL_SIZE);
+    for (int i = 0; i < MY_MQTT_RX_POOL_SIZE; i++)
+    {
+        CHECK(my_mqtt_acquire(&msg, 0));
+        my_mqtt_release(msg);
+    }
+    CHECK(!my_mqtt_acquire(&msg, 0));
+    my_mqtt_release(&copy); // not a pool buffer, ignored
+
+    // ---- Clean session: QoS0 subscriptions, a "session present" on the first connect still subscribes ----
+    subs = 0;
+    cfg = base_cfg("mqtt://broker:1883", false);
+    my_mqtt_init(&cfg);
+    CHECK(!fake_client.cfg.session.disable_clean_session);
+    broker_connect(0);
+    CHECK_EQ(subs, 2);
+    CHECK_EQ(sub_qos[0], 0);
+
+    // ---- mqtts:// with TLS resume: own SSL transport with session tickets ----
+    cfg = base_cfg("mqtts://broker:8883", true);
+    cfg.tls_resume = true;
+    my_mqtt_init(&cfg);
+    CHECK(fake_client.cfg.network.transport == &fake_ssl);
+    CHECK_EQ(fake_ssl.port, 8883);
+    CHECK(fake_ssl.bundle);
+    CHECK(fake_ssl.tickets);
+
+    cfg.ca_cert_pem = "-----BEGIN CERTIFICATE-----";
+    my_mqtt_init(&cfg);
+    CHECK(fake_ssl.cert == cfg.ca_cert_pem);
+    CHECK(!fake_ssl.bundle);
+
+    // Without resume the certificate goes to the client config
+    cfg.tls_resume = false;
+    my_mqtt_init(&cfg);
+    CHECK(fake_client.cfg.network.transport == NULL);
+    CHECK(fake_client.cfg.broker.verification.certificate == cfg.ca_cert_pem);
+    cfg.ca_cert_pem = NULL;
+    my_mqtt_init(&cfg);
+    CHECK(fake_client.cfg.broker.verification.crt_bundle_attach == esp_crt_bundle_attach);
+
+    // ---- Loopback broker: connected on return, publishes come back through the pool ----
+    connected_cbs = 0;
+    cfg = base_cfg(MQTT_LOOPBACK_URI, false);
+    CHECK_EQ(my_mqtt_init(&cfg), ESP_OK);
+    CHECK_EQ(connected_cbs, 1);
+    CHECK(my_mqtt_pub_opts("cmd/loop", "hi", 1, false) >= 0);
+    CHECK(my_mqtt_acquire(&msg, 0));
+    CHECK(strcmp(msg->topic, "cmd/loop") == 0);
+    CHECK(strcmp(msg->payload, "hi") == 0);
+    my_mqtt_release(msg);
+    my_mqtt_pub_opts("other/topic", "no", 0, false);
+    CHECK(!my_mqtt_acquire(&msg, 0));
+
+    return ht_summary("my_mqtt");
+}
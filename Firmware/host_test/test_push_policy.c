@@ -0,0 +1,99 @@
+// Node push policy (push_policy.c): deadbands, rate limit, heartbeat, poll answers, threshold hysteresis,
+// tick wrap-around and config validation
+
+#include "host_test.h"
+#include "push_policy.h"
+
+/**
+ * @brief One sample: decide, and report it as sent when send_ok (a failed send is retried next time)
+ */
+static push_reason_t step(push_policy_t *p, int32_t a, int32_t b, uint32_t now_ms, bool send_ok)
+{
+    const int32_t v[2] = {a, b};
+    push_reason_t r = push_policy_decide(p, v, now_ms);
+    if (r != PUSH_NONE && send_ok)
+    {
+        push_policy_reported(p, v, now_ms, r);
+    }
+    return r;
+}
+
+int main(void)
+{
+    push_policy_t p;
+
+    // ---- DHT11: temp / humi x10, 1.0 C / 3 %RH deadbands, 2 s rate limit, 60 s heartbeat ----
+    const push_policy_config_t dht = {
+        .field = {{.abs_delta = 10}, {.abs_delta = 30}},
+        .field_count = 2,
+        .min_interval_ms = 2000,
+        .heartbeat_ms = 60000,
+    };
+    CHECK(push_policy_valid(&dht));
+    push_policy_init(&p, &dht);
+    CHECK_EQ(step(&p, 250, 600, 0, true), PUSH_CHANGE);      // first sample
+    CHECK_EQ(step(&p, 255, 620, 2000, true), PUSH_NONE);     // inside the deadbands
+    CHECK_EQ(step(&p, 260, 600, 4000, true), PUSH_CHANGE);   // temp +1.0
+    CHECK_EQ(step(&p, 260, 640, 5000, true), PUSH_NONE);     // humi +4, rate limited
+    CHECK_EQ(p.stats.rate_limited, 1);
+    CHECK_EQ(step(&p, 260, 640, 6000, false), PUSH_CHANGE);  // released, send fails
+    CHECK_EQ(step(&p, 260, 640, 8000, true), PUSH_CHANGE);   // retried
+    CHECK_EQ(step(&p, 261, 640, 60000, true), PUSH_NONE);
+    CHECK_EQ(step(&p, 261, 640, 68000, true), PUSH_HEARTBEAT);
+
+    // A poll answer counts as reported: the master already has the value
+    const int32_t polled[2] = {300, 640};
+    push_policy_reported(&p, polled, 70000, PUSH_NONE);
+    CHECK_EQ(step(&p, 300, 640, 73000, true), PUSH_NONE);
+    CHECK_EQ(p.stats.polled, 1);
+    CHECK_EQ(p.stats.pushed_heartbeat, 1);
+    CHECK_EQ(p.stats.pushed_change, 3);
+
+    // Tick counter wrap-around
+    push_policy_init(&p, &dht);
+    CHECK_EQ(step(&p, 0, 0, 0xFFFFF000u, true), PUSH_CHANGE);
+    CHECK_EQ(step(&p, 0, 0, 0xFFFFF000u + 60000u, true), PUSH_HEARTBEAT);
+
+    // ---- Lux: absolute or relative delta, either one triggers ----
+    const push_policy_config_t lux = {
+        .field = {{.abs_delta = 10, .rel_delta_pm = 200, .threshold_en = true, .threshold = 50, .threshold_hyst = 10}},
+        .field_count = 1,
+        .min_interval_ms = 500,
+        .heartbeat_ms = 0,
+    };
+    CHECK(push_policy_valid(&lux));
+    push_policy_init(&p, &lux);
+    CHECK_EQ(step(&p, 1000, 0, 0, true), PUSH_CHANGE);
+    CHECK_EQ(step(&p, 1150, 0, 1000, true), PUSH_CHANGE);    // abs 10
+
+    push_policy_config_t rel = lux;
+    rel.field[0].abs_delta = 0;
+    push_policy_init(&p, &rel);
+    CHECK_EQ(step(&p, 1000, 0, 0, true), PUSH_CHANGE);
+    CHECK_EQ(step(&p, 1150, 0, 1000, true), PUSH_NONE);      // 15 % < 20 %
+    CHECK_EQ(step(&p, 1200, 0, 2000, true), PUSH_CHANGE);    // 20 %
+
+    // Threshold with hysteresis only (deltas off): band 40..60 keeps the side
+    rel.field[0].rel_delta_pm = 0;
+    push_policy_init(&p, &rel);
+    CHECK_EQ(step(&p, 70, 0, 0, true), PUSH_CHANGE);         // above
+    CHECK_EQ(step(&p, 45, 0, 1000, true), PUSH_NONE);        // in the band
+    CHECK_EQ(step(&p, 40, 0, 2000, true), PUSH_CHANGE);      // below
+    CHECK_EQ(step(&p, 55, 0, 3000, true), PUSH_NONE);
+    CHECK_EQ(step(&p, 41, 0, 4000, true), PUSH_NONE);
+    CHECK_EQ(step(&p, 60, 0, 5000, true), PUSH_CHANGE);      // above
+    CHECK_EQ(step(&p, 1000000, 0, 6000, true), PUSH_NONE);   // no delta, no heartbeat
+
+    // ---- Invalid configs ----
+    push_policy_config_t bad = lux;
+    bad.field_count = 3;
+    CHECK(!push_policy_valid(&bad));
+    bad = lux;
+    bad.field_count = 0;
+    CHECK(!push_policy_valid(&bad));
+    bad = lux;
+    bad.field[0].rel_delta_pm = 1001;
+    CHECK(!push_policy_valid(&bad));
+
+    return ht_summary("push_policy");
+}
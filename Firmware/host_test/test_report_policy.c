@@ -0,0 +1,141 @@
+// Gateway report-by-exception (report_policy.c, report_policy_store.c): deadbands from the last published
+// value, min / max interval, node heartbeat, counters, tick wrap-around and the NVS-backed instance
+
+#include "host_test.h"
+#include "report_policy.h"
+
+static report_policy_t p;
+
+/**
+ * @brief One frame of node 1, returns the published field bits (0x80 = frame published with no field)
+ */
+static uint8_t frame(uint8_t present, uint16_t lux, uint16_t temp, uint16_t humi, uint32_t now_ms)
+{
+    const uint16_t value[REPORT_FIELD_COUNT] = {lux, temp, humi};
+    uint8_t publish;
+    bool sent = report_policy_decide(&p, 1, present, value, now_ms, &publish);
+    CHECK(sent || publish == 0);
+    return sent && publish == 0 ? 0x80 : publish;
+}
+
+int main(void)
+{
+    const uint8_t all = REPORT_FIELD_BIT(REPORT_FIELD_LUX) | REPORT_FIELD_BIT(REPORT_FIELD_TEMP) |
+                        REPORT_FIELD_BIT(REPORT_FIELD_HUMI);
+    const uint8_t lux = REPORT_FIELD_BIT(REPORT_FIELD_LUX);
+    const uint8_t temp = REPORT_FIELD_BIT(REPORT_FIELD_TEMP);
+    const uint8_t humi = REPORT_FIELD_BIT(REPORT_FIELD_HUMI);
+    report_policy_config_t cfg;
+
+    // ---- Defaults: lux 10 lx or 5 %, temp 1, humi 2, 1 s min interval, 60 s heartbeat ----
+    report_policy_defaults(&cfg);
+    CHECK(report_policy_valid(&cfg));
+    report_policy_reset(&p, &cfg);
+
+    CHECK_EQ(frame(all, 200, 25, 60, 0), all);       // first frame of the node
+    CHECK_EQ(frame(all, 200, 25, 60, 200), 0);       // unchanged
+    CHECK_EQ(frame(all, 205, 25, 61, 1200), 0);      // inside the deadbands
+    CHECK_EQ(frame(all, 210, 26, 62, 1400), lux | temp | humi);
+    CHECK_EQ(frame(all, 260, 26, 62, 1600), 0);      // moved but inside min_interval_ms
+    CHECK_EQ(frame(all, 260, 26, 62, 2400), lux);
+
+    // Slow drift adds up from the last published value
+    CHECK_EQ(frame(humi, 0, 0, 63, 4000), 0);
+    CHECK_EQ(frame(humi, 0, 0, 64, 5000), humi);
+
+    // Both deadbands set, the larger applies: at 2000 lx that is 5 % = 100 lx, not 10 lx
+    CHECK_EQ(frame(lux, 2000, 0, 0, 6000), lux);
+    CHECK_EQ(frame(lux, 2050, 0, 0, 7000), 0);       // 50 lx >= 10 lx but < 100 lx
+    CHECK_EQ(frame(lux, 2100, 0, 0, 8000), lux);
+
+    // Heartbeat: node silent for 60 s sends all present fields
+    CHECK_EQ(frame(all, 2100, 26, 64, 68000), all);
+    CHECK_EQ(frame(0, 0, 0, 0, 69000), 0);           // empty frame, no heartbeat due
+    CHECK_EQ(frame(0, 0, 0, 0, 128000), 0x80);       // empty frame on the heartbeat
+
+    CHECK_EQ(p.stats.frames_in, 14);
+    CHECK_EQ(p.stats.frames_published, 8);
+    CHECK_EQ(p.stats.frames_suppressed, 6);
+    CHECK_EQ(p.stats.fields_published[REPORT_FIELD_LUX], 6);
+    CHECK_EQ(p.stats.fields_suppressed[REPORT_FIELD_LUX], 4);
+
+    // Nodes are independent, ids past the table are always published
+    const uint16_t v[REPORT_FIELD_COUNT] = {1, 2, 3};
+    uint8_t publish;
+    CHECK(report_policy_decide(&p, 2, all, v, 128000, &publish));
+    CHECK_EQ(publish, all);
+    CHECK(report_policy_decide(&p, REPORT_MAX_NODES, temp, v, 128000, &publish));
+    CHECK_EQ(publish, temp);
+    CHECK(report_policy_decide(&p, REPORT_MAX_NODES, temp, v, 128001, &publish));
+
+    // ---- Max interval, any-change fields, tick wrap-around ----
+    report_policy_defaults(&cfg);
+    cfg.field[REPORT_FIELD_TEMP] = (report_field_policy_t){.min_interval_ms = 0, .max_interval_ms = 10000};
+    cfg.heartbeat_ms = 0;
+    CHECK(report_policy_valid(&cfg));
+    report_policy_reset(&p, &cfg);
+    const uint32_t t0 = 0xFFFFF000u;
+    CHECK_EQ(frame(temp, 0, 25, 0, t0), temp);
+    CHECK_EQ(frame(temp, 0, 26, 0, t0 + 100), temp);  // abs and rel 0: any change
+    CHECK_EQ(frame(temp, 0, 26, 0, t0 + 9000), 0);
+    CHECK_EQ(frame(temp, 0, 26, 0, t0 + 10100), temp); // republished unchanged, across the wrap
+
+    // ---- Combined bands at low light: 1 lx of jitter at 20 lx passes 5 % but not 10 lx ----
+    report_policy_defaults(&cfg);
+    report_policy_reset(&p, &cfg);
+    CHECK_EQ(frame(lux, 20, 0, 0, 0), lux);
+    CHECK_EQ(frame(lux, 21, 0, 0, 2000), 0);
+    CHECK_EQ(frame(lux, 19, 0, 0, 3000), 0);
+    CHECK_EQ(frame(lux, 29, 0, 0, 4000), 0);
+    CHECK_EQ(frame(lux, 30, 0, 0, 5000), lux);
+    // Relative band only: 5 % of 20 lx is 1 lx
+    cfg.field[REPORT_FIELD_LUX].abs_deadband = 0;
+    report_policy_reset(&p, &cfg);
+    CHECK_EQ(frame(lux, 20, 0, 0, 0), lux);
+    CHECK_EQ(frame(lux, 21, 0, 0, 2000), lux);
+
+    // ---- Invalid configs ----
+    report_policy_defaults(&cfg);
+    cfg.field[REPORT_FIELD_LUX].rel_deadband_pm = 1001;
+    CHECK(!report_policy_valid(&cfg));
+    report_policy_defaults(&cfg);
+    cfg.field[REPORT_FIELD_HUMI].max_interval_ms = 500; // below min_interval_ms
+    CHECK(!report_policy_valid(&cfg));
+    report_policy_defaults(&cfg);
+    cfg.version++;
+    CHECK(!report_policy_valid(&cfg));
+
+    CHECK(strcmp(report_field_name(REPORT_FIELD_HUMI), "humi") == 0);
+    CHECK(strcmp(report_field_name(REPORT_FIELD_COUNT), "?") == 0);
+
+    // ---- Gateway instance: pass-through before init, config stored in NVS ----
+    const uint16_t g[REPORT_FIELD_COUNT] = {100, 20, 50};
+    CHECK(report_policy_filter(0, all, g, 0, &publish));
+    CHECK_EQ(publish, all);
+
+    CHECK_EQ(report_policy_init(), ESP_OK);
+    CHECK(report_policy_load() != ESP_OK); // nothing stored, defaults stay
+    CHECK(report_policy_filter(0, all, g, 0, &publish));
+    CHECK(!report_policy_filter(0, all, g, 500, &publish));
+
+    report_policy_defaults(&cfg);
+    cfg.heartbeat_ms = 5000;
+    CHECK_EQ(report_policy_set_config(&cfg), ESP_OK);
+    report_policy_stats_t stats;
+    report_policy_get_stats(&stats);
+    CHECK_EQ(stats.frames_in, 2); // counters kept over a config change
+    CHECK(report_policy_filter(0, all, g, 600, &publish)); // per-node state restarted
+
+    cfg.field[REPORT_FIELD_LUX].rel_deadband_pm = 2000;
+    CHECK_EQ(report_policy_set_config(&cfg), ESP_ERR_INVALID_ARG);
+
+    // Simulated reboot: defaults, then the stored config
+    CHECK_EQ(report_policy_init(), ESP_OK);
+    report_policy_get_config(&cfg);
+    CHECK_EQ(cfg.heartbeat_ms, 60000);
+    CHECK_EQ(report_policy_load(), ESP_OK);
+    report_policy_get_config(&cfg);
+    CHECK_EQ(cfg.heartbeat_ms, 5000);
+
+    return ht_summary("report_policy");
+}
@@ -0,0 +1,133 @@
+// Node sample conditioning (signal_cond.c): config validation, primed low-pass (no ramp from 0, unity DC
+// gain, ripple attenuation, step settling), Welford window statistics and the three output modes
+
+#include <math.h>
+#include "host_test.h"
+#include "signal_cond.h"
+
+#define NEAR(a, b, tol) (fabsf((float)(a) - (float)(b)) <= (tol))
+
+int main(void)
+{
+    signal_cond_t c;
+    float v[COND_MAX_FIELDS];
+
+    // ---- Validation ----
+    cond_config_t bad = {.field = {{.filter = COND_FILTER_LOWPASS, .cutoff = 0.5f, .q = 0.707f}}, .field_count = 1,
+                         .window = 10};
+    CHECK(!signal_cond_valid(&bad));
+    bad.field[0].cutoff = 0.1f;
+    bad.field[0].q = 0.0f;
+    CHECK(!signal_cond_valid(&bad));
+    bad.field[0].q = 0.707f;
+    CHECK(signal_cond_valid(&bad));
+    bad.window = 0;
+    CHECK(!signal_cond_valid(&bad));
+    bad.window = 10;
+    bad.field_count = COND_MAX_FIELDS + 1;
+    CHECK(!signal_cond_init(&c, &bad));
+
+    // ---- Low-pass: primed with the first sample, unity DC gain ----
+    const cond_config_t lp = {
+        .field = {{.filter = COND_FILTER_LOWPASS, .cutoff = 0.1f, .q = 0.707f}, {.filter = COND_FILTER_NONE}},
+        .field_count = 2,
+        .output = COND_OUTPUT_FILTERED,
+        .window = 10,
+    };
+    CHECK(signal_cond_init(&c, &lp));
+    CHECK(!signal_cond_output(&c, v));
+    CHECK(signal_cond_stats(&c, 0) == NULL);
+
+    const float first[2] = {250.0f, 60.0f};
+    signal_cond_update(&c, first);
+    CHECK(signal_cond_output(&c, v));
+    CHECK(NEAR(v[0], 250.0f, 0.01f)); // starts at the signal, not at 0
+    CHECK(NEAR(v[1], 60.0f, 0.0f));   // pass-through field
+    for (int i = 0; i < 50; i++)
+        signal_cond_update(&c, first);
+    signal_cond_output(&c, v);
+    CHECK(NEAR(v[0], 250.0f, 0.01f));
+
+    // Step +10: settles within ~5 samples, Butterworth does not overshoot much
+    const float step[2] = {260.0f, 60.0f};
+    float peak = 0.0f;
+    int settled = -1;
+    for (int i = 0; i < 30; i++)
+    {
+        signal_cond_update(&c, step);
+        signal_cond_output(&c, v);
+        peak = v[0] > peak ? v[0] : peak;
+        if (settled < 0 && NEAR(v[0], 260.0f, 1.0f))
+            settled = i + 1;
+    }
+    CHECK(settled > 0 && settled <= 6);
+    CHECK(peak < 260.0f + 0.6f);
+
+    // Ripple at 0.4 of the sample rate (aliased flicker): attenuated more than 10x
+    CHECK(signal_cond_init(&c, &lp));
+    float lo = 1e9f, hi = -1e9f;
+    for (int i = 0; i < 200; i++)
+    {
+        const float x[2] = {100.0f + 10.0f * sinf(2 * (float)M_PI * 0.4f * i), 0.0f};
+        signal_cond_update(&c, x);
+        signal_cond_output(&c, v);
+        if (i >= 100)
+        {
+            lo = v[0] < lo ? v[0] : lo;
+            hi = v[0] > hi ? v[0] : hi;
+        }
+    }
+    CHECK(hi - lo < 2.0f);
+
+    // ---- Window statistics (raw samples) against a two-pass computation ----
+    const cond_config_t sum = {.field_count = 1, .output = COND_OUTPUT_SUMMARY, .window = 8};
+    CHECK(signal_cond_init(&c, &sum));
+    static const float xs[8] = {20, 21, 20, 22, 19, 20, 21, 23};
+    int done = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        const float x[1] = {xs[i]};
+        done += signal_cond_update(&c, x);
+        if (i == 3)
+        {
+            // Before the first complete window: the running one
+            signal_cond_output(&c, v);
+            CHECK(NEAR(v[0], 20.75f, 1e-4f));
+        }
+    }
+    CHECK_EQ(done, 1);
+    CHECK_EQ(c.windows, 1);
+    double mean = 0, ss = 0;
+    for (int i = 0; i < 8; i++)
+        mean += xs[i] / 8.0;
+    for (int i = 0; i < 8; i++)
+        ss += (xs[i] - mean) * (xs[i] - mean);
+    const cond_stats_t *s = signal_cond_stats(&c, 0);
+    CHECK_EQ(s->n, 8);
+    CHECK(NEAR(s->min, 19.0f, 0.0f));
+    CHECK(NEAR(s->max, 23.0f, 0.0f));
+    CHECK(NEAR(s->mean, mean, 1e-4f));
+    CHECK(NEAR(cond_stats_stddev(s), sqrt(ss / 7), 1e-4f));
+    CHECK(signal_cond_stats(&c, 1) == NULL);
+
+    // Summary keeps the last complete window until the next one closes
+    const float hot[1] = {40.0f};
+    for (int i = 0; i < 7; i++)
+        CHECK(!signal_cond_update(&c, hot));
+    signal_cond_output(&c, v);
+    CHECK(NEAR(v[0], mean, 1e-4f));
+    CHECK(signal_cond_update(&c, hot));
+    signal_cond_output(&c, v);
+    CHECK(NEAR(v[0], 40.0f, 0.0f));
+    CHECK(NEAR(cond_stats_stddev(signal_cond_stats(&c, 0)), 0.0f, 0.0f));
+
+    // ---- Raw output ----
+    const cond_config_t raw = {.field_count = 1, .output = COND_OUTPUT_RAW, .window = 1};
+    CHECK(signal_cond_init(&c, &raw));
+    const float one[1] = {7.5f};
+    CHECK(signal_cond_update(&c, one)); // window of 1 closes on every sample
+    signal_cond_output(&c, v);
+    CHECK(NEAR(v[0], 7.5f, 0.0f));
+
+    return ht_summary("signal_cond");
+}
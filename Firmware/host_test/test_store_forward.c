@@ -0,0 +1,138 @@
+// Store-and-forward ring (store_forward.c) on a file-backed partition: reboot, torn write, wrap
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "host_test.h"
+#include "store_forward.h"
+#include "esp_partition.h"
+
+#define SF_IMAGE_SECTORS 4
+
+static const char *image_path = "store_forward.img";
+
+/**
+ * @brief Power cycle: close the file, reopen it and mount again from what reached the flash
+ */
+static esp_err_t reboot(void)
+{
+    esp_partition_file_close();
+    esp_err_t err = esp_partition_file_open(image_path, STORE_FORWARD_PARTITION, STORE_FORWARD_SUBTYPE,
+                                            SF_IMAGE_SECTORS * SPI_FLASH_SEC_SIZE);
+    if (err != ESP_OK)
+        return err;
+    return store_forward_init();
+}
+
+static int payload_index(const char *payload, const char *key)
+{
+    const char *p = strstr(payload, key);
+    return p ? atoi(p + strlen(key)) : -1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        image_path = argv[1];
+    remove(image_path);
+
+    char pl[400];
+    char buf[STORE_FORWARD_MAX_RECORD];
+    store_forward_record_t r;
+    store_forward_stats_t st;
+
+    // No partition in the table
+    CHECK_EQ(store_forward_init(), ESP_ERR_NOT_FOUND);
+    CHECK_EQ(reboot(), ESP_OK);
+    CHECK_EQ(store_forward_pending(), 0);
+    CHECK(!store_forward_peek(&r, buf, sizeof(buf)));
+
+    // 20 records, replay 5 in order
+    for (int i = 0; i < 20; i++)
+    {
+        snprintf(pl, sizeof(pl), "{\"type\":\"telemetry\",\"i\":%d,\"pad\":\"%0200d\"}", i, 0);
+        CHECK_EQ(store_forward_append(0, "GateWays/Server", pl), ESP_OK);
+    }
+    CHECK_EQ(store_forward_pending(), 20);
+    for (int i = 0; i < 5; i++)
+    {
+        CHECK(store_forward_peek(&r, buf, sizeof(buf)));
+        CHECK_EQ(r.seq, (uint32_t)i + 1);
+        CHECK_EQ(payload_index(r.payload, "\"i\":"), i);
+        CHECK(strcmp(r.topic, "GateWays/Server") == 0);
+        CHECK_EQ(store_forward_ack(r.seq), ESP_OK);
+    }
+
+    // Reboot: the acked records stay acked, the cursor resumes at seq 6
+    CHECK_EQ(reboot(), ESP_OK);
+    CHECK_EQ(store_forward_pending(), 15);
+    CHECK(store_forward_peek(&r, buf, sizeof(buf)));
+    CHECK_EQ(r.seq, 6);
+    CHECK_EQ(payload_index(r.payload, "\"i\":"), 5);
+
+    // Power cut 100 bytes into a record: it must be skipped, the next append and replay go on
+    esp_partition_file_set_write_budget(100);
+    store_forward_append(0, "t", "{\"torn\":1,\"x\":\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+                                 "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\"}");
+    CHECK_EQ(reboot(), ESP_OK);
+    CHECK_EQ(store_forward_append(0, "t", "{\"after\":1}"), ESP_OK);
+
+    int n = 0;
+    uint32_t prev = 0;
+    bool saw_torn = false;
+    char last_payload[64] = "";
+    while (store_forward_peek(&r, buf, sizeof(buf)))
+    {
+        CHECK(r.seq > prev);
+        prev = r.seq;
+        saw_torn |= strstr(r.payload, "torn") != NULL;
+        snprintf(last_payload, sizeof(last_payload), "%s", r.payload);
+        CHECK_EQ(store_forward_ack(r.seq), ESP_OK);
+        n++;
+    }
+    CHECK_EQ(n, 16);
+    CHECK(!saw_torn);
+    CHECK(strcmp(last_payload, "{\"after\":1}") == 0);
+    CHECK_EQ(store_forward_pending(), 0);
+
+    // Wrap far past the capacity without reading: the oldest go, the newest survive a reboot in order
+    for (int i = 0; i < 200; i++)
+    {
+        snprintf(pl, sizeof(pl), "{\"w\":%d,\"pad\":\"%0200d\"}", i, 0);
+        CHECK_EQ(store_forward_append(0, "x", pl), ESP_OK);
+    }
+    store_forward_get_stats(&st);
+    CHECK(st.dropped_overwritten > 0);
+    CHECK_EQ(st.pending + st.dropped_overwritten, 200);
+
+    CHECK_EQ(reboot(), ESP_OK);
+    store_forward_get_stats(&st);
+    uint32_t pending = st.pending;
+    CHECK(pending > 0);
+    n = 0;
+    prev = 0;
+    int last_w = -1;
+    while (store_forward_peek(&r, buf, sizeof(buf)))
+    {
+        CHECK(r.seq > prev);
+        prev = r.seq;
+        int w = payload_index(r.payload, "\"w\":");
+        CHECK(last_w < 0 || w == last_w + 1);
+        last_w = w;
+        CHECK_EQ(store_forward_ack(r.seq), ESP_OK);
+        n++;
+    }
+    CHECK_EQ(n, (int)pending);
+    CHECK_EQ(last_w, 199);
+
+    // Sectors are filled round robin: erase counts differ by at most one, records are never rewritten
+    esp_partition_file_stats_t fs;
+    esp_partition_file_get_stats(&fs);
+    CHECK(fs.sector_erases_max - fs.sector_erases_min <= 1);
+    CHECK_EQ(fs.bad_writes, 0);
+    printf("pending after wrap %lu, erases %lu (per sector %lu..%lu)\n", (unsigned long)pending,
+           (unsigned long)fs.erases, (unsigned long)fs.sector_erases_min, (unsigned long)fs.sector_erases_max);
+
+    esp_partition_file_close();
+    remove(image_path);
+    return ht_summary("test_store_forward");
+}
@@ -0,0 +1,81 @@
+// Topic router (topic_router.c) with the gateway's control routes, and '+' captures on a test table
+
+#include "host_test.h"
+#include "topic_router.h"
+
+#define ROOT "home"
+
+static bool route(const char *topic, topic_match_t *m)
+{
+    memset(m, 0xEE, sizeof(*m));
+    return topic_router_match(topic, (int)strlen(topic), m);
+}
+
+int main(void)
+{
+    // Same table as app_main (define.h documents the forms)
+    const topic_route_t routes[] = {
+        {"Server/Gateways", TOPIC_ACTION_JSON_CONTROL, 0, 0},
+        {ROOT "/gateway/report/set", TOPIC_ACTION_REPORT_SET, 0, 0},
+        {ROOT "/gateway/report/get", TOPIC_ACTION_REPORT_GET, 0, 0},
+    };
+    topic_router_init(ROOT);
+    for (size_t i = 0; i < sizeof(routes) / sizeof(routes[0]); i++)
+        CHECK(topic_router_add(&routes[i]));
+    CHECK_EQ(topic_router_route_count(), 3);
+
+    topic_match_t m;
+
+    CHECK(route(ROOT "/gateway/report/set", &m));
+    CHECK_EQ(m.action, TOPIC_ACTION_REPORT_SET);
+    CHECK(route(ROOT "/gateway/report/get", &m));
+    CHECK_EQ(m.action, TOPIC_ACTION_REPORT_GET);
+    CHECK(route("Server/Gateways", &m));
+    CHECK_EQ(m.action, TOPIC_ACTION_JSON_CONTROL);
+    CHECK_EQ(m.node, 0);
+
+    // The nodes have no plugs, per-node plug topics do not route
+    CHECK(!route(ROOT "/node3/plug/2/set", &m));
+    CHECK(!route(ROOT "/master/plug/3/set", &m));
+    CHECK(!route(ROOT "/gateway/report", &m));
+
+    int subscribed = 0;
+    for (int i = 0; i < topic_router_route_count(); i++)
+        subscribed += !topic_router_filter_covered(i);
+    CHECK_EQ(subscribed, 3);
+
+    // ---- Captures: fields from '+' levels, the exact level wins over '+' ----
+    const topic_route_t captures[] = {
+        {ROOT "/master/x/+/set", TOPIC_ACTION_REPORT_SET, 0, TOPIC_FROM_CAPTURE(0)},
+        {ROOT "/+/x/+/set", TOPIC_ACTION_REPORT_SET, TOPIC_FROM_CAPTURE(0), TOPIC_FROM_CAPTURE(1)},
+    };
+    topic_router_init(ROOT);
+    for (size_t i = 0; i < sizeof(captures) / sizeof(captures[0]); i++)
+        CHECK(topic_router_add(&captures[i]));
+
+    CHECK(route(ROOT "/node3/x/2/set", &m));
+    CHECK_EQ(m.node, 3);
+    CHECK_EQ(m.plug, 2);
+    CHECK(route(ROOT "/node10/x/1/set", &m));
+    CHECK_EQ(m.node, 10);
+    CHECK(route(ROOT "/master/x/3/set", &m));
+    CHECK_EQ(m.node, 0);
+    CHECK_EQ(m.plug, 3);
+
+    // Other forms do not route
+    CHECK(!route(ROOT "/node3/x2/set", &m));
+    CHECK(!route(ROOT "/node3/x/2", &m));
+    CHECK(!route(ROOT "/node3/x/y/set", &m));
+    CHECK(!route("other/node3/x/2/set", &m));
+
+    // The master filter is covered by the node one, so it is not subscribed twice
+    CHECK(topic_router_filter_covered(0));
+    CHECK(!topic_router_filter_covered(1));
+
+    // Telemetry topics, precomputed
+    CHECK(strcmp(topic_router_sensor_topic(2, TOPIC_SENSOR_TEMP), ROOT "/node2/temp") == 0);
+    CHECK(strcmp(topic_router_sensor_topic(0, TOPIC_SENSOR_LUX), ROOT "/node0/lux") == 0);
+    CHECK(topic_router_sensor_topic(TOPIC_MAX_NODES, TOPIC_SENSOR_LUX) == NULL);
+
+    return ht_summary("test_topic_router");
+}
@@ -0,0 +1,301 @@
+// Reliable UART layer (uart_arq.c) looped back on itself through a fake uart_link_send: out-of-order delivery
+// and SACK, a lost ACK and the duplicate it causes, give-up and the receiver skipping via base, completion
+// callbacks, epoch change, full window, and ACKs handled while a slow link write is in progress.
+
+#include <pthread.h>
+#include "host_test.h"
+#include "uart_arq.h"
+#include "uart_link.h"
+#include "uart_protocol.h"
+#include "fsm_frames.h"
+#include "freertos/task.h"
+
+#define WIRE_MAX 512
+#define ARQ_HDR 4
+
+typedef struct
+{
+    uint16_t len;
+    uint8_t data[FRAME_HEADER_SIZE + ARQ_HDR + UART_ARQ_MAX_PAYLOAD + 2];
+} wire_frame_t;
+
+static pthread_mutex_t wire_lock = PTHREAD_MUTEX_INITIALIZER;
+static wire_frame_t wire[WIRE_MAX];
+static int wire_count;
+static volatile TickType_t link_delay; // Blocking time of every uart_link_send, 0 = returns at once
+
+static uint8_t delivered[64];
+static int delivered_count;
+
+static uart_arq_result_t done_result[8];
+static uint32_t done_tag[8];
+static volatile int done_count;
+
+// ======================= Fake link =======================
+bool uart_link_send(const uint8_t *frame, uint16_t length)
+{
+    pthread_mutex_lock(&wire_lock);
+    if (wire_count < WIRE_MAX && length <= sizeof(wire[0].data))
+    {
+        wire[wire_count].len = length;
+        memcpy(wire[wire_count].data, frame, length);
+        wire_count++;
+    }
+    pthread_mutex_unlock(&wire_lock);
+    if (link_delay)
+    {
+        vTaskDelay(link_delay);
+    }
+    return true;
+}
+
+static void on_frame(const Frame_View *view)
+{
+    CHECK_EQ(view->type, UART_MSG_DATA);
+    CHECK_EQ(view->payload_len, 1);
+    if (delivered_count < (int)sizeof(delivered))
+    {
+        delivered[delivered_count++] = view->payload[0];
+    }
+}
+
+static void on_done(uart_arq_result_t result, uint32_t tag)
+{
+    pthread_mutex_lock(&wire_lock);
+    if (done_count < 8)
+    {
+        done_result[done_count] = result;
+        done_tag[done_count] = tag;
+        done_count++;
+    }
+    pthread_mutex_unlock(&wire_lock);
+}
+
+// ======================= Wire helpers =======================
+static int wire_mark(void)
+{
+    pthread_mutex_lock(&wire_lock);
+    int n = wire_count;
+    pthread_mutex_unlock(&wire_lock);
+    return n;
+}
+
+/**
+ * @brief Copy of the first frame of the given type (and seq for reliable frames, -1 = any) at or after *from
+ * @return false if there is none yet, else *from is moved past it
+ */
+static bool wire_next(int *from, uint8_t type, int seq, wire_frame_t *out)
+{
+    bool found = false;
+    pthread_mutex_lock(&wire_lock);
+    for (int i = *from; i < wire_count && !found; i++)
+    {
+        const uint8_t *p = &wire[i].data[FRAME_HEADER_SIZE];
+        if ((wire[i].data[2] & FRAME_TYPE_MASK) == type && (seq < 0 || p[1] == (uint8_t)seq))
+        {
+            *out = wire[i];
+            *from = i + 1;
+            found = true;
+        }
+    }
+    pthread_mutex_unlock(&wire_lock);
+    return found;
+}
+
+static int wire_count_seq(int from, int seq)
+{
+    int n = 0;
+    wire_frame_t f;
+    while (wire_next(&from, UART_MSG_RELIABLE, seq, &f))
+        n++;
+    return n;
+}
+
+/**
+ * @brief The ACK the receiver sent for the last data fed to it
+ */
+static void last_ack(uint8_t *epoch, uint8_t *next, uint16_t *sack)
+{
+    wire_frame_t f = {0};
+    int from = 0, i = 0;
+    while (wire_next(&from, UART_MSG_ACK, -1, &f))
+        i++;
+    CHECK(i > 0);
+    *epoch = f.data[FRAME_HEADER_SIZE];
+    *next = f.data[FRAME_HEADER_SIZE + 1];
+    *sack = (uint16_t)(f.data[FRAME_HEADER_SIZE + 2] | (f.data[FRAME_HEADER_SIZE + 3] << 8));
+}
+
+static void deliver(const wire_frame_t *f)
+{
+    const uint8_t *p = &f->data[FRAME_HEADER_SIZE];
+    uint16_t n = (uint16_t)(f->len - FRAME_HEADER_SIZE - 2);
+    if ((f->data[2] & FRAME_TYPE_MASK) == UART_MSG_ACK)
+        uart_arq_handle_ack(p, n);
+    else
+        uart_arq_handle_data(p, n);
+}
+
+static void deliver_last_ack(void)
+{
+    wire_frame_t f = {0};
+    int from = 0;
+    while (wire_next(&from, UART_MSG_ACK, -1, &f))
+        ;
+    deliver(&f);
+}
+
+static bool send_byte(uint8_t marker, uint32_t timeout_ms)
+{
+    uint8_t frame[16];
+    uint16_t len = frame_build(frame, UART_MSG_DATA, &marker, 1);
+    return uart_arq_send_frame(frame, len, timeout_ms);
+}
+
+/**
+ * @brief Same, outcome reported to on_done with the marker as tag
+ */
+static bool send_byte_notify(uint8_t marker)
+{
+    uint8_t frame[16];
+    uint16_t len = frame_build(frame, UART_MSG_DATA, &marker, 1);
+    return uart_arq_send_frame_notify(frame, len, 0, on_done, marker);
+}
+
+static void ack(uint8_t epoch, uint8_t next, uint16_t sack)
+{
+    const uint8_t p[4] = {epoch, next, (uint8_t)sack, (uint8_t)(sack >> 8)};
+    uart_arq_handle_ack(p, sizeof(p));
+}
+
+static uart_arq_stats_t stats(void)
+{
+    uart_arq_stats_t s;
+    uart_arq_get_stats(&s);
+    return s;
+}
+
+static void slow_sender(void *arg)
+{
+    send_byte(0x77, 0);
+    *(volatile bool *)arg = true;
+    vTaskDelete(NULL);
+}
+
+int main(void)
+{
+    message_set_integrity_mode(INTEGRITY_CRC16);
+    uart_arq_init(on_frame);
+
+    // ---- Sequence numbers, out of order delivery and SACK ----
+    CHECK(send_byte_notify('A'));
+    CHECK(send_byte_notify('B'));
+    CHECK(send_byte('C', 0));
+    int from = 0;
+    wire_frame_t r0, r1, r2;
+    CHECK(wire_next(&from, UART_MSG_RELIABLE, 0, &r0));
+    CHECK(wire_next(&from, UART_MSG_RELIABLE, 1, &r1));
+    CHECK(wire_next(&from, UART_MSG_RELIABLE, 2, &r2));
+    const uint8_t epoch = r0.data[FRAME_HEADER_SIZE];
+    CHECK_EQ(r2.data[FRAME_HEADER_SIZE], epoch);
+    CHECK_EQ(r2.data[FRAME_HEADER_SIZE + 2], 0); // base
+    CHECK_EQ(r2.data[FRAME_HEADER_SIZE + 3], UART_MSG_DATA);
+    CHECK_EQ(r2.data[FRAME_HEADER_SIZE + ARQ_HDR], 'C');
+    CHECK_EQ(stats().in_flight, 3);
+
+    uint8_t e, next;
+    uint16_t sack;
+    deliver(&r0); // first frame: the receiver syncs on its base
+    last_ack(&e, &next, &sack);
+    CHECK(e == epoch && next == 1 && sack == 0);
+    deliver(&r2); // r1 lost
+    last_ack(&e, &next, &sack);
+    CHECK(next == 1 && sack == 0x0001); // bit 0 = next + 1
+    CHECK_EQ(delivered_count, 1);
+    CHECK_EQ(stats().rx_out_of_order, 1);
+
+    ack(epoch ^ 0xFF, 3, 0); // other epoch: ignored
+    CHECK_EQ(stats().in_flight, 3);
+    deliver_last_ack(); // cumulative for seq 0, selective for seq 2
+    CHECK_EQ(stats().acked, 2);
+    CHECK_EQ(stats().in_flight, 1);
+    CHECK_EQ(done_count, 1); // C was sent without a callback
+    CHECK(done_result[0] == UART_ARQ_DELIVERED && done_tag[0] == 'A');
+
+    // ---- ACK lost: the retransmit is a duplicate, only re-ACKed ----
+    deliver(&r0);
+    CHECK_EQ(stats().rx_duplicates, 1);
+    CHECK_EQ(delivered_count, 1);
+    last_ack(&e, &next, &sack);
+    CHECK(next == 1 && sack == 0x0001);
+
+    // ---- Every copy of seq 1 lost: given up, the next frame carries the new base ----
+    for (int i = 0; i < 2000 && stats().failed == 0; i++)
+        vTaskDelay(1);
+    CHECK_EQ(stats().failed, 1);
+    CHECK_EQ(stats().in_flight, 0);
+    CHECK_EQ(wire_count_seq(0, 1), 1 + UART_ARQ_MAX_RETRIES);
+    CHECK_EQ(wire_count_seq(0, 0), 1); // acked before its RTO
+    CHECK_EQ(wire_count_seq(0, 2), 1);
+    CHECK_EQ(done_count, 2);
+    CHECK(done_result[1] == UART_ARQ_GIVEN_UP && done_tag[1] == 'B');
+
+    CHECK(send_byte('D', 0));
+    wire_frame_t r3;
+    from = 0;
+    CHECK(wire_next(&from, UART_MSG_RELIABLE, 3, &r3));
+    CHECK_EQ(r3.data[FRAME_HEADER_SIZE + 2], 3);
+    deliver(&r3); // receiver skips seq 1, hands out C and D
+    CHECK_EQ(stats().rx_skipped, 1);
+    CHECK_EQ(delivered_count, 3);
+    CHECK_MEM(delivered, "ACD", 3);
+    last_ack(&e, &next, &sack);
+    CHECK(next == 4 && sack == 0);
+    deliver_last_ack();
+    CHECK_EQ(stats().in_flight, 0);
+
+    // ---- Epoch change: the receiver drops what it buffered and starts from the new base ----
+    const uint8_t held[ARQ_HDR + 1] = {epoch, 5, 4, UART_MSG_DATA, 'x'};
+    uart_arq_handle_data(held, sizeof(held));
+    CHECK_EQ(delivered_count, 3);
+    const uint8_t reboot[ARQ_HDR + 1] = {(uint8_t)(epoch + 1), 200, 200, UART_MSG_DATA, 'E'};
+    uart_arq_handle_data(reboot, sizeof(reboot));
+    CHECK_EQ(delivered_count, 4);
+    CHECK_EQ(delivered[3], 'E');
+    last_ack(&e, &next, &sack);
+    CHECK(e == (uint8_t)(epoch + 1) && next == 201 && sack == 0);
+    const uint8_t old[ARQ_HDR + 1] = {epoch, 4, 4, UART_MSG_DATA, 'y'};
+    uart_arq_handle_data(old, sizeof(old)); // old epoch again: treated as another reboot
+    CHECK_EQ(delivered[4], 'y');
+
+    // ---- Full window: refused after the timeout, free again after the ACK ----
+    for (int i = 0; i < UART_ARQ_WINDOW; i++)
+        CHECK(send_byte((uint8_t)i, 0));
+    CHECK(!send_byte(0xEE, 20));
+    CHECK(!send_byte_notify(0xEF));
+    CHECK_EQ(stats().window_full, 2);
+    ack(epoch, (uint8_t)(4 + UART_ARQ_WINDOW), 0);
+    CHECK_EQ(stats().in_flight, 0);
+    CHECK(send_byte(0xEE, 0));
+    ack(epoch, (uint8_t)(5 + UART_ARQ_WINDOW), 0);
+
+    // ---- A slow link write does not hold the window: ACKs are processed meanwhile ----
+    volatile bool sent = false;
+    CHECK(send_byte(0x10, 0)); // in flight, acked below while the next send is on the wire
+    link_delay = pdMS_TO_TICKS(1000);
+    xTaskCreate(slow_sender, "slow_sender", 4096, (void *)&sent, 5, NULL);
+    vTaskDelay(pdMS_TO_TICKS(100));
+    CHECK(!sent);
+    TickType_t t0 = xTaskGetTickCount();
+    ack(epoch, (uint8_t)(6 + UART_ARQ_WINDOW), 0);
+    CHECK(xTaskGetTickCount() - t0 < pdMS_TO_TICKS(100));
+    CHECK(!sent);
+    link_delay = 0;
+    for (int i = 0; i < 2000 && !sent; i++)
+        vTaskDelay(1);
+    CHECK(sent);
+
+    CHECK_EQ(done_count, 2); // none for the refused send
+    uart_arq_log_stats();
+    return ht_summary("uart_arq");
+}
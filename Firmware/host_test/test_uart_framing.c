@@ -0,0 +1,146 @@
+// lib_uart framing switch: the FSM must only be switched by the RX task, before the next byte it parses.
+// Runs lib_uart on the pty backend (uart_port_linux.c), fsm_set_framing is wrapped to see who calls it.
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "host_test.h"
+#include "lib_uart.h"
+#include "fsm_frames.h"
+#include "freertos/task.h"
+
+static volatile int wrap_calls;
+static pthread_t wrap_thread;
+static int pty_master = -1;
+
+void __real_fsm_set_framing(Framing_Mode mode);
+void __wrap_fsm_set_framing(Framing_Mode mode)
+{
+    wrap_thread = pthread_self();
+    wrap_calls++;
+    __real_fsm_set_framing(mode);
+}
+
+static void line_write(const uint8_t *data, size_t len)
+{
+    CHECK_EQ(write(pty_master, data, len), (ssize_t)len);
+}
+
+static size_t line_read(uint8_t *out, size_t max, uint32_t wait_ms)
+{
+    size_t got = 0;
+    TickType_t start = xTaskGetTickCount();
+    while (got < max && (xTaskGetTickCount() - start) * portTICK_PERIOD_MS < wait_ms)
+    {
+        ssize_t n = read(pty_master, out + got, max - got);
+        if (n > 0)
+            got += (size_t)n;
+        else
+            vTaskDelay(1);
+    }
+    return got;
+}
+
+/**
+ * @brief Wait for the RX task to hand out a frame and compare it with the expected one
+ */
+static void expect_frame(const uint8_t *frame, uint16_t len)
+{
+    Frame_View view;
+    TickType_t start = xTaskGetTickCount();
+    bool got = false;
+
+    while (!(got = uart.frame.acquire(&view)) && xTaskGetTickCount() - start < pdMS_TO_TICKS(2000))
+        vTaskDelay(1);
+    CHECK(got);
+    if (!got)
+        return;
+    CHECK_EQ(view.length, len);
+    CHECK_EQ(view.payload_len, len - FRAME_HEADER_SIZE - 2);
+    CHECK_MEM(view.payload, &frame[FRAME_HEADER_SIZE], view.payload_len);
+    uart.frame.release(&view);
+}
+
+/**
+ * @brief Wait until the RX task has taken every byte written so far
+ */
+static void wait_rx_idle(void)
+{
+    TickType_t start = xTaskGetTickCount();
+    while (uart.receive.available() > 0 && xTaskGetTickCount() - start < pdMS_TO_TICKS(2000))
+        vTaskDelay(1);
+    vTaskDelay(pdMS_TO_TICKS(50));
+}
+
+int main(void)
+{
+    pty_master = posix_openpt(O_RDWR | O_NOCTTY);
+    CHECK(pty_master >= 0 && grantpt(pty_master) == 0 && unlockpt(pty_master) == 0);
+    fcntl(pty_master, F_SETFL, fcntl(pty_master, F_GETFL) | O_NONBLOCK);
+    setenv(UART_HOST_ENV_DEVICE, ptsname(pty_master), 1);
+    setenv(UART_HOST_ENV_BYTE_RATE, "1000000", 1);
+
+    message_set_integrity_mode(INTEGRITY_CRC16);
+    uart_init_with_fsm(115200, 1, 2);
+
+    static const uint8_t payload[] = {0x10, 0x00, 0x20, 0x00, 0x30, 0xAA, 0x55};
+    uint8_t frame[32], wire[64];
+    uint16_t len = frame_build(frame, 0x01, payload, sizeof(payload));
+
+    // Boot framing
+    line_write(frame, len);
+    expect_frame(frame, len);
+    CHECK_EQ(wrap_calls, 0);
+
+    // Half a length frame is in the FSM when the link task switches to COBS
+    line_write(frame, len / 2);
+    wait_rx_idle();
+    uart_set_framing(FRAMING_COBS);
+    CHECK_EQ(uart_get_framing(), FRAMING_COBS);
+    CHECK_EQ(wrap_calls, 0); // The caller never touches the FSM
+
+    // TX switches at once
+    uint8_t out[64];
+    uint16_t wire_len = frame_cobs_encode(frame, len, wire);
+    uart.send.frame(frame, len);
+    CHECK_EQ(line_read(out, wire_len, 1000), wire_len);
+    CHECK_MEM(out, wire, wire_len);
+
+    // RX switches on the next byte, in the RX task, and drops the half frame
+    line_write(wire, wire_len);
+    expect_frame(frame, len);
+    CHECK_EQ(wrap_calls, 1);
+    CHECK(!pthread_equal(wrap_thread, pthread_self()));
+
+    // And back
+    uart_set_framing(FRAMING_LENGTH);
+    CHECK_EQ(wrap_calls, 1);
+    line_write(frame, len);
+    expect_frame(frame, len);
+    CHECK_EQ(wrap_calls, 2);
+
+    // Repeated switches with nothing received in between cost one FSM reset at most
+    uart_set_framing(FRAMING_COBS);
+    uart_set_framing(FRAMING_LENGTH);
+    line_write(frame, len);
+    expect_frame(frame, len);
+    CHECK(wrap_calls <= 3);
+
+    // Receive timeout, run by the RX task while the line is idle: a cut frame is dropped, not resynced
+    uint32_t errors = fsm_integrity_error_count;
+    line_write(frame, len / 2);
+    wait_rx_idle();
+    CHECK(timeout_wait);
+    TickType_t start = xTaskGetTickCount();
+    while (timeout_wait && xTaskGetTickCount() - start < pdMS_TO_TICKS(COUNTER_TIMEOUT * UART_RX_IDLE_MS * 10))
+        vTaskDelay(1);
+    CHECK(!timeout_wait);
+    line_write(frame, len);
+    expect_frame(frame, len);
+    CHECK_EQ(fsm_integrity_error_count, errors);
+    CHECK(!uart.check.is_message());
+
+    return ht_summary("test_uart_framing");
+}
@@ -0,0 +1,271 @@
+// Link manager (uart_link.c) as initiator against a scripted peer that accepts every rate and then fails its test
+// burst. Application frames sent meanwhile must be queued and delivered in order at a settled rate, and failed
+// negotiations must back off. Runs on the pthread FreeRTOS shim with a compressed tick (HOST_TICK_US).
+
+#include <pthread.h>
+#include "host_test.h"
+#include "uart_link.h"
+#include "uart_protocol.h"
+#include "lib_uart.h"
+#include "fsm.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#define APP_PERIOD_MS 200
+#define WIRE_LOG_MAX 20000
+#define NEGOTIATIONS_CHECKED 4
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t op;          // First payload byte of link frames
+    uint32_t app_seq;    // Payload of application frames
+    uint32_t baud;       // Mode on the wire when written
+    uint8_t framing;
+    TickType_t at;
+} wire_entry_t;
+
+static pthread_mutex_t wire_lock = PTHREAD_MUTEX_INITIALIZER;
+static wire_entry_t wire_log[WIRE_LOG_MAX];
+static int wire_count;
+
+static uint32_t fake_baud = UART_LINK_BASE_BAUD;
+static Framing_Mode fake_framing = FRAMING_LENGTH;
+static QueueHandle_t peer_queue;
+
+typedef struct
+{
+    uint16_t len;
+    uint8_t data[80];
+} peer_msg_t;
+
+// ======================= Fake lib_uart =======================
+static void fake_set_baud(uint32_t baud)
+{
+    fake_baud = baud;
+}
+
+static uint32_t fake_get_baud(void)
+{
+    return fake_baud;
+}
+
+static void fake_send_frame(const uint8_t *frame, size_t length)
+{
+    wire_entry_t e = {.type = frame[2] & FRAME_TYPE_MASK, .baud = fake_baud, .framing = fake_framing,
+                      .at = xTaskGetTickCount()};
+    const uint8_t *payload = &frame[FRAME_HEADER_SIZE];
+    uint16_t payload_len = (uint16_t)(length - FRAME_HEADER_SIZE - 2);
+
+    if (e.type == UART_MSG_LINK)
+    {
+        e.op = payload[0];
+        peer_msg_t msg = {.len = payload_len < sizeof(msg.data) ? payload_len : sizeof(msg.data)};
+        memcpy(msg.data, payload, msg.len);
+        xQueueSend(peer_queue, &msg, 0);
+    }
+    else
+    {
+        memcpy(&e.app_seq, payload, sizeof(e.app_seq));
+    }
+
+    pthread_mutex_lock(&wire_lock);
+    if (wire_count < WIRE_LOG_MAX)
+    {
+        wire_log[wire_count++] = e;
+    }
+    pthread_mutex_unlock(&wire_lock);
+}
+
+void uart_set_framing(Framing_Mode mode)
+{
+    fake_framing = mode;
+}
+
+Framing_Mode uart_get_framing(void)
+{
+    return fake_framing;
+}
+
+const uart_lib_t uart = {
+    .basic = {.set_baud = fake_set_baud, .get_baud = fake_get_baud},
+    .send = {.frame = fake_send_frame},
+};
+
+// ======================= Scripted peer =======================
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    memcpy(p, &v, 4);
+}
+
+/**
+ * @brief Accepts every proposal, reports an empty test burst so nothing is ever committed
+ */
+static void peer_task(void *arg)
+{
+    (void)arg;
+    peer_msg_t msg;
+    TickType_t last_hello = 0;
+
+    while (1)
+    {
+        if (xQueueReceive(peer_queue, &msg, pdMS_TO_TICKS(50)) == pdTRUE)
+        {
+            uint8_t reply[12] = {0, msg.data[1]};
+            if (msg.data[0] == LINK_OP_PROPOSE && msg.len >= 7)
+            {
+                memcpy(reply, msg.data, 7);
+                reply[0] = LINK_OP_ACCEPT;
+                uart_link_notify_rx();
+                uart_link_handle_frame(reply, 7);
+            }
+            else if (msg.data[0] == LINK_OP_TEST_END)
+            {
+                reply[0] = LINK_OP_REPORT; // good = 0, bytes = 0, elapsed = 0
+                uart_link_notify_rx();
+                uart_link_handle_frame(reply, sizeof(reply));
+            }
+        }
+
+        if (xTaskGetTickCount() - last_hello >= pdMS_TO_TICKS(UART_LINK_HEARTBEAT_MS))
+        {
+            uint8_t hello[13] = {LINK_OP_HELLO};
+            put_u32(&hello[9], UART_LINK_BASE_BAUD);
+            last_hello = xTaskGetTickCount();
+            uart_link_notify_rx();
+            uart_link_handle_frame(hello, sizeof(hello));
+        }
+    }
+}
+
+// ======================= Application =======================
+static volatile bool app_run = true;
+static uint32_t app_sent, app_refused;
+static TickType_t app_max_block;
+
+static void app_task(void *arg)
+{
+    (void)arg;
+    uint8_t frame[16];
+
+    while (app_run)
+    {
+        uint16_t idx = 0;
+        frame[idx++] = START_BYTE;
+        frame[idx++] = START_BYTE_FOLLOW;
+        frame[idx++] = UART_MSG_DATA;
+        frame[idx++] = FRAME_HEADER_SIZE + 4 + 2;
+        frame[idx++] = 0;
+        memcpy(&frame[idx], &app_sent, 4);
+        idx += 4;
+        idx = message_append_integrity(frame, idx);
+
+        TickType_t t0 = xTaskGetTickCount();
+        if (uart_link_send(frame, idx))
+        {
+            app_sent++;
+        }
+        else
+        {
+            app_refused++;
+        }
+        TickType_t blocked = xTaskGetTickCount() - t0;
+        if (blocked > app_max_block)
+        {
+            app_max_block = blocked;
+        }
+        vTaskDelay(pdMS_TO_TICKS(APP_PERIOD_MS));
+    }
+}
+
+// ======================= Checks =======================
+/**
+ * @brief Ticks at which a negotiation started: a PROPOSE after the line was free of probes for a while
+ */
+static int negotiation_starts(TickType_t *starts, int max)
+{
+    int n = 0;
+    TickType_t last = 0;
+    bool seen = false;
+
+    pthread_mutex_lock(&wire_lock);
+    for (int i = 0; i < wire_count && n < max; i++)
+    {
+        if (wire_log[i].type != UART_MSG_LINK || wire_log[i].op != LINK_OP_PROPOSE)
+            continue;
+        if (!seen || wire_log[i].at - last > pdMS_TO_TICKS(UART_LINK_RETRY_PERIOD_MS / 2))
+            starts[n++] = wire_log[i].at;
+        seen = true;
+        last = wire_log[i].at;
+    }
+    pthread_mutex_unlock(&wire_lock);
+    return n;
+}
+
+int main(void)
+{
+    peer_queue = xQueueCreate(64, sizeof(peer_msg_t));
+    uart_link_start(UART_LINK_ROLE_INITIATOR);
+    xTaskCreate(peer_task, "peer", 4096, NULL, 5, NULL);
+    xTaskCreate(app_task, "app", 4096, NULL, 5, NULL);
+
+    // Attempts at 0, +30 s, +60 s, +120 s (simulated)
+    TickType_t starts[NEGOTIATIONS_CHECKED];
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(300000);
+    while (negotiation_starts(starts, NEGOTIATIONS_CHECKED) < NEGOTIATIONS_CHECKED && xTaskGetTickCount() < deadline)
+    {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+    // Let the last probe finish and the hold queue drain
+    vTaskDelay(pdMS_TO_TICKS(8000));
+    app_run = false;
+    vTaskDelay(pdMS_TO_TICKS(2 * APP_PERIOD_MS));
+
+    uart_link_stats_t stats;
+    uart_link_get_stats(&stats);
+    int n = negotiation_starts(starts, NEGOTIATIONS_CHECKED);
+    CHECK_EQ(n, NEGOTIATIONS_CHECKED);
+    CHECK(stats.negotiations >= NEGOTIATIONS_CHECKED);
+    CHECK_EQ(stats.current_baud, UART_LINK_BASE_BAUD);
+    CHECK_EQ(stats.current_framing, FRAMING_LENGTH);
+
+    // Backoff: each wait doubles from UART_LINK_RETRY_PERIOD_MS (plus the probe time of the failed attempt)
+    uint32_t expect_ms = UART_LINK_RETRY_PERIOD_MS;
+    for (int i = 1; i < n; i++)
+    {
+        uint32_t gap_ms = (starts[i] - starts[i - 1]) * portTICK_PERIOD_MS;
+        printf("negotiation %d after %lu ms (expected >= %lu)\n", i, (unsigned long)gap_ms, (unsigned long)expect_ms);
+        CHECK(gap_ms >= expect_ms);
+        CHECK(gap_ms < expect_ms + 10000);
+        expect_ms *= 2;
+    }
+    CHECK_EQ(stats.retry_ms, expect_ms > UART_LINK_RETRY_MAX_MS ? UART_LINK_RETRY_MAX_MS : expect_ms);
+
+    // Nothing refused, nobody waited for a probe, frames were held and all reached the wire in order
+    printf("app frames %lu, held %lu, dropped %lu, longest send %lu ms\n", (unsigned long)app_sent,
+           (unsigned long)stats.tx_held, (unsigned long)stats.tx_dropped,
+           (unsigned long)(app_max_block * portTICK_PERIOD_MS));
+    CHECK_EQ(app_refused, 0);
+    CHECK_EQ(stats.tx_dropped, 0);
+    CHECK(stats.tx_held > 0);
+    CHECK(app_max_block * portTICK_PERIOD_MS < UART_LINK_TX_WAIT_MS);
+
+    uint32_t next = 0;
+    int off_mode = 0;
+    pthread_mutex_lock(&wire_lock);
+    for (int i = 0; i < wire_count; i++)
+    {
+        if (wire_log[i].type != UART_MSG_DATA)
+            continue;
+        CHECK_EQ(wire_log[i].app_seq, next);
+        next = wire_log[i].app_seq + 1;
+        // A probe never lets application frames through at the mode under test
+        if (wire_log[i].baud != UART_LINK_BASE_BAUD || wire_log[i].framing != FRAMING_LENGTH)
+            off_mode++;
+    }
+    pthread_mutex_unlock(&wire_lock);
+    CHECK_EQ(next, app_sent);
+    CHECK_EQ(off_mode, 0);
+
+    return ht_summary("test_uart_link");
+}
@@ -0,0 +1,163 @@
+// Wi-Fi connect state machine (wifi_connect_sm.c) against a simulated radio: fast path, ranking, hidden SSID, failure
+
+#include "host_test.h"
+#include "wifi_connect_sm.h"
+
+typedef struct
+{
+    const char *ok_ssid;     // Only this SSID associates
+    const uint8_t *ok_bssid; // And only through this AP when pinned
+    int fail_first;          // The first n connect() calls fail anyway
+    int calls;
+    int scans;
+    wifi_scan_ap_t aps[8];
+    int n_aps;
+    uint32_t sim_ms;         // Simulated time spent: timeouts on failure, association time on success
+    char log[256];
+} sim_radio_t;
+
+static bool sim_connect(void *ctx, const wifi_credential_t *cred, const uint8_t *bssid, uint8_t channel,
+                        uint32_t timeout_ms)
+{
+    sim_radio_t *s = ctx;
+    char entry[48];
+    s->calls++;
+    snprintf(entry, sizeof(entry), "%s/%s/%u ", cred->ssid, bssid ? "pin" : "any", channel);
+    strncat(s->log, entry, sizeof(s->log) - strlen(s->log) - 1);
+
+    bool ok = s->ok_ssid && strcmp(cred->ssid, s->ok_ssid) == 0 &&
+              (!bssid || !s->ok_bssid || memcmp(bssid, s->ok_bssid, 6) == 0) && s->calls > s->fail_first;
+    s->sim_ms += ok ? ((bssid && channel) ? 300 : 2500) : timeout_ms;
+    return ok;
+}
+
+static int sim_scan(void *ctx, wifi_scan_ap_t *aps, int max)
+{
+    sim_radio_t *s = ctx;
+    int n = s->n_aps < max ? s->n_aps : max;
+    s->scans++;
+    s->sim_ms += 2200;
+    memcpy(aps, s->aps, sizeof(*aps) * n);
+    return n;
+}
+
+static wifi_scan_ap_t sim_ap(const char *ssid, uint8_t bssid_last, uint8_t channel, int8_t rssi)
+{
+    wifi_scan_ap_t ap = {0};
+    snprintf(ap.ssid, sizeof(ap.ssid), "%s", ssid);
+    ap.bssid[5] = bssid_last;
+    ap.channel = channel;
+    ap.rssi = rssi;
+    return ap;
+}
+
+int main(void)
+{
+    wifi_credentials_list_t creds = {.count = 3};
+    strcpy(creds.credentials[0].ssid, "home");
+    strcpy(creds.credentials[1].ssid, "office");
+    strcpy(creds.credentials[2].ssid, "hidden");
+
+    static const uint8_t bssid2[6] = {0, 0, 0, 0, 0, 2};
+    static const uint8_t bssid3[6] = {0, 0, 0, 0, 0, 3};
+    wifi_fast_cache_t cache = {.version = WIFI_SM_CACHE_VERSION, .channel = 6};
+    memcpy(cache.bssid, bssid2, 6);
+    strcpy(cache.ssid, "office");
+
+    sim_radio_t s;
+    wifi_connect_ops_t ops = {sim_connect, sim_scan, &s};
+    wifi_connect_result_t r;
+
+    // Fast path: cached BSSID/channel still good, no scan
+    memset(&s, 0, sizeof(s));
+    s.ok_ssid = "office";
+    s.ok_bssid = bssid2;
+    CHECK(wifi_sm_run(&ops, &creds, &cache, &r));
+    CHECK_EQ(r.phase, WIFI_SM_FAST);
+    CHECK_EQ(r.cred_index, 1);
+    CHECK_EQ(r.attempts, 1);
+    CHECK_EQ(s.scans, 0);
+    printf("fast:   %s%lu ms\n", s.log, (unsigned long)s.sim_ms);
+
+    // Cache stale (AP replaced): one scan, saved networks strongest first, pinned to the AP
+    memset(&s, 0, sizeof(s));
+    s.ok_ssid = "office";
+    s.ok_bssid = bssid3;
+    s.aps[0] = sim_ap("home", 1, 1, -80);
+    s.aps[1] = sim_ap("office", 3, 11, -50);
+    s.aps[2] = sim_ap("office", 4, 1, -70);
+    s.aps[3] = sim_ap("x", 9, 3, -30);
+    s.n_aps = 4;
+    CHECK(wifi_sm_run(&ops, &creds, &cache, &r));
+    CHECK_EQ(r.phase, WIFI_SM_RANKED);
+    CHECK_EQ(r.cred_index, 1);
+    CHECK_EQ(r.attempts, 2);
+    CHECK_EQ(r.scan_count, 4);
+    CHECK_EQ(s.scans, 1);
+    printf("ranked: %s%lu ms\n", s.log, (unsigned long)s.sim_ms);
+
+    // Ranking keeps the strongest AP per credential and drops unknown SSIDs
+    wifi_candidate_t cand[MAX_WIFI_CREDENTIALS];
+    int n = wifi_sm_rank(creds.credentials, creds.count, s.aps, s.n_aps, cand);
+    CHECK_EQ(n, 2);
+    CHECK_EQ(cand[0].cred_index, 1);
+    CHECK_EQ(cand[0].channel, 11);
+    CHECK_EQ(cand[0].bssid[5], 3);
+    CHECK_EQ(cand[1].cred_index, 0);
+
+    // A transient failure on the best AP is retried before moving on
+    memset(&s, 0, sizeof(s));
+    s.ok_ssid = "office";
+    s.fail_first = 1;
+    s.aps[0] = sim_ap("office", 3, 11, -50);
+    s.n_aps = 1;
+    CHECK(wifi_sm_run(&ops, &creds, NULL, &r));
+    CHECK_EQ(r.phase, WIFI_SM_RANKED);
+    CHECK_EQ(r.attempts, 2);
+
+    // Hidden SSID: not in the scan, reached by a plain attempt
+    memset(&s, 0, sizeof(s));
+    s.ok_ssid = "hidden";
+    s.aps[0] = sim_ap("home", 1, 1, -80);
+    s.n_aps = 1;
+    CHECK(wifi_sm_run(&ops, &creds, NULL, &r));
+    CHECK_EQ(r.phase, WIFI_SM_HIDDEN);
+    CHECK_EQ(r.cred_index, 2);
+    printf("hidden: %s\n", s.log);
+
+    // Nothing works: bounded by one fast try, one scan, the retries of the seen networks and one try per hidden one
+    memset(&s, 0, sizeof(s));
+    s.aps[0] = sim_ap("home", 1, 1, -80);
+    s.n_aps = 1;
+    CHECK(!wifi_sm_run(&ops, &creds, &cache, &r));
+    CHECK_EQ(r.phase, WIFI_SM_FAILED);
+    CHECK_EQ(r.cred_index, -1);
+    CHECK_EQ(r.attempts, 1 + WIFI_SM_RETRY_PER_WIFI + 2);
+    CHECK(s.sim_ms <= WIFI_SM_FAST_TIMEOUT_MS + 2200 + (WIFI_SM_RETRY_PER_WIFI + 2) * WIFI_SM_CONNECT_TIMEOUT_MS);
+    printf("fail:   %s%lu ms (3 credentials x 3 tries x 16 s before: %d ms)\n", s.log, (unsigned long)s.sim_ms,
+           3 * 3 * (15000 + 1000));
+
+    // Cached SSID no longer saved: the fast path is skipped
+    strcpy(cache.ssid, "gone");
+    memset(&s, 0, sizeof(s));
+    s.ok_ssid = "home";
+    s.aps[0] = sim_ap("home", 1, 1, -80);
+    s.n_aps = 1;
+    CHECK(wifi_sm_run(&ops, &creds, &cache, &r));
+    CHECK_EQ(r.phase, WIFI_SM_RANKED);
+    CHECK_EQ(r.attempts, 1);
+
+    // Wrong cache version counts as no cache
+    strcpy(cache.ssid, "office");
+    cache.version = WIFI_SM_CACHE_VERSION + 1;
+    memset(&s, 0, sizeof(s));
+    s.ok_ssid = "office";
+    s.ok_bssid = bssid2;
+    s.aps[0] = sim_ap("office", 2, 6, -60);
+    s.n_aps = 1;
+    CHECK(wifi_sm_run(&ops, &creds, &cache, &r));
+    CHECK_EQ(r.phase, WIFI_SM_RANKED);
+    CHECK_EQ(s.scans, 1);
+
+    return ht_summary("test_wifi_connect_sm");
+}
@@ -0,0 +1,303 @@
+#include "mqtt_loopback.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    bool used;
+    uint8_t qos;
+    char filter[MQTT_LOOPBACK_TOPIC_LEN];
+    mqtt_loopback_cb_t cb;
+    void *ctx;
+} loopback_sub_t;
+
+typedef struct
+{
+    bool used;
+    uint8_t qos;
+    uint16_t len;
+    char topic[MQTT_LOOPBACK_TOPIC_LEN];
+    uint8_t data[MQTT_LOOPBACK_RETAINED_LEN];
+} loopback_retained_t;
+
+typedef struct
+{
+    mqtt_loopback_cb_t cb;
+    void *ctx;
+    uint8_t qos;
+} loopback_target_t;
+
+static loopback_sub_t subs[MQTT_LOOPBACK_MAX_SUBS];
+static loopback_retained_t retained[MQTT_LOOPBACK_MAX_RETAINED];
+static mqtt_loopback_lock_t broker_lock;
+static mqtt_loopback_stats_t stats;
+static uint16_t next_msg_id = 0;
+
+static void lb_lock(void)
+{
+    if (broker_lock.lock)
+    {
+        broker_lock.lock(broker_lock.arg);
+    }
+}
+
+static void lb_unlock(void)
+{
+    if (broker_lock.unlock)
+    {
+        broker_lock.unlock(broker_lock.arg);
+    }
+}
+
+/**
+ * @brief Filter syntax: '#' only as the whole last level, '+' only as a whole level
+ */
+static bool lb_filter_valid(const char *filter)
+{
+    size_t len = strlen(filter);
+
+    if (len == 0 || len >= MQTT_LOOPBACK_TOPIC_LEN)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        if (filter[i] != '+' && filter[i] != '#')
+        {
+            continue;
+        }
+        bool level_start = (i == 0 || filter[i - 1] == '/');
+        bool level_end = (i + 1 == len || filter[i + 1] == '/');
+        if (!level_start || !level_end || (filter[i] == '#' && i + 1 != len))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool mqtt_topic_match(const char *filter, const char *topic, int topic_len)
+{
+    int pos = 0;
+
+    // '$SYS/...' style topics are only matched by filters that spell out the first level
+    if (topic_len > 0 && topic[0] == '$' && (filter[0] == '+' || filter[0] == '#'))
+    {
+        return false;
+    }
+
+    while (1)
+    {
+        const char *slash = strchr(filter, '/');
+        size_t flen = slash ? (size_t)(slash - filter) : strlen(filter);
+        int end = pos;
+        while (end < topic_len && topic[end] != '/')
+        {
+            end++;
+        }
+
+        if (flen == 1 && filter[0] == '#')
+        {
+            return true; // also matches the parent level: "a/#" matches "a"
+        }
+        if (pos > topic_len)
+        {
+            return false; // topic ran out of levels
+        }
+        if (!(flen == 1 && filter[0] == '+') && !((size_t)(end - pos) == flen && memcmp(filter, &topic[pos], flen) == 0))
+        {
+            return false;
+        }
+
+        bool topic_last = (end >= topic_len);
+        if (slash == NULL)
+        {
+            return topic_last;
+        }
+        filter = slash + 1;
+        pos = end + 1; // past topic_len when the topic ended, only '#' can still match
+    }
+}
+
+void mqtt_loopback_init(const mqtt_loopback_lock_t *lock)
+{
+    memset(&broker_lock, 0, sizeof(broker_lock));
+    if (lock)
+    {
+        broker_lock = *lock;
+    }
+    memset(subs, 0, sizeof(subs));
+    memset(retained, 0, sizeof(retained));
+    memset(&stats, 0, sizeof(stats));
+}
+
+int mqtt_loopback_subscribe(const char *filter, int qos, mqtt_loopback_cb_t cb, void *ctx)
+{
+    // Snapshot of the retained messages to replay after unlocking, static to keep ~5 KB off the stack
+    // (subscriptions are made at init, one task at a time)
+    static loopback_retained_t replay[MQTT_LOOPBACK_MAX_RETAINED];
+    int n_replay = 0;
+    int id = -1;
+    uint8_t sub_qos = (uint8_t)(qos > 1 ? 1 : qos);
+
+    if (filter == NULL || cb == NULL || !lb_filter_valid(filter))
+    {
+        return -1;
+    }
+
+    lb_lock();
+    for (int i = 0; i < MQTT_LOOPBACK_MAX_SUBS; i++)
+    {
+        if (!subs[i].used)
+        {
+            subs[i] = (loopback_sub_t){.used = true, .qos = sub_qos, .cb = cb, .ctx = ctx};
+            strcpy(subs[i].filter, filter);
+            id = i;
+            break;
+        }
+    }
+    for (int r = 0; id >= 0 && r < MQTT_LOOPBACK_MAX_RETAINED; r++)
+    {
+        if (retained[r].used && mqtt_topic_match(filter, retained[r].topic, strlen(retained[r].topic)))
+        {
+            replay[n_replay++] = retained[r];
+        }
+    }
+    lb_unlock();
+
+    for (int r = 0; r < n_replay; r++)
+    {
+        int dq = replay[r].qos < sub_qos ? replay[r].qos : sub_qos;
+        cb(ctx, replay[r].topic, strlen(replay[r].topic), replay[r].data, replay[r].len, dq, true);
+    }
+    return id;
+}
+
+void mqtt_loopback_unsubscribe(int id)
+{
+    if (id < 0 || id >= MQTT_LOOPBACK_MAX_SUBS)
+    {
+        return;
+    }
+    lb_lock();
+    subs[id].used = false;
+    lb_unlock();
+}
+
+/**
+ * @brief Keep, replace or (empty payload) clear the retained message of a topic
+ */
+static void lb_retain(const char *topic, const void *data, int len, int qos)
+{
+    int free_slot = -1;
+
+    for (int r = 0; r < MQTT_LOOPBACK_MAX_RETAINED; r++)
+    {
+        if (retained[r].used && strcmp(retained[r].topic, topic) == 0)
+        {
+            free_slot = r;
+            break;
+        }
+        if (!retained[r].used && free_slot < 0)
+        {
+            free_slot = r;
+        }
+    }
+
+    if (len == 0)
+    {
+        if (free_slot >= 0 && retained[free_slot].used && strcmp(retained[free_slot].topic, topic) == 0)
+        {
+            retained[free_slot].used = false;
+        }
+        return;
+    }
+    if (free_slot < 0 || len > MQTT_LOOPBACK_RETAINED_LEN)
+    {
+        stats.retained_dropped++;
+        return;
+    }
+
+    loopback_retained_t *slot = &retained[free_slot];
+    slot->used = true;
+    slot->qos = (uint8_t)qos;
+    slot->len = (uint16_t)len;
+    strcpy(slot->topic, topic);
+    memcpy(slot->data, data, len);
+}
+
+int mqtt_loopback_publish(const char *topic, const void *data, int len, int qos, bool retain)
+{
+    loopback_target_t targets[MQTT_LOOPBACK_MAX_SUBS];
+    int n_targets = 0;
+    size_t topic_len = topic ? strlen(topic) : 0;
+
+    if (topic_len == 0 || topic_len >= MQTT_LOOPBACK_TOPIC_LEN || strpbrk(topic, "+#") != NULL)
+    {
+        return -1;
+    }
+    if (len <= 0)
+    {
+        len = data ? (int)strlen((const char *)data) : 0; // 0 = '\0' terminated, like esp_mqtt_client_publish
+    }
+    qos = qos > 1 ? 1 : qos;
+
+    lb_lock();
+    if (retain)
+    {
+        lb_retain(topic, data, len, qos);
+    }
+    for (int i = 0; i < MQTT_LOOPBACK_MAX_SUBS; i++)
+    {
+        if (subs[i].used && mqtt_topic_match(subs[i].filter, topic, (int)topic_len))
+        {
+            targets[n_targets++] = (loopback_target_t){subs[i].cb, subs[i].ctx, subs[i].qos < qos ? subs[i].qos : (uint8_t)qos};
+        }
+    }
+    stats.published++;
+    stats.delivered += n_targets;
+    int msg_id = 0;
+    if (qos > 0)
+    {
+        next_msg_id = next_msg_id == 0xFFFF ? 1 : next_msg_id + 1;
+        msg_id = next_msg_id;
+    }
+    lb_unlock();
+
+    // Live messages go out with retain = 0, as a broker does for existing subscriptions
+    for (int i = 0; i < n_targets; i++)
+    {
+        targets[i].cb(targets[i].ctx, topic, (int)topic_len, data, len, targets[i].qos, false);
+    }
+    return msg_id;
+}
+
+void mqtt_loopback_get_stats(mqtt_loopback_stats_t *out)
+{
+    lb_lock();
+    *out = stats;
+    lb_unlock();
+}
+
+static int lb_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+void mqtt_bench_result(uint32_t *latency_us, uint32_t count, uint64_t elapsed_us, mqtt_bench_result_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (count == 0)
+    {
+        return;
+    }
+    qsort(latency_us, count, sizeof(latency_us[0]), lb_cmp_u32);
+    out->count = count;
+    // Nearest rank
+    out->p50_us = latency_us[(count * 50 + 99) / 100 - 1];
+    out->p99_us = latency_us[(count * 99 + 99) / 100 - 1];
+    out->max_us = latency_us[count - 1];
+    out->msgs_per_s = elapsed_us ? (uint32_t)((uint64_t)count * 1000000u / elapsed_us) : 0;
+}
@@ -0,0 +1,83 @@
+#ifndef MQTT_LOOPBACK_H
+#define MQTT_LOOPBACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * In-process MQTT 3.1.1 broker stand-in, for measuring the pipeline without a network:
+ *   - QoS 0 / 1 (delivery is synchronous, so a QoS 1 publish is acknowledged on return)
+ *   - retained messages (empty retained payload clears the topic), sent to new subscriptions
+ *   - '+' / '#' filters, wildcards never match '$' topics at the first level
+ * Pure C (no ESP-IDF / FreeRTOS), builds on the host as well. my_mqtt switches to it when the
+ * server URI is MQTT_LOOPBACK_URI; a benchmark subscribes its "server side" here directly.
+ * Callbacks run in the publisher's context, outside the lock, and may publish themselves.
+ */
+
+// ============ CONFIG ============
+#define MQTT_LOOPBACK_URI "loopback://"
+#define MQTT_LOOPBACK_MAX_SUBS 16
+#define MQTT_LOOPBACK_MAX_RETAINED 8
+#define MQTT_LOOPBACK_TOPIC_LEN 128
+#define MQTT_LOOPBACK_RETAINED_LEN 512
+
+typedef void (*mqtt_loopback_cb_t)(void *ctx, const char *topic, int topic_len, const void *data, int len, int qos,
+                                   bool retained);
+
+typedef struct
+{
+    void (*lock)(void *arg);
+    void (*unlock)(void *arg);
+    void *arg;
+} mqtt_loopback_lock_t;
+
+typedef struct
+{
+    uint32_t published;
+    uint32_t delivered;
+    uint32_t retained_dropped; // retained store full or payload too large
+} mqtt_loopback_stats_t;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint32_t msgs_per_s;
+} mqtt_bench_result_t;
+
+// ============ API ============
+/**
+ * @brief Reset the broker (subscriptions, retained store, counters)
+ * @param lock Optional, needed when several tasks publish / subscribe
+ */
+void mqtt_loopback_init(const mqtt_loopback_lock_t *lock);
+
+/**
+ * @brief Add a subscription, retained messages matching it are delivered before returning
+ * @return subscription id, -1 if the filter is malformed or the table is full
+ */
+int mqtt_loopback_subscribe(const char *filter, int qos, mqtt_loopback_cb_t cb, void *ctx);
+void mqtt_loopback_unsubscribe(int id);
+
+/**
+ * @brief Deliver to every matching subscription (once per subscription, like a broker)
+ * @return message id like esp_mqtt_client_publish(): 0 for QoS 0, > 0 for QoS 1, -1 on a bad topic
+ */
+int mqtt_loopback_publish(const char *topic, const void *data, int len, int qos, bool retain);
+
+void mqtt_loopback_get_stats(mqtt_loopback_stats_t *out);
+
+/**
+ * @brief MQTT filter match ('+', '#', '$' rule), topic does not have to be '\0' terminated
+ */
+bool mqtt_topic_match(const char *filter, const char *topic, int topic_len);
+
+/**
+ * @brief p50 / p99 / max of latency samples (sorted in place) and throughput over elapsed_us
+ */
+void mqtt_bench_result(uint32_t *latency_us, uint32_t count, uint64_t elapsed_us, mqtt_bench_result_t *out);
+
+#endif // MQTT_LOOPBACK_H
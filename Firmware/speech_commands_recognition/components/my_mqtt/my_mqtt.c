@@ -1,11 +1,27 @@
 #include "my_mqtt.h"
+#include "mqtt_loopback.h"
 
 static esp_mqtt_client_handle_t client = NULL;
 static my_mqtt_message_t last_msg;
 static bool msg_received = false;
 static my_mqtt_init_t mqtt_cfg_local;
+static bool loopback = false; // server = MQTT_LOOPBACK_URI, in-process broker instead of the network
 
+/**
+ * @brief Loopback delivery, same copy as MQTT_EVENT_DATA
+ */
+static void my_mqtt_loopback_deliver(void *ctx, const char *topic, int topic_len, const void *data, int len, int qos,
+                                     bool retained)
+{
+    memset(&last_msg, 0, sizeof(last_msg));
+    last_msg.topic_len = topic_len < sizeof(last_msg.topic) ? topic_len : sizeof(last_msg.topic) - 1;
+    memcpy(last_msg.topic, topic, last_msg.topic_len);
 
+    last_msg.payload_len = len < sizeof(last_msg.payload) ? len : sizeof(last_msg.payload) - 1;
+    memcpy(last_msg.payload, data, last_msg.payload_len);
+
+    msg_received = true;
+}
 
 /**
  * @brief callback MQTT event handler
@@ -78,6 +94,20 @@ esp_err_t my_mqtt_init(my_mqtt_init_t *cfg)
 {
     mqtt_cfg_local = *cfg;
 
+    if (strncmp(cfg->server, MQTT_LOOPBACK_URI, strlen(MQTT_LOOPBACK_URI)) == 0)
+    {
+        // Single publisher task here, the broker needs no lock
+        mqtt_loopback_init(NULL);
+        loopback = true;
+        mqtt_loopback_subscribe(mqtt_cfg_local.topic_sub, 0, my_mqtt_loopback_deliver, NULL);
+        ESP_LOGW(TAG_MQTT, "Using the in-process loopback broker, nothing leaves the chip");
+        if (mqtt_cfg_local.on_connected_cb != NULL)
+        {
+            mqtt_cfg_local.on_connected_cb();
+        }
+        return ESP_OK;
+    }
+
     esp_mqtt_client_config_t mqtt_cfg = {
         .broker.address.uri = cfg->server,
     };
@@ -98,9 +128,10 @@ esp_err_t my_mqtt_init(my_mqtt_init_t *cfg)
  */
 void my_mqtt_pub(const char *topic, const char *msg)
 {
-    if (client)
+    if (client || loopback)
     {
-        int msg_id = esp_mqtt_client_publish(client, topic, msg, 0, 1, 0);
+        int msg_id = loopback ? mqtt_loopback_publish(topic, msg, 0, 1, false)
+                              : esp_mqtt_client_publish(client, topic, msg, 0, 1, 0);
         if (msg_id >= 0)
             ESP_LOGI(TAG_MQTT, "Published -> topic: %s | msg: %s", topic, msg);
         else
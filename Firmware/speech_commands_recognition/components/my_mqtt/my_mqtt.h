@@ -32,6 +32,8 @@ typedef struct
 
 /**
  * @brief initialize MQTT client
+ * @details server = MQTT_LOOPBACK_URI ("loopback://") uses the in-process broker of mqtt_loopback,
+ *          connected on return, for benchmarks without a network
  *
  * @param struct init cfg
  */
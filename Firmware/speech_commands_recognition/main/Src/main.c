@@ -101,4 +101,16 @@ void app_main(void)
         NULL,
         MQTT_TASK_CORE);
     ESP_LOGI(TAG, "  [OK] mqtt_task on Core %d", MQTT_TASK_CORE);
+
+#if MQTT_LOOPBACK_BENCH
+    // Task 4: loopback benchmark, runs once
+    xTaskCreatePinnedToCore(
+        plug_bench_task,
+        "bench_task",
+        BENCH_TASK_STACK_SIZE,
+        NULL,
+        BENCH_TASK_PRIORITY,
+        NULL,
+        MQTT_TASK_CORE);
+#endif
 }
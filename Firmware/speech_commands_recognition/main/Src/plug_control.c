@@ -6,9 +6,14 @@
 #include "plug_control.h"
 #include "app_config.h"
 #include "my_mqtt.h"
-#include "cJSON.h"
+#include "json_writer.h"
 #include "esp_log.h"
 #include <string.h>
+#if MQTT_LOOPBACK_BENCH
+#include "mqtt_loopback.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#endif
 
 static const char *TAG = "[PLUG]";
 
@@ -92,51 +97,39 @@ void plug_send_command(plug_id_t plug, plug_state_t state)
 }
 /**
  * @brief Publish plug state to MQTT
- * @details Constructs JSON message and publishes to MQTT topic
+ * @details Writes the JSON message into a stack buffer (no cJSON tree) and publishes it
  * @param plug
  * @param state
  */
 void plug_publish_mqtt(plug_id_t plug, plug_state_t state)
 {
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to create JSON object");
-        return;
-    }
-
-    cJSON *data = cJSON_CreateObject();
-    if (data == NULL)
-    {
-        ESP_LOGE(TAG, "Failed to create data JSON object");
-        cJSON_Delete(root);
-        return;
-    }
-
     const char *plug_name = get_plug_name(plug);
     if (plug_name == NULL)
     {
-        cJSON_Delete(root);
-        cJSON_Delete(data);
         ESP_LOGE(TAG, "Invalid plug");
         return;
     }
 
     // Build JSON: {"type":"control","data":{"plug":"plug_1","status":"on"}}
-    cJSON_AddStringToObject(root, "type", "control");
-    cJSON_AddStringToObject(data, "plug", plug_name);
-    cJSON_AddStringToObject(data, "status", state == STATE_ON ? "on" : "off");
-    cJSON_AddItemToObject(root, "data", data);
-
-    char *json_str = cJSON_PrintUnformatted(root);
-    if (json_str != NULL)
+    char json_str[MQTT_JSON_MAX_LEN];
+    json_writer_t w;
+    json_writer_init(&w, json_str, sizeof(json_str));
+    json_writer_begin_object(&w, NULL);
+    json_writer_string(&w, "type", "control");
+    json_writer_begin_object(&w, "data");
+    json_writer_string(&w, "plug", plug_name);
+    json_writer_string(&w, "status", state == STATE_ON ? "on" : "off");
+    json_writer_end_object(&w);
+    json_writer_end_object(&w);
+
+    if (json_writer_finish(&w) == 0)
     {
-        ESP_LOGI(TAG, "Publishing: %s", json_str);
-        my_mqtt_pub(mqtt_cfg.topic_pub, json_str);
-        free(json_str);
+        ESP_LOGE(TAG, "JSON message does not fit %d bytes", MQTT_JSON_MAX_LEN);
+        return;
     }
 
-    cJSON_Delete(root);
+    ESP_LOGI(TAG, "Publishing: %s", json_str);
+    my_mqtt_pub(mqtt_cfg.topic_pub, json_str);
 }
 
 /**
@@ -192,9 +185,62 @@ void mqtt_task(void *arg)
         if (xQueueReceive(g_mqtt_queue, &msg, portMAX_DELAY) == pdTRUE)
         {
             plug_publish_mqtt(msg.plug, msg.state);
-            vTaskDelay(pdMS_TO_TICKS(50)); // Small delay between publishes
+            vTaskDelay(pdMS_TO_TICKS(MQTT_PUBLISH_GAP_MS)); // Small delay between publishes
+        }
+    }
+
+    vTaskDelete(NULL);
+}
+
+#if MQTT_LOOPBACK_BENCH
+static SemaphoreHandle_t bench_reply = NULL;
+
+/**
+ * @brief Server side of the bench, runs in mqtt_task (inside my_mqtt_pub)
+ */
+static void bench_on_server_message(void *ctx, const char *topic, int topic_len, const void *data, int len, int qos,
+                                    bool retained)
+{
+    xSemaphoreGive(bench_reply);
+}
+
+/**
+ * @brief Plug command benchmark on the loopback broker
+ * @details Closed loop: plug_send_command -> g_mqtt_queue -> mqtt_task -> JSON -> publish, timed until the
+ *          subscriber on MQTT_TOPIC_PUB gets it. The next command waits for the previous one, so msgs/s
+ *          shows the MQTT_PUBLISH_GAP_MS pacing of mqtt_task.
+ * @param arg
+ */
+void plug_bench_task(void *arg)
+{
+    static uint32_t latency_us[MQTT_LOOPBACK_BENCH_COUNT];
+    uint32_t done = 0;
+
+    bench_reply = xSemaphoreCreateBinary();
+    if (bench_reply == NULL || mqtt_loopback_subscribe(MQTT_TOPIC_PUB, 1, bench_on_server_message, NULL) < 0)
+    {
+        ESP_LOGE(TAG, "[BENCH] setup failed");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    for (uint32_t k = 0; k < MQTT_LOOPBACK_BENCH_COUNT; k++)
+    {
+        int64_t sent = esp_timer_get_time();
+        plug_send_command((plug_id_t)(k % 3), (k / 3) % 2 ? STATE_ON : STATE_OFF);
+        if (xSemaphoreTake(bench_reply, pdMS_TO_TICKS(MQTT_LOOPBACK_BENCH_TIMEOUT_MS)) != pdTRUE)
+        {
+            ESP_LOGW(TAG, "[BENCH] command %lu not published", k);
+            break;
         }
+        latency_us[done++] = (uint32_t)(esp_timer_get_time() - sent);
     }
 
+    mqtt_bench_result_t r;
+    mqtt_bench_result(latency_us, done, (uint64_t)(esp_timer_get_time() - start), &r);
+    ESP_LOGI(TAG, "[BENCH] plug commands: %lu msgs, p50 %lu us, p99 %lu us, max %lu us, %lu msgs/s", r.count, r.p50_us,
+             r.p99_us, r.max_us, r.msgs_per_s);
     vTaskDelete(NULL);
 }
+#endif
@@ -21,22 +21,34 @@
 #define WIFI_PASSWORD "11122004"
 
 /* ================== MQTT CONFIG ================== */
+// 1 = publish to the in-process broker (mqtt_loopback) and run the plug command latency benchmark
+#define MQTT_LOOPBACK_BENCH 0
+#define MQTT_LOOPBACK_BENCH_COUNT 100
+#define MQTT_LOOPBACK_BENCH_TIMEOUT_MS 1000
+#if MQTT_LOOPBACK_BENCH
+#define MQTT_BROKER "loopback://"
+#else
 #define MQTT_BROKER "mqtt://broker.emqx.io"
+#endif
 #define MQTT_TOPIC_PUB "GateWays/Server"
 #define MQTT_TOPIC_SUB "Server/Gateways"
 
 /* ================== QUEUE CONFIG ================== */
 #define MQTT_QUEUE_SIZE 10
+#define MQTT_JSON_MAX_LEN 96 // control message published by plug_publish_mqtt
+#define MQTT_PUBLISH_GAP_MS 50 // mqtt_task pause after each publish, caps commands at ~1000/MQTT_PUBLISH_GAP_MS per second
 #define MN_QUEUE_SIZE 5
 
 /* ================== TASK CONFIG ================== */
 #define FEED_TASK_STACK_SIZE 4096
 #define DETECT_TASK_STACK_SIZE 8192
 #define MQTT_TASK_STACK_SIZE 4096
+#define BENCH_TASK_STACK_SIZE 3072
 
 #define FEED_TASK_PRIORITY 5
 #define DETECT_TASK_PRIORITY 5
 #define MQTT_TASK_PRIORITY 4
+#define BENCH_TASK_PRIORITY 3
 
 #define FEED_TASK_CORE 0
 #define DETECT_TASK_CORE 1
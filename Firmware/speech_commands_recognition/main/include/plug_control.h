@@ -85,4 +85,10 @@ void plug_set_all_flags(plug_state_t state);
  */
 void mqtt_task(void *arg);
 
+/**
+ * @brief Loopback benchmark task (MQTT_LOOPBACK_BENCH = 1 only), logs p50/p99 latency and msgs/s once
+ * @param arg Task argument (unused)
+ */
+void plug_bench_task(void *arg);
+
 #endif /* PLUG_CONTROL_H */